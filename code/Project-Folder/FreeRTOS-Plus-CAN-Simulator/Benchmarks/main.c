@@ -0,0 +1,4164 @@
+/*
+ * Benchmarks for the FreeRTOS+IO LPC17xx CAN driver, run on the host against
+ * the simulation in Source/Simulator.
+ *
+ * Twenty-one measurements are made, each on its own freshly configured bus:
+ *
+ * 1) Throughput.  CAN1 sends a stream of 8 byte frames through its Tx frame
+ *    queue, and CAN2 receives them through its Rx frame queue.  The frame rate
+ *    is reported against the rate the bus could carry, together with the
+ *    register accesses and interrupt time each frame costs.  The bus load
+ *    estimated by the driver's analytics is reported alongside the measured
+ *    bus utilisation.
+ *
+ * 2) Rx latency.  A remote node sends a frame every millisecond, and a task
+ *    blocked on FreeRTOS_read() receives it.  The latency is the time from the
+ *    end of the frame on the bus to FreeRTOS_read() returning.  The timestamp
+ *    the driver gave each frame is also compared with the end of the frame,
+ *    and the period and jitter measured by the driver's analytics are
+ *    reported.
+ *
+ * 3) Burst loss.  A remote node keeps the bus 100% loaded with the shortest
+ *    possible frames while the application only drains the Rx frame queue
+ *    every few milliseconds.  Frames lost by the hardware and by the queue are
+ *    reported separately.
+ *
+ * 4) Error recovery.  The throughput test is repeated with errors injected
+ *    into a proportion of the frames, to show the cost of retransmission and
+ *    that no frame is lost or duplicated.
+ *
+ * 5) ISO-TP.  A 4096 byte message is sent from an ISO-TP session on CAN1 to
+ *    one on CAN2, first with no flow control limits and then with the
+ *    receiver asking for blocks of 8 frames 1ms apart.  The transfer time and
+ *    the bus utilisation show the cost of the flow control.  Then a message is
+ *    sent to nobody, and the sender must give up once N_Bs has passed without
+ *    a flow control frame, however long its Tx timeout.  Finally the receiver
+ *    is sent only a first frame, and must abandon the message once N_Cr has
+ *    passed without a consecutive frame, then still receive the next one.
+ *
+ * 6) J1939, at 250 kbit/s.  Two J1939 nodes contend for the same address,
+ *    then a remote node floods the bus with a single frame PGN while the node
+ *    on CAN2 dispatches every frame to a handler from the CAN interrupt, among
+ *    64 other handlers.  Finally a BAM and an RTS/CTS message are sent from
+ *    the node on CAN1 to the node on CAN2.
+ *
+ * 7) Subscriptions.  A remote node sends a repeating mix of standard and
+ *    extended IDs.  Three subscribers on CAN2 - standing in for a control
+ *    task, a logging task and a diagnostics task - each receive only the
+ *    frames they subscribed to, alongside a fourth that holds many more
+ *    subscriptions that never match, while the frames nobody subscribed to
+ *    still reach the reader of CAN2 itself.
+ *
+ * 8) Cyclic Tx.  CAN1 sends 60 messages with periods from 10ms to 1s, first
+ *    from a loop that wakes every millisecond and writes the messages that are
+ *    due, all with the same phase, then from the driver's cyclic Tx scheduler
+ *    with offsets chosen by the driver.  The busiest millisecond on the bus
+ *    and the worst jitter of any message show the cost of sending everything
+ *    on the same tick.
+ *
+ * 9) CAN-over-UDP.  The lwIP CANUDPBridge application from Demo-2, running
+ *    over the host's sockets, forwards the frames received by CAN2 to a UDP
+ *    peer on the loopback interface - first at full bus load, then one frame
+ *    every millisecond - and injects frames the peer sends through CAN1.
+ *    The frames carried by each datagram and the longest any frame waited
+ *    show the effect of batching, and the bus utilisation shows the peer can
+ *    stimulate the bus at full rate.
+ *
+ * 10) SD card logger, at 500 kbit/s.  The CAN logger from Demo-2 logs the
+ *    frames a remote node sends at 100% bus load through the real FatFs, to
+ *    a simulated card that stalls for 100ms every 64K written.  It is run as
+ *    the two tasks it is meant to be run as, the collector preempting the
+ *    writer while the card is busy, and then from a single loop that collects
+ *    and writes in turn.  The log written by the two tasks is read back and
+ *    every frame checked.
+ *
+ * 11) Bit timing.  Each of a list of common bit rates is set with
+ *    ioctlSET_SPEED, and the sample point achieved at the 87.5% the driver
+ *    aims for is reported, along with the rates that cannot be set to within
+ *    0.5%.  The precomputed bit timings the driver looks up are checked
+ *    against the ones it solves for.  Then a remote node sends to CAN2 over a
+ *    long harness, first with the bit timing the NXP library calculates, whose
+ *    early sample point leaves too little time for the signal to cross the
+ *    harness and back, then with the one ioctlSET_SPEED sets.
+ *
+ * 12) Bit rate detection.  A remote node sends on a bus whose bit rate CAN2
+ *    does not know.  CAN2 listens at each of the wrong bit rates in normal
+ *    mode, then finds the bit rate with ioctlDETECT_CAN_BIT_RATE, which
+ *    listens in listen only mode.  The error frames each puts on the bus, and
+ *    the time taken to lock on, are reported.  Finally the bit rate is looked
+ *    for on a silent bus, to show the request gives up in a bounded time.
+ *
+ * 13) Signal decoding.  A remote node cycles through the 40 messages of
+ *    Benchmarks/BenchSignals.dbc, and CAN2 decodes their 408 signals with the
+ *    tables can-dbc-compile generated from it.  Every value is checked against
+ *    a decoder that walks each signal a bit at a time from the start bit the
+ *    DBC file gives, and a watcher of one signal in ten must be told of every
+ *    change to its signals and of nothing else.  The host time taken to decode
+ *    a frame each way is reported for comparison, the time with the tables
+ *    including the critical section entered for each frame, which costs far
+ *    more in the simulation than on the target.
+ *
+ * 14) Rx priority.  A remote node floods the bus with diagnostic frames while
+ *    another sends a control frame every millisecond, and CAN2 reads fewer
+ *    frames each millisecond than arrive, as a task with too much to do would.
+ *    With one Rx frame queue the control frames wait behind the diagnostic
+ *    frames, or are lost when the queue is full.  With the control IDs sent to
+ *    a high priority queue by ioctlSET_CAN_RX_PRIORITY, every control frame
+ *    must be read within the millisecond it arrived in.  Finally nothing is
+ *    read while more control frames arrive, to show the high priority queue
+ *    keeps the latest of them.
+ *
+ * 15) Tx confirmation.  CAN1 streams frames to CAN2 with
+ *    ioctlSET_CAN_TX_CONFIRMATION set, and every frame must be confirmed once,
+ *    in order, with the time CAN2 received it.  Then, while a remote node loads
+ *    the bus with higher priority frames, CAN1 sends a time sync message every
+ *    millisecond - first stamped with the time it was written, as is all a
+ *    sender could do before, then followed by a second frame carrying the time
+ *    its confirmation gave.  The error of the time CAN2 is given is reported
+ *    each way.  Finally frames left in the Tx buffers when the controller is
+ *    reset must be confirmed as aborted.
+ *
+ * 16) Tx deadlines.  A remote node loads the bus with higher priority frames,
+ *    in bursts that leave no idle time, while CAN1 writes a fresh frame and a
+ *    low priority frame every millisecond, the low priority data being
+ *    obsolete a millisecond later.  Without deadlines the low priority frames
+ *    are sent long after they are obsolete, and during a burst they hold every
+ *    Tx buffer, so the fresh frames wait too.  With ioctlSET_CAN_TX_DEADLINES
+ *    set the obsolete frames are dropped from the queue or aborted in their
+ *    buffers, and the drops must be counted against their IDs.  Finally the
+ *    Tx buffers are held by frames that cannot be sent, and a full queue of
+ *    obsolete frames must make room for new ones.
+ *
+ * 17) Acceptance filter.  A remote node cycles through standard and extended
+ *    IDs, some of which CAN2 adds to the acceptance filter with
+ *    ioctlADD_CAN_FILTER_ENTRY, as single IDs and as ranges, and some of which
+ *    lie just outside those entries.  Only the IDs in the table may be read,
+ *    and the frames the hardware rejects must not interrupt the CPU.  Then
+ *    two of the entries are removed with ioctlREMOVE_CAN_FILTER_ENTRY, and
+ *    their IDs must no longer be read while the others still are.
+ *
+ * 18) Filter table.  CAN2 builds its whole acceptance filter in one
+ *    ioctlCOMPILE_CAN_FILTER_TABLE request from several hundred single IDs
+ *    given in no particular order, some of them consecutive, and the remote
+ *    node checks IDs in and just outside the table as in test 17.  The table
+ *    is then replaced with one given in the NXP section format through
+ *    ioctlLOAD_CAN_FILTER_TABLE, after which only its IDs may be read.
+ *
+ * 19) FullCAN.  CAN2 receives three standard IDs into FullCAN message objects
+ *    with the FullCAN interrupt disabled, and a fourth ID through its Rx
+ *    buffer, while the remote node cycles through them and an ID in neither.
+ *    The application polls ioctlGET_CAN_FULLCAN_UPDATES every millisecond.
+ *    The FullCAN IDs must never be read or interrupt the CPU, only their
+ *    objects may be reported as updated, and each object must end up holding
+ *    the last frame sent with its ID.
+ *
+ * 20) Routing.  CAN2 forwards two ranges of IDs to CAN1, which is on a bus of
+ *    its own with a node that only listens, rewriting the IDs of one range and
+ *    also reading the frames of the other, while a fourth ID matches no route.
+ *    The remote node keeps the bus 100% loaded.  Every routed frame must be
+ *    forwarded once with the right ID and none dropped, only the frames of the
+ *    local ID and the second range may be read on CAN2, and the time from the
+ *    end of each frame on the remote node's bus to the end of the forwarded
+ *    frame is measured.
+ *
+ * 21) Frame batch mode.  Second handles on CAN1 and CAN2, which use no
+ *    transfer modes, are switched to ioctlSET_CAN_FRAME_BATCH_MODE.  CAN1
+ *    writes more frames in one call than it has Tx buffers, and CAN2 must
+ *    receive every one intact.  CAN2 then reads the frames a remote node sends
+ *    every millisecond as whole CAN_MSG_Type structures, through its Rx
+ *    interrupt, and a buffer too small for a frame must read nothing.
+ *    Finally CAN1 writes to a bus on which nothing acknowledges it, and the
+ *    write must give up once the time set by ioctlSET_TX_TIMEOUT has passed.
+ *
+ * Run with --check to compare every result with the limits defined below and
+ * exit with a non zero status if any is missed, with --csv <file> to also
+ * write the results to a file, and with --log <file> to save the log written
+ * by the SD card logger test, which Build/can-log-decode can then decode.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Host includes, for the UDP peer of the CAN-over-UDP test. */
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+#include "FreeRTOS_CAN_ISOTP.h"
+#include "FreeRTOS_CAN_J1939.h"
+#include "FreeRTOS_CAN_Subscriber.h"
+
+/* Simulation includes. */
+#include "SimCAN.h"
+#include "SimDisk.h"
+
+/* lwIP application includes. */
+#include "CANUDPBridge.h"
+
+/* File system and CAN logger includes. */
+#include "semphr.h"
+#include "ff.h"
+#include "CANLogger.h"
+
+/* Signal decoding includes, the tables being generated from
+Benchmarks/BenchSignals.dbc at build time. */
+#include "CANSignals.h"
+#include "BenchSignals.h"
+
+/* The bit rate of every test. */
+#define benchBIT_RATE					( 1000000UL )
+
+/* The ID used by the frames of the throughput and error tests. */
+#define benchSTREAM_ID					( 0x123UL )
+
+/* The number of frames written by each FreeRTOS_write() call of the
+throughput and error tests. */
+#define benchTX_BATCH					( 16U )
+
+/* The depths of the Tx and Rx frame queues. */
+#define benchTX_QUEUE_LENGTH			( 32UL )
+#define benchRX_QUEUE_LENGTH			( 64UL )
+
+/* The number of IDs the analytics of CAN2 can track. */
+#define benchANALYTICS_IDS				( 64UL )
+
+/* Test sizes. */
+#define benchTHROUGHPUT_FRAMES			( 20000UL )
+#define benchLATENCY_FRAMES				( 1000UL )
+#define benchLATENCY_PERIOD				( simNS_PER_MS )
+#define benchBURST_FRAMES				( 5000UL )
+#define benchERROR_FRAMES				( 5000UL )
+#define benchISOTP_MESSAGE_BYTES		( 4096UL )
+#define benchJ1939_FRAMES				( 5000UL )
+#define benchJ1939_BAM_BYTES			( 100U )
+#define benchJ1939_CMDT_BYTES			( 1785U )
+#define benchSUBSCRIPTION_FRAMES		( 9000UL )
+
+/* The IDs used by the two ISO-TP sessions. */
+#define benchISOTP_REQUEST_ID			( 0x7E0UL )
+#define benchISOTP_RESPONSE_ID			( 0x7E8UL )
+
+/* The N_Bs and N_Cr timeouts the ISO-TP test sets, shorter than the 1000ms
+default so the test runs quickly, and the length of the message sent after
+N_Cr has passed. */
+#define benchISOTP_N_BS_MS				( 100U )
+#define benchISOTP_N_CR_MS				( 50U )
+#define benchISOTP_SHORT_MESSAGE_BYTES	( 64UL )
+
+/* The ID used by the remote nodes, unless a test gives them another. */
+#define benchREMOTE_NODE_ID				( 0x100UL )
+
+/* The J1939 test runs at the bit rate of a J1939-11 network.  Both nodes prefer
+the same address, and both are arbitrary address capable, so the node with the
+higher priority (numerically lower) NAME keeps the address and the other moves
+to the next address. */
+#define benchJ1939_BIT_RATE				( 250000UL )
+#define benchJ1939_PREFERRED_ADDRESS	( 0x80U )
+#define benchJ1939_CAN1_NAME			( 0x8000000000000002ULL )
+#define benchJ1939_CAN2_NAME			( 0x8000000000000001ULL )
+
+/* The PGNs of the J1939 test - EEC1 flooded by the remote node (sent with
+priority 3 from address 0), DM1 sent as a BAM, and proprietary A sent with
+RTS/CTS. */
+#define benchJ1939_FLOOD_PGN			( 0x0F004UL )
+#define benchJ1939_FLOOD_ID				( 0x0CF00400UL )
+#define benchJ1939_BAM_PGN				( 0x0FECAUL )
+#define benchJ1939_CMDT_PGN				( 0x0EF00UL )
+#define benchJ1939_OTHER_HANDLERS		( 64UL )
+
+/* The subscribers of the subscription test, and the length of their queues.
+The control task wants 0x100 to 0x10F, the logging task wants 0x100 to 0x1FF
+and PGN 0xFEF1 from any address, and the diagnostics task wants the OBD
+functional request ID and one physical ISO-TP ID.  The last subscriber
+subscribes to benchSPARE_EXT_IDS extended IDs and a range of standard IDs the
+remote node never sends. */
+#define benchCONTROL_SUBSCRIBER			( 0U )
+#define benchLOGGING_SUBSCRIBER			( 1U )
+#define benchDIAGNOSTICS_SUBSCRIBER		( 2U )
+#define benchSPARE_SUBSCRIBER			( 3U )
+#define benchSUBSCRIBERS				( 4U )
+#define benchSUBSCRIBER_QUEUE_LENGTH	( 64U )
+#define benchSPARE_EXT_IDS				( 60UL )
+
+/* The cyclic Tx test sends benchCYCLIC_MESSAGES messages with consecutive IDs,
+given the periods in benchCYCLIC_PERIODS in turn, for benchCYCLIC_RUN_MS. */
+#define benchCYCLIC_MESSAGES			( 60U )
+#define benchCYCLIC_BASE_ID				( 0x200UL )
+#define benchCYCLIC_PERIODS				{ 10U, 20U, 50U, 100U, 200U, 1000U }
+#define benchCYCLIC_RUN_MS				( 2000UL )
+
+/* The CAN-over-UDP test forwards benchUDP_FRAMES frames from CAN2 at full bus
+load, then benchUDP_SLOW_FRAMES arriving one every millisecond, and injects
+benchUDP_FRAMES through CAN1 in datagrams of benchUDP_INJECT_FRAMES.  A
+datagram of frames to inject is only sent once the last has been written to
+CAN1, so the datagrams are kept small enough for CAN2 to be drained between
+them without overrunning. */
+#define benchUDP_FRAMES					( 10000UL )
+#define benchUDP_SLOW_FRAMES			( 200UL )
+#define benchUDP_INJECT_FRAMES			( 24U )
+#define benchUDP_FLUSH_LATENCY_MS		( 5U )
+#define benchUDP_PEER_PORT				( 47100U )
+#define benchUDP_CAN1_PORT				( 47101U )
+#define benchUDP_CAN2_PORT				( 47102U )
+
+/* The SD card logger test logs benchLOG_FRAMES 8 byte frames, sent back to
+back, to a card that writes at 5MB/s once it has taken a command, but stalls
+for benchLOG_STALL_MS every benchLOG_SECTORS_PER_STALL sectors - which is
+about once a second at this bus load.  Each buffer of the logger holds the
+frames received in about 120ms, so more than a stall. */
+#define benchLOG_BIT_RATE				( 500000UL )
+#define benchLOG_FRAMES					( 12000UL )
+#define benchLOG_FILE_BLOCKS			( 4096UL )
+#define benchLOG_BUFFER_BLOCKS			( 16U )
+#define benchLOG_FLUSH_INTERVAL_MS		( 200U )
+#define benchLOG_COMMAND_US				( 200ULL )
+#define benchLOG_SECTOR_US				( 100ULL )
+#define benchLOG_SECTORS_PER_STALL		( 128UL )
+#define benchLOG_STALL_MS				( 100ULL )
+
+/* The limits applied by --check.  The bus must be kept busy while the Tx
+queue holds frames, a frame must reach a blocked reader within a small
+fraction of a frame time, draining the Rx queue every millisecond must be
+enough to lose nothing at 100% bus load, and the hardware itself must never
+overrun while the CAN interrupt is serviced promptly.  A timestamp can be
+out by its microsecond resolution and by the interrupt latency. */
+#define benchMIN_BUS_UTILISATION		( 0.97 )
+#define benchMAX_RX_LATENCY_US			( 20.0 )
+#define benchMAX_TIMESTAMP_ERROR_US		( 2.0 )
+#define benchLOSSLESS_DRAIN_PERIOD_MS	( 1UL )
+
+/* The analytics must see every frame, their estimate of the bus load must not
+be below the measured utilisation, and the period they measure must be within
+the timestamp resolution of the real period. */
+#define benchMAX_PERIOD_ERROR_US		( 1.0 )
+
+/* Without flow control limits an ISO-TP sender only has one frame in a Tx
+buffer at a time, so leaves a short gap between its frames. */
+#define benchMIN_ISOTP_BUS_UTILISATION	( 0.90 )
+
+/* With their offsets spread, no more than three cyclic messages are due in
+the same millisecond, so none waits behind more than two other frames. */
+#define benchMAX_CYCLIC_PEAK_FRAMES		( 3.0 )
+#define benchMAX_CYCLIC_JITTER_US		( 300.0 )
+
+/* A forwarded frame waits no longer than the flush latency, plus the tick by
+which a FreeRTOS timeout can overrun. */
+#define benchMAX_UDP_HOLD_US			( ( benchUDP_FLUSH_LATENCY_MS + 1U ) * 1000.0 )
+
+/* Apart from the last buffer and the ones the flush interval hands over,
+every buffer of the logger fills completely, and is written to the card in a
+single command. */
+#define benchMIN_LOG_SECTORS_PER_WRITE	( benchLOG_BUFFER_BLOCKS / 2U )
+
+/* The bit timing test asks for each of benchBIT_TIMING_RATES.  From the 50MHz
+peripheral clock of the simulation the nearest to 800K is 0.8% out, so every
+rate but that one can be set.  400K is one the NXP library's calculation never
+returns from, as 50MHz is not a multiple of 400K times any even number of time
+quanta up to 24. */
+#define benchBIT_TIMING_RATES			{ 10000UL, 20000UL, 33333UL, 50000UL, 100000UL, 125000UL, 250000UL, 400000UL, 500000UL, 800000UL, 1000000UL }
+#define benchBIT_TIMING_RATES_SET		( 10.0 )
+#define benchMAX_BIT_RATE_ERROR_PPM		( 5000.0 )
+
+/* A sample point asked for explicitly, at 500K, which is met exactly with 20
+time quanta. */
+#define benchEXPLICIT_SAMPLE_POINT		( 750U )
+#define benchEXPLICIT_SAMPLE_POINT_RATE	( 500000UL )
+
+/* The long harness test sends benchHARNESS_FRAMES frames over a bus whose loop
+delay is that of 30m of cable at 5ns/m, there and back, plus 50ns through each
+transceiver. */
+#define benchHARNESS_LOOP_DELAY_NS		( 400ULL )
+#define benchHARNESS_FRAMES				( 1000UL )
+#define benchHARNESS_PERIOD_US			( 200ULL )
+
+/* The bit rate detection test runs bus 0 at benchDETECT_BIT_RATE while a remote
+node sends benchDETECT_FRAMES frames, one every benchDETECT_PERIOD_US.  CAN2
+starts at benchBIT_RATE, and tries the driver's own list of bit rates, of which
+benchDETECT_WRONG_RATES come first.  It listens at each for up to
+benchDETECT_LISTEN_MS, so the whole list of nine takes no longer than
+benchMAX_DETECT_TIME_MS, even when nothing is sent. */
+#define benchDETECT_BIT_RATE			( 250000UL )
+#define benchDETECT_FRAMES				( 200UL )
+#define benchDETECT_PERIOD_US			( 1000ULL )
+#define benchDETECT_WRONG_RATES			{ 1000000UL, 500000UL }
+#define benchDETECT_LISTEN_MS			( 20U )
+#define benchDETECT_FRAMES_TO_LOCK		( 4U )
+#define benchMAX_DETECT_TIME_MS			( 9.0 * ( benchDETECT_LISTEN_MS + 1U ) )
+
+/* The signal decoding test decodes benchSIGNAL_FRAMES frames, the first data
+word of each counting the frames and the second counting down once every
+2 ^ benchSIGNAL_SLOW_SHIFT frames, so some signals change in every frame and
+others hardly ever.  One in benchSIGNAL_WATCH_EVERY signals is watched.  The
+host time is measured over benchSIGNAL_TIMING_PASSES passes over the frames. */
+#define benchSIGNAL_FRAMES				( 4000UL )
+#define benchSIGNAL_SLOW_SHIFT			( 8U )
+#define benchSIGNAL_WATCH_EVERY			( 10U )
+#define benchSIGNAL_TIMING_PASSES		( 50U )
+
+/* The Rx priority test sends benchPRIORITY_CONTROL_FRAMES control frames, one
+every millisecond, and CAN2 reads at most benchPRIORITY_READS_PER_MS frames
+each millisecond.  With priority queues, the standard IDs from
+benchPRIORITY_HIGH_LOWER_ID to benchPRIORITY_HIGH_UPPER_ID go to a high priority
+queue of benchPRIORITY_HIGH_QUEUE_LENGTH frames, and then
+benchPRIORITY_STALL_FRAMES more control frames are sent while nothing is read. */
+#define benchPRIORITY_CONTROL_ID		( 0x080UL )
+#define benchPRIORITY_DIAGNOSTIC_ID		( 0x7E8UL )
+#define benchPRIORITY_CONTROL_FRAMES	( 500UL )
+#define benchPRIORITY_READS_PER_MS		( 4U )
+#define benchPRIORITY_HIGH_LOWER_ID		( 0x000UL )
+#define benchPRIORITY_HIGH_UPPER_ID		( 0x0FFUL )
+#define benchPRIORITY_HIGH_QUEUE_LENGTH	( 8U )
+#define benchPRIORITY_STALL_FRAMES		( 20UL )
+#define benchMAX_PRIORITY_LATENCY_US	( 1000.0 )
+
+/* The Tx confirmation test streams benchCONFIRM_FRAMES frames from CAN1, then
+sends benchSYNC_MESSAGES time sync messages, one every millisecond, while a
+remote node releases a higher priority frame every benchSYNC_FLOOD_PERIOD_US.
+Finally one frame is left in each Tx buffer when CAN1 is reset. */
+#define benchCONFIRM_FRAMES				( 2000UL )
+#define benchCONFIRM_QUEUE_LENGTH		( 64U )
+#define benchSYNC_ID					( 0x180UL )
+#define benchSYNC_FOLLOW_UP_ID			( 0x181UL )
+#define benchSYNC_MESSAGES				( 200UL )
+#define benchSYNC_FLOOD_PERIOD_US		( 180ULL )
+#define benchSYNC_CONFIRM_WAIT_TICKS	( 5U )
+#define benchSYNC_SETTLE_MS				( 5UL )
+#define benchABORT_IDS					{ 0x300UL, 0x301UL, 0x302UL }
+
+/* The Tx deadline test runs for benchDEADLINE_RUN_MS.  The remote node releases
+benchDEADLINE_BURST_FRAMES frames each millisecond for the first
+benchDEADLINE_BURST_MS of every benchDEADLINE_CYCLE_MS, more than the bus can
+carry, and benchDEADLINE_QUIET_FRAMES otherwise, for a load of about 80% with
+CAN1's frames.  The low priority frames of CAN1 take the benchDEADLINE_STALE_IDS
+IDs from benchDEADLINE_STALE_BASE_ID in turn, and are obsolete benchDEADLINE_US
+after they are written.  A frame that had started before its deadline may end
+up to benchDEADLINE_TOLERANCE_US after it. */
+#define benchDEADLINE_FLOOD_ID			( 0x200UL )
+#define benchDEADLINE_FRESH_ID			( 0x180UL )
+#define benchDEADLINE_STALE_BASE_ID		( 0x400UL )
+#define benchDEADLINE_STALE_IDS			( 8UL )
+#define benchDEADLINE_RUN_MS			( 400UL )
+#define benchDEADLINE_CYCLE_MS			( 20UL )
+#define benchDEADLINE_BURST_MS			( 8UL )
+#define benchDEADLINE_BURST_FRAMES		( 8UL )
+#define benchDEADLINE_QUIET_FRAMES		( 2UL )
+#define benchDEADLINE_US				( 1000UL )
+#define benchDEADLINE_TOLERANCE_US		( 200UL )
+#define benchDEADLINE_SETTLE_MS			( 20UL )
+#define benchMIN_DEADLINE_BUS_LOAD		( 70.0 )
+#define benchMAX_DEADLINE_BUS_LOAD		( 90.0 )
+#define benchMAX_DEADLINE_FRESH_LATENCY_US	( 1000.0 )
+
+/* The acceptance filter tests have a remote node send benchFILTER_CYCLES
+cycles of their IDs at full bus load. */
+#define benchFILTER_CYCLES				( 200UL )
+
+/* The compiled filter table holds benchCOMPILED_STD_IDS standard IDs two apart,
+benchCOMPILED_STD_RUN consecutive standard IDs that are merged into a single
+range, and benchCOMPILED_EXT_IDS extended IDs four apart. */
+#define benchCOMPILED_STD_IDS			( 100UL )
+#define benchCOMPILED_STD_RUN			( 200UL )
+#define benchCOMPILED_EXT_IDS			( 50UL )
+#define benchCOMPILED_ENTRIES			( benchCOMPILED_STD_IDS + benchCOMPILED_STD_RUN + benchCOMPILED_EXT_IDS )
+
+/* The number of standard IDs received into FullCAN message objects. */
+#define benchFULLCAN_IDS				( 3UL )
+
+/* The routing test sends benchFILTER_CYCLES cycles of benchROUTING_IDS IDs.  The
+forwarded frames arrive no faster than they can be sent, so each need only wait
+for the end of the frame before it, and is then sent in about 130us at
+1Mbit/s. */
+#define benchROUTING_IDS				( 4UL )
+#define benchROUTING_FRAMES				( benchFILTER_CYCLES * benchROUTING_IDS )
+#define benchMAX_ROUTING_LATENCY_US		( 300.0 )
+
+/* The frame batch test writes benchBATCH_FRAMES frames in one call, more than
+the three Tx buffers hold, with a Tx timeout of benchBATCH_TX_TIMEOUT ticks, the
+first of which may be part gone.  It then reads benchBATCH_READS frames one
+millisecond apart. */
+#define benchBATCH_FRAMES				( 8UL )
+#define benchBATCH_TX_TIMEOUT			( 5UL )
+#define benchBATCH_READS				( 20UL )
+
+/* The handles of the two controllers. */
+static Peripheral_Descriptor_t xCAN1 = NULL, xCAN2 = NULL;
+
+/* The ISO-TP sessions, opened by the ISO-TP test. */
+static Peripheral_Descriptor_t xISOTPSender = NULL, xISOTPReceiver = NULL;
+
+/* Set by --check, and cleared by the first result outside its limits. */
+static portBASE_TYPE xChecking = pdFALSE, xAllPassed = pdTRUE;
+
+/* Results are also written here if --csv is given. */
+static FILE *pxCSVFile = NULL;
+
+/* The log written by the SD card logger test is saved here if --log is
+given. */
+static const char *pcLogFileName = NULL;
+
+/* The logger whose collector is run by the preempt hook of the simulated
+card. */
+static CAN_Logger_t *pxPreemptingLogger = NULL;
+
+/* An ID sent by a remote node. */
+typedef struct BENCH_ID
+{
+	uint32_t ulID;
+	uint8_t ucFormat;
+} BenchID_t;
+
+/* The state of a remote node that sends a numbered sequence of frames. */
+typedef struct BENCH_SEQUENCE
+{
+	uint32_t ulFramesToSend;
+	uint32_t ulFramesQueued;
+	uint32_t ulFramesSent;
+	SimTime_t xFirstRelease;
+	SimTime_t xPeriod;
+	uint32_t ulID;
+	uint8_t ucFormat;
+	uint8_t ucLength;
+	SimTime_t *pxEndTimes;
+	const struct BENCH_ID *pxIDCycle;		/* If not NULL, the IDs given to the frames in turn, in place of ulID and ucFormat. */
+	uint32_t ulIDCycleLength;
+	uint8_t ucDataBShift;					/* If not 0, the second data word counts down once every 2 ^ ucDataBShift frames, in place of being 0. */
+} BenchSequence_t;
+
+/* Collects the messages passed to a J1939 handler. */
+typedef struct BENCH_J1939_SINK
+{
+	uint32_t ulMessages;
+	uint8_t ucSourceAddress;
+	uint16_t usLength;
+	uint8_t ucData[ diJ1939_MAX_MESSAGE_BYTES ];
+} BenchJ1939Sink_t;
+
+/* The sequences sent by the remote nodes of the latency and burst tests.  A
+node has nothing to send until its test gives it a sequence. */
+static BenchSequence_t xLatencySequence, xBurstSequence;
+
+/* The frames heard by the node that only listens on bus 2, which the routing
+test clears before it starts. */
+typedef struct BENCH_ROUTED_FRAMES
+{
+	uint32_t ulFrames;
+	uint32_t ulWrongIDs;
+	SimTime_t xTotalLatency;
+	SimTime_t xMaxLatency;
+} BenchRoutedFrames_t;
+
+static BenchRoutedFrames_t xRoutedFrames;
+
+/*
+ * The twenty-one tests.
+ */
+static void prvThroughputBenchmark( void );
+static void prvLatencyBenchmark( void );
+static void prvBurstBenchmark( void );
+static void prvErrorBenchmark( void );
+static void prvISOTPBenchmark( void );
+static void prvJ1939Benchmark( void );
+static void prvSubscriptionBenchmark( void );
+static void prvCyclicTxBenchmark( void );
+static void prvUDPBridgeBenchmark( void );
+static void prvSDCardLoggerBenchmark( void );
+static void prvBitTimingBenchmark( void );
+static void prvBitRateDetectionBenchmark( void );
+static void prvSignalDecodingBenchmark( void );
+static void prvRxPriorityBenchmark( void );
+static void prvTxConfirmationBenchmark( void );
+static void prvTxDeadlineBenchmark( void );
+static void prvAcceptanceFilterBenchmark( void );
+static void prvFilterTableBenchmark( void );
+static void prvFullCANBenchmark( void );
+static void prvRoutingBenchmark( void );
+static void prvFrameBatchBenchmark( void );
+
+/*
+ * Stream uxFrames frames from CAN1 to CAN2, checking every frame arrives
+ * exactly once.  Returns the number of frames received, and the simulated
+ * time taken in pxElapsed.
+ */
+static uint32_t prvStreamFrames( uint32_t ulFrames, SimTime_t *pxElapsed );
+
+/*
+ * Return every controller, bus and node used by the tests to a known state.
+ */
+static void prvResetTest( portBASE_TYPE xBothControllersOnBus );
+
+/*
+ * The J1939 handlers used by the J1939 test.  prvJ1939Count() only counts the
+ * messages it is passed, prvJ1939Collect() also keeps a copy of the last.
+ */
+static void prvJ1939Count( const J1939_Message_t *pxMessage, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken );
+static void prvJ1939Collect( const J1939_Message_t *pxMessage, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken );
+
+/*
+ * Read every frame queued for each subscriber of the subscription test, and
+ * for the reader of CAN2, adding the number read to pulFrames[] - the reader
+ * of CAN2 counting in pulFrames[ benchSUBSCRIBERS ].
+ */
+static void prvDrainSubscribers( const Peripheral_Descriptor_t *pxSubscribers, uint32_t *pulFrames );
+
+/*
+ * Run the cyclic Tx messages for benchCYCLIC_RUN_MS from xStart, draining CAN2
+ * every millisecond.  If xWriteDueFrames is pdTRUE the messages due each
+ * millisecond are written to CAN1, otherwise they are left to the driver's
+ * cyclic Tx scheduler, which is stopped at the end of the run.  Reports the
+ * busiest millisecond on the bus, the worst jitter of any message, and how
+ * many messages were not received the expected number of times or with their
+ * payloads in sequence.
+ */
+static void prvRunCyclicTraffic( const char *pcTest, const CAN_Cyclic_Tx_Message_t *pxMessages, portBASE_TYPE xWriteDueFrames, SimTime_t xStart );
+static void prvDrainCyclicFrames( uint32_t ulTimestampAtStart, uint16_t *pusFramesPerMs, uint32_t *pulLastPayloads, uint32_t *pulSequenceErrors );
+static void prvStopCyclicTx( void );
+
+/*
+ * The payload function of the cyclic Tx messages, which counts the frames sent
+ * in the second data word.
+ */
+static void prvCyclicPayload( uint32_t *pulDataA, uint32_t *pulDataB, void *pvContext );
+
+/*
+ * Forward the frames sent by pxSequence from CAN2 to the UDP peer iPeerSocket
+ * until ulFrames have arrived, checking they arrive in order, in datagrams
+ * numbered in order, and reporting the frames carried by each datagram and the
+ * longest any frame was held.
+ */
+static void prvForwardToUDPPeer( const char *pcTest, CAN_UDP_Bridge_t *pxBridge, int iPeerSocket, BenchSequence_t *pxSequence, uint32_t ulFrames );
+
+/*
+ * Log benchBurstSequence to pcFileName until it has all been sent.  If
+ * xTwoTasks is pdTRUE the collector is also run by the preempt hook of the
+ * simulated card, as a collector task of higher priority than the writer task
+ * would run while the card was busy.
+ */
+static void prvLogToSDCard( const char *pcTest, const char *pcFileName, portBASE_TYPE xTwoTasks );
+static void prvRunCollector( void );
+
+/*
+ * Count the frames CAN2 receives from a remote node over a bus with a long loop
+ * delay, with the bit timing set by ioctlSET_SPEED or by the NXP library.
+ */
+static void prvReceiveOverHarness( const char *pcPrefix, portBASE_TYPE xUseDriverTiming );
+
+/*
+ * Read back the log written to pcFileName, and count the frames in it that
+ * carry the sequence number expected next, and those that do not.  Optionally
+ * copy the log to a file on the host.
+ */
+static void prvReadBackLog( const char *pcFileName, uint32_t *pulFrames, uint32_t *pulSequenceErrors, FILE *pxCopy );
+
+/*
+ * Check the signals of pxFrame, just decoded by pxDecoder, against the values
+ * found by prvDecodeBitByBit(), and count the watched signals whose value is
+ * new in *pulChanges.  Returns the number of signals with the wrong value.
+ */
+static uint32_t prvCheckSignals( const CAN_Signal_Decoder_t *pxDecoder, const CAN_MSG_Type *pxFrame, uint32_t *pulChanges );
+
+/*
+ * Decode the signals of pxFrame the slow way - finding its message with a
+ * linear search, and each signal a bit at a time from the start bit the DBC
+ * file gave - into pllValues[].  Returns the message, or NULL if it is not in
+ * the database.
+ */
+static const CAN_Message_Def_t *prvDecodeBitByBit( const CAN_MSG_Type *pxFrame, int64_t *pllValues );
+
+/*
+ * The host time, to measure the time taken to decode on the host.
+ */
+static double prvHostTimeNs( void );
+
+/*
+ * Read the control and diagnostic frames of the Rx priority test from CAN2,
+ * benchPRIORITY_READS_PER_MS frames each millisecond, with or without the
+ * control IDs going to a high priority queue, and report how long the control
+ * frames waited and how many were lost.
+ */
+static void prvReadByPriority( const char *pcPrefix, portBASE_TYPE xUsePriority );
+
+/*
+ * Send benchSYNC_MESSAGES time sync messages from CAN1 behind a remote node's
+ * traffic, each carrying the time it was written, or followed by a frame
+ * carrying the time its Tx confirmation gave, and report the worst difference
+ * from the time CAN2 received it.
+ */
+static void prvSendTimeSync( const char *pcPrefix, portBASE_TYPE xUseConfirmation );
+
+/*
+ * A Tx confirmation function that counts the confirmations it is given.
+ */
+static void prvCountConfirmation( const CAN_Tx_Confirmation_t *pxConfirmation, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken );
+
+/*
+ * Run the traffic of the Tx deadline test, with or without
+ * ioctlSET_CAN_TX_DEADLINES set, and report the worst latency of the fresh
+ * frames and how many low priority frames were received after they were
+ * obsolete.  Returns the number of low priority frames written and not
+ * received in *pulMissing.
+ */
+static void prvSendWithDeadlines( const char *pcPrefix, portBASE_TYPE xUseDeadlines, uint32_t *pulMissing );
+
+/*
+ * Have a remote node send ulCycles cycles of the ulIDs IDs in pxIDs at full
+ * bus load, draining CAN2 every millisecond, and add the number of frames read
+ * with each ID to pulFrames[].  Returns the number of frames read with an ID
+ * that is not in pxIDs.
+ */
+static uint32_t prvReceiveIDCycle( const BenchID_t *pxIDs, uint32_t ulIDs, uint32_t ulCycles, uint32_t *pulFrames );
+
+/*
+ * Read every frame waiting on CAN2, adding the number read with each of the
+ * ulIDs IDs in pxIDs to pulFrames[].  Returns the number of frames read with an
+ * ID that is not in pxIDs.
+ */
+static uint32_t prvCountIDFrames( const BenchID_t *pxIDs, uint32_t ulIDs, uint32_t *pulFrames );
+
+/*
+ * The pxFrameReceived callback of the node that listens for the frames CAN1
+ * forwards in the routing test.
+ */
+static void prvRoutedFrameReceived( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xEndOfFrame );
+
+/*
+ * The remote node callbacks.
+ */
+static portBASE_TYPE prvNextSequenceFrame( void *pvContext, CAN_MSG_Type *pxFrame, SimTime_t *pxReleaseTime );
+static void prvSequenceFrameSent( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xStartOfFrame, SimTime_t xEndOfFrame );
+
+/*
+ * Print a result, write it to the CSV file, and compare it with its limits
+ * when checking.  The limits are only applied if the corresponding xCheckMin
+ * or xCheckMax is pdTRUE.
+ */
+static void prvReport( const char *pcTest, const char *pcMetric, double dValue, const char *pcUnits, portBASE_TYPE xCheckMin, double dMin, portBASE_TYPE xCheckMax, double dMax );
+
+/*-----------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+int iArg;
+SimNodeConfig_t xNodeConfig;
+portBASE_TYPE xNode;
+
+	for( iArg = 1; iArg < argc; iArg++ )
+	{
+		if( strcmp( argv[ iArg ], "--check" ) == 0 )
+		{
+			xChecking = pdTRUE;
+		}
+		else if( ( strcmp( argv[ iArg ], "--log" ) == 0 ) && ( ( iArg + 1 ) < argc ) )
+		{
+			iArg++;
+			pcLogFileName = argv[ iArg ];
+		}
+		else if( ( strcmp( argv[ iArg ], "--csv" ) == 0 ) && ( ( iArg + 1 ) < argc ) )
+		{
+			iArg++;
+			pxCSVFile = fopen( argv[ iArg ], "w" );
+			if( pxCSVFile == NULL )
+			{
+				perror( argv[ iArg ] );
+				return EXIT_FAILURE;
+			}
+			fprintf( pxCSVFile, "test,metric,value,units\n" );
+		}
+		else
+		{
+			fprintf( stderr, "usage: %s [--check] [--csv <file>] [--log <file>]\n", argv[ 0 ] );
+			return EXIT_FAILURE;
+		}
+	}
+
+	vSimInit();
+
+	/* Both controllers are opened once, and each test then reconfigures
+	them, as an application that changes bit rate at run time would. */
+	xCAN1 = FreeRTOS_open( ( const int8_t * ) "/CAN1/", 0 );
+	xCAN2 = FreeRTOS_open( ( const int8_t * ) "/CAN2/", 0 );
+	configASSERT( xCAN1 );
+	configASSERT( xCAN2 );
+
+	FreeRTOS_ioctl( xCAN1, ioctlUSE_CAN_FRAME_QUEUE_TX, ( void * ) benchTX_QUEUE_LENGTH );
+	FreeRTOS_ioctl( xCAN2, ioctlUSE_CAN_FRAME_QUEUE_RX, ( void * ) benchRX_QUEUE_LENGTH );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_ANALYTICS, ( void * ) benchANALYTICS_IDS );
+
+	/* The error tests read the error counts, and need bus-off recovery. */
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_ERROR_INTERRUPTS, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_ERROR_INTERRUPTS, ( void * ) pdTRUE );
+
+	/* Both remote nodes live on bus 0. */
+	memset( &xNodeConfig, 0x00, sizeof( xNodeConfig ) );
+	xNodeConfig.xAcknowledge = pdTRUE;
+	xNodeConfig.pxNextFrame = prvNextSequenceFrame;
+	xNodeConfig.pxFrameSent = prvSequenceFrameSent;
+
+	xNodeConfig.pvContext = &xLatencySequence;
+	xNode = xSimNodeCreate( 0, &xNodeConfig );
+	configASSERT( xNode >= 0 );
+	xNodeConfig.pvContext = &xBurstSequence;
+	xNode = xSimNodeCreate( 0, &xNodeConfig );
+	configASSERT( xNode >= 0 );
+
+	/* The node that hears the frames forwarded by CAN1 has bus 2 to itself,
+	so CAN1 still sends to nobody on bus 1. */
+	memset( &xNodeConfig, 0x00, sizeof( xNodeConfig ) );
+	xNodeConfig.xAcknowledge = pdTRUE;
+	xNodeConfig.pxFrameReceived = prvRoutedFrameReceived;
+	xNodeConfig.pvContext = &xRoutedFrames;
+	xNode = xSimNodeCreate( 2, &xNodeConfig );
+	configASSERT( xNode >= 0 );
+
+	printf( "LPC17xx CAN driver benchmarks, %lu bit/s, simulated.\n\n", benchBIT_RATE );
+
+	prvThroughputBenchmark();
+	prvLatencyBenchmark();
+	prvBurstBenchmark();
+	prvErrorBenchmark();
+	prvISOTPBenchmark();
+	prvJ1939Benchmark();
+	prvSubscriptionBenchmark();
+	prvCyclicTxBenchmark();
+	prvUDPBridgeBenchmark();
+	prvSDCardLoggerBenchmark();
+	prvBitTimingBenchmark();
+	prvBitRateDetectionBenchmark();
+	prvSignalDecodingBenchmark();
+	prvRxPriorityBenchmark();
+	prvTxConfirmationBenchmark();
+	prvTxDeadlineBenchmark();
+	prvAcceptanceFilterBenchmark();
+	prvFilterTableBenchmark();
+	prvFullCANBenchmark();
+	prvRoutingBenchmark();
+	prvFrameBatchBenchmark();
+
+	if( pxCSVFile != NULL )
+	{
+		fclose( pxCSVFile );
+	}
+
+	if( xChecking != pdFALSE )
+	{
+		printf( "\n%s\n", ( xAllPassed != pdFALSE ) ? "All results within limits." : "FAILED: results outside limits." );
+	}
+
+	return ( xAllPassed != pdFALSE ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvThroughputBenchmark( void )
+{
+uint32_t ulReceived;
+SimTime_t xElapsed;
+SimBusStatistics_t xBusStatistics;
+SimProfile_t xProfile;
+CAN_Statistics_t xCANStatistics;
+CAN_Bus_Load_t xBusLoad;
+double dSeconds, dMaxFramesPerSecond;
+
+	prvResetTest( pdTRUE );
+
+	ulReceived = prvStreamFrames( benchTHROUGHPUT_FRAMES, &xElapsed );
+
+	vSimBusGetStatistics( 0, &xBusStatistics );
+	vSimGetProfile( &xProfile );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_STATISTICS, &xCANStatistics );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BUS_LOAD, &xBusLoad );
+
+	/* The best possible frame rate is that of frames of the same length sent
+	back to back. */
+	dSeconds = ( double ) xElapsed / ( double ) simNS_PER_SECOND;
+	dMaxFramesPerSecond = ( double ) xBusStatistics.ulFrames / ( ( double ) xBusStatistics.xBusyTime / ( double ) simNS_PER_SECOND );
+
+	printf( "Throughput (CAN1 Tx frame queue -> CAN2 Rx frame queue, 8 byte frames)\n" );
+	prvReport( "throughput", "frames_received", ( double ) ulReceived, "frames", pdTRUE, ( double ) benchTHROUGHPUT_FRAMES, pdTRUE, ( double ) benchTHROUGHPUT_FRAMES );
+	prvReport( "throughput", "frame_rate", ( double ) ulReceived / dSeconds, "frames/s", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "max_frame_rate", dMaxFramesPerSecond, "frames/s", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "bus_utilisation", ( double ) xBusStatistics.xBusyTime / ( double ) xElapsed, "", pdTRUE, benchMIN_BUS_UTILISATION, pdFALSE, 0.0 );
+	prvReport( "throughput", "register_accesses_per_frame", ( double ) xProfile.ulRegisterAccesses / ( double ) ulReceived, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "interrupts_per_frame", ( double ) xProfile.ulInterrupts / ( double ) ulReceived, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "interrupt_time", 100.0 * ( double ) xProfile.xTimeInInterrupts / ( double ) xElapsed, "%", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "rx_data_overruns", ( double ) xCANStatistics.ulDataOverruns, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "throughput", "analytics_frames", ( double ) xBusLoad.ulFrames, "frames", pdTRUE, ( double ) benchTHROUGHPUT_FRAMES, pdTRUE, ( double ) benchTHROUGHPUT_FRAMES );
+	prvReport( "throughput", "analytics_bits_per_frame", ( double ) xBusLoad.ullBits / ( double ) xBusLoad.ulFrames, "bits", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "throughput", "analytics_bus_load", ( double ) xBusLoad.usLoad / 10000.0, "", pdTRUE, ( double ) xBusStatistics.xBusyTime / ( double ) xElapsed, pdFALSE, 0.0 );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvLatencyBenchmark( void )
+{
+static SimTime_t xEndTimes[ benchLATENCY_FRAMES ];
+CAN_MSG_Type xFrame;
+uint32_t ulReceived = 0UL, ulSequenceNumber, ulTimerAtStart;
+SimTime_t xLatency, xMinLatency = simTIME_NEVER, xMaxLatency = 0ULL, xTotalLatency = 0ULL, xTimeAtStart;
+double dTimestampError, dMaxTimestampError = 0.0;
+CAN_ID_Analytics_t xAnalytics;
+
+	prvResetTest( pdFALSE );
+
+	xLatencySequence.ulFramesToSend = benchLATENCY_FRAMES;
+	xLatencySequence.xFirstRelease = xSimGetTime() + benchLATENCY_PERIOD;
+	xLatencySequence.xPeriod = benchLATENCY_PERIOD;
+	xLatencySequence.ucLength = 8U;
+	xLatencySequence.pxEndTimes = xEndTimes;
+
+	/* Block for up to ten periods for each frame. */
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) ( 10UL * ( benchLATENCY_PERIOD / simNS_PER_MS ) ) );
+
+	/* Relate the driver's timestamps to simulated time. */
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_TIMESTAMP, &ulTimerAtStart );
+	xTimeAtStart = xSimGetTime();
+
+	while( ulReceived < benchLATENCY_FRAMES )
+	{
+		if( FreeRTOS_read( xCAN2, &xFrame, sizeof( xFrame ) ) != sizeof( xFrame ) )
+		{
+			break;
+		}
+
+		ulSequenceNumber = xFrame.dataAWord;
+		configASSERT( ulSequenceNumber < benchLATENCY_FRAMES );
+
+		xLatency = xSimGetTime() - xEndTimes[ ulSequenceNumber ];
+		xTotalLatency += xLatency;
+		if( xLatency < xMinLatency )
+		{
+			xMinLatency = xLatency;
+		}
+		if( xLatency > xMaxLatency )
+		{
+			xMaxLatency = xLatency;
+		}
+
+		dTimestampError = ( double ) ( ( xFrame.timestamp - ulTimerAtStart ) * boardCAN_TIMESTAMP_RESOLUTION_US );
+		dTimestampError -= ( double ) ( xEndTimes[ ulSequenceNumber ] - xTimeAtStart ) / ( double ) simNS_PER_US;
+		if( dTimestampError < 0.0 )
+		{
+			dTimestampError = -dTimestampError;
+		}
+		if( dTimestampError > dMaxTimestampError )
+		{
+			dMaxTimestampError = dTimestampError;
+		}
+
+		ulReceived++;
+	}
+
+	printf( "Rx latency (remote node -> blocked FreeRTOS_read() on CAN2, one frame every %lu us)\n", ( unsigned long ) ( benchLATENCY_PERIOD / simNS_PER_US ) );
+	prvReport( "latency", "frames_received", ( double ) ulReceived, "frames", pdTRUE, ( double ) benchLATENCY_FRAMES, pdFALSE, 0.0 );
+
+	if( ulReceived > 0UL )
+	{
+		prvReport( "latency", "min_latency", ( double ) xMinLatency / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+		prvReport( "latency", "mean_latency", ( ( double ) xTotalLatency / ( double ) ulReceived ) / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+		prvReport( "latency", "max_latency", ( double ) xMaxLatency / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdTRUE, benchMAX_RX_LATENCY_US );
+		prvReport( "latency", "max_timestamp_error", dMaxTimestampError, "us", pdFALSE, 0.0, pdTRUE, benchMAX_TIMESTAMP_ERROR_US );
+	}
+
+	/* The remote node is the only sender, so its ID is the first tracked. */
+	memset( &xAnalytics, 0x00, sizeof( xAnalytics ) );
+	if( FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_ID_ANALYTICS, &xAnalytics ) == pdPASS )
+	{
+		prvReport( "latency", "analytics_frames", ( double ) xAnalytics.ulFrames, "frames", pdTRUE, ( double ) benchLATENCY_FRAMES, pdTRUE, ( double ) benchLATENCY_FRAMES );
+		prvReport( "latency", "analytics_mean_period", ( double ) ( xAnalytics.ulMeanInterval * boardCAN_TIMESTAMP_RESOLUTION_US ), "us", pdTRUE, ( ( double ) benchLATENCY_PERIOD / ( double ) simNS_PER_US ) - benchMAX_PERIOD_ERROR_US, pdTRUE, ( ( double ) benchLATENCY_PERIOD / ( double ) simNS_PER_US ) + benchMAX_PERIOD_ERROR_US );
+		prvReport( "latency", "analytics_period_range", ( double ) ( ( xAnalytics.ulMaxInterval - xAnalytics.ulMinInterval ) * boardCAN_TIMESTAMP_RESOLUTION_US ), "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+	}
+	else
+	{
+		prvReport( "latency", "analytics_frames", 0.0, "frames", pdTRUE, ( double ) benchLATENCY_FRAMES, pdTRUE, ( double ) benchLATENCY_FRAMES );
+	}
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBurstBenchmark( void )
+{
+static const uint32_t ulDrainPeriodsMs[] = { 1UL, 2UL, 5UL };
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Statistics_t xCANStatistics;
+uint32_t ulReceived, ulQueueOverruns, ulPeriod;
+size_t xBytes;
+char cMetric[ 48 ];
+unsigned portBASE_TYPE ux;
+portBASE_TYPE xMustBeLossless;
+
+	printf( "Burst loss (remote node at 100%% bus load with 0 byte frames, Rx frame queue of %lu frames drained periodically)\n", benchRX_QUEUE_LENGTH );
+
+	for( ux = 0U; ux < ( sizeof( ulDrainPeriodsMs ) / sizeof( ulDrainPeriodsMs[ 0 ] ) ); ux++ )
+	{
+		ulPeriod = ulDrainPeriodsMs[ ux ];
+		ulReceived = 0UL;
+
+		prvResetTest( pdFALSE );
+		FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+		/* Every frame is released at once, so the node sends them back to
+		back. */
+		xBurstSequence.ulFramesToSend = benchBURST_FRAMES;
+		xBurstSequence.xFirstRelease = xSimGetTime();
+		xBurstSequence.xPeriod = 0ULL;
+		xBurstSequence.ucLength = 0U;
+		xBurstSequence.pxEndTimes = NULL;
+
+		/* Drain until the node has sent everything and the queue is empty. */
+		do
+		{
+			vSimRunFor( ( SimTime_t ) ulPeriod * simNS_PER_MS );
+
+			do
+			{
+				xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+				ulReceived += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+			} while( xBytes == sizeof( xFrames ) );
+
+		} while( xBurstSequence.ulFramesSent < benchBURST_FRAMES );
+
+		/* Anything left after the last frame has been sent. */
+		vSimRunFor( simNS_PER_MS );
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+			ulReceived += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes != 0U );
+
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_RX_OVERRUN_COUNT, &ulQueueOverruns );
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_STATISTICS, &xCANStatistics );
+
+		xMustBeLossless = ( ulPeriod <= benchLOSSLESS_DRAIN_PERIOD_MS ) ? pdTRUE : pdFALSE;
+
+		snprintf( cMetric, sizeof( cMetric ), "drain_%lums_frames_lost", ( unsigned long ) ulPeriod );
+		prvReport( "burst", cMetric, ( double ) ( benchBURST_FRAMES - ulReceived ), "frames", pdFALSE, 0.0, xMustBeLossless, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "drain_%lums_queue_overruns", ( unsigned long ) ulPeriod );
+		prvReport( "burst", cMetric, ( double ) ulQueueOverruns, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "drain_%lums_hardware_overruns", ( unsigned long ) ulPeriod );
+		prvReport( "burst", cMetric, ( double ) xCANStatistics.ulDataOverruns, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	}
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvErrorBenchmark( void )
+{
+static const uint32_t ulErrorRates[] = { 0UL, 10000UL, 50000UL };
+uint32_t ulReceived;
+unsigned portBASE_TYPE ux;
+SimTime_t xElapsed;
+SimBusStatistics_t xBusStatistics;
+CAN_Statistics_t xTxStatistics, xRxStatistics;
+char cMetric[ 48 ];
+double dPercent;
+
+	printf( "Error recovery (throughput test with errors injected into a proportion of frames)\n" );
+
+	for( ux = 0U; ux < ( sizeof( ulErrorRates ) / sizeof( ulErrorRates[ 0 ] ) ); ux++ )
+	{
+		prvResetTest( pdTRUE );
+		vSimBusInjectErrors( 0, ulErrorRates[ ux ], 0x5EED0000UL + ( uint32_t ) ux );
+
+		ulReceived = prvStreamFrames( benchERROR_FRAMES, &xElapsed );
+
+		vSimBusGetStatistics( 0, &xBusStatistics );
+		FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_STATISTICS, &xTxStatistics );
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_STATISTICS, &xRxStatistics );
+
+		dPercent = ( double ) ulErrorRates[ ux ] / 10000.0;
+
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_frames_received", dPercent );
+		prvReport( "errors", cMetric, ( double ) ulReceived, "frames", pdTRUE, ( double ) benchERROR_FRAMES, pdTRUE, ( double ) benchERROR_FRAMES );
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_frame_rate", dPercent );
+		prvReport( "errors", cMetric, ( double ) ulReceived / ( ( double ) xElapsed / ( double ) simNS_PER_SECOND ), "frames/s", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_error_frames", dPercent );
+		prvReport( "errors", cMetric, ( double ) xBusStatistics.ulErrorFrames, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_tx_bit_errors", dPercent );
+		prvReport( "errors", cMetric, ( double ) xTxStatistics.ulBitErrors, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_rx_form_and_stuff_errors", dPercent );
+		prvReport( "errors", cMetric, ( double ) ( xRxStatistics.ulFormErrors + xRxStatistics.ulStuffErrors ), "", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "errors_%.1fpc_bus_off_events", dPercent );
+		prvReport( "errors", cMetric, ( double ) xTxStatistics.ulBusOffEvents, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	}
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvISOTPBenchmark( void )
+{
+static uint8_t ucTxMessage[ benchISOTP_MESSAGE_BYTES ], ucRxMessage[ benchISOTP_MESSAGE_BYTES ];
+static const uint8_t ucBlockSizes[] = { 0U, 8U }, ucSTmins[] = { 0U, 1U };
+CAN_ISOTP_Config_t xConfig;
+CAN_ISOTP_Statistics_t xStatistics, xSenderStatistics;
+SimBusStatistics_t xBusStatistics;
+CAN_MSG_Type xFirstFrame;
+uint32_t ulTxFailures, ulRxAborts;
+unsigned portBASE_TYPE ux;
+uint32_t ul;
+size_t xWritten, xRead;
+SimTime_t xStart, xElapsed;
+double dSeconds;
+char cMetric[ 48 ];
+
+	printf( "ISO-TP (%lu byte message, CAN1 session -> CAN2 session)\n", benchISOTP_MESSAGE_BYTES );
+
+	for( ul = 0UL; ul < benchISOTP_MESSAGE_BYTES; ul++ )
+	{
+		ucTxMessage[ ul ] = ( uint8_t ) ( ( ul * 7UL ) + ( ul >> 8UL ) );
+	}
+
+	xISOTPSender = FreeRTOS_ISOTP_open( xCAN1 );
+	xISOTPReceiver = FreeRTOS_ISOTP_open( xCAN2 );
+	configASSERT( xISOTPSender );
+	configASSERT( xISOTPReceiver );
+
+	for( ux = 0U; ux < ( sizeof( ucBlockSizes ) / sizeof( ucBlockSizes[ 0 ] ) ); ux++ )
+	{
+		prvResetTest( pdTRUE );
+
+		/* The block size and STmin are those the receiver asks for. */
+		memset( &xConfig, 0x00, sizeof( xConfig ) );
+		xConfig.ucFormat = STD_ID_FORMAT;
+		xConfig.ulTxID = benchISOTP_REQUEST_ID;
+		xConfig.ulRxID = benchISOTP_RESPONSE_ID;
+		xConfig.ucPadFrames = pdTRUE;
+		xConfig.ucPaddingByte = 0xAAU;
+		xConfig.ulRxBufferSize = 64UL;
+		FreeRTOS_ioctl( xISOTPSender, ioctlSET_ISOTP_CONFIG, &xConfig );
+
+		xConfig.ulTxID = benchISOTP_RESPONSE_ID;
+		xConfig.ulRxID = benchISOTP_REQUEST_ID;
+		xConfig.ucBlockSize = ucBlockSizes[ ux ];
+		xConfig.ucSTmin = ucSTmins[ ux ];
+		xConfig.ulRxBufferSize = benchISOTP_MESSAGE_BYTES;
+		FreeRTOS_ioctl( xISOTPReceiver, ioctlSET_ISOTP_CONFIG, &xConfig );
+
+		FreeRTOS_ioctl( xISOTPSender, ioctlSET_TX_TIMEOUT, ( void * ) 5000UL );
+		FreeRTOS_ioctl( xISOTPReceiver, ioctlSET_RX_TIMEOUT, ( void * ) 100UL );
+		memset( ucRxMessage, 0x00, sizeof( ucRxMessage ) );
+
+		/* The write returns once the last frame has been sent, by which time
+		the receiving session has reassembled the whole message. */
+		xStart = xSimGetTime();
+		xWritten = FreeRTOS_write( xISOTPSender, ucTxMessage, sizeof( ucTxMessage ) );
+		xElapsed = xSimGetTime() - xStart;
+		xRead = FreeRTOS_read( xISOTPReceiver, ucRxMessage, sizeof( ucRxMessage ) );
+
+		if( ( xWritten != sizeof( ucTxMessage ) ) || ( memcmp( ucTxMessage, ucRxMessage, xRead ) != 0 ) )
+		{
+			xRead = 0U;
+		}
+
+		vSimBusGetStatistics( 0, &xBusStatistics );
+		FreeRTOS_ioctl( xISOTPReceiver, ioctlGET_ISOTP_STATISTICS, &xStatistics );
+		dSeconds = ( double ) xElapsed / ( double ) simNS_PER_SECOND;
+
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_bytes_received", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, ( double ) xRead, "bytes", pdTRUE, ( double ) benchISOTP_MESSAGE_BYTES, pdTRUE, ( double ) benchISOTP_MESSAGE_BYTES );
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_transfer_time", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, dSeconds * 1000.0, "ms", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_throughput", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, ( double ) xRead / dSeconds, "bytes/s", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_frames", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, ( double ) xBusStatistics.ulFrames, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_bus_utilisation", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, ( double ) xBusStatistics.xBusyTime / ( double ) xElapsed, "", ( ucBlockSizes[ ux ] == 0U ) ? pdTRUE : pdFALSE, benchMIN_ISOTP_BUS_UTILISATION, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "isotp_bs%u_stmin%u_rx_aborts", ( unsigned ) ucBlockSizes[ ux ], ( unsigned ) ucSTmins[ ux ] );
+		prvReport( "isotp", cMetric, ( double ) ( xStatistics.ulRxAborts + xStatistics.ulRxOverruns ), "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	}
+
+	/* The receiver no longer listens to the sender's ID, so no flow control
+	frame follows the first frame, and N_Bs ends the write long before the Tx
+	timeout would. */
+	prvResetTest( pdTRUE );
+	xConfig.ulTxID = benchISOTP_REQUEST_ID;
+	xConfig.ulRxID = benchISOTP_RESPONSE_ID;
+	xConfig.ucBlockSize = 0U;
+	xConfig.ucSTmin = 0U;
+	xConfig.ulRxBufferSize = 64UL;
+	xConfig.usNBsTimeoutMs = benchISOTP_N_BS_MS;
+	FreeRTOS_ioctl( xISOTPSender, ioctlSET_ISOTP_CONFIG, &xConfig );
+
+	xConfig.ulTxID = benchISOTP_RESPONSE_ID;
+	xConfig.ulRxID = benchISOTP_REQUEST_ID + 1UL;
+	xConfig.ulRxBufferSize = benchISOTP_MESSAGE_BYTES;
+	xConfig.usNBsTimeoutMs = 0U;
+	xConfig.usNCrTimeoutMs = benchISOTP_N_CR_MS;
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlSET_ISOTP_CONFIG, &xConfig );
+
+	FreeRTOS_ioctl( xISOTPSender, ioctlGET_ISOTP_STATISTICS, &xSenderStatistics );
+	ulTxFailures = xSenderStatistics.ulTxFailures;
+
+	xStart = xSimGetTime();
+	xWritten = FreeRTOS_write( xISOTPSender, ucTxMessage, sizeof( ucTxMessage ) );
+	xElapsed = xSimGetTime() - xStart;
+
+	FreeRTOS_ioctl( xISOTPSender, ioctlGET_ISOTP_STATISTICS, &xSenderStatistics );
+	prvReport( "isotp", "n_bs_bytes_written", ( double ) xWritten, "bytes", pdTRUE, 0.0, pdTRUE, 0.0 );
+	prvReport( "isotp", "n_bs_time_to_give_up", ( double ) xElapsed / ( double ) simNS_PER_MS, "ms", pdTRUE, ( double ) ( benchISOTP_N_BS_MS - 1U ), pdTRUE, ( double ) ( benchISOTP_N_BS_MS + 2U ) );
+	prvReport( "isotp", "n_bs_tx_failures", ( double ) ( xSenderStatistics.ulTxFailures - ulTxFailures ), "", pdTRUE, 1.0, pdTRUE, 1.0 );
+
+	/* CAN1 sends the receiver a first frame directly, with no session behind
+	it to send the rest, so the receiver's flow control frame goes unanswered
+	and the message is abandoned once N_Cr has passed. */
+	xConfig.ulRxID = benchISOTP_REQUEST_ID;
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlSET_ISOTP_CONFIG, &xConfig );
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlGET_ISOTP_STATISTICS, &xStatistics );
+	ulRxAborts = xStatistics.ulRxAborts;
+
+	memset( &xFirstFrame, 0x00, sizeof( xFirstFrame ) );
+	xFirstFrame.id = benchISOTP_REQUEST_ID;
+	xFirstFrame.format = STD_ID_FORMAT;
+	xFirstFrame.type = DATA_FRAME;
+	xFirstFrame.len = 8U;
+	xFirstFrame.dataAWord = 0x00000010UL | ( ( uint32_t ) benchISOTP_SHORT_MESSAGE_BYTES << 8UL );
+	FreeRTOS_write( xCAN1, &xFirstFrame, sizeof( xFirstFrame ) );
+
+	vSimRunFor( ( SimTime_t ) ( benchISOTP_N_CR_MS - 2U ) * simNS_PER_MS );
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlGET_ISOTP_STATISTICS, &xStatistics );
+	prvReport( "isotp", "n_cr_aborts_before_timeout", ( double ) ( xStatistics.ulRxAborts - ulRxAborts ), "", pdTRUE, 0.0, pdTRUE, 0.0 );
+
+	vSimRunFor( 4ULL * simNS_PER_MS );
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlGET_ISOTP_STATISTICS, &xStatistics );
+	prvReport( "isotp", "n_cr_aborts", ( double ) ( xStatistics.ulRxAborts - ulRxAborts ), "", pdTRUE, 1.0, pdTRUE, 1.0 );
+
+	xWritten = FreeRTOS_write( xISOTPSender, ucTxMessage, benchISOTP_SHORT_MESSAGE_BYTES );
+	xRead = FreeRTOS_read( xISOTPReceiver, ucRxMessage, sizeof( ucRxMessage ) );
+
+	if( ( xWritten != benchISOTP_SHORT_MESSAGE_BYTES ) || ( memcmp( ucTxMessage, ucRxMessage, xRead ) != 0 ) )
+	{
+		xRead = 0U;
+	}
+
+	prvReport( "isotp", "n_cr_next_message_bytes", ( double ) xRead, "bytes", pdTRUE, ( double ) benchISOTP_SHORT_MESSAGE_BYTES, pdTRUE, ( double ) benchISOTP_SHORT_MESSAGE_BYTES );
+
+	/* The sessions are layers on the controllers, so are released before the
+	later tests use the controllers. */
+	FreeRTOS_ioctl( xISOTPSender, ioctlRELEASE_ISOTP_SESSION, NULL );
+	FreeRTOS_ioctl( xISOTPReceiver, ioctlRELEASE_ISOTP_SESSION, NULL );
+	xISOTPSender = NULL;
+	xISOTPReceiver = NULL;
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvJ1939Benchmark( void )
+{
+static uint8_t ucTxMessage[ diJ1939_MAX_MESSAGE_BYTES ];
+static BenchJ1939Sink_t xFloodSink, xBAMSink, xCMDTSink, xOtherSink;
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+Peripheral_Descriptor_t xNode1, xNode2;
+J1939_Config_t xConfig;
+J1939_PGN_Handler_t xHandler;
+J1939_Message_t xMessage;
+J1939_Statistics_t xStatistics1, xStatistics2;
+SimProfile_t xProfile;
+SimTime_t xStart;
+uint8_t ucAddress1 = 0U, ucAddress2 = 0U;
+uint32_t ul, ulFramesToReaders = 0UL;
+size_t xBytes;
+portBASE_TYPE xClaimed1, xClaimed2, xSent;
+
+	printf( "J1939 (%lu bit/s, node on CAN1 -> node on CAN2, remote node flooding PGN 0x%05lX)\n", benchJ1939_BIT_RATE, benchJ1939_FLOOD_PGN );
+
+	prvResetTest( pdTRUE );
+	vSimBusSetBitRate( 0, benchJ1939_BIT_RATE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_SPEED, ( void * ) benchJ1939_BIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_SPEED, ( void * ) benchJ1939_BIT_RATE );
+
+	for( ul = 0UL; ul < diJ1939_MAX_MESSAGE_BYTES; ul++ )
+	{
+		ucTxMessage[ ul ] = ( uint8_t ) ( ( ul * 13UL ) + ( ul >> 8UL ) );
+	}
+
+	xNode1 = FreeRTOS_J1939_open( xCAN1 );
+	xNode2 = FreeRTOS_J1939_open( xCAN2 );
+	configASSERT( xNode1 );
+	configASSERT( xNode2 );
+
+	/* Both nodes claim the same address at once. */
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.ucPreferredAddress = benchJ1939_PREFERRED_ADDRESS;
+	xConfig.ullName = benchJ1939_CAN1_NAME;
+	xConfig.usMaxHandlers = 4U;
+	xConfig.usRxBufferSize = 64U;
+	FreeRTOS_ioctl( xNode1, ioctlSET_J1939_CONFIG, &xConfig );
+
+	xConfig.ullName = benchJ1939_CAN2_NAME;
+	xConfig.usMaxHandlers = ( uint16_t ) ( benchJ1939_OTHER_HANDLERS + 3UL );
+	xConfig.usRxBufferSize = diJ1939_MAX_MESSAGE_BYTES;
+	xConfig.ucPacketsPerCTS = 16U;
+	FreeRTOS_ioctl( xNode2, ioctlSET_J1939_CONFIG, &xConfig );
+
+	vSimRunFor( 300ULL * simNS_PER_MS );
+
+	xClaimed1 = FreeRTOS_ioctl( xNode1, ioctlGET_J1939_ADDRESS, &ucAddress1 );
+	xClaimed2 = FreeRTOS_ioctl( xNode2, ioctlGET_J1939_ADDRESS, &ucAddress2 );
+	prvReport( "j1939", "claim_can2_address", ( xClaimed2 == pdPASS ) ? ( double ) ucAddress2 : -1.0, "", pdTRUE, ( double ) benchJ1939_PREFERRED_ADDRESS, pdTRUE, ( double ) benchJ1939_PREFERRED_ADDRESS );
+	prvReport( "j1939", "claim_can1_address", ( xClaimed1 == pdPASS ) ? ( double ) ucAddress1 : -1.0, "", pdTRUE, ( double ) benchJ1939_PREFERRED_ADDRESS + 1.0, pdTRUE, ( double ) benchJ1939_PREFERRED_ADDRESS + 1.0 );
+
+	/* The node on CAN2 handles the flooded PGN, the two transport protocol
+	PGNs, and enough others to show the cost of a lookup does not depend on
+	the number of handlers. */
+	memset( &xFloodSink, 0x00, sizeof( xFloodSink ) );
+	memset( &xBAMSink, 0x00, sizeof( xBAMSink ) );
+	memset( &xCMDTSink, 0x00, sizeof( xCMDTSink ) );
+	memset( &xOtherSink, 0x00, sizeof( xOtherSink ) );
+
+	xHandler.pxHandler = prvJ1939Count;
+	xHandler.pvContext = &xOtherSink;
+	for( ul = 0UL; ul < benchJ1939_OTHER_HANDLERS; ul++ )
+	{
+		xHandler.ulPGN = 0x0FF00UL + ul;
+		FreeRTOS_ioctl( xNode2, ioctlADD_J1939_PGN_HANDLER, &xHandler );
+	}
+
+	xHandler.ulPGN = benchJ1939_FLOOD_PGN;
+	xHandler.pvContext = &xFloodSink;
+	FreeRTOS_ioctl( xNode2, ioctlADD_J1939_PGN_HANDLER, &xHandler );
+
+	xHandler.pxHandler = prvJ1939Collect;
+	xHandler.ulPGN = benchJ1939_BAM_PGN;
+	xHandler.pvContext = &xBAMSink;
+	FreeRTOS_ioctl( xNode2, ioctlADD_J1939_PGN_HANDLER, &xHandler );
+	xHandler.ulPGN = benchJ1939_CMDT_PGN;
+	xHandler.pvContext = &xCMDTSink;
+	FreeRTOS_ioctl( xNode2, ioctlADD_J1939_PGN_HANDLER, &xHandler );
+
+	/* Flood the bus.  Frames handled by the node never reach the Rx frame
+	queue, so never wake a reader. */
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_RX_BUFFER, NULL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	vSimClearProfile();
+
+	xBurstSequence.ulID = benchJ1939_FLOOD_ID;
+	xBurstSequence.ucFormat = EXT_ID_FORMAT;
+	xBurstSequence.ulFramesToSend = benchJ1939_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+	xBurstSequence.pxEndTimes = NULL;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+			ulFramesToReaders += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes == sizeof( xFrames ) );
+
+	} while( xBurstSequence.ulFramesSent < benchJ1939_FRAMES );
+
+	vSimRunFor( simNS_PER_MS );
+	vSimGetProfile( &xProfile );
+
+	prvReport( "j1939", "flood_handler_calls", ( double ) xFloodSink.ulMessages, "", pdTRUE, ( double ) benchJ1939_FRAMES, pdTRUE, ( double ) benchJ1939_FRAMES );
+	prvReport( "j1939", "flood_frames_to_readers", ( double ) ulFramesToReaders, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "j1939", "flood_interrupt_time_per_frame", ( ( double ) xProfile.xTimeInInterrupts / ( double ) benchJ1939_FRAMES ) / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "j1939", "flood_interrupt_accesses_per_frame", ( double ) xProfile.ulInterruptAccesses / ( double ) benchJ1939_FRAMES, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+	/* A BAM, paced by the 50ms gap between its frames, then an RTS/CTS
+	transfer of the longest message, with a CTS every 16 frames. */
+	FreeRTOS_ioctl( xNode1, ioctlSET_TX_TIMEOUT, ( void * ) 10000UL );
+
+	memset( &xMessage, 0x00, sizeof( xMessage ) );
+	xMessage.ulPGN = benchJ1939_BAM_PGN;
+	xMessage.ucPriority = 6U;
+	xMessage.ucDestinationAddress = diJ1939_GLOBAL_ADDRESS;
+	xMessage.usLength = benchJ1939_BAM_BYTES;
+	xMessage.pucData = ucTxMessage;
+
+	xStart = xSimGetTime();
+	xSent = ( FreeRTOS_write( xNode1, &xMessage, sizeof( xMessage ) ) == sizeof( xMessage ) ) ? pdTRUE : pdFALSE;
+	prvReport( "j1939", "bam_transfer_time", ( double ) ( xSimGetTime() - xStart ) / ( double ) simNS_PER_MS, "ms", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "j1939", "bam_bytes_received", ( ( xSent != pdFALSE ) && ( xBAMSink.ulMessages == 1UL ) && ( memcmp( xBAMSink.ucData, ucTxMessage, xBAMSink.usLength ) == 0 ) ) ? ( double ) xBAMSink.usLength : 0.0, "bytes", pdTRUE, ( double ) benchJ1939_BAM_BYTES, pdTRUE, ( double ) benchJ1939_BAM_BYTES );
+
+	xMessage.ulPGN = benchJ1939_CMDT_PGN;
+	xMessage.ucDestinationAddress = ucAddress2;
+	xMessage.usLength = benchJ1939_CMDT_BYTES;
+
+	xStart = xSimGetTime();
+	xSent = ( FreeRTOS_write( xNode1, &xMessage, sizeof( xMessage ) ) == sizeof( xMessage ) ) ? pdTRUE : pdFALSE;
+	prvReport( "j1939", "cmdt_transfer_time", ( double ) ( xSimGetTime() - xStart ) / ( double ) simNS_PER_MS, "ms", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "j1939", "cmdt_bytes_received", ( ( xSent != pdFALSE ) && ( xCMDTSink.ulMessages == 1UL ) && ( xCMDTSink.ucSourceAddress == ucAddress1 ) && ( memcmp( xCMDTSink.ucData, ucTxMessage, xCMDTSink.usLength ) == 0 ) ) ? ( double ) xCMDTSink.usLength : 0.0, "bytes", pdTRUE, ( double ) benchJ1939_CMDT_BYTES, pdTRUE, ( double ) benchJ1939_CMDT_BYTES );
+
+	FreeRTOS_ioctl( xNode1, ioctlGET_J1939_STATISTICS, &xStatistics1 );
+	FreeRTOS_ioctl( xNode2, ioctlGET_J1939_STATISTICS, &xStatistics2 );
+	prvReport( "j1939", "can1_addresses_lost", ( double ) xStatistics1.ulAddressesLost, "", pdTRUE, 1.0, pdTRUE, 1.0 );
+	prvReport( "j1939", "can1_messages_sent", ( double ) xStatistics1.ulMessagesSent, "", pdTRUE, 2.0, pdTRUE, 2.0 );
+	prvReport( "j1939", "can2_rx_aborts", ( double ) ( xStatistics2.ulRxAborts + xStatistics2.ulRxRefused ), "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "j1939", "can2_other_handler_calls", ( double ) xOtherSink.ulMessages, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	/* Released so the later tests see every extended frame. */
+	FreeRTOS_ioctl( xNode1, ioctlRELEASE_J1939_NODE, NULL );
+	FreeRTOS_ioctl( xNode2, ioctlRELEASE_J1939_NODE, NULL );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvJ1939Count( const J1939_Message_t *pxMessage, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+BenchJ1939Sink_t * const pxSink = ( BenchJ1939Sink_t * ) pvContext;
+
+	( void ) pxMessage;
+	( void ) pxHigherPriorityTaskWoken;
+
+	pxSink->ulMessages++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvJ1939Collect( const J1939_Message_t *pxMessage, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+BenchJ1939Sink_t * const pxSink = ( BenchJ1939Sink_t * ) pvContext;
+
+	( void ) pxHigherPriorityTaskWoken;
+
+	pxSink->ulMessages++;
+	pxSink->ucSourceAddress = pxMessage->ucSourceAddress;
+	pxSink->usLength = pxMessage->usLength;
+	memcpy( pxSink->ucData, pxMessage->pucData, pxMessage->usLength );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSubscriptionBenchmark( void )
+{
+/* The IDs the remote node sends in turn, and the subscribers each is for. */
+static const BenchID_t xIDCycle[] =
+{
+	{ 0x101UL, STD_ID_FORMAT },
+	{ 0x10AUL, STD_ID_FORMAT },
+	{ 0x1F0UL, STD_ID_FORMAT },
+	{ 0x7DFUL, STD_ID_FORMAT },
+	{ 0x18DA10F1UL, EXT_ID_FORMAT },
+	{ 0x18FEF100UL, EXT_ID_FORMAT },
+	{ 0x18FEF117UL, EXT_ID_FORMAT },
+	{ 0x300UL, STD_ID_FORMAT },
+	{ 0x18FF8000UL, EXT_ID_FORMAT }
+};
+static const uint8_t ucIDSubscribers[] =
+{
+	( 1U << benchCONTROL_SUBSCRIBER ) | ( 1U << benchLOGGING_SUBSCRIBER ),
+	( 1U << benchCONTROL_SUBSCRIBER ) | ( 1U << benchLOGGING_SUBSCRIBER ),
+	( 1U << benchLOGGING_SUBSCRIBER ),
+	( 1U << benchDIAGNOSTICS_SUBSCRIBER ),
+	( 1U << benchDIAGNOSTICS_SUBSCRIBER ),
+	( 1U << benchLOGGING_SUBSCRIBER ),
+	( 1U << benchLOGGING_SUBSCRIBER ),
+	0U,
+	0U
+};
+static const char * const pcNames[ benchSUBSCRIBERS + 1U ] = { "control", "logging", "diagnostics", "spare", "can2_reader" };
+static Peripheral_Descriptor_t xSubscribers[ benchSUBSCRIBERS ];
+const uint32_t ulCycles = benchSUBSCRIPTION_FRAMES / ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) );
+CAN_Subscriber_Config_t xConfig;
+CAN_Subscription_t xSubscription;
+CAN_Subscriber_Statistics_t xStatistics;
+SimProfile_t xProfile;
+uint32_t ulFrames[ benchSUBSCRIBERS + 1U ], ulExpected[ benchSUBSCRIBERS + 1U ], ul, ulOverruns = 0UL;
+unsigned portBASE_TYPE ux, uxID;
+char cMetric[ 48 ];
+
+	printf( "Subscriptions (remote node cycling through %u IDs, %u subscribers on CAN2 with queues of %u frames drained every millisecond)\n", ( unsigned ) ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) ), ( unsigned ) benchSUBSCRIBERS, ( unsigned ) benchSUBSCRIBER_QUEUE_LENGTH );
+
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	xConfig.usQueueLength = benchSUBSCRIBER_QUEUE_LENGTH;
+
+	for( ux = 0U; ux < benchSUBSCRIBERS; ux++ )
+	{
+		xSubscribers[ ux ] = FreeRTOS_CAN_Subscriber_open( xCAN2 );
+		configASSERT( xSubscribers[ ux ] );
+		FreeRTOS_ioctl( xSubscribers[ ux ], ioctlSET_CAN_SUBSCRIBER_CONFIG, &xConfig );
+		FreeRTOS_ioctl( xSubscribers[ ux ], ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	}
+
+	xSubscription.ucFormat = STD_ID_FORMAT;
+	xSubscription.ulID = 0x100UL;
+	xSubscription.ulMask = 0x7F0UL;
+	FreeRTOS_ioctl( xSubscribers[ benchCONTROL_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+
+	xSubscription.ulMask = 0x700UL;
+	FreeRTOS_ioctl( xSubscribers[ benchLOGGING_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+	xSubscription.ucFormat = EXT_ID_FORMAT;
+	xSubscription.ulID = 0x00FEF100UL;
+	xSubscription.ulMask = 0x00FFFF00UL;
+	FreeRTOS_ioctl( xSubscribers[ benchLOGGING_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+
+	xSubscription.ucFormat = STD_ID_FORMAT;
+	xSubscription.ulID = 0x7DFUL;
+	xSubscription.ulMask = 0x7FFUL;
+	FreeRTOS_ioctl( xSubscribers[ benchDIAGNOSTICS_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+	xSubscription.ucFormat = EXT_ID_FORMAT;
+	xSubscription.ulID = 0x18DA10F1UL;
+	xSubscription.ulMask = 0x1FFFFFFFUL;
+	FreeRTOS_ioctl( xSubscribers[ benchDIAGNOSTICS_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+
+	for( ul = 0UL; ul < benchSPARE_EXT_IDS; ul++ )
+	{
+		xSubscription.ulID = 0x10000000UL + ( ul << 8UL );
+		FreeRTOS_ioctl( xSubscribers[ benchSPARE_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+	}
+	xSubscription.ucFormat = STD_ID_FORMAT;
+	xSubscription.ulID = 0x600UL;
+	xSubscription.ulMask = 0x700UL;
+	FreeRTOS_ioctl( xSubscribers[ benchSPARE_SUBSCRIBER ], ioctlADD_CAN_SUBSCRIPTION, &xSubscription );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	memset( ulExpected, 0x00, sizeof( ulExpected ) );
+
+	for( uxID = 0U; uxID < ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) ); uxID++ )
+	{
+		for( ux = 0U; ux < benchSUBSCRIBERS; ux++ )
+		{
+			if( ( ucIDSubscribers[ uxID ] & ( 1U << ux ) ) != 0U )
+			{
+				ulExpected[ ux ] += ulCycles;
+			}
+		}
+
+		if( ucIDSubscribers[ uxID ] == 0U )
+		{
+			ulExpected[ benchSUBSCRIBERS ] += ulCycles;
+		}
+	}
+
+	vSimClearProfile();
+
+	xBurstSequence.pxIDCycle = xIDCycle;
+	xBurstSequence.ulIDCycleLength = ( uint32_t ) ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) );
+	xBurstSequence.ulFramesToSend = ulCycles * xBurstSequence.ulIDCycleLength;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+	xBurstSequence.pxEndTimes = NULL;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+		prvDrainSubscribers( xSubscribers, ulFrames );
+	} while( xBurstSequence.ulFramesSent < xBurstSequence.ulFramesToSend );
+
+	vSimRunFor( simNS_PER_MS );
+	prvDrainSubscribers( xSubscribers, ulFrames );
+	vSimGetProfile( &xProfile );
+
+	for( ux = 0U; ux <= benchSUBSCRIBERS; ux++ )
+	{
+		snprintf( cMetric, sizeof( cMetric ), "%s_frames", pcNames[ ux ] );
+		prvReport( "subscriptions", cMetric, ( double ) ulFrames[ ux ], "frames", pdTRUE, ( double ) ulExpected[ ux ], pdTRUE, ( double ) ulExpected[ ux ] );
+	}
+
+	for( ux = 0U; ux < benchSUBSCRIBERS; ux++ )
+	{
+		FreeRTOS_ioctl( xSubscribers[ ux ], ioctlGET_CAN_SUBSCRIBER_STATISTICS, &xStatistics );
+		ulOverruns += xStatistics.ulOverruns;
+	}
+
+	prvReport( "subscriptions", "subscriber_overruns", ( double ) ulOverruns, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "subscriptions", "interrupt_time_per_frame", ( ( double ) xProfile.xTimeInInterrupts / ( double ) xBurstSequence.ulFramesToSend ) / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "subscriptions", "interrupt_accesses_per_frame", ( double ) xProfile.ulInterruptAccesses / ( double ) xBurstSequence.ulFramesToSend, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+	/* Once the diagnostics and spare subscribers have dropped their
+	subscriptions, the diagnostics frames go to the reader of CAN2, and the
+	other subscribers still receive theirs. */
+	FreeRTOS_ioctl( xSubscribers[ benchDIAGNOSTICS_SUBSCRIBER ], ioctlCLEAR_CAN_SUBSCRIPTIONS, NULL );
+	FreeRTOS_ioctl( xSubscribers[ benchSPARE_SUBSCRIBER ], ioctlCLEAR_CAN_SUBSCRIPTIONS, NULL );
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+
+	xBurstSequence.ulFramesQueued = 0UL;
+	xBurstSequence.ulFramesSent = 0UL;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+		prvDrainSubscribers( xSubscribers, ulFrames );
+	} while( xBurstSequence.ulFramesSent < xBurstSequence.ulFramesToSend );
+
+	vSimRunFor( simNS_PER_MS );
+	prvDrainSubscribers( xSubscribers, ulFrames );
+
+	prvReport( "subscriptions", "after_clear_diagnostics_frames", ( double ) ulFrames[ benchDIAGNOSTICS_SUBSCRIBER ], "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "subscriptions", "after_clear_logging_frames", ( double ) ulFrames[ benchLOGGING_SUBSCRIBER ], "frames", pdTRUE, ( double ) ulExpected[ benchLOGGING_SUBSCRIBER ], pdTRUE, ( double ) ulExpected[ benchLOGGING_SUBSCRIBER ] );
+	prvReport( "subscriptions", "after_clear_can2_reader_frames", ( double ) ulFrames[ benchSUBSCRIBERS ], "frames", pdTRUE, ( double ) ( ulExpected[ benchSUBSCRIBERS ] + ulExpected[ benchDIAGNOSTICS_SUBSCRIBER ] ), pdTRUE, ( double ) ( ulExpected[ benchSUBSCRIBERS ] + ulExpected[ benchDIAGNOSTICS_SUBSCRIBER ] ) );
+
+	/* Released so the later tests see every frame on CAN2. */
+	for( ux = 0U; ux < benchSUBSCRIBERS; ux++ )
+	{
+		FreeRTOS_ioctl( xSubscribers[ ux ], ioctlRELEASE_CAN_SUBSCRIBER, NULL );
+	}
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCyclicTxBenchmark( void )
+{
+static CAN_Cyclic_Tx_Message_t xMessages[ benchCYCLIC_MESSAGES ];
+static const uint16_t usPeriods[] = benchCYCLIC_PERIODS;
+CAN_Cyclic_Tx_Table_t xTable;
+uint16_t usMessage;
+
+	for( usMessage = 0U; usMessage < benchCYCLIC_MESSAGES; usMessage++ )
+	{
+		memset( &( xMessages[ usMessage ] ), 0x00, sizeof( CAN_Cyclic_Tx_Message_t ) );
+		xMessages[ usMessage ].ucFormat = STD_ID_FORMAT;
+		xMessages[ usMessage ].ucType = DATA_FRAME;
+		xMessages[ usMessage ].ucLength = 8U;
+		xMessages[ usMessage ].ulID = benchCYCLIC_BASE_ID + usMessage;
+		xMessages[ usMessage ].ulDataA = usMessage;
+		xMessages[ usMessage ].usPeriodMs = usPeriods[ usMessage % ( sizeof( usPeriods ) / sizeof( usPeriods[ 0 ] ) ) ];
+		xMessages[ usMessage ].usOffsetMs = 0U;
+		xMessages[ usMessage ].pxPayloadFunction = prvCyclicPayload;
+	}
+
+	/* A task that wakes every tick and writes whatever is due sends every
+	message with the same phase. */
+	prvResetTest( pdTRUE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 100UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	printf( "Cyclic Tx (%u messages from CAN1 every 10ms to 1s, written by a 1ms loop)\n", benchCYCLIC_MESSAGES );
+	prvRunCyclicTraffic( "cyclic_tx_loop", xMessages, pdTRUE, xSimGetTime() );
+	printf( "\n" );
+
+	/* The scheduler starts each message its offset after the next millisecond
+	boundary, so draining half way between boundaries, and stopping half a
+	millisecond after the last, sees every frame sent in the run. */
+	prvResetTest( pdTRUE );
+
+	for( usMessage = 0U; usMessage < benchCYCLIC_MESSAGES; usMessage++ )
+	{
+		xMessages[ usMessage ].usOffsetMs = diCAN_CYCLIC_TX_AUTO_OFFSET;
+	}
+
+	xTable.pxMessages = xMessages;
+	xTable.usNumberOfMessages = benchCYCLIC_MESSAGES;
+	configASSERT( FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_CYCLIC_TX_TABLE, &xTable ) == pdPASS );
+	vSimRunFor( simNS_PER_MS / 2ULL );
+
+	printf( "Cyclic Tx (the same messages sent by the driver's scheduler, with offsets chosen by the driver)\n" );
+	prvRunCyclicTraffic( "cyclic_tx_scheduler", xMessages, pdFALSE, xSimGetTime() );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUDPBridgeBenchmark( void )
+{
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+static uint8_t ucDatagram[ canudpMAX_DATAGRAM_BYTES ];
+CAN_UDP_Bridge_Config_t xConfig;
+CAN_UDP_Bridge_t *pxCAN1Bridge, *pxCAN2Bridge;
+CAN_UDP_Bridge_Statistics_t xStatistics;
+SimBusStatistics_t xBusStatistics;
+struct sockaddr_in xAddress;
+int iPeerSocket;
+uint32_t ulSent = 0UL, ulReceived = 0UL, ul;
+uint64_t ullSequenceTotal = 0ULL;
+size_t xBytes, xFramesPacked, xFramesRead;
+SimTime_t xStart, xElapsed;
+
+	/* The peer stands in for a bench PC. */
+	iPeerSocket = socket( AF_INET, SOCK_DGRAM, 0 );
+	configASSERT( iPeerSocket >= 0 );
+	memset( &xAddress, 0x00, sizeof( xAddress ) );
+	xAddress.sin_family = AF_INET;
+	xAddress.sin_port = htons( benchUDP_PEER_PORT );
+	xAddress.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+	configASSERT( bind( iPeerSocket, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) ) == 0 );
+
+	/* A bridge on each controller, both sending to the peer. */
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.ulPeerAddress = htonl( INADDR_LOOPBACK );
+	xConfig.usPeerPort = benchUDP_PEER_PORT;
+	xConfig.usMaxDatagramBytes = canudpMAX_DATAGRAM_BYTES;
+	xConfig.usFlushLatencyMs = benchUDP_FLUSH_LATENCY_MS;
+
+	xConfig.xCAN = xCAN1;
+	xConfig.usLocalPort = benchUDP_CAN1_PORT;
+	pxCAN1Bridge = pxCANUDPBridgeCreate( &xConfig );
+	xConfig.xCAN = xCAN2;
+	xConfig.usLocalPort = benchUDP_CAN2_PORT;
+	pxCAN2Bridge = pxCANUDPBridgeCreate( &xConfig );
+	configASSERT( pxCAN1Bridge );
+	configASSERT( pxCAN2Bridge );
+
+	prvResetTest( pdFALSE );
+
+	xBurstSequence.ulFramesToSend = benchUDP_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+
+	printf( "CAN-over-UDP (CAN2 -> UDP peer at full bus load, %u ms flush latency)\n", benchUDP_FLUSH_LATENCY_MS );
+	prvForwardToUDPPeer( "udp_uplink", pxCAN2Bridge, iPeerSocket, &xBurstSequence, benchUDP_FRAMES );
+	printf( "\n" );
+
+	prvResetTest( pdFALSE );
+
+	xLatencySequence.ulFramesToSend = benchUDP_SLOW_FRAMES;
+	xLatencySequence.xFirstRelease = xSimGetTime() + simNS_PER_MS;
+	xLatencySequence.xPeriod = simNS_PER_MS;
+	xLatencySequence.ucLength = 8U;
+
+	printf( "CAN-over-UDP (CAN2 -> UDP peer, one frame every ms)\n" );
+	prvForwardToUDPPeer( "udp_uplink_slow", pxCAN2Bridge, iPeerSocket, &xLatencySequence, benchUDP_SLOW_FRAMES );
+	printf( "\n" );
+
+	/* The peer sends frames to the bridge on CAN1, which injects them into
+	bus 0, and CAN2 receives them directly rather than through its bridge. */
+	prvResetTest( pdTRUE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 100UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	xAddress.sin_port = htons( benchUDP_CAN1_PORT );
+
+	/* A datagram that is not valid is dropped whole. */
+	memset( ucDatagram, 0x00, canudpHEADER_BYTES + canudpMAX_RECORD_BYTES );
+	sendto( iPeerSocket, ucDatagram, canudpHEADER_BYTES + canudpMAX_RECORD_BYTES, 0, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) );
+	xCANUDPBridgeForwardToCAN( pxCAN1Bridge, pdFALSE );
+
+	xStart = xSimGetTime();
+
+	while( ( ulReceived < benchUDP_FRAMES ) && ( ( xSimGetTime() - xStart ) < ( ( SimTime_t ) benchUDP_FRAMES * simNS_PER_MS ) ) )
+	{
+		if( ulSent < benchUDP_FRAMES )
+		{
+			for( ul = 0UL; ( ul < benchUDP_INJECT_FRAMES ) && ( ( ulSent + ul ) < benchUDP_FRAMES ); ul++ )
+			{
+				memset( &( xFrames[ ul ] ), 0x00, sizeof( CAN_MSG_Type ) );
+				xFrames[ ul ].id = benchSTREAM_ID;
+				xFrames[ ul ].len = 8U;
+				xFrames[ ul ].format = STD_ID_FORMAT;
+				xFrames[ ul ].type = DATA_FRAME;
+				xFrames[ ul ].dataAWord = ulSent + ul;
+				xFrames[ ul ].dataBWord = ~( ulSent + ul );
+			}
+
+			xBytes = xCANUDPPackDatagram( xFrames, ul, ulSent / benchUDP_INJECT_FRAMES, ucDatagram, sizeof( ucDatagram ), &xFramesPacked );
+			configASSERT( xFramesPacked == ul );
+			sendto( iPeerSocket, ucDatagram, xBytes, 0, ( struct sockaddr * ) &xAddress, sizeof( xAddress ) );
+			ulSent += ( uint32_t ) xCANUDPBridgeForwardToCAN( pxCAN1Bridge, pdFALSE );
+		}
+		else
+		{
+			vSimRunFor( 100ULL * simNS_PER_US );
+		}
+
+		do
+		{
+			xFramesRead = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) ) / sizeof( CAN_MSG_Type );
+
+			for( ul = 0UL; ul < xFramesRead; ul++ )
+			{
+				configASSERT( xFrames[ ul ].dataBWord == ~xFrames[ ul ].dataAWord );
+				ullSequenceTotal += xFrames[ ul ].dataAWord;
+			}
+
+			ulReceived += ( uint32_t ) xFramesRead;
+		} while( xFramesRead == benchRX_QUEUE_LENGTH );
+	}
+
+	xElapsed = xSimGetTime() - xStart;
+	vSimBusGetStatistics( 0, &xBusStatistics );
+	vCANUDPBridgeGetStatistics( pxCAN1Bridge, &xStatistics );
+
+	/* A lost frame and a duplicated frame would only go unnoticed together if
+	they happened to have the same sequence number. */
+	if( ullSequenceTotal != ( ( ( uint64_t ) benchUDP_FRAMES * ( uint64_t ) ( benchUDP_FRAMES - 1UL ) ) / 2ULL ) )
+	{
+		ulReceived = 0UL;
+	}
+
+	printf( "CAN-over-UDP (UDP peer -> CAN1 -> CAN2, %u frames per datagram)\n", benchUDP_INJECT_FRAMES );
+	prvReport( "udp_downlink", "frames_received", ( double ) ulReceived, "frames", pdTRUE, ( double ) benchUDP_FRAMES, pdTRUE, ( double ) benchUDP_FRAMES );
+	prvReport( "udp_downlink", "frame_rate", ( double ) ulReceived / ( ( double ) xElapsed / ( double ) simNS_PER_SECOND ), "frames/s", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "udp_downlink", "bus_utilisation", ( double ) xBusStatistics.xBusyTime / ( double ) xElapsed, "", pdTRUE, benchMIN_BUS_UTILISATION, pdFALSE, 0.0 );
+	prvReport( "udp_downlink", "frames_not_injected", ( double ) xStatistics.ulFramesNotInjected, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "udp_downlink", "datagrams_rejected", ( double ) xStatistics.ulDatagramsRejected, "datagrams", pdTRUE, 1.0, pdTRUE, 1.0 );
+	printf( "\n" );
+
+	close( iPeerSocket );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSDCardLoggerBenchmark( void )
+{
+static FATFS xFatFs;
+SimDiskTiming_t xTiming;
+uint32_t ulFrames, ulSequenceErrors;
+FILE *pxCopy = NULL;
+
+	xTiming.xCommandTime = benchLOG_COMMAND_US * simNS_PER_US;
+	xTiming.xSectorTime = benchLOG_SECTOR_US * simNS_PER_US;
+	xTiming.ulSectorsPerStall = benchLOG_SECTORS_PER_STALL;
+	xTiming.xStallTime = benchLOG_STALL_MS * simNS_PER_MS;
+	vSimDiskSetTiming( &xTiming );
+	f_mount( 0, &xFatFs );
+
+	printf( "SD card logger (%lu bit/s, remote node at 100%% bus load with 8 byte frames, card stalls %llums every %lu sectors, collector and writer tasks)\n", benchLOG_BIT_RATE, benchLOG_STALL_MS, benchLOG_SECTORS_PER_STALL );
+	prvLogToSDCard( "sd_logger", "CANLOG1.BIN", pdTRUE );
+
+	if( pcLogFileName != NULL )
+	{
+		pxCopy = fopen( pcLogFileName, "wb" );
+		if( pxCopy == NULL )
+		{
+			perror( pcLogFileName );
+		}
+	}
+
+	prvReadBackLog( "CANLOG1.BIN", &ulFrames, &ulSequenceErrors, pxCopy );
+	prvReport( "sd_logger", "frames_in_file", ( double ) ulFrames, "frames", pdTRUE, ( double ) benchLOG_FRAMES, pdTRUE, ( double ) benchLOG_FRAMES );
+	prvReport( "sd_logger", "frames_out_of_sequence", ( double ) ulSequenceErrors, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	if( pxCopy != NULL )
+	{
+		fclose( pxCopy );
+	}
+	printf( "\n" );
+
+	printf( "SD card logger (as above, collecting and writing from a single loop)\n" );
+	prvLogToSDCard( "sd_logger_single_task", "CANLOG2.BIN", pdFALSE );
+
+	f_mount( 0, NULL );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBitTimingBenchmark( void )
+{
+static const uint32_t ulRates[] = benchBIT_TIMING_RATES;
+CAN_Bit_Timing_Request_t xRequest;
+CAN_Bit_Timing_t xTiming;
+uint32_t ulRatesSet = 0UL, ulMismatches = 0UL, ulError, ulWorstError = 0UL, ulDefaultBTR;
+char cMetric[ 48 ];
+unsigned portBASE_TYPE ux;
+
+	printf( "Bit timing (common bit rates set with ioctlSET_SPEED from a %lu Hz peripheral clock)\n", ( unsigned long ) ( SystemCoreClock / 2UL ) );
+
+	prvResetTest( pdFALSE );
+
+	for( ux = 0U; ux < ( sizeof( ulRates ) / sizeof( ulRates[ 0 ] ) ); ux++ )
+	{
+		if( FreeRTOS_ioctl( xCAN2, ioctlSET_SPEED, ( void * ) ulRates[ ux ] ) == pdPASS )
+		{
+			ulRatesSet++;
+			FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BIT_TIMING, &xTiming );
+			ulDefaultBTR = xTiming.ulBTR;
+
+			ulError = ( xTiming.ulBitRate > ulRates[ ux ] ) ? ( xTiming.ulBitRate - ulRates[ ux ] ) : ( ulRates[ ux ] - xTiming.ulBitRate );
+			ulError = ( uint32_t ) ( ( ( uint64_t ) ulError * 1000000ULL ) / ulRates[ ux ] );
+			if( ulError > ulWorstError )
+			{
+				ulWorstError = ulError;
+			}
+
+			snprintf( cMetric, sizeof( cMetric ), "sample_point_%lu", ( unsigned long ) ulRates[ ux ] );
+			prvReport( "bit_timing", cMetric, ( double ) xTiming.usSamplePoint / 10.0, "%", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+			/* Asking for the same sample point explicitly bypasses the table
+			of precomputed bit timings, so must give the same result. */
+			xRequest.ulBitRate = ulRates[ ux ];
+			xRequest.usSamplePoint = 875U;
+			xRequest.ucSJW = 4U;
+			FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_BIT_TIMING, &xRequest );
+			FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BIT_TIMING, &xTiming );
+			if( xTiming.ulBTR != ulDefaultBTR )
+			{
+				ulMismatches++;
+			}
+		}
+	}
+
+	xRequest.ulBitRate = benchEXPLICIT_SAMPLE_POINT_RATE;
+	xRequest.usSamplePoint = benchEXPLICIT_SAMPLE_POINT;
+	xRequest.ucSJW = 0U;
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_BIT_TIMING, &xRequest );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BIT_TIMING, &xTiming );
+
+	prvReport( "bit_timing", "rates_set", ( double ) ulRatesSet, "", pdTRUE, benchBIT_TIMING_RATES_SET, pdTRUE, benchBIT_TIMING_RATES_SET );
+	prvReport( "bit_timing", "worst_bit_rate_error", ( double ) ulWorstError, "ppm", pdFALSE, 0.0, pdTRUE, benchMAX_BIT_RATE_ERROR_PPM );
+	prvReport( "bit_timing", "table_solver_mismatches", ( double ) ulMismatches, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "bit_timing", "sample_point_asked_for_75", ( double ) xTiming.usSamplePoint / 10.0, "%", pdTRUE, ( double ) benchEXPLICIT_SAMPLE_POINT / 10.0, pdTRUE, ( double ) benchEXPLICIT_SAMPLE_POINT / 10.0 );
+	printf( "\n" );
+
+	printf( "Bit timing (remote node to CAN2 at %lu bit/s over a harness with a %llu ns loop delay)\n", benchBIT_RATE, benchHARNESS_LOOP_DELAY_NS );
+	prvReceiveOverHarness( "library_timing", pdFALSE );
+	prvReceiveOverHarness( "solved_timing", pdTRUE );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvBitRateDetectionBenchmark( void )
+{
+static const uint32_t ulWrongRates[] = benchDETECT_WRONG_RATES;
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Bit_Rate_Detection_t xDetection;
+CAN_Bit_Timing_t xTiming;
+SimBusStatistics_t xBusStatistics;
+SimTime_t xStart;
+portBASE_TYPE xResult;
+uint32_t ulSentAtLock, ulReceived = 0UL;
+size_t xBytes;
+unsigned portBASE_TYPE ux;
+
+	printf( "Bit rate detection (remote node sending every %llu us at %lu bit/s, CAN2 starting at %lu bit/s)\n", benchDETECT_PERIOD_US, benchDETECT_BIT_RATE, benchBIT_RATE );
+
+	/* Listening in normal mode at each wrong bit rate, for as long as
+	ioctlDETECT_CAN_BIT_RATE would at most. */
+	prvResetTest( pdFALSE );
+	vSimBusSetBitRate( 0, benchDETECT_BIT_RATE );
+	xLatencySequence.ulFramesToSend = benchDETECT_FRAMES;
+	xLatencySequence.xFirstRelease = xSimGetTime();
+	xLatencySequence.xPeriod = benchDETECT_PERIOD_US * simNS_PER_US;
+	xLatencySequence.ucLength = 8U;
+
+	for( ux = 0U; ux < ( sizeof( ulWrongRates ) / sizeof( ulWrongRates[ 0 ] ) ); ux++ )
+	{
+		FreeRTOS_ioctl( xCAN2, ioctlSET_SPEED, ( void * ) ulWrongRates[ ux ] );
+		vSimRunFor( ( SimTime_t ) benchDETECT_LISTEN_MS * simNS_PER_MS );
+	}
+
+	vSimBusGetStatistics( 0, &xBusStatistics );
+	prvReport( "bit_rate_detection", "normal_mode_error_frames", ( double ) xBusStatistics.ulErrorFrames, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+	/* Detecting the bit rate in listen only mode, then receiving the rest of
+	the frames at the bit rate found. */
+	prvResetTest( pdFALSE );
+	vSimBusSetBitRate( 0, benchDETECT_BIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	xLatencySequence.ulFramesToSend = benchDETECT_FRAMES;
+	xLatencySequence.xFirstRelease = xSimGetTime();
+	xLatencySequence.xPeriod = benchDETECT_PERIOD_US * simNS_PER_US;
+	xLatencySequence.ucLength = 8U;
+
+	memset( &xDetection, 0x00, sizeof( xDetection ) );
+	xDetection.pulBitRates = NULL;
+	xDetection.usListenTimeMs = benchDETECT_LISTEN_MS;
+	xDetection.ucFramesToLock = benchDETECT_FRAMES_TO_LOCK;
+
+	xStart = xSimGetTime();
+	xResult = FreeRTOS_ioctl( xCAN2, ioctlDETECT_CAN_BIT_RATE, &xDetection );
+	prvReport( "bit_rate_detection", "listen_only_time_to_lock", ( double ) ( xSimGetTime() - xStart ) / ( double ) simNS_PER_MS, "ms", pdFALSE, 0.0, pdTRUE, benchMAX_DETECT_TIME_MS );
+	prvReport( "bit_rate_detection", "listen_only_bit_rate_found", ( xResult == pdPASS ) ? ( double ) xDetection.ulBitRate : 0.0, "bit/s", pdTRUE, ( double ) benchDETECT_BIT_RATE, pdTRUE, ( double ) benchDETECT_BIT_RATE );
+
+	/* Discard the frames received while the bit rate was being found. */
+	while( FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) ) != 0U )
+	{
+	}
+	ulSentAtLock = xLatencySequence.ulFramesSent;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+			ulReceived += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes != 0U );
+
+	} while( xLatencySequence.ulFramesSent < benchDETECT_FRAMES );
+
+	vSimBusGetStatistics( 0, &xBusStatistics );
+	prvReport( "bit_rate_detection", "listen_only_error_frames", ( double ) xBusStatistics.ulErrorFrames, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "bit_rate_detection", "frames_received_after_lock", ( double ) ulReceived, "frames", pdTRUE, ( double ) ( benchDETECT_FRAMES - ulSentAtLock ), pdFALSE, 0.0 );
+
+	/* Nothing to listen to, so every bit rate is tried for the full listen
+	time, then the bit rate CAN2 had is restored. */
+	prvResetTest( pdFALSE );
+	vSimBusSetBitRate( 0, benchDETECT_BIT_RATE );
+
+	xStart = xSimGetTime();
+	xResult = FreeRTOS_ioctl( xCAN2, ioctlDETECT_CAN_BIT_RATE, &xDetection );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BIT_TIMING, &xTiming );
+	prvReport( "bit_rate_detection", "silent_bus_time_to_give_up", ( double ) ( xSimGetTime() - xStart ) / ( double ) simNS_PER_MS, "ms", pdFALSE, 0.0, pdTRUE, benchMAX_DETECT_TIME_MS );
+	prvReport( "bit_rate_detection", "silent_bus_detections", ( xResult == pdPASS ) ? 1.0 : 0.0, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "bit_rate_detection", "silent_bus_bit_rate_kept", ( double ) xTiming.ulBitRate, "bit/s", pdTRUE, ( double ) benchBIT_RATE, pdTRUE, ( double ) benchBIT_RATE );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSignalDecodingBenchmark( void )
+{
+static BenchID_t xIDCycle[ BENCHSIGNALS_MESSAGES ];
+static CAN_MSG_Type xFrames[ benchSIGNAL_FRAMES ];
+static int64_t llValues[ BENCHSIGNALS_SIGNALS ];
+CAN_Signal_Decoder_t *pxDecoder;
+CAN_Signal_Watcher_t *pxWatcher;
+CAN_Signals_Statistics_t xStatistics;
+uint32_t ulReceived = 0UL, ulMismatches = 0UL, ulChanges = 0UL, ulNotifications = 0UL, ulUnwatchedNotifications = 0UL, ulWakeups = 0UL, ulFrame, ulPass;
+uint16_t usSignal;
+size_t xBytes;
+double dStart, dTableNs, dBitByBitNs;
+
+	printf( "Signal decoding (%u signals in %u messages, watching one signal in %u)\n", BENCHSIGNALS_SIGNALS, BENCHSIGNALS_MESSAGES, benchSIGNAL_WATCH_EVERY );
+
+	pxDecoder = pxCANSignalsCreate( &xBenchSignals );
+	configASSERT( pxDecoder );
+	pxWatcher = pxCANSignalsCreateWatcher( pxDecoder );
+	configASSERT( pxWatcher );
+
+	for( usSignal = 0U; usSignal < BENCHSIGNALS_SIGNALS; usSignal += benchSIGNAL_WATCH_EVERY )
+	{
+		xCANSignalsWatch( pxWatcher, usSignal );
+	}
+
+	for( ulFrame = 0UL; ulFrame < BENCHSIGNALS_MESSAGES; ulFrame++ )
+	{
+		xIDCycle[ ulFrame ].ulID = xBenchSignals.pxMessages[ ulFrame ].ulID & ~cansigEXTENDED_ID;
+		xIDCycle[ ulFrame ].ucFormat = ( ( xBenchSignals.pxMessages[ ulFrame ].ulID & cansigEXTENDED_ID ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT;
+	}
+
+	prvResetTest( pdFALSE );
+	xBurstSequence.pxIDCycle = xIDCycle;
+	xBurstSequence.ulIDCycleLength = BENCHSIGNALS_MESSAGES;
+	xBurstSequence.ucDataBShift = benchSIGNAL_SLOW_SHIFT;
+	xBurstSequence.ulFramesToSend = benchSIGNAL_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+
+	/* Each frame is decoded as it is read, as the application would, and the
+	watcher is emptied after each, so every change must be notified once. */
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, &( xFrames[ ulReceived ] ), ( benchSIGNAL_FRAMES - ulReceived ) * sizeof( CAN_MSG_Type ) );
+
+			for( ulFrame = ulReceived; ulFrame < ( ulReceived + ( xBytes / sizeof( CAN_MSG_Type ) ) ); ulFrame++ )
+			{
+				xCANSignalsDecode( pxDecoder, &( xFrames[ ulFrame ] ), 1U );
+				ulMismatches += prvCheckSignals( pxDecoder, &( xFrames[ ulFrame ] ), &ulChanges );
+
+				if( xCANSignalsWaitForChange( pxWatcher, 0U, &usSignal ) == pdPASS )
+				{
+					ulWakeups++;
+
+					do
+					{
+						ulNotifications++;
+						if( ( usSignal % benchSIGNAL_WATCH_EVERY ) != 0U )
+						{
+							ulUnwatchedNotifications++;
+						}
+					} while( xCANSignalsWaitForChange( pxWatcher, 0U, &usSignal ) == pdPASS );
+				}
+			}
+
+			ulReceived += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes != 0U );
+	} while( xBurstSequence.ulFramesSent < benchSIGNAL_FRAMES );
+
+	vCANSignalsGetStatistics( pxDecoder, &xStatistics );
+	prvReport( "signal_decoding", "frames_decoded", ( double ) xStatistics.ulFramesDecoded, "frames", pdTRUE, ( double ) benchSIGNAL_FRAMES, pdTRUE, ( double ) benchSIGNAL_FRAMES );
+	prvReport( "signal_decoding", "signals_decoded", ( double ) xStatistics.ulSignalsDecoded, "signals", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "signal_decoding", "signals_changed", ( double ) xStatistics.ulSignalsChanged, "signals", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "signal_decoding", "values_not_matching_bit_by_bit", ( double ) ulMismatches, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "signal_decoding", "watched_signal_changes", ( double ) ulChanges, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "signal_decoding", "changes_notified", ( double ) ulNotifications, "", pdTRUE, ( double ) ulChanges, pdTRUE, ( double ) ulChanges );
+	prvReport( "signal_decoding", "unwatched_signals_notified", ( double ) ulUnwatchedNotifications, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "signal_decoding", "frames_waking_watcher", ( double ) ulWakeups, "frames", pdFALSE, 0.0, pdTRUE, ( double ) benchSIGNAL_FRAMES );
+
+	/* The same frames decoded over and over on the host, in one batch with the
+	tables, and one frame at a time bit by bit. */
+	dStart = prvHostTimeNs();
+	for( ulPass = 0UL; ulPass < benchSIGNAL_TIMING_PASSES; ulPass++ )
+	{
+		xCANSignalsDecode( pxDecoder, xFrames, ulReceived );
+	}
+	dTableNs = ( prvHostTimeNs() - dStart ) / ( double ) ( benchSIGNAL_TIMING_PASSES * ulReceived );
+
+	dStart = prvHostTimeNs();
+	for( ulPass = 0UL; ulPass < benchSIGNAL_TIMING_PASSES; ulPass++ )
+	{
+		for( ulFrame = 0UL; ulFrame < ulReceived; ulFrame++ )
+		{
+			( void ) prvDecodeBitByBit( &( xFrames[ ulFrame ] ), llValues );
+		}
+	}
+	dBitByBitNs = ( prvHostTimeNs() - dStart ) / ( double ) ( benchSIGNAL_TIMING_PASSES * ulReceived );
+
+	prvReport( "signal_decoding", "host_time_per_frame_tables", dTableNs, "ns", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( "signal_decoding", "host_time_per_frame_bit_by_bit", dBitByBitNs, "ns", pdFALSE, 0.0, pdFALSE, 0.0 );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRxPriorityBenchmark( void )
+{
+	printf( "Rx priority (control frame every 1 ms behind a diagnostic flood, CAN2 reading %u frames a ms)\n", benchPRIORITY_READS_PER_MS );
+
+	prvReadByPriority( "single_queue", pdFALSE );
+	prvReadByPriority( "priority_queues", pdTRUE );
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReadByPriority( const char *pcPrefix, portBASE_TYPE xUsePriority )
+{
+static const CAN_Filter_Entry_t xHighPriorityIDs[] = { { benchPRIORITY_HIGH_LOWER_ID, benchPRIORITY_HIGH_UPPER_ID, STD_ID_FORMAT } };
+static SimTime_t xEndTimes[ benchPRIORITY_CONTROL_FRAMES ];
+CAN_MSG_Type xFrames[ benchPRIORITY_READS_PER_MS ];
+CAN_Rx_Priority_Config_t xConfig;
+CAN_Rx_Priority_Statistics_t xStatistics;
+uint32_t ulControlFrames = 0UL, ulDiagnosticFrames = 0UL, ulOutOfOrder = 0UL, ulNextControl = 0UL, ulNextDiagnostic = 0UL, ulOverrunsAtStart, ulOverruns, ulOldestKept;
+SimTime_t xLatency, xMaxLatency = 0ULL;
+size_t xBytes, xFrame;
+portBASE_TYPE xResult;
+char cMetric[ 64 ];
+
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_RX_OVERRUN_COUNT, &ulOverrunsAtStart );
+
+	/* The control frames are kept if the high priority queue overflows, as
+	only the latest matters, and the diagnostic frames are not, so whatever is
+	read of a diagnostic response is its start. */
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	if( xUsePriority != pdFALSE )
+	{
+		xConfig.pxHighPriorityIDs = xHighPriorityIDs;
+		xConfig.usNumberOfRanges = ( uint16_t ) ( sizeof( xHighPriorityIDs ) / sizeof( xHighPriorityIDs[ 0 ] ) );
+		xConfig.usHighQueueLength = benchPRIORITY_HIGH_QUEUE_LENGTH;
+		xConfig.ucHighOverflowPolicy = diCAN_RX_DROP_OLDEST;
+		xConfig.ucLowOverflowPolicy = diCAN_RX_DROP_NEWEST;
+	}
+	xResult = FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_RX_PRIORITY, &xConfig );
+	configASSERT( xResult == pdPASS );
+
+	/* The control frames are sent half way between the reads, so are not
+	always the first frame to arrive after a read makes room in the queue. */
+	xLatencySequence.ulID = benchPRIORITY_CONTROL_ID;
+	xLatencySequence.ulFramesToSend = benchPRIORITY_CONTROL_FRAMES;
+	xLatencySequence.xFirstRelease = xSimGetTime() + simNS_PER_MS + ( simNS_PER_MS / 2ULL );
+	xLatencySequence.xPeriod = simNS_PER_MS;
+	xLatencySequence.ucLength = 8U;
+	xLatencySequence.pxEndTimes = xEndTimes;
+
+	/* The flood is stopped once the last control frame has been sent, and
+	CAN2 then reads on until both queues are empty. */
+	xBurstSequence.ulID = benchPRIORITY_DIAGNOSTIC_ID;
+	xBurstSequence.ulFramesToSend = 0xFFFFFFFFUL;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+
+		if( xLatencySequence.ulFramesSent >= benchPRIORITY_CONTROL_FRAMES )
+		{
+			xBurstSequence.ulFramesToSend = xBurstSequence.ulFramesQueued;
+		}
+
+		xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+
+		for( xFrame = 0U; xFrame < ( xBytes / sizeof( CAN_MSG_Type ) ); xFrame++ )
+		{
+			if( xFrames[ xFrame ].id == benchPRIORITY_CONTROL_ID )
+			{
+				if( xFrames[ xFrame ].dataAWord < ulNextControl )
+				{
+					ulOutOfOrder++;
+				}
+				else
+				{
+					xLatency = xSimGetTime() - xEndTimes[ xFrames[ xFrame ].dataAWord ];
+					if( xLatency > xMaxLatency )
+					{
+						xMaxLatency = xLatency;
+					}
+
+					ulNextControl = xFrames[ xFrame ].dataAWord + 1UL;
+					ulControlFrames++;
+				}
+			}
+			else
+			{
+				if( xFrames[ xFrame ].dataAWord < ulNextDiagnostic )
+				{
+					ulOutOfOrder++;
+				}
+				else
+				{
+					ulNextDiagnostic = xFrames[ xFrame ].dataAWord + 1UL;
+					ulDiagnosticFrames++;
+				}
+			}
+		}
+	} while( ( xLatencySequence.ulFramesSent < benchPRIORITY_CONTROL_FRAMES ) || ( xBytes != 0U ) );
+
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_RX_OVERRUN_COUNT, &ulOverruns );
+
+	snprintf( cMetric, sizeof( cMetric ), "%s_control_frames_lost", pcPrefix );
+	prvReport( "rx_priority", cMetric, ( double ) ( benchPRIORITY_CONTROL_FRAMES - ulControlFrames ), "frames", pdFALSE, 0.0, xUsePriority, 0.0 );
+	snprintf( cMetric, sizeof( cMetric ), "%s_control_worst_latency", pcPrefix );
+	prvReport( "rx_priority", cMetric, ( double ) xMaxLatency / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, xUsePriority, benchMAX_PRIORITY_LATENCY_US );
+	snprintf( cMetric, sizeof( cMetric ), "%s_diagnostic_frames_read", pcPrefix );
+	prvReport( "rx_priority", cMetric, ( double ) ulDiagnosticFrames, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+	snprintf( cMetric, sizeof( cMetric ), "%s_overruns", pcPrefix );
+	prvReport( "rx_priority", cMetric, ( double ) ( ulOverruns - ulOverrunsAtStart ), "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+	snprintf( cMetric, sizeof( cMetric ), "%s_frames_out_of_order", pcPrefix );
+	prvReport( "rx_priority", cMetric, ( double ) ulOutOfOrder, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	if( xUsePriority != pdFALSE )
+	{
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_RX_PRIORITY_STATISTICS, &xStatistics );
+		prvReport( "rx_priority", "high_priority_frames_queued", ( double ) xStatistics.ulHighFramesQueued, "frames", pdTRUE, ( double ) benchPRIORITY_CONTROL_FRAMES, pdTRUE, ( double ) benchPRIORITY_CONTROL_FRAMES );
+		prvReport( "rx_priority", "high_priority_overruns", ( double ) xStatistics.ulHighOverruns, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+		prvReport( "rx_priority", "low_priority_overruns", ( double ) xStatistics.ulLowOverruns, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+		/* The high priority queue drops its oldest frames when it overflows,
+		so once the reader has stalled the frames it reads are the latest. */
+		xLatencySequence.ulFramesQueued = 0UL;
+		xLatencySequence.ulFramesSent = 0UL;
+		xLatencySequence.ulFramesToSend = benchPRIORITY_STALL_FRAMES;
+		xLatencySequence.xFirstRelease = xSimGetTime();
+		vSimRunFor( ( SimTime_t ) ( benchPRIORITY_STALL_FRAMES + 1UL ) * simNS_PER_MS );
+
+		ulControlFrames = 0UL;
+		ulOldestKept = benchPRIORITY_STALL_FRAMES;
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+
+			for( xFrame = 0U; xFrame < ( xBytes / sizeof( CAN_MSG_Type ) ); xFrame++ )
+			{
+				if( xFrames[ xFrame ].dataAWord < ulOldestKept )
+				{
+					ulOldestKept = xFrames[ xFrame ].dataAWord;
+				}
+				ulControlFrames++;
+			}
+		} while( xBytes != 0U );
+
+		prvReport( "rx_priority", "stalled_reader_control_frames_kept", ( double ) ulControlFrames, "frames", pdTRUE, ( double ) benchPRIORITY_HIGH_QUEUE_LENGTH, pdTRUE, ( double ) benchPRIORITY_HIGH_QUEUE_LENGTH );
+		prvReport( "rx_priority", "stalled_reader_oldest_frame_kept", ( double ) ulOldestKept, "", pdTRUE, ( double ) ( benchPRIORITY_STALL_FRAMES - benchPRIORITY_HIGH_QUEUE_LENGTH ), pdTRUE, ( double ) ( benchPRIORITY_STALL_FRAMES - benchPRIORITY_HIGH_QUEUE_LENGTH ) );
+
+		/* Every frame goes to the Rx frame queue again. */
+		memset( &xConfig, 0x00, sizeof( xConfig ) );
+		FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_RX_PRIORITY, &xConfig );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTxConfirmationBenchmark( void )
+{
+static uint32_t ulConfirmedTimestamps[ benchCONFIRM_FRAMES ], ulRxTimestamps[ benchCONFIRM_FRAMES ];
+static const uint32_t ulAbortIDs[] = benchABORT_IDS;
+const uint32_t ulAbortFrames = ( uint32_t ) ( sizeof( ulAbortIDs ) / sizeof( ulAbortIDs[ 0 ] ) );
+CAN_MSG_Type xTxFrames[ benchTX_BATCH ], xRxFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Tx_Confirmation_Config_t xConfig;
+CAN_Tx_Confirmation_Statistics_t xStatistics;
+CAN_Tx_Confirmation_t xConfirmation;
+uint32_t ulWritten = 0UL, ulReceived = 0UL, ulConfirmed = 0UL, ulOutOfOrder = 0UL, ulCounted = 0UL, ulAborted = 0UL, ulResent = 0UL, ulBatch, ul;
+uint32_t ulError, ulMaxError = 0UL;
+size_t xBytes;
+SimTime_t xStart;
+portBASE_TYPE xResult;
+
+	printf( "Tx confirmation (CAN1 -> CAN2, confirmations queued and counted by a function)\n" );
+
+	prvResetTest( pdTRUE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 100UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.pxFunction = prvCountConfirmation;
+	xConfig.pvContext = &ulCounted;
+	xConfig.usQueueLength = benchCONFIRM_QUEUE_LENGTH;
+	xConfig.xBlockTime = 0U;
+	xResult = FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_CONFIRMATION, &xConfig );
+	configASSERT( xResult == pdPASS );
+
+	/* Each frame carries its sequence number, so its confirmation and its
+	reception can be matched whichever is read first. */
+	xStart = xSimGetTime();
+
+	while( ( ulReceived < benchCONFIRM_FRAMES ) || ( ulConfirmed < benchCONFIRM_FRAMES ) )
+	{
+		if( ulWritten < benchCONFIRM_FRAMES )
+		{
+			ulBatch = benchCONFIRM_FRAMES - ulWritten;
+			if( ulBatch > benchTX_BATCH )
+			{
+				ulBatch = benchTX_BATCH;
+			}
+
+			for( ul = 0UL; ul < ulBatch; ul++ )
+			{
+				memset( &( xTxFrames[ ul ] ), 0x00, sizeof( CAN_MSG_Type ) );
+				xTxFrames[ ul ].id = benchSTREAM_ID;
+				xTxFrames[ ul ].len = 8U;
+				xTxFrames[ ul ].format = STD_ID_FORMAT;
+				xTxFrames[ ul ].type = DATA_FRAME;
+				xTxFrames[ ul ].dataAWord = ulWritten + ul;
+			}
+
+			xBytes = FreeRTOS_write( xCAN1, xTxFrames, ulBatch * sizeof( CAN_MSG_Type ) );
+			ulWritten += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		}
+		else
+		{
+			vSimRunFor( 100ULL * simNS_PER_US );
+
+			if( ( xSimGetTime() - xStart ) > ( ( SimTime_t ) benchCONFIRM_FRAMES * simNS_PER_MS ) )
+			{
+				/* Frames or confirmations have been lost. */
+				break;
+			}
+		}
+
+		while( FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_CONFIRMATION, &xConfirmation ) == pdPASS )
+		{
+			if( ( xConfirmation.ulID != benchSTREAM_ID ) || ( xConfirmation.ulDataA != ulConfirmed ) || ( xConfirmation.ucResult != diCAN_TX_SENT ) )
+			{
+				ulOutOfOrder++;
+			}
+			else
+			{
+				ulConfirmedTimestamps[ ulConfirmed ] = xConfirmation.ulTimestamp;
+				ulConfirmed++;
+			}
+		}
+
+		xBytes = FreeRTOS_read( xCAN2, xRxFrames, sizeof( xRxFrames ) );
+
+		for( ul = 0UL; ul < ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) ); ul++ )
+		{
+			configASSERT( xRxFrames[ ul ].id == benchSTREAM_ID );
+			configASSERT( xRxFrames[ ul ].dataAWord < benchCONFIRM_FRAMES );
+			ulRxTimestamps[ xRxFrames[ ul ].dataAWord ] = xRxFrames[ ul ].timestamp;
+			ulReceived++;
+		}
+	}
+
+	for( ul = 0UL; ul < ulConfirmed; ul++ )
+	{
+		ulError = ( ulConfirmedTimestamps[ ul ] >= ulRxTimestamps[ ul ] ) ? ( ulConfirmedTimestamps[ ul ] - ulRxTimestamps[ ul ] ) : ( ulRxTimestamps[ ul ] - ulConfirmedTimestamps[ ul ] );
+		if( ulError > ulMaxError )
+		{
+			ulMaxError = ulError;
+		}
+	}
+
+	FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_CONFIRMATION_STATISTICS, &xStatistics );
+	prvReport( "tx_confirmation", "frames_confirmed_in_order", ( double ) ulConfirmed, "frames", pdTRUE, ( double ) benchCONFIRM_FRAMES, pdTRUE, ( double ) benchCONFIRM_FRAMES );
+	prvReport( "tx_confirmation", "confirmations_out_of_order", ( double ) ulOutOfOrder, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "tx_confirmation", "function_calls", ( double ) ulCounted, "", pdTRUE, ( double ) benchCONFIRM_FRAMES, pdTRUE, ( double ) benchCONFIRM_FRAMES );
+	prvReport( "tx_confirmation", "frames_aborted", ( double ) xStatistics.ulFramesAborted, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "tx_confirmation", "queue_overruns", ( double ) xStatistics.ulOverruns, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "tx_confirmation", "max_timestamp_difference_from_rx", ( double ) ( ulMaxError * boardCAN_TIMESTAMP_RESOLUTION_US ), "us", pdFALSE, 0.0, pdTRUE, benchMAX_TIMESTAMP_ERROR_US );
+
+	prvSendTimeSync( "sync_written_time", pdFALSE );
+	prvSendTimeSync( "sync_confirmed_time", pdTRUE );
+
+	/* With CAN1 on a bus of its own nothing it sends is acknowledged, so each
+	frame stays in its Tx buffer until the controller is reset.  Setting the
+	bit rate resets it, and the frames are confirmed as aborted when the
+	buffers are next loaded. */
+	prvResetTest( pdFALSE );
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.usQueueLength = benchCONFIRM_QUEUE_LENGTH;
+	xResult = FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_CONFIRMATION, &xConfig );
+	configASSERT( xResult == pdPASS );
+
+	for( ul = 0UL; ul < ulAbortFrames; ul++ )
+	{
+		memset( &( xTxFrames[ ul ] ), 0x00, sizeof( CAN_MSG_Type ) );
+		xTxFrames[ ul ].id = ulAbortIDs[ ul ];
+		xTxFrames[ ul ].len = 8U;
+		xTxFrames[ ul ].format = STD_ID_FORMAT;
+		xTxFrames[ ul ].type = DATA_FRAME;
+	}
+
+	FreeRTOS_write( xCAN1, xTxFrames, ulAbortFrames * sizeof( CAN_MSG_Type ) );
+	vSimRunFor( 5ULL * simNS_PER_MS );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_SPEED, ( void * ) benchBIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_RX_BUFFER, NULL );
+	vSimAttachController( 0, 0 );
+	FreeRTOS_write( xCAN1, xTxFrames, ulAbortFrames * sizeof( CAN_MSG_Type ) );
+	vSimRunFor( 5ULL * simNS_PER_MS );
+
+	while( FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_CONFIRMATION, &xConfirmation ) == pdPASS )
+	{
+		if( xConfirmation.ucResult == diCAN_TX_ABORTED )
+		{
+			ulAborted++;
+		}
+		else
+		{
+			ulResent++;
+		}
+	}
+
+	FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_CONFIRMATION_STATISTICS, &xStatistics );
+	prvReport( "tx_confirmation", "reset_frames_confirmed_aborted", ( double ) ulAborted, "frames", pdTRUE, ( double ) ulAbortFrames, pdTRUE, ( double ) ulAbortFrames );
+	prvReport( "tx_confirmation", "reset_frames_resent", ( double ) ulResent, "frames", pdTRUE, ( double ) ulAbortFrames, pdTRUE, ( double ) ulAbortFrames );
+	prvReport( "tx_confirmation", "reset_frames_counted_aborted", ( double ) xStatistics.ulFramesAborted, "frames", pdTRUE, ( double ) ulAbortFrames, pdTRUE, ( double ) ulAbortFrames );
+
+	/* Stop the confirmations, and discard the frames CAN2 received. */
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_CONFIRMATION, &xConfig );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_RX_BUFFER, NULL );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvTxDeadlineBenchmark( void )
+{
+CAN_Tx_Deadline_Statistics_t xStatistics;
+CAN_Tx_Deadline_Drops_t xDrops;
+CAN_MSG_Type xTxFrames[ benchTX_BATCH ];
+uint32_t ulMissing, ulDropped, ulIDDrops = 0UL, ulOtherIDs = 0UL, ulNow, ulWritten, ul;
+size_t xBytes;
+portBASE_TYPE xResult;
+
+	printf( "Tx deadlines (CAN1 -> CAN2 behind %lu ms bursts of higher priority frames, low priority data obsolete after %lu us)\n", benchDEADLINE_BURST_MS, benchDEADLINE_US );
+
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_DEADLINES, ( void * ) 0UL );
+	prvSendWithDeadlines( "no_deadlines", pdFALSE, &ulMissing );
+	prvReport( "tx_deadlines", "no_deadlines_frames_missing", ( double ) ulMissing, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	xResult = FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_DEADLINES, ( void * ) ( benchDEADLINE_STALE_IDS * 2UL ) );
+	configASSERT( xResult == pdPASS );
+	prvSendWithDeadlines( "deadlines", pdTRUE, &ulMissing );
+
+	/* With CAN1 on a bus of its own, frames without a deadline stay in the Tx
+	buffers, and the frames with deadlines written after them wait in the
+	queue until they are obsolete.  Writing to the full queue must then drop
+	them to make room, without waiting. */
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TIMESTAMP, &ulNow );
+
+	memset( xTxFrames, 0x00, sizeof( xTxFrames ) );
+	for( ul = 0UL; ul < benchTX_BATCH; ul++ )
+	{
+		xTxFrames[ ul ].id = benchDEADLINE_STALE_BASE_ID + ( ul % benchDEADLINE_STALE_IDS );
+		xTxFrames[ ul ].len = 8U;
+		xTxFrames[ ul ].format = STD_ID_FORMAT;
+		xTxFrames[ ul ].type = DATA_FRAME;
+		xTxFrames[ ul ].timestamp = ulNow + ( benchDEADLINE_US / boardCAN_TIMESTAMP_RESOLUTION_US );
+	}
+
+	/* One frame without a deadline for each Tx buffer. */
+	for( ul = 0UL; ul < 3UL; ul++ )
+	{
+		xTxFrames[ ul ].timestamp = 0UL;
+	}
+	FreeRTOS_write( xCAN1, xTxFrames, 3UL * sizeof( CAN_MSG_Type ) );
+	vSimRunFor( simNS_PER_MS / 10ULL );
+
+	for( ul = 0UL; ul < 3UL; ul++ )
+	{
+		xTxFrames[ ul ].timestamp = xTxFrames[ 3 ].timestamp;
+	}
+	for( ulWritten = 0UL; ulWritten < benchTX_QUEUE_LENGTH; ulWritten += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) ) )
+	{
+		xBytes = FreeRTOS_write( xCAN1, xTxFrames, sizeof( xTxFrames ) );
+		configASSERT( xBytes != 0U );
+	}
+
+	vSimRunFor( 2ULL * benchDEADLINE_US * simNS_PER_US );
+	xBytes = FreeRTOS_write( xCAN1, xTxFrames, sizeof( xTxFrames ) );
+	prvReport( "tx_deadlines", "full_queue_frames_accepted", ( double ) ( xBytes / sizeof( CAN_MSG_Type ) ), "frames", pdTRUE, ( double ) benchTX_BATCH, pdTRUE, ( double ) benchTX_BATCH );
+	ulMissing += ulWritten;
+
+	/* Every low priority frame that was not received must have been dropped,
+	and counted against its own ID. */
+	FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_DEADLINE_STATISTICS, &xStatistics );
+	ulDropped = xStatistics.ulDroppedFromQueue + xStatistics.ulAborted;
+
+	for( xDrops.usIndex = 0U; FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_DEADLINE_DROPS, &xDrops ) == pdPASS; xDrops.usIndex++ )
+	{
+		if( ( xDrops.ulID >= benchDEADLINE_STALE_BASE_ID ) && ( xDrops.ulID < ( benchDEADLINE_STALE_BASE_ID + benchDEADLINE_STALE_IDS ) ) && ( xDrops.ucFormat == STD_ID_FORMAT ) )
+		{
+			ulIDDrops += xDrops.ulDroppedFromQueue + xDrops.ulAborted;
+		}
+		else
+		{
+			ulOtherIDs++;
+		}
+	}
+
+	prvReport( "tx_deadlines", "dropped_from_queue", ( double ) xStatistics.ulDroppedFromQueue, "frames", pdTRUE, ( double ) ulWritten, pdFALSE, 0.0 );
+	prvReport( "tx_deadlines", "aborted", ( double ) xStatistics.ulAborted, "frames", pdTRUE, 1.0, pdFALSE, 0.0 );
+	prvReport( "tx_deadlines", "frames_missing_not_dropped", ( double ) ( ulMissing - ulDropped ), "frames", pdTRUE, 0.0, pdTRUE, 0.0 );
+	prvReport( "tx_deadlines", "drops_counted_by_id", ( double ) ulIDDrops, "frames", pdTRUE, ( double ) ulDropped, pdTRUE, ( double ) ulDropped );
+	prvReport( "tx_deadlines", "other_ids_dropped", ( double ) ( ulOtherIDs + xStatistics.ulUntrackedDrops ), "", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	/* Stop the deadlines, let CAN1 send what it still holds, and discard the
+	frames CAN2 received. */
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_DEADLINES, ( void * ) 0UL );
+	vSimAttachController( 0, 0 );
+	vSimRunFor( 10ULL * simNS_PER_MS );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_RX_BUFFER, NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAcceptanceFilterBenchmark( void )
+{
+/* The IDs the remote node sends in turn.  The first four are accepted by the
+entries added below, the others lie just outside them. */
+static const BenchID_t xIDCycle[] =
+{
+	{ 0x123UL, STD_ID_FORMAT },
+	{ 0x205UL, STD_ID_FORMAT },
+	{ 0x18FEF100UL, EXT_ID_FORMAT },
+	{ 0x18DA10F1UL, EXT_ID_FORMAT },
+	{ 0x124UL, STD_ID_FORMAT },
+	{ 0x210UL, STD_ID_FORMAT },
+	{ 0x18FEF101UL, EXT_ID_FORMAT },
+	{ 0x18DB10F1UL, EXT_ID_FORMAT }
+};
+static const CAN_Filter_Entry_t xEntries[] =
+{
+	{ 0x123UL, 0x123UL, STD_ID_FORMAT },
+	{ 0x200UL, 0x20FUL, STD_ID_FORMAT },
+	{ 0x18FEF100UL, 0x18FEF100UL, EXT_ID_FORMAT },
+	{ 0x18DA0000UL, 0x18DAFFFFUL, EXT_ID_FORMAT }
+};
+const uint32_t ulIDs = ( uint32_t ) ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) );
+const uint32_t ulEntries = ( uint32_t ) ( sizeof( xEntries ) / sizeof( xEntries[ 0 ] ) );
+uint32_t ulFrames[ sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) ];
+uint32_t ulAccepted, ulRejected, ulOther, ulEntry, ulID, ulResults = 0UL;
+SimProfile_t xProfile;
+
+	printf( "Acceptance filter (remote node cycling through %lu IDs, %lu filter entries on CAN2)\n", ( unsigned long ) ulIDs, ( unsigned long ) ulEntries );
+
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	for( ulEntry = 0UL; ulEntry < ulEntries; ulEntry++ )
+	{
+		if( FreeRTOS_ioctl( xCAN2, ioctlADD_CAN_FILTER_ENTRY, ( void * ) &( xEntries[ ulEntry ] ) ) == pdPASS )
+		{
+			ulResults++;
+		}
+	}
+
+	prvReport( "acceptance_filter", "entries_added", ( double ) ulResults, "", pdTRUE, ( double ) ulEntries, pdTRUE, ( double ) ulEntries );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	vSimClearProfile();
+	ulOther = prvReceiveIDCycle( xIDCycle, ulIDs, benchFILTER_CYCLES, ulFrames );
+	vSimGetProfile( &xProfile );
+
+	ulAccepted = ulFrames[ 0 ] + ulFrames[ 1 ] + ulFrames[ 2 ] + ulFrames[ 3 ];
+	ulRejected = ulOther;
+	for( ulID = 4UL; ulID < ulIDs; ulID++ )
+	{
+		ulRejected += ulFrames[ ulID ];
+	}
+
+	/* Every frame read interrupts the CPU at most once, and a rejected frame
+	not at all. */
+	prvReport( "acceptance_filter", "accepted_frames", ( double ) ulAccepted, "frames", pdTRUE, ( double ) ( 4UL * benchFILTER_CYCLES ), pdTRUE, ( double ) ( 4UL * benchFILTER_CYCLES ) );
+	prvReport( "acceptance_filter", "rejected_frames_read", ( double ) ulRejected, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "acceptance_filter", "interrupts", ( double ) xProfile.ulInterrupts, "", pdFALSE, 0.0, pdTRUE, ( double ) ulAccepted );
+
+	/* Remove the single standard ID and the standard range. */
+	ulResults = 0UL;
+	if( FreeRTOS_ioctl( xCAN2, ioctlREMOVE_CAN_FILTER_ENTRY, ( void * ) &( xEntries[ 0 ] ) ) == pdPASS )
+	{
+		ulResults++;
+	}
+	if( FreeRTOS_ioctl( xCAN2, ioctlREMOVE_CAN_FILTER_ENTRY, ( void * ) &( xEntries[ 1 ] ) ) == pdPASS )
+	{
+		ulResults++;
+	}
+
+	prvReport( "acceptance_filter", "entries_removed", ( double ) ulResults, "", pdTRUE, 2.0, pdTRUE, 2.0 );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	ulOther = prvReceiveIDCycle( xIDCycle, ulIDs, benchFILTER_CYCLES, ulFrames );
+
+	ulRejected = ulOther;
+	for( ulID = 4UL; ulID < ulIDs; ulID++ )
+	{
+		ulRejected += ulFrames[ ulID ];
+	}
+
+	prvReport( "acceptance_filter", "after_remove_removed_id_frames", ( double ) ( ulFrames[ 0 ] + ulFrames[ 1 ] ), "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "acceptance_filter", "after_remove_kept_id_frames", ( double ) ( ulFrames[ 2 ] + ulFrames[ 3 ] ), "frames", pdTRUE, ( double ) ( 2UL * benchFILTER_CYCLES ), pdTRUE, ( double ) ( 2UL * benchFILTER_CYCLES ) );
+	prvReport( "acceptance_filter", "after_remove_rejected_frames_read", ( double ) ulRejected, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFilterTableBenchmark( void )
+{
+/* The first four IDs are in the compiled table, the others are not. */
+static const BenchID_t xCompiledIDCycle[] =
+{
+	{ 0x300UL, STD_ID_FORMAT },
+	{ 0x3C6UL, STD_ID_FORMAT },
+	{ 0x650UL, STD_ID_FORMAT },
+	{ 0x100000C4UL, EXT_ID_FORMAT },
+	{ 0x301UL, STD_ID_FORMAT },
+	{ 0x3C8UL, STD_ID_FORMAT },
+	{ 0x6C8UL, STD_ID_FORMAT },
+	{ 0x100000C5UL, EXT_ID_FORMAT }
+};
+/* The first three IDs are in the loaded table, the others are not, although
+the first of them was in the compiled table. */
+static const BenchID_t xLoadedIDCycle[] =
+{
+	{ 0x100UL, STD_ID_FORMAT },
+	{ 0x120UL, STD_ID_FORMAT },
+	{ 0x1ABCDE00UL, EXT_ID_FORMAT },
+	{ 0x300UL, STD_ID_FORMAT },
+	{ 0x101UL, STD_ID_FORMAT },
+	{ 0x1ABCDE01UL, EXT_ID_FORMAT }
+};
+/* The loaded table, which must already be sorted. */
+static SFF_Entry xStdSection[] =
+{
+	{ CAN2_CTRL, MSG_ENABLE, 0x100U },
+	{ CAN2_CTRL, MSG_ENABLE, 0x110U },
+	{ CAN2_CTRL, MSG_ENABLE, 0x120U }
+};
+static EFF_Entry xExtSection[] =
+{
+	{ CAN2_CTRL, 0x1ABCDE00UL }
+};
+static CAN_Filter_Entry_t xEntries[ benchCOMPILED_ENTRIES ];
+const uint32_t ulCompiledIDs = ( uint32_t ) ( sizeof( xCompiledIDCycle ) / sizeof( xCompiledIDCycle[ 0 ] ) );
+const uint32_t ulLoadedIDs = ( uint32_t ) ( sizeof( xLoadedIDCycle ) / sizeof( xLoadedIDCycle[ 0 ] ) );
+uint32_t ulFrames[ sizeof( xCompiledIDCycle ) / sizeof( xCompiledIDCycle[ 0 ] ) ];
+uint32_t ulEntry, ulSwap, ulID, ulAccepted, ulRejected, ulSeed = 0x12345678UL;
+CAN_Filter_Entry_t xEntry;
+CAN_Filter_Table_t xTable;
+AF_SectionDef xSections;
+portBASE_TYPE xResult;
+SimProfile_t xProfile;
+
+	printf( "Filter table (%lu entries compiled, then a table of %lu entries loaded, on CAN2)\n", ( unsigned long ) benchCOMPILED_ENTRIES, ( unsigned long ) ( ( sizeof( xStdSection ) / sizeof( xStdSection[ 0 ] ) ) + ( sizeof( xExtSection ) / sizeof( xExtSection[ 0 ] ) ) ) );
+
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	/* Create the single ID entries, then shuffle them. */
+	for( ulEntry = 0UL; ulEntry < benchCOMPILED_STD_IDS; ulEntry++ )
+	{
+		xEntries[ ulEntry ].ulLowerID = 0x300UL + ( ulEntry << 1UL );
+		xEntries[ ulEntry ].ucFormat = STD_ID_FORMAT;
+	}
+
+	for( ulEntry = 0UL; ulEntry < benchCOMPILED_STD_RUN; ulEntry++ )
+	{
+		xEntries[ benchCOMPILED_STD_IDS + ulEntry ].ulLowerID = 0x600UL + ulEntry;
+		xEntries[ benchCOMPILED_STD_IDS + ulEntry ].ucFormat = STD_ID_FORMAT;
+	}
+
+	for( ulEntry = 0UL; ulEntry < benchCOMPILED_EXT_IDS; ulEntry++ )
+	{
+		xEntries[ benchCOMPILED_STD_IDS + benchCOMPILED_STD_RUN + ulEntry ].ulLowerID = 0x10000000UL + ( ulEntry << 2UL );
+		xEntries[ benchCOMPILED_STD_IDS + benchCOMPILED_STD_RUN + ulEntry ].ucFormat = EXT_ID_FORMAT;
+	}
+
+	for( ulEntry = benchCOMPILED_ENTRIES - 1UL; ulEntry > 0UL; ulEntry-- )
+	{
+		ulSeed = ( ulSeed * 1103515245UL ) + 12345UL;
+		ulSwap = ( ulSeed >> 8UL ) % ( ulEntry + 1UL );
+		xEntry = xEntries[ ulEntry ];
+		xEntries[ ulEntry ] = xEntries[ ulSwap ];
+		xEntries[ ulSwap ] = xEntry;
+	}
+
+	for( ulEntry = 0UL; ulEntry < benchCOMPILED_ENTRIES; ulEntry++ )
+	{
+		xEntries[ ulEntry ].ulUpperID = xEntries[ ulEntry ].ulLowerID;
+	}
+
+	xTable.pxEntries = xEntries;
+	xTable.usNumberOfEntries = ( uint16_t ) benchCOMPILED_ENTRIES;
+
+	vSimClearProfile();
+	xResult = FreeRTOS_ioctl( xCAN2, ioctlCOMPILE_CAN_FILTER_TABLE, &xTable );
+	vSimGetProfile( &xProfile );
+
+	prvReport( "filter_table", "compiled", ( double ) ( xResult == pdPASS ), "", pdTRUE, 1.0, pdTRUE, 1.0 );
+	prvReport( "filter_table", "compile_register_accesses", ( double ) xProfile.ulRegisterAccesses, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	ulRejected = prvReceiveIDCycle( xCompiledIDCycle, ulCompiledIDs, benchFILTER_CYCLES, ulFrames );
+
+	ulAccepted = ulFrames[ 0 ] + ulFrames[ 1 ] + ulFrames[ 2 ] + ulFrames[ 3 ];
+	for( ulID = 4UL; ulID < ulCompiledIDs; ulID++ )
+	{
+		ulRejected += ulFrames[ ulID ];
+	}
+
+	prvReport( "filter_table", "compiled_accepted_frames", ( double ) ulAccepted, "frames", pdTRUE, ( double ) ( 4UL * benchFILTER_CYCLES ), pdTRUE, ( double ) ( 4UL * benchFILTER_CYCLES ) );
+	prvReport( "filter_table", "compiled_rejected_frames_read", ( double ) ulRejected, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	/* Replace the compiled table with one in the NXP format. */
+	memset( &xSections, 0x00, sizeof( xSections ) );
+	xSections.SFF_Sec = xStdSection;
+	xSections.SFF_NumEntry = ( uint8_t ) ( sizeof( xStdSection ) / sizeof( xStdSection[ 0 ] ) );
+	xSections.EFF_Sec = xExtSection;
+	xSections.EFF_NumEntry = ( uint8_t ) ( sizeof( xExtSection ) / sizeof( xExtSection[ 0 ] ) );
+	xResult = FreeRTOS_ioctl( xCAN2, ioctlLOAD_CAN_FILTER_TABLE, &xSections );
+
+	prvReport( "filter_table", "loaded", ( double ) ( xResult == pdPASS ), "", pdTRUE, 1.0, pdTRUE, 1.0 );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	ulRejected = prvReceiveIDCycle( xLoadedIDCycle, ulLoadedIDs, benchFILTER_CYCLES, ulFrames );
+
+	ulAccepted = ulFrames[ 0 ] + ulFrames[ 1 ] + ulFrames[ 2 ];
+	for( ulID = 3UL; ulID < ulLoadedIDs; ulID++ )
+	{
+		ulRejected += ulFrames[ ulID ];
+	}
+
+	prvReport( "filter_table", "loaded_accepted_frames", ( double ) ulAccepted, "frames", pdTRUE, ( double ) ( 3UL * benchFILTER_CYCLES ), pdTRUE, ( double ) ( 3UL * benchFILTER_CYCLES ) );
+	prvReport( "filter_table", "loaded_rejected_frames_read", ( double ) ulRejected, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFullCANBenchmark( void )
+{
+/* The first three IDs are received into FullCAN objects, the fourth through
+the Rx buffer, and the last not at all. */
+static const BenchID_t xIDCycle[] =
+{
+	{ 0x080UL, STD_ID_FORMAT },
+	{ 0x081UL, STD_ID_FORMAT },
+	{ 0x082UL, STD_ID_FORMAT },
+	{ 0x090UL, STD_ID_FORMAT },
+	{ 0x091UL, STD_ID_FORMAT }
+};
+static const CAN_Filter_Entry_t xEntry = { 0x090UL, 0x090UL, STD_ID_FORMAT };
+const uint32_t ulIDs = ( uint32_t ) ( sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) );
+CAN_FullCAN_Mailbox_t xMailboxes[ benchFULLCAN_IDS ];
+uint32_t ulFrames[ sizeof( xIDCycle ) / sizeof( xIDCycle[ 0 ] ) ];
+uint32_t ulUpdated[ 2 ], ulObjectUpdates = 0UL, ulOtherUpdates = 0UL, ulObjectBits = 0UL;
+uint32_t ulResults = 0UL, ulStale = 0UL, ulOther = 0UL, ulID, ulBit;
+portBASE_TYPE xSending;
+SimProfile_t xProfile;
+
+	printf( "FullCAN (%lu IDs in FullCAN objects polled every ms, 1 ID through the Rx buffer, on CAN2)\n", ( unsigned long ) benchFULLCAN_IDS );
+
+	prvResetTest( pdFALSE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_FULLCAN_INTERRUPT, ( void * ) pdFALSE );
+
+	for( ulID = 0UL; ulID < benchFULLCAN_IDS; ulID++ )
+	{
+		if( FreeRTOS_ioctl( xCAN2, ioctlADD_CAN_FULLCAN_ENTRY, ( void * ) xIDCycle[ ulID ].ulID ) == pdPASS )
+		{
+			ulResults++;
+		}
+	}
+
+	if( FreeRTOS_ioctl( xCAN2, ioctlADD_CAN_FILTER_ENTRY, ( void * ) &xEntry ) == pdPASS )
+	{
+		ulResults++;
+	}
+
+	/* The objects move as entries are added, so are found last. */
+	for( ulID = 0UL; ulID < benchFULLCAN_IDS; ulID++ )
+	{
+		xMailboxes[ ulID ].usID = ( uint16_t ) xIDCycle[ ulID ].ulID;
+		if( FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_FULLCAN_MAILBOX, &( xMailboxes[ ulID ] ) ) == pdPASS )
+		{
+			ulResults++;
+			ulObjectBits |= 1UL << xMailboxes[ ulID ].ucObjectNumber;
+		}
+	}
+
+	prvReport( "fullcan", "setup_requests_passed", ( double ) ulResults, "", pdTRUE, ( double ) ( ( 2UL * benchFULLCAN_IDS ) + 1UL ), pdTRUE, ( double ) ( ( 2UL * benchFULLCAN_IDS ) + 1UL ) );
+
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	vSimClearProfile();
+
+	xBurstSequence.pxIDCycle = xIDCycle;
+	xBurstSequence.ulIDCycleLength = ulIDs;
+	xBurstSequence.ulFramesToSend = benchFILTER_CYCLES * ulIDs;
+	xBurstSequence.ulFramesQueued = 0UL;
+	xBurstSequence.ulFramesSent = 0UL;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+	xBurstSequence.pxEndTimes = NULL;
+
+	do
+	{
+		xSending = ( xBurstSequence.ulFramesSent < xBurstSequence.ulFramesToSend ) ? pdTRUE : pdFALSE;
+		vSimRunFor( simNS_PER_MS );
+
+		ulOther += prvCountIDFrames( xIDCycle, ulIDs, ulFrames );
+
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_FULLCAN_UPDATES, ulUpdated );
+		ulOtherUpdates += ( uint32_t ) __builtin_popcount( ulUpdated[ 0 ] & ~ulObjectBits ) + ( uint32_t ) __builtin_popcount( ulUpdated[ 1 ] );
+		ulObjectUpdates += ( uint32_t ) __builtin_popcount( ulUpdated[ 0 ] & ulObjectBits );
+	} while( xSending != pdFALSE );
+
+	vSimGetProfile( &xProfile );
+
+	/* The last frame sent with each FullCAN ID has sequence number
+	( ( benchFILTER_CYCLES - 1 ) * ulIDs ) + ulID. */
+	for( ulID = 0UL; ulID < benchFULLCAN_IDS; ulID++ )
+	{
+		if( ( ( xMailboxes[ ulID ].pxObject->ulControl & 0x7FFUL ) != xIDCycle[ ulID ].ulID ) || ( xMailboxes[ ulID ].pxObject->ulDataA != ( ( ( benchFILTER_CYCLES - 1UL ) * ulIDs ) + ulID ) ) )
+		{
+			ulStale++;
+		}
+	}
+
+	ulBit = 0UL;
+	for( ulID = 0UL; ulID < benchFULLCAN_IDS; ulID++ )
+	{
+		ulBit += ulFrames[ ulID ];
+	}
+
+	prvReport( "fullcan", "fullcan_frames_read", ( double ) ulBit, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "fullcan", "rx_buffer_frames_read", ( double ) ulFrames[ benchFULLCAN_IDS ], "frames", pdTRUE, ( double ) benchFILTER_CYCLES, pdTRUE, ( double ) benchFILTER_CYCLES );
+	prvReport( "fullcan", "rejected_frames_read", ( double ) ( ulFrames[ benchFULLCAN_IDS + 1UL ] + ulOther ), "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "fullcan", "object_updates_seen", ( double ) ulObjectUpdates, "", pdTRUE, 1.0, pdTRUE, ( double ) ( benchFULLCAN_IDS * benchFILTER_CYCLES ) );
+	prvReport( "fullcan", "other_updates_seen", ( double ) ulOtherUpdates, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "fullcan", "stale_objects", ( double ) ulStale, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	/* Only the frames read through the Rx buffer may interrupt the CPU. */
+	prvReport( "fullcan", "interrupts", ( double ) xProfile.ulInterrupts, "", pdFALSE, 0.0, pdTRUE, ( double ) ulFrames[ benchFULLCAN_IDS ] );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRoutingBenchmark( void )
+{
+/* The first two IDs are forwarded with bits 10:8 of the ID changed to 5, the
+third matches no route, and the fourth is forwarded unchanged and also read. */
+static const BenchID_t xIDCycle[ benchROUTING_IDS ] =
+{
+	{ 0x300UL, STD_ID_FORMAT },
+	{ 0x30FUL, STD_ID_FORMAT },
+	{ 0x090UL, STD_ID_FORMAT },
+	{ 0x18FF0012UL, EXT_ID_FORMAT }
+};
+static const CAN_Route_t xRoutes[] =
+{
+	{ 0x300UL, 0x3FFUL, 0x700UL, 0x500UL, STD_ID_FORMAT, 1U, pdFALSE },
+	{ 0x18FF0000UL, 0x18FF00FFUL, 0UL, 0UL, EXT_ID_FORMAT, 1U, pdTRUE }
+};
+static SimTime_t xEndTimes[ benchROUTING_FRAMES ];
+uint32_t ulFrames[ benchROUTING_IDS ];
+uint32_t ulOther = 0UL, ulDropCount = 0UL;
+CAN_Routing_Table_t xTable;
+
+	printf( "Routing (CAN2 forwarding three of %lu IDs to CAN1 at 100%% bus load)\n", ( unsigned long ) benchROUTING_IDS );
+
+	prvResetTest( pdFALSE );
+	vSimAttachController( 0, 2 );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	memset( &xRoutedFrames, 0x00, sizeof( xRoutedFrames ) );
+
+	xTable.pxRoutes = xRoutes;
+	xTable.usNumberOfRoutes = ( uint16_t ) ( sizeof( xRoutes ) / sizeof( xRoutes[ 0 ] ) );
+	prvReport( "routing", "table_set", ( double ) ( FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_ROUTING_TABLE, &xTable ) == pdPASS ), "", pdTRUE, 1.0, pdTRUE, 1.0 );
+
+	/* The end times are recorded as the frames are sent, so the routed
+	frames can be timed as they are heard on bus 2. */
+	memset( ulFrames, 0x00, sizeof( ulFrames ) );
+	xBurstSequence.pxEndTimes = xEndTimes;
+	xBurstSequence.pxIDCycle = xIDCycle;
+	xBurstSequence.ulIDCycleLength = benchROUTING_IDS;
+	xBurstSequence.ulFramesToSend = benchROUTING_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+		ulOther += prvCountIDFrames( xIDCycle, benchROUTING_IDS, ulFrames );
+	} while( xBurstSequence.ulFramesSent < xBurstSequence.ulFramesToSend );
+
+	vSimRunFor( simNS_PER_MS );
+	ulOther += prvCountIDFrames( xIDCycle, benchROUTING_IDS, ulFrames );
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_ROUTE_DROP_COUNT, &ulDropCount );
+
+	prvReport( "routing", "forwarded_frames", ( double ) xRoutedFrames.ulFrames, "frames", pdTRUE, ( double ) ( 3UL * benchFILTER_CYCLES ), pdTRUE, ( double ) ( 3UL * benchFILTER_CYCLES ) );
+	prvReport( "routing", "forwarded_wrong_ids", ( double ) xRoutedFrames.ulWrongIDs, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "routing", "dropped_frames", ( double ) ulDropCount, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "routing", "routed_frames_read", ( double ) ( ulFrames[ 0 ] + ulFrames[ 1 ] + ulOther ), "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( "routing", "local_frames_read", ( double ) ulFrames[ 2 ], "frames", pdTRUE, ( double ) benchFILTER_CYCLES, pdTRUE, ( double ) benchFILTER_CYCLES );
+	prvReport( "routing", "routed_and_local_frames_read", ( double ) ulFrames[ 3 ], "frames", pdTRUE, ( double ) benchFILTER_CYCLES, pdTRUE, ( double ) benchFILTER_CYCLES );
+
+	if( xRoutedFrames.ulFrames > 0UL )
+	{
+		prvReport( "routing", "mean_latency", ( ( double ) xRoutedFrames.xTotalLatency / ( double ) xRoutedFrames.ulFrames ) / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+		prvReport( "routing", "max_latency", ( double ) xRoutedFrames.xMaxLatency / ( double ) simNS_PER_US, "us", pdFALSE, 0.0, pdTRUE, benchMAX_ROUTING_LATENCY_US );
+	}
+
+	/* Stop forwarding. */
+	xTable.usNumberOfRoutes = 0U;
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_ROUTING_TABLE, &xTable );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFrameBatchBenchmark( void )
+{
+static CAN_MSG_Type xTxFrames[ benchBATCH_FRAMES ];
+CAN_MSG_Type xRxFrames[ benchRX_QUEUE_LENGTH ];
+Peripheral_Descriptor_t xBatchCAN1, xBatchCAN2;
+uint32_t ul, ulIntact = 0UL, ulFramesRead = 0UL;
+size_t xBytes, xWritten;
+SimTime_t xStart;
+
+	printf( "Frame batch mode (%lu frames written in one call, %lu read one at a time)\n", ( unsigned long ) benchBATCH_FRAMES, ( unsigned long ) benchBATCH_READS );
+
+	/* The second handles have no transfer control structures, so they write
+	through the Tx buffers directly and read the frame the Rx interrupt last
+	received.  Opening a controller resets it, so they are opened before the
+	test sets the bit rate. */
+	xBatchCAN1 = FreeRTOS_open( ( const int8_t * ) "/CAN1/", 0 );
+	xBatchCAN2 = FreeRTOS_open( ( const int8_t * ) "/CAN2/", 0 );
+	configASSERT( xBatchCAN1 );
+	configASSERT( xBatchCAN2 );
+
+	prvResetTest( pdTRUE );
+
+	/* The reset left CAN2's Rx interrupt disabled, so enable it again for
+	the Rx frame queue of xCAN2 to receive the frames CAN1 writes.  Batch mode
+	belongs to the controller, so is set through either handle. */
+	FreeRTOS_ioctl( xCAN2, ioctlUSE_INTERRUPTS, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xBatchCAN1, ioctlSET_CAN_FRAME_BATCH_MODE, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xBatchCAN2, ioctlSET_CAN_FRAME_BATCH_MODE, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xBatchCAN1, ioctlSET_TX_TIMEOUT, ( void * ) benchBATCH_TX_TIMEOUT );
+
+	/* The IDs rise, so the frames win arbitration in the order written. */
+	for( ul = 0UL; ul < benchBATCH_FRAMES; ul++ )
+	{
+		memset( &( xTxFrames[ ul ] ), 0x00, sizeof( CAN_MSG_Type ) );
+		xTxFrames[ ul ].id = 0x200UL + ul;
+		xTxFrames[ ul ].len = ( uint8_t ) ( ul + 1UL );
+		xTxFrames[ ul ].format = STD_ID_FORMAT;
+		xTxFrames[ ul ].type = DATA_FRAME;
+		xTxFrames[ ul ].dataAWord = ul;
+		xTxFrames[ ul ].dataBWord = ~ul;
+	}
+
+	xWritten = FreeRTOS_write( xBatchCAN1, xTxFrames, sizeof( xTxFrames ) );
+	vSimRunFor( simNS_PER_MS );
+	xBytes = FreeRTOS_read( xCAN2, xRxFrames, sizeof( xRxFrames ) );
+
+	for( ul = 0UL; ( ul < benchBATCH_FRAMES ) && ( ul < ( xBytes / sizeof( CAN_MSG_Type ) ) ); ul++ )
+	{
+		if( ( xRxFrames[ ul ].id == xTxFrames[ ul ].id ) && ( xRxFrames[ ul ].len == xTxFrames[ ul ].len ) && ( xRxFrames[ ul ].dataAWord == xTxFrames[ ul ].dataAWord ) && ( xRxFrames[ ul ].dataBWord == xTxFrames[ ul ].dataBWord ) )
+		{
+			ulIntact++;
+		}
+	}
+
+	prvReport( "frame_batch", "frames_written", ( double ) ( xWritten / sizeof( CAN_MSG_Type ) ), "frames", pdTRUE, ( double ) benchBATCH_FRAMES, pdTRUE, ( double ) benchBATCH_FRAMES );
+	prvReport( "frame_batch", "frames_received_intact", ( double ) ulIntact, "frames", pdTRUE, ( double ) benchBATCH_FRAMES, pdTRUE, ( double ) benchBATCH_FRAMES );
+
+	/* The Rx interrupt now keeps the frame it last received for the reader
+	of xBatchCAN2, which is given a whole frame or nothing.  The remote node
+	sends one frame every millisecond, so the reader never falls behind. */
+	FreeRTOS_ioctl( xBatchCAN2, ioctlUSE_INTERRUPTS, ( void * ) pdTRUE );
+	prvReport( "frame_batch", "short_read_bytes", ( double ) FreeRTOS_read( xBatchCAN2, xRxFrames, 8U ), "bytes", pdTRUE, 0.0, pdTRUE, 0.0 );
+
+	xLatencySequence.ulFramesToSend = benchBATCH_READS;
+	xLatencySequence.xFirstRelease = xSimGetTime() + simNS_PER_MS;
+	xLatencySequence.xPeriod = simNS_PER_MS;
+	xLatencySequence.ucLength = 8U;
+
+	for( ul = 0UL; ul < benchBATCH_READS; ul++ )
+	{
+		xBytes = FreeRTOS_read( xBatchCAN2, xRxFrames, sizeof( xRxFrames ) );
+
+		if( ( xBytes == sizeof( CAN_MSG_Type ) ) && ( xRxFrames[ 0 ].id == benchREMOTE_NODE_ID ) && ( xRxFrames[ 0 ].len == 8U ) && ( xRxFrames[ 0 ].dataAWord == ul ) )
+		{
+			ulFramesRead++;
+		}
+	}
+
+	prvReport( "frame_batch", "whole_frames_read", ( double ) ulFramesRead, "frames", pdTRUE, ( double ) benchBATCH_READS, pdTRUE, ( double ) benchBATCH_READS );
+
+	/* With CAN1 on a bus of its own nothing it sends is acknowledged, so the
+	frames that fill the three Tx buffers are never sent, and the write gives
+	up on the rest once the Tx timeout has passed. */
+	vSimAttachController( 0, 1 );
+	xStart = xSimGetTime();
+	xWritten = FreeRTOS_write( xBatchCAN1, xTxFrames, sizeof( xTxFrames ) );
+	prvReport( "frame_batch", "unacknowledged_frames_written", ( double ) ( xWritten / sizeof( CAN_MSG_Type ) ), "frames", pdTRUE, 3.0, pdTRUE, 3.0 );
+	prvReport( "frame_batch", "unacknowledged_write_time", ( double ) ( xSimGetTime() - xStart ) / ( double ) simNS_PER_MS, "ms", pdTRUE, ( double ) ( benchBATCH_TX_TIMEOUT - 1UL ), pdTRUE, ( double ) ( benchBATCH_TX_TIMEOUT + 1UL ) );
+
+	/* Setting the bit rate resets CAN1, which discards the frames it still
+	holds.  The controllers leave batch mode, and the interrupts and frame
+	queues the other tests use are restored, as opening the second handles
+	reset them. */
+	FreeRTOS_ioctl( xBatchCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xBatchCAN1, ioctlSET_CAN_FRAME_BATCH_MODE, ( void * ) pdFALSE );
+	FreeRTOS_ioctl( xBatchCAN2, ioctlSET_CAN_FRAME_BATCH_MODE, ( void * ) pdFALSE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_SPEED, ( void * ) benchBIT_RATE );
+	vSimAttachController( 0, 0 );
+	FreeRTOS_ioctl( xCAN1, ioctlUSE_CAN_FRAME_QUEUE_TX, ( void * ) benchTX_QUEUE_LENGTH );
+	FreeRTOS_ioctl( xCAN2, ioctlUSE_INTERRUPTS, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_ERROR_INTERRUPTS, ( void * ) pdTRUE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CAN_ERROR_INTERRUPTS, ( void * ) pdTRUE );
+
+	printf( "\n" );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRoutedFrameReceived( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xEndOfFrame )
+{
+BenchRoutedFrames_t * const pxRouted = ( BenchRoutedFrames_t * ) pvContext;
+const uint32_t ulSequenceNumber = pxFrame->dataAWord;
+uint32_t ulExpectedID;
+SimTime_t xLatency;
+
+	if( ulSequenceNumber < benchROUTING_FRAMES )
+	{
+		/* The frames were sent in cycles of the routing test's IDs. */
+		switch( ulSequenceNumber % benchROUTING_IDS )
+		{
+			case 0UL	:	ulExpectedID = 0x500UL;			break;
+			case 1UL	:	ulExpectedID = 0x50FUL;			break;
+			case 3UL	:	ulExpectedID = 0x18FF0012UL;	break;
+			default		:	ulExpectedID = UINT32_MAX;		break;
+		}
+
+		if( pxFrame->id != ulExpectedID )
+		{
+			( pxRouted->ulWrongIDs )++;
+		}
+
+		xLatency = xEndOfFrame - xBurstSequence.pxEndTimes[ ulSequenceNumber ];
+		pxRouted->xTotalLatency += xLatency;
+		if( xLatency > pxRouted->xMaxLatency )
+		{
+			pxRouted->xMaxLatency = xLatency;
+		}
+	}
+	else
+	{
+		( pxRouted->ulWrongIDs )++;
+	}
+
+	( pxRouted->ulFrames )++;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReceiveIDCycle( const BenchID_t *pxIDs, uint32_t ulIDs, uint32_t ulCycles, uint32_t *pulFrames )
+{
+uint32_t ulOther = 0UL;
+portBASE_TYPE xSending;
+
+	xBurstSequence.pxIDCycle = pxIDs;
+	xBurstSequence.ulIDCycleLength = ulIDs;
+	xBurstSequence.ulFramesToSend = ulCycles * ulIDs;
+	xBurstSequence.ulFramesQueued = 0UL;
+	xBurstSequence.ulFramesSent = 0UL;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+	xBurstSequence.pxEndTimes = NULL;
+
+	do
+	{
+		/* One more millisecond is run once the last frame has been sent, so
+		the frames it left in the queue are read too. */
+		xSending = ( xBurstSequence.ulFramesSent < xBurstSequence.ulFramesToSend ) ? pdTRUE : pdFALSE;
+		vSimRunFor( simNS_PER_MS );
+		ulOther += prvCountIDFrames( pxIDs, ulIDs, pulFrames );
+	} while( xSending != pdFALSE );
+
+	return ulOther;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCountIDFrames( const BenchID_t *pxIDs, uint32_t ulIDs, uint32_t *pulFrames )
+{
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+uint32_t ulOther = 0UL, ulID;
+size_t xBytes, xFrame;
+
+	do
+	{
+		xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+
+		for( xFrame = 0U; xFrame < ( xBytes / sizeof( CAN_MSG_Type ) ); xFrame++ )
+		{
+			for( ulID = 0UL; ulID < ulIDs; ulID++ )
+			{
+				if( ( xFrames[ xFrame ].id == pxIDs[ ulID ].ulID ) && ( xFrames[ xFrame ].format == pxIDs[ ulID ].ucFormat ) )
+				{
+					break;
+				}
+			}
+
+			if( ulID < ulIDs )
+			{
+				pulFrames[ ulID ]++;
+			}
+			else
+			{
+				ulOther++;
+			}
+		}
+	} while( xBytes == sizeof( xFrames ) );
+
+	return ulOther;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSendTimeSync( const char *pcPrefix, portBASE_TYPE xUseConfirmation )
+{
+static uint32_t ulSentTimes[ benchSYNC_MESSAGES ], ulRxTimestamps[ benchSYNC_MESSAGES ];
+static uint8_t ucReceived[ benchSYNC_MESSAGES ];
+CAN_MSG_Type xTxFrame, xRxFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Tx_Confirmation_Config_t xConfig;
+CAN_Tx_Confirmation_t xConfirmation;
+uint32_t ulMessage, ulMessages = 0UL, ul, ulError, ulMaxError = 0UL;
+uint64_t ullTotalError = 0ULL;
+size_t xBytes;
+char cMetric[ 64 ];
+
+	prvResetTest( pdTRUE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	memset( ucReceived, 0x00, sizeof( ucReceived ) );
+	memset( ulSentTimes, 0x00, sizeof( ulSentTimes ) );
+
+	/* Confirmations are only queued for the run that uses them, and the
+	sender waits for each. */
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	if( xUseConfirmation != pdFALSE )
+	{
+		xConfig.usQueueLength = 4U;
+		xConfig.xBlockTime = benchSYNC_CONFIRM_WAIT_TICKS;
+	}
+	FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_TX_CONFIRMATION, &xConfig );
+
+	/* The remote node's frames win arbitration, and leave the bus idle only
+	briefly between them, so each sync message waits for up to a frame. */
+	xBurstSequence.ulFramesToSend = 0xFFFFFFFFUL;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = benchSYNC_FLOOD_PERIOD_US * simNS_PER_US;
+	xBurstSequence.ucLength = 8U;
+
+	memset( &xTxFrame, 0x00, sizeof( xTxFrame ) );
+	xTxFrame.len = 8U;
+	xTxFrame.format = STD_ID_FORMAT;
+	xTxFrame.type = DATA_FRAME;
+
+	/* Each message is written at a different point in the remote node's
+	period.  The last few milliseconds send nothing, and let the last messages
+	arrive. */
+	for( ulMessage = 0UL; ulMessage < ( benchSYNC_MESSAGES + benchSYNC_SETTLE_MS ); ulMessage++ )
+	{
+		vSimRunFor( simNS_PER_MS - ( ( ( SimTime_t ) ulMessage * 37ULL ) % benchSYNC_FLOOD_PERIOD_US ) * simNS_PER_US );
+
+		if( ulMessage < benchSYNC_MESSAGES )
+		{
+			/* The sender only knows when it wrote the frame, unless it is told
+			when the frame was sent. */
+			xTxFrame.id = benchSYNC_ID;
+			xTxFrame.dataAWord = ulMessage;
+			FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TIMESTAMP, &( xTxFrame.dataBWord ) );
+			if( xUseConfirmation != pdFALSE )
+			{
+				xTxFrame.dataBWord = 0UL;
+			}
+			FreeRTOS_write( xCAN1, &xTxFrame, sizeof( xTxFrame ) );
+
+			if( xUseConfirmation == pdFALSE )
+			{
+				ulSentTimes[ ulMessage ] = xTxFrame.dataBWord;
+			}
+			else
+			{
+				/* The follow ups are confirmed too, and are skipped. */
+				while( FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TX_CONFIRMATION, &xConfirmation ) == pdPASS )
+				{
+					if( ( xConfirmation.ulID == benchSYNC_ID ) && ( xConfirmation.ulDataA == ulMessage ) )
+					{
+						if( xConfirmation.ucResult == diCAN_TX_SENT )
+						{
+							/* The follow up carries the time the sync message
+							was sent. */
+							xTxFrame.id = benchSYNC_FOLLOW_UP_ID;
+							xTxFrame.dataBWord = xConfirmation.ulTimestamp;
+							FreeRTOS_write( xCAN1, &xTxFrame, sizeof( xTxFrame ) );
+						}
+
+						break;
+					}
+				}
+			}
+		}
+
+		/* CAN2 takes the time from its own timestamp of the sync message
+		and the time carried by the sync message or its follow up. */
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xRxFrames, sizeof( xRxFrames ) );
+
+			for( ul = 0UL; ul < ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) ); ul++ )
+			{
+				if( ( xRxFrames[ ul ].id == benchSYNC_ID ) && ( xRxFrames[ ul ].dataAWord < benchSYNC_MESSAGES ) )
+				{
+					ulRxTimestamps[ xRxFrames[ ul ].dataAWord ] = xRxFrames[ ul ].timestamp;
+					ucReceived[ xRxFrames[ ul ].dataAWord ] |= 0x01U;
+
+					if( xUseConfirmation == pdFALSE )
+					{
+						ucReceived[ xRxFrames[ ul ].dataAWord ] |= 0x02U;
+					}
+				}
+				else if( ( xRxFrames[ ul ].id == benchSYNC_FOLLOW_UP_ID ) && ( xRxFrames[ ul ].dataAWord < benchSYNC_MESSAGES ) )
+				{
+					ulSentTimes[ xRxFrames[ ul ].dataAWord ] = xRxFrames[ ul ].dataBWord;
+					ucReceived[ xRxFrames[ ul ].dataAWord ] |= 0x02U;
+				}
+			}
+		} while( xBytes != 0U );
+	}
+
+	xBurstSequence.ulFramesToSend = xBurstSequence.ulFramesQueued;
+
+	for( ulMessage = 0UL; ulMessage < benchSYNC_MESSAGES; ulMessage++ )
+	{
+		if( ucReceived[ ulMessage ] == 0x03U )
+		{
+			ulError = ( ulRxTimestamps[ ulMessage ] >= ulSentTimes[ ulMessage ] ) ? ( ulRxTimestamps[ ulMessage ] - ulSentTimes[ ulMessage ] ) : ( ulSentTimes[ ulMessage ] - ulRxTimestamps[ ulMessage ] );
+			ullTotalError += ulError;
+			if( ulError > ulMaxError )
+			{
+				ulMaxError = ulError;
+			}
+
+			ulMessages++;
+		}
+	}
+
+	snprintf( cMetric, sizeof( cMetric ), "%s_messages", pcPrefix );
+	prvReport( "tx_confirmation", cMetric, ( double ) ulMessages, "", pdTRUE, ( double ) benchSYNC_MESSAGES, pdTRUE, ( double ) benchSYNC_MESSAGES );
+
+	if( ulMessages > 0UL )
+	{
+		snprintf( cMetric, sizeof( cMetric ), "%s_mean_error", pcPrefix );
+		prvReport( "tx_confirmation", cMetric, ( ( double ) ullTotalError / ( double ) ulMessages ) * boardCAN_TIMESTAMP_RESOLUTION_US, "us", pdFALSE, 0.0, pdFALSE, 0.0 );
+		snprintf( cMetric, sizeof( cMetric ), "%s_max_error", pcPrefix );
+		prvReport( "tx_confirmation", cMetric, ( double ) ( ulMaxError * boardCAN_TIMESTAMP_RESOLUTION_US ), "us", pdFALSE, 0.0, xUseConfirmation, benchMAX_TIMESTAMP_ERROR_US );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvSendWithDeadlines( const char *pcPrefix, portBASE_TYPE xUseDeadlines, uint32_t *pulMissing )
+{
+CAN_MSG_Type xTxFrames[ 2 ], xRxFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Bus_Load_t xBusLoad;
+uint32_t ulMs, ulNow, ulLatency, ulMaxLatency = 0UL, ulFresh = 0UL, ulStaleWritten = 0UL, ulStaleReceived = 0UL, ulObsolete = 0UL, ul;
+size_t xBytes;
+char cMetric[ 64 ];
+
+	prvResetTest( pdTRUE );
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 0UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	/* The remote node's frames are all released as soon as they are given to
+	it. */
+	xBurstSequence.ulID = benchDEADLINE_FLOOD_ID;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.ucLength = 8U;
+
+	memset( xTxFrames, 0x00, sizeof( xTxFrames ) );
+	xTxFrames[ 0 ].id = benchDEADLINE_FRESH_ID;
+	for( ul = 0UL; ul < 2UL; ul++ )
+	{
+		xTxFrames[ ul ].len = 8U;
+		xTxFrames[ ul ].format = STD_ID_FORMAT;
+		xTxFrames[ ul ].type = DATA_FRAME;
+	}
+
+	for( ulMs = 0UL; ulMs < ( benchDEADLINE_RUN_MS + benchDEADLINE_SETTLE_MS ); ulMs++ )
+	{
+		if( ulMs < benchDEADLINE_RUN_MS )
+		{
+			xBurstSequence.ulFramesToSend += ( ( ulMs % benchDEADLINE_CYCLE_MS ) < benchDEADLINE_BURST_MS ) ? benchDEADLINE_BURST_FRAMES : benchDEADLINE_QUIET_FRAMES;
+
+			/* Both frames carry the time they were written.  The low priority
+			frame also carries its deadline, which is only given to the driver
+			when deadlines are used.  0 would mean no deadline. */
+			FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_TIMESTAMP, &ulNow );
+			xTxFrames[ 0 ].dataAWord = ulNow;
+			xTxFrames[ 1 ].id = benchDEADLINE_STALE_BASE_ID + ( ulMs % benchDEADLINE_STALE_IDS );
+			xTxFrames[ 1 ].dataAWord = ulNow;
+			xTxFrames[ 1 ].dataBWord = ulNow + ( benchDEADLINE_US / boardCAN_TIMESTAMP_RESOLUTION_US );
+			if( xTxFrames[ 1 ].dataBWord == 0UL )
+			{
+				xTxFrames[ 1 ].dataBWord = 1UL;
+			}
+			xTxFrames[ 1 ].timestamp = ( xUseDeadlines != pdFALSE ) ? xTxFrames[ 1 ].dataBWord : 0UL;
+
+			xBytes = FreeRTOS_write( xCAN1, xTxFrames, sizeof( xTxFrames ) );
+			configASSERT( xBytes == sizeof( xTxFrames ) );
+			ulStaleWritten++;
+		}
+
+		vSimRunFor( simNS_PER_MS );
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xRxFrames, sizeof( xRxFrames ) );
+
+			for( ul = 0UL; ul < ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) ); ul++ )
+			{
+				if( xRxFrames[ ul ].id == benchDEADLINE_FRESH_ID )
+				{
+					ulLatency = xRxFrames[ ul ].timestamp - xRxFrames[ ul ].dataAWord;
+					if( ulLatency > ulMaxLatency )
+					{
+						ulMaxLatency = ulLatency;
+					}
+					ulFresh++;
+				}
+				else if( xRxFrames[ ul ].id != benchDEADLINE_FLOOD_ID )
+				{
+					if( ( int32_t ) ( xRxFrames[ ul ].timestamp - ( xRxFrames[ ul ].dataBWord + ( benchDEADLINE_TOLERANCE_US / boardCAN_TIMESTAMP_RESOLUTION_US ) ) ) > 0L )
+					{
+						ulObsolete++;
+					}
+					ulStaleReceived++;
+				}
+			}
+		} while( xBytes != 0U );
+	}
+
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BUS_LOAD, &xBusLoad );
+	*pulMissing = ulStaleWritten - ulStaleReceived;
+
+	snprintf( cMetric, sizeof( cMetric ), "%s_bus_load", pcPrefix );
+	prvReport( "tx_deadlines", cMetric, ( double ) xBusLoad.usLoad / 100.0, "%", pdTRUE, benchMIN_DEADLINE_BUS_LOAD, pdTRUE, benchMAX_DEADLINE_BUS_LOAD );
+	snprintf( cMetric, sizeof( cMetric ), "%s_fresh_frames", pcPrefix );
+	prvReport( "tx_deadlines", cMetric, ( double ) ulFresh, "frames", pdTRUE, ( double ) benchDEADLINE_RUN_MS, pdTRUE, ( double ) benchDEADLINE_RUN_MS );
+	snprintf( cMetric, sizeof( cMetric ), "%s_fresh_max_latency", pcPrefix );
+	prvReport( "tx_deadlines", cMetric, ( double ) ( ulMaxLatency * boardCAN_TIMESTAMP_RESOLUTION_US ), "us", pdFALSE, 0.0, xUseDeadlines, benchMAX_DEADLINE_FRESH_LATENCY_US );
+	snprintf( cMetric, sizeof( cMetric ), "%s_low_priority_frames_received", pcPrefix );
+	prvReport( "tx_deadlines", cMetric, ( double ) ulStaleReceived, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+	snprintf( cMetric, sizeof( cMetric ), "%s_obsolete_frames_received", pcPrefix );
+	prvReport( "tx_deadlines", cMetric, ( double ) ulObsolete, "frames", pdFALSE, 0.0, xUseDeadlines, 0.0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCountConfirmation( const CAN_Tx_Confirmation_t *pxConfirmation, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+	( void ) pxConfirmation;
+	( void ) pxHigherPriorityTaskWoken;
+
+	( *( ( uint32_t * ) pvContext ) )++;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCheckSignals( const CAN_Signal_Decoder_t *pxDecoder, const CAN_MSG_Type *pxFrame, uint32_t *pulChanges )
+{
+static int64_t llExpected[ BENCHSIGNALS_SIGNALS ], llLastWatched[ BENCHSIGNALS_SIGNALS ];
+static uint8_t ucSeen[ BENCHSIGNALS_SIGNALS ];
+const CAN_Message_Def_t *pxMessage;
+uint32_t ulMismatches = 0UL;
+uint16_t usSignal;
+
+	pxMessage = prvDecodeBitByBit( pxFrame, llExpected );
+	if( pxMessage != NULL )
+	{
+		for( usSignal = pxMessage->usFirstSignal; usSignal < ( pxMessage->usFirstSignal + pxMessage->usSignals ); usSignal++ )
+		{
+			if( llCANSignalsGetRaw( pxDecoder, usSignal ) != llExpected[ usSignal ] )
+			{
+				ulMismatches++;
+			}
+
+			if( ( ( usSignal % benchSIGNAL_WATCH_EVERY ) == 0U ) && ( ( ucSeen[ usSignal ] == 0U ) || ( llLastWatched[ usSignal ] != llExpected[ usSignal ] ) ) )
+			{
+				( *pulChanges )++;
+			}
+
+			ucSeen[ usSignal ] = 1U;
+			llLastWatched[ usSignal ] = llExpected[ usSignal ];
+		}
+	}
+	else
+	{
+		ulMismatches++;
+	}
+
+	return ulMismatches;
+}
+/*-----------------------------------------------------------*/
+
+static const CAN_Message_Def_t *prvDecodeBitByBit( const CAN_MSG_Type *pxFrame, int64_t *pllValues )
+{
+const CAN_Message_Def_t *pxMessage = NULL;
+const CAN_Signal_Def_t *pxSignal;
+uint32_t ulID = pxFrame->id;
+uint8_t ucData[ 8 ], ucBit, ucBitsDone;
+uint16_t usMessage, usSignal;
+uint64_t ullRaw;
+
+	if( pxFrame->format == EXT_ID_FORMAT )
+	{
+		ulID |= cansigEXTENDED_ID;
+	}
+
+	for( usMessage = 0U; usMessage < xBenchSignals.usMessages; usMessage++ )
+	{
+		if( xBenchSignals.pxMessages[ usMessage ].ulID == ulID )
+		{
+			pxMessage = &( xBenchSignals.pxMessages[ usMessage ] );
+			break;
+		}
+	}
+
+	if( pxMessage != NULL )
+	{
+		memcpy( &( ucData[ 0 ] ), pxFrame->dataA, 4 );
+		memcpy( &( ucData[ 4 ] ), pxFrame->dataB, 4 );
+
+		for( usSignal = pxMessage->usFirstSignal; usSignal < ( pxMessage->usFirstSignal + pxMessage->usSignals ); usSignal++ )
+		{
+			pxSignal = &( xBenchSignals.pxSignals[ usSignal ] );
+			ullRaw = 0ULL;
+			ucBit = pxSignal->ucStartBit;
+
+			/* An Intel signal starts at its least significant bit and runs up
+			through the payload.  A Motorola signal starts at its most
+			significant bit, and runs down each byte to the top of the next. */
+			for( ucBitsDone = 0U; ucBitsDone < pxSignal->ucLength; ucBitsDone++ )
+			{
+				if( ( pxSignal->ucFlags & cansigBIG_ENDIAN ) == 0U )
+				{
+					ullRaw |= ( uint64_t ) ( ( ucData[ ucBit / 8U ] >> ( ucBit % 8U ) ) & 0x01U ) << ucBitsDone;
+					ucBit++;
+				}
+				else
+				{
+					ullRaw = ( ullRaw << 1 ) | ( uint64_t ) ( ( ucData[ ucBit / 8U ] >> ( ucBit % 8U ) ) & 0x01U );
+					ucBit = ( ( ucBit % 8U ) == 0U ) ? ( uint8_t ) ( ucBit + 15U ) : ( uint8_t ) ( ucBit - 1U );
+				}
+			}
+
+			if( ( ( pxSignal->ucFlags & cansigSIGNED ) != 0U ) && ( pxSignal->ucLength < 64U ) && ( ( ullRaw >> ( pxSignal->ucLength - 1U ) ) != 0ULL ) )
+			{
+				ullRaw |= ~0ULL << pxSignal->ucLength;
+			}
+
+			pllValues[ usSignal ] = ( int64_t ) ullRaw;
+		}
+	}
+
+	return pxMessage;
+}
+/*-----------------------------------------------------------*/
+
+static double prvHostTimeNs( void )
+{
+struct timespec xNow;
+
+	clock_gettime( CLOCK_MONOTONIC, &xNow );
+	return ( ( double ) xNow.tv_sec * 1e9 ) + ( double ) xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReceiveOverHarness( const char *pcPrefix, portBASE_TYPE xUseDriverTiming )
+{
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+CAN_Bit_Timing_t xTiming;
+SimBusStatistics_t xBusStatistics;
+uint32_t ulReceived = 0UL;
+size_t xBytes;
+char cMetric[ 48 ];
+
+	prvResetTest( pdFALSE );
+	vSimBusSetLoopDelay( 0, benchHARNESS_LOOP_DELAY_NS );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	if( xUseDriverTiming == pdFALSE )
+	{
+		/* The bit timing ioctlSET_SPEED used to set - a sample point of 70%,
+		with an SJW longer than phase segment 2. */
+		can_SetBaudrate( LPC_CAN2, benchBIT_RATE );
+	}
+
+	/* The part of TSEG1 not needed by phase segment 1, which the signal has
+	to cross the harness and back within. */
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_BIT_TIMING, &xTiming );
+	snprintf( cMetric, sizeof( cMetric ), "%s_propagation_time", pcPrefix );
+	prvReport( "bit_timing", cMetric, ( ( double ) ( xTiming.ucTSEG1 - xTiming.ucSJW ) * 1e9 ) / ( ( double ) xTiming.ulBitRate * ( double ) xTiming.ucTimeQuanta ), "ns", pdFALSE, 0.0, pdFALSE, 0.0 );
+
+	xBurstSequence.ulFramesToSend = benchHARNESS_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = benchHARNESS_PERIOD_US * simNS_PER_US;
+	xBurstSequence.ucLength = 8U;
+	xBurstSequence.pxEndTimes = NULL;
+
+	do
+	{
+		vSimRunFor( simNS_PER_MS );
+
+		do
+		{
+			xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+			ulReceived += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes != 0U );
+
+	} while( xBurstSequence.ulFramesSent < benchHARNESS_FRAMES );
+
+	vSimBusGetStatistics( 0, &xBusStatistics );
+
+	snprintf( cMetric, sizeof( cMetric ), "%s_frames_received", pcPrefix );
+	prvReport( "bit_timing", cMetric, ( double ) ulReceived, "frames", xUseDriverTiming, ( double ) benchHARNESS_FRAMES, pdFALSE, 0.0 );
+	snprintf( cMetric, sizeof( cMetric ), "%s_error_frames", pcPrefix );
+	prvReport( "bit_timing", cMetric, ( double ) xBusStatistics.ulErrorFrames, "", pdFALSE, 0.0, xUseDriverTiming, 0.0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvLogToSDCard( const char *pcTest, const char *pcFileName, portBASE_TYPE xTwoTasks )
+{
+CAN_Logger_Config_t xConfig;
+CAN_Logger_t *pxLogger;
+CAN_Logger_Statistics_t xStatistics;
+SimDiskStatistics_t xDiskStatistics;
+size_t xFramesLogged, xBlocksWritten;
+portBASE_TYPE xClosed;
+
+	prvResetTest( pdFALSE );
+	vSimBusSetBitRate( 0, benchLOG_BIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_SPEED, ( void * ) benchLOG_BIT_RATE );
+
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.xCAN = xCAN2;
+	xConfig.pcFileName = pcFileName;
+	xConfig.ulBitRate = benchLOG_BIT_RATE;
+	xConfig.ulFileBlocks = benchLOG_FILE_BLOCKS;
+	xConfig.usBufferBlocks = benchLOG_BUFFER_BLOCKS;
+	xConfig.usFlushIntervalMs = benchLOG_FLUSH_INTERVAL_MS;
+	pxLogger = pxCANLoggerCreate( &xConfig );
+	configASSERT( pxLogger );
+
+	/* Only the writes made while logging are of interest, not those that
+	extended the file. */
+	vSimDiskClearStatistics();
+	if( xTwoTasks != pdFALSE )
+	{
+		pxPreemptingLogger = pxLogger;
+		vSimDiskSetPreemptHook( prvRunCollector );
+	}
+
+	xBurstSequence.ulFramesToSend = benchLOG_FRAMES;
+	xBurstSequence.xFirstRelease = xSimGetTime();
+	xBurstSequence.xPeriod = 0ULL;
+	xBurstSequence.ucLength = 8U;
+
+	while( xBurstSequence.ulFramesSent < benchLOG_FRAMES )
+	{
+		xCANLoggerCollect( pxLogger );
+		xCANLoggerWrite( pxLogger, 0U );
+	}
+
+	/* Log the frames still in the Rx queue, and write every buffer that fills
+	while doing so. */
+	do
+	{
+		xFramesLogged = xCANLoggerCollect( pxLogger );
+		xBlocksWritten = xCANLoggerWrite( pxLogger, 0U );
+	} while( ( xFramesLogged + xBlocksWritten ) > 0U );
+
+	vSimDiskSetPreemptHook( NULL );
+	pxPreemptingLogger = NULL;
+
+	vCANLoggerGetStatistics( pxLogger, &xStatistics );
+	vSimDiskGetStatistics( &xDiskStatistics );
+	xClosed = xCANLoggerClose( pxLogger );
+
+	if( xTwoTasks != pdFALSE )
+	{
+		prvReport( pcTest, "frames_logged", ( double ) xStatistics.ulFramesLogged, "frames", pdTRUE, ( double ) benchLOG_FRAMES, pdTRUE, ( double ) benchLOG_FRAMES );
+		prvReport( pcTest, "frames_lost", ( double ) ( xStatistics.ulFramesLost + xStatistics.ulFramesDropped ), "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+	}
+	else
+	{
+		prvReport( pcTest, "frames_logged", ( double ) xStatistics.ulFramesLogged, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+		prvReport( pcTest, "frames_lost", ( double ) ( xStatistics.ulFramesLost + xStatistics.ulFramesDropped ), "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+	}
+
+	prvReport( pcTest, "buffers_written", ( double ) xStatistics.ulBuffersWritten, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "sectors_per_write_command", ( double ) xDiskStatistics.ulSectorsWritten / ( double ) xDiskStatistics.ulWriteCommands, "sectors", pdTRUE, ( double ) benchMIN_LOG_SECTORS_PER_WRITE, pdFALSE, 0.0 );
+	prvReport( pcTest, "card_stalls", ( double ) xDiskStatistics.ulStalls, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "longest_write", ( double ) ( xStatistics.xLongestWrite * portTICK_RATE_MS ), "ms", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "collector_stalls", ( double ) xStatistics.ulCollectorStalls, "", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "write_failures", ( double ) ( xStatistics.ulWriteFailures + ( ( xClosed != pdPASS ) ? 1UL : 0UL ) ), "", pdFALSE, 0.0, pdTRUE, 0.0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunCollector( void )
+{
+	/* A collector task would run whenever frames arrived, and block again as
+	soon as it had read them, so the writer would not wait for the collector's
+	Rx timeout to expire. */
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+	xCANLoggerCollect( pxPreemptingLogger );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) ( benchLOG_FLUSH_INTERVAL_MS / portTICK_RATE_MS ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReadBackLog( const char *pcFileName, uint32_t *pulFrames, uint32_t *pulSequenceErrors, FILE *pxCopy )
+{
+static uint8_t ucBlock[ canlogBLOCK_BYTES ];
+FIL xFile;
+UINT xBytesRead = 0U;
+uint32_t ulBlock, ulRecord, ulID, ulSession = 0UL, ulNextSequenceNumber = 0UL;
+const uint8_t *pucRecord;
+
+	*pulFrames = 0UL;
+	*pulSequenceErrors = 0UL;
+
+	if( f_open( &xFile, pcFileName, FA_OPEN_EXISTING | FA_READ ) == FR_OK )
+	{
+		for( ulBlock = 0UL; ( f_read( &xFile, ucBlock, sizeof( ucBlock ), &xBytesRead ) == FR_OK ) && ( xBytesRead == sizeof( ucBlock ) ); ulBlock++ )
+		{
+			if( pxCopy != NULL )
+			{
+				fwrite( ucBlock, 1, sizeof( ucBlock ), pxCopy );
+			}
+
+			/* The records are little endian, as is the host. */
+			if( ( ulBlock % canlogBLOCKS_PER_INDEX ) == 0UL )
+			{
+				if( ulBlock == 0UL )
+				{
+					memcpy( &ulSession, &( ucBlock[ canlogINDEX_SESSION_OFFSET ] ), sizeof( ulSession ) );
+				}
+			}
+			else
+			{
+				for( ulRecord = 0UL; ulRecord < canlogRECORDS_PER_BLOCK; ulRecord++ )
+				{
+					pucRecord = &( ucBlock[ ulRecord * canlogRECORD_BYTES ] );
+					memcpy( &ulID, &( pucRecord[ 4 ] ), sizeof( ulID ) );
+
+					if( ulRecord == 0UL )
+					{
+						/* Every data block must be numbered, and belong to
+						this log. */
+						if( ( ulID != ( canlogID_EVENT | canlogEVENT_BLOCK ) ) || ( memcmp( &( pucRecord[ 8 ] ), &ulBlock, sizeof( ulBlock ) ) != 0 ) || ( memcmp( &( pucRecord[ 12 ] ), &ulSession, sizeof( ulSession ) ) != 0 ) )
+						{
+							( *pulSequenceErrors )++;
+						}
+					}
+					else if( ( ulID & canlogID_EVENT ) == 0UL )
+					{
+						if( ( ulID != benchREMOTE_NODE_ID ) || ( memcmp( &( pucRecord[ 8 ] ), &ulNextSequenceNumber, sizeof( ulNextSequenceNumber ) ) != 0 ) )
+						{
+							( *pulSequenceErrors )++;
+						}
+						else
+						{
+							( *pulFrames )++;
+						}
+
+						ulNextSequenceNumber++;
+					}
+				}
+			}
+		}
+
+		f_close( &xFile );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvForwardToUDPPeer( const char *pcTest, CAN_UDP_Bridge_t *pxBridge, int iPeerSocket, BenchSequence_t *pxSequence, uint32_t ulFrames )
+{
+static CAN_MSG_Type xFrames[ canudpMAX_DATAGRAM_BYTES / canudpRECORD_HEADER_BYTES ];
+static uint8_t ucDatagram[ canudpMAX_DATAGRAM_BYTES ];
+CAN_UDP_Bridge_Statistics_t xStatistics;
+uint32_t ulReceived = 0UL, ulDatagrams = 0UL, ulBytes = 0UL, ulOrderErrors = 0UL, ulSequenceNumber, ulNextSequenceNumber = 0UL, ulTimestamp, ulHold, ulMaxHold = 0UL, ul;
+portBASE_TYPE xFirstDatagram = pdTRUE;
+size_t xFrameCount;
+ssize_t xBytes;
+SimTime_t xStart;
+
+	xStart = xSimGetTime();
+
+	while( ( ulReceived < ulFrames ) && ( ( xSimGetTime() - xStart ) < ( ( SimTime_t ) ulFrames * 10ULL * simNS_PER_MS ) ) )
+	{
+		xCANUDPBridgeForwardFromCAN( pxBridge );
+
+		/* The peer sees the datagram at once, so how long each frame was held
+		is the age of its timestamp. */
+		FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_TIMESTAMP, &ulTimestamp );
+
+		while( ( xBytes = recv( iPeerSocket, ucDatagram, sizeof( ucDatagram ), MSG_DONTWAIT ) ) > 0 )
+		{
+			xFrameCount = xCANUDPUnpackDatagram( ucDatagram, ( size_t ) xBytes, xFrames, sizeof( xFrames ) / sizeof( xFrames[ 0 ] ), &ulSequenceNumber );
+			configASSERT( xFrameCount > 0U );
+
+			if( ( xFirstDatagram == pdFALSE ) && ( ulSequenceNumber != ulNextSequenceNumber ) )
+			{
+				ulOrderErrors++;
+			}
+			xFirstDatagram = pdFALSE;
+			ulNextSequenceNumber = ulSequenceNumber + 1UL;
+
+			/* The remote node numbers its frames, and they all have the same
+			ID, so they arrive in order. */
+			for( ul = 0UL; ul < xFrameCount; ul++ )
+			{
+				if( xFrames[ ul ].dataAWord != ( ulReceived + ul ) )
+				{
+					ulOrderErrors++;
+				}
+
+				ulHold = ( ulTimestamp - xFrames[ ul ].timestamp ) * boardCAN_TIMESTAMP_RESOLUTION_US;
+				if( ulHold > ulMaxHold )
+				{
+					ulMaxHold = ulHold;
+				}
+			}
+
+			ulReceived += ( uint32_t ) xFrameCount;
+			ulDatagrams++;
+			ulBytes += ( uint32_t ) xBytes;
+		}
+	}
+
+	vCANUDPBridgeGetStatistics( pxBridge, &xStatistics );
+
+	prvReport( pcTest, "frames_received", ( double ) ulReceived, "frames", pdTRUE, ( double ) ulFrames, pdTRUE, ( double ) ulFrames );
+	prvReport( pcTest, "datagrams", ( double ) ulDatagrams, "datagrams", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "frames_per_datagram", ( ulDatagrams > 0UL ) ? ( double ) ulReceived / ( double ) ulDatagrams : 0.0, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "udp_payload_bytes_per_frame", ( ulReceived > 0UL ) ? ( double ) ulBytes / ( double ) ulReceived : 0.0, "bytes", pdFALSE, 0.0, pdFALSE, 0.0 );
+	prvReport( pcTest, "max_frame_hold", ( double ) ulMaxHold, "us", pdFALSE, 0.0, pdTRUE, benchMAX_UDP_HOLD_US );
+	prvReport( pcTest, "order_errors", ( double ) ulOrderErrors, "", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( pcTest, "datagrams_not_sent", ( double ) xStatistics.ulDatagramsNotSent, "datagrams", pdFALSE, 0.0, pdTRUE, 0.0 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunCyclicTraffic( const char *pcTest, const CAN_Cyclic_Tx_Message_t *pxMessages, portBASE_TYPE xWriteDueFrames, SimTime_t xStart )
+{
+static uint32_t ulLastPayloads[ benchCYCLIC_MESSAGES ];
+static uint16_t usFramesPerMs[ benchCYCLIC_RUN_MS + 20UL ];
+CAN_MSG_Type xFrame;
+CAN_ID_Analytics_t xAnalytics;
+CAN_Cyclic_Tx_Statistics_t xStatistics;
+uint32_t ulMs, ulTimestampAtStart, ulPeakFrames = 0UL, ulSequenceErrors = 0UL, ulWrongCounts = 0UL, ulJitter, ulWorstJitter = 0UL, ulSent = 0UL, ulMissed = 0UL;
+uint16_t usMessage, usPeakDue = 0U;
+SimTime_t xNow;
+
+	memset( ulLastPayloads, 0x00, sizeof( ulLastPayloads ) );
+	memset( usFramesPerMs, 0x00, sizeof( usFramesPerMs ) );
+
+	/* xStart is now, so the frames can be placed in the milliseconds of the
+	run by their timestamps. */
+	FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_TIMESTAMP, &ulTimestampAtStart );
+
+	for( ulMs = 0UL; ulMs < benchCYCLIC_RUN_MS; ulMs++ )
+	{
+		if( xWriteDueFrames != pdFALSE )
+		{
+			for( usMessage = 0U; usMessage < benchCYCLIC_MESSAGES; usMessage++ )
+			{
+				if( ( ulMs % pxMessages[ usMessage ].usPeriodMs ) == 0UL )
+				{
+					memset( &xFrame, 0x00, sizeof( xFrame ) );
+					xFrame.id = pxMessages[ usMessage ].ulID;
+					xFrame.len = pxMessages[ usMessage ].ucLength;
+					xFrame.format = pxMessages[ usMessage ].ucFormat;
+					xFrame.type = pxMessages[ usMessage ].ucType;
+					xFrame.dataAWord = pxMessages[ usMessage ].ulDataA;
+					xFrame.dataBWord = ( ulMs / pxMessages[ usMessage ].usPeriodMs ) + 1UL;
+					FreeRTOS_write( xCAN1, &xFrame, sizeof( xFrame ) );
+				}
+			}
+		}
+
+		xNow = xSimGetTime();
+		if( xNow < ( xStart + ( ( SimTime_t ) ( ulMs + 1UL ) * simNS_PER_MS ) ) )
+		{
+			vSimRunFor( ( xStart + ( ( SimTime_t ) ( ulMs + 1UL ) * simNS_PER_MS ) ) - xNow );
+		}
+
+		prvDrainCyclicFrames( ulTimestampAtStart, usFramesPerMs, ulLastPayloads, &ulSequenceErrors );
+	}
+
+	if( xWriteDueFrames == pdFALSE )
+	{
+		for( usMessage = 0U; usMessage < benchCYCLIC_MESSAGES; usMessage++ )
+		{
+			xStatistics.usIndex = usMessage;
+			if( FreeRTOS_ioctl( xCAN1, ioctlGET_CAN_CYCLIC_TX_STATISTICS, &xStatistics ) == pdPASS )
+			{
+				ulSent += xStatistics.ulFramesSent;
+				ulMissed += xStatistics.ulFramesMissed;
+				usPeakDue = xStatistics.usPeakFramesPerMs;
+			}
+		}
+
+		prvStopCyclicTx();
+	}
+
+	/* Let the frames still queued when the run ended arrive. */
+	vSimRunFor( 10ULL * simNS_PER_MS );
+	prvDrainCyclicFrames( ulTimestampAtStart, usFramesPerMs, ulLastPayloads, &ulSequenceErrors );
+
+	for( ulMs = 0UL; ulMs < ( sizeof( usFramesPerMs ) / sizeof( usFramesPerMs[ 0 ] ) ); ulMs++ )
+	{
+		if( usFramesPerMs[ ulMs ] > ulPeakFrames )
+		{
+			ulPeakFrames = usFramesPerMs[ ulMs ];
+		}
+	}
+
+	/* Every tracked ID is one of the messages. */
+	for( usMessage = 0U; usMessage < benchCYCLIC_MESSAGES; usMessage++ )
+	{
+		memset( &xAnalytics, 0x00, sizeof( xAnalytics ) );
+		xAnalytics.usIndex = usMessage;
+
+		if( FreeRTOS_ioctl( xCAN2, ioctlGET_CAN_ID_ANALYTICS, &xAnalytics ) != pdPASS )
+		{
+			ulWrongCounts++;
+		}
+		else
+		{
+			configASSERT( ( xAnalytics.ulID - benchCYCLIC_BASE_ID ) < benchCYCLIC_MESSAGES );
+
+			if( xAnalytics.ulFrames != ( benchCYCLIC_RUN_MS / pxMessages[ xAnalytics.ulID - benchCYCLIC_BASE_ID ].usPeriodMs ) )
+			{
+				ulWrongCounts++;
+			}
+
+			if( xAnalytics.ulFrames > 1UL )
+			{
+				ulJitter = ( xAnalytics.ulMaxInterval - xAnalytics.ulMinInterval ) * boardCAN_TIMESTAMP_RESOLUTION_US;
+				if( ulJitter > ulWorstJitter )
+				{
+					ulWorstJitter = ulJitter;
+				}
+			}
+		}
+	}
+
+	prvReport( pcTest, "peak_frames_per_ms", ( double ) ulPeakFrames, "frames", pdFALSE, 0.0, ( xWriteDueFrames == pdFALSE ), benchMAX_CYCLIC_PEAK_FRAMES );
+	prvReport( pcTest, "worst_period_jitter", ( double ) ulWorstJitter, "us", pdFALSE, 0.0, ( xWriteDueFrames == pdFALSE ), benchMAX_CYCLIC_JITTER_US );
+	prvReport( pcTest, "messages_with_wrong_frame_count", ( double ) ulWrongCounts, "messages", pdFALSE, 0.0, pdTRUE, 0.0 );
+	prvReport( pcTest, "payload_sequence_errors", ( double ) ulSequenceErrors, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+
+	if( xWriteDueFrames == pdFALSE )
+	{
+		prvReport( pcTest, "frames_sent", ( double ) ulSent, "frames", pdFALSE, 0.0, pdFALSE, 0.0 );
+		prvReport( pcTest, "frames_missed", ( double ) ulMissed, "frames", pdFALSE, 0.0, pdTRUE, 0.0 );
+		prvReport( pcTest, "peak_frames_due_per_ms", ( double ) usPeakDue, "frames", pdFALSE, 0.0, pdTRUE, benchMAX_CYCLIC_PEAK_FRAMES );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvDrainCyclicFrames( uint32_t ulTimestampAtStart, uint16_t *pusFramesPerMs, uint32_t *pulLastPayloads, uint32_t *pulSequenceErrors )
+{
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+uint32_t ul, ulMessage, ulMs;
+size_t xBytes;
+
+	do
+	{
+		xBytes = FreeRTOS_read( xCAN2, xFrames, sizeof( xFrames ) );
+
+		for( ul = 0UL; ul < ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) ); ul++ )
+		{
+			ulMessage = xFrames[ ul ].id - benchCYCLIC_BASE_ID;
+			configASSERT( ulMessage < benchCYCLIC_MESSAGES );
+
+			/* A message is never due again before its last frame has been
+			sent, so its frames arrive in order. */
+			if( xFrames[ ul ].dataBWord != ( pulLastPayloads[ ulMessage ] + 1UL ) )
+			{
+				( *pulSequenceErrors )++;
+			}
+			pulLastPayloads[ ulMessage ] = xFrames[ ul ].dataBWord;
+
+			ulMs = ( ( xFrames[ ul ].timestamp - ulTimestampAtStart ) * boardCAN_TIMESTAMP_RESOLUTION_US ) / 1000UL;
+			if( ulMs < ( benchCYCLIC_RUN_MS + 20UL ) )
+			{
+				( pusFramesPerMs[ ulMs ] )++;
+			}
+		}
+	} while( xBytes == sizeof( xFrames ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvStopCyclicTx( void )
+{
+CAN_Cyclic_Tx_Table_t xTable;
+
+	/* An empty table stops the scheduler. */
+	xTable.pxMessages = NULL;
+	xTable.usNumberOfMessages = 0U;
+	configASSERT( FreeRTOS_ioctl( xCAN1, ioctlSET_CAN_CYCLIC_TX_TABLE, &xTable ) == pdPASS );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCyclicPayload( uint32_t *pulDataA, uint32_t *pulDataB, void *pvContext )
+{
+	( void ) pulDataA;
+	( void ) pvContext;
+
+	( *pulDataB )++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDrainSubscribers( const Peripheral_Descriptor_t *pxSubscribers, uint32_t *pulFrames )
+{
+static CAN_MSG_Type xFrames[ benchRX_QUEUE_LENGTH ];
+Peripheral_Descriptor_t xReader;
+unsigned portBASE_TYPE ux;
+size_t xBytes;
+
+	for( ux = 0U; ux <= benchSUBSCRIBERS; ux++ )
+	{
+		xReader = ( ux < benchSUBSCRIBERS ) ? pxSubscribers[ ux ] : xCAN2;
+
+		do
+		{
+			xBytes = FreeRTOS_read( xReader, xFrames, sizeof( xFrames ) );
+			pulFrames[ ux ] += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		} while( xBytes == sizeof( xFrames ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvStreamFrames( uint32_t ulFrames, SimTime_t *pxElapsed )
+{
+static CAN_MSG_Type xTxFrames[ benchTX_BATCH ], xRxFrames[ benchRX_QUEUE_LENGTH ];
+uint32_t ulWritten = 0UL, ulReceived = 0UL, ul, ulBatch;
+uint64_t ullSequenceTotal = 0ULL, ullExpectedTotal;
+size_t xBytes, xFramesRead;
+SimTime_t xStart;
+
+	/* The writer may block while the Tx queue is full, the reader never
+	blocks. */
+	FreeRTOS_ioctl( xCAN1, ioctlSET_TX_TIMEOUT, ( void * ) 100UL );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_RX_TIMEOUT, ( void * ) 0UL );
+
+	xStart = xSimGetTime();
+
+	while( ulReceived < ulFrames )
+	{
+		if( ulWritten < ulFrames )
+		{
+			ulBatch = ulFrames - ulWritten;
+			if( ulBatch > benchTX_BATCH )
+			{
+				ulBatch = benchTX_BATCH;
+			}
+
+			/* Frames with the same ID are not guaranteed to be sent in order,
+			as the controller picks between its Tx buffers by ID alone, so
+			each frame carries its sequence number and its complement so
+			every frame can be accounted for. */
+			for( ul = 0UL; ul < ulBatch; ul++ )
+			{
+				memset( &( xTxFrames[ ul ] ), 0x00, sizeof( CAN_MSG_Type ) );
+				xTxFrames[ ul ].id = benchSTREAM_ID;
+				xTxFrames[ ul ].len = 8U;
+				xTxFrames[ ul ].format = STD_ID_FORMAT;
+				xTxFrames[ ul ].type = DATA_FRAME;
+				xTxFrames[ ul ].dataAWord = ulWritten + ul;
+				xTxFrames[ ul ].dataBWord = ~( ulWritten + ul );
+			}
+
+			xBytes = FreeRTOS_write( xCAN1, xTxFrames, ulBatch * sizeof( CAN_MSG_Type ) );
+			ulWritten += ( uint32_t ) ( xBytes / sizeof( CAN_MSG_Type ) );
+		}
+		else
+		{
+			/* Everything has been written, so just wait for it to arrive. */
+			vSimRunFor( 100ULL * simNS_PER_US );
+
+			if( ( xSimGetTime() - xStart ) > ( ( SimTime_t ) ulFrames * simNS_PER_MS ) )
+			{
+				/* Frames have been lost. */
+				break;
+			}
+		}
+
+		xBytes = FreeRTOS_read( xCAN2, xRxFrames, sizeof( xRxFrames ) );
+		xFramesRead = xBytes / sizeof( CAN_MSG_Type );
+
+		for( ul = 0UL; ul < xFramesRead; ul++ )
+		{
+			configASSERT( xRxFrames[ ul ].id == benchSTREAM_ID );
+			configASSERT( xRxFrames[ ul ].dataBWord == ~xRxFrames[ ul ].dataAWord );
+			ullSequenceTotal += xRxFrames[ ul ].dataAWord;
+		}
+
+		ulReceived += ( uint32_t ) xFramesRead;
+	}
+
+	*pxElapsed = xSimGetTime() - xStart;
+
+	/* A lost frame and a duplicated frame would only go unnoticed together if
+	they happened to have the same sequence number. */
+	ullExpectedTotal = ( ( uint64_t ) ulFrames * ( uint64_t ) ( ulFrames - 1UL ) ) / 2ULL;
+	if( ( ulReceived == ulFrames ) && ( ullSequenceTotal != ullExpectedTotal ) )
+	{
+		ulReceived = 0UL;
+	}
+
+	return ulReceived;
+}
+/*-----------------------------------------------------------*/
+
+static void prvResetTest( portBASE_TYPE xBothControllersOnBus )
+{
+AF_SectionDef xEmptyFilterTable;
+
+	/* Let anything still in progress finish, then discard it. */
+	vSimRunFor( 10ULL * simNS_PER_MS );
+
+	/* CAN1 only joins bus 0 for the tests in which it sends.  Otherwise it
+	would receive every frame from the remote nodes too, and its Rx buffer
+	would overrun. */
+	vSimAttachController( 0, ( xBothControllersOnBus != pdFALSE ) ? 0 : 1 );
+	vSimAttachController( 1, 0 );
+	vSimBusSetBitRate( 0, benchBIT_RATE );
+	vSimBusSetBitRate( 1, benchBIT_RATE );
+	vSimBusSetBitRate( 2, benchBIT_RATE );
+	vSimBusSetLoopDelay( 0, 0ULL );
+	vSimBusInjectErrors( 0, 0UL, 0UL );
+
+	/* Silence the remote nodes. */
+	memset( &xLatencySequence, 0x00, sizeof( xLatencySequence ) );
+	memset( &xBurstSequence, 0x00, sizeof( xBurstSequence ) );
+	xLatencySequence.ulID = benchREMOTE_NODE_ID;
+	xLatencySequence.ucFormat = STD_ID_FORMAT;
+	xBurstSequence.ulID = benchREMOTE_NODE_ID;
+	xBurstSequence.ucFormat = STD_ID_FORMAT;
+
+	FreeRTOS_ioctl( xCAN1, ioctlSET_SPEED, ( void * ) benchBIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_SPEED, ( void * ) benchBIT_RATE );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_RX_BUFFER, NULL );
+	FreeRTOS_ioctl( xCAN1, ioctlCLEAR_CAN_STATISTICS, NULL );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_CAN_STATISTICS, NULL );
+	FreeRTOS_ioctl( xCAN2, ioctlCLEAR_CAN_ANALYTICS, NULL );
+
+	/* Empty the acceptance filter table, then bypass it, so every ID is
+	received again. */
+	memset( &xEmptyFilterTable, 0x00, sizeof( xEmptyFilterTable ) );
+	FreeRTOS_ioctl( xCAN2, ioctlLOAD_CAN_FILTER_TABLE, &xEmptyFilterTable );
+	FreeRTOS_ioctl( xCAN2, ioctlSET_CONFIG_CANAF_MODE_BYPASS, ( void * ) 1UL );
+
+	vSimBusClearStatistics( 0 );
+	vSimBusClearStatistics( 1 );
+	vSimClearProfile();
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvNextSequenceFrame( void *pvContext, CAN_MSG_Type *pxFrame, SimTime_t *pxReleaseTime )
+{
+BenchSequence_t * const pxSequence = ( BenchSequence_t * ) pvContext;
+portBASE_TYPE xReturn = pdFALSE;
+
+	if( pxSequence->ulFramesQueued < pxSequence->ulFramesToSend )
+	{
+		memset( pxFrame, 0x00, sizeof( CAN_MSG_Type ) );
+		pxFrame->id = pxSequence->ulID;
+		pxFrame->len = pxSequence->ucLength;
+		pxFrame->format = pxSequence->ucFormat;
+
+		if( pxSequence->pxIDCycle != NULL )
+		{
+			pxFrame->id = pxSequence->pxIDCycle[ pxSequence->ulFramesQueued % pxSequence->ulIDCycleLength ].ulID;
+			pxFrame->format = pxSequence->pxIDCycle[ pxSequence->ulFramesQueued % pxSequence->ulIDCycleLength ].ucFormat;
+		}
+		pxFrame->type = DATA_FRAME;
+		pxFrame->dataAWord = pxSequence->ulFramesQueued;
+
+		if( pxSequence->ucDataBShift != 0U )
+		{
+			pxFrame->dataBWord = ~( pxSequence->ulFramesQueued >> pxSequence->ucDataBShift );
+		}
+
+		*pxReleaseTime = pxSequence->xFirstRelease + ( ( SimTime_t ) pxSequence->ulFramesQueued * pxSequence->xPeriod );
+		pxSequence->ulFramesQueued++;
+		xReturn = pdTRUE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSequenceFrameSent( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xStartOfFrame, SimTime_t xEndOfFrame )
+{
+BenchSequence_t * const pxSequence = ( BenchSequence_t * ) pvContext;
+
+	( void ) xStartOfFrame;
+
+	if( ( pxSequence->pxEndTimes != NULL ) && ( pxFrame->dataAWord < pxSequence->ulFramesToSend ) )
+	{
+		pxSequence->pxEndTimes[ pxFrame->dataAWord ] = xEndOfFrame;
+	}
+
+	pxSequence->ulFramesSent++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReport( const char *pcTest, const char *pcMetric, double dValue, const char *pcUnits, portBASE_TYPE xCheckMin, double dMin, portBASE_TYPE xCheckMax, double dMax )
+{
+const char *pcVerdict = "";
+
+	if( xChecking != pdFALSE )
+	{
+		if( ( ( xCheckMin != pdFALSE ) && ( dValue < dMin ) ) || ( ( xCheckMax != pdFALSE ) && ( dValue > dMax ) ) )
+		{
+			pcVerdict = "  FAIL";
+			xAllPassed = pdFALSE;
+		}
+		else if( ( xCheckMin != pdFALSE ) || ( xCheckMax != pdFALSE ) )
+		{
+			pcVerdict = "  ok";
+		}
+	}
+
+	printf( "  %-40s %14.3f %-9s%s\n", pcMetric, dValue, pcUnits, pcVerdict );
+
+	if( pxCSVFile != NULL )
+	{
+		fprintf( pxCSVFile, "%s,%s,%.6f,%s\n", pcTest, pcMetric, dValue, pcUnits );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,40 @@
+/*
+ * Host build wrapper around the CMSIS LPC17xx.h.
+ *
+ * The register layout, base addresses and NVIC functions all come from the
+ * real CMSIS header.  The peripheral address ranges that the CAN driver uses
+ * are mapped into the simulation process at the same addresses, so no pointer
+ * has to be redirected (see Simulator/SimRegisters.c).  Only the core
+ * instruction and core function intrinsics are replaced, as the CMSIS versions
+ * are Cortex-M3 inline assembler.
+ */
+
+#ifndef SIM_LPC17xx_H
+#define SIM_LPC17xx_H
+
+#include <stdint.h>
+
+/* Stop the CMSIS Cortex-M3 intrinsics from being included. */
+#define __CORE_CMINSTR_H__
+#define __CORE_CMFUNC_H__
+
+/* Defined by Simulator/SimKernel.c. */
+void vSimWaitForInterrupt( void );
+unsigned long ulPortSetInterruptMask( void );
+void vPortClearInterruptMask( unsigned long ulNewMaskValue );
+
+static inline void __NOP( void ) { }
+static inline void __WFI( void ) { vSimWaitForInterrupt(); }
+static inline void __WFE( void ) { vSimWaitForInterrupt(); }
+static inline void __SEV( void ) { }
+static inline void __ISB( void ) { __sync_synchronize(); }
+static inline void __DSB( void ) { __sync_synchronize(); }
+static inline void __DMB( void ) { __sync_synchronize(); }
+static inline uint32_t __REV( uint32_t ulValue ) { return __builtin_bswap32( ulValue ); }
+static inline uint8_t __CLZ( uint32_t ulValue ) { return ( ulValue == 0UL ) ? 32U : ( uint8_t ) __builtin_clz( ulValue ); }
+static inline void __enable_irq( void ) { vPortClearInterruptMask( 0UL ); }
+static inline void __disable_irq( void ) { ( void ) ulPortSetInterruptMask(); }
+
+#include_next <LPC17xx.h>
+
+#endif /* SIM_LPC17xx_H */
@@ -0,0 +1,723 @@
+/*
+ * Discrete event model of the CAN buses.
+ *
+ * Each bus carries one frame at a time.  When the bus is idle, every
+ * controller and remote node with a frame ready takes part in arbitration, the
+ * frame with the lowest arbitration field wins, and the bus stays busy for the
+ * exact length of that frame - stuff bits included - plus the intermission.
+ * Errors, whether injected or caused by a controller whose bit timing does not
+ * match the bus, destroy the frame with an error frame, update the error
+ * counters of every controller on the bus, and leave the transmitter to try
+ * again.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
+/* Simulation includes. */
+#include "SimInternal.h"
+
+/* The bits of a frame after the CRC, which are never stuffed - CRC
+delimiter, ACK slot, ACK delimiter and end of frame - and the intermission
+that must pass before the next frame can start. */
+#define simFRAME_TRAILER_BITS		( 10UL )
+#define simINTERMISSION_BITS		( 3UL )
+
+/* An error flag followed by the error delimiter. */
+#define simERROR_FRAME_BITS			( 14UL )
+
+/* A controller whose bit rate is further than this from the bus bit rate
+(in parts per thousand) cannot decode the bus. */
+#define simBIT_RATE_TOLERANCE		( 10UL )
+
+/* The position in the frame at which a controller with the wrong bit timing
+causes an error. */
+#define simMISMATCH_ERROR_BIT		( 6UL )
+
+#define simNO_TRANSMITTER			( -1 )
+
+typedef struct SIM_NODE
+{
+	unsigned portBASE_TYPE uxBus;
+	SimNodeConfig_t xConfig;
+	CAN_MSG_Type xFrames[ simNODE_QUEUE_LENGTH ];
+	SimTime_t xReleaseTimes[ simNODE_QUEUE_LENGTH ];
+	unsigned portBASE_TYPE uxHead;
+	unsigned portBASE_TYPE uxCount;
+} SimNode_t;
+
+typedef struct SIM_BUS
+{
+	uint32_t ulBitRate;
+	SimTime_t xBitTime;
+	SimTime_t xLoopDelay;
+	uint32_t ulErrorsPerMillion;
+	uint32_t ulRandom;
+
+	/* The time from which the bus is idle again. */
+	SimTime_t xIdleTime;
+
+	/* The frame on the bus, if any.  The transmitter is a controller number,
+	or a node number offset by simNUM_CONTROLLERS. */
+	portBASE_TYPE xFrameInProgress;
+	portBASE_TYPE xTransmitter;
+	uint32_t ulTxBuffer;
+	CAN_MSG_Type xFrame;
+	SimTime_t xStartTime;
+	SimTime_t xEndTime;
+	SimTxResult_t eResult;
+
+	SimBusStatistics_t xStatistics;
+} SimBus_t;
+
+static void prvRefillNode( SimNode_t *pxNode );
+static SimTime_t prvBusNextEventTime( unsigned portBASE_TYPE uxBus );
+static portBASE_TYPE prvArbitrate( unsigned portBASE_TYPE uxBus, SimTime_t xNow );
+static void prvStartFrame( unsigned portBASE_TYPE uxBus, SimTime_t xStart );
+static void prvEndFrame( unsigned portBASE_TYPE uxBus );
+static uint32_t prvArbitrationKey( const CAN_MSG_Type *pxFrame );
+static uint32_t prvFrameBits( const CAN_MSG_Type *pxFrame );
+static portBASE_TYPE prvControllerMatchesBus( unsigned portBASE_TYPE uxController, unsigned portBASE_TYPE uxBus );
+static uint32_t prvRandom( SimBus_t *pxBus );
+
+/*-----------------------------------------------------------*/
+
+static SimBus_t xBuses[ simMAX_BUSES ];
+static SimNode_t xNodes[ simMAX_NODES ];
+static unsigned portBASE_TYPE uxNodes = 0U;
+static unsigned portBASE_TYPE uxControllerBuses[ simNUM_CONTROLLERS ];
+
+/*-----------------------------------------------------------*/
+
+void vSimBusInit( void )
+{
+unsigned portBASE_TYPE ux;
+
+	memset( xBuses, 0x00, sizeof( xBuses ) );
+	memset( xNodes, 0x00, sizeof( xNodes ) );
+	uxNodes = 0U;
+
+	for( ux = 0U; ux < simMAX_BUSES; ux++ )
+	{
+		vSimBusSetBitRate( ux, boardDEFAULT_CAN_BAUD );
+		xBuses[ ux ].ulRandom = 1UL;
+	}
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		uxControllerBuses[ ux ] = 0U;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusSetBitRate( unsigned portBASE_TYPE uxBus, uint32_t ulBitRate )
+{
+	configASSERT( uxBus < simMAX_BUSES );
+	configASSERT( ulBitRate > 0UL );
+
+	xBuses[ uxBus ].ulBitRate = ulBitRate;
+	xBuses[ uxBus ].xBitTime = simNS_PER_SECOND / ( SimTime_t ) ulBitRate;
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusSetLoopDelay( unsigned portBASE_TYPE uxBus, SimTime_t xLoopDelay )
+{
+	configASSERT( uxBus < simMAX_BUSES );
+
+	xBuses[ uxBus ].xLoopDelay = xLoopDelay;
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusInjectErrors( unsigned portBASE_TYPE uxBus, uint32_t ulErrorsPerMillion, uint32_t ulSeed )
+{
+	configASSERT( uxBus < simMAX_BUSES );
+
+	xBuses[ uxBus ].ulErrorsPerMillion = ulErrorsPerMillion;
+	xBuses[ uxBus ].ulRandom = ( ulSeed != 0UL ) ? ulSeed : 1UL;
+}
+/*-----------------------------------------------------------*/
+
+void vSimAttachController( unsigned portBASE_TYPE uxController, unsigned portBASE_TYPE uxBus )
+{
+	configASSERT( uxController < simNUM_CONTROLLERS );
+	configASSERT( uxBus < simMAX_BUSES );
+
+	uxControllerBuses[ uxController ] = uxBus;
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusGetStatistics( unsigned portBASE_TYPE uxBus, SimBusStatistics_t *pxStatistics )
+{
+	configASSERT( uxBus < simMAX_BUSES );
+	*pxStatistics = xBuses[ uxBus ].xStatistics;
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusClearStatistics( unsigned portBASE_TYPE uxBus )
+{
+	configASSERT( uxBus < simMAX_BUSES );
+	memset( &( xBuses[ uxBus ].xStatistics ), 0x00, sizeof( SimBusStatistics_t ) );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimNodeCreate( unsigned portBASE_TYPE uxBus, const SimNodeConfig_t *pxConfig )
+{
+portBASE_TYPE xReturn = -1;
+
+	configASSERT( uxBus < simMAX_BUSES );
+
+	if( uxNodes < simMAX_NODES )
+	{
+		xNodes[ uxNodes ].uxBus = uxBus;
+		xNodes[ uxNodes ].xConfig = *pxConfig;
+		xReturn = ( portBASE_TYPE ) uxNodes;
+		uxNodes++;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimNodeSend( portBASE_TYPE xNode, const CAN_MSG_Type *pxFrame, SimTime_t xReleaseTime )
+{
+SimNode_t *pxNode;
+unsigned portBASE_TYPE uxTail;
+portBASE_TYPE xReturn = pdFAIL;
+
+	configASSERT( ( xNode >= 0 ) && ( xNode < ( portBASE_TYPE ) uxNodes ) );
+	pxNode = &( xNodes[ xNode ] );
+
+	if( pxNode->uxCount < simNODE_QUEUE_LENGTH )
+	{
+		uxTail = ( pxNode->uxHead + pxNode->uxCount ) % simNODE_QUEUE_LENGTH;
+		pxNode->xFrames[ uxTail ] = *pxFrame;
+		pxNode->xReleaseTimes[ uxTail ] = xReleaseTime;
+		pxNode->uxCount++;
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+unsigned portBASE_TYPE uxSimControllerBus( unsigned portBASE_TYPE uxController )
+{
+	return uxControllerBuses[ uxController ];
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimBusBitTime( unsigned portBASE_TYPE uxBus )
+{
+	return xBuses[ uxBus ].xBitTime;
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimBusNextEventTime( void )
+{
+SimTime_t xNext = simTIME_NEVER, xEvent;
+unsigned portBASE_TYPE ux;
+
+	for( ux = 0U; ux < simMAX_BUSES; ux++ )
+	{
+		xEvent = prvBusNextEventTime( ux );
+
+		if( xEvent < xNext )
+		{
+			xNext = xEvent;
+		}
+	}
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		xEvent = xSimControllerRecoveryTime( ux );
+
+		if( xEvent < xNext )
+		{
+			xNext = xEvent;
+		}
+	}
+
+	return xNext;
+}
+/*-----------------------------------------------------------*/
+
+void vSimBusProcessEvents( SimTime_t xNow )
+{
+unsigned portBASE_TYPE ux;
+SimBus_t *pxBus;
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		if( xSimControllerRecoveryTime( ux ) <= xNow )
+		{
+			vSimControllerRecover( ux );
+		}
+	}
+
+	for( ux = 0U; ux < simMAX_BUSES; ux++ )
+	{
+		pxBus = &( xBuses[ ux ] );
+
+		/* Events are handled at the time they fall due, not at xNow, so the
+		bus timing does not depend on how often it is processed. */
+		while( prvBusNextEventTime( ux ) <= xNow )
+		{
+			if( pxBus->xFrameInProgress != pdFALSE )
+			{
+				prvEndFrame( ux );
+			}
+			else if( prvArbitrate( ux, xNow ) == pdFALSE )
+			{
+				break;
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRefillNode( SimNode_t *pxNode )
+{
+CAN_MSG_Type xFrame;
+SimTime_t xReleaseTime = 0ULL;
+
+	if( ( pxNode->uxCount == 0U ) && ( pxNode->xConfig.pxNextFrame != NULL ) )
+	{
+		if( pxNode->xConfig.pxNextFrame( pxNode->xConfig.pvContext, &xFrame, &xReleaseTime ) != pdFALSE )
+		{
+			xSimNodeSend( ( portBASE_TYPE ) ( pxNode - xNodes ), &xFrame, xReleaseTime );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static SimTime_t prvBusNextEventTime( unsigned portBASE_TYPE uxBus )
+{
+SimBus_t * const pxBus = &( xBuses[ uxBus ] );
+SimTime_t xNext = simTIME_NEVER, xReady;
+unsigned portBASE_TYPE ux;
+SimNode_t *pxNode;
+CAN_MSG_Type xFrame;
+uint32_t ulBuffer;
+
+	if( pxBus->xFrameInProgress != pdFALSE )
+	{
+		xNext = pxBus->xEndTime;
+	}
+	else
+	{
+		/* The earliest time at which any frame is ready, but never before
+		the end of the last intermission. */
+		for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+		{
+			if( ( uxControllerBuses[ ux ] == uxBus ) && ( xSimControllerGetTxFrame( ux, &xFrame, &ulBuffer, &xReady ) != pdFALSE ) && ( xReady < xNext ) )
+			{
+				xNext = xReady;
+			}
+		}
+
+		for( ux = 0U; ux < uxNodes; ux++ )
+		{
+			pxNode = &( xNodes[ ux ] );
+
+			if( pxNode->uxBus == uxBus )
+			{
+				prvRefillNode( pxNode );
+
+				if( ( pxNode->uxCount > 0U ) && ( pxNode->xReleaseTimes[ pxNode->uxHead ] < xNext ) )
+				{
+					xNext = pxNode->xReleaseTimes[ pxNode->uxHead ];
+				}
+			}
+		}
+
+		if( ( xNext != simTIME_NEVER ) && ( xNext < pxBus->xIdleTime ) )
+		{
+			xNext = pxBus->xIdleTime;
+		}
+	}
+
+	return xNext;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvArbitrate( unsigned portBASE_TYPE uxBus, SimTime_t xNow )
+{
+SimBus_t * const pxBus = &( xBuses[ uxBus ] );
+SimTime_t xStart, xReady;
+portBASE_TYPE xWinner = simNO_TRANSMITTER, xReturn = pdFALSE;
+uint32_t ulKey, ulWinningKey = 0UL, ulBuffer, ulWinningBuffer = 0UL;
+uint32_t ulKeys[ simNUM_CONTROLLERS ], ulBuffers[ simNUM_CONTROLLERS ];
+portBASE_TYPE xCompeting[ simNUM_CONTROLLERS ];
+unsigned portBASE_TYPE ux;
+CAN_MSG_Type xFrame, xWinningFrame;
+SimNode_t *pxNode;
+
+	xStart = prvBusNextEventTime( uxBus );
+
+	if( xStart <= xNow )
+	{
+		/* Every transmitter that is ready by the start of arbitration takes
+		part.  The lowest arbitration field wins, as a dominant bit is 0. */
+		for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+		{
+			xCompeting[ ux ] = pdFALSE;
+
+			if( ( uxControllerBuses[ ux ] == uxBus ) && ( xSimControllerGetTxFrame( ux, &xFrame, &ulBuffer, &xReady ) != pdFALSE ) && ( xReady <= xStart ) )
+			{
+				ulKey = prvArbitrationKey( &xFrame );
+				xCompeting[ ux ] = pdTRUE;
+				ulKeys[ ux ] = ulKey;
+				ulBuffers[ ux ] = ulBuffer;
+
+				if( ( xWinner == simNO_TRANSMITTER ) || ( ulKey < ulWinningKey ) )
+				{
+					xWinner = ( portBASE_TYPE ) ux;
+					ulWinningKey = ulKey;
+					ulWinningBuffer = ulBuffer;
+					xWinningFrame = xFrame;
+				}
+			}
+		}
+
+		for( ux = 0U; ux < uxNodes; ux++ )
+		{
+			pxNode = &( xNodes[ ux ] );
+
+			if( ( pxNode->uxBus == uxBus ) && ( pxNode->uxCount > 0U ) && ( pxNode->xReleaseTimes[ pxNode->uxHead ] <= xStart ) )
+			{
+				ulKey = prvArbitrationKey( &( pxNode->xFrames[ pxNode->uxHead ] ) );
+
+				if( ( xWinner == simNO_TRANSMITTER ) || ( ulKey < ulWinningKey ) )
+				{
+					xWinner = ( portBASE_TYPE ) ( simNUM_CONTROLLERS + ux );
+					ulWinningKey = ulKey;
+					xWinningFrame = pxNode->xFrames[ pxNode->uxHead ];
+				}
+			}
+		}
+
+		if( xWinner != simNO_TRANSMITTER )
+		{
+			/* Controllers that lost are told at which bit they lost, and try
+			again once the bus is next idle. */
+			for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+			{
+				if( ( xCompeting[ ux ] != pdFALSE ) && ( ( portBASE_TYPE ) ux != xWinner ) )
+				{
+					pxBus->xStatistics.ulArbitrationLosses++;
+					vSimControllerTxDone( ux, ulBuffers[ ux ], eSimTxArbitrationLost, ( ulKeys[ ux ] == ulWinningKey ) ? 31UL : ( uint32_t ) __builtin_clz( ulKeys[ ux ] ^ ulWinningKey ) );
+				}
+			}
+
+			pxBus->xTransmitter = xWinner;
+			pxBus->ulTxBuffer = ulWinningBuffer;
+			pxBus->xFrame = xWinningFrame;
+			prvStartFrame( uxBus, xStart );
+			xReturn = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartFrame( unsigned portBASE_TYPE uxBus, SimTime_t xStart )
+{
+SimBus_t * const pxBus = &( xBuses[ uxBus ] );
+const portBASE_TYPE xControllerSends = ( pxBus->xTransmitter < simNUM_CONTROLLERS );
+uint32_t ulBits = prvFrameBits( &( pxBus->xFrame ) );
+uint32_t ulErrorBit = 0UL;
+portBASE_TYPE xAcknowledged = pdFALSE;
+unsigned portBASE_TYPE ux;
+
+	pxBus->xFrameInProgress = pdTRUE;
+	pxBus->xStartTime = xStart;
+	pxBus->eResult = eSimTxSuccess;
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		if( ( uxControllerBuses[ ux ] == uxBus ) && ( xSimControllerIsActive( ux ) != pdFALSE ) )
+		{
+			if( ( xControllerSends != pdFALSE ) && ( ( portBASE_TYPE ) ux == pxBus->xTransmitter ) )
+			{
+				vSimControllerFrameStarted( ux, pdTRUE, pxBus->ulTxBuffer );
+
+				if( prvControllerMatchesBus( ux, uxBus ) == pdFALSE )
+				{
+					ulErrorBit = simMISMATCH_ERROR_BIT;
+				}
+
+				/* A controller in self test mode needs no acknowledgement. */
+				if( xSimControllerIsSelfTest( ux ) != pdFALSE )
+				{
+					xAcknowledged = pdTRUE;
+				}
+			}
+			else
+			{
+				vSimControllerFrameStarted( ux, pdFALSE, 0UL );
+
+				if( prvControllerMatchesBus( ux, uxBus ) == pdFALSE )
+				{
+					/* A receiver that cannot decode the bus sends an error
+					flag, unless its error flags are passive. */
+					if( ( xSimControllerAcknowledges( ux ) != pdFALSE ) && ( xSimControllerIsErrorPassive( ux ) == pdFALSE ) )
+					{
+						ulErrorBit = simMISMATCH_ERROR_BIT;
+					}
+				}
+				else if( xSimControllerAcknowledges( ux ) != pdFALSE )
+				{
+					xAcknowledged = pdTRUE;
+				}
+			}
+		}
+	}
+
+	for( ux = 0U; ux < uxNodes; ux++ )
+	{
+		if( ( xNodes[ ux ].uxBus == uxBus ) && ( ( portBASE_TYPE ) ( simNUM_CONTROLLERS + ux ) != pxBus->xTransmitter ) && ( xNodes[ ux ].xConfig.xAcknowledge != pdFALSE ) )
+		{
+			xAcknowledged = pdTRUE;
+		}
+	}
+
+	if( ( ulErrorBit == 0UL ) && ( pxBus->ulErrorsPerMillion > 0UL ) && ( ( prvRandom( pxBus ) % 1000000UL ) < pxBus->ulErrorsPerMillion ) )
+	{
+		/* The error can hit any bit before the end of frame. */
+		ulErrorBit = 1UL + ( prvRandom( pxBus ) % ( ulBits - 8UL ) );
+	}
+
+	if( ulErrorBit != 0UL )
+	{
+		pxBus->eResult = eSimTxBusError;
+		ulBits = ulErrorBit + simERROR_FRAME_BITS;
+	}
+	else if( xAcknowledged == pdFALSE )
+	{
+		/* The transmitter sends an error flag after the ACK slot. */
+		pxBus->eResult = eSimTxAckError;
+		ulBits = ( ulBits - 8UL ) + simERROR_FRAME_BITS;
+	}
+
+	pxBus->xEndTime = xStart + ( ( SimTime_t ) ulBits * pxBus->xBitTime );
+	pxBus->xIdleTime = pxBus->xEndTime + ( ( SimTime_t ) simINTERMISSION_BITS * pxBus->xBitTime );
+	pxBus->xStatistics.ullBits += ulBits;
+	pxBus->xStatistics.xBusyTime += pxBus->xIdleTime - xStart;
+}
+/*-----------------------------------------------------------*/
+
+static void prvEndFrame( unsigned portBASE_TYPE uxBus )
+{
+SimBus_t * const pxBus = &( xBuses[ uxBus ] );
+const CAN_MSG_Type * const pxFrame = &( pxBus->xFrame );
+const portBASE_TYPE xControllerSends = ( pxBus->xTransmitter < simNUM_CONTROLLERS );
+SimNode_t *pxNode = NULL;
+unsigned portBASE_TYPE ux;
+
+	pxBus->xFrameInProgress = pdFALSE;
+
+	if( xControllerSends == pdFALSE )
+	{
+		pxNode = &( xNodes[ pxBus->xTransmitter - simNUM_CONTROLLERS ] );
+	}
+	else if( ( pxBus->eResult == eSimTxSuccess ) && ( xSimControllerIsActive( ( unsigned portBASE_TYPE ) pxBus->xTransmitter ) == pdFALSE ) )
+	{
+		/* The transmitter entered reset mode part way through the frame. */
+		pxBus->eResult = eSimTxBusError;
+	}
+
+	if( pxBus->eResult == eSimTxSuccess )
+	{
+		pxBus->xStatistics.ulFrames++;
+	}
+	else
+	{
+		pxBus->xStatistics.ulErrorFrames++;
+	}
+
+	/* Receivers. */
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		if( ( uxControllerBuses[ ux ] == uxBus ) && ( xSimControllerIsActive( ux ) != pdFALSE ) && ( ( xControllerSends == pdFALSE ) || ( ( portBASE_TYPE ) ux != pxBus->xTransmitter ) ) )
+		{
+			if( ( pxBus->eResult == eSimTxSuccess ) && ( prvControllerMatchesBus( ux, uxBus ) != pdFALSE ) )
+			{
+				vSimControllerRxDone( ux, pxFrame );
+			}
+			else
+			{
+				vSimControllerRxError( ux, ( pxBus->eResult == eSimTxAckError ) ? simERRC_FORM_ERROR : simERRC_STUFF_ERROR );
+			}
+		}
+	}
+
+	for( ux = 0U; ux < uxNodes; ux++ )
+	{
+		if( ( xNodes[ ux ].uxBus == uxBus ) && ( &( xNodes[ ux ] ) != pxNode ) && ( pxBus->eResult == eSimTxSuccess ) && ( xNodes[ ux ].xConfig.pxFrameReceived != NULL ) )
+		{
+			xNodes[ ux ].xConfig.pxFrameReceived( xNodes[ ux ].xConfig.pvContext, pxFrame, pxBus->xEndTime );
+		}
+	}
+
+	/* The transmitter. */
+	if( xControllerSends != pdFALSE )
+	{
+		ux = ( unsigned portBASE_TYPE ) pxBus->xTransmitter;
+
+		if( ( pxBus->eResult == eSimTxSuccess ) && ( xSimControllerWantsSelfReception( ux, pxBus->ulTxBuffer ) != pdFALSE ) )
+		{
+			vSimControllerRxDone( ux, pxFrame );
+		}
+
+		vSimControllerTxDone( ux, pxBus->ulTxBuffer, pxBus->eResult, ( pxBus->eResult == eSimTxAckError ) ? simERRC_OTHER_ERROR : simERRC_BIT_ERROR );
+	}
+	else if( pxBus->eResult == eSimTxSuccess )
+	{
+		pxNode->uxHead = ( pxNode->uxHead + 1U ) % simNODE_QUEUE_LENGTH;
+		pxNode->uxCount--;
+
+		if( pxNode->xConfig.pxFrameSent != NULL )
+		{
+			pxNode->xConfig.pxFrameSent( pxNode->xConfig.pvContext, pxFrame, pxBus->xStartTime, pxBus->xEndTime );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvArbitrationKey( const CAN_MSG_Type *pxFrame )
+{
+const uint32_t ulRTR = ( pxFrame->type == REMOTE_FRAME ) ? 1UL : 0UL;
+uint32_t ulKey;
+
+	/* The arbitration field as it is sent, most significant bit first.  In a
+	standard frame the RTR bit follows the identifier, then the dominant IDE
+	bit.  In an extended frame the recessive SRR and IDE bits follow the base
+	identifier, then the identifier extension and the RTR bit. */
+	if( pxFrame->format == EXT_ID_FORMAT )
+	{
+		ulKey = ( ( ( pxFrame->id >> 18UL ) & 0x7FFUL ) << 21UL ) | ( 1UL << 20UL ) | ( 1UL << 19UL ) | ( ( pxFrame->id & 0x3FFFFUL ) << 1UL ) | ulRTR;
+	}
+	else
+	{
+		ulKey = ( ( pxFrame->id & 0x7FFUL ) << 21UL ) | ( ulRTR << 20UL );
+	}
+
+	return ulKey;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvFrameBits( const CAN_MSG_Type *pxFrame )
+{
+uint8_t ucBits[ 160 ];
+uint32_t ulCount = 0UL, ulBit, ulByte, ulDataBytes, ulStuffBits = 0UL, ulRun = 0UL;
+uint16_t usCRC = 0U;
+uint8_t ucLast = 2U, ucNext;
+
+	#define prvADD_BITS( ulValue, ulWidth )												\
+	{																					\
+		for( ulBit = ( ulWidth ); ulBit > 0UL; ulBit-- )								\
+		{																				\
+			ucBits[ ulCount++ ] = ( uint8_t ) ( ( ( ulValue ) >> ( ulBit - 1UL ) ) & 0x01UL );	\
+		}																				\
+	}
+
+	/* Start of frame, arbitration and control fields. */
+	prvADD_BITS( 0UL, 1UL );
+
+	if( pxFrame->format == EXT_ID_FORMAT )
+	{
+		prvADD_BITS( pxFrame->id >> 18UL, 11UL );
+		prvADD_BITS( 0x03UL, 2UL );
+		prvADD_BITS( pxFrame->id, 18UL );
+		prvADD_BITS( ( pxFrame->type == REMOTE_FRAME ) ? 1UL : 0UL, 1UL );
+		prvADD_BITS( 0UL, 2UL );
+	}
+	else
+	{
+		prvADD_BITS( pxFrame->id, 11UL );
+		prvADD_BITS( ( pxFrame->type == REMOTE_FRAME ) ? 1UL : 0UL, 1UL );
+		prvADD_BITS( 0UL, 2UL );
+	}
+
+	prvADD_BITS( pxFrame->len, 4UL );
+
+	/* Data field. */
+	ulDataBytes = ( pxFrame->type == REMOTE_FRAME ) ? 0UL : ( ( pxFrame->len > 8U ) ? 8UL : pxFrame->len );
+
+	for( ulByte = 0UL; ulByte < ulDataBytes; ulByte++ )
+	{
+		prvADD_BITS( ( ulByte < 4UL ) ? pxFrame->dataA[ ulByte ] : pxFrame->dataB[ ulByte - 4UL ], 8UL );
+	}
+
+	/* CRC-15 over everything so far. */
+	for( ulByte = 0UL; ulByte < ulCount; ulByte++ )
+	{
+		ucNext = ucBits[ ulByte ] ^ ( uint8_t ) ( ( usCRC >> 14U ) & 0x01U );
+		usCRC = ( uint16_t ) ( ( usCRC << 1U ) & 0x7FFFU );
+
+		if( ucNext != 0U )
+		{
+			usCRC ^= 0x4599U;
+		}
+	}
+
+	prvADD_BITS( ( uint32_t ) usCRC, 15UL );
+
+	#undef prvADD_BITS
+
+	/* A stuff bit follows every five bits of the same value, and counts
+	towards the next run. */
+	for( ulByte = 0UL; ulByte < ulCount; ulByte++ )
+	{
+		if( ucBits[ ulByte ] == ucLast )
+		{
+			ulRun++;
+		}
+		else
+		{
+			ucLast = ucBits[ ulByte ];
+			ulRun = 1UL;
+		}
+
+		if( ulRun == 5UL )
+		{
+			ulStuffBits++;
+			ucLast ^= 0x01U;
+			ulRun = 1UL;
+		}
+	}
+
+	return ulCount + ulStuffBits + simFRAME_TRAILER_BITS;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvControllerMatchesBus( unsigned portBASE_TYPE uxController, unsigned portBASE_TYPE uxBus )
+{
+const uint32_t ulBusRate = xBuses[ uxBus ].ulBitRate;
+const uint32_t ulRate = ulSimControllerBitRate( uxController );
+const uint32_t ulDifference = ( ulRate > ulBusRate ) ? ( ulRate - ulBusRate ) : ( ulBusRate - ulRate );
+
+	/* A controller that samples a bit before the bits sent by the furthest
+	node have arrived loses arbitration and acknowledgements, and sees bit
+	errors, as if its bit rate were wrong. */
+	return ( ( ( ( uint64_t ) ulDifference * 1000ULL ) <= ( ( uint64_t ) ulBusRate * simBIT_RATE_TOLERANCE ) ) &&
+			 ( xSimControllerPropagationTime( uxController ) >= xBuses[ uxBus ].xLoopDelay ) );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvRandom( SimBus_t *pxBus )
+{
+	/* xorshift32, so every run with the same seed sees the same errors. */
+	pxBus->ulRandom ^= pxBus->ulRandom << 13UL;
+	pxBus->ulRandom ^= pxBus->ulRandom >> 17UL;
+	pxBus->ulRandom ^= pxBus->ulRandom << 5UL;
+
+	return pxBus->ulRandom;
+}
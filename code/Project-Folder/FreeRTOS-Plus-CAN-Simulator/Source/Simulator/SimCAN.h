@@ -0,0 +1,139 @@
+/*
+ * Host simulation of the LPC17xx CAN controllers.
+ *
+ * The unmodified FreeRTOS+IO CAN driver and NXP CAN library run against an
+ * emulated register model of LPC_CAN1, LPC_CAN2, LPC_CANAF, LPC_CANAF_RAM,
+ * LPC_CANCR and the NVIC.  The controllers are attached to in-process virtual
+ * buses, together with any number of simulated remote nodes, and the CAN
+ * interrupt is raised by the model exactly as the hardware would raise it.
+ *
+ * Time is simulated.  It advances when a kernel function blocks, when the
+ * application calls vSimRunFor() or vSimRunUntil(), and by a fixed cost for
+ * every register access made by the driver, so a task that polls a status
+ * register still sees the bus make progress.  Frame timing is bit accurate,
+ * including stuff bits and intermission, so bus load, throughput, latency and
+ * frame loss measured by the simulation are those of the real bus.  The time
+ * taken by driver code other than register accesses is not modelled.
+ */
+
+#ifndef SIM_CAN_H
+#define SIM_CAN_H
+
+#include "FreeRTOS.h"
+#include "lpc17xx_can.h"
+
+/* Simulated time, in nanoseconds. */
+typedef uint64_t SimTime_t;
+
+#define simNS_PER_US				( ( SimTime_t ) 1000ULL )
+#define simNS_PER_MS				( ( SimTime_t ) 1000000ULL )
+#define simNS_PER_SECOND			( ( SimTime_t ) 1000000000ULL )
+#define simTIME_NEVER				( ( SimTime_t ) UINT64_MAX )
+
+/* The dimensions of the simulation. */
+#define simNUM_CONTROLLERS			2	/* CAN1 and CAN2. */
+#define simMAX_BUSES				3
+#define simMAX_NODES				8	/* Simulated remote nodes, across all buses. */
+#define simNODE_QUEUE_LENGTH		64	/* Frames each remote node can hold. */
+
+/* A simulated remote node.  Every callback is optional.  The callbacks are
+called from within the bus model, so must not call the FreeRTOS+IO API. */
+typedef struct SIM_NODE_CONFIG
+{
+	/* Whether the node acknowledges frames.  A frame that no node
+	acknowledges is retransmitted until the transmitter goes error passive. */
+	portBASE_TYPE xAcknowledge;
+
+	/* Called when the node has no frame waiting to be sent.  Returns pdTRUE
+	after writing the next frame to pxFrame, and the time before which it must
+	not be sent to pxReleaseTime, or pdFALSE if there is nothing to send. */
+	portBASE_TYPE ( *pxNextFrame )( void *pvContext, CAN_MSG_Type *pxFrame, SimTime_t *pxReleaseTime );
+
+	/* Called at the end of every frame sent without error by another node or
+	controller on the same bus. */
+	void ( *pxFrameReceived )( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xEndOfFrame );
+
+	/* Called at the end of every frame the node itself sends without error.
+	xStartOfFrame is when the frame won arbitration. */
+	void ( *pxFrameSent )( void *pvContext, const CAN_MSG_Type *pxFrame, SimTime_t xStartOfFrame, SimTime_t xEndOfFrame );
+
+	void *pvContext;
+} SimNodeConfig_t;
+
+/* Bus level counters, returned by vSimBusGetStatistics(). */
+typedef struct SIM_BUS_STATISTICS
+{
+	uint32_t ulFrames;				/* Frames sent without error. */
+	uint32_t ulErrorFrames;			/* Transmissions destroyed by an error frame. */
+	uint32_t ulArbitrationLosses;	/* Transmitters that lost arbitration. */
+	uint64_t ullBits;				/* Bits sent on the bus, including error frames and stuff bits. */
+	SimTime_t xBusyTime;			/* Time the bus was not idle. */
+} SimBusStatistics_t;
+
+/* The cost of running the driver, returned by vSimGetProfile(). */
+typedef struct SIM_PROFILE
+{
+	uint32_t ulRegisterAccesses;	/* Register accesses, from tasks and interrupts. */
+	uint32_t ulInterruptAccesses;	/* The register accesses made from the CAN interrupt. */
+	uint32_t ulInterrupts;			/* Times the CAN interrupt was entered. */
+	SimTime_t xTimeInInterrupts;	/* Simulated time spent in the CAN interrupt. */
+} SimProfile_t;
+
+/*
+ * Map the peripheral registers, attach both controllers to bus 0, and set every
+ * bus to boardDEFAULT_CAN_BAUD with no remote nodes.  Must be called before any
+ * other function, including FreeRTOS_open().
+ */
+void vSimInit( void );
+
+/*
+ * The current simulated time, and functions that let it pass, taking any CAN
+ * interrupts and running any software timers that fall due.
+ */
+SimTime_t xSimGetTime( void );
+void vSimRunFor( SimTime_t xDuration );
+void vSimRunUntil( SimTime_t xTime );
+
+/*
+ * Set the cost of a single register access, which is 40ns by default (four
+ * 100MHz CPU clocks, the typical cost of an APB access on the LPC17xx).
+ */
+void vSimSetRegisterAccessTime( SimTime_t xAccessTime );
+
+/*
+ * Bus configuration.  A controller whose bit timing does not give the bus bit
+ * rate to within 1% sees only errors on that bus.  So does a controller whose
+ * bit timing samples each bit before a signal has had time to travel to the
+ * furthest node and back - the loop delay of the bus, which is 0 until set,
+ * and is twice the delay of the cable plus that of two transceivers.  Errors
+ * are injected into ulErrorsPerMillion frames in every million, chosen by a
+ * pseudo random sequence started from ulSeed so every run is the same.
+ */
+void vSimBusSetBitRate( unsigned portBASE_TYPE uxBus, uint32_t ulBitRate );
+void vSimBusSetLoopDelay( unsigned portBASE_TYPE uxBus, SimTime_t xLoopDelay );
+void vSimBusInjectErrors( unsigned portBASE_TYPE uxBus, uint32_t ulErrorsPerMillion, uint32_t ulSeed );
+void vSimAttachController( unsigned portBASE_TYPE uxController, unsigned portBASE_TYPE uxBus );
+void vSimBusGetStatistics( unsigned portBASE_TYPE uxBus, SimBusStatistics_t *pxStatistics );
+void vSimBusClearStatistics( unsigned portBASE_TYPE uxBus );
+
+/*
+ * Add a remote node to uxBus.  Returns the node's number, or -1 if
+ * simMAX_NODES nodes already exist.
+ */
+portBASE_TYPE xSimNodeCreate( unsigned portBASE_TYPE uxBus, const SimNodeConfig_t *pxConfig );
+
+/*
+ * Queue pxFrame to be sent by node xNode once xReleaseTime has been reached.
+ * Frames are sent in the order they are queued.  Returns pdFAIL if the node's
+ * queue is full.
+ */
+portBASE_TYPE xSimNodeSend( portBASE_TYPE xNode, const CAN_MSG_Type *pxFrame, SimTime_t xReleaseTime );
+
+/*
+ * The cost of running the driver since vSimInit() or the last call to
+ * vSimClearProfile().
+ */
+void vSimGetProfile( SimProfile_t *pxProfile );
+void vSimClearProfile( void );
+
+#endif /* SIM_CAN_H */
@@ -0,0 +1,1120 @@
+/*
+ * Register level model of the two LPC17xx CAN controllers, the acceptance
+ * filter and the central CAN registers.
+ *
+ * Each controller has three Tx buffers, a double buffered receiver, the error
+ * counters and error state machine, and the interrupt capture register.  The
+ * acceptance filter searches the look up table held in the acceptance filter
+ * RAM exactly as the driver and NXP library lay it out, including the FullCAN
+ * section, and writes FullCAN frames into the message objects that follow the
+ * table.  The acceptance filter RAM is plain memory, so it is read and written
+ * directly.  The other registers are trapped (see SimRegisters.c).
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* Simulation includes. */
+#include "SimInternal.h"
+
+#define simNUM_TX_BUFFERS			( 3UL )
+#define simNO_BUFFER				( 0xffffffffUL )
+
+/* Register offsets within a controller's page. */
+#define simCAN_MOD					( 0x00UL )
+#define simCAN_CMR					( 0x04UL )
+#define simCAN_GSR					( 0x08UL )
+#define simCAN_ICR					( 0x0CUL )
+#define simCAN_IER					( 0x10UL )
+#define simCAN_BTR					( 0x14UL )
+#define simCAN_EWL					( 0x18UL )
+#define simCAN_SR					( 0x1CUL )
+#define simCAN_RFS					( 0x20UL )
+#define simCAN_RID					( 0x24UL )
+#define simCAN_RDA					( 0x28UL )
+#define simCAN_RDB					( 0x2CUL )
+#define simCAN_TFI1					( 0x30UL )
+#define simCAN_TX_BUFFER_BYTES		( 0x10UL )
+#define simCAN_END_OF_REGISTERS		( simCAN_TFI1 + ( simNUM_TX_BUFFERS * simCAN_TX_BUFFER_BYTES ) )
+
+/* Register offsets within the acceptance filter register page. */
+#define simAF_AFMR					( 0x00UL )
+#define simAF_SFF_SA				( 0x04UL )
+#define simAF_SFF_GRP_SA			( 0x08UL )
+#define simAF_EFF_SA				( 0x0CUL )
+#define simAF_EFF_GRP_SA			( 0x10UL )
+#define simAF_END_OF_TABLE			( 0x14UL )
+#define simAF_FCANIE				( 0x20UL )
+#define simAF_FCANIC0				( 0x24UL )
+#define simAF_FCANIC1				( 0x28UL )
+#define simAF_WORDS					( 11UL )
+
+/* Register offsets within the central register page. */
+#define simCR_TXSR					( 0x00UL )
+#define simCR_RXSR					( 0x04UL )
+#define simCR_MSR					( 0x08UL )
+
+/* The ICR bits that are latched until ICR is read, and those that capture
+the detail of the last error or arbitration loss. */
+#define simICR_TI_BITS				( CAN_ICR_TI1 | CAN_ICR_TI2 | CAN_ICR_TI3 )
+#define simICR_ERRC_SHIFT			( 22UL )
+#define simICR_ALCBIT_SHIFT			( 24UL )
+
+/* Fields of the bit timing register. */
+#define simBTR_BRP( ulBTR )			( ( ulBTR ) & 0x3FFUL )
+#define simBTR_SJW( ulBTR )			( ( ( ulBTR ) >> 14UL ) & 0x03UL )
+#define simBTR_TSEG1( ulBTR )		( ( ( ulBTR ) >> 16UL ) & 0x0FUL )
+#define simBTR_TSEG2( ulBTR )		( ( ( ulBTR ) >> 20UL ) & 0x07UL )
+
+/* The peripheral clock selection of each controller in PCLKSEL0. */
+#define simPCLKSEL_CAN1_SHIFT		( 26UL )
+#define simPCLKSEL_CAN2_SHIFT		( 28UL )
+
+/* The register values after reset. */
+#define simRESET_MOD				( CAN_MOD_RM )
+#define simRESET_BTR				( 0x1C0000UL )
+#define simRESET_EWL				( 96UL )
+
+/* Error counter limits. */
+#define simERROR_PASSIVE_LIMIT		( 127UL )
+#define simBUS_OFF_LIMIT			( 255UL )
+
+/* Bus-off recovery waits for 128 sequences of 11 recessive bits. */
+#define simBUS_OFF_RECOVERY_BITS	( 128ULL * 11ULL )
+
+/* Fields of a 16 bit standard identifier entry in the acceptance filter RAM. */
+#define simAF_ENTRY_CONTROLLER( x )	( ( ( x ) >> 13UL ) & 0x07UL )
+#define simAF_ENTRY_DISABLE			( 1UL << 12UL )
+#define simAF_ENTRY_INTERRUPT		( 1UL << 11UL )
+#define simAF_ENTRY_ID( x )			( ( x ) & 0x7FFUL )
+
+/* A FullCAN message object. */
+#define simFULLCAN_OBJECT_WORDS		( 3UL )
+#define simFULLCAN_SEM_SHIFT		( 24UL )
+#define simFULLCAN_SEM_UPDATED		( 3UL )
+#define simFULLCAN_MAX_OBJECTS		( 64UL )
+
+typedef enum
+{
+	eSimFilterReject = 0,
+	eSimFilterAccept,
+	eSimFilterFullCAN
+} SimFilterResult_t;
+
+typedef struct SIM_RX_BUFFER
+{
+	portBASE_TYPE xFull;
+	uint32_t ulRFS;
+	uint32_t ulRID;
+	uint32_t ulRDA;
+	uint32_t ulRDB;
+} SimRxBuffer_t;
+
+typedef struct SIM_CONTROLLER
+{
+	uint32_t ulBase;
+	uint32_t ulMOD;
+	uint32_t ulIER;
+	uint32_t ulBTR;
+	uint32_t ulEWL;
+
+	/* The interrupt flags that are latched, and the error and arbitration
+	lost capture fields. */
+	uint32_t ulICR;
+
+	uint32_t ulTxErrors;
+	uint32_t ulRxErrors;
+	portBASE_TYPE xBusOff;
+	SimTime_t xRecoveryTime;
+
+	/* The Tx buffers.  A buffer is locked while its bit is set in
+	ulTxRequested, and ulTxActive is the buffer being sent, if any. */
+	uint32_t ulTxRegisters[ simNUM_TX_BUFFERS ][ 4 ];
+	uint32_t ulTxRequested;
+	uint32_t ulTxSelfReception;
+	uint32_t ulTxSingleShot;
+	uint32_t ulTxComplete;
+	uint32_t ulTxActive;
+	SimTime_t xRequestTime[ simNUM_TX_BUFFERS ];
+
+	portBASE_TYPE xReceiving;
+
+	/* The receive buffer visible through RFS, RID, RDA and RDB, and the
+	hidden buffer behind it. */
+	SimRxBuffer_t xRxBuffers[ 2 ];
+	portBASE_TYPE xDataOverrun;
+} SimController_t;
+
+static void prvControllerSync( void *pvContext, volatile uint32_t *pulView );
+static void prvControllerAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+static void prvFilterSync( void *pvContext, volatile uint32_t *pulView );
+static void prvFilterAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+static void prvCentralSync( void *pvContext, volatile uint32_t *pulView );
+static void prvCentralAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+
+static uint32_t prvPeripheralClock( unsigned portBASE_TYPE uxController );
+static uint32_t prvStatus( const SimController_t *pxController );
+static uint32_t prvGlobalStatus( const SimController_t *pxController );
+static void prvWriteMode( SimController_t *pxController, uint32_t ulValue );
+static void prvWriteCommand( SimController_t *pxController, uint32_t ulValue );
+static void prvEnterResetMode( SimController_t *pxController );
+static void prvReleaseTxBuffer( SimController_t *pxController, uint32_t ulBuffer, portBASE_TYPE xComplete );
+static void prvUpdateErrorState( SimController_t *pxController, uint32_t ulOldStatus );
+static void prvLatchInterrupt( SimController_t *pxController, uint32_t ulInterrupt );
+static SimFilterResult_t prvAcceptanceFilter( uint32_t ulController, const CAN_MSG_Type *pxFrame, uint32_t *pulIndex );
+static void prvWriteFullCANObject( uint32_t ulObject, const CAN_MSG_Type *pxFrame );
+static uint32_t prvFullCANPending( uint32_t ulWord );
+static uint32_t prvStandardEntry( uint32_t ulEntry );
+
+/*-----------------------------------------------------------*/
+
+static SimController_t xControllers[ simNUM_CONTROLLERS ];
+static uint32_t ulFilterRegisters[ simAF_WORDS ];
+
+/*-----------------------------------------------------------*/
+
+void vSimControllersInit( void )
+{
+unsigned portBASE_TYPE ux;
+SimController_t *pxController;
+
+	memset( xControllers, 0x00, sizeof( xControllers ) );
+	memset( ulFilterRegisters, 0x00, sizeof( ulFilterRegisters ) );
+
+	/* The acceptance filter is off after reset. */
+	ulFilterRegisters[ simAF_AFMR / sizeof( uint32_t ) ] = CAN_AFMR_AccOff;
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		pxController = &( xControllers[ ux ] );
+		pxController->ulBase = ( ux == 0U ) ? LPC_CAN1_BASE : LPC_CAN2_BASE;
+		pxController->ulMOD = simRESET_MOD;
+		pxController->ulBTR = simRESET_BTR;
+		pxController->ulEWL = simRESET_EWL;
+		pxController->ulTxComplete = ( 1UL << simNUM_TX_BUFFERS ) - 1UL;
+		pxController->ulTxActive = simNO_BUFFER;
+		pxController->xRecoveryTime = simTIME_NEVER;
+
+		vSimTrapPeripheral( pxController->ulBase, prvControllerSync, prvControllerAccess, pxController );
+	}
+
+	vSimTrapPeripheral( LPC_CANAF_BASE, prvFilterSync, prvFilterAccess, NULL );
+	vSimTrapPeripheral( LPC_CANCR_BASE, prvCentralSync, prvCentralAccess, NULL );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerIsActive( unsigned portBASE_TYPE uxController )
+{
+const SimController_t * const pxController = &( xControllers[ uxController ] );
+
+	return ( ( ( pxController->ulMOD & CAN_MOD_RM ) == 0UL ) && ( pxController->xBusOff == pdFALSE ) );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerAcknowledges( unsigned portBASE_TYPE uxController )
+{
+	return ( ( xSimControllerIsActive( uxController ) != pdFALSE ) && ( ( xControllers[ uxController ].ulMOD & CAN_MOD_LOM ) == 0UL ) );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerIsErrorPassive( unsigned portBASE_TYPE uxController )
+{
+const SimController_t * const pxController = &( xControllers[ uxController ] );
+
+	return ( ( pxController->ulTxErrors > simERROR_PASSIVE_LIMIT ) || ( pxController->ulRxErrors > simERROR_PASSIVE_LIMIT ) );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerIsSelfTest( unsigned portBASE_TYPE uxController )
+{
+	return ( ( xControllers[ uxController ].ulMOD & CAN_MOD_STM ) != 0UL );
+}
+/*-----------------------------------------------------------*/
+
+uint32_t ulSimControllerBitRate( unsigned portBASE_TYPE uxController )
+{
+const uint32_t ulBTR = xControllers[ uxController ].ulBTR;
+
+	return prvPeripheralClock( uxController ) / ( ( simBTR_BRP( ulBTR ) + 1UL ) * ( simBTR_TSEG1( ulBTR ) + simBTR_TSEG2( ulBTR ) + 3UL ) );
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimControllerPropagationTime( unsigned portBASE_TYPE uxController )
+{
+const uint32_t ulBTR = xControllers[ uxController ].ulBTR;
+const uint32_t ulTSEG1 = simBTR_TSEG1( ulBTR ) + 1UL;
+const uint32_t ulSJW = simBTR_SJW( ulBTR ) + 1UL;
+SimTime_t xReturn = 0U;
+
+	/* Phase segment 1 must be at least as long as the SJW, and TSEG1 holds
+	what is left of it after the propagation segment. */
+	if( ulTSEG1 > ulSJW )
+	{
+		xReturn = ( ( SimTime_t ) ( ulTSEG1 - ulSJW ) * ( SimTime_t ) ( simBTR_BRP( ulBTR ) + 1UL ) * simNS_PER_SECOND ) / ( SimTime_t ) prvPeripheralClock( uxController );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvPeripheralClock( unsigned portBASE_TYPE uxController )
+{
+const uint32_t ulShift = ( uxController == 0U ) ? simPCLKSEL_CAN1_SHIFT : simPCLKSEL_CAN2_SHIFT;
+uint32_t ulPeripheralClock;
+
+	/* PCLKSEL0 is plain memory, written by the NXP clock and power library. */
+	switch( ( LPC_SC->PCLKSEL0 >> ulShift ) & 0x03UL )
+	{
+		case 0UL :	ulPeripheralClock = SystemCoreClock / 4UL;	break;
+		case 1UL :	ulPeripheralClock = SystemCoreClock;		break;
+		case 2UL :	ulPeripheralClock = SystemCoreClock / 2UL;	break;
+		default :	ulPeripheralClock = SystemCoreClock / 6UL;	break;
+	}
+
+	return ulPeripheralClock;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerGetTxFrame( unsigned portBASE_TYPE uxController, CAN_MSG_Type *pxFrame, uint32_t *pulBuffer, SimTime_t *pxRequestTime )
+{
+const SimController_t * const pxController = &( xControllers[ uxController ] );
+portBASE_TYPE xReturn = pdFALSE;
+uint32_t ulBuffer, ulChosen = simNO_BUFFER, ulKey, ulBestKey = 0UL;
+const uint32_t *pulRegisters;
+
+	if( ( xSimControllerIsActive( uxController ) != pdFALSE ) && ( ( pxController->ulMOD & CAN_MOD_LOM ) == 0UL ) )
+	{
+		for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+		{
+			if( ( pxController->ulTxRequested & ( 1UL << ulBuffer ) ) != 0UL )
+			{
+				/* The buffer with the lowest identifier, or with the lowest
+				priority field in TPM mode, goes first.  Ties go to the lowest
+				numbered buffer. */
+				if( ( pxController->ulMOD & CAN_MOD_TPM ) != 0UL )
+				{
+					ulKey = CAN_TFI_PRIO( pxController->ulTxRegisters[ ulBuffer ][ 0 ] );
+				}
+				else
+				{
+					ulKey = pxController->ulTxRegisters[ ulBuffer ][ 1 ];
+				}
+
+				if( ( ulChosen == simNO_BUFFER ) || ( ulKey < ulBestKey ) )
+				{
+					ulChosen = ulBuffer;
+					ulBestKey = ulKey;
+				}
+			}
+		}
+
+		if( ulChosen != simNO_BUFFER )
+		{
+			pulRegisters = pxController->ulTxRegisters[ ulChosen ];
+			pxFrame->format = ( ( pulRegisters[ 0 ] & CAN_TFI_FF ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT;
+			pxFrame->type = ( ( pulRegisters[ 0 ] & CAN_TFI_RTR ) != 0UL ) ? REMOTE_FRAME : DATA_FRAME;
+			pxFrame->len = ( uint8_t ) ( ( pulRegisters[ 0 ] >> 16UL ) & 0x0FUL );
+			pxFrame->id = pulRegisters[ 1 ] & ( ( pxFrame->format == EXT_ID_FORMAT ) ? 0x1FFFFFFFUL : 0x7FFUL );
+			pxFrame->dataAWord = pulRegisters[ 2 ];
+			pxFrame->dataBWord = pulRegisters[ 3 ];
+
+			*pulBuffer = ulChosen;
+			*pxRequestTime = pxController->xRequestTime[ ulChosen ];
+			xReturn = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vSimControllerFrameStarted( unsigned portBASE_TYPE uxController, portBASE_TYPE xTransmitting, uint32_t ulBuffer )
+{
+SimController_t * const pxController = &( xControllers[ uxController ] );
+
+	if( xTransmitting != pdFALSE )
+	{
+		pxController->ulTxActive = ulBuffer;
+	}
+	else
+	{
+		pxController->xReceiving = pdTRUE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vSimControllerTxDone( unsigned portBASE_TYPE uxController, uint32_t ulBuffer, SimTxResult_t eResult, uint32_t ulDetail )
+{
+SimController_t * const pxController = &( xControllers[ uxController ] );
+const uint32_t ulOldStatus = prvGlobalStatus( pxController );
+const uint32_t ulMask = 1UL << ulBuffer;
+
+	pxController->ulTxActive = simNO_BUFFER;
+
+	/* The request may have gone when the controller entered reset mode. */
+	if( ( pxController->ulTxRequested & ulMask ) != 0UL )
+	{
+		switch( eResult )
+		{
+			case eSimTxSuccess :
+				if( pxController->ulTxErrors > 0UL )
+				{
+					pxController->ulTxErrors--;
+				}
+
+				prvReleaseTxBuffer( pxController, ulBuffer, pdTRUE );
+				break;
+
+			case eSimTxArbitrationLost :
+				pxController->ulICR &= ~( 0xFFUL << simICR_ALCBIT_SHIFT );
+				pxController->ulICR |= CAN_ICR_ALCBIT( ulDetail );
+				prvLatchInterrupt( pxController, CAN_ICR_ALI );
+				break;
+
+			case eSimTxBusError :
+			case eSimTxAckError :
+				/* A transmitter that is error passive and sees no
+				acknowledgement does not count it as an error. */
+				if( ( eResult == eSimTxBusError ) || ( xSimControllerIsErrorPassive( uxController ) == pdFALSE ) )
+				{
+					pxController->ulTxErrors += 8UL;
+				}
+
+				pxController->ulICR &= ~( CAN_ICR_ERRC( 3UL ) | CAN_ICR_ERRDIR | CAN_ICR_ERRBIT( 0x1FUL ) );
+				pxController->ulICR |= CAN_ICR_ERRC( ulDetail );
+				prvLatchInterrupt( pxController, CAN_ICR_BEI );
+				break;
+
+			default :
+				break;
+		}
+
+		/* A single shot transmission is not retried. */
+		if( ( ( pxController->ulTxRequested & ulMask ) != 0UL ) && ( ( pxController->ulTxSingleShot & ulMask ) != 0UL ) )
+		{
+			prvReleaseTxBuffer( pxController, ulBuffer, pdFALSE );
+		}
+	}
+
+	prvUpdateErrorState( pxController, ulOldStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vSimControllerRxDone( unsigned portBASE_TYPE uxController, const CAN_MSG_Type *pxFrame )
+{
+SimController_t * const pxController = &( xControllers[ uxController ] );
+const uint32_t ulOldStatus = prvGlobalStatus( pxController );
+SimRxBuffer_t *pxBuffer = NULL;
+uint32_t ulIndex = 0UL;
+SimFilterResult_t eResult;
+
+	pxController->xReceiving = pdFALSE;
+
+	/* Error counters are frozen in listen only mode. */
+	if( ( pxController->ulMOD & CAN_MOD_LOM ) == 0UL )
+	{
+		if( pxController->ulRxErrors > simERROR_PASSIVE_LIMIT )
+		{
+			pxController->ulRxErrors = 120UL;
+		}
+		else if( pxController->ulRxErrors > 0UL )
+		{
+			pxController->ulRxErrors--;
+		}
+	}
+
+	eResult = prvAcceptanceFilter( ( uint32_t ) uxController, pxFrame, &ulIndex );
+
+	if( eResult == eSimFilterFullCAN )
+	{
+		prvWriteFullCANObject( ulIndex, pxFrame );
+	}
+	else if( eResult == eSimFilterAccept )
+	{
+		if( pxController->xRxBuffers[ 0 ].xFull == pdFALSE )
+		{
+			pxBuffer = &( pxController->xRxBuffers[ 0 ] );
+		}
+		else if( pxController->xRxBuffers[ 1 ].xFull == pdFALSE )
+		{
+			pxBuffer = &( pxController->xRxBuffers[ 1 ] );
+		}
+		else
+		{
+			/* Both buffers are full, so the frame is lost. */
+			pxController->xDataOverrun = pdTRUE;
+			prvLatchInterrupt( pxController, CAN_ICR_DOI );
+		}
+
+		if( pxBuffer != NULL )
+		{
+			pxBuffer->xFull = pdTRUE;
+			pxBuffer->ulRFS = ( ( uint32_t ) ( pxFrame->len & 0x0FU ) << 16UL ) | ulIndex;
+			pxBuffer->ulRFS |= ( pxFrame->type == REMOTE_FRAME ) ? CAN_RFS_RTR : 0UL;
+			pxBuffer->ulRFS |= ( pxFrame->format == EXT_ID_FORMAT ) ? CAN_RFS_FF : 0UL;
+			pxBuffer->ulRID = pxFrame->id;
+			pxBuffer->ulRDA = ( pxFrame->type == REMOTE_FRAME ) ? 0UL : pxFrame->dataAWord;
+			pxBuffer->ulRDB = ( pxFrame->type == REMOTE_FRAME ) ? 0UL : pxFrame->dataBWord;
+		}
+	}
+
+	prvUpdateErrorState( pxController, ulOldStatus );
+}
+/*-----------------------------------------------------------*/
+
+void vSimControllerRxError( unsigned portBASE_TYPE uxController, uint32_t ulErrorCode )
+{
+SimController_t * const pxController = &( xControllers[ uxController ] );
+const uint32_t ulOldStatus = prvGlobalStatus( pxController );
+
+	pxController->xReceiving = pdFALSE;
+
+	if( ( ( pxController->ulMOD & CAN_MOD_LOM ) == 0UL ) && ( pxController->ulRxErrors < simBUS_OFF_LIMIT ) )
+	{
+		pxController->ulRxErrors++;
+	}
+
+	pxController->ulICR &= ~( CAN_ICR_ERRC( 3UL ) | CAN_ICR_ERRDIR | CAN_ICR_ERRBIT( 0x1FUL ) );
+	pxController->ulICR |= CAN_ICR_ERRC( ulErrorCode ) | CAN_ICR_ERRDIR;
+	prvLatchInterrupt( pxController, CAN_ICR_BEI );
+
+	prvUpdateErrorState( pxController, ulOldStatus );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimControllerWantsSelfReception( unsigned portBASE_TYPE uxController, uint32_t ulBuffer )
+{
+	return ( ( xControllers[ uxController ].ulTxSelfReception & ( 1UL << ulBuffer ) ) != 0UL );
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimControllerRecoveryTime( unsigned portBASE_TYPE uxController )
+{
+	return xControllers[ uxController ].xRecoveryTime;
+}
+/*-----------------------------------------------------------*/
+
+void vSimControllerRecover( unsigned portBASE_TYPE uxController )
+{
+SimController_t * const pxController = &( xControllers[ uxController ] );
+const uint32_t ulOldStatus = prvGlobalStatus( pxController );
+
+	pxController->xBusOff = pdFALSE;
+	pxController->xRecoveryTime = simTIME_NEVER;
+	pxController->ulTxErrors = 0UL;
+	pxController->ulRxErrors = 0UL;
+
+	prvUpdateErrorState( pxController, ulOldStatus );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimCANInterruptAsserted( void )
+{
+portBASE_TYPE xReturn = pdFALSE;
+unsigned portBASE_TYPE ux;
+const SimController_t *pxController;
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		pxController = &( xControllers[ ux ] );
+
+		if( ( ( pxController->ulICR & pxController->ulIER & 0x7FFUL ) != 0UL ) || ( ( pxController->xRxBuffers[ 0 ].xFull != pdFALSE ) && ( ( pxController->ulIER & CAN_IER_RIE ) != 0UL ) ) )
+		{
+			xReturn = pdTRUE;
+		}
+	}
+
+	/* The FullCAN pending bits are set whatever the value of FCANIE, which
+	only decides whether they interrupt the CPU. */
+	if( ( ( ulFilterRegisters[ simAF_FCANIE / sizeof( uint32_t ) ] & 0x01UL ) != 0UL ) && ( ( prvFullCANPending( 0UL ) | prvFullCANPending( 1UL ) ) != 0UL ) )
+	{
+		xReturn = pdTRUE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvControllerSync( void *pvContext, volatile uint32_t *pulView )
+{
+const SimController_t * const pxController = ( const SimController_t * ) pvContext;
+const SimRxBuffer_t * const pxRxBuffer = &( pxController->xRxBuffers[ 0 ] );
+uint32_t ulBuffer, ulICR;
+
+	ulICR = pxController->ulICR;
+
+	if( ( pxRxBuffer->xFull != pdFALSE ) && ( ( pxController->ulIER & CAN_IER_RIE ) != 0UL ) )
+	{
+		ulICR |= CAN_ICR_RI;
+	}
+
+	pulView[ simCAN_MOD / sizeof( uint32_t ) ] = pxController->ulMOD;
+	pulView[ simCAN_CMR / sizeof( uint32_t ) ] = 0UL;
+	pulView[ simCAN_GSR / sizeof( uint32_t ) ] = prvGlobalStatus( pxController );
+	pulView[ simCAN_ICR / sizeof( uint32_t ) ] = ulICR;
+	pulView[ simCAN_IER / sizeof( uint32_t ) ] = pxController->ulIER;
+	pulView[ simCAN_BTR / sizeof( uint32_t ) ] = pxController->ulBTR;
+	pulView[ simCAN_EWL / sizeof( uint32_t ) ] = pxController->ulEWL;
+	pulView[ simCAN_SR / sizeof( uint32_t ) ] = prvStatus( pxController );
+	pulView[ simCAN_RFS / sizeof( uint32_t ) ] = pxRxBuffer->ulRFS;
+	pulView[ simCAN_RID / sizeof( uint32_t ) ] = pxRxBuffer->ulRID;
+	pulView[ simCAN_RDA / sizeof( uint32_t ) ] = pxRxBuffer->ulRDA;
+	pulView[ simCAN_RDB / sizeof( uint32_t ) ] = pxRxBuffer->ulRDB;
+
+	for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+	{
+		memcpy( ( void * ) &( pulView[ ( simCAN_TFI1 + ( ulBuffer * simCAN_TX_BUFFER_BYTES ) ) / sizeof( uint32_t ) ] ), pxController->ulTxRegisters[ ulBuffer ], simCAN_TX_BUFFER_BYTES );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvControllerAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue )
+{
+SimController_t * const pxController = ( SimController_t * ) pvContext;
+const portBASE_TYPE xInReset = ( ( pxController->ulMOD & CAN_MOD_RM ) != 0UL );
+const uint32_t ulOldStatus = prvGlobalStatus( pxController );
+uint32_t ulBuffer;
+
+	if( xWrite == pdFALSE )
+	{
+		/* Reading the interrupt capture register releases everything it
+		captured.  The Rx interrupt is only cleared by releasing the receive
+		buffer. */
+		if( ulOffset == simCAN_ICR )
+		{
+			pxController->ulICR = 0UL;
+		}
+	}
+	else
+	{
+		switch( ulOffset )
+		{
+			case simCAN_MOD :
+				prvWriteMode( pxController, ulValue );
+				break;
+
+			case simCAN_CMR :
+				prvWriteCommand( pxController, ulValue );
+				break;
+
+			case simCAN_GSR :
+				/* Only the error counters can be written, and only in reset
+				mode. */
+				if( xInReset != pdFALSE )
+				{
+					pxController->ulRxErrors = ( ulValue >> 16UL ) & 0xFFUL;
+					pxController->ulTxErrors = ( ulValue >> 24UL ) & 0xFFUL;
+				}
+				break;
+
+			case simCAN_IER :
+				pxController->ulIER = ulValue & 0x7FFUL;
+				break;
+
+			case simCAN_BTR :
+				if( xInReset != pdFALSE )
+				{
+					pxController->ulBTR = ulValue & 0x00FFC3FFUL;
+				}
+				break;
+
+			case simCAN_EWL :
+				if( xInReset != pdFALSE )
+				{
+					pxController->ulEWL = ulValue & 0xFFUL;
+				}
+				break;
+
+			default :
+				if( ( ulOffset >= simCAN_TFI1 ) && ( ulOffset < simCAN_END_OF_REGISTERS ) )
+				{
+					/* A buffer cannot be written while it is waiting to be
+					sent. */
+					ulBuffer = ( ulOffset - simCAN_TFI1 ) / simCAN_TX_BUFFER_BYTES;
+
+					if( ( pxController->ulTxRequested & ( 1UL << ulBuffer ) ) == 0UL )
+					{
+						pxController->ulTxRegisters[ ulBuffer ][ ( ulOffset % simCAN_TX_BUFFER_BYTES ) / sizeof( uint32_t ) ] = ulValue;
+					}
+				}
+
+				/* The status and receive buffer registers are read only
+				outside of test modes. */
+				break;
+		}
+	}
+
+	prvUpdateErrorState( pxController, ulOldStatus );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFilterSync( void *pvContext, volatile uint32_t *pulView )
+{
+uint32_t ulWord;
+
+	( void ) pvContext;
+
+	for( ulWord = 0UL; ulWord < simAF_WORDS; ulWord++ )
+	{
+		pulView[ ulWord ] = ulFilterRegisters[ ulWord ];
+	}
+
+	pulView[ simAF_FCANIC0 / sizeof( uint32_t ) ] = prvFullCANPending( 0UL );
+	pulView[ simAF_FCANIC1 / sizeof( uint32_t ) ] = prvFullCANPending( 1UL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvFilterAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue )
+{
+	( void ) pvContext;
+
+	/* The look up table error registers and the FullCAN interrupt capture
+	registers are read only. */
+	if( ( xWrite != pdFALSE ) && ( ulOffset < ( simAF_WORDS * sizeof( uint32_t ) ) ) && ( ulOffset != simAF_FCANIC0 ) && ( ulOffset != simAF_FCANIC1 ) )
+	{
+		ulFilterRegisters[ ulOffset / sizeof( uint32_t ) ] = ulValue;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCentralSync( void *pvContext, volatile uint32_t *pulView )
+{
+uint32_t ulTxStatus = 0UL, ulRxStatus = 0UL, ulMiscStatus = 0UL, ulStatus;
+unsigned portBASE_TYPE ux;
+
+	( void ) pvContext;
+
+	for( ux = 0U; ux < simNUM_CONTROLLERS; ux++ )
+	{
+		ulStatus = prvGlobalStatus( &( xControllers[ ux ] ) );
+
+		ulTxStatus |= ( ( ulStatus & CAN_GSR_TS ) != 0UL ) ? ( CAN_TSR_TS1 << ux ) : 0UL;
+		ulTxStatus |= ( ( ulStatus & CAN_GSR_TBS ) != 0UL ) ? ( CAN_TSR_TBS1 << ux ) : 0UL;
+		ulTxStatus |= ( ( ulStatus & CAN_GSR_TCS ) != 0UL ) ? ( CAN_TSR_TCS1 << ux ) : 0UL;
+		ulRxStatus |= ( ( ulStatus & CAN_GSR_RS ) != 0UL ) ? ( CAN_RSR_RS1 << ux ) : 0UL;
+		ulRxStatus |= ( ( ulStatus & CAN_GSR_RBS ) != 0UL ) ? ( CAN_RSR_RB1 << ux ) : 0UL;
+		ulRxStatus |= ( ( ulStatus & CAN_GSR_DOS ) != 0UL ) ? ( CAN_RSR_DOS1 << ux ) : 0UL;
+		ulMiscStatus |= ( ( ulStatus & CAN_GSR_ES ) != 0UL ) ? ( CAN_MSR_E1 << ux ) : 0UL;
+		ulMiscStatus |= ( ( ulStatus & CAN_GSR_BS ) != 0UL ) ? ( CAN_MSR_BS1 << ux ) : 0UL;
+	}
+
+	pulView[ simCR_TXSR / sizeof( uint32_t ) ] = ulTxStatus;
+	pulView[ simCR_RXSR / sizeof( uint32_t ) ] = ulRxStatus;
+	pulView[ simCR_MSR / sizeof( uint32_t ) ] = ulMiscStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCentralAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue )
+{
+	/* Every central register is read only, and reading has no side
+	effects. */
+	( void ) pvContext;
+	( void ) ulOffset;
+	( void ) xWrite;
+	( void ) ulValue;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvStatus( const SimController_t *pxController )
+{
+const uint32_t ulGlobal = prvGlobalStatus( pxController );
+uint32_t ulStatus = 0UL, ulBuffer, ulMask, ulCommon;
+
+	/* The bits that are common to the controller are repeated in each byte
+	of SR, next to the status of the Tx buffer that byte describes. */
+	ulCommon = ulGlobal & ( CAN_GSR_RBS | CAN_GSR_DOS | CAN_GSR_RS | CAN_GSR_ES | CAN_GSR_BS );
+
+	for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+	{
+		ulMask = 1UL << ulBuffer;
+		ulStatus |= ulCommon << ( ulBuffer * 8UL );
+
+		if( ( pxController->ulTxRequested & ulMask ) == 0UL )
+		{
+			ulStatus |= CAN_SR_TBS1 << ( ulBuffer * 8UL );
+		}
+
+		if( ( pxController->ulTxComplete & ulMask ) != 0UL )
+		{
+			ulStatus |= CAN_SR_TCS1 << ( ulBuffer * 8UL );
+		}
+
+		if( pxController->ulTxActive == ulBuffer )
+		{
+			ulStatus |= CAN_SR_TS1 << ( ulBuffer * 8UL );
+		}
+	}
+
+	return ulStatus;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGlobalStatus( const SimController_t *pxController )
+{
+const uint32_t ulAllBuffers = ( 1UL << simNUM_TX_BUFFERS ) - 1UL;
+uint32_t ulStatus = 0UL;
+
+	ulStatus |= ( pxController->xRxBuffers[ 0 ].xFull != pdFALSE ) ? CAN_GSR_RBS : 0UL;
+	ulStatus |= ( pxController->xDataOverrun != pdFALSE ) ? CAN_GSR_DOS : 0UL;
+	ulStatus |= ( pxController->ulTxRequested == 0UL ) ? CAN_GSR_TBS : 0UL;
+	ulStatus |= ( pxController->ulTxComplete == ulAllBuffers ) ? CAN_GSR_TCS : 0UL;
+	ulStatus |= ( pxController->xReceiving != pdFALSE ) ? CAN_GSR_RS : 0UL;
+	ulStatus |= ( pxController->ulTxActive != simNO_BUFFER ) ? CAN_GSR_TS : 0UL;
+	ulStatus |= ( ( pxController->ulTxErrors >= pxController->ulEWL ) || ( pxController->ulRxErrors >= pxController->ulEWL ) ) ? CAN_GSR_ES : 0UL;
+	ulStatus |= ( pxController->xBusOff != pdFALSE ) ? CAN_GSR_BS : 0UL;
+	ulStatus |= ( pxController->ulRxErrors & 0xFFUL ) << 16UL;
+	ulStatus |= ( pxController->ulTxErrors & 0xFFUL ) << 24UL;
+
+	return ulStatus;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteMode( SimController_t *pxController, uint32_t ulValue )
+{
+const uint32_t ulOldMode = pxController->ulMOD;
+uint32_t ulNewMode = ulValue & ( CAN_MOD_RM | CAN_MOD_LOM | CAN_MOD_STM | CAN_MOD_TPM | CAN_MOD_SM | CAN_MOD_RPM | CAN_MOD_TM );
+unsigned portBASE_TYPE uxController;
+
+	/* Listen only and self test can only be changed in reset mode. */
+	if( ( ulOldMode & CAN_MOD_RM ) == 0UL )
+	{
+		ulNewMode &= ~( CAN_MOD_LOM | CAN_MOD_STM );
+		ulNewMode |= ulOldMode & ( CAN_MOD_LOM | CAN_MOD_STM );
+	}
+
+	pxController->ulMOD = ulNewMode;
+
+	if( ( ( ulOldMode & CAN_MOD_RM ) == 0UL ) && ( ( ulNewMode & CAN_MOD_RM ) != 0UL ) )
+	{
+		prvEnterResetMode( pxController );
+	}
+	else if( ( ( ulOldMode & CAN_MOD_RM ) != 0UL ) && ( ( ulNewMode & CAN_MOD_RM ) == 0UL ) && ( pxController->xBusOff != pdFALSE ) )
+	{
+		/* Leaving reset mode after going bus-off starts the recovery
+		sequence. */
+		uxController = ( pxController == &( xControllers[ 0 ] ) ) ? 0U : 1U;
+		pxController->xRecoveryTime = xSimGetTime() + ( simBUS_OFF_RECOVERY_BITS * xSimBusBitTime( uxSimControllerBus( uxController ) ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteCommand( SimController_t *pxController, uint32_t ulValue )
+{
+uint32_t ulBuffers, ulBuffer;
+
+	if( ( ulValue & CAN_CMR_AT ) != 0UL )
+	{
+		/* Only the selected buffers are aborted, or all of them if none is
+		selected.  A buffer that is being sent cannot be aborted, but is not
+		retried if it loses arbitration or fails, and a transmission request
+		made in the same write becomes a single shot request. */
+		ulBuffers = ( ulValue >> 5UL ) & 0x07UL;
+
+		if( ulBuffers == 0UL )
+		{
+			ulBuffers = 0x07UL;
+		}
+
+		for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+		{
+			if( ( ( ulBuffers & ( 1UL << ulBuffer ) ) != 0UL ) && ( ( pxController->ulTxRequested & ( 1UL << ulBuffer ) ) != 0UL ) )
+			{
+				if( pxController->ulTxActive != ulBuffer )
+				{
+					prvReleaseTxBuffer( pxController, ulBuffer, pdFALSE );
+				}
+				else
+				{
+					pxController->ulTxSingleShot |= 1UL << ulBuffer;
+				}
+			}
+		}
+	}
+
+	if( ( ( ulValue & ( CAN_CMR_TR | CAN_CMR_SRR ) ) != 0UL ) && ( ( pxController->ulMOD & CAN_MOD_RM ) == 0UL ) )
+	{
+		ulBuffers = ( ulValue >> 5UL ) & 0x07UL;
+
+		if( ulBuffers == 0UL )
+		{
+			ulBuffers = 0x01UL;
+		}
+
+		for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+		{
+			if( ( ulBuffers & ( 1UL << ulBuffer ) ) != 0UL )
+			{
+				pxController->ulTxRequested |= 1UL << ulBuffer;
+				pxController->ulTxComplete &= ~( 1UL << ulBuffer );
+				pxController->xRequestTime[ ulBuffer ] = xSimGetTime();
+
+				if( ( ulValue & CAN_CMR_SRR ) != 0UL )
+				{
+					pxController->ulTxSelfReception |= 1UL << ulBuffer;
+				}
+				else
+				{
+					pxController->ulTxSelfReception &= ~( 1UL << ulBuffer );
+				}
+
+				if( ( ulValue & CAN_CMR_AT ) != 0UL )
+				{
+					pxController->ulTxSingleShot |= 1UL << ulBuffer;
+				}
+				else
+				{
+					pxController->ulTxSingleShot &= ~( 1UL << ulBuffer );
+				}
+			}
+		}
+	}
+
+	if( ( ulValue & CAN_CMR_RRB ) != 0UL )
+	{
+		pxController->xRxBuffers[ 0 ] = pxController->xRxBuffers[ 1 ];
+		pxController->xRxBuffers[ 1 ].xFull = pdFALSE;
+	}
+
+	if( ( ulValue & CAN_CMR_CDO ) != 0UL )
+	{
+		pxController->xDataOverrun = pdFALSE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvEnterResetMode( SimController_t *pxController )
+{
+uint32_t ulBuffer;
+
+	/* A frame being sent is cut off, and pending requests are dropped. */
+	for( ulBuffer = 0UL; ulBuffer < simNUM_TX_BUFFERS; ulBuffer++ )
+	{
+		if( ( pxController->ulTxRequested & ( 1UL << ulBuffer ) ) != 0UL )
+		{
+			pxController->ulTxRequested &= ~( 1UL << ulBuffer );
+		}
+	}
+
+	pxController->ulTxActive = simNO_BUFFER;
+	pxController->xReceiving = pdFALSE;
+}
+/*-----------------------------------------------------------*/
+
+static void prvReleaseTxBuffer( SimController_t *pxController, uint32_t ulBuffer, portBASE_TYPE xComplete )
+{
+static const uint32_t ulTxInterrupts[ simNUM_TX_BUFFERS ] = { CAN_ICR_TI1, CAN_ICR_TI2, CAN_ICR_TI3 };
+
+	pxController->ulTxRequested &= ~( 1UL << ulBuffer );
+
+	if( xComplete != pdFALSE )
+	{
+		pxController->ulTxComplete |= 1UL << ulBuffer;
+	}
+
+	prvLatchInterrupt( pxController, ulTxInterrupts[ ulBuffer ] );
+}
+/*-----------------------------------------------------------*/
+
+static void prvUpdateErrorState( SimController_t *pxController, uint32_t ulOldStatus )
+{
+uint32_t ulNewStatus;
+portBASE_TYPE xWasPassive, xIsPassive;
+
+	if( ( pxController->ulTxErrors > simBUS_OFF_LIMIT ) && ( pxController->xBusOff == pdFALSE ) )
+	{
+		/* Bus-off.  The controller enters reset mode, and the Tx error
+		counter is left at 127 to count the recovery sequence. */
+		pxController->xBusOff = pdTRUE;
+		pxController->ulMOD |= CAN_MOD_RM;
+		pxController->ulTxErrors = simERROR_PASSIVE_LIMIT;
+		pxController->ulRxErrors = 0UL;
+		prvEnterResetMode( pxController );
+	}
+
+	ulNewStatus = prvGlobalStatus( pxController );
+
+	if( ( ( ulNewStatus ^ ulOldStatus ) & ( CAN_GSR_ES | CAN_GSR_BS ) ) != 0UL )
+	{
+		prvLatchInterrupt( pxController, CAN_ICR_EI );
+	}
+
+	xWasPassive = ( ( ( ulOldStatus >> 16UL ) & 0xFFUL ) > simERROR_PASSIVE_LIMIT ) || ( ( ( ulOldStatus >> 24UL ) & 0xFFUL ) > simERROR_PASSIVE_LIMIT );
+	xIsPassive = ( ( ( ulNewStatus >> 16UL ) & 0xFFUL ) > simERROR_PASSIVE_LIMIT ) || ( ( ( ulNewStatus >> 24UL ) & 0xFFUL ) > simERROR_PASSIVE_LIMIT );
+
+	if( xWasPassive != xIsPassive )
+	{
+		prvLatchInterrupt( pxController, CAN_ICR_EPI );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvLatchInterrupt( SimController_t *pxController, uint32_t ulInterrupt )
+{
+	/* The interrupt flags in ICR, other than RI, are only set if the
+	interrupt is enabled.  The enable bits share their positions. */
+	if( ( pxController->ulIER & ulInterrupt ) != 0UL )
+	{
+		pxController->ulICR |= ulInterrupt;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvStandardEntry( uint32_t ulEntry )
+{
+const uint32_t ulWord = LPC_CANAF_RAM->mask[ ulEntry >> 1UL ];
+
+	/* The first entry of each pair is in the upper half of the word. */
+	return ( ( ulEntry & 0x01UL ) == 0UL ) ? ( ulWord >> 16UL ) : ( ulWord & 0xFFFFUL );
+}
+/*-----------------------------------------------------------*/
+
+static SimFilterResult_t prvAcceptanceFilter( uint32_t ulController, const CAN_MSG_Type *pxFrame, uint32_t *pulIndex )
+{
+SimFilterResult_t eResult = eSimFilterReject;
+const uint32_t ulMode = ulFilterRegisters[ simAF_AFMR / sizeof( uint32_t ) ];
+const uint32_t ulSFFStart = ulFilterRegisters[ simAF_SFF_SA / sizeof( uint32_t ) ] / sizeof( uint32_t );
+const uint32_t ulSFFGroupStart = ulFilterRegisters[ simAF_SFF_GRP_SA / sizeof( uint32_t ) ] / sizeof( uint32_t );
+const uint32_t ulEFFStart = ulFilterRegisters[ simAF_EFF_SA / sizeof( uint32_t ) ] / sizeof( uint32_t );
+const uint32_t ulEFFGroupStart = ulFilterRegisters[ simAF_EFF_GRP_SA / sizeof( uint32_t ) ] / sizeof( uint32_t );
+const uint32_t ulEnd = ulFilterRegisters[ simAF_END_OF_TABLE / sizeof( uint32_t ) ] / sizeof( uint32_t );
+uint32_t ulEntry, ulValue, ulLower, ulUpper, ulIndex = 0UL;
+
+	*pulIndex = 0UL;
+
+	if( ( ulMode & CAN_AFMR_AccBP ) != 0UL )
+	{
+		*pulIndex = CAN_RFS_BP;
+		eResult = eSimFilterAccept;
+	}
+	else if( ( ulMode & CAN_AFMR_AccOff ) != 0UL )
+	{
+		eResult = eSimFilterReject;
+	}
+	else if( pxFrame->format == STD_ID_FORMAT )
+	{
+		/* FullCAN entries come first, two to a word. */
+		if( ( ulMode & CAN_AFMR_eFCAN ) != 0UL )
+		{
+			for( ulEntry = 0UL; ( ulEntry < ( ulSFFStart * 2UL ) ) && ( ulEntry < simFULLCAN_MAX_OBJECTS ); ulEntry++ )
+			{
+				ulValue = prvStandardEntry( ulEntry );
+
+				if( ( simAF_ENTRY_CONTROLLER( ulValue ) == ulController ) && ( ( ulValue & simAF_ENTRY_DISABLE ) == 0UL ) && ( simAF_ENTRY_ID( ulValue ) == pxFrame->id ) )
+				{
+					*pulIndex = ulEntry;
+					eResult = eSimFilterFullCAN;
+					break;
+				}
+			}
+		}
+
+		/* The ID index counts every entry from the start of the standard
+		explicit section, disabled entries included. */
+		for( ulEntry = ulSFFStart * 2UL; ( eResult == eSimFilterReject ) && ( ulEntry < ( ulSFFGroupStart * 2UL ) ); ulEntry++ )
+		{
+			ulValue = prvStandardEntry( ulEntry );
+
+			if( ( simAF_ENTRY_CONTROLLER( ulValue ) == ulController ) && ( ( ulValue & simAF_ENTRY_DISABLE ) == 0UL ) && ( simAF_ENTRY_ID( ulValue ) == pxFrame->id ) )
+			{
+				*pulIndex = ulIndex;
+				eResult = eSimFilterAccept;
+			}
+
+			ulIndex++;
+		}
+
+		for( ulEntry = ulSFFGroupStart; ( eResult == eSimFilterReject ) && ( ulEntry < ulEFFStart ); ulEntry++ )
+		{
+			ulLower = prvStandardEntry( ulEntry * 2UL );
+			ulUpper = prvStandardEntry( ( ulEntry * 2UL ) + 1UL );
+
+			if( ( simAF_ENTRY_CONTROLLER( ulLower ) == ulController ) && ( ( ulLower & simAF_ENTRY_DISABLE ) == 0UL ) && ( simAF_ENTRY_ID( ulLower ) <= pxFrame->id ) && ( pxFrame->id <= simAF_ENTRY_ID( ulUpper ) ) )
+			{
+				*pulIndex = ulIndex;
+				eResult = eSimFilterAccept;
+			}
+
+			ulIndex++;
+		}
+	}
+	else
+	{
+		ulIndex = ( ( ulSFFGroupStart - ulSFFStart ) * 2UL ) + ( ulEFFStart - ulSFFGroupStart );
+
+		for( ulEntry = ulEFFStart; ( eResult == eSimFilterReject ) && ( ulEntry < ulEFFGroupStart ); ulEntry++ )
+		{
+			ulValue = LPC_CANAF_RAM->mask[ ulEntry ];
+
+			if( ( ( ulValue >> 29UL ) == ulController ) && ( ( ulValue & 0x1FFFFFFFUL ) == pxFrame->id ) )
+			{
+				*pulIndex = ulIndex;
+				eResult = eSimFilterAccept;
+			}
+
+			ulIndex++;
+		}
+
+		for( ulEntry = ulEFFGroupStart; ( eResult == eSimFilterReject ) && ( ( ulEntry + 1UL ) < ulEnd ); ulEntry += 2UL )
+		{
+			ulLower = LPC_CANAF_RAM->mask[ ulEntry ];
+			ulUpper = LPC_CANAF_RAM->mask[ ulEntry + 1UL ];
+
+			if( ( ( ulLower >> 29UL ) == ulController ) && ( ( ulLower & 0x1FFFFFFFUL ) <= pxFrame->id ) && ( pxFrame->id <= ( ulUpper & 0x1FFFFFFFUL ) ) )
+			{
+				*pulIndex = ulIndex;
+				eResult = eSimFilterAccept;
+			}
+
+			ulIndex++;
+		}
+	}
+
+	return eResult;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteFullCANObject( uint32_t ulObject, const CAN_MSG_Type *pxFrame )
+{
+const uint32_t ulEnd = ulFilterRegisters[ simAF_END_OF_TABLE / sizeof( uint32_t ) ] / sizeof( uint32_t );
+volatile uint32_t * const pulObject = &( LPC_CANAF_RAM->mask[ ulEnd + ( ulObject * simFULLCAN_OBJECT_WORDS ) ] );
+uint32_t ulControl;
+
+	ulControl = ( simFULLCAN_SEM_UPDATED << simFULLCAN_SEM_SHIFT ) | ( ( uint32_t ) ( pxFrame->len & 0x0FU ) << 16UL ) | ( pxFrame->id & 0x7FFUL );
+	ulControl |= ( pxFrame->type == REMOTE_FRAME ) ? CAN_RFS_RTR : 0UL;
+
+	/* The frame is written whole, so the intermediate semaphore value is not
+	visible. */
+	pulObject[ 1 ] = pxFrame->dataAWord;
+	pulObject[ 2 ] = pxFrame->dataBWord;
+	pulObject[ 0 ] = ulControl;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvFullCANPending( uint32_t ulWord )
+{
+const uint32_t ulSFFStart = ulFilterRegisters[ simAF_SFF_SA / sizeof( uint32_t ) ] / sizeof( uint32_t );
+const uint32_t ulEnd = ulFilterRegisters[ simAF_END_OF_TABLE / sizeof( uint32_t ) ] / sizeof( uint32_t );
+uint32_t ulPending = 0UL, ulBit, ulObject;
+
+	for( ulBit = 0UL; ulBit < 32UL; ulBit++ )
+	{
+		ulObject = ( ulWord * 32UL ) + ulBit;
+
+		if( ulObject >= ( ulSFFStart * 2UL ) )
+		{
+			break;
+		}
+
+		/* A disabled entry, such as the one that pads an odd number of
+		FullCAN entries, has no message object. */
+		if( ( ( prvStandardEntry( ulObject ) & simAF_ENTRY_DISABLE ) == 0UL ) && ( ( prvStandardEntry( ulObject ) & simAF_ENTRY_INTERRUPT ) != 0UL ) && ( ( ( LPC_CANAF_RAM->mask[ ulEnd + ( ulObject * simFULLCAN_OBJECT_WORDS ) ] >> simFULLCAN_SEM_SHIFT ) & 0x03UL ) == simFULLCAN_SEM_UPDATED ) )
+		{
+			ulPending |= 1UL << ulBit;
+		}
+	}
+
+	return ulPending;
+}
@@ -0,0 +1,294 @@
+/*
+ * The simulated SD card described in SimDisk.h, which implements the disk
+ * functions FatFs calls through diskio.h, and get_fattime(), as mmc.c does on
+ * the target.
+ */
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* FatFs includes. */
+#include "diskio.h"
+
+/* Simulation includes. */
+#include "SimDisk.h"
+
+#define simDISK_SECTOR_BYTES		( 512UL )
+
+/* The layout of the FAT16 volume - 8K clusters, and a FAT big enough for the
+8185 clusters that follow the root directory. */
+#define simDISK_SECTORS_PER_CLUSTER	( 16U )
+#define simDISK_RESERVED_SECTORS	( 1U )
+#define simDISK_NUM_FATS			( 2U )
+#define simDISK_FAT_SECTORS			( 32U )
+#define simDISK_ROOT_ENTRIES		( 512U )
+
+/* The timestamp given to files - midnight on the 1st of January 2012. */
+#define simDISK_FAT_TIME			( ( ( 2012UL - 1980UL ) << 25 ) | ( 1UL << 21 ) | ( 1UL << 16 ) )
+
+/*
+ * Allocate the image, and write the boot sector and both FATs of an empty
+ * volume.
+ */
+static void prvFormat( void );
+
+/*
+ * Let the time taken by a command pass, calling the preempt hook between
+ * slices.
+ */
+static void prvBusy( SimTime_t xDuration );
+
+static void prvWriteLittleEndian16( uint8_t *pucBytes, uint16_t usValue );
+static void prvWriteLittleEndian32( uint8_t *pucBytes, uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+static uint8_t *pucImage = NULL;
+static DSTATUS xStatus = STA_NOINIT;
+static SimDiskTiming_t xTiming;
+static SimDiskStatistics_t xStatistics;
+static uint32_t ulSectorsSinceStall = 0UL;
+static void ( *pxPreemptHook )( void ) = NULL;
+static portBASE_TYPE xInHook = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+void vSimDiskSetTiming( const SimDiskTiming_t *pxTiming )
+{
+	xTiming = *pxTiming;
+	ulSectorsSinceStall = 0UL;
+}
+/*-----------------------------------------------------------*/
+
+void vSimDiskSetPreemptHook( void ( *pxHook )( void ) )
+{
+	pxPreemptHook = pxHook;
+}
+/*-----------------------------------------------------------*/
+
+void vSimDiskGetStatistics( SimDiskStatistics_t *pxStatistics )
+{
+	*pxStatistics = xStatistics;
+}
+/*-----------------------------------------------------------*/
+
+void vSimDiskClearStatistics( void )
+{
+	memset( &xStatistics, 0x00, sizeof( xStatistics ) );
+}
+/*-----------------------------------------------------------*/
+
+DSTATUS disk_initialize( BYTE ucDrive )
+{
+	if( ucDrive == 0U )
+	{
+		if( pucImage == NULL )
+		{
+			prvFormat();
+		}
+
+		if( pucImage != NULL )
+		{
+			xStatus = 0U;
+		}
+	}
+
+	return disk_status( ucDrive );
+}
+/*-----------------------------------------------------------*/
+
+DSTATUS disk_status( BYTE ucDrive )
+{
+	return ( ucDrive == 0U ) ? xStatus : STA_NOINIT;
+}
+/*-----------------------------------------------------------*/
+
+DRESULT disk_read( BYTE ucDrive, BYTE *pucBuffer, DWORD ulSector, BYTE ucCount )
+{
+DRESULT xResult = RES_PARERR;
+
+	if( ( ucDrive == 0U ) && ( ucCount > 0U ) && ( ( ulSector + ucCount ) <= simDISK_SECTORS ) )
+	{
+		if( xStatus != 0U )
+		{
+			xResult = RES_NOTRDY;
+		}
+		else
+		{
+			prvBusy( xTiming.xCommandTime + ( xTiming.xSectorTime * ucCount ) );
+			memcpy( pucBuffer, &( pucImage[ ulSector * simDISK_SECTOR_BYTES ] ), ucCount * simDISK_SECTOR_BYTES );
+
+			( xStatistics.ulReadCommands )++;
+			xStatistics.ulSectorsRead += ucCount;
+			xResult = RES_OK;
+		}
+	}
+
+	return xResult;
+}
+/*-----------------------------------------------------------*/
+
+DRESULT disk_write( BYTE ucDrive, const BYTE *pucBuffer, DWORD ulSector, BYTE ucCount )
+{
+DRESULT xResult = RES_PARERR;
+SimTime_t xDuration;
+
+	if( ( ucDrive == 0U ) && ( ucCount > 0U ) && ( ( ulSector + ucCount ) <= simDISK_SECTORS ) )
+	{
+		if( xStatus != 0U )
+		{
+			xResult = RES_NOTRDY;
+		}
+		else
+		{
+			xDuration = xTiming.xCommandTime + ( xTiming.xSectorTime * ucCount );
+
+			ulSectorsSinceStall += ucCount;
+			if( ( xTiming.ulSectorsPerStall > 0UL ) && ( ulSectorsSinceStall >= xTiming.ulSectorsPerStall ) )
+			{
+				ulSectorsSinceStall = 0UL;
+				xDuration += xTiming.xStallTime;
+				( xStatistics.ulStalls )++;
+			}
+
+			prvBusy( xDuration );
+			memcpy( &( pucImage[ ulSector * simDISK_SECTOR_BYTES ] ), pucBuffer, ucCount * simDISK_SECTOR_BYTES );
+
+			( xStatistics.ulWriteCommands )++;
+			xStatistics.ulSectorsWritten += ucCount;
+			xResult = RES_OK;
+		}
+	}
+
+	return xResult;
+}
+/*-----------------------------------------------------------*/
+
+DRESULT disk_ioctl( BYTE ucDrive, BYTE ucCommand, void *pvBuffer )
+{
+DRESULT xResult = RES_PARERR;
+
+	if( ucDrive == 0U )
+	{
+		xResult = RES_OK;
+
+		switch( ucCommand )
+		{
+			case CTRL_SYNC :
+				/* Writes complete before disk_write() returns. */
+				break;
+
+			case GET_SECTOR_COUNT :
+				*( ( DWORD * ) pvBuffer ) = simDISK_SECTORS;
+				break;
+
+			case GET_SECTOR_SIZE :
+				*( ( WORD * ) pvBuffer ) = ( WORD ) simDISK_SECTOR_BYTES;
+				break;
+
+			case GET_BLOCK_SIZE :
+				*( ( DWORD * ) pvBuffer ) = simDISK_SECTORS_PER_CLUSTER;
+				break;
+
+			default :
+				xResult = RES_PARERR;
+				break;
+		}
+	}
+
+	return xResult;
+}
+/*-----------------------------------------------------------*/
+
+DWORD get_fattime( void )
+{
+	return simDISK_FAT_TIME;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFormat( void )
+{
+uint8_t *pucBoot;
+unsigned portBASE_TYPE uxFAT;
+
+	pucImage = calloc( simDISK_SECTORS, simDISK_SECTOR_BYTES );
+
+	if( pucImage != NULL )
+	{
+		pucBoot = pucImage;
+		memcpy( &( pucBoot[ 0 ] ), "\xEB\x3C\x90" "MSDOS5.0", 11 );
+		prvWriteLittleEndian16( &( pucBoot[ 11 ] ), ( uint16_t ) simDISK_SECTOR_BYTES );
+		pucBoot[ 13 ] = simDISK_SECTORS_PER_CLUSTER;
+		prvWriteLittleEndian16( &( pucBoot[ 14 ] ), simDISK_RESERVED_SECTORS );
+		pucBoot[ 16 ] = simDISK_NUM_FATS;
+		prvWriteLittleEndian16( &( pucBoot[ 17 ] ), simDISK_ROOT_ENTRIES );
+		pucBoot[ 21 ] = 0xF8U;
+		prvWriteLittleEndian16( &( pucBoot[ 22 ] ), simDISK_FAT_SECTORS );
+		prvWriteLittleEndian16( &( pucBoot[ 24 ] ), 63U );
+		prvWriteLittleEndian16( &( pucBoot[ 26 ] ), 255U );
+		prvWriteLittleEndian32( &( pucBoot[ 32 ] ), simDISK_SECTORS );
+		pucBoot[ 36 ] = 0x80U;
+		pucBoot[ 38 ] = 0x29U;
+		prvWriteLittleEndian32( &( pucBoot[ 39 ] ), 0x20120101UL );
+		memcpy( &( pucBoot[ 43 ] ), "NO NAME    " "FAT16   ", 19 );
+		pucBoot[ 510 ] = 0x55U;
+		pucBoot[ 511 ] = 0xAAU;
+
+		/* The media byte, and the end of chain marker of reserved cluster 1. */
+		for( uxFAT = 0U; uxFAT < simDISK_NUM_FATS; uxFAT++ )
+		{
+			prvWriteLittleEndian32( &( pucImage[ ( simDISK_RESERVED_SECTORS + ( uxFAT * simDISK_FAT_SECTORS ) ) * simDISK_SECTOR_BYTES ] ), 0xFFFFFFF8UL );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvBusy( SimTime_t xDuration )
+{
+const SimTime_t xEndTime = xSimGetTime() + xDuration;
+SimTime_t xSliceEnd;
+
+	xStatistics.xBusyTime += xDuration;
+
+	while( xSimGetTime() < xEndTime )
+	{
+		xSliceEnd = xSimGetTime() + simDISK_SLICE;
+		if( xSliceEnd > xEndTime )
+		{
+			xSliceEnd = xEndTime;
+		}
+
+		vSimRunUntil( xSliceEnd );
+
+		/* The hook may let time pass itself, which counts towards the time
+		the card is busy, as the card carries on while the task of higher
+		priority runs. */
+		if( ( pxPreemptHook != NULL ) && ( xInHook == pdFALSE ) )
+		{
+			xInHook = pdTRUE;
+			pxPreemptHook();
+			xInHook = pdFALSE;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLittleEndian16( uint8_t *pucBytes, uint16_t usValue )
+{
+	pucBytes[ 0 ] = ( uint8_t ) usValue;
+	pucBytes[ 1 ] = ( uint8_t ) ( usValue >> 8 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLittleEndian32( uint8_t *pucBytes, uint32_t ulValue )
+{
+	pucBytes[ 0 ] = ( uint8_t ) ulValue;
+	pucBytes[ 1 ] = ( uint8_t ) ( ulValue >> 8 );
+	pucBytes[ 2 ] = ( uint8_t ) ( ulValue >> 16 );
+	pucBytes[ 3 ] = ( uint8_t ) ( ulValue >> 24 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,52 @@
+/*
+ * A simulated SD card, on which the FatFs module of FreeRTOS-Plus-Demo-2 runs
+ * on the host in place of mmc.c.
+ *
+ * The card is a RAM image, formatted as an empty FAT16 volume the first time
+ * FatFs initialises it.  Every read or write command takes simulated time - a
+ * fixed cost per command, a cost per sector, and, every ulSectorsPerStall
+ * sectors written, a stall of xStallTime, as a real card takes when it has to
+ * erase a block or move data to make room.  The time passes in slices, and the
+ * hook set by vSimDiskSetPreemptHook() is called between slices.  There is only
+ * one task, so the hook stands in for a task of higher priority than the one
+ * using the card, which would run while the card was busy.
+ */
+
+#ifndef SIM_DISK_H
+#define SIM_DISK_H
+
+#include "SimCAN.h"
+
+/* The size of the card, in 512 byte sectors. */
+#define simDISK_SECTORS				( 131072UL )
+
+/* The longest the card is busy before the preempt hook is called. */
+#define simDISK_SLICE				( simNS_PER_MS )
+
+/* The time taken by the card, passed to vSimDiskSetTiming().  Every field is
+zero until it is called, so the card takes no time. */
+typedef struct SIM_DISK_TIMING
+{
+	SimTime_t xCommandTime;			/* The cost of every read or write command. */
+	SimTime_t xSectorTime;			/* The cost of every sector read or written. */
+	uint32_t ulSectorsPerStall;		/* The card stalls once this many sectors have been written since the last stall, or never if 0. */
+	SimTime_t xStallTime;
+} SimDiskTiming_t;
+
+/* Counters returned by vSimDiskGetStatistics(). */
+typedef struct SIM_DISK_STATISTICS
+{
+	uint32_t ulReadCommands;
+	uint32_t ulWriteCommands;
+	uint32_t ulSectorsRead;
+	uint32_t ulSectorsWritten;
+	uint32_t ulStalls;
+	SimTime_t xBusyTime;			/* Time the card spent on commands, stalls included. */
+} SimDiskStatistics_t;
+
+void vSimDiskSetTiming( const SimDiskTiming_t *pxTiming );
+void vSimDiskSetPreemptHook( void ( *pxHook )( void ) );
+void vSimDiskGetStatistics( SimDiskStatistics_t *pxStatistics );
+void vSimDiskClearStatistics( void );
+
+#endif /* SIM_DISK_H */
@@ -0,0 +1,139 @@
+/*
+ * Definitions shared by the modules of the simulation, but not used by the
+ * application.
+ */
+
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include "SimCAN.h"
+
+/*-------------------------- SimRegisters.c ---------------------------------*/
+
+/* Called before a trapped register page is accessed, to write the current
+value of every register in the page into pulView. */
+typedef void ( *SimPeripheralSync_t )( void *pvContext, volatile uint32_t *pulView );
+
+/* Called after a trapped register page has been accessed.  ulOffset is the
+offset of the 32 bit word accessed, and ulValue the value of that word after
+the access, which is only of interest if xWrite is pdTRUE. */
+typedef void ( *SimPeripheralAccess_t )( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+
+/*
+ * Map every peripheral address range used by the CAN driver and the NXP
+ * library.  Pages that are not trapped behave as plain memory.
+ */
+void vSimRegistersInit( void );
+
+/*
+ * Trap every access to the 4K page at ulBase, so pxSync and pxAccess can give
+ * the page the behaviour of a peripheral.
+ */
+void vSimTrapPeripheral( uint32_t ulBase, SimPeripheralSync_t pxSync, SimPeripheralAccess_t pxAccess, void *pvContext );
+
+/* The NVIC state, as written through the NVIC registers. */
+portBASE_TYPE xSimNVICIsEnabled( IRQn_Type xIRQ );
+portBASE_TYPE xSimNVICIsPending( IRQn_Type xIRQ );
+void vSimNVICClearPending( IRQn_Type xIRQ );
+
+/*---------------------------- SimKernel.c ----------------------------------*/
+
+/*
+ * Account for a register access, which lets simulated time pass.  Called from
+ * the signal handler that completes the access, so must not run driver code.
+ */
+void vSimRegisterAccessed( void );
+
+/* The number of simulated nanoseconds in a tick. */
+#define simNS_PER_TICK				( simNS_PER_SECOND / ( SimTime_t ) configTICK_RATE_HZ )
+
+/*------------------------- SimCANController.c ------------------------------*/
+
+/* The outcome of an attempt to send a frame. */
+typedef enum
+{
+	eSimTxSuccess = 0,
+	eSimTxArbitrationLost,
+	eSimTxBusError,
+	eSimTxAckError
+} SimTxResult_t;
+
+/* The error code captured in ICR when a bus error is detected. */
+#define simERRC_BIT_ERROR			( 0UL )
+#define simERRC_FORM_ERROR			( 1UL )
+#define simERRC_STUFF_ERROR			( 2UL )
+#define simERRC_OTHER_ERROR			( 3UL )
+
+void vSimControllersInit( void );
+
+/* Whether the controller is taking part in bus traffic (not in reset mode,
+and not bus-off), and whether it acknowledges the frames it receives. */
+portBASE_TYPE xSimControllerIsActive( unsigned portBASE_TYPE uxController );
+portBASE_TYPE xSimControllerAcknowledges( unsigned portBASE_TYPE uxController );
+portBASE_TYPE xSimControllerIsErrorPassive( unsigned portBASE_TYPE uxController );
+portBASE_TYPE xSimControllerIsSelfTest( unsigned portBASE_TYPE uxController );
+
+/* The bit rate given by the controller's bit timing register, and the
+longest signal loop delay its sample point allows for - the part of TSEG1 that
+is not needed by phase segment 1. */
+uint32_t ulSimControllerBitRate( unsigned portBASE_TYPE uxController );
+SimTime_t xSimControllerPropagationTime( unsigned portBASE_TYPE uxController );
+
+/*
+ * If the controller has a frame waiting to be sent, write it to pxFrame, the
+ * hardware Tx buffer that holds it to pulBuffer, the time at which it was
+ * requested to pxRequestTime, and return pdTRUE.
+ */
+portBASE_TYPE xSimControllerGetTxFrame( unsigned portBASE_TYPE uxController, CAN_MSG_Type *pxFrame, uint32_t *pulBuffer, SimTime_t *pxRequestTime );
+
+/* Bus events, reported to the controller by the bus. */
+void vSimControllerFrameStarted( unsigned portBASE_TYPE uxController, portBASE_TYPE xTransmitting, uint32_t ulBuffer );
+void vSimControllerTxDone( unsigned portBASE_TYPE uxController, uint32_t ulBuffer, SimTxResult_t eResult, uint32_t ulDetail );
+void vSimControllerRxDone( unsigned portBASE_TYPE uxController, const CAN_MSG_Type *pxFrame );
+void vSimControllerRxError( unsigned portBASE_TYPE uxController, uint32_t ulErrorCode );
+portBASE_TYPE xSimControllerWantsSelfReception( unsigned portBASE_TYPE uxController, uint32_t ulBuffer );
+
+/*
+ * The time at which a controller that is recovering from bus-off rejoins the
+ * bus, or simTIME_NEVER, and the function that completes recovery.
+ */
+SimTime_t xSimControllerRecoveryTime( unsigned portBASE_TYPE uxController );
+void vSimControllerRecover( unsigned portBASE_TYPE uxController );
+
+/* Whether the CAN interrupt line is asserted by either controller or by the
+FullCAN message objects. */
+portBASE_TYPE xSimCANInterruptAsserted( void );
+
+/*----------------------------- SimTimer.c ----------------------------------*/
+
+void vSimTimersInit( void );
+
+/*
+ * The time of the next match that raises an interrupt, resets or stops a
+ * timer, or simTIME_NEVER, and the function that takes every match that is due
+ * at xNow.  Neither runs driver code.
+ */
+SimTime_t xSimTimersNextEventTime( void );
+void vSimTimersProcessEvents( SimTime_t xNow );
+
+/* Whether timer uxTimer (0 to 3) has a match flag set, which asserts its
+interrupt line. */
+portBASE_TYPE xSimTimerInterruptAsserted( unsigned portBASE_TYPE uxTimer );
+
+/*----------------------------- SimBus.c ------------------------------------*/
+
+void vSimBusInit( void );
+
+/* The bus that controller uxController is attached to, and its bit time. */
+unsigned portBASE_TYPE uxSimControllerBus( unsigned portBASE_TYPE uxController );
+SimTime_t xSimBusBitTime( unsigned portBASE_TYPE uxBus );
+
+/*
+ * The time of the next bus event, which may be now if a controller has just
+ * been asked to send, and the function that processes every event that is due
+ * at xNow.  Neither runs driver code.
+ */
+SimTime_t xSimBusNextEventTime( void );
+void vSimBusProcessEvents( SimTime_t xNow );
+
+#endif /* SIM_INTERNAL_H */
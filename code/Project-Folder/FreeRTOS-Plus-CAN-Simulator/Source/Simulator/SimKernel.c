@@ -0,0 +1,821 @@
+/*
+ * The subset of the FreeRTOS kernel API used by FreeRTOS+IO, implemented for a
+ * single task on the host.
+ *
+ * There is no scheduler.  main() is the only task, and the CAN interrupt and
+ * the four timer interrupts are the only interrupts.  An interrupt is taken at
+ * the points at which it could first be taken on the target once the model has
+ * raised it - when interrupts are re-enabled, when a critical section is
+ * exited, when a kernel function is called, and while a kernel function is
+ * blocked.  When more than one is raised, the one with the lowest number is
+ * taken first, as it would be on the target with equal priorities.  A function
+ * that blocks lets simulated time run forward to the next bus event, timer
+ * match, software timer expiry or its own timeout, whichever comes first, so
+ * the simulation never waits in real time.  Software timer callbacks run from the blocked function, as they would
+ * run from the timer service task while the application task was blocked.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "timers.h"
+
+/* Simulation includes. */
+#include "SimInternal.h"
+
+/* The cost of a register access if vSimSetRegisterAccessTime() is not
+called. */
+#define simDEFAULT_REGISTER_ACCESS_TIME		( ( SimTime_t ) 40ULL )
+
+/* The number of times the interrupt can be entered without the line ever
+being released before the simulation concludes the interrupt is not being
+cleared. */
+#define simMAX_CONSECUTIVE_INTERRUPTS		( 100000UL )
+
+/* The handle returned by xTaskGetCurrentTaskHandle(), as there is only one
+task. */
+#define simTHE_TASK							( ( xTaskHandle ) &xTheTask )
+
+typedef struct SIM_QUEUE
+{
+	unsigned portBASE_TYPE uxLength;
+	unsigned portBASE_TYPE uxItemSize;
+	unsigned portBASE_TYPE uxMessagesWaiting;
+	unsigned portBASE_TYPE uxReadFrom;
+	unsigned char ucQueueType;
+	xTaskHandle xMutexHolder;
+	unsigned char *pucStorage;
+} SimQueue_t;
+
+typedef struct SIM_TIMER
+{
+	const signed char *pcTimerName;
+	portTickType xPeriod;
+	unsigned portBASE_TYPE uxAutoReload;
+	void *pvTimerID;
+	tmrTIMER_CALLBACK pxCallbackFunction;
+	portBASE_TYPE xActive;
+	SimTime_t xExpiryTime;
+	struct SIM_TIMER *pxNext;
+} SimTimer_t;
+
+/* The number of interrupts the simulation can raise. */
+#define simNUM_INTERRUPTS					( 5U )
+
+/* The interrupt handlers, defined by the driver.  The timer handlers are weak,
+as the driver only defines the handlers of the timers it uses. */
+extern void CAN_IRQHandler( void );
+extern void TIMER0_IRQHandler( void ) __attribute__( ( weak ) );
+extern void TIMER1_IRQHandler( void ) __attribute__( ( weak ) );
+extern void TIMER2_IRQHandler( void ) __attribute__( ( weak ) );
+extern void TIMER3_IRQHandler( void ) __attribute__( ( weak ) );
+
+static void prvServiceInterrupts( void );
+static portBASE_TYPE prvInterruptAsserted( IRQn_Type xIRQ );
+static void prvProcessBus( void );
+static SimTime_t prvNextTimerExpiry( void );
+static void prvProcessTimers( void );
+static void prvRunToNextEvent( SimTime_t xLimit );
+static SimTime_t prvTimeoutToDeadline( portTickType xTicksToWait );
+static void prvCopyToQueue( SimQueue_t *pxQueue, const void *pvItem, portBASE_TYPE xCopyPosition );
+static void prvCopyFromQueue( SimQueue_t *pxQueue, void *pvBuffer, portBASE_TYPE xJustPeek );
+
+/*-----------------------------------------------------------*/
+
+/* Required by the CMSIS and NXP library clock calculations. */
+uint32_t SystemCoreClock = 100000000UL;
+
+static SimTime_t xCurrentTime = 0ULL;
+static SimTime_t xRegisterAccessTime = simDEFAULT_REGISTER_ACCESS_TIME;
+
+static unsigned portBASE_TYPE uxCriticalNesting = 0U;
+static unsigned long ulInterruptMask = 0UL;
+static portBASE_TYPE xInInterrupt = pdFALSE;
+static portBASE_TYPE xProcessingBus = pdFALSE;
+
+static SimTimer_t *pxTimerList = NULL;
+static SimProfile_t xProfile;
+static char xTheTask;
+
+/*-----------------------------------------------------------*/
+
+void vSimInit( void )
+{
+	vSimRegistersInit();
+	vSimControllersInit();
+	vSimTimersInit();
+	vSimBusInit();
+	vSimClearProfile();
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimGetTime( void )
+{
+	return xCurrentTime;
+}
+/*-----------------------------------------------------------*/
+
+void vSimRunFor( SimTime_t xDuration )
+{
+	vSimRunUntil( xCurrentTime + xDuration );
+}
+/*-----------------------------------------------------------*/
+
+void vSimRunUntil( SimTime_t xTime )
+{
+	prvServiceInterrupts();
+
+	while( xCurrentTime < xTime )
+	{
+		prvRunToNextEvent( xTime );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vSimSetRegisterAccessTime( SimTime_t xAccessTime )
+{
+	xRegisterAccessTime = xAccessTime;
+}
+/*-----------------------------------------------------------*/
+
+void vSimGetProfile( SimProfile_t *pxProfile )
+{
+	*pxProfile = xProfile;
+}
+/*-----------------------------------------------------------*/
+
+void vSimClearProfile( void )
+{
+	memset( &xProfile, 0x00, sizeof( xProfile ) );
+}
+/*-----------------------------------------------------------*/
+
+void vSimRegisterAccessed( void )
+{
+	xProfile.ulRegisterAccesses++;
+
+	if( xInInterrupt != pdFALSE )
+	{
+		xProfile.ulInterruptAccesses++;
+	}
+
+	xCurrentTime += xRegisterAccessTime;
+	prvProcessBus();
+}
+/*-----------------------------------------------------------*/
+
+void vSimWaitForInterrupt( void )
+{
+	prvRunToNextEvent( simTIME_NEVER );
+}
+/*-----------------------------------------------------------*/
+
+void vSimAssertCalled( const char *pcFile, unsigned long ulLine )
+{
+	fprintf( stderr, "Assert failed at %s:%lu (simulated time %lluns).\n", pcFile, ulLine, ( unsigned long long ) xCurrentTime );
+	abort();
+}
+/*-----------------------------------------------------------*/
+
+void check_failed( uint8_t *file, uint32_t line )
+{
+	vSimAssertCalled( ( const char * ) file, ( unsigned long ) line );
+}
+/*-----------------------------------------------------------*/
+
+static void prvServiceInterrupts( void )
+{
+static const IRQn_Type xIRQs[ simNUM_INTERRUPTS ] = { TIMER0_IRQn, TIMER1_IRQn, TIMER2_IRQn, TIMER3_IRQn, CAN_IRQn };
+void ( * const pxHandlers[ simNUM_INTERRUPTS ] )( void ) = { TIMER0_IRQHandler, TIMER1_IRQHandler, TIMER2_IRQHandler, TIMER3_IRQHandler, CAN_IRQHandler };
+uint32_t ulConsecutive = 0UL;
+unsigned portBASE_TYPE ux;
+SimTime_t xEntryTime;
+
+	/* Timer matches do not run driver code, so are taken whether or not
+	interrupts are masked, and only the interrupts they raise wait. */
+	vSimTimersProcessEvents( xCurrentTime );
+
+	if( ( uxCriticalNesting == 0U ) && ( ulInterruptMask == 0UL ) && ( xInInterrupt == pdFALSE ) )
+	{
+		ux = 0U;
+
+		while( ux < simNUM_INTERRUPTS )
+		{
+			if( ( xSimNVICIsEnabled( xIRQs[ ux ] ) != pdFALSE ) && ( ( prvInterruptAsserted( xIRQs[ ux ] ) != pdFALSE ) || ( xSimNVICIsPending( xIRQs[ ux ] ) != pdFALSE ) ) )
+			{
+				ulConsecutive++;
+				configASSERT( ulConsecutive < simMAX_CONSECUTIVE_INTERRUPTS );
+
+				/* An interrupt was enabled that the driver has no handler
+				for. */
+				configASSERT( pxHandlers[ ux ] != NULL );
+
+				vSimNVICClearPending( xIRQs[ ux ] );
+				xInInterrupt = pdTRUE;
+				xProfile.ulInterrupts++;
+				xEntryTime = xCurrentTime;
+
+				pxHandlers[ ux ]();
+
+				xProfile.xTimeInInterrupts += xCurrentTime - xEntryTime;
+				xInInterrupt = pdFALSE;
+
+				/* The handler let time pass, so check every interrupt again,
+				highest priority first. */
+				vSimTimersProcessEvents( xCurrentTime );
+				ux = 0U;
+			}
+			else
+			{
+				ux++;
+			}
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvInterruptAsserted( IRQn_Type xIRQ )
+{
+portBASE_TYPE xReturn;
+
+	if( xIRQ == CAN_IRQn )
+	{
+		xReturn = xSimCANInterruptAsserted();
+	}
+	else
+	{
+		xReturn = xSimTimerInterruptAsserted( ( unsigned portBASE_TYPE ) ( xIRQ - TIMER0_IRQn ) );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessBus( void )
+{
+	/* The bus can be processed from the signal handler that completes a
+	register access, so must not be entered twice. */
+	if( xProcessingBus == pdFALSE )
+	{
+		xProcessingBus = pdTRUE;
+
+		while( xSimBusNextEventTime() <= xCurrentTime )
+		{
+			vSimBusProcessEvents( xCurrentTime );
+		}
+
+		xProcessingBus = pdFALSE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static SimTime_t prvNextTimerExpiry( void )
+{
+SimTime_t xNext = simTIME_NEVER;
+SimTimer_t *pxTimer;
+
+	for( pxTimer = pxTimerList; pxTimer != NULL; pxTimer = pxTimer->pxNext )
+	{
+		if( ( pxTimer->xActive != pdFALSE ) && ( pxTimer->xExpiryTime < xNext ) )
+		{
+			xNext = pxTimer->xExpiryTime;
+		}
+	}
+
+	return xNext;
+}
+/*-----------------------------------------------------------*/
+
+static void prvProcessTimers( void )
+{
+SimTimer_t *pxTimer;
+portBASE_TYPE xExpired;
+
+	do
+	{
+		xExpired = pdFALSE;
+
+		for( pxTimer = pxTimerList; pxTimer != NULL; pxTimer = pxTimer->pxNext )
+		{
+			if( ( pxTimer->xActive != pdFALSE ) && ( pxTimer->xExpiryTime <= xCurrentTime ) )
+			{
+				if( pxTimer->uxAutoReload != pdFALSE )
+				{
+					pxTimer->xExpiryTime += ( SimTime_t ) pxTimer->xPeriod * simNS_PER_TICK;
+				}
+				else
+				{
+					pxTimer->xActive = pdFALSE;
+				}
+
+				/* The callback can change the list, so start again. */
+				pxTimer->pxCallbackFunction( ( xTimerHandle ) pxTimer );
+				xExpired = pdTRUE;
+				break;
+			}
+		}
+
+	} while( xExpired != pdFALSE );
+}
+/*-----------------------------------------------------------*/
+
+static void prvRunToNextEvent( SimTime_t xLimit )
+{
+SimTime_t xNext = xLimit;
+SimTime_t xEvent;
+
+	prvServiceInterrupts();
+
+	xEvent = xSimBusNextEventTime();
+	if( xEvent < xNext )
+	{
+		xNext = xEvent;
+	}
+
+	xEvent = xSimTimersNextEventTime();
+	if( xEvent < xNext )
+	{
+		xNext = xEvent;
+	}
+
+	xEvent = prvNextTimerExpiry();
+	if( xEvent < xNext )
+	{
+		xNext = xEvent;
+	}
+
+	/* Waiting forever with nothing left that could happen. */
+	configASSERT( xNext != simTIME_NEVER );
+
+	if( xNext > xCurrentTime )
+	{
+		xCurrentTime = xNext;
+	}
+
+	prvProcessBus();
+	prvServiceInterrupts();
+	prvProcessTimers();
+	prvServiceInterrupts();
+}
+/*-----------------------------------------------------------*/
+
+static SimTime_t prvTimeoutToDeadline( portTickType xTicksToWait )
+{
+SimTime_t xDeadline;
+
+	if( xTicksToWait == portMAX_DELAY )
+	{
+		xDeadline = simTIME_NEVER;
+	}
+	else
+	{
+		xDeadline = ( ( SimTime_t ) xTaskGetTickCount() + ( SimTime_t ) xTicksToWait ) * simNS_PER_TICK;
+	}
+
+	return xDeadline;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+	return malloc( xWantedSize );
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+	free( pv );
+}
+/*-----------------------------------------------------------*/
+
+void vPortEnterCritical( void )
+{
+	uxCriticalNesting++;
+}
+/*-----------------------------------------------------------*/
+
+void vPortExitCritical( void )
+{
+	configASSERT( uxCriticalNesting > 0U );
+	uxCriticalNesting--;
+	prvServiceInterrupts();
+}
+/*-----------------------------------------------------------*/
+
+unsigned long ulPortSetInterruptMask( void )
+{
+unsigned long ulReturn = ulInterruptMask;
+
+	ulInterruptMask = 1UL;
+	return ulReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortClearInterruptMask( unsigned long ulNewMaskValue )
+{
+	ulInterruptMask = ulNewMaskValue;
+	prvServiceInterrupts();
+}
+/*-----------------------------------------------------------*/
+
+void vPortYield( void )
+{
+	prvServiceInterrupts();
+}
+/*-----------------------------------------------------------*/
+
+portTickType xTaskGetTickCount( void )
+{
+	return ( portTickType ) ( xCurrentTime / simNS_PER_TICK );
+}
+/*-----------------------------------------------------------*/
+
+portTickType xTaskGetTickCountFromISR( void )
+{
+	return xTaskGetTickCount();
+}
+/*-----------------------------------------------------------*/
+
+xTaskHandle xTaskGetCurrentTaskHandle( void )
+{
+	return simTHE_TASK;
+}
+/*-----------------------------------------------------------*/
+
+void vTaskDelay( portTickType xTicksToDelay )
+{
+	vSimRunUntil( prvTimeoutToDeadline( xTicksToDelay ) );
+}
+/*-----------------------------------------------------------*/
+
+void vTaskDelayUntil( portTickType * const pxPreviousWakeTime, portTickType xTimeIncrement )
+{
+	*pxPreviousWakeTime += xTimeIncrement;
+	vSimRunUntil( ( SimTime_t ) *pxPreviousWakeTime * simNS_PER_TICK );
+}
+/*-----------------------------------------------------------*/
+
+void vTaskSetTimeOutState( xTimeOutType * const pxTimeOut )
+{
+	pxTimeOut->xOverflowCount = 0;
+	pxTimeOut->xTimeOnEntering = xTaskGetTickCount();
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xTaskCheckForTimeOut( xTimeOutType * const pxTimeOut, portTickType * const pxTicksToWait )
+{
+portBASE_TYPE xReturn = pdFALSE;
+portTickType xElapsed;
+
+	if( *pxTicksToWait != portMAX_DELAY )
+	{
+		xElapsed = xTaskGetTickCount() - pxTimeOut->xTimeOnEntering;
+
+		if( xElapsed < *pxTicksToWait )
+		{
+			*pxTicksToWait -= xElapsed;
+			vTaskSetTimeOutState( pxTimeOut );
+		}
+		else
+		{
+			xReturn = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+xQueueHandle xQueueGenericCreate( unsigned portBASE_TYPE uxQueueLength, unsigned portBASE_TYPE uxItemSize, unsigned char ucQueueType )
+{
+SimQueue_t *pxQueue;
+
+	pxQueue = ( SimQueue_t * ) pvPortMalloc( sizeof( SimQueue_t ) + ( uxQueueLength * uxItemSize ) );
+
+	if( pxQueue != NULL )
+	{
+		memset( pxQueue, 0x00, sizeof( SimQueue_t ) );
+		pxQueue->uxLength = uxQueueLength;
+		pxQueue->uxItemSize = uxItemSize;
+		pxQueue->ucQueueType = ucQueueType;
+		pxQueue->pucStorage = ( unsigned char * ) ( pxQueue + 1 );
+	}
+
+	return ( xQueueHandle ) pxQueue;
+}
+/*-----------------------------------------------------------*/
+
+xQueueHandle xQueueCreateMutex( unsigned char ucQueueType )
+{
+SimQueue_t *pxQueue;
+
+	pxQueue = ( SimQueue_t * ) xQueueGenericCreate( 1U, 0U, ucQueueType );
+
+	if( pxQueue != NULL )
+	{
+		pxQueue->uxMessagesWaiting = 1U;
+	}
+
+	return ( xQueueHandle ) pxQueue;
+}
+/*-----------------------------------------------------------*/
+
+xQueueHandle xQueueCreateCountingSemaphore( unsigned portBASE_TYPE uxCountValue, unsigned portBASE_TYPE uxInitialCount )
+{
+SimQueue_t *pxQueue;
+
+	pxQueue = ( SimQueue_t * ) xQueueGenericCreate( uxCountValue, 0U, queueQUEUE_TYPE_COUNTING_SEMAPHORE );
+
+	if( pxQueue != NULL )
+	{
+		pxQueue->uxMessagesWaiting = uxInitialCount;
+	}
+
+	return ( xQueueHandle ) pxQueue;
+}
+/*-----------------------------------------------------------*/
+
+void* xQueueGetMutexHolder( xQueueHandle xSemaphore )
+{
+	return ( ( SimQueue_t * ) xSemaphore )->xMutexHolder;
+}
+/*-----------------------------------------------------------*/
+
+void vQueueDelete( xQueueHandle pxQueue )
+{
+	vPortFree( pxQueue );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xQueueGenericReset( xQueueHandle pxQueue, portBASE_TYPE xNewQueue )
+{
+SimQueue_t * const pxSimQueue = ( SimQueue_t * ) pxQueue;
+
+	( void ) xNewQueue;
+
+	portENTER_CRITICAL();
+	{
+		pxSimQueue->uxMessagesWaiting = 0U;
+		pxSimQueue->uxReadFrom = 0U;
+	}
+	portEXIT_CRITICAL();
+
+	return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+unsigned portBASE_TYPE uxQueueMessagesWaiting( const xQueueHandle xQueue )
+{
+	prvServiceInterrupts();
+	return ( ( SimQueue_t * ) xQueue )->uxMessagesWaiting;
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xQueueGenericSend( xQueueHandle pxQueue, const void * const pvItemToQueue, portTickType xTicksToWait, portBASE_TYPE xCopyPosition )
+{
+SimQueue_t * const pxSimQueue = ( SimQueue_t * ) pxQueue;
+const SimTime_t xDeadline = prvTimeoutToDeadline( xTicksToWait );
+signed portBASE_TYPE xReturn = errQUEUE_FULL;
+
+	for( ;; )
+	{
+		prvServiceInterrupts();
+
+		if( pxSimQueue->uxMessagesWaiting < pxSimQueue->uxLength )
+		{
+			portENTER_CRITICAL();
+			{
+				prvCopyToQueue( pxSimQueue, pvItemToQueue, xCopyPosition );
+			}
+			portEXIT_CRITICAL();
+
+			xReturn = pdPASS;
+			break;
+		}
+
+		if( xCurrentTime >= xDeadline )
+		{
+			break;
+		}
+
+		prvRunToNextEvent( xDeadline );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xQueueGenericReceive( xQueueHandle xQueue, void * const pvBuffer, portTickType xTicksToWait, portBASE_TYPE xJustPeek )
+{
+SimQueue_t * const pxSimQueue = ( SimQueue_t * ) xQueue;
+const SimTime_t xDeadline = prvTimeoutToDeadline( xTicksToWait );
+signed portBASE_TYPE xReturn = errQUEUE_EMPTY;
+
+	for( ;; )
+	{
+		prvServiceInterrupts();
+
+		if( pxSimQueue->uxMessagesWaiting > 0U )
+		{
+			portENTER_CRITICAL();
+			{
+				prvCopyFromQueue( pxSimQueue, pvBuffer, xJustPeek );
+			}
+			portEXIT_CRITICAL();
+
+			xReturn = pdPASS;
+			break;
+		}
+
+		if( xCurrentTime >= xDeadline )
+		{
+			break;
+		}
+
+		prvRunToNextEvent( xDeadline );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xQueueGenericSendFromISR( xQueueHandle pxQueue, const void * const pvItemToQueue, signed portBASE_TYPE *pxHigherPriorityTaskWoken, portBASE_TYPE xCopyPosition )
+{
+SimQueue_t * const pxSimQueue = ( SimQueue_t * ) pxQueue;
+signed portBASE_TYPE xReturn = errQUEUE_FULL;
+
+	if( pxSimQueue->uxMessagesWaiting < pxSimQueue->uxLength )
+	{
+		prvCopyToQueue( pxSimQueue, pvItemToQueue, xCopyPosition );
+		xReturn = pdPASS;
+
+		/* The only task is always the one that was waiting. */
+		if( pxHigherPriorityTaskWoken != NULL )
+		{
+			*pxHigherPriorityTaskWoken = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+signed portBASE_TYPE xQueueReceiveFromISR( xQueueHandle pxQueue, void * const pvBuffer, signed portBASE_TYPE *pxHigherPriorityTaskWoken )
+{
+SimQueue_t * const pxSimQueue = ( SimQueue_t * ) pxQueue;
+signed portBASE_TYPE xReturn = pdFAIL;
+
+	if( pxSimQueue->uxMessagesWaiting > 0U )
+	{
+		prvCopyFromQueue( pxSimQueue, pvBuffer, pdFALSE );
+		xReturn = pdPASS;
+
+		if( pxHigherPriorityTaskWoken != NULL )
+		{
+			*pxHigherPriorityTaskWoken = pdTRUE;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyToQueue( SimQueue_t *pxQueue, const void *pvItem, portBASE_TYPE xCopyPosition )
+{
+unsigned portBASE_TYPE uxWriteTo;
+
+	if( pxQueue->uxItemSize > 0U )
+	{
+		if( xCopyPosition == queueSEND_TO_FRONT )
+		{
+			pxQueue->uxReadFrom = ( pxQueue->uxReadFrom + pxQueue->uxLength - 1U ) % pxQueue->uxLength;
+			uxWriteTo = pxQueue->uxReadFrom;
+		}
+		else
+		{
+			uxWriteTo = ( pxQueue->uxReadFrom + pxQueue->uxMessagesWaiting ) % pxQueue->uxLength;
+		}
+
+		memcpy( pxQueue->pucStorage + ( uxWriteTo * pxQueue->uxItemSize ), pvItem, pxQueue->uxItemSize );
+	}
+	else if( ( pxQueue->ucQueueType == queueQUEUE_TYPE_MUTEX ) || ( pxQueue->ucQueueType == queueQUEUE_TYPE_RECURSIVE_MUTEX ) )
+	{
+		pxQueue->xMutexHolder = NULL;
+	}
+
+	pxQueue->uxMessagesWaiting++;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCopyFromQueue( SimQueue_t *pxQueue, void *pvBuffer, portBASE_TYPE xJustPeek )
+{
+	if( pxQueue->uxItemSize > 0U )
+	{
+		memcpy( pvBuffer, pxQueue->pucStorage + ( pxQueue->uxReadFrom * pxQueue->uxItemSize ), pxQueue->uxItemSize );
+	}
+
+	if( xJustPeek == pdFALSE )
+	{
+		if( pxQueue->uxItemSize > 0U )
+		{
+			pxQueue->uxReadFrom = ( pxQueue->uxReadFrom + 1U ) % pxQueue->uxLength;
+		}
+		else if( ( pxQueue->ucQueueType == queueQUEUE_TYPE_MUTEX ) || ( pxQueue->ucQueueType == queueQUEUE_TYPE_RECURSIVE_MUTEX ) )
+		{
+			pxQueue->xMutexHolder = simTHE_TASK;
+		}
+
+		pxQueue->uxMessagesWaiting--;
+	}
+}
+/*-----------------------------------------------------------*/
+
+xTimerHandle xTimerCreate( const signed char * const pcTimerName, portTickType xTimerPeriodInTicks, unsigned portBASE_TYPE uxAutoReload, void * pvTimerID, tmrTIMER_CALLBACK pxCallbackFunction )
+{
+SimTimer_t *pxTimer;
+
+	configASSERT( xTimerPeriodInTicks > 0 );
+	pxTimer = ( SimTimer_t * ) pvPortMalloc( sizeof( SimTimer_t ) );
+
+	if( pxTimer != NULL )
+	{
+		pxTimer->pcTimerName = pcTimerName;
+		pxTimer->xPeriod = xTimerPeriodInTicks;
+		pxTimer->uxAutoReload = uxAutoReload;
+		pxTimer->pvTimerID = pvTimerID;
+		pxTimer->pxCallbackFunction = pxCallbackFunction;
+		pxTimer->xActive = pdFALSE;
+		pxTimer->xExpiryTime = simTIME_NEVER;
+		pxTimer->pxNext = pxTimerList;
+		pxTimerList = pxTimer;
+	}
+
+	return ( xTimerHandle ) pxTimer;
+}
+/*-----------------------------------------------------------*/
+
+void *pvTimerGetTimerID( xTimerHandle xTimer )
+{
+	return ( ( SimTimer_t * ) xTimer )->pvTimerID;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xTimerIsTimerActive( xTimerHandle xTimer )
+{
+	return ( ( SimTimer_t * ) xTimer )->xActive;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xTimerGenericCommand( xTimerHandle xTimer, portBASE_TYPE xCommandID, portTickType xOptionalValue, signed portBASE_TYPE *pxHigherPriorityTaskWoken, portTickType xBlockTime )
+{
+SimTimer_t * const pxTimer = ( SimTimer_t * ) xTimer;
+SimTimer_t **ppxLink;
+
+	( void ) pxHigherPriorityTaskWoken;
+	( void ) xBlockTime;
+
+	/* Commands are processed straight away, rather than being sent to the
+	timer service task. */
+	switch( xCommandID )
+	{
+		case tmrCOMMAND_START :
+			pxTimer->xExpiryTime = ( ( SimTime_t ) xOptionalValue + ( SimTime_t ) pxTimer->xPeriod ) * simNS_PER_TICK;
+			pxTimer->xActive = pdTRUE;
+			break;
+
+		case tmrCOMMAND_STOP :
+			pxTimer->xActive = pdFALSE;
+			break;
+
+		case tmrCOMMAND_CHANGE_PERIOD :
+			configASSERT( xOptionalValue > 0 );
+			pxTimer->xPeriod = xOptionalValue;
+			pxTimer->xExpiryTime = ( ( SimTime_t ) xTaskGetTickCount() + ( SimTime_t ) xOptionalValue ) * simNS_PER_TICK;
+			pxTimer->xActive = pdTRUE;
+			break;
+
+		case tmrCOMMAND_DELETE :
+			for( ppxLink = &pxTimerList; *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+			{
+				if( *ppxLink == pxTimer )
+				{
+					*ppxLink = pxTimer->pxNext;
+					vPortFree( pxTimer );
+					break;
+				}
+			}
+			break;
+
+		default :
+			configASSERT( 0 );
+			break;
+	}
+
+	return pdPASS;
+}
@@ -0,0 +1,303 @@
+/*
+ * Emulation of the memory mapped peripheral registers.
+ *
+ * The LPC17xx peripheral address ranges are mapped into the simulation process
+ * at their real addresses, so the CMSIS definitions (LPC_CAN1, NVIC, etc.) are
+ * used unchanged.  Most pages are plain memory.  The pages that hold the
+ * registers of a modelled peripheral are mapped with no access rights, so every
+ * access faults.  The SIGSEGV handler writes the current register values into
+ * the page, makes it accessible and sets the x86 trap flag.  The faulting
+ * instruction is then restarted, and the SIGTRAP raised once it has completed
+ * lets the peripheral model act on the access (a write to a command register,
+ * a read of a clear on read register, etc.) before the page is protected
+ * again.
+ */
+
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE
+#endif
+
+/* Standard includes. */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* Simulation includes. */
+#include "SimInternal.h"
+
+#if !defined( __x86_64__ ) && !defined( __i386__ )
+	#error The register emulation single steps register accesses using the x86 trap flag.
+#endif
+
+#define simPAGE_SIZE				( 4096UL )
+#define simMAX_TRAPPED_PAGES		( 16 )
+
+/* The x86 trap flag in EFLAGS, and the page fault error code bit that is set
+when the faulting access was a write. */
+#define simEFLAGS_TRAP_FLAG			( 0x100UL )
+#define simPAGE_FAULT_WRITE			( 0x02UL )
+
+/* The address ranges that are mapped.  APB0 and APB1 hold every peripheral
+used by the driver and the NXP library, and the system control space holds the
+NVIC. */
+#define simAPB0_BASE				( 0x40000000UL )
+#define simAPB0_SIZE				( 0x80000UL )
+#define simAPB1_BASE				( 0x40080000UL )
+#define simAPB1_SIZE				( 0x80000UL )
+
+/* The registers of the NVIC that have set and clear semantics. */
+#define simNVIC_ISER_OFFSET			( 0x100UL )
+#define simNVIC_ICER_OFFSET			( 0x180UL )
+#define simNVIC_ISPR_OFFSET			( 0x200UL )
+#define simNVIC_ICPR_OFFSET			( 0x280UL )
+#define simNVIC_IABR_OFFSET			( 0x300UL )
+#define simNVIC_WORDS				( 8UL )
+
+typedef struct SIM_TRAPPED_PAGE
+{
+	uint32_t ulBase;
+	SimPeripheralSync_t pxSync;
+	SimPeripheralAccess_t pxAccess;
+	void *pvContext;
+} SimTrappedPage_t;
+
+static void prvMapRange( uint32_t ulBase, uint32_t ulSize );
+static SimTrappedPage_t *prvFindTrappedPage( uintptr_t uxAddress );
+static void prvFatalFault( uintptr_t uxAddress );
+static void prvSegvHandler( int iSignal, siginfo_t *pxInfo, void *pvContext );
+static void prvTrapHandler( int iSignal, siginfo_t *pxInfo, void *pvContext );
+static void prvNVICSync( void *pvContext, volatile uint32_t *pulView );
+static void prvNVICAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+static SimTrappedPage_t xTrappedPages[ simMAX_TRAPPED_PAGES ];
+static unsigned portBASE_TYPE uxTrappedPages = 0U;
+
+/* The access that is being single stepped. */
+static SimTrappedPage_t * volatile pxAccessPage = NULL;
+static volatile uint32_t ulAccessOffset;
+static volatile portBASE_TYPE xAccessIsWrite;
+
+/* The system control space, which holds the NVIC.  Registers without set and
+clear semantics (the priorities, SCB, SysTick) are simply stored. */
+static uint32_t ulSCSRegisters[ simPAGE_SIZE / sizeof( uint32_t ) ];
+static uint32_t ulNVICEnabled[ simNVIC_WORDS ];
+static uint32_t ulNVICPending[ simNVIC_WORDS ];
+
+/*-----------------------------------------------------------*/
+
+void vSimRegistersInit( void )
+{
+struct sigaction xAction;
+
+	prvMapRange( simAPB0_BASE, simAPB0_SIZE );
+	prvMapRange( simAPB1_BASE, simAPB1_SIZE );
+	prvMapRange( SCS_BASE, simPAGE_SIZE );
+
+	memset( &xAction, 0x00, sizeof( xAction ) );
+	xAction.sa_flags = SA_SIGINFO;
+	sigemptyset( &xAction.sa_mask );
+
+	xAction.sa_sigaction = prvSegvHandler;
+	sigaction( SIGSEGV, &xAction, NULL );
+	xAction.sa_sigaction = prvTrapHandler;
+	sigaction( SIGTRAP, &xAction, NULL );
+
+	vSimTrapPeripheral( SCS_BASE, prvNVICSync, prvNVICAccess, NULL );
+}
+/*-----------------------------------------------------------*/
+
+void vSimTrapPeripheral( uint32_t ulBase, SimPeripheralSync_t pxSync, SimPeripheralAccess_t pxAccess, void *pvContext )
+{
+	configASSERT( uxTrappedPages < simMAX_TRAPPED_PAGES );
+	configASSERT( ( ulBase & ( simPAGE_SIZE - 1UL ) ) == 0UL );
+
+	xTrappedPages[ uxTrappedPages ].ulBase = ulBase;
+	xTrappedPages[ uxTrappedPages ].pxSync = pxSync;
+	xTrappedPages[ uxTrappedPages ].pxAccess = pxAccess;
+	xTrappedPages[ uxTrappedPages ].pvContext = pvContext;
+	uxTrappedPages++;
+
+	if( mprotect( ( void * ) ( uintptr_t ) ulBase, simPAGE_SIZE, PROT_NONE ) != 0 )
+	{
+		perror( "mprotect" );
+		exit( EXIT_FAILURE );
+	}
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimNVICIsEnabled( IRQn_Type xIRQ )
+{
+	return ( ( ulNVICEnabled[ ( uint32_t ) xIRQ >> 5UL ] & ( 1UL << ( ( uint32_t ) xIRQ & 0x1FUL ) ) ) != 0UL );
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimNVICIsPending( IRQn_Type xIRQ )
+{
+	return ( ( ulNVICPending[ ( uint32_t ) xIRQ >> 5UL ] & ( 1UL << ( ( uint32_t ) xIRQ & 0x1FUL ) ) ) != 0UL );
+}
+/*-----------------------------------------------------------*/
+
+void vSimNVICClearPending( IRQn_Type xIRQ )
+{
+	ulNVICPending[ ( uint32_t ) xIRQ >> 5UL ] &= ~( 1UL << ( ( uint32_t ) xIRQ & 0x1FUL ) );
+}
+/*-----------------------------------------------------------*/
+
+static void prvMapRange( uint32_t ulBase, uint32_t ulSize )
+{
+void *pvMapped;
+
+	/* The addresses are below 4GB, which Linux leaves free for a position
+	independent executable. */
+	pvMapped = mmap( ( void * ) ( uintptr_t ) ulBase, ulSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0 );
+
+	if( pvMapped != ( void * ) ( uintptr_t ) ulBase )
+	{
+		fprintf( stderr, "Could not map the peripheral range at 0x%08lx.\n", ( unsigned long ) ulBase );
+		exit( EXIT_FAILURE );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static SimTrappedPage_t *prvFindTrappedPage( uintptr_t uxAddress )
+{
+SimTrappedPage_t *pxPage = NULL;
+unsigned portBASE_TYPE ux;
+
+	for( ux = 0U; ux < uxTrappedPages; ux++ )
+	{
+		if( ( uxAddress >= xTrappedPages[ ux ].ulBase ) && ( uxAddress < ( xTrappedPages[ ux ].ulBase + simPAGE_SIZE ) ) )
+		{
+			pxPage = &( xTrappedPages[ ux ] );
+			break;
+		}
+	}
+
+	return pxPage;
+}
+/*-----------------------------------------------------------*/
+
+static void prvFatalFault( uintptr_t uxAddress )
+{
+static const char cMessage[] = "Segmentation fault outside the emulated registers.\n";
+
+	( void ) uxAddress;
+
+	/* A genuine fault.  Put the default action back, so returning re-runs the
+	faulting instruction and the process is killed as it would have been. */
+	( void ) write( STDERR_FILENO, cMessage, sizeof( cMessage ) - 1 );
+	signal( SIGSEGV, SIG_DFL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvSegvHandler( int iSignal, siginfo_t *pxInfo, void *pvContext )
+{
+ucontext_t * const pxContext = ( ucontext_t * ) pvContext;
+const uintptr_t uxAddress = ( uintptr_t ) pxInfo->si_addr;
+SimTrappedPage_t * const pxPage = prvFindTrappedPage( uxAddress );
+
+	( void ) iSignal;
+
+	if( ( pxPage == NULL ) || ( pxAccessPage != NULL ) )
+	{
+		prvFatalFault( uxAddress );
+	}
+	else
+	{
+		pxAccessPage = pxPage;
+		ulAccessOffset = ( uint32_t ) ( uxAddress - pxPage->ulBase ) & ~0x03UL;
+		xAccessIsWrite = ( ( pxContext->uc_mcontext.gregs[ REG_ERR ] & simPAGE_FAULT_WRITE ) != 0 );
+
+		mprotect( ( void * ) ( uintptr_t ) pxPage->ulBase, simPAGE_SIZE, PROT_READ | PROT_WRITE );
+		pxPage->pxSync( pxPage->pvContext, ( volatile uint32_t * ) ( uintptr_t ) pxPage->ulBase );
+
+		/* Run the faulting instruction, then stop again. */
+		pxContext->uc_mcontext.gregs[ REG_EFL ] |= simEFLAGS_TRAP_FLAG;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTrapHandler( int iSignal, siginfo_t *pxInfo, void *pvContext )
+{
+ucontext_t * const pxContext = ( ucontext_t * ) pvContext;
+SimTrappedPage_t * const pxPage = pxAccessPage;
+volatile uint32_t *pulView;
+
+	( void ) iSignal;
+	( void ) pxInfo;
+
+	if( pxPage != NULL )
+	{
+		pxContext->uc_mcontext.gregs[ REG_EFL ] &= ~simEFLAGS_TRAP_FLAG;
+		pulView = ( volatile uint32_t * ) ( uintptr_t ) pxPage->ulBase;
+
+		pxPage->pxAccess( pxPage->pvContext, ulAccessOffset, xAccessIsWrite, pulView[ ulAccessOffset / sizeof( uint32_t ) ] );
+
+		mprotect( ( void * ) ( uintptr_t ) pxPage->ulBase, simPAGE_SIZE, PROT_NONE );
+		pxAccessPage = NULL;
+
+		vSimRegisterAccessed();
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvNVICSync( void *pvContext, volatile uint32_t *pulView )
+{
+uint32_t ulWord;
+
+	( void ) pvContext;
+
+	for( ulWord = 0UL; ulWord < ( simPAGE_SIZE / sizeof( uint32_t ) ); ulWord++ )
+	{
+		pulView[ ulWord ] = ulSCSRegisters[ ulWord ];
+	}
+
+	for( ulWord = 0UL; ulWord < simNVIC_WORDS; ulWord++ )
+	{
+		pulView[ ( simNVIC_ISER_OFFSET / sizeof( uint32_t ) ) + ulWord ] = ulNVICEnabled[ ulWord ];
+		pulView[ ( simNVIC_ICER_OFFSET / sizeof( uint32_t ) ) + ulWord ] = ulNVICEnabled[ ulWord ];
+		pulView[ ( simNVIC_ISPR_OFFSET / sizeof( uint32_t ) ) + ulWord ] = ulNVICPending[ ulWord ];
+		pulView[ ( simNVIC_ICPR_OFFSET / sizeof( uint32_t ) ) + ulWord ] = ulNVICPending[ ulWord ];
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvNVICAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue )
+{
+const uint32_t ulWord = ( ulOffset & 0x7FUL ) / sizeof( uint32_t );
+
+	( void ) pvContext;
+
+	if( xWrite != pdFALSE )
+	{
+		if( ( ulOffset >= simNVIC_ISER_OFFSET ) && ( ulOffset < simNVIC_ICER_OFFSET ) )
+		{
+			ulNVICEnabled[ ulWord % simNVIC_WORDS ] |= ulValue;
+		}
+		else if( ( ulOffset >= simNVIC_ICER_OFFSET ) && ( ulOffset < simNVIC_ISPR_OFFSET ) )
+		{
+			ulNVICEnabled[ ulWord % simNVIC_WORDS ] &= ~ulValue;
+		}
+		else if( ( ulOffset >= simNVIC_ISPR_OFFSET ) && ( ulOffset < simNVIC_ICPR_OFFSET ) )
+		{
+			ulNVICPending[ ulWord % simNVIC_WORDS ] |= ulValue;
+		}
+		else if( ( ulOffset >= simNVIC_ICPR_OFFSET ) && ( ulOffset < simNVIC_IABR_OFFSET ) )
+		{
+			ulNVICPending[ ulWord % simNVIC_WORDS ] &= ~ulValue;
+		}
+		else
+		{
+			ulSCSRegisters[ ulOffset / sizeof( uint32_t ) ] = ulValue;
+		}
+	}
+}
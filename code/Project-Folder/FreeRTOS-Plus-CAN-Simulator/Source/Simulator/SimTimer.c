@@ -0,0 +1,320 @@
+/*
+ * Register level model of the four LPC17xx timers, as far as they are used to
+ * count time and to raise match interrupts.
+ *
+ * The timer counter and prescale counter advance with simulated time, at the
+ * rate given by the timer's peripheral clock in PCLKSEL0 or PCLKSEL1 and by its
+ * prescale register.  The counter is started, stopped and reset through the
+ * timer control register.  When the counter reaches a match register, the
+ * actions selected in the match control register are taken - the match flag is
+ * set in the interrupt register, which asserts the timer's interrupt line until
+ * the flag is cleared by writing a 1 to it, and the counter is reset or stopped.
+ * A reset on match takes effect at the match, rather than one count later.
+ * Capture registers are stored, but never capture, and match outputs are not
+ * modelled.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+
+/* Simulation includes. */
+#include "SimInternal.h"
+
+#define simNUM_TIMERS				( 4U )
+
+/* Register offsets within a timer's page. */
+#define simTIM_IR					( 0x00UL )
+#define simTIM_TCR					( 0x04UL )
+#define simTIM_TC					( 0x08UL )
+#define simTIM_PR					( 0x0CUL )
+#define simTIM_PC					( 0x10UL )
+#define simTIM_MCR					( 0x14UL )
+#define simTIM_MR0					( 0x18UL )
+#define simTIM_WORDS				( ( 0x70UL / sizeof( uint32_t ) ) + 1UL )
+
+/* Bits in the timer control register. */
+#define simTCR_ENABLE				( 0x01UL )
+#define simTCR_RESET				( 0x02UL )
+
+/* The match channels, the bits of each in the match control register, and the
+match flags in the interrupt register. */
+#define simNUM_MATCH_CHANNELS		( 4U )
+#define simMCR_INTERRUPT			( 0x01UL )
+#define simMCR_RESET				( 0x02UL )
+#define simMCR_STOP					( 0x04UL )
+#define simMCR_CHANNEL_BITS			( 3UL )
+#define simIR_MATCH_FLAGS			( 0x0FUL )
+
+/* A match that will never occur. */
+#define simNO_MATCH					( UINT64_MAX )
+
+/* Shorthand for a register of a timer. */
+#define simTIMER_REGISTER( pxTimer, ulOffset )	( ( pxTimer )->ulRegisters[ ( ulOffset ) / sizeof( uint32_t ) ] )
+
+typedef struct SIM_TIMER
+{
+	uint32_t ulBase;
+	volatile uint32_t *pulPCLKSEL;		/* The peripheral clock selection register, */
+	uint32_t ulPCLKSELShift;			/* and the position of the timer's field in it. */
+	uint32_t ulRegisters[ simTIM_WORDS ];
+	uint64_t ullAnchorCycles;			/* The peripheral clock cycle at which TC and PC were last brought up to date. */
+	uint64_t ullMatchCycles[ simNUM_MATCH_CHANNELS ];	/* The peripheral clock cycle of the next match on each channel, or simNO_MATCH. */
+	SimTime_t xNextMatchTime;			/* The time of the earliest of those matches, or simTIME_NEVER. */
+} SimTimer_t;
+
+static SimTimer_t xTimers[ simNUM_TIMERS ];
+
+static void prvTimerSync( void *pvContext, volatile uint32_t *pulView );
+static void prvTimerAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue );
+static uint32_t prvPeripheralClock( const SimTimer_t *pxTimer );
+static void prvTimerUpdate( SimTimer_t *pxTimer, uint64_t ullNow );
+static void prvAdvanceCounters( SimTimer_t *pxTimer, uint64_t ullTo );
+static void prvScheduleMatches( SimTimer_t *pxTimer );
+
+/*-----------------------------------------------------------*/
+
+void vSimTimersInit( void )
+{
+static const uint32_t ulBases[ simNUM_TIMERS ] = { LPC_TIM0_BASE, LPC_TIM1_BASE, LPC_TIM2_BASE, LPC_TIM3_BASE };
+static const uint32_t ulShifts[ simNUM_TIMERS ] = { 2UL, 4UL, 12UL, 14UL };
+unsigned portBASE_TYPE ux;
+
+	memset( xTimers, 0x00, sizeof( xTimers ) );
+
+	for( ux = 0U; ux < simNUM_TIMERS; ux++ )
+	{
+		xTimers[ ux ].ulBase = ulBases[ ux ];
+		xTimers[ ux ].pulPCLKSEL = ( ux < 2U ) ? &( LPC_SC->PCLKSEL0 ) : &( LPC_SC->PCLKSEL1 );
+		xTimers[ ux ].ulPCLKSELShift = ulShifts[ ux ];
+		prvScheduleMatches( &( xTimers[ ux ] ) );
+
+		vSimTrapPeripheral( xTimers[ ux ].ulBase, prvTimerSync, prvTimerAccess, &( xTimers[ ux ] ) );
+	}
+}
+/*-----------------------------------------------------------*/
+
+SimTime_t xSimTimersNextEventTime( void )
+{
+SimTime_t xNext = simTIME_NEVER;
+unsigned portBASE_TYPE ux;
+
+	for( ux = 0U; ux < simNUM_TIMERS; ux++ )
+	{
+		if( xTimers[ ux ].xNextMatchTime < xNext )
+		{
+			xNext = xTimers[ ux ].xNextMatchTime;
+		}
+	}
+
+	return xNext;
+}
+/*-----------------------------------------------------------*/
+
+void vSimTimersProcessEvents( SimTime_t xNow )
+{
+unsigned portBASE_TYPE ux;
+
+	for( ux = 0U; ux < simNUM_TIMERS; ux++ )
+	{
+		if( xTimers[ ux ].xNextMatchTime <= xNow )
+		{
+			prvTimerUpdate( &( xTimers[ ux ] ), ( uint64_t ) ( ( ( unsigned __int128 ) xNow * prvPeripheralClock( &( xTimers[ ux ] ) ) ) / simNS_PER_SECOND ) );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xSimTimerInterruptAsserted( unsigned portBASE_TYPE uxTimer )
+{
+	configASSERT( uxTimer < simNUM_TIMERS );
+	return ( ( simTIMER_REGISTER( &( xTimers[ uxTimer ] ), simTIM_IR ) & simIR_MATCH_FLAGS ) != 0UL );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvPeripheralClock( const SimTimer_t *pxTimer )
+{
+uint32_t ulPeripheralClock;
+
+	/* PCLKSEL0 and PCLKSEL1 are plain memory, written by the NXP clock and
+	power library.  Unlike the CAN controllers, the timers divide by 8 when
+	the field is 3. */
+	switch( ( *( pxTimer->pulPCLKSEL ) >> pxTimer->ulPCLKSELShift ) & 0x03UL )
+	{
+		case 0UL :	ulPeripheralClock = SystemCoreClock / 4UL;	break;
+		case 1UL :	ulPeripheralClock = SystemCoreClock;		break;
+		case 2UL :	ulPeripheralClock = SystemCoreClock / 2UL;	break;
+		default :	ulPeripheralClock = SystemCoreClock / 8UL;	break;
+	}
+
+	return ulPeripheralClock;
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerUpdate( SimTimer_t *pxTimer, uint64_t ullNow )
+{
+uint64_t ullMatch;
+uint32_t ulChannel, ulActions;
+unsigned portBASE_TYPE ux;
+
+	/* Take every match that falls before ullNow, earliest first, as a reset or
+	stop on one match changes when the next occurs. */
+	for( ;; )
+	{
+		ullMatch = simNO_MATCH;
+		ulChannel = 0UL;
+
+		for( ux = 0U; ux < simNUM_MATCH_CHANNELS; ux++ )
+		{
+			if( pxTimer->ullMatchCycles[ ux ] < ullMatch )
+			{
+				ullMatch = pxTimer->ullMatchCycles[ ux ];
+				ulChannel = ( uint32_t ) ux;
+			}
+		}
+
+		if( ullMatch > ullNow )
+		{
+			break;
+		}
+
+		prvAdvanceCounters( pxTimer, ullMatch );
+		ulActions = simTIMER_REGISTER( pxTimer, simTIM_MCR ) >> ( ulChannel * simMCR_CHANNEL_BITS );
+
+		if( ( ulActions & simMCR_INTERRUPT ) != 0UL )
+		{
+			simTIMER_REGISTER( pxTimer, simTIM_IR ) |= ( 1UL << ulChannel );
+		}
+
+		if( ( ulActions & simMCR_RESET ) != 0UL )
+		{
+			simTIMER_REGISTER( pxTimer, simTIM_TC ) = 0UL;
+			simTIMER_REGISTER( pxTimer, simTIM_PC ) = 0UL;
+		}
+
+		if( ( ulActions & simMCR_STOP ) != 0UL )
+		{
+			simTIMER_REGISTER( pxTimer, simTIM_TCR ) &= ~simTCR_ENABLE;
+		}
+
+		prvScheduleMatches( pxTimer );
+	}
+
+	prvAdvanceCounters( pxTimer, ullNow );
+}
+/*-----------------------------------------------------------*/
+
+static void prvAdvanceCounters( SimTimer_t *pxTimer, uint64_t ullTo )
+{
+uint64_t ullPrescaleCounts;
+const uint64_t ullPrescale = ( uint64_t ) simTIMER_REGISTER( pxTimer, simTIM_PR ) + 1ULL;
+
+	/* PC counts peripheral clock cycles up to PR, and TC counts each time PC
+	wraps. */
+	if( ( simTIMER_REGISTER( pxTimer, simTIM_TCR ) & ( simTCR_ENABLE | simTCR_RESET ) ) == simTCR_ENABLE )
+	{
+		ullPrescaleCounts = ( uint64_t ) simTIMER_REGISTER( pxTimer, simTIM_PC ) + ( ullTo - pxTimer->ullAnchorCycles );
+		simTIMER_REGISTER( pxTimer, simTIM_TC ) += ( uint32_t ) ( ullPrescaleCounts / ullPrescale );
+		simTIMER_REGISTER( pxTimer, simTIM_PC ) = ( uint32_t ) ( ullPrescaleCounts % ullPrescale );
+	}
+
+	pxTimer->ullAnchorCycles = ullTo;
+}
+/*-----------------------------------------------------------*/
+
+static void prvScheduleMatches( SimTimer_t *pxTimer )
+{
+const uint64_t ullPrescale = ( uint64_t ) simTIMER_REGISTER( pxTimer, simTIM_PR ) + 1ULL;
+const uint32_t ulPeripheralClock = prvPeripheralClock( pxTimer );
+uint64_t ullCounts, ullEarliest = simNO_MATCH;
+uint32_t ulMatch;
+unsigned portBASE_TYPE ux;
+
+	/* Called with TC and PC up to date at ullAnchorCycles.  A channel matches
+	when TC next counts up to its match register, which is a full wrap of the
+	counter away if TC is already there. */
+	for( ux = 0U; ux < simNUM_MATCH_CHANNELS; ux++ )
+	{
+		pxTimer->ullMatchCycles[ ux ] = simNO_MATCH;
+
+		if( ( ( simTIMER_REGISTER( pxTimer, simTIM_TCR ) & ( simTCR_ENABLE | simTCR_RESET ) ) == simTCR_ENABLE ) &&
+			( ( ( simTIMER_REGISTER( pxTimer, simTIM_MCR ) >> ( ( uint32_t ) ux * simMCR_CHANNEL_BITS ) ) & ( simMCR_INTERRUPT | simMCR_RESET | simMCR_STOP ) ) != 0UL ) )
+		{
+			ulMatch = simTIMER_REGISTER( pxTimer, simTIM_MR0 + ( ( uint32_t ) ux * sizeof( uint32_t ) ) );
+			ullCounts = ( uint64_t ) ( ulMatch - simTIMER_REGISTER( pxTimer, simTIM_TC ) );
+
+			if( ullCounts == 0ULL )
+			{
+				ullCounts = 1ULL << 32;
+			}
+
+			pxTimer->ullMatchCycles[ ux ] = pxTimer->ullAnchorCycles + ( ullCounts * ullPrescale ) - simTIMER_REGISTER( pxTimer, simTIM_PC );
+
+			if( pxTimer->ullMatchCycles[ ux ] < ullEarliest )
+			{
+				ullEarliest = pxTimer->ullMatchCycles[ ux ];
+			}
+		}
+	}
+
+	/* The first nanosecond by which the peripheral clock has reached the
+	cycle of the match. */
+	if( ( ullEarliest == simNO_MATCH ) || ( ulPeripheralClock == 0UL ) )
+	{
+		pxTimer->xNextMatchTime = simTIME_NEVER;
+	}
+	else
+	{
+		pxTimer->xNextMatchTime = ( SimTime_t ) ( ( ( ( unsigned __int128 ) ullEarliest * simNS_PER_SECOND ) + ulPeripheralClock - 1U ) / ulPeripheralClock );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerSync( void *pvContext, volatile uint32_t *pulView )
+{
+SimTimer_t * const pxTimer = ( SimTimer_t * ) pvContext;
+uint32_t ulWord;
+
+	/* Counting whole cycles from time zero, rather than from the last access,
+	means no fraction of a cycle is ever lost however often the timer is
+	read. */
+	prvTimerUpdate( pxTimer, ( uint64_t ) ( ( ( unsigned __int128 ) xSimGetTime() * prvPeripheralClock( pxTimer ) ) / simNS_PER_SECOND ) );
+
+	for( ulWord = 0UL; ulWord < simTIM_WORDS; ulWord++ )
+	{
+		pulView[ ulWord ] = pxTimer->ulRegisters[ ulWord ];
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTimerAccess( void *pvContext, uint32_t ulOffset, portBASE_TYPE xWrite, uint32_t ulValue )
+{
+SimTimer_t * const pxTimer = ( SimTimer_t * ) pvContext;
+
+	/* The counters were brought up to date by the sync that preceded the
+	access, so a write takes effect from now. */
+	if( ( xWrite != pdFALSE ) && ( ulOffset < ( simTIM_WORDS * sizeof( uint32_t ) ) ) )
+	{
+		if( ulOffset == simTIM_IR )
+		{
+			/* Flags are cleared by writing a 1 to them. */
+			simTIMER_REGISTER( pxTimer, simTIM_IR ) &= ~ulValue;
+		}
+		else
+		{
+			pxTimer->ulRegisters[ ulOffset / sizeof( uint32_t ) ] = ulValue;
+		}
+
+		/* The counters are held at zero while the reset bit is set. */
+		if( ( simTIMER_REGISTER( pxTimer, simTIM_TCR ) & simTCR_RESET ) != 0UL )
+		{
+			simTIMER_REGISTER( pxTimer, simTIM_TC ) = 0UL;
+			simTIMER_REGISTER( pxTimer, simTIM_PC ) = 0UL;
+		}
+
+		prvScheduleMatches( pxTimer );
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,23 @@
+/*
+ * The part of the lwIP sockets API used by the lwIP applications built into
+ * the simulation, mapped onto the host's own sockets so the applications can
+ * exchange datagrams with real peers on the host.  Socket calls take no
+ * simulated time.
+ */
+
+#ifndef SIM_LWIP_SOCKETS_H
+#define SIM_LWIP_SOCKETS_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#define lwip_socket					socket
+#define lwip_bind					bind
+#define lwip_sendto					sendto
+#define lwip_recvfrom				recvfrom
+#define lwip_close					close
+
+#endif /* SIM_LWIP_SOCKETS_H */
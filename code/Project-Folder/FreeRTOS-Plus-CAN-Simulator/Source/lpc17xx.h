@@ -0,0 +1,5 @@
+/*
+ * The driver library includes "lpc17xx.h", which only resolves to the CMSIS
+ * "LPC17xx.h" on a case insensitive file system.
+ */
+#include "LPC17xx.h"
@@ -0,0 +1,443 @@
+/*
+ * Compiles the messages and signals of a DBC file into the constant tables
+ * described in FreeRTOS-Plus-Demo-2/Source/CANSignals/CANSignalTable.h, for
+ * the signal decoder in CANSignals.c.
+ *
+ *   can-dbc-compile <DBC file> <name> <output directory>
+ *
+ * writes <name>.c, which defines the database x<name>, and <name>.h, which
+ * declares it and defines the index of every signal as
+ * <NAME>_<MESSAGE>_<SIGNAL>, in upper case.  The messages are sorted by ID,
+ * and where each signal lies in the payload is worked out here, so the target
+ * does no more than a shift and a mask to extract it.
+ *
+ * Only the BO_ and SG_ lines of the file are read.  Multiplexed signals are
+ * not supported, and are reported as an error, as are signals that do not fit
+ * in the length of their message.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+
+/* Set in the ID of a message with a 29 bit ID, as in CANSignalTable.h. */
+#define dbcEXTENDED_ID				( 0x80000000UL )
+
+#define dbcMAX_MESSAGES				( 1024U )
+#define dbcMAX_SIGNALS				( 8192U )
+#define dbcMAX_NAME					( 64U )
+#define dbcMAX_LINE					( 1024U )
+
+typedef struct DBC_SIGNAL
+{
+	char cName[ dbcMAX_NAME ];
+	unsigned uStartBit;
+	unsigned uLength;
+	unsigned uShift;
+	int iBigEndian;
+	int iSigned;
+	double dScale;
+	double dOffset;
+} DBCSignal_t;
+
+typedef struct DBC_MESSAGE
+{
+	char cName[ dbcMAX_NAME ];
+	uint32_t ulID;
+	unsigned uLength;
+	unsigned uFirstSignal;				/* In the order the signals were read. */
+	unsigned uSignals;
+} DBCMessage_t;
+
+/*
+ * Read the BO_ and SG_ lines of the file.  Returns 0 and reports the line at
+ * fault if the file cannot be compiled.
+ */
+static int prvReadDBC( const char *pcFileName );
+
+/*
+ * Work out the shift of a signal within its message, as CANSignalTable.h
+ * describes it.  Returns 0 if the signal does not fit.
+ */
+static int prvPlaceSignal( DBCSignal_t *pxSignal, const DBCMessage_t *pxMessage );
+
+static int prvCompareMessages( const void *pvA, const void *pvB );
+
+static int prvWriteSource( const char *pcDirectory, const char *pcName );
+static int prvWriteHeader( const char *pcDirectory, const char *pcName );
+
+/*
+ * Write a floating point constant that C reads as a float.
+ */
+static void prvWriteFloat( FILE *pxFile, double dValue );
+
+/*
+ * Write pcText in upper case.
+ */
+static void prvWriteUpper( FILE *pxFile, const char *pcText );
+
+/*-----------------------------------------------------------*/
+
+static DBCMessage_t xMessages[ dbcMAX_MESSAGES ];
+static DBCSignal_t xSignals[ dbcMAX_SIGNALS ];
+static unsigned uMessages = 0U, uSignals = 0U;
+static const char *pcSourceName = NULL;
+
+/*-----------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+int iReturn = EXIT_FAILURE;
+
+	if( argc != 4 )
+	{
+		fprintf( stderr, "usage: %s <DBC file> <name> <output directory>\n", argv[ 0 ] );
+	}
+	else if( prvReadDBC( argv[ 1 ] ) != 0 )
+	{
+		pcSourceName = strrchr( argv[ 1 ], '/' );
+		pcSourceName = ( pcSourceName == NULL ) ? argv[ 1 ] : ( pcSourceName + 1 );
+
+		qsort( xMessages, uMessages, sizeof( xMessages[ 0 ] ), prvCompareMessages );
+
+		if( ( prvWriteSource( argv[ 3 ], argv[ 2 ] ) != 0 ) && ( prvWriteHeader( argv[ 3 ], argv[ 2 ] ) != 0 ) )
+		{
+			iReturn = EXIT_SUCCESS;
+		}
+	}
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int prvReadDBC( const char *pcFileName )
+{
+FILE *pxFile;
+char cLine[ dbcMAX_LINE ], cName[ dbcMAX_NAME ], cOrder, cSign;
+const char *pcLine;
+unsigned uLineNumber = 0U, uLength;
+unsigned long ulID;
+int iValid = 1, iUsed;
+DBCMessage_t *pxMessage = NULL;
+DBCSignal_t *pxSignal;
+const char *pcError = NULL;
+
+	pxFile = fopen( pcFileName, "r" );
+	if( pxFile == NULL )
+	{
+		perror( pcFileName );
+		return 0;
+	}
+
+	while( ( iValid != 0 ) && ( fgets( cLine, sizeof( cLine ), pxFile ) != NULL ) )
+	{
+		uLineNumber++;
+
+		for( pcLine = cLine; isspace( ( unsigned char ) *pcLine ) != 0; pcLine++ )
+		{
+		}
+
+		if( strncmp( pcLine, "BO_ ", 4 ) == 0 )
+		{
+			/* BO_ <ID> <name>: <length> <transmitter> */
+			if( sscanf( pcLine, "BO_ %lu %63[A-Za-z0-9_]: %u", &ulID, cName, &uLength ) != 3 )
+			{
+				pcError = "cannot read message";
+			}
+			else if( uMessages == dbcMAX_MESSAGES )
+			{
+				pcError = "too many messages";
+			}
+			else if( uLength > 8U )
+			{
+				pcError = "message longer than 8 bytes";
+			}
+			else
+			{
+				pxMessage = &( xMessages[ uMessages ] );
+				uMessages++;
+				memset( pxMessage, 0x00, sizeof( *pxMessage ) );
+				snprintf( pxMessage->cName, sizeof( pxMessage->cName ), "%s", cName );
+				pxMessage->ulID = ( uint32_t ) ulID;
+				pxMessage->uLength = uLength;
+				pxMessage->uFirstSignal = uSignals;
+			}
+		}
+		else if( strncmp( pcLine, "SG_ ", 4 ) == 0 )
+		{
+			/* SG_ <name> : <start>|<length>@<order><sign> (<scale>,<offset>) ... */
+			pxSignal = &( xSignals[ uSignals ] );
+
+			if( pxMessage == NULL )
+			{
+				pcError = "signal outside a message";
+			}
+			else if( uSignals == dbcMAX_SIGNALS )
+			{
+				pcError = "too many signals";
+			}
+			else if( ( sscanf( pcLine, "SG_ %63[A-Za-z0-9_] %n", cName, &iUsed ) != 1 ) || ( pcLine[ iUsed ] != ':' ) )
+			{
+				pcError = "cannot read signal, or multiplexed signal";
+			}
+			else if( sscanf( &( pcLine[ iUsed ] ), ": %u|%u@%c%c (%lf,%lf)", &( pxSignal->uStartBit ), &( pxSignal->uLength ), &cOrder, &cSign, &( pxSignal->dScale ), &( pxSignal->dOffset ) ) != 6 )
+			{
+				pcError = "cannot read signal";
+			}
+			else if( ( ( cOrder != '0' ) && ( cOrder != '1' ) ) || ( ( cSign != '+' ) && ( cSign != '-' ) ) )
+			{
+				pcError = "unknown byte order or sign";
+			}
+			else
+			{
+				snprintf( pxSignal->cName, sizeof( pxSignal->cName ), "%s", cName );
+				pxSignal->iBigEndian = ( cOrder == '0' );
+				pxSignal->iSigned = ( cSign == '-' );
+
+				if( prvPlaceSignal( pxSignal, pxMessage ) == 0 )
+				{
+					pcError = "signal does not fit in its message";
+				}
+				else
+				{
+					uSignals++;
+					( pxMessage->uSignals )++;
+				}
+			}
+		}
+		else
+		{
+			/* Comments, attributes, value tables and the rest are not
+			needed to decode the signals. */
+		}
+
+		if( pcError != NULL )
+		{
+			fprintf( stderr, "%s:%u: %s\n", pcFileName, uLineNumber, pcError );
+			iValid = 0;
+		}
+	}
+
+	fclose( pxFile );
+
+	if( ( iValid != 0 ) && ( uSignals == 0U ) )
+	{
+		fprintf( stderr, "%s: no signals\n", pcFileName );
+		iValid = 0;
+	}
+
+	return iValid;
+}
+/*-----------------------------------------------------------*/
+
+static int prvPlaceSignal( DBCSignal_t *pxSignal, const DBCMessage_t *pxMessage )
+{
+const unsigned uBits = pxMessage->uLength * 8U;
+unsigned uMostSignificant;
+int iFits = 0;
+
+	if( ( pxSignal->uLength >= 1U ) && ( pxSignal->uLength <= 64U ) && ( pxSignal->uStartBit < uBits ) )
+	{
+		if( pxSignal->iBigEndian == 0 )
+		{
+			/* The start bit is the least significant bit, counted from bit 0
+			of byte 0 upwards, which is its bit in the little endian word. */
+			pxSignal->uShift = pxSignal->uStartBit;
+			iFits = ( ( pxSignal->uStartBit + pxSignal->uLength ) <= uBits );
+		}
+		else
+		{
+			/* The start bit is the most significant bit, numbered as above.
+			In the big endian word bit b of byte n is bit ( 7 - n ) * 8 + b,
+			and the signal extends down from there. */
+			uMostSignificant = ( ( 7U - ( pxSignal->uStartBit / 8U ) ) * 8U ) + ( pxSignal->uStartBit % 8U );
+
+			if( ( uMostSignificant + 1U ) >= pxSignal->uLength )
+			{
+				pxSignal->uShift = uMostSignificant + 1U - pxSignal->uLength;
+
+				/* The byte holding the least significant bit must be within
+				the message. */
+				iFits = ( ( 7U - ( pxSignal->uShift / 8U ) ) < pxMessage->uLength );
+			}
+		}
+	}
+
+	return iFits;
+}
+/*-----------------------------------------------------------*/
+
+static int prvCompareMessages( const void *pvA, const void *pvB )
+{
+const DBCMessage_t *pxA = ( const DBCMessage_t * ) pvA, *pxB = ( const DBCMessage_t * ) pvB;
+
+	return ( pxA->ulID < pxB->ulID ) ? -1 : ( ( pxA->ulID > pxB->ulID ) ? 1 : 0 );
+}
+/*-----------------------------------------------------------*/
+
+static int prvWriteSource( const char *pcDirectory, const char *pcName )
+{
+char cPath[ 1024 ];
+FILE *pxFile;
+unsigned uMessage, uSignal, uIndex = 0U;
+const DBCSignal_t *pxSignal;
+int iValid = 1;
+
+	for( uMessage = 1U; uMessage < uMessages; uMessage++ )
+	{
+		if( xMessages[ uMessage ].ulID == xMessages[ uMessage - 1U ].ulID )
+		{
+			fprintf( stderr, "%s: messages %s and %s have the same ID\n", pcSourceName, xMessages[ uMessage - 1U ].cName, xMessages[ uMessage ].cName );
+			return 0;
+		}
+	}
+
+	snprintf( cPath, sizeof( cPath ), "%s/%s.c", pcDirectory, pcName );
+	pxFile = fopen( cPath, "w" );
+	if( pxFile == NULL )
+	{
+		perror( cPath );
+		return 0;
+	}
+
+	fprintf( pxFile, "/* Generated from %s by can-dbc-compile.  Do not edit. */\n\n", pcSourceName );
+	fprintf( pxFile, "#include \"%s.h\"\n\n", pcName );
+
+	/* The signals, in the order of their messages. */
+	fprintf( pxFile, "static const CAN_Signal_Def_t xSignals[ %u ] =\n{\n", uSignals );
+	for( uMessage = 0U; uMessage < uMessages; uMessage++ )
+	{
+		for( uSignal = 0U; uSignal < xMessages[ uMessage ].uSignals; uSignal++ )
+		{
+			pxSignal = &( xSignals[ xMessages[ uMessage ].uFirstSignal + uSignal ] );
+			fprintf( pxFile, "\t{ %2uU, %2uU, %s, %2uU, ", pxSignal->uShift, pxSignal->uLength,
+					 ( pxSignal->iBigEndian != 0 ) ? ( ( pxSignal->iSigned != 0 ) ? "cansigBIG_ENDIAN | cansigSIGNED" : "cansigBIG_ENDIAN" ) : ( ( pxSignal->iSigned != 0 ) ? "cansigSIGNED" : "0U" ),
+					 pxSignal->uStartBit );
+			prvWriteFloat( pxFile, pxSignal->dScale );
+			fprintf( pxFile, ", " );
+			prvWriteFloat( pxFile, pxSignal->dOffset );
+			fprintf( pxFile, " }%s\t/* %u: %s.%s */\n", ( ( uIndex + 1U ) < uSignals ) ? "," : "", uIndex, xMessages[ uMessage ].cName, pxSignal->cName );
+			uIndex++;
+		}
+	}
+	fprintf( pxFile, "};\n\n" );
+
+	/* The messages, in ascending order of ID. */
+	uIndex = 0U;
+	fprintf( pxFile, "static const CAN_Message_Def_t xMessages[ %u ] =\n{\n", uMessages );
+	for( uMessage = 0U; uMessage < uMessages; uMessage++ )
+	{
+		fprintf( pxFile, "\t{ 0x%08lXUL, %uU, %uU, %uU }%s\t/* %s */\n", ( unsigned long ) xMessages[ uMessage ].ulID, xMessages[ uMessage ].uLength, uIndex, xMessages[ uMessage ].uSignals, ( ( uMessage + 1U ) < uMessages ) ? "," : "", xMessages[ uMessage ].cName );
+		uIndex += xMessages[ uMessage ].uSignals;
+	}
+	fprintf( pxFile, "};\n\n" );
+
+	fprintf( pxFile, "static const char * const pcSignalNames[ %u ] =\n{\n", uSignals );
+	uIndex = 0U;
+	for( uMessage = 0U; uMessage < uMessages; uMessage++ )
+	{
+		for( uSignal = 0U; uSignal < xMessages[ uMessage ].uSignals; uSignal++ )
+		{
+			uIndex++;
+			fprintf( pxFile, "\t\"%s.%s\"%s\n", xMessages[ uMessage ].cName, xSignals[ xMessages[ uMessage ].uFirstSignal + uSignal ].cName, ( uIndex < uSignals ) ? "," : "" );
+		}
+	}
+	fprintf( pxFile, "};\n\n" );
+
+	fprintf( pxFile, "const CAN_Signal_Database_t x%s =\n{\n\txMessages,\n\txSignals,\n\tpcSignalNames,\n\t%uU,\n\t%uU\n};\n", pcName, uMessages, uSignals );
+
+	if( fclose( pxFile ) != 0 )
+	{
+		perror( cPath );
+		iValid = 0;
+	}
+
+	return iValid;
+}
+/*-----------------------------------------------------------*/
+
+static int prvWriteHeader( const char *pcDirectory, const char *pcName )
+{
+char cPath[ 1024 ];
+FILE *pxFile;
+unsigned uMessage, uSignal, uIndex = 0U;
+int iValid = 1;
+
+	snprintf( cPath, sizeof( cPath ), "%s/%s.h", pcDirectory, pcName );
+	pxFile = fopen( cPath, "w" );
+	if( pxFile == NULL )
+	{
+		perror( cPath );
+		return 0;
+	}
+
+	fprintf( pxFile, "/* Generated from %s by can-dbc-compile.  Do not edit. */\n\n", pcSourceName );
+	fprintf( pxFile, "#ifndef " );
+	prvWriteUpper( pxFile, pcName );
+	fprintf( pxFile, "_H\n#define " );
+	prvWriteUpper( pxFile, pcName );
+	fprintf( pxFile, "_H\n\n#include \"CANSignalTable.h\"\n\n" );
+
+	fprintf( pxFile, "extern const CAN_Signal_Database_t x%s;\n\n", pcName );
+
+	fprintf( pxFile, "#define " );
+	prvWriteUpper( pxFile, pcName );
+	fprintf( pxFile, "_MESSAGES\t( %uU )\n#define ", uMessages );
+	prvWriteUpper( pxFile, pcName );
+	fprintf( pxFile, "_SIGNALS\t( %uU )\n\n", uSignals );
+
+	for( uMessage = 0U; uMessage < uMessages; uMessage++ )
+	{
+		for( uSignal = 0U; uSignal < xMessages[ uMessage ].uSignals; uSignal++ )
+		{
+			fprintf( pxFile, "#define " );
+			prvWriteUpper( pxFile, pcName );
+			fprintf( pxFile, "_" );
+			prvWriteUpper( pxFile, xMessages[ uMessage ].cName );
+			fprintf( pxFile, "_" );
+			prvWriteUpper( pxFile, xSignals[ xMessages[ uMessage ].uFirstSignal + uSignal ].cName );
+			fprintf( pxFile, "\t( %uU )\n", uIndex );
+			uIndex++;
+		}
+	}
+
+	fprintf( pxFile, "\n#endif\n" );
+
+	if( fclose( pxFile ) != 0 )
+	{
+		perror( cPath );
+		iValid = 0;
+	}
+
+	return iValid;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteFloat( FILE *pxFile, double dValue )
+{
+char cValue[ 40 ];
+
+	snprintf( cValue, sizeof( cValue ), "%.9g", dValue );
+
+	/* 1 must be written as 1.0F, not 1F. */
+	if( strpbrk( cValue, ".eEin" ) == NULL )
+	{
+		strcat( cValue, ".0" );
+	}
+
+	fprintf( pxFile, "%sF", cValue );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteUpper( FILE *pxFile, const char *pcText )
+{
+	while( *pcText != '\0' )
+	{
+		fputc( toupper( ( unsigned char ) *pcText ), pxFile );
+		pcText++;
+	}
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,282 @@
+/*
+ * Converts a binary log written by the CAN logger in
+ * FreeRTOS-Plus-Demo-2/Source/CANLogger to text, or to CSV.  See
+ * CANLogFormat.h for the format of the log.
+ *
+ *   can-log-decode [--csv] <log file>
+ *
+ * Each frame is written as one line, in the order the frames were received,
+ * with its timestamp in seconds.  Frames the driver discarded because its Rx
+ * queue was full are reported where the log recorded them.  Decoding stops at
+ * the end of the file, or at the first block that was not written by the log -
+ * which is where a log that was not closed, for example because the power
+ * failed, ends in its preallocated file.  A summary is written to stderr.
+ */
+
+/* Standard includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+/* Log format. */
+#include "CANLogFormat.h"
+
+/* The log as decoded so far. */
+typedef struct DECODE_STATE
+{
+	uint32_t ulSession;
+	uint32_t ulResolutionNs;
+	uint64_t ullTimeBase;
+	uint32_t ulFrames;
+	uint32_t ulFramesLost;
+	uint32_t ulBlocks;
+	int iCSV;
+} DecodeState_t;
+
+/*
+ * Decode the index block or data block ulBlock.  Returns 0 if the block was
+ * not written by the log, so marks its end.
+ */
+static int prvDecodeIndexBlock( DecodeState_t *pxState, const uint8_t *pucBlock, uint32_t ulBlock );
+static int prvDecodeDataBlock( DecodeState_t *pxState, const uint8_t *pucBlock, uint32_t ulBlock );
+
+/*
+ * Write one frame, or one overrun event, to stdout.
+ */
+static void prvPrintFrame( const DecodeState_t *pxState, uint64_t ullTime, uint32_t ulID, uint8_t ucLength, const uint8_t *pucData );
+static void prvPrintOverrun( const DecodeState_t *pxState, uint64_t ullTime, uint32_t ulFramesLost );
+
+static uint16_t prvReadLittleEndian16( const uint8_t *pucBytes );
+static uint32_t prvReadLittleEndian32( const uint8_t *pucBytes );
+static uint64_t prvReadLittleEndian64( const uint8_t *pucBytes );
+
+/*-----------------------------------------------------------*/
+
+int main( int argc, char *argv[] )
+{
+DecodeState_t xState;
+uint8_t ucBlock[ canlogBLOCK_BYTES ];
+const char *pcFileName = NULL;
+FILE *pxFile;
+int iArg, iValid = 1, iReturn = EXIT_SUCCESS;
+uint32_t ulBlock;
+
+	memset( &xState, 0x00, sizeof( xState ) );
+
+	for( iArg = 1; iArg < argc; iArg++ )
+	{
+		if( strcmp( argv[ iArg ], "--csv" ) == 0 )
+		{
+			xState.iCSV = 1;
+		}
+		else if( ( pcFileName == NULL ) && ( argv[ iArg ][ 0 ] != '-' ) )
+		{
+			pcFileName = argv[ iArg ];
+		}
+		else
+		{
+			pcFileName = NULL;
+			break;
+		}
+	}
+
+	if( pcFileName == NULL )
+	{
+		fprintf( stderr, "usage: %s [--csv] <log file>\n", argv[ 0 ] );
+		return EXIT_FAILURE;
+	}
+
+	pxFile = fopen( pcFileName, "rb" );
+	if( pxFile == NULL )
+	{
+		perror( pcFileName );
+		return EXIT_FAILURE;
+	}
+
+	if( xState.iCSV != 0 )
+	{
+		printf( "time_s,id,extended,remote,dlc,data,frames_lost\n" );
+	}
+
+	for( ulBlock = 0UL; ( iValid != 0 ) && ( fread( ucBlock, 1, sizeof( ucBlock ), pxFile ) == sizeof( ucBlock ) ); ulBlock++ )
+	{
+		if( ( ulBlock % canlogBLOCKS_PER_INDEX ) == 0UL )
+		{
+			iValid = prvDecodeIndexBlock( &xState, ucBlock, ulBlock );
+		}
+		else
+		{
+			iValid = prvDecodeDataBlock( &xState, ucBlock, ulBlock );
+		}
+
+		if( iValid != 0 )
+		{
+			xState.ulBlocks++;
+		}
+	}
+
+	fclose( pxFile );
+
+	if( xState.ulBlocks == 0UL )
+	{
+		fprintf( stderr, "%s: not a CAN log\n", pcFileName );
+		iReturn = EXIT_FAILURE;
+	}
+	else
+	{
+		fprintf( stderr, "%s: session %" PRIu32 ", %" PRIu32 " blocks, %" PRIu32 " frames, %" PRIu32 " frames lost%s\n", pcFileName, xState.ulSession, xState.ulBlocks, xState.ulFrames, xState.ulFramesLost, ( iValid != 0 ) ? "" : ", ends before the end of the file" );
+	}
+
+	return iReturn;
+}
+/*-----------------------------------------------------------*/
+
+static int prvDecodeIndexBlock( DecodeState_t *pxState, const uint8_t *pucBlock, uint32_t ulBlock )
+{
+int iValid = 0;
+
+	if( ( prvReadLittleEndian32( &( pucBlock[ canlogINDEX_MAGIC_OFFSET ] ) ) == canlogINDEX_MAGIC ) &&
+		( prvReadLittleEndian16( &( pucBlock[ canlogINDEX_VERSION_OFFSET ] ) ) == canlogVERSION ) &&
+		( prvReadLittleEndian16( &( pucBlock[ canlogINDEX_SPACING_OFFSET ] ) ) == canlogBLOCKS_PER_INDEX ) &&
+		( prvReadLittleEndian32( &( pucBlock[ canlogINDEX_BLOCK_OFFSET ] ) ) == ulBlock ) )
+	{
+		/* Block 0 gives the session every other block must have. */
+		if( ulBlock == 0UL )
+		{
+			pxState->ulSession = prvReadLittleEndian32( &( pucBlock[ canlogINDEX_SESSION_OFFSET ] ) );
+			pxState->ulResolutionNs = prvReadLittleEndian32( &( pucBlock[ canlogINDEX_RESOLUTION_OFFSET ] ) );
+		}
+
+		if( prvReadLittleEndian32( &( pucBlock[ canlogINDEX_SESSION_OFFSET ] ) ) == pxState->ulSession )
+		{
+			pxState->ullTimeBase = prvReadLittleEndian64( &( pucBlock[ canlogINDEX_TIME_BASE_OFFSET ] ) );
+			iValid = 1;
+		}
+	}
+
+	return iValid;
+}
+/*-----------------------------------------------------------*/
+
+static int prvDecodeDataBlock( DecodeState_t *pxState, const uint8_t *pucBlock, uint32_t ulBlock )
+{
+int iValid = 0;
+const uint8_t *pucRecord;
+uint32_t ulTimeWord, ulID, ulRecord;
+uint64_t ullTime;
+
+	if( ( prvReadLittleEndian32( &( pucBlock[ 4 ] ) ) == ( canlogID_EVENT | canlogEVENT_BLOCK ) ) &&
+		( prvReadLittleEndian32( &( pucBlock[ 8 ] ) ) == ulBlock ) &&
+		( prvReadLittleEndian32( &( pucBlock[ 12 ] ) ) == pxState->ulSession ) )
+	{
+		iValid = 1;
+
+		for( ulRecord = 1UL; ulRecord < canlogRECORDS_PER_BLOCK; ulRecord++ )
+		{
+			pucRecord = &( pucBlock[ ulRecord * canlogRECORD_BYTES ] );
+			ulTimeWord = prvReadLittleEndian32( &( pucRecord[ 0 ] ) );
+			ulID = prvReadLittleEndian32( &( pucRecord[ 4 ] ) );
+			ullTime = pxState->ullTimeBase | ( ulTimeWord & canlogTIME_MASK );
+
+			if( ( ulID & canlogID_EVENT ) == 0UL )
+			{
+				prvPrintFrame( pxState, ullTime, ulID, ( uint8_t ) ( ulTimeWord >> canlogDLC_SHIFT ), &( pucRecord[ 8 ] ) );
+				pxState->ulFrames++;
+			}
+			else if( ( ulID & 0xFFUL ) == canlogEVENT_TIME )
+			{
+				pxState->ullTimeBase = prvReadLittleEndian64( &( pucRecord[ 8 ] ) ) & ~( uint64_t ) canlogTIME_MASK;
+			}
+			else if( ( ulID & 0xFFUL ) == canlogEVENT_OVERRUN )
+			{
+				prvPrintOverrun( pxState, ullTime, prvReadLittleEndian32( &( pucRecord[ 8 ] ) ) );
+				pxState->ulFramesLost += prvReadLittleEndian32( &( pucRecord[ 8 ] ) );
+			}
+			else
+			{
+				/* Padding, or an event this version does not know of. */
+			}
+		}
+	}
+
+	return iValid;
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintFrame( const DecodeState_t *pxState, uint64_t ullTime, uint32_t ulID, uint8_t ucLength, const uint8_t *pucData )
+{
+const double dSeconds = ( ( double ) ullTime * ( double ) pxState->ulResolutionNs ) / 1e9;
+const int iExtended = ( ( ulID & canlogID_EXTENDED ) != 0UL ) ? 1 : 0;
+const int iRemote = ( ( ulID & canlogID_REMOTE ) != 0UL ) ? 1 : 0;
+uint8_t ucByte, ucDataBytes;
+
+	ucDataBytes = ( ucLength > 8U ) ? 8U : ucLength;
+	if( iRemote != 0 )
+	{
+		ucDataBytes = 0U;
+	}
+
+	if( pxState->iCSV != 0 )
+	{
+		printf( "%.6f,%0*" PRIX32 ",%d,%d,%u,", dSeconds, ( iExtended != 0 ) ? 8 : 3, ( uint32_t ) ( ulID & canlogID_MASK ), iExtended, iRemote, ( unsigned ) ucLength );
+
+		for( ucByte = 0U; ucByte < ucDataBytes; ucByte++ )
+		{
+			printf( "%02X", pucData[ ucByte ] );
+		}
+
+		printf( ",\n" );
+	}
+	else
+	{
+		printf( "%14.6f  %*s%0*" PRIX32 "  [%u] ", dSeconds, ( iExtended != 0 ) ? 0 : 5, "", ( iExtended != 0 ) ? 8 : 3, ( uint32_t ) ( ulID & canlogID_MASK ), ( unsigned ) ucLength );
+
+		if( iRemote != 0 )
+		{
+			printf( " remote request" );
+		}
+
+		for( ucByte = 0U; ucByte < ucDataBytes; ucByte++ )
+		{
+			printf( " %02X", pucData[ ucByte ] );
+		}
+
+		printf( "\n" );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvPrintOverrun( const DecodeState_t *pxState, uint64_t ullTime, uint32_t ulFramesLost )
+{
+const double dSeconds = ( ( double ) ullTime * ( double ) pxState->ulResolutionNs ) / 1e9;
+
+	if( pxState->iCSV != 0 )
+	{
+		printf( "%.6f,,,,,,%" PRIu32 "\n", dSeconds, ulFramesLost );
+	}
+	else
+	{
+		printf( "%14.6f  *** %" PRIu32 " frames lost ***\n", dSeconds, ulFramesLost );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvReadLittleEndian16( const uint8_t *pucBytes )
+{
+	return ( uint16_t ) ( ( uint16_t ) pucBytes[ 0 ] | ( ( uint16_t ) pucBytes[ 1 ] << 8 ) );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLittleEndian32( const uint8_t *pucBytes )
+{
+	return ( ( uint32_t ) pucBytes[ 0 ] ) | ( ( uint32_t ) pucBytes[ 1 ] << 8 ) | ( ( uint32_t ) pucBytes[ 2 ] << 16 ) | ( ( uint32_t ) pucBytes[ 3 ] << 24 );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvReadLittleEndian64( const uint8_t *pucBytes )
+{
+	return ( uint64_t ) prvReadLittleEndian32( pucBytes ) | ( ( uint64_t ) prvReadLittleEndian32( &( pucBytes[ 4 ] ) ) << 32 );
+}
+/*-----------------------------------------------------------*/
@@ -51,6 +51,9 @@
     licensing and training services.
 */
 
+/* Standard includes. */
+#include <string.h>
+
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
@@ -62,12 +65,20 @@
 
 /* Library includes. */
 #include "lpc17xx_gpio.h"
+#include "lpc17xx_can.h"
 #include "LPC17xx.h"
 
 /* Example includes. */
 #include "can.h"
 
 
+/* The number of frames sent by each call to FreeRTOS_write() once the CAN
+port is in frame batch mode. */
+#define canDEMO_FRAMES_PER_BATCH	( 4 )
+
+/* The longest a write waits for a Tx buffer to become free, in ticks. */
+#define canDEMO_TX_TIMEOUT			( 10 )
+
 /*
  * The task that starts the CAN communication
  */
@@ -100,6 +111,8 @@ uint32_t *id=(void *)0x00012340;
 uint8_t *frame_type=0;
 uint8_t *frame_length=6;
 uint8_t *use_irq=1;
+static CAN_MSG_Type xTxFrames[ canDEMO_FRAMES_PER_BATCH ];
+uint32_t ulFrame;
 
 	( void ) pvParameters;
 
@@ -113,11 +126,30 @@ uint8_t *use_irq=1;
 	//FreeRTOS_ioctl( xCAN,ioctlUSE_INTERRUPTS,(void *)use_irq);
 	//FreeRTOS_read( xCAN, &cRxedChar,sizeof(cRxedChar));
 
+	/* From now on each write sends a complete array of frames, each carrying
+	its own ID and length, so no ioctl() calls are needed per frame. */
+	FreeRTOS_ioctl( xCAN, ioctlSET_CAN_FRAME_BATCH_MODE, ( void * ) pdTRUE );
+
+	/* A batch holds more frames than there are Tx buffers, so let each write
+	wait a little for a buffer to become free.  With no other node on the bus
+	to acknowledge the frames, the write gives up after canDEMO_TX_TIMEOUT
+	ticks and returns the number of frames sent so far. */
+	FreeRTOS_ioctl( xCAN, ioctlSET_TX_TIMEOUT, ( void * ) canDEMO_TX_TIMEOUT );
+
+	for( ulFrame = 0; ulFrame < canDEMO_FRAMES_PER_BATCH; ulFrame++ )
+	{
+		xTxFrames[ ulFrame ].id = ( uint32_t ) id + ulFrame;
+		xTxFrames[ ulFrame ].format = EXT_ID_FORMAT;
+		xTxFrames[ ulFrame ].type = DATA_FRAME;
+		xTxFrames[ ulFrame ].len = ( uint8_t ) ( uint32_t ) frame_length;
+		memcpy( xTxFrames[ ulFrame ].dataA, &cTxedChar, sizeof( xTxFrames[ ulFrame ].dataA ) );
+		memcpy( xTxFrames[ ulFrame ].dataB, ( ( uint8_t * ) &cTxedChar ) + sizeof( xTxFrames[ ulFrame ].dataA ), sizeof( xTxFrames[ ulFrame ].dataB ) );
+	}
+
 	for( ;; )
 	{
 		vTaskDelayUntil( &xLastWakeTime, xFrequency );
-		FreeRTOS_ioctl( xCAN,ioctlSET_CAN_EXT_ID,(void *)id);
-		FreeRTOS_write(xCAN, &cTxedChar,sizeof(cTxedChar));
+		FreeRTOS_write( xCAN, xTxFrames, sizeof( xTxFrames ) );
 	}
 }
 /*-----------------------------------------------------------*/
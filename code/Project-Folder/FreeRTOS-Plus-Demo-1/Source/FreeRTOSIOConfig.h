@@ -81,6 +81,16 @@
 	#define ioconfigUSE_CAN_ZERO_COPY_TX					1
 	#define ioconfigUSE_CAN_CIRCULAR_BUFFER_RX				1
 	#define ioconfigUSE_CAN_TX_CHAR_QUEUE					1
+	#define ioconfigUSE_CAN_FRAME_QUEUE_RX					1
+	#define ioconfigUSE_CAN_FRAME_QUEUE_TX					1
+	#define ioconfigUSE_CAN_TIMESTAMPS						1
+	#define ioconfigUSE_CAN_ANALYTICS						1
+	#define ioconfigUSE_CAN_ISOTP							1
+	#define ioconfigUSE_CAN_J1939							1
+	#define ioconfigUSE_CAN_SUBSCRIBERS						1
+	#define ioconfigUSE_CAN_CYCLIC_TX						1
+	#define ioconfigUSE_CAN_TX_CONFIRMATION					1
+	#define ioconfigUSE_CAN_TX_DEADLINES					1
 
 
 /* Sanity check configuration.  Do not edit below this line. */
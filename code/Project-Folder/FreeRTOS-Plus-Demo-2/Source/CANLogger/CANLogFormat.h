@@ -0,0 +1,101 @@
+/*
+ * The format of the binary CAN logs written by CANLogger.c.  Only the standard
+ * integer types are used, so the host decoder in
+ * FreeRTOS-Plus-CAN-Simulator/Tools/CANLogDecode.c can include this file too.
+ *
+ * A log is a sequence of 512 byte blocks, so the logger only ever writes whole
+ * sectors.  Every field is little endian.  Block 0, and every
+ * canlogBLOCKS_PER_INDEX'th block after it, is an index block.  Every other
+ * block is a data block of canlogRECORDS_PER_BLOCK fixed size records:
+ *
+ *   offset 0   uint32  bits 0 to 27   the low 28 bits of the timestamp
+ *                      bits 28 to 31  the DLC
+ *   offset 4   uint32  bits 0 to 28   the ID
+ *                      bit 29         canlogID_REMOTE
+ *                      bit 30         canlogID_EXTENDED
+ *                      bit 31         canlogID_EVENT
+ *   offset 8   uint8   [ 8 ]          the data, as many bytes as the DLC
+ *
+ * A record with canlogID_EVENT set is not a frame.  Bits 0 to 7 of its ID hold
+ * one of the canlogEVENT_ codes, and its data the arguments of the event:
+ *
+ *   canlogEVENT_BLOCK     The first record of every data block.  uint32 the
+ *                         number of the block, uint32 the session of the log.
+ *                         A block that does not start with this event, for
+ *                         the block's own number and the session given in
+ *                         block 0, was not written by this log, and marks its
+ *                         end.
+ *   canlogEVENT_TIME      uint64 the full timestamp.  Written before any
+ *                         record whose timestamp differs from that of the
+ *                         record before it above bit 27.
+ *   canlogEVENT_OVERRUN   uint32 the frames discarded by the driver because
+ *                         its Rx queue was full.  They were received after
+ *                         the record before the event, but can have been
+ *                         received after as many of the frames that follow
+ *                         it as the Rx queue holds.
+ *   canlogEVENT_PAD       Fills the end of a block written before it was full.
+ *
+ * Timestamps are those given to the frames by the CAN driver, extended to 64
+ * bits, and count in units of the resolution given in the index blocks.
+ *
+ * An index block describes the log as it stood when the block was written, so
+ * a decoder can start from any index block, rather than from the beginning:
+ *
+ *   offset 0   uint32  canlogINDEX_MAGIC
+ *   offset 4   uint16  canlogVERSION
+ *   offset 6   uint16  canlogBLOCKS_PER_INDEX
+ *   offset 8   uint32  the number of the block
+ *   offset 12  uint32  the session of the log
+ *   offset 16  uint32  the timestamp resolution, in nanoseconds
+ *   offset 20  uint32  the bit rate of the bus, in bits per second
+ *   offset 24  uint32  the frames logged before the block
+ *   offset 28  uint32  the frames lost before the block
+ *   offset 32  uint64  the full timestamp of the record before the block, with
+ *                      bits 0 to 27 clear, to which the low 28 bits of the
+ *                      timestamps that follow are added
+ *
+ * The rest of an index block is zero.
+ */
+
+#ifndef CAN_LOG_FORMAT_H
+#define CAN_LOG_FORMAT_H
+
+#include <stdint.h>
+
+#define canlogBLOCK_BYTES				( 512U )
+#define canlogRECORD_BYTES				( 16U )
+#define canlogRECORDS_PER_BLOCK			( canlogBLOCK_BYTES / canlogRECORD_BYTES )
+#define canlogBLOCKS_PER_INDEX			( 64U )
+
+#define canlogINDEX_MAGIC				( 0x474F4C43UL )	/* "CLOG". */
+#define canlogVERSION					( 1U )
+
+/* The first word of a record. */
+#define canlogTIME_BITS					( 28U )
+#define canlogTIME_MASK					( ( 1UL << canlogTIME_BITS ) - 1UL )
+#define canlogDLC_SHIFT					( 28U )
+
+/* The second word of a record. */
+#define canlogID_MASK					( 0x1FFFFFFFUL )
+#define canlogID_REMOTE					( 0x20000000UL )
+#define canlogID_EXTENDED				( 0x40000000UL )
+#define canlogID_EVENT					( 0x80000000UL )
+
+#define canlogEVENT_BLOCK				( 0x01UL )
+#define canlogEVENT_TIME				( 0x02UL )
+#define canlogEVENT_OVERRUN				( 0x03UL )
+#define canlogEVENT_PAD					( 0xFFUL )
+
+/* The offsets of the fields of an index block. */
+#define canlogINDEX_MAGIC_OFFSET		( 0U )
+#define canlogINDEX_VERSION_OFFSET		( 4U )
+#define canlogINDEX_SPACING_OFFSET		( 6U )
+#define canlogINDEX_BLOCK_OFFSET		( 8U )
+#define canlogINDEX_SESSION_OFFSET		( 12U )
+#define canlogINDEX_RESOLUTION_OFFSET	( 16U )
+#define canlogINDEX_BIT_RATE_OFFSET		( 20U )
+#define canlogINDEX_FRAMES_OFFSET		( 24U )
+#define canlogINDEX_LOST_OFFSET			( 28U )
+#define canlogINDEX_TIME_BASE_OFFSET	( 32U )
+
+#endif /* CAN_LOG_FORMAT_H */
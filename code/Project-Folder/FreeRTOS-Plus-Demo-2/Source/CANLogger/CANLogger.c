@@ -0,0 +1,673 @@
+/*
+ * The binary CAN logger.  See CANLogger.h for how the work is split between
+ * the collector and the writer, and CANLogFormat.h for the file format.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
+/* File system includes. */
+#include "ff.h"
+
+/* Application includes. */
+#include "CANLogger.h"
+
+/* A buffer, which holds the blocks from ulFirstBlock of the file. */
+typedef struct xCAN_LOG_BUFFER
+{
+	uint8_t *pucBlocks;
+	uint32_t ulFirstBlock;
+	size_t xBlocksUsed;					/* The blocks that are complete. */
+} CAN_Log_Buffer_t;
+
+/* The state of a logger.  The buffers are passed between the collector and the
+writer through two queues of buffer pointers.  Everything else is only used by
+the collector, apart from the file and the statistics the writer keeps. */
+struct xCAN_LOGGER
+{
+	Peripheral_Descriptor_t xCAN;
+	FIL xFile;
+	uint32_t ulSession;
+	uint32_t ulBitRate;
+	uint32_t ulFileBlocks;
+	size_t xBufferBlocks;
+	portTickType xFlushInterval;
+	CAN_Log_Buffer_t xBuffers[ canlogBUFFERS ];
+	xQueueHandle xFreeBuffers;
+	xQueueHandle xFullBuffers;
+	CAN_MSG_Type *pxFrames;				/* canlogRECORDS_PER_BLOCK frames read from the controller. */
+
+	/* The collector's position in the file. */
+	CAN_Log_Buffer_t *pxFilling;		/* NULL while the collector has no buffer. */
+	size_t xRecord;						/* The records in the block after the complete blocks of the buffer, or 0 if that block has not been started. */
+	size_t xFramesInBuffer;
+	portTickType xFirstFrameTime;		/* When the first frame was added to the buffer. */
+	uint32_t ulNextBlock;				/* The first block of the next buffer. */
+
+	/* Driver timestamps wrap at 32 bits, so are extended to 64. */
+	uint64_t ullLatestTime;				/* The latest timestamp seen. */
+	uint64_t ullTimeBase;				/* The timestamp of the last record, with the bits the records hold cleared. */
+
+	uint32_t ulOverrunCount;			/* The driver's count of discarded frames, when it was last recorded. */
+	CAN_Logger_Statistics_t xStatistics;
+};
+
+/*
+ * Give the collector the next free buffer, waiting up to xBlockTime for the
+ * writer to free one.
+ */
+static portBASE_TYPE prvTakeBuffer( CAN_Logger_t * const pxLogger, portTickType xBlockTime );
+
+/*
+ * The number of frames that fit in the rest of the buffer being filled,
+ * allowing for the block header of every block still to be started, but not
+ * for index blocks or events.
+ */
+static size_t prvFramesThatFit( const CAN_Logger_t * const pxLogger );
+
+/*
+ * Pad the block being filled, and hand the buffer being filled to the writer.
+ */
+static void prvHandOverBuffer( CAN_Logger_t * const pxLogger );
+
+/*
+ * Start the next data block, writing an index block first if one is due, and
+ * moving on to the next buffer if the one being filled is full.  Returns
+ * pdFAIL if there is no free buffer or the file is full.
+ */
+static portBASE_TYPE prvStartBlock( CAN_Logger_t * const pxLogger );
+
+/*
+ * Add a record to the block being filled, starting a new block if it is full.
+ * Returns pdFAIL if the record could not be added.
+ */
+static portBASE_TYPE prvAddRecord( CAN_Logger_t * const pxLogger, uint64_t ullTime, uint32_t ulLengthAndTime, uint32_t ulID, uint32_t ulDataA, uint32_t ulDataB );
+
+/*
+ * Add an event record, with two 32 bit arguments.
+ */
+static portBASE_TYPE prvAddEvent( CAN_Logger_t * const pxLogger, uint64_t ullTime, uint32_t ulEvent, uint32_t ulArgumentA, uint32_t ulArgumentB );
+
+/*
+ * Write the index block for block number ulBlock to pucBlock.
+ */
+static void prvWriteIndexBlock( const CAN_Logger_t * const pxLogger, uint8_t * const pucBlock, uint32_t ulBlock );
+
+/*
+ * Extend a 32 bit driver timestamp to 64 bits, relative to the latest
+ * timestamp seen.  Frames arrive in order, but the timestamp read from the
+ * driver when no frames are received can be later than that of a frame still
+ * in the Rx queue, so the timestamp can be earlier than the latest.
+ */
+static uint64_t prvExtendTimestamp( CAN_Logger_t * const pxLogger, uint32_t ulTimestamp );
+
+/*
+ * Little endian access to the fields of a block.
+ */
+static void prvWriteLittleEndian16( uint8_t * const pucBytes, const uint16_t usValue );
+static void prvWriteLittleEndian32( uint8_t * const pucBytes, const uint32_t ulValue );
+static uint32_t prvReadLittleEndian32( const uint8_t * const pucBytes );
+
+/*-----------------------------------------------------------*/
+
+CAN_Logger_t *pxCANLoggerCreate( const CAN_Logger_Config_t * const pxConfig )
+{
+CAN_Logger_t *pxLogger = NULL;
+size_t xBytes, xBuffer;
+uint8_t *pucBlocks;
+uint32_t ulTimestamp = 0UL;
+UINT xBytesRead;
+portBASE_TYPE xFileOpen = pdFALSE, xCreated = pdFALSE;
+
+	configASSERT( pxConfig );
+
+	if( ( pxConfig->xCAN != NULL ) && ( pxConfig->pcFileName != NULL ) && ( pxConfig->usBufferBlocks > 0U ) && ( pxConfig->ulFileBlocks > 1UL ) )
+	{
+		/* The state, followed by the frames read from the controller and the
+		blocks of the buffers. */
+		xBytes = sizeof( CAN_Logger_t ) + ( canlogRECORDS_PER_BLOCK * sizeof( CAN_MSG_Type ) ) + ( ( size_t ) canlogBUFFERS * pxConfig->usBufferBlocks * canlogBLOCK_BYTES );
+		pxLogger = pvPortMalloc( xBytes );
+
+		if( pxLogger != NULL )
+		{
+			memset( pxLogger, 0x00, sizeof( CAN_Logger_t ) );
+			pxLogger->xCAN = pxConfig->xCAN;
+			pxLogger->ulBitRate = pxConfig->ulBitRate;
+			pxLogger->xBufferBlocks = pxConfig->usBufferBlocks;
+			pxLogger->pxFrames = ( CAN_MSG_Type * ) ( pxLogger + 1 );
+			pucBlocks = ( uint8_t * ) ( pxLogger->pxFrames + canlogRECORDS_PER_BLOCK );
+
+			pxLogger->xFreeBuffers = xQueueCreate( canlogBUFFERS, sizeof( CAN_Log_Buffer_t * ) );
+			pxLogger->xFullBuffers = xQueueCreate( canlogBUFFERS, sizeof( CAN_Log_Buffer_t * ) );
+
+			if( ( pxLogger->xFreeBuffers != NULL ) && ( pxLogger->xFullBuffers != NULL ) && ( f_open( &( pxLogger->xFile ), pxConfig->pcFileName, FA_OPEN_ALWAYS | FA_READ | FA_WRITE ) == FR_OK ) )
+			{
+				xFileOpen = pdTRUE;
+				FreeRTOS_ioctl( pxLogger->xCAN, ioctlGET_CAN_TIMESTAMP, &ulTimestamp );
+				pxLogger->ullLatestTime = ulTimestamp;
+				pxLogger->ullTimeBase = ulTimestamp & ~canlogTIME_MASK;
+				FreeRTOS_ioctl( pxLogger->xCAN, ioctlGET_CAN_RX_OVERRUN_COUNT, &( pxLogger->ulOverrunCount ) );
+
+				for( xBuffer = 0U; xBuffer < canlogBUFFERS; xBuffer++ )
+				{
+					pxLogger->xBuffers[ xBuffer ].pucBlocks = pucBlocks + ( xBuffer * pxLogger->xBufferBlocks * canlogBLOCK_BYTES );
+					pxLogger->pxFilling = &( pxLogger->xBuffers[ xBuffer ] );
+					xQueueSend( pxLogger->xFreeBuffers, &( pxLogger->pxFilling ), 0U );
+				}
+				pxLogger->pxFilling = NULL;
+
+				/* A file that already holds a log gives the new log the next
+				session number, as the blocks of the old log are about to be
+				reused.  Otherwise the time is as good as anything. */
+				if( ( f_read( &( pxLogger->xFile ), pucBlocks, canlogBLOCK_BYTES, &xBytesRead ) == FR_OK ) && ( xBytesRead == canlogBLOCK_BYTES ) && ( prvReadLittleEndian32( &( pucBlocks[ canlogINDEX_MAGIC_OFFSET ] ) ) == canlogINDEX_MAGIC ) )
+				{
+					pxLogger->ulSession = prvReadLittleEndian32( &( pucBlocks[ canlogINDEX_SESSION_OFFSET ] ) ) + 1UL;
+				}
+				else
+				{
+					pxLogger->ulSession = ulTimestamp ^ ( ( uint32_t ) xTaskGetTickCount() << 16 );
+				}
+
+				/* Extend the file to its full size now, so the clusters are
+				allocated and the FAT written before logging starts.  The size
+				is clipped if the volume is full. */
+				if( ( f_lseek( &( pxLogger->xFile ), pxConfig->ulFileBlocks * canlogBLOCK_BYTES ) == FR_OK ) && ( f_sync( &( pxLogger->xFile ) ) == FR_OK ) )
+				{
+					pxLogger->ulFileBlocks = f_tell( &( pxLogger->xFile ) ) / canlogBLOCK_BYTES;
+				}
+
+				if( ( pxLogger->ulFileBlocks > 1UL ) && ( f_lseek( &( pxLogger->xFile ), 0UL ) == FR_OK ) )
+				{
+					/* A read of the controller returns once a block is full,
+					or once the flush interval has passed - which must be at
+					least a tick, or the collector would spin. */
+					pxLogger->xFlushInterval = ( portTickType ) pxConfig->usFlushIntervalMs / portTICK_RATE_MS;
+					if( pxLogger->xFlushInterval == 0U )
+					{
+						pxLogger->xFlushInterval = 1U;
+					}
+					FreeRTOS_ioctl( pxLogger->xCAN, ioctlSET_RX_TIMEOUT, ( void * ) pxLogger->xFlushInterval );
+					xCreated = pdTRUE;
+				}
+			}
+
+			if( xCreated == pdFALSE )
+			{
+				if( xFileOpen != pdFALSE )
+				{
+					f_close( &( pxLogger->xFile ) );
+				}
+
+				if( pxLogger->xFreeBuffers != NULL )
+				{
+					vQueueDelete( pxLogger->xFreeBuffers );
+				}
+
+				if( pxLogger->xFullBuffers != NULL )
+				{
+					vQueueDelete( pxLogger->xFullBuffers );
+				}
+
+				vPortFree( pxLogger );
+				pxLogger = NULL;
+			}
+		}
+	}
+
+	return pxLogger;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANLoggerCollect( CAN_Logger_t * const pxLogger )
+{
+size_t xFrames = 0U, xFramesLogged = 0U, xFrame, xSpace;
+uint32_t ulOverrunCount = 0UL, ulTimestamp = 0UL, ulID;
+uint64_t ullTime;
+
+	configASSERT( pxLogger );
+
+	/* With both buffers waiting to be written there is nowhere to put frames,
+	so leave them in the controller's Rx queue until a buffer is free. */
+	if( pxLogger->pxFilling == NULL )
+	{
+		prvTakeBuffer( pxLogger, pxLogger->xFlushInterval );
+	}
+
+	if( pxLogger->pxFilling != NULL )
+	{
+		/* Only read the frames there is room for, so frames are not read only
+		to be dropped.  Index blocks and events can still overflow the buffer,
+		into the next if it is free. */
+		xSpace = prvFramesThatFit( pxLogger );
+		if( xSpace > canlogRECORDS_PER_BLOCK )
+		{
+			xSpace = canlogRECORDS_PER_BLOCK;
+		}
+
+		xFrames = FreeRTOS_read( pxLogger->xCAN, pxLogger->pxFrames, xSpace * sizeof( CAN_MSG_Type ) ) / sizeof( CAN_MSG_Type );
+
+		/* Frames the driver had to discard are recorded ahead of the frames
+		just read, as they were discarded after every frame already logged was
+		received. */
+		FreeRTOS_ioctl( pxLogger->xCAN, ioctlGET_CAN_RX_OVERRUN_COUNT, &ulOverrunCount );
+		if( ulOverrunCount != pxLogger->ulOverrunCount )
+		{
+			if( prvAddEvent( pxLogger, pxLogger->ullLatestTime, canlogEVENT_OVERRUN, ulOverrunCount - pxLogger->ulOverrunCount, 0UL ) == pdPASS )
+			{
+				pxLogger->xStatistics.ulFramesLost += ulOverrunCount - pxLogger->ulOverrunCount;
+				pxLogger->ulOverrunCount = ulOverrunCount;
+			}
+		}
+
+		for( xFrame = 0U; xFrame < xFrames; xFrame++ )
+		{
+			ullTime = prvExtendTimestamp( pxLogger, pxLogger->pxFrames[ xFrame ].timestamp );
+
+			ulID = pxLogger->pxFrames[ xFrame ].id & canlogID_MASK;
+			if( pxLogger->pxFrames[ xFrame ].format == EXT_ID_FORMAT )
+			{
+				ulID |= canlogID_EXTENDED;
+			}
+			if( pxLogger->pxFrames[ xFrame ].type == REMOTE_FRAME )
+			{
+				ulID |= canlogID_REMOTE;
+			}
+
+			if( prvAddRecord( pxLogger, ullTime, ( ( uint32_t ) pxLogger->pxFrames[ xFrame ].len ) << canlogDLC_SHIFT, ulID, pxLogger->pxFrames[ xFrame ].dataAWord, pxLogger->pxFrames[ xFrame ].dataBWord ) == pdPASS )
+			{
+				if( pxLogger->xFramesInBuffer == 0U )
+				{
+					pxLogger->xFirstFrameTime = xTaskGetTickCount();
+				}
+				( pxLogger->xFramesInBuffer )++;
+				xFramesLogged++;
+			}
+			else
+			{
+				( pxLogger->xStatistics.ulFramesDropped )++;
+			}
+		}
+
+		pxLogger->xStatistics.ulFramesLogged += ( uint32_t ) xFramesLogged;
+
+		/* With no frames to extend the timestamps, keep track of the time from
+		the driver, so a wrap of its timestamps is not missed. */
+		if( xFrames == 0U )
+		{
+			FreeRTOS_ioctl( pxLogger->xCAN, ioctlGET_CAN_TIMESTAMP, &ulTimestamp );
+			prvExtendTimestamp( pxLogger, ulTimestamp );
+		}
+
+		if( ( pxLogger->pxFilling != NULL ) && ( ( prvFramesThatFit( pxLogger ) == 0U ) || ( ( pxLogger->xFramesInBuffer > 0U ) && ( ( xTaskGetTickCount() - pxLogger->xFirstFrameTime ) >= pxLogger->xFlushInterval ) ) ) )
+		{
+			prvHandOverBuffer( pxLogger );
+		}
+	}
+
+	return xFramesLogged;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANLoggerWrite( CAN_Logger_t * const pxLogger, portTickType xBlockTime )
+{
+CAN_Log_Buffer_t *pxBuffer;
+size_t xBlocks = 0U;
+UINT xBytes, xBytesWritten = 0U;
+portTickType xStartTime, xWriteTime;
+
+	configASSERT( pxLogger );
+
+	if( xQueueReceive( pxLogger->xFullBuffers, &pxBuffer, xBlockTime ) == pdPASS )
+	{
+		xStartTime = xTaskGetTickCount();
+
+		/* Buffers are handed over in the order they were filled, so the file
+		pointer is already at the first block of the buffer. */
+		xBytes = ( UINT ) ( pxBuffer->xBlocksUsed * canlogBLOCK_BYTES );
+
+		if( ( f_write( &( pxLogger->xFile ), pxBuffer->pucBlocks, xBytes, &xBytesWritten ) == FR_OK ) && ( xBytesWritten == xBytes ) )
+		{
+			xBlocks = pxBuffer->xBlocksUsed;
+			( pxLogger->xStatistics.ulBuffersWritten )++;
+			pxLogger->xStatistics.ulBlocksWritten += ( uint32_t ) xBlocks;
+		}
+		else
+		{
+			/* Leave the blocks as they were, and move on to those of the next
+			buffer. */
+			( pxLogger->xStatistics.ulWriteFailures )++;
+			f_lseek( &( pxLogger->xFile ), ( pxBuffer->ulFirstBlock + pxBuffer->xBlocksUsed ) * canlogBLOCK_BYTES );
+		}
+
+		xWriteTime = xTaskGetTickCount() - xStartTime;
+		if( xWriteTime > pxLogger->xStatistics.xLongestWrite )
+		{
+			pxLogger->xStatistics.xLongestWrite = xWriteTime;
+		}
+
+		xQueueSend( pxLogger->xFreeBuffers, &pxBuffer, 0U );
+	}
+
+	return xBlocks;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xCANLoggerClose( CAN_Logger_t * const pxLogger )
+{
+portBASE_TYPE xReturn = pdFAIL;
+
+	configASSERT( pxLogger );
+
+	if( pxLogger->pxFilling != NULL )
+	{
+		if( ( pxLogger->pxFilling->xBlocksUsed > 0U ) || ( pxLogger->xRecord > 0U ) )
+		{
+			prvHandOverBuffer( pxLogger );
+		}
+		else
+		{
+			pxLogger->pxFilling = NULL;
+		}
+	}
+
+	while( uxQueueMessagesWaiting( pxLogger->xFullBuffers ) > 0U )
+	{
+		xCANLoggerWrite( pxLogger, 0U );
+	}
+
+	if( ( f_lseek( &( pxLogger->xFile ), pxLogger->ulNextBlock * canlogBLOCK_BYTES ) == FR_OK ) && ( f_truncate( &( pxLogger->xFile ) ) == FR_OK ) )
+	{
+		xReturn = pdPASS;
+	}
+
+	if( f_close( &( pxLogger->xFile ) ) != FR_OK )
+	{
+		xReturn = pdFAIL;
+	}
+
+	vQueueDelete( pxLogger->xFreeBuffers );
+	vQueueDelete( pxLogger->xFullBuffers );
+	vPortFree( pxLogger );
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vCANLoggerGetStatistics( const CAN_Logger_t * const pxLogger, CAN_Logger_Statistics_t * const pxStatistics )
+{
+	configASSERT( pxLogger );
+	configASSERT( pxStatistics );
+
+	/* Each count is only written by one task, and a torn read of a 32 bit
+	count cannot happen, so no critical section is needed. */
+	*pxStatistics = pxLogger->xStatistics;
+}
+/*-----------------------------------------------------------*/
+
+void vCANLoggerCollectorTask( void *pvParameters )
+{
+CAN_Logger_t * const pxLogger = ( CAN_Logger_t * ) pvParameters;
+
+	for( ;; )
+	{
+		xCANLoggerCollect( pxLogger );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vCANLoggerWriterTask( void *pvParameters )
+{
+CAN_Logger_t * const pxLogger = ( CAN_Logger_t * ) pvParameters;
+
+	for( ;; )
+	{
+		xCANLoggerWrite( pxLogger, portMAX_DELAY );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvTakeBuffer( CAN_Logger_t * const pxLogger, portTickType xBlockTime )
+{
+portBASE_TYPE xReturn = pdFAIL;
+
+	if( xQueueReceive( pxLogger->xFreeBuffers, &( pxLogger->pxFilling ), 0U ) == pdPASS )
+	{
+		xReturn = pdPASS;
+	}
+	else
+	{
+		( pxLogger->xStatistics.ulCollectorStalls )++;
+
+		if( ( xBlockTime > 0U ) && ( xQueueReceive( pxLogger->xFreeBuffers, &( pxLogger->pxFilling ), xBlockTime ) == pdPASS ) )
+		{
+			xReturn = pdPASS;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		pxLogger->pxFilling->ulFirstBlock = pxLogger->ulNextBlock;
+		pxLogger->pxFilling->xBlocksUsed = 0U;
+		pxLogger->xRecord = 0U;
+		pxLogger->xFramesInBuffer = 0U;
+	}
+	else
+	{
+		pxLogger->pxFilling = NULL;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvFramesThatFit( const CAN_Logger_t * const pxLogger )
+{
+size_t xFrames;
+
+	xFrames = ( pxLogger->xBufferBlocks - pxLogger->pxFilling->xBlocksUsed ) * ( canlogRECORDS_PER_BLOCK - 1U );
+	if( pxLogger->xRecord > 0U )
+	{
+		xFrames -= pxLogger->xRecord - 1U;
+	}
+
+	return xFrames;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHandOverBuffer( CAN_Logger_t * const pxLogger )
+{
+CAN_Log_Buffer_t * const pxBuffer = pxLogger->pxFilling;
+uint8_t *pucRecord;
+
+	if( pxLogger->xRecord > 0U )
+	{
+		pucRecord = pxBuffer->pucBlocks + ( pxBuffer->xBlocksUsed * canlogBLOCK_BYTES ) + ( pxLogger->xRecord * canlogRECORD_BYTES );
+
+		while( pxLogger->xRecord < canlogRECORDS_PER_BLOCK )
+		{
+			memset( pucRecord, 0x00, canlogRECORD_BYTES );
+			prvWriteLittleEndian32( &( pucRecord[ 4 ] ), canlogID_EVENT | canlogEVENT_PAD );
+			pucRecord += canlogRECORD_BYTES;
+			( pxLogger->xRecord )++;
+		}
+
+		( pxBuffer->xBlocksUsed )++;
+		pxLogger->xRecord = 0U;
+	}
+
+	pxLogger->ulNextBlock = pxBuffer->ulFirstBlock + ( uint32_t ) pxBuffer->xBlocksUsed;
+	pxLogger->xFramesInBuffer = 0U;
+	pxLogger->pxFilling = NULL;
+
+	/* The queue has room for every buffer, so this cannot fail. */
+	xQueueSend( pxLogger->xFullBuffers, &pxBuffer, 0U );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvStartBlock( CAN_Logger_t * const pxLogger )
+{
+portBASE_TYPE xReturn = pdFAIL, xDone = pdFALSE;
+uint32_t ulBlock;
+uint8_t *pucBlock;
+
+	while( xDone == pdFALSE )
+	{
+		if( ( pxLogger->pxFilling != NULL ) && ( pxLogger->pxFilling->xBlocksUsed == pxLogger->xBufferBlocks ) )
+		{
+			prvHandOverBuffer( pxLogger );
+		}
+
+		if( ( pxLogger->pxFilling == NULL ) && ( prvTakeBuffer( pxLogger, 0U ) != pdPASS ) )
+		{
+			xDone = pdTRUE;
+		}
+		else
+		{
+			ulBlock = pxLogger->pxFilling->ulFirstBlock + ( uint32_t ) pxLogger->pxFilling->xBlocksUsed;
+			pucBlock = pxLogger->pxFilling->pucBlocks + ( pxLogger->pxFilling->xBlocksUsed * canlogBLOCK_BYTES );
+
+			if( ulBlock >= pxLogger->ulFileBlocks )
+			{
+				xDone = pdTRUE;
+			}
+			else if( ( ulBlock % canlogBLOCKS_PER_INDEX ) == 0UL )
+			{
+				prvWriteIndexBlock( pxLogger, pucBlock, ulBlock );
+				( pxLogger->pxFilling->xBlocksUsed )++;
+			}
+			else
+			{
+				memset( pucBlock, 0x00, canlogRECORD_BYTES );
+				prvWriteLittleEndian32( &( pucBlock[ 0 ] ), 8UL << canlogDLC_SHIFT );
+				prvWriteLittleEndian32( &( pucBlock[ 4 ] ), canlogID_EVENT | canlogEVENT_BLOCK );
+				prvWriteLittleEndian32( &( pucBlock[ 8 ] ), ulBlock );
+				prvWriteLittleEndian32( &( pucBlock[ 12 ] ), pxLogger->ulSession );
+				pxLogger->xRecord = 1U;
+				xReturn = pdPASS;
+				xDone = pdTRUE;
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvAddRecord( CAN_Logger_t * const pxLogger, uint64_t ullTime, uint32_t ulLengthAndTime, uint32_t ulID, uint32_t ulDataA, uint32_t ulDataB )
+{
+portBASE_TYPE xReturn = pdPASS;
+uint64_t ullPreviousTimeBase;
+uint8_t *pucRecord;
+
+	/* A record whose timestamp has moved on past what the records hold must
+	be preceded by the full timestamp.  The time base is changed first, so the
+	event itself does not need another. */
+	if( ( ullTime & ~( uint64_t ) canlogTIME_MASK ) != pxLogger->ullTimeBase )
+	{
+		ullPreviousTimeBase = pxLogger->ullTimeBase;
+		pxLogger->ullTimeBase = ullTime & ~( uint64_t ) canlogTIME_MASK;
+		xReturn = prvAddEvent( pxLogger, ullTime, canlogEVENT_TIME, ( uint32_t ) ullTime, ( uint32_t ) ( ullTime >> 32 ) );
+
+		if( xReturn != pdPASS )
+		{
+			pxLogger->ullTimeBase = ullPreviousTimeBase;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		if( pxLogger->xRecord == canlogRECORDS_PER_BLOCK )
+		{
+			( pxLogger->pxFilling->xBlocksUsed )++;
+			pxLogger->xRecord = 0U;
+		}
+
+		if( ( ( pxLogger->pxFilling == NULL ) || ( pxLogger->xRecord == 0U ) ) && ( prvStartBlock( pxLogger ) != pdPASS ) )
+		{
+			xReturn = pdFAIL;
+		}
+		else
+		{
+			pucRecord = pxLogger->pxFilling->pucBlocks + ( pxLogger->pxFilling->xBlocksUsed * canlogBLOCK_BYTES ) + ( pxLogger->xRecord * canlogRECORD_BYTES );
+			prvWriteLittleEndian32( &( pucRecord[ 0 ] ), ( ( uint32_t ) ullTime & canlogTIME_MASK ) | ulLengthAndTime );
+			prvWriteLittleEndian32( &( pucRecord[ 4 ] ), ulID );
+			prvWriteLittleEndian32( &( pucRecord[ 8 ] ), ulDataA );
+			prvWriteLittleEndian32( &( pucRecord[ 12 ] ), ulDataB );
+			( pxLogger->xRecord )++;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvAddEvent( CAN_Logger_t * const pxLogger, uint64_t ullTime, uint32_t ulEvent, uint32_t ulArgumentA, uint32_t ulArgumentB )
+{
+	return prvAddRecord( pxLogger, ullTime, 8UL << canlogDLC_SHIFT, canlogID_EVENT | ulEvent, ulArgumentA, ulArgumentB );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteIndexBlock( const CAN_Logger_t * const pxLogger, uint8_t * const pucBlock, uint32_t ulBlock )
+{
+	memset( pucBlock, 0x00, canlogBLOCK_BYTES );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_MAGIC_OFFSET ] ), canlogINDEX_MAGIC );
+	prvWriteLittleEndian16( &( pucBlock[ canlogINDEX_VERSION_OFFSET ] ), canlogVERSION );
+	prvWriteLittleEndian16( &( pucBlock[ canlogINDEX_SPACING_OFFSET ] ), canlogBLOCKS_PER_INDEX );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_BLOCK_OFFSET ] ), ulBlock );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_SESSION_OFFSET ] ), pxLogger->ulSession );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_RESOLUTION_OFFSET ] ), boardCAN_TIMESTAMP_RESOLUTION_US * 1000UL );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_BIT_RATE_OFFSET ] ), pxLogger->ulBitRate );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_FRAMES_OFFSET ] ), pxLogger->xStatistics.ulFramesLogged );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_LOST_OFFSET ] ), pxLogger->xStatistics.ulFramesLost );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_TIME_BASE_OFFSET ] ), ( uint32_t ) pxLogger->ullTimeBase );
+	prvWriteLittleEndian32( &( pucBlock[ canlogINDEX_TIME_BASE_OFFSET + 4U ] ), ( uint32_t ) ( pxLogger->ullTimeBase >> 32 ) );
+}
+/*-----------------------------------------------------------*/
+
+static uint64_t prvExtendTimestamp( CAN_Logger_t * const pxLogger, uint32_t ulTimestamp )
+{
+int32_t lDifference;
+uint64_t ullTime;
+
+	lDifference = ( int32_t ) ( ulTimestamp - ( uint32_t ) pxLogger->ullLatestTime );
+	ullTime = pxLogger->ullLatestTime + ( uint64_t ) ( int64_t ) lDifference;
+
+	if( lDifference > 0L )
+	{
+		pxLogger->ullLatestTime = ullTime;
+	}
+
+	return ullTime;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLittleEndian16( uint8_t * const pucBytes, const uint16_t usValue )
+{
+	pucBytes[ 0 ] = ( uint8_t ) usValue;
+	pucBytes[ 1 ] = ( uint8_t ) ( usValue >> 8 );
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLittleEndian32( uint8_t * const pucBytes, const uint32_t ulValue )
+{
+	pucBytes[ 0 ] = ( uint8_t ) ulValue;
+	pucBytes[ 1 ] = ( uint8_t ) ( ulValue >> 8 );
+	pucBytes[ 2 ] = ( uint8_t ) ( ulValue >> 16 );
+	pucBytes[ 3 ] = ( uint8_t ) ( ulValue >> 24 );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLittleEndian32( const uint8_t * const pucBytes )
+{
+	return ( ( uint32_t ) pucBytes[ 0 ] ) | ( ( uint32_t ) pucBytes[ 1 ] << 8 ) | ( ( uint32_t ) pucBytes[ 2 ] << 16 ) | ( ( uint32_t ) pucBytes[ 3 ] << 24 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,100 @@
+/*
+ * A logger that records every frame received by a CAN controller to a file on
+ * a FatFs volume, such as the SD card driven by mmc.c.  See CANLogFormat.h for
+ * the format of the file.
+ *
+ * The work is split between two tasks so the card never holds up the Rx path.
+ * The collector reads frames from the controller's Rx frame queue and packs
+ * them into one of two buffers, each a whole number of 512 byte blocks.  The
+ * writer writes each buffer the collector hands it to the file in a single
+ * f_write(), which FatFs passes straight to the card as a multiple sector
+ * write because the buffer starts on a sector boundary.  While the card is
+ * busy with one buffer the collector fills the other, so the collector must
+ * have the higher priority.  If the collector fills both buffers before the
+ * card has taken the first, it stops reading, and the frames wait in the
+ * driver's Rx queue.
+ *
+ * The file is extended to its full size when the logger is created, so
+ * writing it never allocates a cluster or updates the FAT, and is truncated to
+ * the blocks written when the logger is closed.  Should the power fail first,
+ * the decoder finds the end of the log from the block numbers in the data
+ * blocks.
+ *
+ * The application can call xCANLoggerCollect() and xCANLoggerWrite() itself in
+ * place of the tasks.
+ */
+
+#ifndef CAN_LOGGER_H
+#define CAN_LOGGER_H
+
+#include "CANLogFormat.h"
+
+/* The number of buffers the collector fills in turn. */
+#define canlogBUFFERS					( 2U )
+
+/* The configuration passed to pxCANLoggerCreate(). */
+typedef struct xCAN_LOGGER_CONFIG
+{
+	Peripheral_Descriptor_t xCAN;		/* An open controller that uses ioctlUSE_CAN_FRAME_QUEUE_RX, and which nothing else reads. */
+	const char *pcFileName;				/* The file to log to, on a volume that is already mounted.  An existing file is overwritten. */
+	uint32_t ulBitRate;					/* The bit rate of the bus, recorded in the index blocks. */
+	uint32_t ulFileBlocks;				/* The size the file is extended to, in 512 byte blocks.  Frames received once it is full are dropped. */
+	uint16_t usBufferBlocks;			/* The size of each buffer, in 512 byte blocks.  Each buffer must be able to hold the frames received during the longest time the card can take to write one. */
+	uint16_t usFlushIntervalMs;			/* The longest a frame waits in a buffer before the buffer is written, which bounds what is lost if the power fails. */
+} CAN_Logger_Config_t;
+
+/* The counts returned by vCANLoggerGetStatistics(). */
+typedef struct xCAN_LOGGER_STATISTICS
+{
+	uint32_t ulFramesLogged;
+	uint32_t ulFramesLost;				/* Frames discarded by the driver because its Rx queue was full, which the log records as overrun events. */
+	uint32_t ulFramesDropped;			/* Frames read from the controller that could not be logged, because the file was full, or because the collector's estimate of the space left in a buffer was exceeded while the other buffer was waiting to be written. */
+	uint32_t ulCollectorStalls;			/* Times the collector found both buffers waiting to be written. */
+	uint32_t ulBuffersWritten;
+	uint32_t ulBlocksWritten;
+	uint32_t ulWriteFailures;			/* Buffers FatFs failed to write.  Their blocks are left as they were. */
+	portTickType xLongestWrite;			/* The longest the writer took to write a buffer. */
+} CAN_Logger_Statistics_t;
+
+typedef struct xCAN_LOGGER CAN_Logger_t;
+
+/*
+ * Open and extend the file, and set the Rx timeout of the controller to the
+ * flush interval.  A file that already holds a log is given the next session
+ * number, so its old blocks cannot be mistaken for new ones.  Returns NULL if
+ * the configuration is not valid, or the file or buffers could not be created.
+ */
+CAN_Logger_t *pxCANLoggerCreate( const CAN_Logger_Config_t * const pxConfig );
+
+/*
+ * Wait up to the flush interval for frames, and log those received, handing
+ * the buffer being filled to the writer once it is full, or once its first
+ * frame has waited for the flush interval.  Only waits for the card if both
+ * buffers are waiting to be written, and then leaves the frames in the
+ * controller's Rx queue.  Returns the number of frames logged.
+ */
+size_t xCANLoggerCollect( CAN_Logger_t * const pxLogger );
+
+/*
+ * Wait up to xBlockTime for a buffer to be handed over by the collector, and
+ * write it to the file.  Returns the number of blocks written.
+ */
+size_t xCANLoggerWrite( CAN_Logger_t * const pxLogger, portTickType xBlockTime );
+
+/*
+ * Write the frames still in the buffers, truncate the file to the blocks
+ * written, close it, and free the logger.  Neither task may be running.
+ * Returns pdPASS if the file was closed without error.
+ */
+portBASE_TYPE xCANLoggerClose( CAN_Logger_t * const pxLogger );
+
+void vCANLoggerGetStatistics( const CAN_Logger_t * const pxLogger, CAN_Logger_Statistics_t * const pxStatistics );
+
+/*
+ * The collector and writer tasks, which service the logger passed as their
+ * parameter for ever.  The collector must have the higher priority.
+ */
+void vCANLoggerCollectorTask( void *pvParameters );
+void vCANLoggerWriterTask( void *pvParameters );
+
+#endif /* CAN_LOGGER_H */
@@ -0,0 +1,55 @@
+/*
+ * The constant tables that describe the messages and signals of a CAN
+ * database.  They are not written by hand, but generated at build time from a
+ * DBC file by FreeRTOS-Plus-CAN-Simulator/Tools/CANDBCCompile.c, which works
+ * out where each signal lies in the payload once, so CANSignals.c can extract
+ * every signal of a frame with a single shift and mask.  Only the standard
+ * integer types are used, so the tables can be built for any target.
+ *
+ * The 8 bytes of a payload are treated as one 64 bit word.  A signal with
+ * little endian (Intel) byte order is found in the word that has byte 0 of the
+ * payload as its least significant byte, and one with big endian (Motorola)
+ * byte order in the word that has byte 0 as its most significant byte.  Either
+ * way the signal is ucLength bits from bit ucShift of the word.
+ */
+
+#ifndef CAN_SIGNAL_TABLE_H
+#define CAN_SIGNAL_TABLE_H
+
+#include <stdint.h>
+
+/* Flags of a signal. */
+#define cansigBIG_ENDIAN				( 0x01U )	/* Motorola byte order, @0 in a DBC file. */
+#define cansigSIGNED					( 0x02U )	/* Two's complement, - in a DBC file. */
+
+/* Set in the ID of a message with a 29 bit ID, as it is in a DBC file. */
+#define cansigEXTENDED_ID				( 0x80000000UL )
+
+typedef struct xCAN_SIGNAL_DEF
+{
+	uint8_t ucShift;
+	uint8_t ucLength;				/* 1 to 64. */
+	uint8_t ucFlags;
+	uint8_t ucStartBit;				/* The start bit given in the DBC file, kept for tools that show it. */
+	float fScale;					/* The physical value is the raw value times fScale, plus fOffset. */
+	float fOffset;
+} CAN_Signal_Def_t;
+
+typedef struct xCAN_MESSAGE_DEF
+{
+	uint32_t ulID;					/* With cansigEXTENDED_ID set for a 29 bit ID. */
+	uint8_t ucLength;				/* The data length of the message.  Shorter frames are not decoded. */
+	uint16_t usFirstSignal;			/* The signals of a message follow each other in the signal table. */
+	uint16_t usSignals;
+} CAN_Message_Def_t;
+
+typedef struct xCAN_SIGNAL_DATABASE
+{
+	const CAN_Message_Def_t *pxMessages;	/* In ascending order of ulID. */
+	const CAN_Signal_Def_t *pxSignals;
+	const char * const *ppcSignalNames;		/* "Message.Signal" for each signal, or NULL if the names were not generated. */
+	uint16_t usMessages;
+	uint16_t usSignals;
+} CAN_Signal_Database_t;
+
+#endif /* CAN_SIGNAL_TABLE_H */
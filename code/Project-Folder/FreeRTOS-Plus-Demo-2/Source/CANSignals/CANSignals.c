@@ -0,0 +1,444 @@
+/*
+ * The table driven signal decoder described in CANSignals.h.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
+/* Application includes. */
+#include "CANSignals.h"
+
+/* The signals are tracked in bitmaps of one bit per signal. */
+#define cansigBITS_PER_WORD				( 32U )
+#define cansigBITMAP_WORDS( usSignals )	( ( ( size_t ) ( usSignals ) + cansigBITS_PER_WORD - 1U ) / cansigBITS_PER_WORD )
+#define cansigWORD( usSignal )			( ( usSignal ) / cansigBITS_PER_WORD )
+#define cansigBIT( usSignal )			( 1UL << ( ( usSignal ) % cansigBITS_PER_WORD ) )
+
+/* The size of the decoder's state, rounded up so the values that follow it are
+aligned for 64 bit access. */
+#define cansigDECODER_BYTES				( ( sizeof( CAN_Signal_Decoder_t ) + sizeof( int64_t ) - 1U ) & ~( sizeof( int64_t ) - 1U ) )
+
+/* A watcher is allocated with its two bitmaps.  pulChanged is only written
+from within a critical section, by the decoding task and the watching task. */
+struct xCAN_SIGNAL_WATCHER
+{
+	CAN_Signal_Decoder_t *pxDecoder;
+	xSemaphoreHandle xChanged;			/* Given once for every call to xCANSignalsDecode() that marks a watched signal as changed. */
+	uint32_t *pulWatched;
+	uint32_t *pulChanged;
+	portBASE_TYPE xWake;				/* Set while decoding when a signal is marked as changed. */
+	CAN_Signal_Watcher_t *pxNext;
+};
+
+/* A decoder is allocated with its values and bitmaps.  The values and the
+received bits are only written by the decoding task, from within a critical
+section, so a value read by another task is never half written. */
+struct xCAN_SIGNAL_DECODER
+{
+	const CAN_Signal_Database_t *pxDatabase;
+	int64_t *pllValues;					/* The raw value of each signal, sign extended. */
+	uint32_t *pulReceived;
+	uint32_t *pulWatched;				/* The signals watched by any watcher, so the watchers are only searched when one of them changes. */
+	size_t xBitmapWords;
+	CAN_Signal_Watcher_t *pxWatchers;
+	CAN_Signals_Statistics_t xStatistics;
+};
+
+/*
+ * Find the message with the ID and format of pxFrame, or return NULL if it is
+ * not in the database.
+ */
+static const CAN_Message_Def_t *prvFindMessage( const CAN_Signal_Database_t * const pxDatabase, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Extract every signal of pxMessage from the payload of pxFrame, and mark the
+ * signals that changed in the watchers watching them.
+ */
+static void prvDecodeMessage( CAN_Signal_Decoder_t * const pxDecoder, const CAN_Message_Def_t * const pxMessage, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Mark signal usSignal as changed in every watcher watching it.
+ */
+static void prvMarkChanged( CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal );
+
+/*
+ * Take the lowest numbered signal marked as changed in pxWatcher.  Returns
+ * pdFAIL if none is.
+ */
+static portBASE_TYPE prvTakeChanged( CAN_Signal_Watcher_t * const pxWatcher, uint16_t * const pusSignal );
+
+static uint32_t prvSwapBytes32( const uint32_t ulValue );
+
+/*-----------------------------------------------------------*/
+
+CAN_Signal_Decoder_t *pxCANSignalsCreate( const CAN_Signal_Database_t * const pxDatabase )
+{
+CAN_Signal_Decoder_t *pxDecoder = NULL;
+size_t xBitmapWords, xBytes;
+
+	configASSERT( pxDatabase );
+
+	if( ( pxDatabase->usMessages > 0U ) && ( pxDatabase->usSignals > 0U ) )
+	{
+		/* The state, followed by the values, then the received and watched
+		bitmaps. */
+		xBitmapWords = cansigBITMAP_WORDS( pxDatabase->usSignals );
+		xBytes = cansigDECODER_BYTES + ( ( size_t ) pxDatabase->usSignals * sizeof( int64_t ) ) + ( 2U * xBitmapWords * sizeof( uint32_t ) );
+		pxDecoder = pvPortMalloc( xBytes );
+
+		if( pxDecoder != NULL )
+		{
+			memset( pxDecoder, 0x00, xBytes );
+			pxDecoder->pxDatabase = pxDatabase;
+			pxDecoder->xBitmapWords = xBitmapWords;
+			pxDecoder->pllValues = ( int64_t * ) ( ( ( uint8_t * ) pxDecoder ) + cansigDECODER_BYTES );
+			pxDecoder->pulReceived = ( uint32_t * ) &( pxDecoder->pllValues[ pxDatabase->usSignals ] );
+			pxDecoder->pulWatched = &( pxDecoder->pulReceived[ xBitmapWords ] );
+		}
+	}
+
+	return pxDecoder;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANSignalsDecode( CAN_Signal_Decoder_t * const pxDecoder, const CAN_MSG_Type * const pxFrames, const size_t xFrames )
+{
+const CAN_Message_Def_t *pxMessage;
+CAN_Signal_Watcher_t *pxWatcher;
+size_t xFrame, xDecoded = 0U;
+
+	configASSERT( pxDecoder );
+
+	for( xFrame = 0U; xFrame < xFrames; xFrame++ )
+	{
+		pxMessage = prvFindMessage( pxDecoder->pxDatabase, &( pxFrames[ xFrame ] ) );
+
+		if( pxMessage == NULL )
+		{
+			( pxDecoder->xStatistics.ulFramesUnknown )++;
+		}
+		else if( pxFrames[ xFrame ].len < pxMessage->ucLength )
+		{
+			( pxDecoder->xStatistics.ulFramesTooShort )++;
+		}
+		else
+		{
+			prvDecodeMessage( pxDecoder, pxMessage, &( pxFrames[ xFrame ] ) );
+			xDecoded++;
+		}
+	}
+
+	pxDecoder->xStatistics.ulFramesDecoded += ( uint32_t ) xDecoded;
+
+	/* Each watcher is woken once, however many of its signals changed. */
+	for( pxWatcher = pxDecoder->pxWatchers; pxWatcher != NULL; pxWatcher = pxWatcher->pxNext )
+	{
+		if( pxWatcher->xWake != pdFALSE )
+		{
+			pxWatcher->xWake = pdFALSE;
+			xSemaphoreGive( pxWatcher->xChanged );
+		}
+	}
+
+	return xDecoded;
+}
+/*-----------------------------------------------------------*/
+
+int64_t llCANSignalsGetRaw( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal )
+{
+int64_t llValue = 0;
+
+	configASSERT( pxDecoder );
+
+	if( usSignal < pxDecoder->pxDatabase->usSignals )
+	{
+		taskENTER_CRITICAL();
+		{
+			llValue = pxDecoder->pllValues[ usSignal ];
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return llValue;
+}
+/*-----------------------------------------------------------*/
+
+float fCANSignalsGetValue( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal )
+{
+float fValue = 0.0F;
+const CAN_Signal_Def_t *pxSignal;
+
+	configASSERT( pxDecoder );
+
+	if( usSignal < pxDecoder->pxDatabase->usSignals )
+	{
+		pxSignal = &( pxDecoder->pxDatabase->pxSignals[ usSignal ] );
+		fValue = ( ( float ) llCANSignalsGetRaw( pxDecoder, usSignal ) * pxSignal->fScale ) + pxSignal->fOffset;
+	}
+
+	return fValue;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xCANSignalsReceived( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal )
+{
+portBASE_TYPE xReturn = pdFALSE;
+
+	configASSERT( pxDecoder );
+
+	if( ( usSignal < pxDecoder->pxDatabase->usSignals ) && ( ( pxDecoder->pulReceived[ cansigWORD( usSignal ) ] & cansigBIT( usSignal ) ) != 0UL ) )
+	{
+		xReturn = pdTRUE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vCANSignalsGetStatistics( const CAN_Signal_Decoder_t * const pxDecoder, CAN_Signals_Statistics_t * const pxStatistics )
+{
+	configASSERT( pxDecoder );
+	*pxStatistics = pxDecoder->xStatistics;
+}
+/*-----------------------------------------------------------*/
+
+CAN_Signal_Watcher_t *pxCANSignalsCreateWatcher( CAN_Signal_Decoder_t * const pxDecoder )
+{
+CAN_Signal_Watcher_t *pxWatcher;
+size_t xBytes;
+
+	configASSERT( pxDecoder );
+
+	xBytes = sizeof( CAN_Signal_Watcher_t ) + ( 2U * pxDecoder->xBitmapWords * sizeof( uint32_t ) );
+	pxWatcher = pvPortMalloc( xBytes );
+
+	if( pxWatcher != NULL )
+	{
+		memset( pxWatcher, 0x00, xBytes );
+		vSemaphoreCreateBinary( pxWatcher->xChanged );
+
+		if( pxWatcher->xChanged == NULL )
+		{
+			vPortFree( pxWatcher );
+			pxWatcher = NULL;
+		}
+		else
+		{
+			/* The semaphore is created available, but nothing has changed
+			yet. */
+			( void ) xSemaphoreTake( pxWatcher->xChanged, 0 );
+
+			pxWatcher->pxDecoder = pxDecoder;
+			pxWatcher->pulWatched = ( uint32_t * ) &( pxWatcher[ 1 ] );
+			pxWatcher->pulChanged = &( pxWatcher->pulWatched[ pxDecoder->xBitmapWords ] );
+
+			taskENTER_CRITICAL();
+			{
+				pxWatcher->pxNext = pxDecoder->pxWatchers;
+				pxDecoder->pxWatchers = pxWatcher;
+			}
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	return pxWatcher;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xCANSignalsWatch( CAN_Signal_Watcher_t * const pxWatcher, const uint16_t usSignal )
+{
+CAN_Signal_Decoder_t *pxDecoder;
+portBASE_TYPE xReturn = pdFAIL;
+
+	configASSERT( pxWatcher );
+	pxDecoder = pxWatcher->pxDecoder;
+
+	if( usSignal < pxDecoder->pxDatabase->usSignals )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxWatcher->pulWatched[ cansigWORD( usSignal ) ] |= cansigBIT( usSignal );
+			pxDecoder->pulWatched[ cansigWORD( usSignal ) ] |= cansigBIT( usSignal );
+
+			if( ( pxDecoder->pulReceived[ cansigWORD( usSignal ) ] & cansigBIT( usSignal ) ) != 0UL )
+			{
+				pxWatcher->pulChanged[ cansigWORD( usSignal ) ] |= cansigBIT( usSignal );
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+portBASE_TYPE xCANSignalsWaitForChange( CAN_Signal_Watcher_t * const pxWatcher, const portTickType xBlockTime, uint16_t * const pusSignal )
+{
+portBASE_TYPE xReturn;
+portTickType xTicksToWait = xBlockTime;
+xTimeOutType xTimeOut;
+
+	configASSERT( pxWatcher );
+
+	xReturn = prvTakeChanged( pxWatcher, pusSignal );
+	vTaskSetTimeOutState( &xTimeOut );
+
+	/* The semaphore can have been given for a change already taken, so it
+	is waited on again until a change is found or the block time expires. */
+	while( ( xReturn == pdFAIL ) && ( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) == pdFALSE ) )
+	{
+		( void ) xSemaphoreTake( pxWatcher->xChanged, xTicksToWait );
+		xReturn = prvTakeChanged( pxWatcher, pusSignal );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static const CAN_Message_Def_t *prvFindMessage( const CAN_Signal_Database_t * const pxDatabase, const CAN_MSG_Type * const pxFrame )
+{
+const CAN_Message_Def_t *pxMessage = NULL;
+uint32_t ulID = pxFrame->id;
+uint16_t usLow = 0U, usHigh = pxDatabase->usMessages, usMiddle;
+
+	if( pxFrame->format == EXT_ID_FORMAT )
+	{
+		ulID |= cansigEXTENDED_ID;
+	}
+
+	/* Remote frames carry no signals. */
+	if( pxFrame->type == DATA_FRAME )
+	{
+		while( usLow < usHigh )
+		{
+			usMiddle = ( uint16_t ) ( ( usLow + usHigh ) / 2U );
+
+			if( pxDatabase->pxMessages[ usMiddle ].ulID < ulID )
+			{
+				usLow = ( uint16_t ) ( usMiddle + 1U );
+			}
+			else if( pxDatabase->pxMessages[ usMiddle ].ulID > ulID )
+			{
+				usHigh = usMiddle;
+			}
+			else
+			{
+				pxMessage = &( pxDatabase->pxMessages[ usMiddle ] );
+				break;
+			}
+		}
+	}
+
+	return pxMessage;
+}
+/*-----------------------------------------------------------*/
+
+static void prvDecodeMessage( CAN_Signal_Decoder_t * const pxDecoder, const CAN_Message_Def_t * const pxMessage, const CAN_MSG_Type * const pxFrame )
+{
+const CAN_Signal_Def_t *pxSignal = &( pxDecoder->pxDatabase->pxSignals[ pxMessage->usFirstSignal ] );
+const uint64_t ullLittleEndian = ( uint64_t ) pxFrame->dataAWord | ( ( uint64_t ) pxFrame->dataBWord << 32 );
+const uint64_t ullBigEndian = ( ( uint64_t ) prvSwapBytes32( pxFrame->dataAWord ) << 32 ) | ( uint64_t ) prvSwapBytes32( pxFrame->dataBWord );
+uint64_t ullRaw, ullMask;
+uint16_t usSignal, usLastSignal = ( uint16_t ) ( pxMessage->usFirstSignal + pxMessage->usSignals );
+uint32_t ulChanged = 0UL;
+
+	taskENTER_CRITICAL();
+	{
+		for( usSignal = pxMessage->usFirstSignal; usSignal < usLastSignal; usSignal++, pxSignal++ )
+		{
+			ullRaw = ( ( ( pxSignal->ucFlags & cansigBIG_ENDIAN ) != 0U ) ? ullBigEndian : ullLittleEndian ) >> pxSignal->ucShift;
+
+			if( pxSignal->ucLength < 64U )
+			{
+				ullMask = ( 1ULL << pxSignal->ucLength ) - 1ULL;
+				ullRaw &= ullMask;
+
+				if( ( ( pxSignal->ucFlags & cansigSIGNED ) != 0U ) && ( ( ullRaw >> ( pxSignal->ucLength - 1U ) ) != 0ULL ) )
+				{
+					ullRaw |= ~ullMask;
+				}
+			}
+
+			if( ( pxDecoder->pllValues[ usSignal ] != ( int64_t ) ullRaw ) || ( ( pxDecoder->pulReceived[ cansigWORD( usSignal ) ] & cansigBIT( usSignal ) ) == 0UL ) )
+			{
+				pxDecoder->pllValues[ usSignal ] = ( int64_t ) ullRaw;
+				pxDecoder->pulReceived[ cansigWORD( usSignal ) ] |= cansigBIT( usSignal );
+				ulChanged++;
+
+				if( ( pxDecoder->pulWatched[ cansigWORD( usSignal ) ] & cansigBIT( usSignal ) ) != 0UL )
+				{
+					prvMarkChanged( pxDecoder, usSignal );
+				}
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	pxDecoder->xStatistics.ulSignalsDecoded += pxMessage->usSignals;
+	pxDecoder->xStatistics.ulSignalsChanged += ulChanged;
+}
+/*-----------------------------------------------------------*/
+
+static void prvMarkChanged( CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal )
+{
+CAN_Signal_Watcher_t *pxWatcher;
+
+	for( pxWatcher = pxDecoder->pxWatchers; pxWatcher != NULL; pxWatcher = pxWatcher->pxNext )
+	{
+		if( ( pxWatcher->pulWatched[ cansigWORD( usSignal ) ] & cansigBIT( usSignal ) ) != 0UL )
+		{
+			pxWatcher->pulChanged[ cansigWORD( usSignal ) ] |= cansigBIT( usSignal );
+			pxWatcher->xWake = pdTRUE;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvTakeChanged( CAN_Signal_Watcher_t * const pxWatcher, uint16_t * const pusSignal )
+{
+portBASE_TYPE xReturn = pdFAIL;
+size_t xWord;
+uint32_t ulBits;
+uint16_t usBit;
+
+	taskENTER_CRITICAL();
+	{
+		for( xWord = 0U; xWord < pxWatcher->pxDecoder->xBitmapWords; xWord++ )
+		{
+			ulBits = pxWatcher->pulChanged[ xWord ];
+
+			if( ulBits != 0UL )
+			{
+				for( usBit = 0U; ( ulBits & 1UL ) == 0UL; usBit++ )
+				{
+					ulBits >>= 1U;
+				}
+
+				pxWatcher->pulChanged[ xWord ] &= ~( 1UL << usBit );
+				*pusSignal = ( uint16_t ) ( ( xWord * cansigBITS_PER_WORD ) + usBit );
+				xReturn = pdPASS;
+				break;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSwapBytes32( const uint32_t ulValue )
+{
+	return ( ulValue >> 24 ) | ( ( ulValue >> 8 ) & 0x0000FF00UL ) | ( ( ulValue << 8 ) & 0x00FF0000UL ) | ( ulValue << 24 );
+}
+/*-----------------------------------------------------------*/
@@ -0,0 +1,90 @@
+/*
+ * Decodes the signals carried by CAN frames, using the constant tables of a
+ * database generated from a DBC file - see CANSignalTable.h.
+ *
+ * The application reads frames from the CAN controller as it does now, and
+ * passes them to xCANSignalsDecode().  Each frame is looked up in the table of
+ * messages, and every signal of its message is extracted with one shift and
+ * mask, in a single pass over the message's part of the signal table.  The raw
+ * value of every signal is kept by the decoder, and can be read by any task as
+ * a raw or a physical value.
+ *
+ * A task that only needs to act when a signal changes creates a watcher, and
+ * adds the signals it cares about to it.  When a frame carries a new value for
+ * a watched signal, the signal is marked as changed in the watcher, and the
+ * task blocked in xCANSignalsWaitForChange() is woken.  Frames that repeat the
+ * values the signals already have wake nobody.  A signal that changes several
+ * times before the task gets to it is reported once, so a watcher cannot
+ * overflow - the task reads the latest value when it is woken.
+ */
+
+#ifndef CAN_SIGNALS_H
+#define CAN_SIGNALS_H
+
+#include "CANSignalTable.h"
+
+/* The counts returned by vCANSignalsGetStatistics(). */
+typedef struct xCAN_SIGNALS_STATISTICS
+{
+	uint32_t ulFramesDecoded;
+	uint32_t ulFramesUnknown;			/* Frames whose ID is not in the database, and remote frames. */
+	uint32_t ulFramesTooShort;			/* Frames shorter than the length of their message, which are not decoded. */
+	uint32_t ulSignalsDecoded;
+	uint32_t ulSignalsChanged;			/* Signals decoded with a different value to the one they had, including the first value of each. */
+} CAN_Signals_Statistics_t;
+
+typedef struct xCAN_SIGNAL_DECODER CAN_Signal_Decoder_t;
+typedef struct xCAN_SIGNAL_WATCHER CAN_Signal_Watcher_t;
+
+/*
+ * Create a decoder for the database pxDatabase, which must remain valid while
+ * the decoder is used.  Returns NULL if the memory could not be allocated.
+ */
+CAN_Signal_Decoder_t *pxCANSignalsCreate( const CAN_Signal_Database_t * const pxDatabase );
+
+/*
+ * Decode the signals carried by xFrames frames, as read from a CAN controller
+ * with ioctlSET_CAN_FRAME_BATCH_MODE or a frame queue, and wake the tasks
+ * watching any of them that changed.  Only one task may decode frames.
+ * Returns the number of frames decoded.
+ */
+size_t xCANSignalsDecode( CAN_Signal_Decoder_t * const pxDecoder, const CAN_MSG_Type * const pxFrames, const size_t xFrames );
+
+/*
+ * The value last decoded for signal usSignal, sign extended if the signal is
+ * signed, or 0 if the signal has not been received.  The physical value is
+ * the raw value scaled and offset as the database says.
+ */
+int64_t llCANSignalsGetRaw( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal );
+float fCANSignalsGetValue( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal );
+
+/*
+ * pdTRUE once signal usSignal has been received.
+ */
+portBASE_TYPE xCANSignalsReceived( const CAN_Signal_Decoder_t * const pxDecoder, const uint16_t usSignal );
+
+void vCANSignalsGetStatistics( const CAN_Signal_Decoder_t * const pxDecoder, CAN_Signals_Statistics_t * const pxStatistics );
+
+/*
+ * Create a watcher, to be used by a single task, which watches no signals
+ * until xCANSignalsWatch() is called.  Returns NULL if the memory or the
+ * semaphore could not be allocated.
+ */
+CAN_Signal_Watcher_t *pxCANSignalsCreateWatcher( CAN_Signal_Decoder_t * const pxDecoder );
+
+/*
+ * Add signal usSignal to those watched.  A signal that has already been
+ * received is marked as changed straight away, so the task starts with its
+ * current value.  Returns pdFAIL if usSignal is not in the database.
+ */
+portBASE_TYPE xCANSignalsWatch( CAN_Signal_Watcher_t * const pxWatcher, const uint16_t usSignal );
+
+/*
+ * Wait up to xBlockTime for a watched signal to change, and return the
+ * signal that changed in *pusSignal, marking it as no longer changed.  Returns
+ * at once, without blocking, while any watched signal is marked as changed.
+ * Returns pdFAIL if none changed within xBlockTime.
+ */
+portBASE_TYPE xCANSignalsWaitForChange( CAN_Signal_Watcher_t * const pxWatcher, const portTickType xBlockTime, uint16_t * const pusSignal );
+
+#endif /* CAN_SIGNALS_H */
@@ -0,0 +1,138 @@
+/*
+    FreeRTOS V7.3.0 - Copyright (C) 2012 Real Time Engineers Ltd.
+
+
+    ***************************************************************************
+     *                                                                       *
+     *    FreeRTOS tutorial books are available in pdf and paperback.        *
+     *    Complete, revised, and edited pdf reference manuals are also       *
+     *    available.                                                         *
+     *                                                                       *
+     *    Purchasing FreeRTOS documentation will not only help you, by       *
+     *    ensuring you get running as quickly as possible and with an        *
+     *    in-depth knowledge of how to use FreeRTOS, it will also help       *
+     *    the FreeRTOS project to continue with its mission of providing     *
+     *    professional grade, cross platform, de facto standard solutions    *
+     *    for microcontrollers - completely free of charge!                  *
+     *                                                                       *
+     *    >>> See http://www.FreeRTOS.org/Documentation for details. <<<     *
+     *                                                                       *
+     *    Thank you for using FreeRTOS, and thank you for your support!      *
+     *                                                                       *
+    ***************************************************************************
+
+
+    This file is part of the FreeRTOS distribution.
+
+    FreeRTOS is free software; you can redistribute it and/or modify it under
+    the terms of the GNU General Public License (version 2) as published by the
+    Free Software Foundation AND MODIFIED BY the FreeRTOS exception.
+    >>>NOTE<<< The modification to the GPL is included to allow you to
+    distribute a combined work that includes FreeRTOS without being obliged to
+    provide the source code for proprietary components outside of the FreeRTOS
+    kernel.  FreeRTOS is distributed in the hope that it will be useful, but
+    WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+    or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+    more details. You should have received a copy of the GNU General Public
+    License and the FreeRTOS license exception along with FreeRTOS; if not it
+    can be viewed here: http://www.freertos.org/a00114.html and also obtained
+    by writing to Richard Barry, contact details for whom are available on the
+    FreeRTOS WEB site.
+
+    1 tab == 4 spaces!
+
+    http://www.FreeRTOS.org - Documentation, latest information, license and
+    contact details.
+
+    http://www.SafeRTOS.com - A version that is certified for use in safety
+    critical systems.
+
+    http://www.OpenRTOS.com - Commercial support, development, porting,
+    licensing and training services.
+*/
+
+/*
+ * Logs every frame received by CAN2 to a binary file on the SD card, using
+ * the logger in Source/CANLogger.  A start up task opens CAN2, then waits for
+ * the SPI-interface-to-SD-card example to mount the card, creates the logger,
+ * and starts the logger's collector and writer tasks.  The log can be
+ * converted to text or CSV on a PC by the can-log-decode tool built by
+ * FreeRTOS-Plus-CAN-Simulator.
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
+/* Example includes. */
+#include "CAN-logger-to-SD-card.h"
+#include "CANLogger.h"
+
+/* Delay used between attempts to create the logger, while the card is not
+yet mounted. */
+#define canlogLONG_DELAY				( 1000 / portTICK_RATE_MS )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * Opens CAN2, creates the logger once the card is mounted, starts the writer
+ * task, then becomes the collector task.
+ */
+static void prvCANLoggerStartTask( void *pvParameters );
+
+/*-----------------------------------------------------------*/
+
+void vStartCANLoggerToSDCardTasks( void )
+{
+	/* The start up task runs at the collector's priority, as it goes on to
+	become the collector. */
+	xTaskCreate( 	prvCANLoggerStartTask,				/* The task that creates the logger then collects frames for it. */
+					( const int8_t * const ) "CANLog", 	/* Text name assigned to the task.  This is just to assist debugging.  The kernel does not use this name itself. */
+					configCAN_LOGGER_STACK_SIZE,		/* The size of the stack allocated to the task. */
+					NULL,								/* The parameter is not used, so NULL is passed. */
+					configCAN_LOGGER_COLLECTOR_PRIORITY,/* The priority allocated to the task. */
+					NULL );								/* A handle to the task being created is not required, so just pass in NULL. */
+}
+/*-----------------------------------------------------------*/
+
+static void prvCANLoggerStartTask( void *pvParameters )
+{
+CAN_Logger_Config_t xConfig;
+CAN_Logger_t *pxLogger = NULL;
+
+	( void ) pvParameters;
+
+	xConfig.xCAN = FreeRTOS_open( ( const int8_t * ) "/CAN2/", 0 );
+	configASSERT( xConfig.xCAN );
+
+	FreeRTOS_ioctl( xConfig.xCAN, ioctlSET_SPEED, ( void * ) configCAN_LOGGER_BIT_RATE );
+	FreeRTOS_ioctl( xConfig.xCAN, ioctlUSE_CAN_FRAME_QUEUE_RX, ( void * ) configCAN_LOGGER_RX_QUEUE_LENGTH );
+
+	xConfig.pcFileName = configCAN_LOGGER_FILE_NAME;
+	xConfig.ulBitRate = configCAN_LOGGER_BIT_RATE;
+	xConfig.ulFileBlocks = configCAN_LOGGER_FILE_BLOCKS;
+	xConfig.usBufferBlocks = configCAN_LOGGER_BUFFER_BLOCKS;
+	xConfig.usFlushIntervalMs = configCAN_LOGGER_FLUSH_INTERVAL_MS;
+
+	/* The file cannot be opened until the card has been mounted by the
+	SPI-interface-to-SD-card example. */
+	while( pxLogger == NULL )
+	{
+		pxLogger = pxCANLoggerCreate( &xConfig );
+
+		if( pxLogger == NULL )
+		{
+			vTaskDelay( canlogLONG_DELAY );
+		}
+	}
+
+	/* The writer has the lower priority, so the collector keeps reading
+	frames while the writer waits for the card. */
+	xTaskCreate( vCANLoggerWriterTask, ( const int8_t * const ) "CANLogWr", configCAN_LOGGER_STACK_SIZE, pxLogger, configCAN_LOGGER_WRITER_PRIORITY, NULL );
+	vCANLoggerCollectorTask( pxLogger );
+}
+/*-----------------------------------------------------------*/
+
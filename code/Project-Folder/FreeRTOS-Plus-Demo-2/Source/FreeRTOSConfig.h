@@ -197,4 +197,51 @@ standard names. */
 #define configNET_MASK2		255
 #define configNET_MASK3		0
 
+/*-----------------------------------------------------------
+ * CAN-over-UDP bridge configuration.
+ *-----------------------------------------------------------*/
+
+/* The bench PC that receives the frames from CAN1, and the ports used in each
+direction. */
+#define configCAN_UDP_PEER_ADDR0		192
+#define configCAN_UDP_PEER_ADDR1		168
+#define configCAN_UDP_PEER_ADDR2		0
+#define configCAN_UDP_PEER_ADDR3		10
+#define configCAN_UDP_PEER_PORT			( 47100U )
+#define configCAN_UDP_LOCAL_PORT		( 47101U )
+
+/* Datagrams are kept well below the MTU, as they are buffered in the FreeRTOS
+heap, and a received frame waits no more than 5ms for a datagram to fill. */
+#define configCAN_UDP_MAX_DATAGRAM_BYTES	( 512U )
+#define configCAN_UDP_FLUSH_LATENCY_MS		( 5U )
+
+#define configCAN_UDP_BIT_RATE				( 500000UL )
+#define configCAN_UDP_RX_QUEUE_LENGTH		( 64UL )
+#define configCAN_UDP_TX_QUEUE_LENGTH		( 32UL )
+#define configCAN_UDP_TASK_PRIORITY			( 2U )
+#define configCAN_UDP_STACK_SIZE			( configMINIMAL_STACK_SIZE * 3UL )
+
+/*-----------------------------------------------------------
+ * CAN logger configuration.
+ *-----------------------------------------------------------*/
+
+/* Every frame received by CAN2 is logged to this file on the SD card, which is
+extended to 32MB when logging starts - about eight minutes of a 500 kbit/s bus
+at full load. */
+#define configCAN_LOGGER_FILE_NAME			"CANLOG.BIN"
+#define configCAN_LOGGER_FILE_BLOCKS		( 65536UL )
+#define configCAN_LOGGER_BIT_RATE			( 500000UL )
+#define configCAN_LOGGER_RX_QUEUE_LENGTH	( 64UL )
+
+/* The two buffers come from the FreeRTOS heap, so are kept small.  At full
+load each holds about 60ms of frames, and the Rx queue another 16ms, which a
+card that stalls for longer than that while it writes needs more of. */
+#define configCAN_LOGGER_BUFFER_BLOCKS		( 8U )
+#define configCAN_LOGGER_FLUSH_INTERVAL_MS	( 500U )
+
+/* The collector must have a higher priority than the writer. */
+#define configCAN_LOGGER_COLLECTOR_PRIORITY	( 3U )
+#define configCAN_LOGGER_WRITER_PRIORITY	( 1U )
+#define configCAN_LOGGER_STACK_SIZE			( configMINIMAL_STACK_SIZE * 3UL )
+
 #endif /* FREERTOS_CONFIG_H */
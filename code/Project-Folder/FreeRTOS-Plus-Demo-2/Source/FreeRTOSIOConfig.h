@@ -68,6 +68,25 @@
 	#define ioconfigUSE_I2C_CIRCULAR_BUFFER_RX				0
 	#define ioconfigUSE_I2C_TX_CHAR_QUEUE					0
 
+/* CAN1 is bridged to UDP by the CANUDPBridge lwIP application, which reads
+and writes through the frame queues. */
+#define ioconfigINCLUDE_CAN									1
+	#define ioconfigUSE_CAN_POLLED_TX						1
+	#define ioconfigUSE_CAN_POLLED_RX						1
+	#define ioconfigUSE_CAN_ZERO_COPY_TX					0
+	#define ioconfigUSE_CAN_CIRCULAR_BUFFER_RX				0
+	#define ioconfigUSE_CAN_TX_CHAR_QUEUE					0
+	#define ioconfigUSE_CAN_FRAME_QUEUE_RX					1
+	#define ioconfigUSE_CAN_FRAME_QUEUE_TX					1
+	#define ioconfigUSE_CAN_TIMESTAMPS						1
+	#define ioconfigUSE_CAN_ANALYTICS						0
+	#define ioconfigUSE_CAN_ISOTP							0
+	#define ioconfigUSE_CAN_J1939							0
+	#define ioconfigUSE_CAN_SUBSCRIBERS						0
+	#define ioconfigUSE_CAN_CYCLIC_TX						0
+	#define ioconfigUSE_CAN_TX_CONFIRMATION					0
+	#define ioconfigUSE_CAN_TX_DEADLINES					0
+
 
 
 
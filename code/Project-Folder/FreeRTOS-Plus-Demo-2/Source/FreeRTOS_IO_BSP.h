@@ -38,7 +38,7 @@
 #ifndef FREERTOS_BOARD_H
 #define FREERTOS_BOARD_H
 
-#include "LPCXpresso17xx-base-board.h"
+#include "LPC17xxBSP.h"
 
 #endif /* FREERTOS_BOARD_H */
 
@@ -0,0 +1,351 @@
+/*
+ * The CAN-over-UDP bridge.  See CANUDPBridge.h for the datagram format.
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
+/* lwIP includes. */
+#include "lwip/sockets.h"
+
+/* Application includes. */
+#include "CANUDPBridge.h"
+
+/* The first bytes of every datagram. */
+#define canudpMAGIC_0					( ( uint8_t ) 'C' )
+#define canudpMAGIC_1					( ( uint8_t ) 'U' )
+
+/* The state of a bridge.  The frames and datagram buffers of each direction
+are only used by the task that services that direction. */
+struct xCAN_UDP_BRIDGE
+{
+	Peripheral_Descriptor_t xCAN;
+	int32_t lTxSocket;
+	int32_t lRxSocket;
+	struct sockaddr_in xPeerAddress;
+	size_t xMaxDatagramBytes;
+	size_t xTxFramesPerDatagram;		/* The most frames of any length that fit in a datagram. */
+	size_t xRxFramesPerDatagram;		/* The most frames that fit in a datagram if none carry data. */
+	uint32_t ulNextSequenceNumber;
+	CAN_MSG_Type *pxTxFrames;			/* Frames read from the controller. */
+	CAN_MSG_Type *pxRxFrames;			/* Frames unpacked from a received datagram. */
+	uint8_t *pucTxDatagram;				/* xMaxDatagramBytes each. */
+	uint8_t *pucRxDatagram;
+	CAN_UDP_Bridge_Statistics_t xStatistics;
+};
+
+/*
+ * Little endian access to the 32 bit fields of a datagram.
+ */
+static void prvWriteLittleEndian32( uint8_t * const pucBytes, const uint32_t ulValue );
+static uint32_t prvReadLittleEndian32( const uint8_t * const pucBytes );
+
+/*-----------------------------------------------------------*/
+
+CAN_UDP_Bridge_t *pxCANUDPBridgeCreate( const CAN_UDP_Bridge_Config_t * const pxConfig )
+{
+CAN_UDP_Bridge_t *pxBridge = NULL;
+struct sockaddr_in xLocalAddress;
+portTickType xFlushLatency;
+size_t xBytes, xTxFrames, xRxFrames;
+
+	configASSERT( pxConfig );
+
+	if( ( pxConfig->xCAN != NULL ) && ( pxConfig->usMaxDatagramBytes >= ( canudpHEADER_BYTES + canudpMAX_RECORD_BYTES ) ) && ( pxConfig->usMaxDatagramBytes <= canudpMAX_DATAGRAM_BYTES ) )
+	{
+		/* The state, followed by the frames and datagram buffers of both
+		directions. */
+		xTxFrames = ( pxConfig->usMaxDatagramBytes - canudpHEADER_BYTES ) / canudpMAX_RECORD_BYTES;
+		xRxFrames = ( pxConfig->usMaxDatagramBytes - canudpHEADER_BYTES ) / canudpRECORD_HEADER_BYTES;
+		xBytes = sizeof( CAN_UDP_Bridge_t ) + ( ( xTxFrames + xRxFrames ) * sizeof( CAN_MSG_Type ) ) + ( 2U * pxConfig->usMaxDatagramBytes );
+		pxBridge = pvPortMalloc( xBytes );
+
+		if( pxBridge != NULL )
+		{
+			memset( pxBridge, 0x00, xBytes );
+			pxBridge->xCAN = pxConfig->xCAN;
+			pxBridge->xMaxDatagramBytes = pxConfig->usMaxDatagramBytes;
+			pxBridge->xTxFramesPerDatagram = xTxFrames;
+			pxBridge->xRxFramesPerDatagram = xRxFrames;
+			pxBridge->pxTxFrames = ( CAN_MSG_Type * ) ( pxBridge + 1 );
+			pxBridge->pxRxFrames = pxBridge->pxTxFrames + xTxFrames;
+			pxBridge->pucTxDatagram = ( uint8_t * ) ( pxBridge->pxRxFrames + xRxFrames );
+			pxBridge->pucRxDatagram = pxBridge->pucTxDatagram + pxConfig->usMaxDatagramBytes;
+
+			pxBridge->xPeerAddress.sin_family = AF_INET;
+			pxBridge->xPeerAddress.sin_port = htons( pxConfig->usPeerPort );
+			pxBridge->xPeerAddress.sin_addr.s_addr = pxConfig->ulPeerAddress;
+
+			memset( &xLocalAddress, 0x00, sizeof( xLocalAddress ) );
+			xLocalAddress.sin_family = AF_INET;
+			xLocalAddress.sin_port = htons( pxConfig->usLocalPort );
+			xLocalAddress.sin_addr.s_addr = htonl( INADDR_ANY );
+
+			pxBridge->lTxSocket = lwip_socket( AF_INET, SOCK_DGRAM, 0 );
+			pxBridge->lRxSocket = lwip_socket( AF_INET, SOCK_DGRAM, 0 );
+
+			if( ( pxBridge->lTxSocket < 0 ) || ( pxBridge->lRxSocket < 0 ) || ( lwip_bind( pxBridge->lRxSocket, ( struct sockaddr * ) &xLocalAddress, sizeof( xLocalAddress ) ) < 0 ) )
+			{
+				if( pxBridge->lTxSocket >= 0 )
+				{
+					lwip_close( pxBridge->lTxSocket );
+				}
+
+				if( pxBridge->lRxSocket >= 0 )
+				{
+					lwip_close( pxBridge->lRxSocket );
+				}
+
+				vPortFree( pxBridge );
+				pxBridge = NULL;
+			}
+			else
+			{
+				/* A read of the controller returns once it has filled a
+				datagram, or once the flush latency has passed - which must be
+				at least a tick, or the bridge would spin. */
+				xFlushLatency = ( portTickType ) pxConfig->usFlushLatencyMs / portTICK_RATE_MS;
+				if( xFlushLatency == 0U )
+				{
+					xFlushLatency = 1U;
+				}
+				FreeRTOS_ioctl( pxBridge->xCAN, ioctlSET_RX_TIMEOUT, ( void * ) xFlushLatency );
+			}
+		}
+	}
+
+	return pxBridge;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANUDPBridgeForwardFromCAN( CAN_UDP_Bridge_t * const pxBridge )
+{
+size_t xFrames, xFramesPacked, xBytes;
+int32_t lBytesSent;
+
+	configASSERT( pxBridge );
+
+	xFrames = FreeRTOS_read( pxBridge->xCAN, pxBridge->pxTxFrames, pxBridge->xTxFramesPerDatagram * sizeof( CAN_MSG_Type ) ) / sizeof( CAN_MSG_Type );
+
+	if( xFrames > 0U )
+	{
+		xBytes = xCANUDPPackDatagram( pxBridge->pxTxFrames, xFrames, pxBridge->ulNextSequenceNumber, pxBridge->pucTxDatagram, pxBridge->xMaxDatagramBytes, &xFramesPacked );
+		configASSERT( xFramesPacked == xFrames );
+
+		/* The sequence number moves on even if the datagram is not sent, so
+		the peer can tell frames have been lost. */
+		pxBridge->ulNextSequenceNumber++;
+
+		lBytesSent = lwip_sendto( pxBridge->lTxSocket, pxBridge->pucTxDatagram, xBytes, 0, ( struct sockaddr * ) &( pxBridge->xPeerAddress ), sizeof( pxBridge->xPeerAddress ) );
+
+		if( lBytesSent == ( int32_t ) xBytes )
+		{
+			pxBridge->xStatistics.ulDatagramsSent++;
+			pxBridge->xStatistics.ulFramesForwarded += ( uint32_t ) xFrames;
+		}
+		else
+		{
+			pxBridge->xStatistics.ulDatagramsNotSent++;
+			xFrames = 0U;
+		}
+	}
+
+	return xFrames;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANUDPBridgeForwardToCAN( CAN_UDP_Bridge_t * const pxBridge, portBASE_TYPE xBlock )
+{
+size_t xFrames = 0U, xFramesWritten = 0U;
+int32_t lBytes;
+uint32_t ulSequenceNumber;
+
+	configASSERT( pxBridge );
+
+	lBytes = lwip_recvfrom( pxBridge->lRxSocket, pxBridge->pucRxDatagram, pxBridge->xMaxDatagramBytes, ( xBlock != pdFALSE ) ? 0 : MSG_DONTWAIT, NULL, NULL );
+
+	if( lBytes > 0 )
+	{
+		pxBridge->xStatistics.ulDatagramsReceived++;
+		xFrames = xCANUDPUnpackDatagram( pxBridge->pucRxDatagram, ( size_t ) lBytes, pxBridge->pxRxFrames, pxBridge->xRxFramesPerDatagram, &ulSequenceNumber );
+
+		if( xFrames == 0U )
+		{
+			pxBridge->xStatistics.ulDatagramsRejected++;
+		}
+		else
+		{
+			xFramesWritten = FreeRTOS_write( pxBridge->xCAN, pxBridge->pxRxFrames, xFrames * sizeof( CAN_MSG_Type ) ) / sizeof( CAN_MSG_Type );
+			pxBridge->xStatistics.ulFramesInjected += ( uint32_t ) xFramesWritten;
+			pxBridge->xStatistics.ulFramesNotInjected += ( uint32_t ) ( xFrames - xFramesWritten );
+		}
+	}
+
+	return xFramesWritten;
+}
+/*-----------------------------------------------------------*/
+
+void vCANUDPBridgeGetStatistics( const CAN_UDP_Bridge_t * const pxBridge, CAN_UDP_Bridge_Statistics_t * const pxStatistics )
+{
+	configASSERT( pxBridge );
+	configASSERT( pxStatistics );
+
+	/* Each count is only written by one task, and a torn read of a 32 bit
+	count cannot happen, so no critical section is needed. */
+	*pxStatistics = pxBridge->xStatistics;
+}
+/*-----------------------------------------------------------*/
+
+void vCANUDPBridgeCANToUDPTask( void *pvParameters )
+{
+CAN_UDP_Bridge_t * const pxBridge = ( CAN_UDP_Bridge_t * ) pvParameters;
+
+	for( ;; )
+	{
+		xCANUDPBridgeForwardFromCAN( pxBridge );
+	}
+}
+/*-----------------------------------------------------------*/
+
+void vCANUDPBridgeUDPToCANTask( void *pvParameters )
+{
+CAN_UDP_Bridge_t * const pxBridge = ( CAN_UDP_Bridge_t * ) pvParameters;
+
+	for( ;; )
+	{
+		xCANUDPBridgeForwardToCAN( pxBridge, pdTRUE );
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANUDPPackDatagram( const CAN_MSG_Type * const pxFrames, size_t xFrames, uint32_t ulSequenceNumber, uint8_t * const pucDatagram, size_t xMaxBytes, size_t * const pxFramesPacked )
+{
+size_t xBytes = canudpHEADER_BYTES, xFrame, xDataBytes;
+uint32_t ulID;
+
+	configASSERT( xMaxBytes >= canudpHEADER_BYTES );
+
+	for( xFrame = 0U; ( xFrame < xFrames ) && ( xFrame < 0xFFU ); xFrame++ )
+	{
+		xDataBytes = ( pxFrames[ xFrame ].type == REMOTE_FRAME ) ? 0U : pxFrames[ xFrame ].len;
+		if( xDataBytes > 8U )
+		{
+			xDataBytes = 8U;
+		}
+
+		if( ( xBytes + canudpRECORD_HEADER_BYTES + xDataBytes ) > xMaxBytes )
+		{
+			break;
+		}
+
+		ulID = pxFrames[ xFrame ].id;
+		if( pxFrames[ xFrame ].format == EXT_ID_FORMAT )
+		{
+			ulID |= canudpID_EXTENDED;
+		}
+		if( pxFrames[ xFrame ].type == REMOTE_FRAME )
+		{
+			ulID |= canudpID_REMOTE;
+		}
+
+		prvWriteLittleEndian32( &( pucDatagram[ xBytes ] ), pxFrames[ xFrame ].timestamp );
+		prvWriteLittleEndian32( &( pucDatagram[ xBytes + 4U ] ), ulID );
+		pucDatagram[ xBytes + 8U ] = ( pxFrames[ xFrame ].len > 8U ) ? 8U : pxFrames[ xFrame ].len;
+
+		/* dataA and dataB hold the data bytes in order. */
+		memcpy( &( pucDatagram[ xBytes + canudpRECORD_HEADER_BYTES ] ), pxFrames[ xFrame ].dataA, ( xDataBytes > 4U ) ? 4U : xDataBytes );
+		if( xDataBytes > 4U )
+		{
+			memcpy( &( pucDatagram[ xBytes + canudpRECORD_HEADER_BYTES + 4U ] ), pxFrames[ xFrame ].dataB, xDataBytes - 4U );
+		}
+
+		xBytes += canudpRECORD_HEADER_BYTES + xDataBytes;
+	}
+
+	pucDatagram[ 0 ] = canudpMAGIC_0;
+	pucDatagram[ 1 ] = canudpMAGIC_1;
+	pucDatagram[ 2 ] = canudpVERSION;
+	pucDatagram[ 3 ] = ( uint8_t ) xFrame;
+	prvWriteLittleEndian32( &( pucDatagram[ 4 ] ), ulSequenceNumber );
+
+	*pxFramesPacked = xFrame;
+
+	return xBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xCANUDPUnpackDatagram( const uint8_t * const pucDatagram, size_t xBytes, CAN_MSG_Type * const pxFrames, size_t xMaxFrames, uint32_t * const pulSequenceNumber )
+{
+size_t xFrames = 0U, xFrame, xOffset = canudpHEADER_BYTES, xDataBytes;
+uint32_t ulID;
+
+	if( ( xBytes >= canudpHEADER_BYTES ) && ( pucDatagram[ 0 ] == canudpMAGIC_0 ) && ( pucDatagram[ 1 ] == canudpMAGIC_1 ) && ( pucDatagram[ 2 ] == canudpVERSION ) && ( pucDatagram[ 3 ] <= xMaxFrames ) )
+	{
+		xFrames = pucDatagram[ 3 ];
+		*pulSequenceNumber = prvReadLittleEndian32( &( pucDatagram[ 4 ] ) );
+
+		for( xFrame = 0U; xFrame < xFrames; xFrame++ )
+		{
+			if( ( xOffset + canudpRECORD_HEADER_BYTES ) > xBytes )
+			{
+				break;
+			}
+
+			ulID = prvReadLittleEndian32( &( pucDatagram[ xOffset + 4U ] ) );
+
+			memset( &( pxFrames[ xFrame ] ), 0x00, sizeof( CAN_MSG_Type ) );
+			pxFrames[ xFrame ].timestamp = prvReadLittleEndian32( &( pucDatagram[ xOffset ] ) );
+			pxFrames[ xFrame ].id = ulID & ~( canudpID_EXTENDED | canudpID_REMOTE );
+			pxFrames[ xFrame ].format = ( ( ulID & canudpID_EXTENDED ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT;
+			pxFrames[ xFrame ].type = ( ( ulID & canudpID_REMOTE ) != 0UL ) ? REMOTE_FRAME : DATA_FRAME;
+			pxFrames[ xFrame ].len = pucDatagram[ xOffset + 8U ];
+
+			xDataBytes = ( pxFrames[ xFrame ].type == REMOTE_FRAME ) ? 0U : pxFrames[ xFrame ].len;
+
+			if( ( pxFrames[ xFrame ].len > 8U ) || ( ( xOffset + canudpRECORD_HEADER_BYTES + xDataBytes ) > xBytes ) )
+			{
+				break;
+			}
+
+			memcpy( pxFrames[ xFrame ].dataA, &( pucDatagram[ xOffset + canudpRECORD_HEADER_BYTES ] ), ( xDataBytes > 4U ) ? 4U : xDataBytes );
+			if( xDataBytes > 4U )
+			{
+				memcpy( pxFrames[ xFrame ].dataB, &( pucDatagram[ xOffset + canudpRECORD_HEADER_BYTES + 4U ] ), xDataBytes - 4U );
+			}
+
+			xOffset += canudpRECORD_HEADER_BYTES + xDataBytes;
+		}
+
+		/* A truncated record, a bad DLC, or bytes left over after the last
+		record all make the whole datagram invalid. */
+		if( ( xFrame < xFrames ) || ( xOffset != xBytes ) )
+		{
+			xFrames = 0U;
+		}
+	}
+
+	return xFrames;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteLittleEndian32( uint8_t * const pucBytes, const uint32_t ulValue )
+{
+	pucBytes[ 0 ] = ( uint8_t ) ulValue;
+	pucBytes[ 1 ] = ( uint8_t ) ( ulValue >> 8 );
+	pucBytes[ 2 ] = ( uint8_t ) ( ulValue >> 16 );
+	pucBytes[ 3 ] = ( uint8_t ) ( ulValue >> 24 );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvReadLittleEndian32( const uint8_t * const pucBytes )
+{
+	return ( uint32_t ) pucBytes[ 0 ] | ( ( uint32_t ) pucBytes[ 1 ] << 8 ) | ( ( uint32_t ) pucBytes[ 2 ] << 16 ) | ( ( uint32_t ) pucBytes[ 3 ] << 24 );
+}
+/*-----------------------------------------------------------*/
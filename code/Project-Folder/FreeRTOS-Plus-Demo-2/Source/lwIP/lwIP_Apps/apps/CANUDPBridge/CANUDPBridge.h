@@ -0,0 +1,123 @@
+/*
+ * A bridge between a CAN controller and a UDP peer, such as a bench PC that
+ * monitors and stimulates the bus.
+ *
+ * Frames received by the controller are packed, with their timestamps, into
+ * datagrams sent to the peer.  A datagram is sent once it is full, or once the
+ * first frame in it has waited for the flush latency, so at full bus load the
+ * cost of UDP, IP and Ethernet headers is shared by many frames.  Datagrams
+ * received from any peer on the local port are unpacked, and their frames
+ * written to the controller.
+ *
+ * The bridge uses the lwIP sockets API.  Each direction is serviced by its own
+ * task, or by the application calling xCANUDPBridgeForwardFromCAN() and
+ * xCANUDPBridgeForwardToCAN() itself.
+ *
+ * Every datagram, in either direction, starts with an 8 byte header:
+ *
+ *   bytes 0-1  'C', 'U'
+ *   byte  2    canudpVERSION
+ *   byte  3    the number of frames that follow, 1 or more
+ *   bytes 4-7  a sequence number, incremented for every datagram the bridge
+ *              sends, so the peer can see when a datagram has been lost
+ *
+ * followed by one variable length record per frame:
+ *
+ *   bytes 0-3  the timestamp the driver gave the frame, in units of
+ *              boardCAN_TIMESTAMP_RESOLUTION_US - ignored for injected frames
+ *   bytes 4-7  the ID, with canudpID_EXTENDED and canudpID_REMOTE or'ed in
+ *   byte  8    the DLC, 0 to 8
+ *   bytes 9-   the data bytes, DLC of them for a data frame, none for a remote
+ *              frame
+ *
+ * Every multi byte field is little endian.
+ */
+
+#ifndef CAN_UDP_BRIDGE_H
+#define CAN_UDP_BRIDGE_H
+
+/* The largest UDP payload that fits a 1500 byte Ethernet frame without IP
+fragmentation. */
+#define canudpMAX_DATAGRAM_BYTES		( 1472U )
+
+#define canudpVERSION					( 1U )
+#define canudpHEADER_BYTES				( 8U )
+#define canudpRECORD_HEADER_BYTES		( 9U )
+#define canudpMAX_RECORD_BYTES			( canudpRECORD_HEADER_BYTES + 8U )
+
+/* Flags or'ed into the ID field of a record. */
+#define canudpID_EXTENDED				( 0x80000000UL )
+#define canudpID_REMOTE					( 0x40000000UL )
+
+/* The configuration passed to pxCANUDPBridgeCreate(). */
+typedef struct xCAN_UDP_BRIDGE_CONFIG
+{
+	Peripheral_Descriptor_t xCAN;		/* An open controller.  Frames are only forwarded to the peer if it uses ioctlUSE_CAN_FRAME_QUEUE_RX, and injected frames are best written through ioctlUSE_CAN_FRAME_QUEUE_TX. */
+	uint32_t ulPeerAddress;				/* The IPv4 address datagrams are sent to, in network byte order. */
+	uint16_t usPeerPort;
+	uint16_t usLocalPort;				/* The port on which datagrams of frames to inject are received. */
+	uint16_t usMaxDatagramBytes;		/* The longest datagram sent or accepted, up to canudpMAX_DATAGRAM_BYTES.  The bridge allocates buffers for two datagrams, and for as many frames as fit in them. */
+	uint16_t usFlushLatencyMs;			/* The longest a received frame waits for a datagram to fill. */
+} CAN_UDP_Bridge_Config_t;
+
+/* The counts returned by vCANUDPBridgeGetStatistics(). */
+typedef struct xCAN_UDP_BRIDGE_STATISTICS
+{
+	uint32_t ulFramesForwarded;			/* Frames sent to the peer. */
+	uint32_t ulDatagramsSent;
+	uint32_t ulDatagramsNotSent;		/* Datagrams the stack refused, for example for lack of buffers.  Their sequence numbers are skipped. */
+	uint32_t ulDatagramsReceived;
+	uint32_t ulDatagramsRejected;		/* Received datagrams that were not valid, none of whose frames were injected. */
+	uint32_t ulFramesInjected;			/* Frames written to the controller. */
+	uint32_t ulFramesNotInjected;		/* Frames of valid datagrams the controller did not accept within its Tx timeout. */
+} CAN_UDP_Bridge_Statistics_t;
+
+typedef struct xCAN_UDP_BRIDGE CAN_UDP_Bridge_t;
+
+/*
+ * Open the sockets of a bridge, and set the Rx timeout of the controller to
+ * the flush latency.  Returns NULL if the configuration is not valid, or the
+ * sockets or buffers could not be created.
+ */
+CAN_UDP_Bridge_t *pxCANUDPBridgeCreate( const CAN_UDP_Bridge_Config_t * const pxConfig );
+
+/*
+ * Wait up to the flush latency for enough frames to fill a datagram, then send
+ * the frames received, if any, to the peer.  Returns the number of frames
+ * sent.
+ */
+size_t xCANUDPBridgeForwardFromCAN( CAN_UDP_Bridge_t * const pxBridge );
+
+/*
+ * Receive one datagram from the local port, waiting for one to arrive if
+ * xBlock is pdTRUE, and write its frames to the controller.  Returns the number
+ * of frames the controller accepted.
+ */
+size_t xCANUDPBridgeForwardToCAN( CAN_UDP_Bridge_t * const pxBridge, portBASE_TYPE xBlock );
+
+void vCANUDPBridgeGetStatistics( const CAN_UDP_Bridge_t * const pxBridge, CAN_UDP_Bridge_Statistics_t * const pxStatistics );
+
+/*
+ * Tasks that service one direction of the bridge passed as their parameter
+ * for ever.
+ */
+void vCANUDPBridgeCANToUDPTask( void *pvParameters );
+void vCANUDPBridgeUDPToCANTask( void *pvParameters );
+
+/*
+ * Pack up to xFrames frames into pucDatagram, which can hold xMaxBytes, giving
+ * the datagram sequence number ulSequenceNumber.  Returns the length of the
+ * datagram, and the number of frames it holds in *pxFramesPacked - which is
+ * less than xFrames if they did not all fit.
+ */
+size_t xCANUDPPackDatagram( const CAN_MSG_Type * const pxFrames, size_t xFrames, uint32_t ulSequenceNumber, uint8_t * const pucDatagram, size_t xMaxBytes, size_t * const pxFramesPacked );
+
+/*
+ * Unpack the frames of the xBytes long datagram pucDatagram into pxFrames,
+ * which can hold xMaxFrames.  Returns the number of frames, and the datagram's
+ * sequence number in *pulSequenceNumber, or 0 if the datagram is not valid or
+ * holds more than xMaxFrames frames.
+ */
+size_t xCANUDPUnpackDatagram( const uint8_t * const pucDatagram, size_t xBytes, CAN_MSG_Type * const pxFrames, size_t xMaxFrames, uint32_t * const pulSequenceNumber );
+
+#endif /* CAN_UDP_BRIDGE_H */
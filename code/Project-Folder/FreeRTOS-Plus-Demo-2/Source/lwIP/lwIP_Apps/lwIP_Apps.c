@@ -66,8 +66,12 @@
 /* lwIP netif includes */
 #include "netif/etharp.h"
 
+/* FreeRTOS+IO includes. */
+#include "FreeRTOS_IO.h"
+
 /* applications includes */
 #include "apps/httpserver_raw/httpd.h"
+#include "apps/CANUDPBridge/CANUDPBridge.h"
 
 /* The constants that define the IP address, net mask, gateway address and MAC
 address are located at the bottom of FreeRTOSConfig.h. */
@@ -89,6 +93,13 @@ array.  If pccSSITags is updated, then these definitions must also be updated. *
  */
 extern void vBasicSocketsCommandInterpreterTask( void *pvParameters );
 
+/*
+ * Opens CAN1 and bridges it to UDP.  The sockets cannot be created from the
+ * TCP/IP thread, so this is done from its own task, which then forwards frames
+ * from CAN1 to the bench PC, while a second task forwards frames the other way.
+ */
+static void prvCANUDPBridgeTask( void *pvParameters );
+
 /*
  * The SSI handler callback function passed to lwIP.
  */
@@ -138,6 +149,47 @@ static struct netif xNetIf;
 	/* Create the FreeRTOS defined basic command server.  This demonstrates use
 	of the lwIP sockets API. */
 	xTaskCreate( vBasicSocketsCommandInterpreterTask, ( int8_t * ) "CmdInt", configCOMMAND_INTERPRETER_STACK_SIZE, NULL, configCOMMAND_INTERPRETER_TASK_PRIORITY, NULL );
+
+	/* Create the bridge that streams CAN1 to and from a bench PC over UDP. */
+	xTaskCreate( prvCANUDPBridgeTask, ( int8_t * ) "CANtoUDP", configCAN_UDP_STACK_SIZE, NULL, configCAN_UDP_TASK_PRIORITY, NULL );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCANUDPBridgeTask( void *pvParameters )
+{
+CAN_UDP_Bridge_Config_t xConfig;
+CAN_UDP_Bridge_t *pxBridge = NULL;
+ip_addr_t xPeerAddress;
+
+	( void ) pvParameters;
+
+	memset( &xConfig, 0x00, sizeof( xConfig ) );
+	xConfig.xCAN = FreeRTOS_open( ( const int8_t * ) "/CAN1/", 0 );
+
+	if( xConfig.xCAN != NULL )
+	{
+		FreeRTOS_ioctl( xConfig.xCAN, ioctlSET_SPEED, ( void * ) configCAN_UDP_BIT_RATE );
+		FreeRTOS_ioctl( xConfig.xCAN, ioctlUSE_CAN_FRAME_QUEUE_RX, ( void * ) configCAN_UDP_RX_QUEUE_LENGTH );
+		FreeRTOS_ioctl( xConfig.xCAN, ioctlUSE_CAN_FRAME_QUEUE_TX, ( void * ) configCAN_UDP_TX_QUEUE_LENGTH );
+
+		IP4_ADDR( &xPeerAddress, configCAN_UDP_PEER_ADDR0, configCAN_UDP_PEER_ADDR1, configCAN_UDP_PEER_ADDR2, configCAN_UDP_PEER_ADDR3 );
+		xConfig.ulPeerAddress = xPeerAddress.addr;
+		xConfig.usPeerPort = configCAN_UDP_PEER_PORT;
+		xConfig.usLocalPort = configCAN_UDP_LOCAL_PORT;
+		xConfig.usMaxDatagramBytes = configCAN_UDP_MAX_DATAGRAM_BYTES;
+		xConfig.usFlushLatencyMs = configCAN_UDP_FLUSH_LATENCY_MS;
+
+		pxBridge = pxCANUDPBridgeCreate( &xConfig );
+	}
+
+	if( pxBridge != NULL )
+	{
+		xTaskCreate( vCANUDPBridgeUDPToCANTask, ( int8_t * ) "UDPtoCAN", configCAN_UDP_STACK_SIZE, pxBridge, configCAN_UDP_TASK_PRIORITY, NULL );
+		vCANUDPBridgeCANToUDPTask( pxBridge );
+	}
+
+	/* Will only get here if CAN1 or the bridge could not be set up. */
+	vTaskDelete( NULL );
 }
 /*-----------------------------------------------------------*/
 
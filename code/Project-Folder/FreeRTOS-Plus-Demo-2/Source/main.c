@@ -139,6 +139,7 @@
 /* Example includes. */
 #include "GPIO-output-and-software-timers.h"
 #include "SPI-interface-to-SD-card.h"
+#include "CAN-logger-to-SD-card.h"
 #include "FreeRTOS_CLI.h"
 
 /* Library includes. */
@@ -217,6 +218,10 @@ int main( void )
 	disk IO interface to an SD card. */
 	vStartSPIInterfaceToSDCardTask();
 
+	/* Start the tasks that log every frame received by CAN2 to a file on the
+	SD card, once the task started above has mounted it. */
+	vStartCANLoggerToSDCardTasks();
+
 	/* This call creates the TCP/IP thread. */
 	tcpip_init( lwIPAppsInit, NULL );
 
@@ -0,0 +1,1081 @@
+/*
+ * FreeRTOS+IO V1.0.1 (C) 2012 Real Time Engineers ltd.
+ *
+ * FreeRTOS+IO is an add-on component to FreeRTOS.  It is not, in itself, part
+ * of the FreeRTOS kernel.  FreeRTOS+IO is licensed separately from FreeRTOS,
+ * and uses a different license to FreeRTOS.  FreeRTOS+IO uses a dual license
+ * model, information on which is provided below:
+ *
+ * - Open source licensing -
+ * FreeRTOS+IO is a free download and may be used, modified and distributed
+ * without charge provided the user adheres to version two of the GNU General
+ * Public license (GPL) and does not remove the copyright notice or this text.
+ * The GPL V2 text is available on the gnu.org web site, and on the following
+ * URL: http://www.FreeRTOS.org/gpl-2.0.txt
+ *
+ * - Commercial licensing -
+ * Businesses and individuals who wish to incorporate FreeRTOS+IO into
+ * proprietary software for redistribution in any form must first obtain a low
+ * cost commercial license - and in-so-doing support the maintenance, support
+ * and further development of the FreeRTOS+IO product.  Commercial licenses can
+ * be obtained from http://shop.freertos.org and do not require any source files
+ * to be changed.
+ *
+ * FreeRTOS+IO is distributed in the hope that it will be useful.  You cannot
+ * use FreeRTOS+IO unless you agree that you use the software 'as is'.
+ * FreeRTOS+IO is provided WITHOUT ANY WARRANTY; without even the implied
+ * warranties of NON-INFRINGEMENT, MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. Real Time Engineers Ltd. disclaims all conditions and terms, be they
+ * implied, expressed, or statutory.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * http://www.FreeRTOS.org
+ * http://www.FreeRTOS.org/FreeRTOS-Plus
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "timers.h"
+
+/* FreeRTOS IO library includes. */
+#include "FreeRTOS_IO.h"
+#include "FreeRTOS_CAN_Layer.h"
+#include "FreeRTOS_CAN_ISOTP.h"
+
+#if ( ioconfigINCLUDE_CAN == 1 ) && ( ioconfigUSE_CAN_ISOTP == 1 )
+
+/* The number of data bytes a CAN frame can carry, and the number a frame
+with a given DLC carries - DLCs above 8 still mean 8 bytes. */
+#define isotpMAX_PAYLOAD_BYTES			( 8U )
+#define isotpDLC_TO_BYTES( ucDLC )		( ( ( ucDLC ) > isotpMAX_PAYLOAD_BYTES ) ? isotpMAX_PAYLOAD_BYTES : ( ucDLC ) )
+
+/* The protocol control information in the first byte of every ISO-TP frame.
+The frame type is held in the upper nibble, and the lower nibble holds the
+length of a single frame, the top of the length of a first frame, the sequence
+number of a consecutive frame, or the flow status of a flow control frame. */
+#define isotpSINGLE_FRAME				( 0x00U )
+#define isotpFIRST_FRAME				( 0x10U )
+#define isotpCONSECUTIVE_FRAME			( 0x20U )
+#define isotpFLOW_CONTROL_FRAME			( 0x30U )
+#define isotpFRAME_TYPE_MASK			( 0xF0U )
+#define isotpLOW_NIBBLE_MASK			( 0x0FU )
+
+#define isotpFLOW_CONTINUE				( 0x00U )
+#define isotpFLOW_WAIT					( 0x01U )
+#define isotpFLOW_OVERFLOW				( 0x02U )
+
+/* The longest message that fits in a single frame, and that can be described
+by the 12 bit length of a first frame.  Longer messages use a first frame whose
+12 bit length is 0, followed by a 32 bit length. */
+#define isotpMAX_SINGLE_FRAME_BYTES		( 7UL )
+#define isotpMAX_SHORT_LENGTH			( 0xFFFUL )
+
+/* The N_Bs and N_Cr timeouts used when the configuration leaves them at 0,
+which are the limits ISO 15765-2 gives. */
+#define isotpDEFAULT_N_BS_MS			( 1000U )
+#define isotpDEFAULT_N_CR_MS			( 1000U )
+
+/* The state of the message being sent by a session.  A single frame or first
+frame is waiting to be sent, a first frame or a block of consecutive frames has
+been sent and the flow control frame that lets the rest be sent is awaited,
+consecutive frames are being sent, the STmin gap requested by the receiver is
+being waited out before the next consecutive frame, or the last frame has been
+sent and its transmission is awaited. */
+#define isotpTX_IDLE					( 0U )
+#define isotpTX_FIRST					( 1U )
+#define isotpTX_WAIT_FLOW_CONTROL		( 2U )
+#define isotpTX_CONSECUTIVE				( 3U )
+#define isotpTX_STMIN					( 4U )
+#define isotpTX_LAST					( 5U )
+
+/* The state of the message being received by a session. */
+#define isotpRX_IDLE					( 0U )
+#define isotpRX_RECEIVING				( 1U )
+#define isotpRX_COMPLETE				( 2U )
+
+/* The state of one ISO-TP session, which also holds the handle returned by
+FreeRTOS_ISOTP_open().  The session is a layer on its CAN controller, so the
+CAN interrupt passes it every frame, and tells it each time a frame it sent has
+gone.  A message is sent straight from the buffer passed to FreeRTOS_write(),
+each frame being cut from it as the last has gone, so the buffer must not
+change until the write returns.  Only one frame of the message is waiting to be
+sent at a time, as without a Tx frame queue the controller does not send frames
+with the same ID in the order they were loaded.  A received message is
+reassembled by the CAN interrupt into the session's Rx buffer, where it stays
+until it is read. */
+typedef struct xCAN_ISOTP_SESSION
+{
+	Peripheral_Control_t xControl;			/* The handle returned by FreeRTOS_ISOTP_open(). */
+	Peripheral_Descriptor_t xCAN;			/* The controller that carries the session. */
+	CAN_Layer_t xLayer;						/* Added to xCAN by the first ioctlSET_ISOTP_CONFIG. */
+	CAN_ISOTP_Config_t xConfig;
+	CAN_ISOTP_Statistics_t xStatistics;
+
+	const uint8_t *pucTxMessage;			/* The buffer passed to FreeRTOS_write(). */
+	uint32_t ulTxLength;
+	uint32_t ulTxOffset;					/* The number of bytes of pucTxMessage already sent in frames. */
+	portBASE_TYPE xTxFrameSent;				/* pdTRUE until the last frame sent has gone, which is once no frame the layer sent is pending. */
+	volatile uint8_t ucTxState;
+	uint8_t ucTxSequenceNumber;
+	uint8_t ucTxBlockSize;					/* As set by the last flow control frame received. */
+	uint8_t ucTxFramesInBlock;
+	portTickType xTxSTminTicks;
+	portBASE_TYPE xTxResult;
+	xSemaphoreHandle xTxDoneSemaphore;		/* Given by the ISR when a message has been sent, or has failed. */
+	xTimerHandle xSTminTimer;				/* Sends the next consecutive frame once STmin has passed. */
+	xTimerHandle xNBsTimer;					/* Abandons the message if no flow control frame arrives within N_Bs. */
+	portTickType xNBsTicks;
+	portTickType xTxWaitStartTime;			/* When the wait for the current flow control frame started. */
+	portTickType xTxBlockTime;
+
+	uint8_t *pucRxBuffer;
+	uint32_t ulRxLength;
+	uint32_t ulRxOffset;
+	volatile uint8_t ucRxState;
+	uint8_t ucRxSequenceNumber;
+	uint8_t ucRxFramesInBlock;
+	xSemaphoreHandle xRxDoneSemaphore;		/* Given by the ISR when a message has been received. */
+	xTimerHandle xNCrTimer;					/* Abandons the message if no consecutive frame arrives within N_Cr. */
+	portTickType xNCrTicks;
+	portTickType xRxLastFrameTime;			/* When the last frame of the message being received arrived. */
+	portTickType xRxBlockTime;
+} CAN_ISOTP_Session_t;
+
+#define prvISOTP_SESSION( pxPeripheral ) ( ( CAN_ISOTP_Session_t * ) diGET_DEVICE_STATE( ( ( Peripheral_Control_t * const ) pxPeripheral ) ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The write, read and ioctl functions of the handle returned by
+ * FreeRTOS_ISOTP_open().
+ */
+static size_t prvISOTPWrite( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes );
+static size_t prvISOTPRead( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes );
+static portBASE_TYPE prvISOTPIoctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue );
+
+/*
+ * Set the IDs of a session, adding it to its controller as a layer the first
+ * time.
+ */
+static portBASE_TYPE prvConfigure( CAN_ISOTP_Session_t * const pxSession, const CAN_ISOTP_Config_t * const pxConfig );
+
+/*
+ * Remove a session from its controller, then free it and everything it
+ * created.
+ */
+static void prvRelease( CAN_ISOTP_Session_t * const pxSession );
+
+/*
+ * The Rx and Tx functions of the session's layer.  Called from the CAN
+ * interrupt.
+ */
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+static void prvLayerTxFromISR( CAN_Layer_t * const pxLayer, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Handle a frame received with the session's Rx ID.  Called from the CAN
+ * interrupt.
+ */
+static void prvReceiveFromISR( CAN_ISOTP_Session_t * const pxSession, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Send the next frame of the message being sent, if it may be sent now and
+ * the last frame has gone.  Does not use the FreeRTOS API, so is called from
+ * the CAN interrupt, or by a task from within a critical section.
+ */
+static void prvTransmit( CAN_ISOTP_Session_t * const pxSession );
+
+/*
+ * Send a flow control frame with the given flow status.  Called from the CAN
+ * interrupt.
+ */
+static portBASE_TYPE prvSendFlowControl( CAN_ISOTP_Session_t * const pxSession, const uint8_t ucFlowStatus );
+
+/*
+ * Fill in the ID, format, length and padding of a frame sent by a session.
+ * The first xBytes payload bytes must already have been written.
+ */
+static void prvCompleteFrame( const CAN_ISOTP_Session_t * const pxSession, CAN_MSG_Type * const pxFrame, uint8_t * const pucPayload, const size_t xBytes );
+
+/*
+ * The number of ticks that guarantees at least the gap encoded by an ISO-TP
+ * STmin value.
+ */
+static portTickType prvSTminToTicks( const uint8_t ucSTmin );
+
+/*
+ * The callback of the timer that paces consecutive frames.
+ */
+static void prvSTminCallback( xTimerHandle xTimer );
+
+/*
+ * The callbacks of the timers that abandon a message when the other end stops
+ * responding.  N_Bs limits the wait for each flow control frame, and N_Cr the
+ * wait for each consecutive frame.
+ */
+static void prvNBsCallback( xTimerHandle xTimer );
+static void prvNCrCallback( xTimerHandle xTimer );
+
+/*
+ * The number of ticks in an N_Bs or N_Cr timeout given in milliseconds, or in
+ * usDefaultMs if usTimeoutMs is 0.
+ */
+static portTickType prvTimeoutToTicks( const uint16_t usTimeoutMs, const uint16_t usDefaultMs );
+
+/*
+ * The number of ticks left until xTimeout ticks have passed since
+ * xStartTime, or 0 if they have.
+ */
+static portTickType prvTicksRemaining( const portTickType xStartTime, const portTickType xTimeout );
+
+/*-----------------------------------------------------------*/
+
+Peripheral_Descriptor_t FreeRTOS_ISOTP_open( Peripheral_Descriptor_t const xCAN )
+{
+const Peripheral_Control_t * const pxCANControl = ( const Peripheral_Control_t * ) xCAN;
+CAN_ISOTP_Session_t *pxSession;
+Peripheral_Control_t *pxReturn = NULL;
+
+	configASSERT( xCAN );
+
+	pxSession = pvPortMalloc( sizeof( CAN_ISOTP_Session_t ) );
+
+	if( pxSession != NULL )
+	{
+		memset( pxSession, 0x00, sizeof( CAN_ISOTP_Session_t ) );
+		pxSession->xCAN = xCAN;
+		pxSession->xTxBlockTime = portMAX_DELAY;
+		pxSession->xRxBlockTime = portMAX_DELAY;
+
+		pxSession->xLayer.pxRxFunction = prvLayerRxFromISR;
+		pxSession->xLayer.pxTxFunction = prvLayerTxFromISR;
+		pxSession->xLayer.pvContext = ( void * ) pxSession;
+
+		vSemaphoreCreateBinary( pxSession->xTxDoneSemaphore );
+		vSemaphoreCreateBinary( pxSession->xRxDoneSemaphore );
+		pxSession->xSTminTimer = xTimerCreate( ( const signed char * ) "ISOTP", 1, pdFALSE, ( void * ) pxSession, prvSTminCallback );
+		pxSession->xNBsTimer = xTimerCreate( ( const signed char * ) "N_Bs", 1, pdFALSE, ( void * ) pxSession, prvNBsCallback );
+		pxSession->xNCrTimer = xTimerCreate( ( const signed char * ) "N_Cr", 1, pdFALSE, ( void * ) pxSession, prvNCrCallback );
+		pxSession->xNBsTicks = prvTimeoutToTicks( 0U, isotpDEFAULT_N_BS_MS );
+		pxSession->xNCrTicks = prvTimeoutToTicks( 0U, isotpDEFAULT_N_CR_MS );
+
+		if( ( pxSession->xTxDoneSemaphore != NULL ) && ( pxSession->xRxDoneSemaphore != NULL ) && ( pxSession->xSTminTimer != NULL ) && ( pxSession->xNBsTimer != NULL ) && ( pxSession->xNCrTimer != NULL ) )
+		{
+			/* The semaphores are created in the given state. */
+			xSemaphoreTake( pxSession->xTxDoneSemaphore, 0U );
+			xSemaphoreTake( pxSession->xRxDoneSemaphore, 0U );
+
+			/* The handle is used with FreeRTOS_write(), FreeRTOS_read() and
+			FreeRTOS_ioctl() just as the handle of a peripheral is, and shares
+			the name and number of the controller. */
+			pxReturn = &( pxSession->xControl );
+			pxReturn->write = prvISOTPWrite;
+			pxReturn->read = prvISOTPRead;
+			pxReturn->ioctl = prvISOTPIoctl;
+			pxReturn->pxDevice = pxCANControl->pxDevice;
+			pxReturn->cPeripheralNumber = pxCANControl->cPeripheralNumber;
+			pxReturn->pvDeviceState = ( void * ) pxSession;
+		}
+		else
+		{
+			if( pxSession->xTxDoneSemaphore != NULL )
+			{
+				vQueueDelete( pxSession->xTxDoneSemaphore );
+			}
+
+			if( pxSession->xRxDoneSemaphore != NULL )
+			{
+				vQueueDelete( pxSession->xRxDoneSemaphore );
+			}
+
+			if( pxSession->xSTminTimer != NULL )
+			{
+				xTimerDelete( pxSession->xSTminTimer, 0U );
+			}
+
+			if( pxSession->xNBsTimer != NULL )
+			{
+				xTimerDelete( pxSession->xNBsTimer, 0U );
+			}
+
+			if( pxSession->xNCrTimer != NULL )
+			{
+				xTimerDelete( pxSession->xNCrTimer, 0U );
+			}
+
+			vPortFree( pxSession );
+		}
+	}
+
+	return ( Peripheral_Descriptor_t ) pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvISOTPWrite( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes )
+{
+CAN_ISOTP_Session_t * const pxSession = prvISOTP_SESSION( pxPeripheral );
+size_t xReturn = 0U;
+portBASE_TYPE xStarted = pdFALSE;
+
+	/* pvBuffer holds one whole message.  Its frames are cut from it as they
+	are sent, so it is not copied, and must not change until this function
+	returns. */
+	taskENTER_CRITICAL();
+	{
+		if( ( pxSession->xLayer.pvController != NULL ) && ( pxSession->ucTxState == isotpTX_IDLE ) && ( xBytes > 0U ) )
+		{
+			pxSession->pucTxMessage = ( const uint8_t * ) pvBuffer;
+			pxSession->ulTxLength = ( uint32_t ) xBytes;
+			pxSession->ulTxOffset = 0UL;
+			pxSession->ucTxState = isotpTX_FIRST;
+			pxSession->xTxResult = pdFAIL;
+			xSemaphoreTake( pxSession->xTxDoneSemaphore, 0U );
+
+			/* Send the single frame or first frame now if there is room for
+			it, otherwise the CAN interrupt sends it once a frame has gone. */
+			prvTransmit( pxSession );
+			xStarted = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xStarted != pdFALSE )
+	{
+		/* The rest of the message is sent by the CAN interrupt, paced by the
+		flow control frames returned by the receiver. */
+		if( ( xSemaphoreTake( pxSession->xTxDoneSemaphore, pxSession->xTxBlockTime ) == pdTRUE ) && ( pxSession->xTxResult == pdPASS ) )
+		{
+			xReturn = xBytes;
+		}
+		else
+		{
+			taskENTER_CRITICAL();
+			{
+				/* Abandon the message if it is still being sent.  A frame
+				still waiting to be sent is left to go, and the next message
+				waits for it. */
+				if( pxSession->ucTxState != isotpTX_IDLE )
+				{
+					pxSession->ucTxState = isotpTX_IDLE;
+					( pxSession->xStatistics.ulTxFailures )++;
+				}
+			}
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvISOTPRead( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes )
+{
+CAN_ISOTP_Session_t * const pxSession = prvISOTP_SESSION( pxPeripheral );
+size_t xReturn = 0U;
+
+	if( pxSession->ucRxState != isotpRX_COMPLETE )
+	{
+		xSemaphoreTake( pxSession->xRxDoneSemaphore, pxSession->xRxBlockTime );
+	}
+
+	if( pxSession->ucRxState == isotpRX_COMPLETE )
+	{
+		/* The ISR leaves a complete message alone until it has been read.  A
+		message longer than xBytes is truncated. */
+		xReturn = ( pxSession->ulRxLength < xBytes ) ? ( size_t ) pxSession->ulRxLength : xBytes;
+		memcpy( pvBuffer, pxSession->pucRxBuffer, xReturn );
+
+		/* Discard the semaphore given for this message, if it is still held,
+		before the ISR can give it for the next. */
+		xSemaphoreTake( pxSession->xRxDoneSemaphore, 0U );
+		pxSession->ucRxState = isotpRX_IDLE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvISOTPIoctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue )
+{
+CAN_ISOTP_Session_t * const pxSession = prvISOTP_SESSION( pxPeripheral );
+portBASE_TYPE xReturn = pdPASS;
+
+	if( ulRequest == ioctlSET_ISOTP_CONFIG )
+	{
+		/* The Rx buffer is allocated from the heap, and the layer is added
+		through the controller's own ioctl(), so this is done outside of the
+		critical section below. */
+		xReturn = prvConfigure( pxSession, ( const CAN_ISOTP_Config_t * ) pvValue );
+	}
+	else if( ulRequest == ioctlRELEASE_ISOTP_SESSION )
+	{
+		prvRelease( pxSession );
+	}
+	else
+	{
+		taskENTER_CRITICAL();
+		{
+			switch( ulRequest )
+			{
+				case ioctlSET_TX_TIMEOUT :
+
+					/* The longest a write can take, including the wait for
+					every flow control frame. */
+					pxSession->xTxBlockTime = ( portTickType ) pvValue;
+					break;
+
+				case ioctlSET_RX_TIMEOUT :
+
+					pxSession->xRxBlockTime = ( portTickType ) pvValue;
+					break;
+
+				case ioctlCLEAR_RX_BUFFER :
+
+					/* Discard a message that has been received but not read. */
+					if( pxSession->ucRxState == isotpRX_COMPLETE )
+					{
+						xSemaphoreTake( pxSession->xRxDoneSemaphore, 0U );
+						pxSession->ucRxState = isotpRX_IDLE;
+					}
+					break;
+
+				case ioctlGET_ISOTP_STATISTICS :
+
+					*( ( CAN_ISOTP_Statistics_t * ) pvValue ) = pxSession->xStatistics;
+					break;
+
+				default :
+
+					xReturn = pdFAIL;
+					break;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvConfigure( CAN_ISOTP_Session_t * const pxSession, const CAN_ISOTP_Config_t * const pxConfig )
+{
+portBASE_TYPE xReturn = pdFAIL, xReplaced = pdFALSE;
+uint8_t *pucNewRxBuffer, *pucOldRxBuffer = NULL;
+
+	configASSERT( pxConfig );
+
+	if( pxConfig->ulRxBufferSize > 0UL )
+	{
+		pucNewRxBuffer = pvPortMalloc( pxConfig->ulRxBufferSize );
+
+		if( pucNewRxBuffer != NULL )
+		{
+			taskENTER_CRITICAL();
+			{
+				/* A session cannot change its IDs while it is sending. */
+				if( pxSession->ucTxState == isotpTX_IDLE )
+				{
+					pxSession->xConfig = *pxConfig;
+					pxSession->xNBsTicks = prvTimeoutToTicks( pxConfig->usNBsTimeoutMs, isotpDEFAULT_N_BS_MS );
+					pxSession->xNCrTicks = prvTimeoutToTicks( pxConfig->usNCrTimeoutMs, isotpDEFAULT_N_CR_MS );
+					pucOldRxBuffer = pxSession->pucRxBuffer;
+					pxSession->pucRxBuffer = pucNewRxBuffer;
+					pxSession->ucRxState = isotpRX_IDLE;
+					xSemaphoreTake( pxSession->xRxDoneSemaphore, 0U );
+					xReplaced = pdTRUE;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xReplaced != pdFALSE )
+			{
+				/* The ISR cannot still be using the old buffer once the
+				critical section has been exited. */
+				if( pucOldRxBuffer != NULL )
+				{
+					vPortFree( pucOldRxBuffer );
+				}
+
+				if( pxSession->xLayer.pvController != NULL )
+				{
+					xReturn = pdPASS;
+				}
+				else
+				{
+					/* The session receives its frames, and paces the frames it
+					sends, from the CAN interrupt, through a layer on the
+					controller. */
+					xReturn = FreeRTOS_ioctl( pxSession->xCAN, ioctlADD_CAN_LAYER, &( pxSession->xLayer ) );
+				}
+			}
+			else
+			{
+				vPortFree( pucNewRxBuffer );
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRelease( CAN_ISOTP_Session_t * const pxSession )
+{
+	/* Once the layer has been removed the CAN interrupt no longer uses the
+	session, and the timer callback can no longer send from it. */
+	if( pxSession->xLayer.pvController != NULL )
+	{
+		FreeRTOS_ioctl( pxSession->xCAN, ioctlREMOVE_CAN_LAYER, &( pxSession->xLayer ) );
+	}
+
+	/* The timer callbacks are given the session, so the session is not freed
+	until the timer service task has stopped the timers. */
+	xTimerStop( pxSession->xSTminTimer, portMAX_DELAY );
+	xTimerStop( pxSession->xNBsTimer, portMAX_DELAY );
+	xTimerStop( pxSession->xNCrTimer, portMAX_DELAY );
+
+	while( ( xTimerIsTimerActive( pxSession->xSTminTimer ) != pdFALSE ) || ( xTimerIsTimerActive( pxSession->xNBsTimer ) != pdFALSE ) || ( xTimerIsTimerActive( pxSession->xNCrTimer ) != pdFALSE ) )
+	{
+		vTaskDelay( 1 );
+	}
+
+	xTimerDelete( pxSession->xSTminTimer, portMAX_DELAY );
+	xTimerDelete( pxSession->xNBsTimer, portMAX_DELAY );
+	xTimerDelete( pxSession->xNCrTimer, portMAX_DELAY );
+	vQueueDelete( pxSession->xTxDoneSemaphore );
+	vQueueDelete( pxSession->xRxDoneSemaphore );
+
+	if( pxSession->pucRxBuffer != NULL )
+	{
+		vPortFree( pxSession->pucRxBuffer );
+	}
+
+	vPortFree( pxSession );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_ISOTP_Session_t * const pxSession = ( CAN_ISOTP_Session_t * ) pxLayer->pvContext;
+portBASE_TYPE xTaken = pdFALSE;
+
+	if( ( pxFrame->id == pxSession->xConfig.ulRxID ) && ( pxFrame->format == pxSession->xConfig.ucFormat ) && ( pxFrame->type == DATA_FRAME ) )
+	{
+		prvReceiveFromISR( pxSession, pxFrame, pxHigherPriorityTaskWoken );
+		xTaken = pdTRUE;
+	}
+
+	return xTaken;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLayerTxFromISR( CAN_Layer_t * const pxLayer, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_ISOTP_Session_t * const pxSession = ( CAN_ISOTP_Session_t * ) pxLayer->pvContext;
+
+	/* The flow control frames the session sends are counted with its other
+	frames, so occasionally hold up the next frame of a message until they have
+	gone too. */
+	if( ( pxSession->xTxFrameSent != pdFALSE ) && ( pxLayer->usTxFramesPending == 0U ) )
+	{
+		/* The last frame sent has gone. */
+		pxSession->xTxFrameSent = pdFALSE;
+
+		if( pxSession->ucTxState == isotpTX_LAST )
+		{
+			pxSession->ucTxState = isotpTX_IDLE;
+			pxSession->xTxResult = pdPASS;
+			( pxSession->xStatistics.ulMessagesSent )++;
+			xSemaphoreGiveFromISR( pxSession->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+		}
+		else if( ( pxSession->ucTxState == isotpTX_CONSECUTIVE ) && ( pxSession->xTxSTminTicks > 0U ) )
+		{
+			/* STmin is measured from the end of one consecutive frame to the
+			start of the next. */
+			pxSession->ucTxState = isotpTX_STMIN;
+			xTimerChangePeriodFromISR( pxSession->xSTminTimer, pxSession->xTxSTminTicks, pxHigherPriorityTaskWoken );
+		}
+		else if( pxSession->ucTxState == isotpTX_WAIT_FLOW_CONTROL )
+		{
+			/* N_Bs is measured from the end of the first frame, or of the
+			last consecutive frame of a block, to the flow control frame. */
+			pxSession->xTxWaitStartTime = xTaskGetTickCountFromISR();
+			xTimerChangePeriodFromISR( pxSession->xNBsTimer, pxSession->xNBsTicks, pxHigherPriorityTaskWoken );
+		}
+	}
+
+	/* Also retries a frame there was no room for. */
+	prvTransmit( pxSession );
+}
+/*-----------------------------------------------------------*/
+
+static void prvReceiveFromISR( CAN_ISOTP_Session_t * const pxSession, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+uint32_t ulPayload[ 2 ];
+const uint8_t * const pucPayload = ( const uint8_t * ) ulPayload;
+const size_t xFrameBytes = isotpDLC_TO_BYTES( pxFrame->len );
+uint32_t ulLength, ulBytes;
+size_t xHeaderBytes;
+
+	ulPayload[ 0 ] = pxFrame->dataAWord;
+	ulPayload[ 1 ] = pxFrame->dataBWord;
+
+	/* Frames too short to hold what their protocol control information says
+	they hold are ignored. */
+	if( xFrameBytes > 0U )
+	{
+		switch( pucPayload[ 0 ] & isotpFRAME_TYPE_MASK )
+		{
+			case isotpSINGLE_FRAME :
+
+				ulLength = ( uint32_t ) ( pucPayload[ 0 ] & isotpLOW_NIBBLE_MASK );
+
+				if( ( ulLength > 0UL ) && ( ulLength < xFrameBytes ) )
+				{
+					if( ( pxSession->ucRxState == isotpRX_COMPLETE ) || ( ulLength > pxSession->xConfig.ulRxBufferSize ) )
+					{
+						( pxSession->xStatistics.ulRxOverruns )++;
+					}
+					else
+					{
+						/* A new message abandons one that was part way
+						through. */
+						if( pxSession->ucRxState == isotpRX_RECEIVING )
+						{
+							( pxSession->xStatistics.ulRxAborts )++;
+						}
+
+						memcpy( pxSession->pucRxBuffer, &( pucPayload[ 1 ] ), ulLength );
+						pxSession->ulRxLength = ulLength;
+						pxSession->ucRxState = isotpRX_COMPLETE;
+						( pxSession->xStatistics.ulMessagesReceived )++;
+						xSemaphoreGiveFromISR( pxSession->xRxDoneSemaphore, pxHigherPriorityTaskWoken );
+					}
+				}
+				break;
+
+
+			case isotpFIRST_FRAME :
+
+				/* A first frame always has 8 data bytes. */
+				if( xFrameBytes == isotpMAX_PAYLOAD_BYTES )
+				{
+					ulLength = ( ( uint32_t ) ( pucPayload[ 0 ] & isotpLOW_NIBBLE_MASK ) << 8UL ) | ( uint32_t ) pucPayload[ 1 ];
+					xHeaderBytes = 2U;
+
+					if( ulLength == 0UL )
+					{
+						ulLength = ( ( uint32_t ) pucPayload[ 2 ] << 24UL ) | ( ( uint32_t ) pucPayload[ 3 ] << 16UL ) | ( ( uint32_t ) pucPayload[ 4 ] << 8UL ) | ( uint32_t ) pucPayload[ 5 ];
+						xHeaderBytes = 6U;
+					}
+
+					if( ulLength > isotpMAX_SINGLE_FRAME_BYTES )
+					{
+						if( pxSession->ucRxState == isotpRX_RECEIVING )
+						{
+							( pxSession->xStatistics.ulRxAborts )++;
+							pxSession->ucRxState = isotpRX_IDLE;
+						}
+
+						if( ( pxSession->ucRxState == isotpRX_COMPLETE ) || ( ulLength > pxSession->xConfig.ulRxBufferSize ) )
+						{
+							/* Tell the sender not to send the rest. */
+							( pxSession->xStatistics.ulRxOverruns )++;
+							prvSendFlowControl( pxSession, isotpFLOW_OVERFLOW );
+						}
+						else
+						{
+							ulBytes = ( uint32_t ) ( isotpMAX_PAYLOAD_BYTES - xHeaderBytes );
+							memcpy( pxSession->pucRxBuffer, &( pucPayload[ xHeaderBytes ] ), ulBytes );
+							pxSession->ulRxLength = ulLength;
+							pxSession->ulRxOffset = ulBytes;
+							pxSession->ucRxSequenceNumber = 1U;
+							pxSession->ucRxFramesInBlock = 0U;
+
+							if( prvSendFlowControl( pxSession, isotpFLOW_CONTINUE ) == pdPASS )
+							{
+								/* N_Cr is measured from here to the first
+								consecutive frame, then between each. */
+								pxSession->ucRxState = isotpRX_RECEIVING;
+								pxSession->xRxLastFrameTime = xTaskGetTickCountFromISR();
+								xTimerChangePeriodFromISR( pxSession->xNCrTimer, pxSession->xNCrTicks, pxHigherPriorityTaskWoken );
+							}
+							else
+							{
+								( pxSession->xStatistics.ulRxAborts )++;
+							}
+						}
+					}
+				}
+				break;
+
+
+			case isotpCONSECUTIVE_FRAME :
+
+				if( pxSession->ucRxState == isotpRX_RECEIVING )
+				{
+					if( ( pucPayload[ 0 ] & isotpLOW_NIBBLE_MASK ) != pxSession->ucRxSequenceNumber )
+					{
+						/* A frame has been lost, so the message cannot be
+						completed. */
+						( pxSession->xStatistics.ulRxAborts )++;
+						pxSession->ucRxState = isotpRX_IDLE;
+					}
+					else
+					{
+						ulBytes = pxSession->ulRxLength - pxSession->ulRxOffset;
+						if( ulBytes > ( uint32_t ) ( xFrameBytes - 1U ) )
+						{
+							ulBytes = ( uint32_t ) ( xFrameBytes - 1U );
+						}
+
+						memcpy( &( pxSession->pucRxBuffer[ pxSession->ulRxOffset ] ), &( pucPayload[ 1 ] ), ulBytes );
+						pxSession->ulRxOffset += ulBytes;
+						pxSession->xRxLastFrameTime = xTaskGetTickCountFromISR();
+						pxSession->ucRxSequenceNumber = ( pxSession->ucRxSequenceNumber + 1U ) & isotpLOW_NIBBLE_MASK;
+
+						if( pxSession->ulRxOffset == pxSession->ulRxLength )
+						{
+							pxSession->ucRxState = isotpRX_COMPLETE;
+							( pxSession->xStatistics.ulMessagesReceived )++;
+							xSemaphoreGiveFromISR( pxSession->xRxDoneSemaphore, pxHigherPriorityTaskWoken );
+						}
+						else if( pxSession->xConfig.ucBlockSize > 0U )
+						{
+							( pxSession->ucRxFramesInBlock )++;
+
+							if( pxSession->ucRxFramesInBlock == pxSession->xConfig.ucBlockSize )
+							{
+								/* Let the sender start the next block. */
+								pxSession->ucRxFramesInBlock = 0U;
+
+								if( prvSendFlowControl( pxSession, isotpFLOW_CONTINUE ) != pdPASS )
+								{
+									( pxSession->xStatistics.ulRxAborts )++;
+									pxSession->ucRxState = isotpRX_IDLE;
+								}
+							}
+						}
+					}
+				}
+				break;
+
+
+			case isotpFLOW_CONTROL_FRAME :
+
+				if( ( pxSession->ucTxState == isotpTX_WAIT_FLOW_CONTROL ) && ( xFrameBytes >= 3U ) )
+				{
+					switch( pucPayload[ 0 ] & isotpLOW_NIBBLE_MASK )
+					{
+						case isotpFLOW_CONTINUE :
+
+							pxSession->ucTxBlockSize = pucPayload[ 1 ];
+							pxSession->ucTxFramesInBlock = 0U;
+							pxSession->xTxSTminTicks = prvSTminToTicks( pucPayload[ 2 ] );
+							pxSession->ucTxState = isotpTX_CONSECUTIVE;
+							prvTransmit( pxSession );
+							break;
+
+						case isotpFLOW_WAIT :
+
+							/* Keep waiting.  Each wait frame restarts N_Bs,
+							so only the Tx timeout limits how many the
+							receiver can send. */
+							pxSession->xTxWaitStartTime = xTaskGetTickCountFromISR();
+							break;
+
+						default :
+
+							/* The receiver cannot take the message. */
+							pxSession->ucTxState = isotpTX_IDLE;
+							( pxSession->xStatistics.ulTxFailures )++;
+							xSemaphoreGiveFromISR( pxSession->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+							break;
+					}
+				}
+				break;
+
+
+			default :
+
+				/* Not an ISO-TP frame. */
+				break;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTransmit( CAN_ISOTP_Session_t * const pxSession )
+{
+uint32_t ulPayload[ 2 ], ulBytes;
+uint8_t * const pucPayload = ( uint8_t * ) ulPayload;
+size_t xHeaderBytes;
+uint8_t ucNextState;
+CAN_MSG_Type xFrame;
+
+	if( ( pxSession->xTxFrameSent == pdFALSE ) && ( ( pxSession->ucTxState == isotpTX_FIRST ) || ( pxSession->ucTxState == isotpTX_CONSECUTIVE ) ) )
+	{
+		if( pxSession->ucTxState == isotpTX_FIRST )
+		{
+			if( pxSession->ulTxLength <= isotpMAX_SINGLE_FRAME_BYTES )
+			{
+				pucPayload[ 0 ] = isotpSINGLE_FRAME | ( uint8_t ) pxSession->ulTxLength;
+				xHeaderBytes = 1U;
+				ucNextState = isotpTX_LAST;
+			}
+			else
+			{
+				if( pxSession->ulTxLength <= isotpMAX_SHORT_LENGTH )
+				{
+					pucPayload[ 0 ] = isotpFIRST_FRAME | ( uint8_t ) ( pxSession->ulTxLength >> 8UL );
+					pucPayload[ 1 ] = ( uint8_t ) pxSession->ulTxLength;
+					xHeaderBytes = 2U;
+				}
+				else
+				{
+					pucPayload[ 0 ] = isotpFIRST_FRAME;
+					pucPayload[ 1 ] = 0U;
+					pucPayload[ 2 ] = ( uint8_t ) ( pxSession->ulTxLength >> 24UL );
+					pucPayload[ 3 ] = ( uint8_t ) ( pxSession->ulTxLength >> 16UL );
+					pucPayload[ 4 ] = ( uint8_t ) ( pxSession->ulTxLength >> 8UL );
+					pucPayload[ 5 ] = ( uint8_t ) pxSession->ulTxLength;
+					xHeaderBytes = 6U;
+				}
+
+				ucNextState = isotpTX_WAIT_FLOW_CONTROL;
+			}
+		}
+		else
+		{
+			pucPayload[ 0 ] = isotpCONSECUTIVE_FRAME | pxSession->ucTxSequenceNumber;
+			xHeaderBytes = 1U;
+			ucNextState = isotpTX_CONSECUTIVE;
+		}
+
+		/* Cut the next part of the message straight from the writer's
+		buffer. */
+		ulBytes = pxSession->ulTxLength - pxSession->ulTxOffset;
+		if( ulBytes > ( uint32_t ) ( isotpMAX_PAYLOAD_BYTES - xHeaderBytes ) )
+		{
+			ulBytes = ( uint32_t ) ( isotpMAX_PAYLOAD_BYTES - xHeaderBytes );
+		}
+
+		memcpy( &( pucPayload[ xHeaderBytes ] ), &( pxSession->pucTxMessage[ pxSession->ulTxOffset ] ), ulBytes );
+
+		if( ucNextState == isotpTX_CONSECUTIVE )
+		{
+			if( ( pxSession->ulTxOffset + ulBytes ) == pxSession->ulTxLength )
+			{
+				ucNextState = isotpTX_LAST;
+			}
+			else if( ( pxSession->ucTxBlockSize > 0U ) && ( ( pxSession->ucTxFramesInBlock + 1U ) == pxSession->ucTxBlockSize ) )
+			{
+				ucNextState = isotpTX_WAIT_FLOW_CONTROL;
+			}
+		}
+
+		prvCompleteFrame( pxSession, &xFrame, pucPayload, xHeaderBytes + ( size_t ) ulBytes );
+		xFrame.dataAWord = ulPayload[ 0 ];
+		xFrame.dataBWord = ulPayload[ 1 ];
+
+		/* The session only moves on once the frame has found room.  Otherwise
+		it is tried again the next time a frame of the controller has gone. */
+		if( pxSession->xLayer.pxSendFunction( &( pxSession->xLayer ), &xFrame ) == pdPASS )
+		{
+			pxSession->xTxFrameSent = pdTRUE;
+			pxSession->ulTxOffset += ulBytes;
+
+			if( pxSession->ucTxState == isotpTX_FIRST )
+			{
+				pxSession->ucTxSequenceNumber = 1U;
+			}
+			else
+			{
+				pxSession->ucTxSequenceNumber = ( pxSession->ucTxSequenceNumber + 1U ) & isotpLOW_NIBBLE_MASK;
+				( pxSession->ucTxFramesInBlock )++;
+			}
+
+			pxSession->ucTxState = ucNextState;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSendFlowControl( CAN_ISOTP_Session_t * const pxSession, const uint8_t ucFlowStatus )
+{
+uint32_t ulPayload[ 2 ];
+uint8_t * const pucPayload = ( uint8_t * ) ulPayload;
+CAN_MSG_Type xFrame;
+
+	pucPayload[ 0 ] = isotpFLOW_CONTROL_FRAME | ucFlowStatus;
+	pucPayload[ 1 ] = pxSession->xConfig.ucBlockSize;
+	pucPayload[ 2 ] = pxSession->xConfig.ucSTmin;
+	prvCompleteFrame( pxSession, &xFrame, pucPayload, 3U );
+	xFrame.dataAWord = ulPayload[ 0 ];
+	xFrame.dataBWord = ulPayload[ 1 ];
+
+	return pxSession->xLayer.pxSendFunction( &( pxSession->xLayer ), &xFrame );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCompleteFrame( const CAN_ISOTP_Session_t * const pxSession, CAN_MSG_Type * const pxFrame, uint8_t * const pucPayload, const size_t xBytes )
+{
+	memset( &( pucPayload[ xBytes ] ), pxSession->xConfig.ucPaddingByte, isotpMAX_PAYLOAD_BYTES - xBytes );
+
+	pxFrame->id = pxSession->xConfig.ulTxID;
+	pxFrame->format = pxSession->xConfig.ucFormat;
+	pxFrame->type = DATA_FRAME;
+	pxFrame->len = ( pxSession->xConfig.ucPadFrames != pdFALSE ) ? ( uint8_t ) isotpMAX_PAYLOAD_BYTES : ( uint8_t ) xBytes;
+	pxFrame->timestamp = 0UL;
+}
+/*-----------------------------------------------------------*/
+
+static portTickType prvSTminToTicks( const uint8_t ucSTmin )
+{
+uint32_t ulMicroseconds;
+portTickType xTicks = 0U;
+
+	if( ucSTmin <= 0x7FU )
+	{
+		ulMicroseconds = ( uint32_t ) ucSTmin * 1000UL;
+	}
+	else if( ( ucSTmin >= 0xF1U ) && ( ucSTmin <= 0xF9U ) )
+	{
+		ulMicroseconds = ( uint32_t ) ( ucSTmin - 0xF0U ) * 100UL;
+	}
+	else
+	{
+		/* Reserved values are treated as the longest STmin. */
+		ulMicroseconds = 0x7FUL * 1000UL;
+	}
+
+	if( ulMicroseconds > 0UL )
+	{
+		/* A timer expires anywhere within the tick it is due in, so one tick
+		is added to the rounded up period. */
+		xTicks = ( portTickType ) ( ( ulMicroseconds + ( ( uint32_t ) portTICK_RATE_MS * 1000UL ) - 1UL ) / ( ( uint32_t ) portTICK_RATE_MS * 1000UL ) ) + 1U;
+	}
+
+	return xTicks;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSTminCallback( xTimerHandle xTimer )
+{
+CAN_ISOTP_Session_t * const pxSession = ( CAN_ISOTP_Session_t * ) pvTimerGetTimerID( xTimer );
+
+	/* This runs in the timer service task, not an interrupt, so the frame is
+	sent from within a critical section, and prvTransmit() uses no FreeRTOS API
+	function at all. */
+	taskENTER_CRITICAL();
+	{
+		/* The message may have been abandoned while the timer was running. */
+		if( pxSession->ucTxState == isotpTX_STMIN )
+		{
+			pxSession->ucTxState = isotpTX_CONSECUTIVE;
+			prvTransmit( pxSession );
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvNBsCallback( xTimerHandle xTimer )
+{
+CAN_ISOTP_Session_t * const pxSession = ( CAN_ISOTP_Session_t * ) pvTimerGetTimerID( xTimer );
+portTickType xRemaining = 0U;
+portBASE_TYPE xTimedOut = pdFALSE;
+
+	taskENTER_CRITICAL();
+	{
+		/* The flow control frame may have arrived, or the message been
+		abandoned, while the timer was running.  The wait only starts once the
+		last frame sent has gone. */
+		if( ( pxSession->ucTxState == isotpTX_WAIT_FLOW_CONTROL ) && ( pxSession->xTxFrameSent == pdFALSE ) )
+		{
+			xRemaining = prvTicksRemaining( pxSession->xTxWaitStartTime, pxSession->xNBsTicks );
+
+			if( xRemaining == 0U )
+			{
+				pxSession->ucTxState = isotpTX_IDLE;
+				( pxSession->xStatistics.ulTxFailures )++;
+				xTimedOut = pdTRUE;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xTimedOut != pdFALSE )
+	{
+		/* xTxResult was left at pdFAIL, so the write fails. */
+		xSemaphoreGive( pxSession->xTxDoneSemaphore );
+	}
+	else if( xRemaining > 0U )
+	{
+		/* A wait frame restarted N_Bs. */
+		xTimerChangePeriod( xTimer, xRemaining, 0U );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvNCrCallback( xTimerHandle xTimer )
+{
+CAN_ISOTP_Session_t * const pxSession = ( CAN_ISOTP_Session_t * ) pvTimerGetTimerID( xTimer );
+portTickType xRemaining = 0U;
+
+	taskENTER_CRITICAL();
+	{
+		/* The timer is only started by the first frame, and each consecutive
+		frame just notes when it arrived, so the time left is worked out
+		here. */
+		if( pxSession->ucRxState == isotpRX_RECEIVING )
+		{
+			xRemaining = prvTicksRemaining( pxSession->xRxLastFrameTime, pxSession->xNCrTicks );
+
+			if( xRemaining == 0U )
+			{
+				pxSession->ucRxState = isotpRX_IDLE;
+				( pxSession->xStatistics.ulRxAborts )++;
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xRemaining > 0U )
+	{
+		xTimerChangePeriod( xTimer, xRemaining, 0U );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portTickType prvTimeoutToTicks( const uint16_t usTimeoutMs, const uint16_t usDefaultMs )
+{
+portTickType xTicks;
+
+	xTicks = ( portTickType ) ( ( usTimeoutMs > 0U ) ? usTimeoutMs : usDefaultMs ) / portTICK_RATE_MS;
+
+	if( xTicks == 0U )
+	{
+		xTicks = 1U;
+	}
+
+	return xTicks;
+}
+/*-----------------------------------------------------------*/
+
+static portTickType prvTicksRemaining( const portTickType xStartTime, const portTickType xTimeout )
+{
+const portTickType xElapsed = xTaskGetTickCount() - xStartTime;
+
+	return ( xElapsed < xTimeout ) ? ( xTimeout - xElapsed ) : 0U;
+}
+
+#endif /* ioconfigUSE_CAN_ISOTP */
+
@@ -0,0 +1,1516 @@
+/*
+ * FreeRTOS+IO V1.0.1 (C) 2012 Real Time Engineers ltd.
+ *
+ * FreeRTOS+IO is an add-on component to FreeRTOS.  It is not, in itself, part
+ * of the FreeRTOS kernel.  FreeRTOS+IO is licensed separately from FreeRTOS,
+ * and uses a different license to FreeRTOS.  FreeRTOS+IO uses a dual license
+ * model, information on which is provided below:
+ *
+ * - Open source licensing -
+ * FreeRTOS+IO is a free download and may be used, modified and distributed
+ * without charge provided the user adheres to version two of the GNU General
+ * Public license (GPL) and does not remove the copyright notice or this text.
+ * The GPL V2 text is available on the gnu.org web site, and on the following
+ * URL: http://www.FreeRTOS.org/gpl-2.0.txt
+ *
+ * - Commercial licensing -
+ * Businesses and individuals who wish to incorporate FreeRTOS+IO into
+ * proprietary software for redistribution in any form must first obtain a low
+ * cost commercial license - and in-so-doing support the maintenance, support
+ * and further development of the FreeRTOS+IO product.  Commercial licenses can
+ * be obtained from http://shop.freertos.org and do not require any source files
+ * to be changed.
+ *
+ * FreeRTOS+IO is distributed in the hope that it will be useful.  You cannot
+ * use FreeRTOS+IO unless you agree that you use the software 'as is'.
+ * FreeRTOS+IO is provided WITHOUT ANY WARRANTY; without even the implied
+ * warranties of NON-INFRINGEMENT, MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. Real Time Engineers Ltd. disclaims all conditions and terms, be they
+ * implied, expressed, or statutory.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * http://www.FreeRTOS.org
+ * http://www.FreeRTOS.org/FreeRTOS-Plus
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "timers.h"
+
+/* FreeRTOS IO library includes. */
+#include "FreeRTOS_IO.h"
+#include "FreeRTOS_CAN_Layer.h"
+#include "FreeRTOS_CAN_J1939.h"
+
+#if ( ioconfigINCLUDE_CAN == 1 ) && ( ioconfigUSE_CAN_J1939 == 1 )
+
+/* The number of data bytes a CAN frame can carry, and the number a frame
+with a given DLC carries - DLCs above 8 still mean 8 bytes. */
+#define j1939MAX_PAYLOAD_BYTES			( 8U )
+#define j1939DLC_TO_BYTES( ucDLC )		( ( ( ucDLC ) > j1939MAX_PAYLOAD_BYTES ) ? j1939MAX_PAYLOAD_BYTES : ( ucDLC ) )
+
+/* The PGNs of the J1939 messages handled by the nodes themselves. */
+#define j1939PGN_REQUEST				( 0x0EA00UL )
+#define j1939PGN_ADDRESS_CLAIMED		( 0x0EE00UL )
+#define j1939PGN_TP_CM					( 0x0EC00UL )
+#define j1939PGN_TP_DT					( 0x0EB00UL )
+
+/* The fields of a 29 bit J1939 ID.  A PGN whose PF is below 240 (PDU1) is sent
+to the address held in PS, and its own PS is 0.  Every other PGN (PDU2) is
+broadcast, and uses PS as part of the PGN. */
+#define j1939PGN_MASK					( 0x3FFFFUL )
+#define j1939PDU1_PGN_MASK				( 0x3FF00UL )
+#define j1939PDU2_MIN_PF				( 240U )
+#define j1939PF( ulPGN )				( ( uint8_t ) ( ( ulPGN ) >> 8UL ) )
+#define j1939ID_PRIORITY( ulID )		( ( uint8_t ) ( ( ( ulID ) >> 26UL ) & 0x07UL ) )
+#define j1939ID_PGN( ulID )				( ( ( ulID ) >> 8UL ) & j1939PGN_MASK )
+#define j1939ID_PS( ulID )				( ( uint8_t ) ( ( ulID ) >> 8UL ) )
+#define j1939ID_SA( ulID )				( ( uint8_t ) ( ulID ) )
+
+/* The priorities of the frames generated by the nodes themselves. */
+#define j1939CLAIM_PRIORITY				( 6U )
+#define j1939TP_PRIORITY				( 7U )
+
+/* The control byte of each kind of transport protocol connection management
+frame, and the reasons given for aborting a connection. */
+#define j1939TP_RTS						( 16U )
+#define j1939TP_CTS						( 17U )
+#define j1939TP_END_OF_MSG_ACK			( 19U )
+#define j1939TP_BAM						( 32U )
+#define j1939TP_ABORT					( 255U )
+
+#define j1939ABORT_BUSY					( 1U )
+#define j1939ABORT_RESOURCES			( 2U )
+#define j1939ABORT_TIMEOUT				( 3U )
+#define j1939ABORT_BAD_SEQUENCE			( 7U )
+
+/* Each transport protocol data frame carries a sequence number and 7 bytes of
+the message. */
+#define j1939PACKET_BYTES				( 7U )
+
+/* The gap left between the frames of a BAM, the time a receiver waits for the
+next data frame (T1) and for the first data frame after a CTS (T2), and the
+time an address claim must go unchallenged before the address can be used. */
+#define j1939BAM_PACKET_GAP				( ( portTickType ) 50 / portTICK_RATE_MS )
+#define j1939T1							( ( portTickType ) 750 / portTICK_RATE_MS )
+#define j1939T2							( ( portTickType ) 1250 / portTICK_RATE_MS )
+#define j1939ADDRESS_CLAIM_DELAY		( ( portTickType ) 250 / portTICK_RATE_MS )
+
+/* The addresses an arbitrary address capable node picks from once it has lost
+its preferred address, and the bit of the NAME that makes a node arbitrary
+address capable. */
+#define j1939FIRST_ARBITRARY_ADDRESS	( 128U )
+#define j1939LAST_ARBITRARY_ADDRESS		( 247U )
+#define j1939ARBITRARY_ADDRESS_BIT		( 0x8000000000000000ULL )
+
+/* The progress of a node's address claim. */
+#define j1939CLAIMING					( 0U )
+#define j1939CLAIMED					( 1U )
+#define j1939CANNOT_CLAIM				( 2U )
+
+/* The state of the message being sent by a J1939 node.  A single frame, BAM
+or RTS is waiting to be sent, the gap between the frames of a BAM is being
+waited out, a BAM data frame is waiting to be sent, a CTS is awaited, data
+frames are being sent in response to a CTS, the end of message acknowledgement
+is awaited, or the last frame has been sent and its transmission is
+awaited. */
+#define j1939TX_IDLE					( 0U )
+#define j1939TX_SINGLE					( 1U )
+#define j1939TX_BAM						( 2U )
+#define j1939TX_BAM_GAP					( 3U )
+#define j1939TX_BAM_DATA				( 4U )
+#define j1939TX_RTS						( 5U )
+#define j1939TX_WAIT_CTS				( 6U )
+#define j1939TX_CMDT_DATA				( 7U )
+#define j1939TX_WAIT_ACK				( 8U )
+#define j1939TX_LAST					( 9U )
+
+/* The kind of transport protocol message being received by a J1939 node. */
+#define j1939RX_IDLE					( 0U )
+#define j1939RX_BAM						( 1U )
+#define j1939RX_CMDT					( 2U )
+
+struct xCAN_J1939_NODE;
+
+/* The nodes created on one CAN controller.  Every node needs to see every
+address claim and every broadcast, while a frame a node handles must not also
+reach the controller's own reader, so the nodes on a controller share a single
+layer, which offers each frame to all of them.  A bus is created by the first
+FreeRTOS_J1939_open() on its controller, and freed when its last node is
+released. */
+typedef struct xCAN_J1939_BUS
+{
+	struct xCAN_J1939_BUS *pxNext;			/* The next bus in the list of buses. */
+	Peripheral_Descriptor_t xCAN;			/* The controller the bus is a layer on. */
+	CAN_Layer_t xLayer;
+	struct xCAN_J1939_NODE *pxNodes;		/* The nodes on the controller, which the CAN interrupt walks. */
+	unsigned portBASE_TYPE uxNodes;
+} CAN_J1939_Bus_t;
+
+/* The state of one J1939 node, which also holds the handle returned by
+FreeRTOS_J1939_open().  The handlers are found through an open addressed hash
+table of PGNs with at least twice as many slots as handlers, so each message
+costs a few probes however many PGNs are handled.  A message is sent straight
+from the caller's buffer, one frame at a time, and a transport protocol message
+is reassembled in the node's Rx buffer.  A node sends and receives one
+transport protocol message at a time. */
+typedef struct xCAN_J1939_NODE
+{
+	Peripheral_Control_t xControl;			/* The handle returned by FreeRTOS_J1939_open(). */
+	struct xCAN_J1939_NODE *pxNext;			/* The next node on the same bus. */
+	CAN_J1939_Bus_t *pxBus;
+	J1939_Config_t xConfig;
+	J1939_Statistics_t xStatistics;
+
+	J1939_PGN_Handler_t *pxHandlers;		/* The hash table of handlers, or NULL until the node is configured.  A slot with a NULL pxHandler is empty. */
+	uint16_t usHandlerSlotMask;				/* The number of slots in pxHandlers, less one. */
+	uint16_t usHandlers;					/* The number of slots in use. */
+
+	volatile uint8_t ucAddress;				/* The address claimed, or being claimed, or diJ1939_NULL_ADDRESS. */
+	volatile uint8_t ucClaimState;
+	uint8_t ucAddressesTried;				/* The arbitrary addresses tried since the preferred address was lost. */
+	xTimerHandle xClaimTimer;				/* Completes the claim once it has gone unchallenged. */
+
+	J1939_Message_t xTxMessage;				/* The message being sent.  pucData points into the buffer passed to FreeRTOS_write(). */
+	uint8_t ucTxPackets;					/* The number of data frames that carry the message. */
+	uint8_t ucTxNextPacket;					/* The sequence number of the next data frame to send. */
+	uint8_t ucTxLastPacket;					/* The sequence number of the last data frame the receiver's CTS allows. */
+	portBASE_TYPE xTxFrameSent;				/* pdTRUE until the last frame of the message sent has gone, which is once no frame of the bus is pending. */
+	volatile uint8_t ucTxState;
+	portBASE_TYPE xTxResult;
+	xSemaphoreHandle xTxDoneSemaphore;		/* Given by the ISR when a message has been sent, or has failed. */
+	xTimerHandle xBAMTimer;					/* Sends the next data frame of a BAM once the gap has passed. */
+	portTickType xTxBlockTime;
+
+	uint8_t *pucRxBuffer;
+	J1939_Message_t xRxMessage;				/* The PGN, addresses and length of the message being received. */
+	uint8_t ucRxPackets;
+	uint8_t ucRxNextPacket;
+	uint8_t ucRxLastPacket;					/* The sequence number of the last data frame allowed by the CTS last sent. */
+	uint8_t ucRxSenderPacketsPerCTS;		/* The most packets the sender of an RTS will send for each CTS. */
+	uint8_t ucRxState;
+	xTimerHandle xRxTimer;					/* Abandons a message whose next frame does not arrive in time. */
+} CAN_J1939_Node_t;
+
+#define prvJ1939_NODE( pxPeripheral ) ( ( CAN_J1939_Node_t * ) diGET_DEVICE_STATE( ( ( Peripheral_Control_t * const ) pxPeripheral ) ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The write, read and ioctl functions of the handle returned by
+ * FreeRTOS_J1939_open().
+ */
+static size_t prvJ1939Write( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes );
+static size_t prvJ1939Read( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes );
+static portBASE_TYPE prvJ1939Ioctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue );
+
+/*
+ * Add a node to the bus of its controller, creating the bus, and adding its
+ * layer to the controller, if the node is the first on the controller.
+ */
+static portBASE_TYPE prvJoinBus( CAN_J1939_Node_t * const pxNode, Peripheral_Descriptor_t const xCAN );
+
+/*
+ * Take a node off its bus, freeing the bus, and removing its layer from the
+ * controller, if the node was the last on the controller.
+ */
+static void prvLeaveBus( CAN_J1939_Node_t * const pxNode );
+
+/*
+ * The bus of the controller xCAN, or NULL if it has none.  Called from within
+ * a critical section.
+ */
+static CAN_J1939_Bus_t *prvFindBus( Peripheral_Descriptor_t const xCAN );
+
+/*
+ * Give a node its handler table and Rx buffer, and start it claiming its
+ * preferred address.
+ */
+static portBASE_TYPE prvConfigure( CAN_J1939_Node_t * const pxNode, const J1939_Config_t * const pxConfig );
+
+/*
+ * Take a node off its bus, then free it and everything it created.
+ */
+static void prvRelease( CAN_J1939_Node_t * const pxNode );
+
+/*
+ * The Rx and Tx functions of the layer of a bus.  Called from the CAN
+ * interrupt.
+ */
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+static void prvLayerTxFromISR( CAN_Layer_t * const pxLayer, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Handle the transport protocol connection management and data frames
+ * received by a node.  pxMessage describes the frame.  Each returns pdTRUE if
+ * the frame belonged to a connection the node is, or is now, part of.  Called
+ * from the CAN interrupt.
+ */
+static portBASE_TYPE prvConnectionFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+static portBASE_TYPE prvDataFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Handle an address claim made by another node.  Called from the CAN
+ * interrupt.
+ */
+static void prvAddressClaimedFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Send the next frame of the message being sent by a node, if it may be sent
+ * now and the last frame has gone.  Does not use the FreeRTOS API, so is
+ * called from the CAN interrupt, or by a task from within a critical section.
+ */
+static void prvTransmit( CAN_J1939_Node_t * const pxNode );
+
+/*
+ * Send an 8 byte frame generated by a node itself - an address claim, or a
+ * transport protocol connection management frame.  Does not use the FreeRTOS
+ * API.
+ */
+static portBASE_TYPE prvSend( const CAN_J1939_Node_t * const pxNode, const uint32_t ulPGN, const uint8_t ucPriority, const uint8_t ucDestinationAddress, const uint8_t * const pucData );
+
+/*
+ * Send the node's address claim, or a transport protocol connection
+ * management frame that describes the message ulPGN.  Do not use the FreeRTOS
+ * API.
+ */
+static portBASE_TYPE prvSendAddressClaim( const CAN_J1939_Node_t * const pxNode );
+static portBASE_TYPE prvSendConnection( const CAN_J1939_Node_t * const pxNode, const uint8_t ucDestinationAddress, const uint8_t ucControl, const uint8_t ucByte1, const uint8_t ucByte2, const uint8_t ucByte3, const uint8_t ucByte4, const uint32_t ulPGN );
+
+/*
+ * Abandon the message being received by a node.  Does not use the FreeRTOS
+ * API.
+ */
+static void prvAbortRx( CAN_J1939_Node_t * const pxNode, const uint8_t ucReason );
+
+/*
+ * Send the CTS that lets the sender of the message being received send its
+ * next block of data frames.  Called from the CAN interrupt.
+ */
+static portBASE_TYPE prvSendCTSFromISR( CAN_J1939_Node_t * const pxNode, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Return the handler slot for ulPGN - the slot that holds its handler if it
+ * has one, otherwise the empty slot in which its handler would be added.
+ */
+static J1939_PGN_Handler_t *prvFindHandlerSlot( const CAN_J1939_Node_t * const pxNode, const uint32_t ulPGN );
+
+/*
+ * The 29 bit ID of a frame sent by a node.
+ */
+static uint32_t prvID( const uint8_t ucPriority, const uint32_t ulPGN, const uint8_t ucDestinationAddress, const uint8_t ucSourceAddress );
+
+/*
+ * Stop and delete one of a node's timers, waiting until the timer service
+ * task has processed both, so the callback can no longer run.
+ */
+static void prvDeleteTimer( xTimerHandle xTimer );
+
+/*
+ * The callbacks of the timers that complete an address claim, pace the frames
+ * of a BAM, and time out a message that is being received.  They run in the
+ * timer service task, so only use the FreeRTOS API functions a task may use.
+ */
+static void prvClaimCallback( xTimerHandle xTimer );
+static void prvBAMCallback( xTimerHandle xTimer );
+static void prvRxTimeoutCallback( xTimerHandle xTimer );
+
+/*-----------------------------------------------------------*/
+
+/* The buses that have at least one node.  Only changed by tasks, from within
+a critical section. */
+static CAN_J1939_Bus_t *pxBuses = NULL;
+
+/*-----------------------------------------------------------*/
+
+Peripheral_Descriptor_t FreeRTOS_J1939_open( Peripheral_Descriptor_t const xCAN )
+{
+const Peripheral_Control_t * const pxCANControl = ( const Peripheral_Control_t * ) xCAN;
+CAN_J1939_Node_t *pxNode;
+Peripheral_Control_t *pxReturn = NULL;
+
+	configASSERT( xCAN );
+
+	pxNode = pvPortMalloc( sizeof( CAN_J1939_Node_t ) );
+
+	if( pxNode != NULL )
+	{
+		memset( pxNode, 0x00, sizeof( CAN_J1939_Node_t ) );
+		pxNode->ucAddress = diJ1939_NULL_ADDRESS;
+		pxNode->ucClaimState = j1939CANNOT_CLAIM;
+		pxNode->xTxBlockTime = portMAX_DELAY;
+
+		vSemaphoreCreateBinary( pxNode->xTxDoneSemaphore );
+		pxNode->xClaimTimer = xTimerCreate( ( const signed char * ) "J1939", j1939ADDRESS_CLAIM_DELAY, pdFALSE, ( void * ) pxNode, prvClaimCallback );
+		pxNode->xBAMTimer = xTimerCreate( ( const signed char * ) "J1939", j1939BAM_PACKET_GAP, pdFALSE, ( void * ) pxNode, prvBAMCallback );
+		pxNode->xRxTimer = xTimerCreate( ( const signed char * ) "J1939", j1939T1, pdFALSE, ( void * ) pxNode, prvRxTimeoutCallback );
+
+		if( ( pxNode->xTxDoneSemaphore != NULL ) && ( pxNode->xClaimTimer != NULL ) && ( pxNode->xBAMTimer != NULL ) && ( pxNode->xRxTimer != NULL ) && ( prvJoinBus( pxNode, xCAN ) == pdPASS ) )
+		{
+			/* The semaphore is created in the given state. */
+			xSemaphoreTake( pxNode->xTxDoneSemaphore, 0U );
+
+			/* The handle is used with FreeRTOS_write() and FreeRTOS_ioctl()
+			just as the handle of a peripheral is, and shares the name and
+			number of the controller. */
+			pxReturn = &( pxNode->xControl );
+			pxReturn->write = prvJ1939Write;
+			pxReturn->read = prvJ1939Read;
+			pxReturn->ioctl = prvJ1939Ioctl;
+			pxReturn->pxDevice = pxCANControl->pxDevice;
+			pxReturn->cPeripheralNumber = pxCANControl->cPeripheralNumber;
+			pxReturn->pvDeviceState = ( void * ) pxNode;
+		}
+		else
+		{
+			if( pxNode->xTxDoneSemaphore != NULL )
+			{
+				vQueueDelete( pxNode->xTxDoneSemaphore );
+			}
+
+			if( pxNode->xClaimTimer != NULL )
+			{
+				xTimerDelete( pxNode->xClaimTimer, 0U );
+			}
+
+			if( pxNode->xBAMTimer != NULL )
+			{
+				xTimerDelete( pxNode->xBAMTimer, 0U );
+			}
+
+			if( pxNode->xRxTimer != NULL )
+			{
+				xTimerDelete( pxNode->xRxTimer, 0U );
+			}
+
+			vPortFree( pxNode );
+		}
+	}
+
+	return ( Peripheral_Descriptor_t ) pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvJ1939Write( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes )
+{
+CAN_J1939_Node_t * const pxNode = prvJ1939_NODE( pxPeripheral );
+const J1939_Message_t * const pxMessage = ( const J1939_Message_t * ) pvBuffer;
+size_t xReturn = 0U;
+portBASE_TYPE xStarted = pdFALSE;
+
+	/* pvBuffer points to a single J1939_Message_t.  The data it points to is
+	sent from where it is, so must not change until this function returns. */
+	if( ( xBytes == sizeof( J1939_Message_t ) ) && ( pxMessage->usLength <= diJ1939_MAX_MESSAGE_BYTES ) )
+	{
+		taskENTER_CRITICAL();
+		{
+			if( ( pxNode->ucClaimState == j1939CLAIMED ) && ( pxNode->ucTxState == j1939TX_IDLE ) )
+			{
+				pxNode->xTxMessage = *pxMessage;
+				pxNode->xTxMessage.ulPGN &= j1939PGN_MASK;
+				pxNode->xTxMessage.ucSourceAddress = pxNode->ucAddress;
+
+				if( j1939PF( pxNode->xTxMessage.ulPGN ) >= j1939PDU2_MIN_PF )
+				{
+					pxNode->xTxMessage.ucDestinationAddress = diJ1939_GLOBAL_ADDRESS;
+				}
+
+				if( pxMessage->usLength <= j1939MAX_PAYLOAD_BYTES )
+				{
+					pxNode->ucTxState = j1939TX_SINGLE;
+				}
+				else
+				{
+					pxNode->ucTxPackets = ( uint8_t ) ( ( pxMessage->usLength + ( j1939PACKET_BYTES - 1U ) ) / j1939PACKET_BYTES );
+					pxNode->ucTxNextPacket = 1U;
+					pxNode->ucTxState = ( pxNode->xTxMessage.ucDestinationAddress == diJ1939_GLOBAL_ADDRESS ) ? j1939TX_BAM : j1939TX_RTS;
+				}
+
+				pxNode->xTxResult = pdFAIL;
+				xSemaphoreTake( pxNode->xTxDoneSemaphore, 0U );
+
+				/* Send the first frame now if there is room for it, otherwise
+				the CAN interrupt sends it once a frame has gone. */
+				prvTransmit( pxNode );
+				xStarted = pdTRUE;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	if( xStarted != pdFALSE )
+	{
+		if( ( xSemaphoreTake( pxNode->xTxDoneSemaphore, pxNode->xTxBlockTime ) == pdTRUE ) && ( pxNode->xTxResult == pdPASS ) )
+		{
+			xReturn = xBytes;
+		}
+		else
+		{
+			taskENTER_CRITICAL();
+			{
+				if( pxNode->ucTxState != j1939TX_IDLE )
+				{
+					/* Tell the receiver of a connection mode transfer not to
+					wait for the rest of the message. */
+					if( ( pxNode->ucTxState >= j1939TX_WAIT_CTS ) && ( pxNode->ucTxState <= j1939TX_WAIT_ACK ) )
+					{
+						prvSendConnection( pxNode, pxNode->xTxMessage.ucDestinationAddress, j1939TP_ABORT, j1939ABORT_TIMEOUT, 0xFFU, 0xFFU, 0xFFU, pxNode->xTxMessage.ulPGN );
+					}
+
+					pxNode->ucTxState = j1939TX_IDLE;
+					( pxNode->xStatistics.ulTxFailures )++;
+				}
+			}
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvJ1939Read( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes )
+{
+	/* Messages are passed to the handlers of their PGNs as they arrive, so
+	there is never anything to read. */
+	( void ) pxPeripheral;
+	( void ) pvBuffer;
+	( void ) xBytes;
+
+	return 0U;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvJ1939Ioctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue )
+{
+CAN_J1939_Node_t * const pxNode = prvJ1939_NODE( pxPeripheral );
+portBASE_TYPE xReturn = pdPASS;
+J1939_PGN_Handler_t *pxSlot;
+
+	if( ulRequest == ioctlSET_J1939_CONFIG )
+	{
+		/* The handler table and Rx buffer are allocated from the heap, so
+		this is done outside of the critical section below. */
+		xReturn = prvConfigure( pxNode, ( const J1939_Config_t * ) pvValue );
+	}
+	else if( ulRequest == ioctlRELEASE_J1939_NODE )
+	{
+		prvRelease( pxNode );
+	}
+	else
+	{
+		taskENTER_CRITICAL();
+		{
+			switch( ulRequest )
+			{
+				case ioctlADD_J1939_PGN_HANDLER :
+
+					/* Handlers can only be added once the node has a handler
+					table, and are discarded if it is reconfigured. */
+					if( ( pxNode->pxHandlers != NULL ) && ( ( ( const J1939_PGN_Handler_t * ) pvValue )->pxHandler != NULL ) )
+					{
+						pxSlot = prvFindHandlerSlot( pxNode, ( ( const J1939_PGN_Handler_t * ) pvValue )->ulPGN & j1939PGN_MASK );
+
+						if( pxSlot->pxHandler == NULL )
+						{
+							if( pxNode->usHandlers < pxNode->xConfig.usMaxHandlers )
+							{
+								( pxNode->usHandlers )++;
+							}
+							else
+							{
+								pxSlot = NULL;
+							}
+						}
+
+						if( pxSlot != NULL )
+						{
+							*pxSlot = *( ( const J1939_PGN_Handler_t * ) pvValue );
+							pxSlot->ulPGN &= j1939PGN_MASK;
+						}
+						else
+						{
+							xReturn = pdFAIL;
+						}
+					}
+					else
+					{
+						xReturn = pdFAIL;
+					}
+					break;
+
+				case ioctlGET_J1939_ADDRESS :
+
+					/* The address is only usable once the claim has
+					succeeded. */
+					*( ( uint8_t * ) pvValue ) = pxNode->ucAddress;
+					xReturn = ( pxNode->ucClaimState == j1939CLAIMED ) ? pdPASS : pdFAIL;
+					break;
+
+				case ioctlGET_J1939_STATISTICS :
+
+					*( ( J1939_Statistics_t * ) pvValue ) = pxNode->xStatistics;
+					break;
+
+				case ioctlSET_TX_TIMEOUT :
+
+					/* The longest a write can take, including the wait for
+					every CTS and the gaps between the frames of a BAM. */
+					pxNode->xTxBlockTime = ( portTickType ) pvValue;
+					break;
+
+				default :
+
+					xReturn = pdFAIL;
+					break;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvJoinBus( CAN_J1939_Node_t * const pxNode, Peripheral_Descriptor_t const xCAN )
+{
+CAN_J1939_Bus_t *pxBus, *pxNewBus = NULL;
+portBASE_TYPE xReturn = pdFAIL, xNewBusUsed = pdFALSE;
+
+	taskENTER_CRITICAL();
+	{
+		pxBus = prvFindBus( xCAN );
+	}
+	taskEXIT_CRITICAL();
+
+	if( pxBus == NULL )
+	{
+		/* The first node on the controller.  The bus is created, and its
+		layer added through the controller's own ioctl(), outside of a critical
+		section. */
+		pxNewBus = pvPortMalloc( sizeof( CAN_J1939_Bus_t ) );
+
+		if( pxNewBus != NULL )
+		{
+			memset( pxNewBus, 0x00, sizeof( CAN_J1939_Bus_t ) );
+			pxNewBus->xCAN = xCAN;
+			pxNewBus->xLayer.pxRxFunction = prvLayerRxFromISR;
+			pxNewBus->xLayer.pxTxFunction = prvLayerTxFromISR;
+			pxNewBus->xLayer.pvContext = ( void * ) pxNewBus;
+
+			if( FreeRTOS_ioctl( xCAN, ioctlADD_CAN_LAYER, &( pxNewBus->xLayer ) ) != pdPASS )
+			{
+				vPortFree( pxNewBus );
+				pxNewBus = NULL;
+			}
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		/* Another task may have created a bus for the controller in the
+		meantime, in which case that one is used. */
+		pxBus = prvFindBus( xCAN );
+
+		if( ( pxBus == NULL ) && ( pxNewBus != NULL ) )
+		{
+			pxNewBus->pxNext = pxBuses;
+			pxBuses = pxNewBus;
+			pxBus = pxNewBus;
+			xNewBusUsed = pdTRUE;
+		}
+
+		if( pxBus != NULL )
+		{
+			/* The node is ignored by the CAN interrupt until it has a handler
+			table. */
+			pxNode->pxBus = pxBus;
+			pxNode->pxNext = pxBus->pxNodes;
+			pxBus->pxNodes = pxNode;
+			( pxBus->uxNodes )++;
+			xReturn = pdPASS;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( ( pxNewBus != NULL ) && ( xNewBusUsed == pdFALSE ) )
+	{
+		FreeRTOS_ioctl( xCAN, ioctlREMOVE_CAN_LAYER, &( pxNewBus->xLayer ) );
+		vPortFree( pxNewBus );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLeaveBus( CAN_J1939_Node_t * const pxNode )
+{
+CAN_J1939_Bus_t * const pxBus = pxNode->pxBus;
+CAN_J1939_Bus_t **ppxBusLink;
+CAN_J1939_Node_t **ppxLink;
+portBASE_TYPE xLastNode = pdFALSE;
+
+	taskENTER_CRITICAL();
+	{
+		for( ppxLink = &( pxBus->pxNodes ); *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+		{
+			if( *ppxLink == pxNode )
+			{
+				*ppxLink = pxNode->pxNext;
+				break;
+			}
+		}
+
+		( pxBus->uxNodes )--;
+
+		if( pxBus->uxNodes == 0U )
+		{
+			for( ppxBusLink = &pxBuses; *ppxBusLink != NULL; ppxBusLink = &( ( *ppxBusLink )->pxNext ) )
+			{
+				if( *ppxBusLink == pxBus )
+				{
+					*ppxBusLink = pxBus->pxNext;
+					break;
+				}
+			}
+
+			xLastNode = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xLastNode != pdFALSE )
+	{
+		/* The bus has no nodes left for the CAN interrupt to walk, and once
+		the layer has been removed the CAN interrupt no longer uses the bus at
+		all. */
+		FreeRTOS_ioctl( pxBus->xCAN, ioctlREMOVE_CAN_LAYER, &( pxBus->xLayer ) );
+		vPortFree( pxBus );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static CAN_J1939_Bus_t *prvFindBus( Peripheral_Descriptor_t const xCAN )
+{
+CAN_J1939_Bus_t *pxBus;
+
+	for( pxBus = pxBuses; pxBus != NULL; pxBus = pxBus->pxNext )
+	{
+		if( pxBus->xCAN == xCAN )
+		{
+			break;
+		}
+	}
+
+	return pxBus;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvConfigure( CAN_J1939_Node_t * const pxNode, const J1939_Config_t * const pxConfig )
+{
+portBASE_TYPE xReturn = pdFAIL;
+J1939_PGN_Handler_t *pxNewHandlers, *pxOldHandlers = NULL;
+size_t xSlots = 2U;
+
+	configASSERT( pxConfig );
+
+	if( ( pxConfig->ucPreferredAddress < diJ1939_NULL_ADDRESS ) && ( pxConfig->usMaxHandlers > 0U ) && ( pxConfig->usRxBufferSize <= diJ1939_MAX_MESSAGE_BYTES ) )
+	{
+		/* At least twice as many hash slots as handlers, rounded up to a
+		power of two. */
+		while( xSlots < ( ( size_t ) pxConfig->usMaxHandlers * 2U ) )
+		{
+			xSlots <<= 1U;
+		}
+
+		/* The handler table and the Rx buffer are allocated as one block. */
+		pxNewHandlers = pvPortMalloc( ( sizeof( J1939_PGN_Handler_t ) * xSlots ) + pxConfig->usRxBufferSize );
+
+		if( pxNewHandlers != NULL )
+		{
+			memset( pxNewHandlers, 0x00, sizeof( J1939_PGN_Handler_t ) * xSlots );
+
+			taskENTER_CRITICAL();
+			{
+				/* A node cannot be reconfigured while it is sending. */
+				if( pxNode->ucTxState == j1939TX_IDLE )
+				{
+					pxNode->xConfig = *pxConfig;
+					pxOldHandlers = pxNode->pxHandlers;
+					pxNode->pxHandlers = pxNewHandlers;
+					pxNode->usHandlerSlotMask = ( uint16_t ) ( xSlots - 1U );
+					pxNode->usHandlers = 0U;
+					pxNode->pucRxBuffer = ( uint8_t * ) &( pxNewHandlers[ xSlots ] );
+					pxNode->ucRxState = j1939RX_IDLE;
+
+					/* Start claiming the preferred address. */
+					pxNode->ucAddress = pxConfig->ucPreferredAddress;
+					pxNode->ucAddressesTried = 0U;
+					pxNode->ucClaimState = j1939CLAIMING;
+					prvSendAddressClaim( pxNode );
+
+					xReturn = pdPASS;
+				}
+			}
+			taskEXIT_CRITICAL();
+
+			if( xReturn == pdPASS )
+			{
+				xTimerStop( pxNode->xRxTimer, 0U );
+				xTimerChangePeriod( pxNode->xClaimTimer, j1939ADDRESS_CLAIM_DELAY, 0U );
+
+				/* The ISR cannot still be using the old table once the
+				critical section has been exited. */
+				if( pxOldHandlers != NULL )
+				{
+					vPortFree( pxOldHandlers );
+				}
+			}
+			else
+			{
+				vPortFree( pxNewHandlers );
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRelease( CAN_J1939_Node_t * const pxNode )
+{
+J1939_PGN_Handler_t * const pxHandlers = pxNode->pxHandlers;
+
+	/* The CAN interrupt ignores a node without a handler table, so can no
+	longer start the node's timers, and the timer callbacks are left nothing to
+	do. */
+	taskENTER_CRITICAL();
+	{
+		pxNode->pxHandlers = NULL;
+		pxNode->ucClaimState = j1939CANNOT_CLAIM;
+		pxNode->ucTxState = j1939TX_IDLE;
+		pxNode->ucRxState = j1939RX_IDLE;
+	}
+	taskEXIT_CRITICAL();
+
+	/* The callbacks are given the node, so it is not freed until the timer
+	service task has finished with its timers.  The node stays on its bus until
+	then, so the bus is not freed under a callback either. */
+	prvDeleteTimer( pxNode->xClaimTimer );
+	prvDeleteTimer( pxNode->xBAMTimer );
+	prvDeleteTimer( pxNode->xRxTimer );
+	prvLeaveBus( pxNode );
+
+	vQueueDelete( pxNode->xTxDoneSemaphore );
+
+	if( pxHandlers != NULL )
+	{
+		vPortFree( pxHandlers );
+	}
+
+	vPortFree( pxNode );
+}
+/*-----------------------------------------------------------*/
+
+static void prvDeleteTimer( xTimerHandle xTimer )
+{
+	xTimerStop( xTimer, portMAX_DELAY );
+
+	while( xTimerIsTimerActive( xTimer ) != pdFALSE )
+	{
+		vTaskDelay( 1 );
+	}
+
+	xTimerDelete( xTimer, portMAX_DELAY );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+const CAN_J1939_Bus_t * const pxBus = ( const CAN_J1939_Bus_t * ) pxLayer->pvContext;
+CAN_J1939_Node_t *pxNode;
+J1939_Message_t xMessage;
+J1939_PGN_Handler_t *pxSlot;
+uint32_t ulPayload[ 2 ], ulRequestedPGN;
+portBASE_TYPE xTaken = pdFALSE;
+
+	if( ( pxFrame->format == EXT_ID_FORMAT ) && ( pxFrame->type == DATA_FRAME ) )
+	{
+		ulPayload[ 0 ] = pxFrame->dataAWord;
+		ulPayload[ 1 ] = pxFrame->dataBWord;
+
+		/* Split the ID into its priority, PGN and addresses. */
+		xMessage.ulPGN = j1939ID_PGN( pxFrame->id );
+		xMessage.ucPriority = j1939ID_PRIORITY( pxFrame->id );
+		xMessage.ucSourceAddress = j1939ID_SA( pxFrame->id );
+		xMessage.ucDestinationAddress = diJ1939_GLOBAL_ADDRESS;
+		xMessage.usLength = ( uint16_t ) j1939DLC_TO_BYTES( pxFrame->len );
+		xMessage.pucData = ( const uint8_t * ) ulPayload;
+
+		if( j1939PF( xMessage.ulPGN ) < j1939PDU2_MIN_PF )
+		{
+			xMessage.ucDestinationAddress = j1939ID_PS( pxFrame->id );
+			xMessage.ulPGN &= j1939PDU1_PGN_MASK;
+		}
+
+		for( pxNode = pxBus->pxNodes; pxNode != NULL; pxNode = pxNode->pxNext )
+		{
+			if( pxNode->pxHandlers == NULL )
+			{
+				/* Not configured yet. */
+			}
+			else if( xMessage.ulPGN == j1939PGN_ADDRESS_CLAIMED )
+			{
+				/* Every node needs to see every claim. */
+				prvAddressClaimedFromISR( pxNode, &xMessage, pxHigherPriorityTaskWoken );
+				xTaken = pdTRUE;
+			}
+			else if( ( xMessage.ucDestinationAddress != diJ1939_GLOBAL_ADDRESS ) && ( xMessage.ucDestinationAddress != pxNode->ucAddress ) )
+			{
+				/* Sent to another node. */
+			}
+			else if( xMessage.ulPGN == j1939PGN_TP_CM )
+			{
+				xTaken |= prvConnectionFromISR( pxNode, &xMessage, pxHigherPriorityTaskWoken );
+			}
+			else if( xMessage.ulPGN == j1939PGN_TP_DT )
+			{
+				xTaken |= prvDataFromISR( pxNode, &xMessage, pxHigherPriorityTaskWoken );
+			}
+			else
+			{
+				ulRequestedPGN = 0UL;
+				if( ( xMessage.ulPGN == j1939PGN_REQUEST ) && ( xMessage.usLength >= 3U ) )
+				{
+					ulRequestedPGN = ( ( uint32_t ) xMessage.pucData[ 0 ] ) | ( ( uint32_t ) xMessage.pucData[ 1 ] << 8UL ) | ( ( uint32_t ) xMessage.pucData[ 2 ] << 16UL );
+				}
+
+				if( ulRequestedPGN == j1939PGN_ADDRESS_CLAIMED )
+				{
+					/* Answered even by a node that could not claim an
+					address, which answers with the null address. */
+					prvSendAddressClaim( pxNode );
+					xTaken = pdTRUE;
+				}
+				else
+				{
+					pxSlot = prvFindHandlerSlot( pxNode, xMessage.ulPGN );
+
+					if( pxSlot->pxHandler != NULL )
+					{
+						pxSlot->pxHandler( &xMessage, pxSlot->pvContext, pxHigherPriorityTaskWoken );
+						( pxNode->xStatistics.ulFramesDispatched )++;
+						xTaken = pdTRUE;
+					}
+				}
+			}
+		}
+	}
+
+	return xTaken;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLayerTxFromISR( CAN_Layer_t * const pxLayer, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+const CAN_J1939_Bus_t * const pxBus = ( const CAN_J1939_Bus_t * ) pxLayer->pvContext;
+CAN_J1939_Node_t *pxNode;
+
+	for( pxNode = pxBus->pxNodes; pxNode != NULL; pxNode = pxNode->pxNext )
+	{
+		/* The frames of every node on the bus are counted together, so a node
+		can occasionally be held up until the frames of the others have gone
+		too. */
+		if( ( pxNode->xTxFrameSent != pdFALSE ) && ( pxLayer->usTxFramesPending == 0U ) )
+		{
+			/* The last frame sent has gone. */
+			pxNode->xTxFrameSent = pdFALSE;
+
+			if( pxNode->ucTxState == j1939TX_LAST )
+			{
+				pxNode->ucTxState = j1939TX_IDLE;
+				pxNode->xTxResult = pdPASS;
+				( pxNode->xStatistics.ulMessagesSent )++;
+				xSemaphoreGiveFromISR( pxNode->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+			}
+			else if( pxNode->ucTxState == j1939TX_BAM_GAP )
+			{
+				/* The gap is measured from the end of one frame of a BAM to
+				the start of the next. */
+				xTimerChangePeriodFromISR( pxNode->xBAMTimer, j1939BAM_PACKET_GAP, pxHigherPriorityTaskWoken );
+			}
+		}
+
+		/* Also retries a frame there was no room for. */
+		prvTransmit( pxNode );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvConnectionFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+const uint8_t * const pucData = pxMessage->pucData;
+const uint8_t ucSource = pxMessage->ucSourceAddress;
+uint32_t ulPGN, ulLastPacket;
+uint16_t usLength;
+uint8_t ucPackets;
+portBASE_TYPE xTaken = pdFALSE;
+
+	if( pxMessage->usLength == j1939MAX_PAYLOAD_BYTES )
+	{
+		/* Every connection management frame ends with the PGN of the message
+		being carried. */
+		ulPGN = ( ( uint32_t ) pucData[ 5 ] ) | ( ( uint32_t ) pucData[ 6 ] << 8UL ) | ( ( uint32_t ) pucData[ 7 ] << 16UL );
+		usLength = ( uint16_t ) ( ( uint16_t ) pucData[ 1 ] | ( ( uint16_t ) pucData[ 2 ] << 8U ) );
+		ucPackets = pucData[ 3 ];
+
+		switch( pucData[ 0 ] )
+		{
+			case j1939TP_BAM :
+			case j1939TP_RTS :
+
+				if( ( pucData[ 0 ] == j1939TP_BAM ) && ( pxMessage->ucDestinationAddress != diJ1939_GLOBAL_ADDRESS ) )
+				{
+					/* A BAM is only ever broadcast. */
+				}
+				else if( prvFindHandlerSlot( pxNode, ulPGN )->pxHandler == NULL )
+				{
+					/* Nothing wants the message.  A broadcast is left for the
+					controller's own readers, a connection is refused. */
+					if( pucData[ 0 ] == j1939TP_RTS )
+					{
+						prvSendConnection( pxNode, ucSource, j1939TP_ABORT, j1939ABORT_RESOURCES, 0xFFU, 0xFFU, 0xFFU, ulPGN );
+						( pxNode->xStatistics.ulRxRefused )++;
+						xTaken = pdTRUE;
+					}
+				}
+				else
+				{
+					xTaken = pdTRUE;
+
+					/* A sender that starts again abandons its last message. */
+					if( ( pxNode->ucRxState != j1939RX_IDLE ) && ( pxNode->xRxMessage.ucSourceAddress == ucSource ) )
+					{
+						( pxNode->xStatistics.ulRxAborts )++;
+						pxNode->ucRxState = j1939RX_IDLE;
+					}
+
+					if( ( pxNode->ucRxState != j1939RX_IDLE ) || ( usLength > pxNode->xConfig.usRxBufferSize ) || ( usLength <= j1939MAX_PAYLOAD_BYTES ) || ( ucPackets != ( uint8_t ) ( ( usLength + ( j1939PACKET_BYTES - 1U ) ) / j1939PACKET_BYTES ) ) )
+					{
+						if( pucData[ 0 ] == j1939TP_RTS )
+						{
+							prvSendConnection( pxNode, ucSource, j1939TP_ABORT, ( pxNode->ucRxState != j1939RX_IDLE ) ? j1939ABORT_BUSY : j1939ABORT_RESOURCES, 0xFFU, 0xFFU, 0xFFU, ulPGN );
+						}
+
+						( pxNode->xStatistics.ulRxRefused )++;
+					}
+					else
+					{
+						pxNode->xRxMessage.ulPGN = ulPGN;
+						pxNode->xRxMessage.ucPriority = pxMessage->ucPriority;
+						pxNode->xRxMessage.ucSourceAddress = ucSource;
+						pxNode->xRxMessage.ucDestinationAddress = pxMessage->ucDestinationAddress;
+						pxNode->xRxMessage.usLength = usLength;
+						pxNode->xRxMessage.pucData = pxNode->pucRxBuffer;
+						pxNode->ucRxPackets = ucPackets;
+						pxNode->ucRxNextPacket = 1U;
+
+						if( pucData[ 0 ] == j1939TP_BAM )
+						{
+							pxNode->ucRxState = j1939RX_BAM;
+							xTimerChangePeriodFromISR( pxNode->xRxTimer, j1939T1, pxHigherPriorityTaskWoken );
+						}
+						else
+						{
+							/* 0xFF means the sender places no limit on the
+							packets sent for each CTS. */
+							pxNode->ucRxState = j1939RX_CMDT;
+							pxNode->ucRxSenderPacketsPerCTS = ( pucData[ 4 ] == 0U ) ? 0xFFU : pucData[ 4 ];
+							prvSendCTSFromISR( pxNode, pxHigherPriorityTaskWoken );
+						}
+					}
+				}
+				break;
+
+
+			case j1939TP_CTS :
+
+				if( ( pxNode->ucTxState == j1939TX_WAIT_CTS ) && ( ucSource == pxNode->xTxMessage.ucDestinationAddress ) && ( ulPGN == pxNode->xTxMessage.ulPGN ) )
+				{
+					xTaken = pdTRUE;
+
+					/* A CTS for no packets asks the sender to wait for another
+					CTS. */
+					if( ( pucData[ 1 ] > 0U ) && ( pucData[ 2 ] > 0U ) && ( pucData[ 2 ] <= pxNode->ucTxPackets ) )
+					{
+						ulLastPacket = ( uint32_t ) pucData[ 2 ] + ( uint32_t ) pucData[ 1 ] - 1UL;
+						pxNode->ucTxNextPacket = pucData[ 2 ];
+						pxNode->ucTxLastPacket = ( ulLastPacket > ( uint32_t ) pxNode->ucTxPackets ) ? pxNode->ucTxPackets : ( uint8_t ) ulLastPacket;
+						pxNode->ucTxState = j1939TX_CMDT_DATA;
+						prvTransmit( pxNode );
+					}
+				}
+				break;
+
+
+			case j1939TP_END_OF_MSG_ACK :
+
+				if( ( pxNode->ucTxState == j1939TX_WAIT_ACK ) && ( ucSource == pxNode->xTxMessage.ucDestinationAddress ) && ( ulPGN == pxNode->xTxMessage.ulPGN ) )
+				{
+					pxNode->ucTxState = j1939TX_IDLE;
+					pxNode->xTxResult = pdPASS;
+					( pxNode->xStatistics.ulMessagesSent )++;
+					xSemaphoreGiveFromISR( pxNode->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+					xTaken = pdTRUE;
+				}
+				break;
+
+
+			case j1939TP_ABORT :
+
+				if( ( pxNode->ucTxState >= j1939TX_RTS ) && ( pxNode->ucTxState <= j1939TX_WAIT_ACK ) && ( ucSource == pxNode->xTxMessage.ucDestinationAddress ) && ( ulPGN == pxNode->xTxMessage.ulPGN ) )
+				{
+					pxNode->ucTxState = j1939TX_IDLE;
+					( pxNode->xStatistics.ulTxFailures )++;
+					xSemaphoreGiveFromISR( pxNode->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+					xTaken = pdTRUE;
+				}
+
+				if( ( pxNode->ucRxState == j1939RX_CMDT ) && ( ucSource == pxNode->xRxMessage.ucSourceAddress ) && ( ulPGN == pxNode->xRxMessage.ulPGN ) )
+				{
+					( pxNode->xStatistics.ulRxAborts )++;
+					pxNode->ucRxState = j1939RX_IDLE;
+					xTaken = pdTRUE;
+				}
+				break;
+
+
+			default :
+
+				/* Not a connection management frame this layer knows. */
+				break;
+		}
+	}
+
+	return xTaken;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvDataFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+uint32_t ulOffset, ulBytes;
+J1939_PGN_Handler_t *pxSlot;
+portBASE_TYPE xTaken = pdFALSE;
+
+	/* The frame must come from the sender of the message being received, and
+	be addressed the same way as the connection. */
+	if( ( pxNode->ucRxState != j1939RX_IDLE ) && ( pxMessage->ucSourceAddress == pxNode->xRxMessage.ucSourceAddress ) && ( pxMessage->ucDestinationAddress == pxNode->xRxMessage.ucDestinationAddress ) && ( pxMessage->usLength == j1939MAX_PAYLOAD_BYTES ) )
+	{
+		xTaken = pdTRUE;
+
+		if( pxMessage->pucData[ 0 ] != pxNode->ucRxNextPacket )
+		{
+			/* A frame has been lost, so the message cannot be completed. */
+			prvAbortRx( pxNode, j1939ABORT_BAD_SEQUENCE );
+		}
+		else
+		{
+			ulOffset = ( uint32_t ) ( pxNode->ucRxNextPacket - 1U ) * j1939PACKET_BYTES;
+			ulBytes = ( uint32_t ) pxNode->xRxMessage.usLength - ulOffset;
+			if( ulBytes > j1939PACKET_BYTES )
+			{
+				ulBytes = j1939PACKET_BYTES;
+			}
+
+			memcpy( &( pxNode->pucRxBuffer[ ulOffset ] ), &( pxMessage->pucData[ 1 ] ), ulBytes );
+
+			if( pxNode->ucRxNextPacket == pxNode->ucRxPackets )
+			{
+				xTimerStopFromISR( pxNode->xRxTimer, pxHigherPriorityTaskWoken );
+
+				if( pxNode->ucRxState == j1939RX_CMDT )
+				{
+					prvSendConnection( pxNode, pxNode->xRxMessage.ucSourceAddress, j1939TP_END_OF_MSG_ACK, ( uint8_t ) pxNode->xRxMessage.usLength, ( uint8_t ) ( pxNode->xRxMessage.usLength >> 8U ), pxNode->ucRxPackets, 0xFFU, pxNode->xRxMessage.ulPGN );
+				}
+
+				/* The Rx buffer is free for the next message once the handler
+				returns. */
+				pxNode->ucRxState = j1939RX_IDLE;
+				pxSlot = prvFindHandlerSlot( pxNode, pxNode->xRxMessage.ulPGN );
+
+				if( pxSlot->pxHandler != NULL )
+				{
+					pxSlot->pxHandler( &( pxNode->xRxMessage ), pxSlot->pvContext, pxHigherPriorityTaskWoken );
+					( pxNode->xStatistics.ulMessagesReassembled )++;
+				}
+			}
+			else
+			{
+				( pxNode->ucRxNextPacket )++;
+
+				if( ( pxNode->ucRxState == j1939RX_CMDT ) && ( pxNode->ucRxNextPacket > pxNode->ucRxLastPacket ) )
+				{
+					/* The sender will not send more until it is told to. */
+					prvSendCTSFromISR( pxNode, pxHigherPriorityTaskWoken );
+				}
+				else
+				{
+					xTimerChangePeriodFromISR( pxNode->xRxTimer, j1939T1, pxHigherPriorityTaskWoken );
+				}
+			}
+		}
+	}
+
+	return xTaken;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSendCTSFromISR( CAN_J1939_Node_t * const pxNode, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+uint32_t ulPackets;
+portBASE_TYPE xReturn;
+
+	/* Allow the rest of the message, limited by what the sender asked for in
+	its RTS and by what this node is configured to take at once. */
+	ulPackets = ( uint32_t ) ( pxNode->ucRxPackets - pxNode->ucRxNextPacket ) + 1UL;
+
+	if( ( uint32_t ) pxNode->ucRxSenderPacketsPerCTS < ulPackets )
+	{
+		ulPackets = ( uint32_t ) pxNode->ucRxSenderPacketsPerCTS;
+	}
+
+	if( ( pxNode->xConfig.ucPacketsPerCTS > 0U ) && ( ( uint32_t ) pxNode->xConfig.ucPacketsPerCTS < ulPackets ) )
+	{
+		ulPackets = ( uint32_t ) pxNode->xConfig.ucPacketsPerCTS;
+	}
+
+	pxNode->ucRxLastPacket = ( uint8_t ) ( ( uint32_t ) pxNode->ucRxNextPacket + ulPackets - 1UL );
+	xReturn = prvSendConnection( pxNode, pxNode->xRxMessage.ucSourceAddress, j1939TP_CTS, ( uint8_t ) ulPackets, pxNode->ucRxNextPacket, 0xFFU, 0xFFU, pxNode->xRxMessage.ulPGN );
+
+	if( xReturn == pdPASS )
+	{
+		xTimerChangePeriodFromISR( pxNode->xRxTimer, j1939T2, pxHigherPriorityTaskWoken );
+	}
+	else
+	{
+		( pxNode->xStatistics.ulRxAborts )++;
+		pxNode->ucRxState = j1939RX_IDLE;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAbortRx( CAN_J1939_Node_t * const pxNode, const uint8_t ucReason )
+{
+	if( pxNode->ucRxState == j1939RX_CMDT )
+	{
+		prvSendConnection( pxNode, pxNode->xRxMessage.ucSourceAddress, j1939TP_ABORT, ucReason, 0xFFU, 0xFFU, 0xFFU, pxNode->xRxMessage.ulPGN );
+	}
+
+	if( pxNode->ucRxState != j1939RX_IDLE )
+	{
+		( pxNode->xStatistics.ulRxAborts )++;
+		pxNode->ucRxState = j1939RX_IDLE;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddressClaimedFromISR( CAN_J1939_Node_t * const pxNode, const J1939_Message_t * const pxMessage, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+uint64_t ullName = 0ULL;
+portBASE_TYPE xByte;
+
+	if( ( pxNode->ucClaimState != j1939CANNOT_CLAIM ) && ( pxMessage->ucSourceAddress == pxNode->ucAddress ) && ( pxMessage->usLength == j1939MAX_PAYLOAD_BYTES ) )
+	{
+		/* The NAME is sent least significant byte first. */
+		for( xByte = ( portBASE_TYPE ) j1939MAX_PAYLOAD_BYTES - 1; xByte >= 0; xByte-- )
+		{
+			ullName = ( ullName << 8ULL ) | ( uint64_t ) pxMessage->pucData[ xByte ];
+		}
+
+		if( pxNode->xConfig.ullName < ullName )
+		{
+			/* This node has the higher priority NAME, so keeps the address,
+			and says so. */
+			prvSendAddressClaim( pxNode );
+		}
+		else if( pxNode->xConfig.ullName > ullName )
+		{
+			( pxNode->xStatistics.ulAddressesLost )++;
+
+			/* A message that was being sent from the lost address cannot be
+			completed. */
+			if( pxNode->ucTxState != j1939TX_IDLE )
+			{
+				pxNode->ucTxState = j1939TX_IDLE;
+				( pxNode->xStatistics.ulTxFailures )++;
+				xSemaphoreGiveFromISR( pxNode->xTxDoneSemaphore, pxHigherPriorityTaskWoken );
+			}
+
+			if( ( ( pxNode->xConfig.ullName & j1939ARBITRARY_ADDRESS_BIT ) != 0ULL ) && ( pxNode->ucAddressesTried <= ( j1939LAST_ARBITRARY_ADDRESS - j1939FIRST_ARBITRARY_ADDRESS ) ) )
+			{
+				/* Try the next address in the arbitrary address range. */
+				if( ( pxNode->ucAddress < j1939FIRST_ARBITRARY_ADDRESS ) || ( pxNode->ucAddress >= j1939LAST_ARBITRARY_ADDRESS ) )
+				{
+					pxNode->ucAddress = j1939FIRST_ARBITRARY_ADDRESS;
+				}
+				else
+				{
+					( pxNode->ucAddress )++;
+				}
+
+				( pxNode->ucAddressesTried )++;
+				pxNode->ucClaimState = j1939CLAIMING;
+				xTimerChangePeriodFromISR( pxNode->xClaimTimer, j1939ADDRESS_CLAIM_DELAY, pxHigherPriorityTaskWoken );
+			}
+			else
+			{
+				/* Send a cannot claim address message. */
+				pxNode->ucAddress = diJ1939_NULL_ADDRESS;
+				pxNode->ucClaimState = j1939CANNOT_CLAIM;
+			}
+
+			prvSendAddressClaim( pxNode );
+		}
+		else
+		{
+			/* Two nodes with the same NAME is a network configuration error
+			that cannot be resolved here. */
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvTransmit( CAN_J1939_Node_t * const pxNode )
+{
+uint32_t ulPayload[ 2 ], ulOffset, ulBytes;
+uint8_t * const pucPayload = ( uint8_t * ) ulPayload;
+const uint8_t ucPacket = pxNode->ucTxNextPacket;
+uint8_t ucNextState = pxNode->ucTxState, ucNextPacket = ucPacket;
+CAN_MSG_Type xFrame;
+
+	if( ( pxNode->xTxFrameSent == pdFALSE ) && ( ( pxNode->ucTxState == j1939TX_SINGLE ) || ( pxNode->ucTxState == j1939TX_BAM ) || ( pxNode->ucTxState == j1939TX_BAM_DATA ) || ( pxNode->ucTxState == j1939TX_RTS ) || ( pxNode->ucTxState == j1939TX_CMDT_DATA ) ) )
+	{
+		memset( &xFrame, 0x00, sizeof( xFrame ) );
+		memset( ulPayload, 0xFF, sizeof( ulPayload ) );
+		xFrame.format = EXT_ID_FORMAT;
+		xFrame.type = DATA_FRAME;
+		xFrame.len = ( uint8_t ) j1939MAX_PAYLOAD_BYTES;
+
+		switch( pxNode->ucTxState )
+		{
+			case j1939TX_SINGLE :
+
+				memcpy( pucPayload, pxNode->xTxMessage.pucData, pxNode->xTxMessage.usLength );
+				xFrame.id = prvID( pxNode->xTxMessage.ucPriority, pxNode->xTxMessage.ulPGN, pxNode->xTxMessage.ucDestinationAddress, pxNode->ucAddress );
+				xFrame.len = ( uint8_t ) pxNode->xTxMessage.usLength;
+				ucNextState = j1939TX_LAST;
+				break;
+
+			case j1939TX_BAM :
+			case j1939TX_RTS :
+
+				/* The BAM or RTS announces the message.  An RTS places no
+				limit on the number of packets the receiver can ask for in each
+				CTS. */
+				pucPayload[ 0 ] = ( pxNode->ucTxState == j1939TX_BAM ) ? j1939TP_BAM : j1939TP_RTS;
+				pucPayload[ 1 ] = ( uint8_t ) pxNode->xTxMessage.usLength;
+				pucPayload[ 2 ] = ( uint8_t ) ( pxNode->xTxMessage.usLength >> 8U );
+				pucPayload[ 3 ] = pxNode->ucTxPackets;
+				pucPayload[ 5 ] = ( uint8_t ) pxNode->xTxMessage.ulPGN;
+				pucPayload[ 6 ] = ( uint8_t ) ( pxNode->xTxMessage.ulPGN >> 8UL );
+				pucPayload[ 7 ] = ( uint8_t ) ( pxNode->xTxMessage.ulPGN >> 16UL );
+				xFrame.id = prvID( j1939TP_PRIORITY, j1939PGN_TP_CM, pxNode->xTxMessage.ucDestinationAddress, pxNode->ucAddress );
+				ucNextState = ( pxNode->ucTxState == j1939TX_BAM ) ? j1939TX_BAM_GAP : j1939TX_WAIT_CTS;
+				break;
+
+			default :
+
+				/* A data frame, cut straight from the writer's buffer.  Bytes
+				after the end of the message are left as 0xFF. */
+				ulOffset = ( uint32_t ) ( ucPacket - 1U ) * j1939PACKET_BYTES;
+				ulBytes = ( uint32_t ) pxNode->xTxMessage.usLength - ulOffset;
+				if( ulBytes > j1939PACKET_BYTES )
+				{
+					ulBytes = j1939PACKET_BYTES;
+				}
+
+				pucPayload[ 0 ] = ucPacket;
+				memcpy( &( pucPayload[ 1 ] ), &( pxNode->xTxMessage.pucData[ ulOffset ] ), ulBytes );
+				xFrame.id = prvID( j1939TP_PRIORITY, j1939PGN_TP_DT, pxNode->xTxMessage.ucDestinationAddress, pxNode->ucAddress );
+				ucNextPacket = ucPacket + 1U;
+
+				if( pxNode->ucTxState == j1939TX_BAM_DATA )
+				{
+					ucNextState = ( ucPacket == pxNode->ucTxPackets ) ? j1939TX_LAST : j1939TX_BAM_GAP;
+				}
+				else if( ucPacket == pxNode->ucTxPackets )
+				{
+					ucNextState = j1939TX_WAIT_ACK;
+				}
+				else if( ucPacket == pxNode->ucTxLastPacket )
+				{
+					ucNextState = j1939TX_WAIT_CTS;
+				}
+				else
+				{
+					/* More of the block to send. */
+				}
+				break;
+		}
+
+		xFrame.dataAWord = ulPayload[ 0 ];
+		xFrame.dataBWord = ulPayload[ 1 ];
+
+		/* The node only moves on once the frame has found room.  Otherwise it
+		is tried again the next time a frame of the controller has gone. */
+		if( pxNode->pxBus->xLayer.pxSendFunction( &( pxNode->pxBus->xLayer ), &xFrame ) == pdPASS )
+		{
+			pxNode->xTxFrameSent = pdTRUE;
+			pxNode->ucTxNextPacket = ucNextPacket;
+			pxNode->ucTxState = ucNextState;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSend( const CAN_J1939_Node_t * const pxNode, const uint32_t ulPGN, const uint8_t ucPriority, const uint8_t ucDestinationAddress, const uint8_t * const pucData )
+{
+CAN_MSG_Type xFrame;
+
+	memset( &xFrame, 0x00, sizeof( xFrame ) );
+	xFrame.id = prvID( ucPriority, ulPGN, ucDestinationAddress, pxNode->ucAddress );
+	xFrame.format = EXT_ID_FORMAT;
+	xFrame.type = DATA_FRAME;
+	xFrame.len = ( uint8_t ) j1939MAX_PAYLOAD_BYTES;
+	memcpy( &( xFrame.dataA[ 0 ] ), &( pucData[ 0 ] ), 4U );
+	memcpy( &( xFrame.dataB[ 0 ] ), &( pucData[ 4 ] ), 4U );
+
+	/* Sent through the Tx frame queue if the controller has one, otherwise
+	through any free Tx buffer. */
+	return pxNode->pxBus->xLayer.pxSendFunction( &( pxNode->pxBus->xLayer ), &xFrame );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSendAddressClaim( const CAN_J1939_Node_t * const pxNode )
+{
+uint8_t ucName[ j1939MAX_PAYLOAD_BYTES ];
+uint32_t ulByte;
+
+	for( ulByte = 0UL; ulByte < j1939MAX_PAYLOAD_BYTES; ulByte++ )
+	{
+		ucName[ ulByte ] = ( uint8_t ) ( pxNode->xConfig.ullName >> ( ulByte * 8UL ) );
+	}
+
+	/* A node that cannot claim an address sends its claim from the null
+	address. */
+	return prvSend( pxNode, j1939PGN_ADDRESS_CLAIMED, j1939CLAIM_PRIORITY, diJ1939_GLOBAL_ADDRESS, ucName );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSendConnection( const CAN_J1939_Node_t * const pxNode, const uint8_t ucDestinationAddress, const uint8_t ucControl, const uint8_t ucByte1, const uint8_t ucByte2, const uint8_t ucByte3, const uint8_t ucByte4, const uint32_t ulPGN )
+{
+uint8_t ucData[ j1939MAX_PAYLOAD_BYTES ];
+
+	ucData[ 0 ] = ucControl;
+	ucData[ 1 ] = ucByte1;
+	ucData[ 2 ] = ucByte2;
+	ucData[ 3 ] = ucByte3;
+	ucData[ 4 ] = ucByte4;
+	ucData[ 5 ] = ( uint8_t ) ulPGN;
+	ucData[ 6 ] = ( uint8_t ) ( ulPGN >> 8UL );
+	ucData[ 7 ] = ( uint8_t ) ( ulPGN >> 16UL );
+
+	return prvSend( pxNode, j1939PGN_TP_CM, j1939TP_PRIORITY, ucDestinationAddress, ucData );
+}
+/*-----------------------------------------------------------*/
+
+static J1939_PGN_Handler_t *prvFindHandlerSlot( const CAN_J1939_Node_t * const pxNode, const uint32_t ulPGN )
+{
+uint32_t ulSlot;
+
+	/* Probe linearly from the PGN's hash.  The table is never full, so the
+	search always ends at the PGN's own slot or at an empty slot. */
+	ulSlot = ( ( ulPGN * 2654435761UL ) >> 16UL ) & pxNode->usHandlerSlotMask;
+
+	while( ( pxNode->pxHandlers[ ulSlot ].pxHandler != NULL ) && ( pxNode->pxHandlers[ ulSlot ].ulPGN != ulPGN ) )
+	{
+		ulSlot = ( ulSlot + 1UL ) & pxNode->usHandlerSlotMask;
+	}
+
+	return &( pxNode->pxHandlers[ ulSlot ] );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvID( const uint8_t ucPriority, const uint32_t ulPGN, const uint8_t ucDestinationAddress, const uint8_t ucSourceAddress )
+{
+uint32_t ulID;
+
+	ulID = ( ( uint32_t ) ( ucPriority & 0x07U ) << 26UL ) | ( ( ulPGN & j1939PGN_MASK ) << 8UL ) | ( uint32_t ) ucSourceAddress;
+
+	if( j1939PF( ulPGN ) < j1939PDU2_MIN_PF )
+	{
+		ulID = ( ulID & ~0x0000FF00UL ) | ( ( uint32_t ) ucDestinationAddress << 8UL );
+	}
+
+	return ulID;
+}
+/*-----------------------------------------------------------*/
+
+static void prvClaimCallback( xTimerHandle xTimer )
+{
+CAN_J1939_Node_t * const pxNode = ( CAN_J1939_Node_t * ) pvTimerGetTimerID( xTimer );
+
+	taskENTER_CRITICAL();
+	{
+		/* Nobody has contested the claim in time, so the address is now the
+		node's. */
+		if( pxNode->ucClaimState == j1939CLAIMING )
+		{
+			pxNode->ucClaimState = j1939CLAIMED;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvBAMCallback( xTimerHandle xTimer )
+{
+CAN_J1939_Node_t * const pxNode = ( CAN_J1939_Node_t * ) pvTimerGetTimerID( xTimer );
+
+	taskENTER_CRITICAL();
+	{
+		/* The message may have been abandoned while the timer was running.
+		prvTransmit() uses no FreeRTOS API function, so can be called from
+		here. */
+		if( ( pxNode->ucTxState == j1939TX_BAM_GAP ) && ( pxNode->xTxFrameSent == pdFALSE ) )
+		{
+			pxNode->ucTxState = j1939TX_BAM_DATA;
+			prvTransmit( pxNode );
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvRxTimeoutCallback( xTimerHandle xTimer )
+{
+CAN_J1939_Node_t * const pxNode = ( CAN_J1939_Node_t * ) pvTimerGetTimerID( xTimer );
+
+	taskENTER_CRITICAL();
+	{
+		prvAbortRx( pxNode, j1939ABORT_TIMEOUT );
+	}
+	taskEXIT_CRITICAL();
+}
+
+#endif /* ioconfigUSE_CAN_J1939 */
+
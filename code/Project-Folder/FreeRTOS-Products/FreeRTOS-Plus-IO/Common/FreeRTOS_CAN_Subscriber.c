@@ -0,0 +1,842 @@
+/*
+ * FreeRTOS+IO V1.0.1 (C) 2012 Real Time Engineers ltd.
+ *
+ * FreeRTOS+IO is an add-on component to FreeRTOS.  It is not, in itself, part
+ * of the FreeRTOS kernel.  FreeRTOS+IO is licensed separately from FreeRTOS,
+ * and uses a different license to FreeRTOS.  FreeRTOS+IO uses a dual license
+ * model, information on which is provided below:
+ *
+ * - Open source licensing -
+ * FreeRTOS+IO is a free download and may be used, modified and distributed
+ * without charge provided the user adheres to version two of the GNU General
+ * Public license (GPL) and does not remove the copyright notice or this text.
+ * The GPL V2 text is available on the gnu.org web site, and on the following
+ * URL: http://www.FreeRTOS.org/gpl-2.0.txt
+ *
+ * - Commercial licensing -
+ * Businesses and individuals who wish to incorporate FreeRTOS+IO into
+ * proprietary software for redistribution in any form must first obtain a low
+ * cost commercial license - and in-so-doing support the maintenance, support
+ * and further development of the FreeRTOS+IO product.  Commercial licenses can
+ * be obtained from http://shop.freertos.org and do not require any source files
+ * to be changed.
+ *
+ * FreeRTOS+IO is distributed in the hope that it will be useful.  You cannot
+ * use FreeRTOS+IO unless you agree that you use the software 'as is'.
+ * FreeRTOS+IO is provided WITHOUT ANY WARRANTY; without even the implied
+ * warranties of NON-INFRINGEMENT, MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. Real Time Engineers Ltd. disclaims all conditions and terms, be they
+ * implied, expressed, or statutory.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * http://www.FreeRTOS.org
+ * http://www.FreeRTOS.org/FreeRTOS-Plus
+ *
+ */
+
+/* Standard includes. */
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* FreeRTOS IO library includes. */
+#include "FreeRTOS_IO.h"
+#include "FreeRTOS_CAN_Layer.h"
+#include "FreeRTOS_CAN_Subscriber.h"
+
+#if ( ioconfigINCLUDE_CAN == 1 ) && ( ioconfigUSE_CAN_SUBSCRIBERS == 1 )
+
+/* The number of standard IDs, each of which has its own entry in the
+subscription table of a controller. */
+#define subNUM_STD_IDS					( 2048UL )
+#define subSTD_ID_MASK					( 0x7FFUL )
+#define subEXT_ID_MASK					( 0x1FFFFFFFUL )
+
+/* The number of extended IDs that can be subscribed to without a mask on each
+controller, and the number of slots in the open addressed hash table that finds
+them - twice as many, so the table never fills.  An empty slot holds
+subNO_EXT_ID, which is not a valid 29 bit ID. */
+#define subMAX_EXT_IDS					( 64U )
+#define subEXT_ID_SLOTS					( 128U )
+#define subNO_EXT_ID					( 0xFFFFFFFFUL )
+#define subEXT_ID_HASH( ulID )			( ( ( ( ulID ) * 2654435761UL ) >> 16UL ) & ( subEXT_ID_SLOTS - 1UL ) )
+
+/* The number of extended ID subscriptions with a partial mask on each
+controller.  These are checked one by one against every extended frame. */
+#define subMAX_MASKED_EXT_SUBSCRIPTIONS	( 8U )
+
+struct xCAN_SUBSCRIBER;
+
+/* An extended ID in the hash table of a subscription table, or an extended ID
+subscription with a partial mask, and the subscribers it is delivered to. */
+typedef struct xCAN_EXT_ID_SLOT
+{
+	uint32_t ulID;
+	uint8_t ucSubscribers;
+} CAN_Ext_ID_Slot_t;
+
+typedef struct xCAN_MASKED_EXT_SUBSCRIPTION
+{
+	uint32_t ulID;
+	uint32_t ulMask;
+	uint8_t ucSubscribers;
+} CAN_Masked_Ext_Subscription_t;
+
+/* The subscribers created on one CAN controller, and their subscriptions.  A
+frame that matches any subscription must not also reach the controller's own
+reader, so the subscribers on a controller share a single layer, which looks
+the frame up once for all of them.  Each subscriber is given one bit of a
+uint8_t, and every entry holds the bits of the subscribers it is delivered to.
+A standard ID indexes ucStdSubscribers[] directly, with a subscription that has
+a partial mask setting its bit in every entry it matches, and an extended ID is
+found in xExtIDs[] in a few probes, so finding the subscribers of a frame costs
+the same however many subscriptions there are.  A table is created by the first
+FreeRTOS_CAN_Subscriber_open() on its controller, freed when its last
+subscriber is released, and only changed from within a critical section. */
+typedef struct xCAN_SUBSCRIPTION_TABLE
+{
+	struct xCAN_SUBSCRIPTION_TABLE *pxNext;	/* The next table in the list of tables. */
+	Peripheral_Descriptor_t xCAN;			/* The controller the table is a layer on. */
+	CAN_Layer_t xLayer;
+	struct xCAN_SUBSCRIBER *pxSubscribers[ diCAN_MAX_SUBSCRIBERS ];
+	unsigned portBASE_TYPE uxSubscribers;
+	uint8_t ucStdSubscribers[ subNUM_STD_IDS ];
+	CAN_Ext_ID_Slot_t xExtIDs[ subEXT_ID_SLOTS ];
+	uint16_t usExtIDs;						/* The number of slots in xExtIDs[] in use. */
+	CAN_Masked_Ext_Subscription_t xMaskedExtSubscriptions[ subMAX_MASKED_EXT_SUBSCRIPTIONS ];
+	uint8_t ucMaskedExtSubscriptions;
+} CAN_Subscription_Table_t;
+
+/* The state of one subscriber, which also holds the handle returned by
+FreeRTOS_CAN_Subscriber_open().  The CAN interrupt writes the frames the
+subscriber has subscribed to into pxFrames.  The ISR is the only writer of
+usNextWriteIndex and the reading task is the only writer of usNextReadIndex, so
+frames can be added and removed without entering a critical section.  One slot
+is always left empty so a full queue can be distinguished from an empty
+queue. */
+typedef struct xCAN_SUBSCRIBER
+{
+	Peripheral_Control_t xControl;			/* The handle returned by FreeRTOS_CAN_Subscriber_open(). */
+	CAN_Subscription_Table_t *pxTable;
+	uint8_t ucBit;							/* The bit that stands for the subscriber in pxTable. */
+	xSemaphoreHandle xNewFrameSemaphore;	/* Given by the ISR each time it adds a frame to the queue. */
+	CAN_MSG_Type *pxFrames;					/* The frame storage area, or NULL until the subscriber is configured. */
+	uint16_t usQueueLength;					/* The number of slots in pxFrames - one more than the number of frames the queue can hold. */
+	volatile uint16_t usNextWriteIndex;
+	volatile uint16_t usNextReadIndex;
+	portTickType xBlockTime;				/* The amount of time a task should be held in the Blocked state to wait for frames to arrive when it attempts a read. */
+	CAN_Subscriber_Statistics_t xStatistics;
+} CAN_Subscriber_t;
+
+#define prvSUBSCRIBER( pxPeripheral ) ( ( CAN_Subscriber_t * ) diGET_DEVICE_STATE( ( ( Peripheral_Control_t * const ) pxPeripheral ) ) )
+
+/*-----------------------------------------------------------*/
+
+/*
+ * The write, read and ioctl functions of the handle returned by
+ * FreeRTOS_CAN_Subscriber_open().
+ */
+static size_t prvSubscriberWrite( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes );
+static size_t prvSubscriberRead( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes );
+static portBASE_TYPE prvSubscriberIoctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue );
+
+/*
+ * Give a subscriber a bit in the subscription table of its controller,
+ * creating the table, and adding its layer to the controller, if the
+ * subscriber is the first on the controller.
+ */
+static portBASE_TYPE prvJoinTable( CAN_Subscriber_t * const pxSubscriber, Peripheral_Descriptor_t const xCAN );
+
+/*
+ * Take a subscriber, and all its subscriptions, out of its subscription
+ * table, freeing the table, and removing its layer from the controller, if the
+ * subscriber was the last on the controller.
+ */
+static void prvLeaveTable( CAN_Subscriber_t * const pxSubscriber );
+
+/*
+ * The subscription table of the controller xCAN, or NULL if it has none.
+ * Called from within a critical section.
+ */
+static CAN_Subscription_Table_t *prvFindTable( Peripheral_Descriptor_t const xCAN );
+
+/*
+ * Give a subscriber an empty queue of the configured length and no
+ * subscriptions.
+ */
+static portBASE_TYPE prvConfigure( CAN_Subscriber_t * const pxSubscriber, const CAN_Subscriber_Config_t * const pxConfig );
+
+/*
+ * Take a subscriber out of its subscription table, then free it.
+ */
+static void prvRelease( CAN_Subscriber_t * const pxSubscriber );
+
+/*
+ * Add a subscription to, or remove every subscription of, the subscriber whose
+ * bit in pxTable is ucBit.  Must be called from within a critical section.
+ */
+static portBASE_TYPE prvAddSubscription( CAN_Subscription_Table_t * const pxTable, const uint8_t ucBit, const CAN_Subscription_t * const pxSubscription );
+static void prvClearSubscriptions( CAN_Subscription_Table_t * const pxTable, const uint8_t ucBit );
+
+/*
+ * Empty a slot of the extended ID hash table, moving back any later entries
+ * that would otherwise no longer be found.
+ */
+static void prvRemoveExtIDSlot( CAN_Subscription_Table_t * const pxTable, uint32_t ulSlot );
+
+/*
+ * The Rx function of the layer of a subscription table.  Copies the frame
+ * into the queue of every subscriber whose subscriptions match it, and returns
+ * pdTRUE if any did.  Called from the CAN interrupt.
+ */
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*-----------------------------------------------------------*/
+
+/* The subscription tables that have at least one subscriber.  Only changed by
+tasks, from within a critical section. */
+static CAN_Subscription_Table_t *pxTables = NULL;
+
+/*-----------------------------------------------------------*/
+
+Peripheral_Descriptor_t FreeRTOS_CAN_Subscriber_open( Peripheral_Descriptor_t const xCAN )
+{
+const Peripheral_Control_t * const pxCANControl = ( const Peripheral_Control_t * ) xCAN;
+CAN_Subscriber_t *pxSubscriber;
+Peripheral_Control_t *pxReturn = NULL;
+
+	configASSERT( xCAN );
+
+	pxSubscriber = pvPortMalloc( sizeof( CAN_Subscriber_t ) );
+
+	if( pxSubscriber != NULL )
+	{
+		memset( pxSubscriber, 0x00, sizeof( CAN_Subscriber_t ) );
+		pxSubscriber->xBlockTime = portMAX_DELAY;
+
+		vSemaphoreCreateBinary( pxSubscriber->xNewFrameSemaphore );
+
+		if( ( pxSubscriber->xNewFrameSemaphore != NULL ) && ( prvJoinTable( pxSubscriber, xCAN ) == pdPASS ) )
+		{
+			/* The semaphore is created in the given state. */
+			xSemaphoreTake( pxSubscriber->xNewFrameSemaphore, 0U );
+
+			/* The handle is used with FreeRTOS_read() and FreeRTOS_ioctl()
+			just as the handle of a peripheral is, and shares the name and
+			number of the controller. */
+			pxReturn = &( pxSubscriber->xControl );
+			pxReturn->write = prvSubscriberWrite;
+			pxReturn->read = prvSubscriberRead;
+			pxReturn->ioctl = prvSubscriberIoctl;
+			pxReturn->pxDevice = pxCANControl->pxDevice;
+			pxReturn->cPeripheralNumber = pxCANControl->cPeripheralNumber;
+			pxReturn->pvDeviceState = ( void * ) pxSubscriber;
+		}
+		else
+		{
+			if( pxSubscriber->xNewFrameSemaphore != NULL )
+			{
+				vQueueDelete( pxSubscriber->xNewFrameSemaphore );
+			}
+
+			vPortFree( pxSubscriber );
+		}
+	}
+
+	return ( Peripheral_Descriptor_t ) pxReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvSubscriberWrite( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes )
+{
+	/* Frames are sent through the controller itself. */
+	( void ) pxPeripheral;
+	( void ) pvBuffer;
+	( void ) xBytes;
+
+	return 0U;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvSubscriberRead( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes )
+{
+CAN_Subscriber_t * const pxSubscriber = prvSUBSCRIBER( pxPeripheral );
+CAN_MSG_Type * const pxFrames = ( CAN_MSG_Type * ) pvBuffer;
+const size_t xFramesToRead = xBytes / sizeof( CAN_MSG_Type );
+size_t xFramesRead = 0U;
+uint16_t usReadIndex;
+portTickType xTicksToWait;
+xTimeOutType xTimeOut;
+
+	/* pvBuffer points to an array of CAN_MSG_Type structures.  As with the
+	Rx frame queue of a controller, only one task may read from a subscriber at
+	a time. */
+	if( pxSubscriber->pxFrames != NULL )
+	{
+		xTicksToWait = pxSubscriber->xBlockTime;
+		vTaskSetTimeOutState( &xTimeOut );
+		usReadIndex = pxSubscriber->usNextReadIndex;
+
+		for( ;; )
+		{
+			/* Copy out as many of the requested frames as are already queued.
+			The semaphore is only waited on when the queue is empty, so a burst
+			of frames is drained without a kernel call per frame. */
+			while( ( xFramesRead < xFramesToRead ) && ( usReadIndex != pxSubscriber->usNextWriteIndex ) )
+			{
+				pxFrames[ xFramesRead ] = pxSubscriber->pxFrames[ usReadIndex ];
+				xFramesRead++;
+
+				usReadIndex++;
+				if( usReadIndex == pxSubscriber->usQueueLength )
+				{
+					usReadIndex = 0U;
+				}
+			}
+
+			/* Free the slots just read so the ISR can use them again. */
+			pxSubscriber->usNextReadIndex = usReadIndex;
+
+			if( xFramesRead >= xFramesToRead )
+			{
+				break;
+			}
+
+			if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+			{
+				/* Time out has expired. */
+				break;
+			}
+
+			/* Wait for the ISR to queue more frames. */
+			if( xSemaphoreTake( pxSubscriber->xNewFrameSemaphore, xTicksToWait ) != pdPASS )
+			{
+				break;
+			}
+		}
+	}
+
+	return xFramesRead * sizeof( CAN_MSG_Type );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSubscriberIoctl( Peripheral_Descriptor_t const pxPeripheral, uint32_t ulRequest, void *pvValue )
+{
+CAN_Subscriber_t * const pxSubscriber = prvSUBSCRIBER( pxPeripheral );
+portBASE_TYPE xReturn = pdPASS;
+
+	if( ulRequest == ioctlSET_CAN_SUBSCRIBER_CONFIG )
+	{
+		/* The queue is allocated from the heap, so this is done outside of
+		the critical section below. */
+		xReturn = prvConfigure( pxSubscriber, ( const CAN_Subscriber_Config_t * ) pvValue );
+	}
+	else if( ulRequest == ioctlRELEASE_CAN_SUBSCRIBER )
+	{
+		prvRelease( pxSubscriber );
+	}
+	else
+	{
+		taskENTER_CRITICAL();
+		{
+			switch( ulRequest )
+			{
+				case ioctlADD_CAN_SUBSCRIPTION :
+
+					/* A subscription that matches many standard IDs sets a bit
+					in each of their entries, which takes a while, but is only
+					done when the application sets up its subscriptions.  The
+					CAN interrupt only looks for the bits of subscribers that
+					have a queue. */
+					if( pxSubscriber->pxFrames != NULL )
+					{
+						xReturn = prvAddSubscription( pxSubscriber->pxTable, pxSubscriber->ucBit, ( const CAN_Subscription_t * ) pvValue );
+					}
+					else
+					{
+						xReturn = pdFAIL;
+					}
+					break;
+
+				case ioctlCLEAR_CAN_SUBSCRIPTIONS :
+
+					prvClearSubscriptions( pxSubscriber->pxTable, pxSubscriber->ucBit );
+					break;
+
+				case ioctlSET_RX_TIMEOUT :
+
+					pxSubscriber->xBlockTime = ( portTickType ) pvValue;
+					break;
+
+				case ioctlCLEAR_RX_BUFFER :
+
+					/* Only the reading task moves the read index. */
+					pxSubscriber->usNextReadIndex = pxSubscriber->usNextWriteIndex;
+					xSemaphoreTake( pxSubscriber->xNewFrameSemaphore, 0U );
+					break;
+
+				case ioctlGET_CAN_SUBSCRIBER_STATISTICS :
+
+					*( ( CAN_Subscriber_Statistics_t * ) pvValue ) = pxSubscriber->xStatistics;
+					break;
+
+				default :
+
+					xReturn = pdFAIL;
+					break;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvJoinTable( CAN_Subscriber_t * const pxSubscriber, Peripheral_Descriptor_t const xCAN )
+{
+CAN_Subscription_Table_t *pxTable, *pxNewTable = NULL;
+portBASE_TYPE xReturn = pdFAIL, xNewTableUsed = pdFALSE;
+uint32_t ulSlot;
+uint8_t ucBit;
+
+	taskENTER_CRITICAL();
+	{
+		pxTable = prvFindTable( xCAN );
+	}
+	taskEXIT_CRITICAL();
+
+	if( pxTable == NULL )
+	{
+		/* The first subscriber on the controller.  The table is created, and
+		its layer added through the controller's own ioctl(), outside of a
+		critical section. */
+		pxNewTable = pvPortMalloc( sizeof( CAN_Subscription_Table_t ) );
+
+		if( pxNewTable != NULL )
+		{
+			memset( pxNewTable, 0x00, sizeof( CAN_Subscription_Table_t ) );
+			pxNewTable->xCAN = xCAN;
+			pxNewTable->xLayer.pxRxFunction = prvLayerRxFromISR;
+			pxNewTable->xLayer.pxTxFunction = NULL;
+			pxNewTable->xLayer.pvContext = ( void * ) pxNewTable;
+
+			for( ulSlot = 0UL; ulSlot < subEXT_ID_SLOTS; ulSlot++ )
+			{
+				pxNewTable->xExtIDs[ ulSlot ].ulID = subNO_EXT_ID;
+			}
+
+			if( FreeRTOS_ioctl( xCAN, ioctlADD_CAN_LAYER, &( pxNewTable->xLayer ) ) != pdPASS )
+			{
+				vPortFree( pxNewTable );
+				pxNewTable = NULL;
+			}
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		/* Another task may have created a table for the controller in the
+		meantime, in which case that one is used. */
+		pxTable = prvFindTable( xCAN );
+
+		if( ( pxTable == NULL ) && ( pxNewTable != NULL ) )
+		{
+			pxNewTable->pxNext = pxTables;
+			pxTables = pxNewTable;
+			pxTable = pxNewTable;
+			xNewTableUsed = pdTRUE;
+		}
+
+		if( pxTable != NULL )
+		{
+			for( ucBit = 0U; ucBit < diCAN_MAX_SUBSCRIBERS; ucBit++ )
+			{
+				if( pxTable->pxSubscribers[ ucBit ] == NULL )
+				{
+					/* The subscriber has no subscriptions yet, so is not
+					looked at by the CAN interrupt. */
+					pxSubscriber->pxTable = pxTable;
+					pxSubscriber->ucBit = ucBit;
+					pxTable->pxSubscribers[ ucBit ] = pxSubscriber;
+					( pxTable->uxSubscribers )++;
+					xReturn = pdPASS;
+					break;
+				}
+			}
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( ( pxNewTable != NULL ) && ( xNewTableUsed == pdFALSE ) )
+	{
+		FreeRTOS_ioctl( xCAN, ioctlREMOVE_CAN_LAYER, &( pxNewTable->xLayer ) );
+		vPortFree( pxNewTable );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLeaveTable( CAN_Subscriber_t * const pxSubscriber )
+{
+CAN_Subscription_Table_t * const pxTable = pxSubscriber->pxTable;
+CAN_Subscription_Table_t **ppxTableLink;
+portBASE_TYPE xLastSubscriber = pdFALSE;
+
+	taskENTER_CRITICAL();
+	{
+		prvClearSubscriptions( pxTable, pxSubscriber->ucBit );
+		pxTable->pxSubscribers[ pxSubscriber->ucBit ] = NULL;
+		( pxTable->uxSubscribers )--;
+
+		if( pxTable->uxSubscribers == 0U )
+		{
+			for( ppxTableLink = &pxTables; *ppxTableLink != NULL; ppxTableLink = &( ( *ppxTableLink )->pxNext ) )
+			{
+				if( *ppxTableLink == pxTable )
+				{
+					*ppxTableLink = pxTable->pxNext;
+					break;
+				}
+			}
+
+			xLastSubscriber = pdTRUE;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if( xLastSubscriber != pdFALSE )
+	{
+		/* The table has no subscriptions left for the CAN interrupt to find,
+		and once the layer has been removed the CAN interrupt no longer uses
+		the table at all. */
+		FreeRTOS_ioctl( pxTable->xCAN, ioctlREMOVE_CAN_LAYER, &( pxTable->xLayer ) );
+		vPortFree( pxTable );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static CAN_Subscription_Table_t *prvFindTable( Peripheral_Descriptor_t const xCAN )
+{
+CAN_Subscription_Table_t *pxTable;
+
+	for( pxTable = pxTables; pxTable != NULL; pxTable = pxTable->pxNext )
+	{
+		if( pxTable->xCAN == xCAN )
+		{
+			break;
+		}
+	}
+
+	return pxTable;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvConfigure( CAN_Subscriber_t * const pxSubscriber, const CAN_Subscriber_Config_t * const pxConfig )
+{
+portBASE_TYPE xReturn = pdFAIL;
+CAN_MSG_Type *pxNewFrames, *pxOldFrames;
+
+	configASSERT( pxConfig );
+
+	if( pxConfig->usQueueLength > 0U )
+	{
+		/* One more slot than the requested queue length is allocated, as one
+		slot is always left empty. */
+		pxNewFrames = pvPortMalloc( ( ( size_t ) pxConfig->usQueueLength + 1U ) * sizeof( CAN_MSG_Type ) );
+
+		if( pxNewFrames != NULL )
+		{
+			taskENTER_CRITICAL();
+			{
+				/* The subscriptions go first, so the CAN interrupt no longer
+				writes to the old queue. */
+				prvClearSubscriptions( pxSubscriber->pxTable, pxSubscriber->ucBit );
+
+				pxOldFrames = pxSubscriber->pxFrames;
+				pxSubscriber->pxFrames = pxNewFrames;
+				pxSubscriber->usQueueLength = ( uint16_t ) ( pxConfig->usQueueLength + 1U );
+				pxSubscriber->usNextWriteIndex = 0U;
+				pxSubscriber->usNextReadIndex = 0U;
+				memset( &( pxSubscriber->xStatistics ), 0x00, sizeof( CAN_Subscriber_Statistics_t ) );
+				xSemaphoreTake( pxSubscriber->xNewFrameSemaphore, 0U );
+			}
+			taskEXIT_CRITICAL();
+
+			/* The ISR cannot still be using the old queue once the critical
+			section has been exited. */
+			if( pxOldFrames != NULL )
+			{
+				vPortFree( pxOldFrames );
+			}
+
+			xReturn = pdPASS;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRelease( CAN_Subscriber_t * const pxSubscriber )
+{
+	/* Once the subscriber has no bit in the table the CAN interrupt no longer
+	uses it. */
+	prvLeaveTable( pxSubscriber );
+
+	vQueueDelete( pxSubscriber->xNewFrameSemaphore );
+
+	if( pxSubscriber->pxFrames != NULL )
+	{
+		vPortFree( pxSubscriber->pxFrames );
+	}
+
+	vPortFree( pxSubscriber );
+}
+/*-----------------------------------------------------------*/
+static portBASE_TYPE prvAddSubscription( CAN_Subscription_Table_t * const pxTable, const uint8_t ucBit, const CAN_Subscription_t * const pxSubscription )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint8_t ucSubscriberBit = ( uint8_t ) ( 1U << ucBit );
+uint32_t ulID, ulMask, ulSlot;
+uint8_t ucEntry;
+
+	configASSERT( pxSubscription );
+
+	if( pxSubscription->ucFormat == STD_ID_FORMAT )
+	{
+		ulID = pxSubscription->ulID & subSTD_ID_MASK;
+		ulMask = pxSubscription->ulMask & subSTD_ID_MASK;
+
+		if( ulMask == subSTD_ID_MASK )
+		{
+			pxTable->ucStdSubscribers[ ulID ] |= ucSubscriberBit;
+		}
+		else
+		{
+			/* Set the subscriber's bit in the entry of every ID the mask
+			matches, so the ISR never has to look at the mask. */
+			for( ulSlot = 0UL; ulSlot < subNUM_STD_IDS; ulSlot++ )
+			{
+				if( ( ( ulSlot ^ ulID ) & ulMask ) == 0UL )
+				{
+					pxTable->ucStdSubscribers[ ulSlot ] |= ucSubscriberBit;
+				}
+			}
+		}
+
+		xReturn = pdPASS;
+	}
+	else if( pxSubscription->ucFormat == EXT_ID_FORMAT )
+	{
+		ulID = pxSubscription->ulID & subEXT_ID_MASK;
+		ulMask = pxSubscription->ulMask & subEXT_ID_MASK;
+
+		if( ulMask == subEXT_ID_MASK )
+		{
+			/* Look for the ID, stopping at the first empty slot, where the ID
+			is added if it is not already in the table. */
+			ulSlot = subEXT_ID_HASH( ulID );
+
+			while( ( pxTable->xExtIDs[ ulSlot ].ulID != subNO_EXT_ID ) && ( pxTable->xExtIDs[ ulSlot ].ulID != ulID ) )
+			{
+				ulSlot = ( ulSlot + 1UL ) & ( subEXT_ID_SLOTS - 1UL );
+			}
+
+			if( pxTable->xExtIDs[ ulSlot ].ulID == ulID )
+			{
+				pxTable->xExtIDs[ ulSlot ].ucSubscribers |= ucSubscriberBit;
+				xReturn = pdPASS;
+			}
+			else if( pxTable->usExtIDs < subMAX_EXT_IDS )
+			{
+				pxTable->xExtIDs[ ulSlot ].ucSubscribers = ucSubscriberBit;
+				pxTable->xExtIDs[ ulSlot ].ulID = ulID;
+				( pxTable->usExtIDs )++;
+				xReturn = pdPASS;
+			}
+		}
+		else
+		{
+			/* Subscriptions with the same ID and mask share an entry. */
+			for( ucEntry = 0U; ucEntry < pxTable->ucMaskedExtSubscriptions; ucEntry++ )
+			{
+				if( ( pxTable->xMaskedExtSubscriptions[ ucEntry ].ulMask == ulMask ) && ( pxTable->xMaskedExtSubscriptions[ ucEntry ].ulID == ( ulID & ulMask ) ) )
+				{
+					break;
+				}
+			}
+
+			if( ucEntry < pxTable->ucMaskedExtSubscriptions )
+			{
+				pxTable->xMaskedExtSubscriptions[ ucEntry ].ucSubscribers |= ucSubscriberBit;
+				xReturn = pdPASS;
+			}
+			else if( ucEntry < subMAX_MASKED_EXT_SUBSCRIPTIONS )
+			{
+				pxTable->xMaskedExtSubscriptions[ ucEntry ].ulID = ulID & ulMask;
+				pxTable->xMaskedExtSubscriptions[ ucEntry ].ulMask = ulMask;
+				pxTable->xMaskedExtSubscriptions[ ucEntry ].ucSubscribers = ucSubscriberBit;
+				( pxTable->ucMaskedExtSubscriptions )++;
+				xReturn = pdPASS;
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvClearSubscriptions( CAN_Subscription_Table_t * const pxTable, const uint8_t ucBit )
+{
+const uint8_t ucKeepBits = ( uint8_t ) ~( 1U << ucBit );
+uint32_t ulSlot;
+uint8_t ucEntry = 0U;
+
+	for( ulSlot = 0UL; ulSlot < subNUM_STD_IDS; ulSlot++ )
+	{
+		pxTable->ucStdSubscribers[ ulSlot ] &= ucKeepBits;
+	}
+
+	/* An extended ID no subscriber is left subscribed to gives up its slot.
+	Removing it can move a later entry into the slot, so the slot is checked
+	again. */
+	for( ulSlot = 0UL; ulSlot < subEXT_ID_SLOTS; ulSlot++ )
+	{
+		pxTable->xExtIDs[ ulSlot ].ucSubscribers &= ucKeepBits;
+
+		while( ( pxTable->xExtIDs[ ulSlot ].ulID != subNO_EXT_ID ) && ( pxTable->xExtIDs[ ulSlot ].ucSubscribers == 0U ) )
+		{
+			prvRemoveExtIDSlot( pxTable, ulSlot );
+			pxTable->xExtIDs[ ulSlot ].ucSubscribers &= ucKeepBits;
+		}
+	}
+
+	/* Masked subscriptions are kept packed at the start of the array. */
+	while( ucEntry < pxTable->ucMaskedExtSubscriptions )
+	{
+		pxTable->xMaskedExtSubscriptions[ ucEntry ].ucSubscribers &= ucKeepBits;
+
+		if( pxTable->xMaskedExtSubscriptions[ ucEntry ].ucSubscribers == 0U )
+		{
+			( pxTable->ucMaskedExtSubscriptions )--;
+			pxTable->xMaskedExtSubscriptions[ ucEntry ] = pxTable->xMaskedExtSubscriptions[ pxTable->ucMaskedExtSubscriptions ];
+		}
+		else
+		{
+			ucEntry++;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvRemoveExtIDSlot( CAN_Subscription_Table_t * const pxTable, uint32_t ulSlot )
+{
+const uint32_t ulSlotMask = subEXT_ID_SLOTS - 1UL;
+uint32_t ulNext = ulSlot, ulHome;
+
+	/* The table uses linear probing, so an entry further along the run that
+	started at or before the emptied slot must move back into it, or a look up
+	would stop at the gap before reaching the entry. */
+	for( ;; )
+	{
+		ulNext = ( ulNext + 1UL ) & ulSlotMask;
+
+		if( pxTable->xExtIDs[ ulNext ].ulID == subNO_EXT_ID )
+		{
+			break;
+		}
+
+		/* The distance from the entry's home slot to where it is stored, and
+		to the emptied slot.  If the emptied slot is no further from the home
+		slot, the entry can be moved into it. */
+		ulHome = subEXT_ID_HASH( pxTable->xExtIDs[ ulNext ].ulID );
+
+		if( ( ( ulSlot - ulHome ) & ulSlotMask ) < ( ( ulNext - ulHome ) & ulSlotMask ) )
+		{
+			pxTable->xExtIDs[ ulSlot ] = pxTable->xExtIDs[ ulNext ];
+			ulSlot = ulNext;
+		}
+	}
+
+	pxTable->xExtIDs[ ulSlot ].ulID = subNO_EXT_ID;
+	pxTable->xExtIDs[ ulSlot ].ucSubscribers = 0U;
+	( pxTable->usExtIDs )--;
+}
+/*-----------------------------------------------------------*/
+
+
+static portBASE_TYPE prvLayerRxFromISR( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+const CAN_Subscription_Table_t * const pxTable = ( const CAN_Subscription_Table_t * ) pxLayer->pvContext;
+CAN_Subscriber_t *pxSubscriber;
+uint32_t ulSlot, ulSubscribers = 0UL, ulBit;
+uint16_t usWriteIndex, usNextWriteIndex;
+uint8_t ucEntry;
+
+	if( pxFrame->format == STD_ID_FORMAT )
+	{
+		ulSubscribers = pxTable->ucStdSubscribers[ pxFrame->id & subSTD_ID_MASK ];
+	}
+	else
+	{
+		ulSlot = subEXT_ID_HASH( pxFrame->id );
+
+		while( pxTable->xExtIDs[ ulSlot ].ulID != subNO_EXT_ID )
+		{
+			if( pxTable->xExtIDs[ ulSlot ].ulID == pxFrame->id )
+			{
+				ulSubscribers = pxTable->xExtIDs[ ulSlot ].ucSubscribers;
+				break;
+			}
+
+			ulSlot = ( ulSlot + 1UL ) & ( subEXT_ID_SLOTS - 1UL );
+		}
+
+		for( ucEntry = 0U; ucEntry < pxTable->ucMaskedExtSubscriptions; ucEntry++ )
+		{
+			if( ( pxFrame->id & pxTable->xMaskedExtSubscriptions[ ucEntry ].ulMask ) == pxTable->xMaskedExtSubscriptions[ ucEntry ].ulID )
+			{
+				ulSubscribers |= pxTable->xMaskedExtSubscriptions[ ucEntry ].ucSubscribers;
+			}
+		}
+	}
+
+	/* Only the subscribers the frame is for are woken. */
+	for( ulBit = 0UL; ( ulSubscribers >> ulBit ) != 0UL; ulBit++ )
+	{
+		if( ( ulSubscribers & ( 1UL << ulBit ) ) != 0UL )
+		{
+			pxSubscriber = pxTable->pxSubscribers[ ulBit ];
+
+			usWriteIndex = pxSubscriber->usNextWriteIndex;
+			usNextWriteIndex = usWriteIndex + 1U;
+			if( usNextWriteIndex == pxSubscriber->usQueueLength )
+			{
+				usNextWriteIndex = 0U;
+			}
+
+			if( usNextWriteIndex != pxSubscriber->usNextReadIndex )
+			{
+				pxSubscriber->pxFrames[ usWriteIndex ] = *pxFrame;
+				pxSubscriber->usNextWriteIndex = usNextWriteIndex;
+				( pxSubscriber->xStatistics.ulFramesQueued )++;
+				xSemaphoreGiveFromISR( pxSubscriber->xNewFrameSemaphore, pxHigherPriorityTaskWoken );
+			}
+			else
+			{
+				( pxSubscriber->xStatistics.ulOverruns )++;
+			}
+		}
+	}
+
+	return ( ulSubscribers != 0UL ) ? pdTRUE : pdFALSE;
+}
+
+#endif /* ioconfigUSE_CAN_SUBSCRIBERS */
+
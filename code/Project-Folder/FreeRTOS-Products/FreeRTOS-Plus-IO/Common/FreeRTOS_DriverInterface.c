@@ -107,6 +107,7 @@ Peripheral_Control_t *pxPeripheralControl = NULL;
 			pxPeripheralControl->pxRxControl = NULL;
 			pxPeripheralControl->pxDevice = &( xAvailablePeripherals[ xIndex ] );
 			pxPeripheralControl->cPeripheralNumber = cPeripheralNumber;
+			pxPeripheralControl->pvDeviceState = NULL;
 
 			/* Initialise the peripheral specific parts of the control
 			structure, and call the peripheral specific open function. */
@@ -200,7 +201,7 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 
 		case ioctlSET_TX_TIMEOUT 	:
 
-			if( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_CHARACTER_QUEUE_TX )
+			if( ( pxPeripheralControl->pxTxControl != NULL ) && ( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_CHARACTER_QUEUE_TX ) )
 			{
 				#if ( ioconfigUSE_TX_CHAR_QUEUE == 1 )
 				{
@@ -211,14 +212,25 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 			}
 			else
 			{
-				/* There is nothing to do here as xReturn is already pdFAIL. */
+				/* The Tx transfer method might be one that is specific to the
+				peripheral, in which case the peripheral must handle the
+				request. */
+				xCommandIsDeviceSpecific = pdTRUE;
+				xReturn = pdPASS;
 			}
 			break;
 
 
 		case ioctlSET_RX_TIMEOUT	:
 
-			if( pxPeripheralControl->pxRxControl->ucType == ioctlUSE_CIRCULAR_BUFFER_RX )
+			if( pxPeripheralControl->pxRxControl == NULL )
+			{
+				/* The peripheral has no Rx transfer method the generic code
+				knows about, so must handle the request itself. */
+				xCommandIsDeviceSpecific = pdTRUE;
+				xReturn = pdPASS;
+			}
+			else if( pxPeripheralControl->pxRxControl->ucType == ioctlUSE_CIRCULAR_BUFFER_RX )
 			{
 				#if ioconfigUSE_CIRCULAR_BUFFER_RX == 1
 				{
@@ -238,7 +250,11 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 			}
 			else
 			{
-				/* Nothing to do here as xReturn is already pdFAIL. */
+				/* The Rx transfer method might be one that is specific to the
+				peripheral, in which case the peripheral must handle the
+				request. */
+				xCommandIsDeviceSpecific = pdTRUE;
+				xReturn = pdPASS;
 			}
 			break;
 
@@ -250,7 +266,12 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 
 			xReturn = pdTRUE;
 
-			if( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_ZERO_COPY_TX )
+			if( pxPeripheralControl->pxTxControl == NULL )
+			{
+				/* No Tx transfer method has been set, so there is nothing to
+				wait for. */
+			}
+			else if( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_ZERO_COPY_TX )
 			{
 				#if ioconfigUSE_ZERO_COPY_TX == 1
 				{
@@ -286,7 +307,7 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 
 			#if ioconfigUSE_ZERO_COPY_TX == 1
 			{
-				if( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_ZERO_COPY_TX )
+				if( ( pxPeripheralControl->pxTxControl != NULL ) && ( pxPeripheralControl->pxTxControl->ucType == ioctlUSE_ZERO_COPY_TX ) )
 				{
 						/* Give back the write mutex, if it is held. */
 						xReturn = xIOUtilsReleaseZeroCopyWriteMutex( pxPeripheralControl );
@@ -298,7 +319,14 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 
 		case ioctlCLEAR_RX_BUFFER :
 
-			if( pxPeripheralControl->pxRxControl->ucType == ioctlUSE_CIRCULAR_BUFFER_RX )
+			if( pxPeripheralControl->pxRxControl == NULL )
+			{
+				/* The peripheral has no Rx transfer method the generic code
+				knows about, so must handle the request itself. */
+				xCommandIsDeviceSpecific = pdTRUE;
+				xReturn = pdPASS;
+			}
+			else if( pxPeripheralControl->pxRxControl->ucType == ioctlUSE_CIRCULAR_BUFFER_RX )
 			{
 				#if ioconfigUSE_CIRCULAR_BUFFER_RX == 1
 				{
@@ -318,7 +346,10 @@ portBASE_TYPE xReturn = pdFAIL, xCommandIsDeviceSpecific = pdFALSE;
 			}
 			else
 			{
-				/* Nothing to do here as xReturn is already set to pdFAIL; */
+				/* As per ioctlSET_RX_TIMEOUT, pass the request on to the
+				peripheral in case it is using its own Rx transfer method. */
+				xCommandIsDeviceSpecific = pdTRUE;
+				xReturn = pdPASS;
 			}
 			break;
 
@@ -35,357 +35,5673 @@
  *
  */
 
+/* Standard includes. */
+#include <string.h>
+
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "timers.h"
 
 /* IO library includes. */
 #include "FreeRTOS_IO.h"
 #include "IOUtils_Common.h"
 #include "FreeRTOS_can.h"
+#include "FreeRTOS_CAN_Layer.h"
 #include "uart.h"
 
 /* Hardware setup peripheral driver includes.  The includes for the CAN itself
 is already included from FreeRTOS_IO_BSP.h. */
 #include "lpc17xx_pinsel.h"
+#include "lpc17xx_clkpwr.h"
 
 //Check out what all needs to be added in terms of the setup for the CAN Protocol, if anything at all
 
 
 
 
-/* Stores the IRQ numbers of the supported CAN ports. */
-//static const IRQn_Type xIRQ[] = { CAN_IRQn, CANActivity_IRQn };
+/* CAN peripherals are numbered from 1 ("/CAN1/" and "/CAN2/"), whereas the
+arrays that hold per peripheral data are indexed from 0. */
+#define canPERIPHERAL_INDEX( cPeripheralNumber )	( ( cPeripheralNumber ) - 1 )
 
-/*Structures used to store Rx and Tx CAN Frames*/
+/* The index into the same arrays of the controller at address pxCAN. */
+#define canCONTROLLER_INDEX( pxCAN )				( ( ( pxCAN ) == LPC_CAN1 ) ? 0U : 1U )
 
-static CAN_MSG_Type CAN_TxMsg,CAN_RxMsg;
-static xSemaphoreHandle xSemaphore_irq;
-static uint8_t enable_irq = 0;
-void CAN_IRQHandler(void);
+/*-----------------------------------------------------------*/
 
-/*------------------------------- CAN_open ----------------------------------------*/
+/* The transfer structure used when received frames are placed into a queue by
+the CAN interrupt.  The ISR is the only writer of usNextWriteIndex and the
+reading task is the only writer of usNextReadIndex, so frames can be added and
+removed without entering a critical section.  One slot is always left empty so
+a full queue can be distinguished from an empty queue. */
+typedef struct xCAN_FRAME_QUEUE_RX_STATE
+{
+	xSemaphoreHandle xNewFrameSemaphore;	/* Given by the ISR each time it adds frames to the queue. */
+	CAN_MSG_Type *pxFrames;					/* The start address of the frame storage area. */
+	uint16_t usQueueLength;					/* The number of slots in pxFrames - one more than the number of frames the queue can hold. */
+	volatile uint16_t usNextWriteIndex;		/* Index into pxFrames to which the ISR will write the next received frame. */
+	volatile uint16_t usNextReadIndex;		/* Index into pxFrames from which the next frame will be read. */
+	portTickType xBlockTime;				/* The amount of time a task should be held in the Blocked state to wait for frames to arrive when it attempts a read. */
+	volatile uint32_t ulOverrunCount;		/* The number of received frames that were discarded because the queue was full. */
+} CAN_Frame_Queue_Rx_State_t;
 
-portBASE_TYPE FreeRTOS_CAN_open( Peripheral_Control_t * const pxPeripheralControl )
+/* The high priority Rx frame queue set by ioctlSET_CAN_RX_PRIORITY, allocated
+together with its ranges of IDs and its frame storage.  The controller's Rx
+frame queue becomes the low priority queue.  The high priority queue has no
+semaphore of its own - the ISR gives that of the low priority queue when it adds
+frames to either, so a task blocked in read() is woken by both. */
+typedef struct xCAN_RX_PRIORITY_STATE
 {
-PINSEL_CFG_Type xPinConfig;
-LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( pxPeripheralControl );
-portBASE_TYPE xReturn;
-const uint8_t cPeripheralNumber = diGET_PERIPHERAL_NUMBER( pxPeripheralControl );
-vSemaphoreCreateBinary( xSemaphore_irq );
+	CAN_Frame_Queue_Rx_State_t xHighQueue;
+	CAN_Filter_Entry_t *pxRanges;			/* The IDs queued in xHighQueue. */
+	uint16_t usNumberOfRanges;
+	uint8_t ucHighOverflowPolicy;			/* diCAN_RX_DROP_NEWEST or diCAN_RX_DROP_OLDEST. */
+	uint8_t ucLowOverflowPolicy;
+	CAN_Rx_Priority_Statistics_t xStatistics;
+} CAN_Rx_Priority_State_t;
 
-	/* Sanity check the peripheral number. */
-	if( cPeripheralNumber <= boardNUM_CANS )
-	{
-		pxPeripheralControl->read = FreeRTOS_CAN_read;
-		pxPeripheralControl->write = FreeRTOS_CAN_write;
-		pxPeripheralControl->ioctl = FreeRTOS_CAN_ioctl;
+/* The layout of the acceptance filter look up table entries.  Standard ID
+entries are 16 bits, holding the controller number, a disable bit, an unused
+bit and the 11 bit ID.  Extended ID entries are 32 bits, holding the controller
+number and the 29 bit ID. */
+#define canAF_STD_ENTRY_MASK			( 0xE7FFUL )
+#define canAF_STD_CONTROLLER_SHIFT		( 13UL )
+#define canAF_EXT_CONTROLLER_SHIFT		( 29UL )
+#define canAF_CONTROLLER_MASK			( 0x07UL )
 
+/* The size of the acceptance filter look up table, and the number of words of
+it used by each FullCAN message object. */
+#define canAF_LUT_SIZE_WORDS			( 512UL )
+#define canAF_FULLCAN_OBJECT_WORDS		( 3UL )
 
-		/* Setup the pins for the CAN being used. */
-		taskENTER_CRITICAL();
-		{
-			boardCONFIGURE_CAN_PINS( cPeripheralNumber, xPinConfig );
-			
-			/* Set up the default CAN configuration. */
-			CAN_Init( pxCAN,boardDEFAULT_CAN_BAUD );//Setting CAN to 125000bps
-			//Self-test mode selected
-			//CAN_ModeConfig(pxCAN, CAN_SELFTEST_MODE, ENABLE);
-			
-			//Acceptance filter bypassed
-			CAN_SetAFMode (LPC_CANAF, CAN_AccBP);
+/* The maximum number of FullCAN message objects, and the number of objects
+covered by each of the FCANIC0 and FCANIC1 registers. */
+#define canMAX_FULLCAN_OBJECTS			( 64UL )
+#define canFULLCAN_OBJECTS_PER_WORD		( 32UL )
 
-		}
-		taskEXIT_CRITICAL();
-		xReturn = pdPASS;
-	}
-	else
-	{
-		xReturn = pdFAIL;
-	}
+/* The number of hardware Tx buffers in each CAN controller. */
+#define canNUM_TX_BUFFERS	( 3 )
 
-	return xReturn;
-}
+/* The number of payload bytes carried by a frame.  A DLC above 8 still means 8
+bytes. */
+#define canMAX_PAYLOAD_BYTES			( 8U )
+#define canDLC_TO_BYTES( ucDLC )		( ( ( ucDLC ) > canMAX_PAYLOAD_BYTES ) ? canMAX_PAYLOAD_BYTES : ( ucDLC ) )
 
-/*----------------------------------- CAN_write ------------------------------------------*/
+/* The delay before a controller that has gone bus-off is restarted.  The delay
+doubles, up to the maximum, each time the controller goes bus-off again before
+its error counters have dropped back below the warning limit. */
+#define canBUS_OFF_MIN_BACK_OFF			( ( portTickType ) 10 / portTICK_RATE_MS )
+#define canBUS_OFF_MAX_BACK_OFF			( ( portTickType ) 1000 / portTICK_RATE_MS )
 
-size_t FreeRTOS_CAN_write( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes )
+/* The error code captured in bits 23:22 of the interrupt capture register when
+a bus error occurs. */
+#define canICR_ERRC( ulICR )			( ( ( ulICR ) >> 22UL ) & 0x03UL )
+#define canERRC_BIT_ERROR				( 0UL )
+#define canERRC_FORM_ERROR				( 1UL )
+#define canERRC_STUFF_ERROR				( 2UL )
+
+/* The transmit and receive error counters in the global status register. */
+#define canGSR_TXERR( ulGSR )			( ( uint8_t ) ( ( ulGSR ) >> 24UL ) )
+#define canGSR_RXERR( ulGSR )			( ( uint8_t ) ( ( ulGSR ) >> 16UL ) )
+
+/* The limits of the bit timing, in time quanta.  A bit is the synchronisation
+segment (one time quantum), TSEG1 (the propagation segment and phase segment 1)
+and TSEG2 (phase segment 2).  TSEG2 is kept to at least the two time quanta of
+the information processing time, and TSEG1 is kept longer than the SJW, as
+phase segment 1 must be at least as long as the SJW and the propagation
+segment at least one time quantum. */
+#define canMIN_TQ_PER_BIT				( 8UL )
+#define canMAX_TQ_PER_BIT				( 25UL )
+#define canMAX_TSEG1					( 16UL )
+#define canMIN_TSEG2					( 2UL )
+#define canMAX_TSEG2					( 8UL )
+#define canMAX_SJW						( 4UL )
+#define canMAX_PRESCALER				( 1024UL )
+#define canMAX_BIT_RATE					( 1000000UL )
+
+/* The furthest the bit rate set can be from the bit rate requested, in parts
+per million.  Nodes further apart than this lose synchronisation long before
+the oscillator tolerance of the other nodes is taken into account. */
+#define canMAX_BIT_RATE_ERROR_PPM		( 5000UL )
+
+/* The fields of the bus timing register, each of which holds one less than its
+value. */
+#define canBTR( ulPrescaler, ulTSEG1, ulTSEG2, ulSJW )	( ( ( ulPrescaler ) - 1UL ) | ( ( ( ulSJW ) - 1UL ) << 14UL ) | ( ( ( ulTSEG1 ) - 1UL ) << 16UL ) | ( ( ( ulTSEG2 ) - 1UL ) << 20UL ) )
+#define canBTR_PRESCALER( ulBTR )		( ( ( ulBTR ) & 0x3FFUL ) + 1UL )
+#define canBTR_SJW( ulBTR )				( ( ( ( ulBTR ) >> 14UL ) & 0x03UL ) + 1UL )
+#define canBTR_TSEG1( ulBTR )			( ( ( ( ulBTR ) >> 16UL ) & 0x0FUL ) + 1UL )
+#define canBTR_TSEG2( ulBTR )			( ( ( ( ulBTR ) >> 20UL ) & 0x07UL ) + 1UL )
+
+/* The sample point, in tenths of a percent, of every bit timing in
+xCommonBitTimings[].  The table is only used while it is also the default
+sample point. */
+#define canCOMMON_BIT_TIMING_SAMPLE_POINT	( 875U )
+
+/* Bit rate detection moves on from a bit rate once it has seen this many bus
+errors at it.  One is allowed, as a frame that is on the bus as the bit timing
+is changed can be seen as an error at the right bit rate. */
+#define canDETECT_MAX_BUS_ERRORS		( 2UL )
+
+/* The bus errors of every type counted in a CAN_Statistics_t structure. */
+#define canBUS_ERRORS( pxStatistics )	( ( pxStatistics )->ulBitErrors + ( pxStatistics )->ulFormErrors + ( pxStatistics )->ulStuffErrors + ( pxStatistics )->ulOtherErrors )
+
+#if ( ioconfigUSE_CAN_ANALYTICS == 1 ) && ( ioconfigUSE_CAN_TIMESTAMPS != 1 )
+	#error ioconfigUSE_CAN_TIMESTAMPS must also be set to 1 if ioconfigUSE_CAN_ANALYTICS is set to 1
+#endif
+
+#if ( ioconfigUSE_CAN_TX_DEADLINES == 1 ) && ( ( ioconfigUSE_CAN_FRAME_QUEUE_TX != 1 ) || ( ioconfigUSE_CAN_TIMESTAMPS != 1 ) )
+	#error ioconfigUSE_CAN_FRAME_QUEUE_TX and ioconfigUSE_CAN_TIMESTAMPS must also be set to 1 if ioconfigUSE_CAN_TX_DEADLINES is set to 1
+#endif
+
+/* The current value of the free running timer used to timestamp frames, or 0
+if frames are not being timestamped. */
+#if ioconfigUSE_CAN_TIMESTAMPS == 1
+	#define canGET_TIMESTAMP()			( boardCAN_TIMESTAMP_TIMER->TC )
+#else
+	#define canGET_TIMESTAMP()			( 0UL )
+#endif /* ioconfigUSE_CAN_TIMESTAMPS */
+
+/* An entry in the Tx frame queue.  ulArbitrationKey orders frames the way the
+bus would - a numerically lower key wins arbitration.  ulSequenceNumber keeps
+frames that have equal keys in the order in which they were written.  The
+timestamp member of xFrame holds the frame's deadline, or 0 if it has none. */
+typedef struct xCAN_TX_QUEUE_ITEM
 {
-Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
-LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
-size_t xReturn = 0U;
-Status SendMsgReturn;
-uint8_t CANData[8] = {0}; //Temporary buffer for CAN data
-uint8_t *buffPtr =(uint8_t *)pvBuffer;
-int8_t counter=0;
-uint8_t frame_length = CAN_TxMsg.len;
-size_t index;
+	uint32_t ulArbitrationKey;
+	uint32_t ulSequenceNumber;
+	CAN_Layer_t *pxLayer;					/* The layer that sent the frame, or NULL. */
+	CAN_MSG_Type xFrame;
+} CAN_Tx_Queue_Item_t;
 
-uint8_t self_rec=0; //Make this zero if communicating between two boards
+/* The transfer structure used when frames are written to a priority ordered
+queue, from which the Tx interrupts refill the three hardware Tx buffers.  The
+queue is a binary heap with the highest priority frame at index 0.  It is
+modified by both the writing task and the ISR, so the task only accesses it
+from within a critical section. */
+typedef struct xCAN_FRAME_QUEUE_TX_STATE
+{
+	xSemaphoreHandle xSpaceAvailableSemaphore;				/* Given by the ISR each time it removes frames from the queue. */
+	CAN_Tx_Queue_Item_t *pxItems;							/* The start address of the heap storage area. */
+	uint16_t usQueueLength;									/* The maximum number of frames the queue can hold. */
+	uint16_t usFramesWaiting;								/* The number of frames currently in the queue. */
+	uint32_t ulNextSequenceNumber;							/* The sequence number to give the next frame written to the queue. */
+	uint32_t ulBufferArbitrationKeys[ canNUM_TX_BUFFERS ];	/* The key of the frame last loaded into each hardware Tx buffer. */
+	portTickType xBlockTime;								/* The amount of time a task should be held in the Blocked state to wait for space to become available when it attempts a write. */
+} CAN_Frame_Queue_Tx_State_t;
 
-for(index=0;index<frame_length;index++)
+/* The statistics kept for each ID by the analytics.  ulKey holds the ID, with
+canANALYTICS_EXT_KEY_BIT set for an extended ID. */
+typedef struct xCAN_ID_RECORD
 {
-CANData[index]=*buffPtr;
-buffPtr++;
-}
+	uint32_t ulKey;
+	uint32_t ulFrames;
+	uint32_t ulLastSeen;
+	uint32_t ulMinInterval;
+	uint32_t ulMaxInterval;
+	uint64_t ullIntervalTotal;
+	uint32_t ulJitterHistogram[ diCAN_JITTER_BUCKETS ];
+} CAN_ID_Record_t;
 
+#define canANALYTICS_EXT_KEY_BIT		( 0x80000000UL )
 
-		#if ioconfigUSE_CAN_POLLED_TX == 1
-		{
-			if(frame_length<=4)
-			{
-				for(counter=frame_length-1;counter>=0;counter--)
-				{
-					CAN_TxMsg.dataA[counter]=CANData[counter];
-				}
-			}
-			else
-			{
-				for(counter = 3;counter>=0;counter--)
-				{
-				CAN_TxMsg.dataA[counter]=CANData[counter];
-				}
+/* The analytics of a controller, allocated by ioctlSET_CAN_ANALYTICS.  The
+records are kept in the order in which their IDs were first seen, and found
+from the ISR through an open addressed hash table of record numbers, so each
+frame costs a few probes however many IDs are tracked.  The hash table has at
+least twice as many slots as there are records, so it never fills. */
+typedef struct xCAN_ANALYTICS_STATE
+{
+	CAN_ID_Record_t *pxRecords;
+	uint16_t *pusSlots;						/* Record number plus one, or 0 for an empty slot. */
+	uint16_t usMaxIDs;						/* The number of records in pxRecords. */
+	uint16_t usIDsTracked;					/* The number of records in use. */
+	uint16_t usSlotMask;					/* The number of slots in pusSlots, less one. */
+	uint32_t ulUntrackedFrames;
+	uint32_t ulFrames;						/* Frames included in ullBits. */
+	uint64_t ullBits;						/* The estimated bus time of the frames received and sent, in bits. */
+	uint32_t ulStartTime;					/* The timestamp at which the analytics were last enabled or cleared. */
+} CAN_Analytics_State_t;
 
+/* The bits of a frame that are never stuffed, the bits before the data field
+that can be stuffed, and the intermission that follows a frame. */
+#define canSTD_FRAME_FIXED_BITS			( 44UL )
+#define canEXT_FRAME_FIXED_BITS			( 64UL )
+#define canSTD_FRAME_STUFFED_BITS		( 34UL )
+#define canEXT_FRAME_STUFFED_BITS		( 54UL )
+#define canINTERMISSION_BITS			( 3UL )
 
-				for(counter=0;counter<(frame_length-4);counter++)
-					{
-						CAN_TxMsg.dataB[counter]=CANData[counter+4];
-					}
-			}
+/* The mean of ulCount intervals that add up to ullTotal, to the nearest
+timestamp unit. */
+#define canROUNDED_MEAN( ullTotal, ulCount )	( ( uint32_t ) ( ( ( ullTotal ) + ( ( uint64_t ) ( ulCount ) / 2ULL ) ) / ( uint64_t ) ( ulCount ) ) )
 
-			SendMsgReturn =	CAN_SendMsg (pxCAN,&CAN_TxMsg,self_rec);
-			if(SendMsgReturn)
-			{
-			xReturn=frame_length;
-			}
+/* The largest table of IDs ioctlSET_CAN_ANALYTICS can create. */
+#define canANALYTICS_MAX_IDS			( 2048UL )
 
+/* The cyclic Tx scheduler divides time into 1ms slots, each started by a
+match of the timer, which counts microseconds.  The timer is only programmed to
+interrupt in slots in which a message is due, so a message can be due no more
+than canCYCLIC_TX_MAX_SLOTS_AHEAD slots after the current slot. */
+#define canCYCLIC_TX_SLOT_US			( 1000UL )
+#define canCYCLIC_TX_MAX_SLOTS_AHEAD	( 0x10000UL )
 
-		}
-		#endif /* ioconfigUSE_CAN_POLLED_TX */
+/* The offsets of the messages of a table are chosen over the least common
+multiple of their periods, up to this many slots.  The slots of messages whose
+periods do not divide it are approximated by wrapping them. */
+#define canCYCLIC_TX_MAX_HYPERPERIOD	( 1000UL )
 
-	return xReturn;
-}
+/* The MR0 bit of the timer's interrupt register and match control register. */
+#define canTIMER_MR0_INTERRUPT			( 0x01UL )
 
-/*---------------------------------- CAN_read ---------------------------------------*/
+/* A message of a controller's cyclic Tx table, as copied from the table passed
+to ioctlSET_CAN_CYCLIC_TX_TABLE. */
+typedef struct xCAN_CYCLIC_TX_ENTRY
+{
+	CAN_MSG_Type xFrame;
+	CAN_Cyclic_Tx_Payload_Function_t pxPayloadFunction;
+	void *pvContext;
+	uint32_t ulNextSlot;					/* The slot in which the message is next due. */
+	uint16_t usPeriodMs;
+	uint16_t usOffsetMs;
+	uint8_t ucPending;						/* pdTRUE while the frame is due but has not yet found room in a Tx buffer or the Tx frame queue. */
+	uint32_t ulFramesSent;
+	uint32_t ulFramesMissed;
+} CAN_Cyclic_Tx_Entry_t;
 
-size_t FreeRTOS_CAN_read( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes )
+/* The cyclic Tx table of a controller, allocated with its entries by
+ioctlSET_CAN_CYCLIC_TX_TABLE.  The entries are only changed by a task from
+within a critical section. */
+typedef struct xCAN_CYCLIC_TX_SCHEDULE
 {
-Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
-LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
-size_t xReturn = 0U;
-uint64_t data=0;
-uint64_t *dataPtr=NULL;
-uint8_t displace1,displace2;
-int8_t counter=0;
-uint8_t length;
-Status RcvMsgReturn;
+	CAN_Cyclic_Tx_Entry_t *pxEntries;
+	uint16_t usEntries;
+	uint16_t usPending;						/* The number of entries with ucPending set. */
+	uint16_t usPeakFramesPerSlot;			/* The most frames due in any slot, with the offsets used. */
+} CAN_Cyclic_Tx_Schedule_t;
 
+/* The Tx confirmations of a controller, set by ioctlSET_CAN_TX_CONFIRMATION.
+xBuffers[] holds the frame last loaded into each hardware Tx buffer, and
+ulPending has bit n set while the frame in buffer n has yet to be confirmed.
+Both are only changed by the ISR, or by a task from within a critical
+section. */
+typedef struct xCAN_TX_CONFIRMATION_STATE
+{
+	xQueueHandle xQueue;					/* Read by ioctlGET_CAN_TX_CONFIRMATION, or NULL if confirmations are not queued. */
+	CAN_Tx_Confirmation_Function_t pxFunction;
+	void *pvContext;
+	portTickType xBlockTime;
+	CAN_MSG_Type xBuffers[ canNUM_TX_BUFFERS ];
+	uint32_t ulPending;
+	CAN_Tx_Confirmation_Statistics_t xStatistics;
+} CAN_Tx_Confirmation_State_t;
 
-if(enable_irq == 0)
+/* The number of frames of an ID dropped because they missed their deadlines.
+ulKey holds the ID, with canANALYTICS_EXT_KEY_BIT set for an extended ID. */
+typedef struct xCAN_TX_DEADLINE_RECORD
 {
-		#if ioconfigUSE_CAN_POLLED_RX == 1
-		{
-			RcvMsgReturn = CAN_ReceiveMsg (pxCAN,&CAN_RxMsg);
-			length = CAN_RxMsg.len;
-			if(length<=4)
-			{
-				displace1 = (length-1)*8;
-				for(counter=length-1;counter>=0;counter--)
-				{
-					data |=(((uint64_t)CAN_RxMsg.dataA[counter])<<displace1);
-					displace1 -=8;
-				}
-			}
-			else
-			{
-				displace1 = 24;
-				displace2 = (length-1)*8;
-				for(counter=3;counter>=0;counter--)
-				{
-					data |=(((uint64_t)CAN_RxMsg.dataA[counter])<<displace1);
-					displace1 -=8;
-				}
+	uint32_t ulKey;
+	uint32_t ulDroppedFromQueue;
+	uint32_t ulAborted;
+} CAN_Tx_Deadline_Record_t;
 
-				for(counter=length-5;counter>=0;counter--)
-				{
-					data |=(((uint64_t)CAN_RxMsg.dataB[counter])<<displace2);
-					displace2 -=8;
-				}
-			}
-			dataPtr=(uint64_t *)pvBuffer;
-			*dataPtr=data;
-			xReturn = CAN_RxMsg.len;
-		}
-		#endif /* ioconfigUSE_CAN_POLLED_RX */
-}
+/* The Tx deadlines of a controller, allocated by ioctlSET_CAN_TX_DEADLINES.
+The deadline and key of each frame the Tx frame queue loads into a hardware Tx
+buffer are kept until the buffer completes, so the frame can be aborted, and
+its drop counted.  The records are found through a hash table of record
+numbers, as the analytics records are.  Only changed by the CAN and timestamp
+timer interrupts, or by a task from within a critical section. */
+typedef struct xCAN_TX_DEADLINE_STATE
+{
+	uint32_t ulDeadlines[ canNUM_TX_BUFFERS ];
+	uint32_t ulKeys[ canNUM_TX_BUFFERS ];
+	uint32_t ulTimed;						/* Bit n is set while buffer n holds a frame with a deadline. */
+	uint32_t ulAborting;					/* Bit n is set once the frame in buffer n has been aborted. */
+	CAN_Tx_Deadline_Record_t *pxRecords;
+	uint16_t *pusSlots;						/* Record number plus one, or 0 for an empty slot. */
+	uint16_t usMaxIDs;						/* The number of records in pxRecords. */
+	uint16_t usSlotMask;					/* The number of slots in pusSlots, less one. */
+	CAN_Tx_Deadline_Statistics_t xStatistics;	/* usIDsTracked is the number of records in use. */
+} CAN_Tx_Deadline_State_t;
 
-else
+/* The largest table of IDs ioctlSET_CAN_TX_DEADLINES can create. */
+#define canTX_DEADLINE_MAX_IDS			( 512UL )
+
+/* pdTRUE if ulNow, a timestamp, is at or after ulDeadline.  Timestamps wrap,
+so a deadline must be less than half the timer's period away. */
+#define canDEADLINE_PASSED( ulDeadline, ulNow )	( ( int32_t ) ( ( ulNow ) - ( ulDeadline ) ) >= 0L )
+
+/* The state kept for each open CAN controller, independent of the Tx and Rx
+transfer modes.  It is hung off the peripheral control structure, and is also
+stored in pxControllerStates[] so the shared ISR can find it. */
+typedef struct xCAN_CONTROLLER_STATE
 {
-	if( xSemaphoreTake( xSemaphore_irq, portMAX_DELAY) == pdTRUE )
-	{
-		length = CAN_RxMsg.len;
-					if(length<=4)
-					{
-						displace1 = (length-1)*8;
-						for(counter=length-1;counter>=0;counter--)
-						{
-							data |=(((uint64_t)CAN_RxMsg.dataA[counter])<<displace1);
-							displace1 -=8;
-						}
-					}
-					else
-					{
-						displace1 = 24;
-						displace2 = (length-1)*8;
-						for(counter=3;counter>=0;counter--)
-						{
-							data |=(((uint64_t)CAN_RxMsg.dataA[counter])<<displace1);
-							displace1 -=8;
-						}
+	LPC_CAN_TypeDef *pxCAN;					/* The controller this state belongs to. */
+	CAN_MSG_Type xTxFrame;					/* The ID, format, type and length used by a single frame write, as set by ioctl(). */
+	CAN_MSG_Type xRxFrame;					/* The frame most recently received when interrupts are used without a frame queue. */
+	xSemaphoreHandle xRxSemaphore;			/* Given by the ISR each time xRxFrame is updated. */
+	portBASE_TYPE xInterruptsEnabled;		/* Set by ioctlUSE_INTERRUPTS. */
+	portBASE_TYPE xFrameBatchMode;			/* Set by ioctlSET_CAN_FRAME_BATCH_MODE.  When pdTRUE, the buffers passed to write() and read() are arrays of CAN_MSG_Type structures rather than the data bytes of a single frame. */
+	portTickType xTxBlockTime;				/* Set by ioctlSET_TX_TIMEOUT when no Tx transfer mode is set.  The time a batch write waits for a Tx buffer to become free, 0 until set. */
+	CAN_Route_t *pxRoutes;					/* The routes used to forward frames received by this controller, or NULL if there are none. */
+	uint16_t usNumberOfRoutes;				/* The number of routes in pxRoutes. */
+	volatile uint32_t ulRouteDropCount;		/* The number of received frames that matched a route but could not be forwarded. */
+	CAN_Statistics_t xStatistics;			/* Updated by the ISR and the read and write functions, and returned by ioctlGET_CAN_STATISTICS. */
+	xTimerHandle xBusOffTimer;				/* Restarts the controller after it has gone bus-off.  NULL if the timer could not be created. */
+	portTickType xBusOffBackOff;			/* The delay before the controller is next restarted after going bus-off. */
+	portBASE_TYPE xErrorInterruptsEnabled;	/* Set by ioctlSET_CAN_ERROR_INTERRUPTS. */
+	CAN_Tx_Timestamp_t xTxTimestamp;		/* Updated by the ISR on each Tx complete event, and returned by ioctlGET_CAN_TX_TIMESTAMP. */
+	uint32_t ulBitRate;						/* The bit rate last set, used to estimate the bus load.  The bit rate actually achieved can differ by up to canMAX_BIT_RATE_ERROR_PPM. */
+	CAN_Analytics_State_t *pxAnalytics;		/* The per ID analytics and bus load, or NULL if they are not enabled. */
+	CAN_Cyclic_Tx_Schedule_t *pxCyclicTx;	/* The messages sent cyclically by the controller, or NULL if there are none. */
+	CAN_Rx_Priority_State_t *pxRxPriority;	/* The high priority Rx frame queue, or NULL if all frames go to the Rx frame queue. */
+	portBASE_TYPE xRxQueueReadInProgress;	/* pdTRUE while read() is taking frames from the Rx frame queues, during which ioctlSET_CAN_RX_PRIORITY fails. */
+	CAN_Tx_Confirmation_State_t *pxTxConfirmation;	/* The Tx confirmations, or NULL if frames are not confirmed. */
+	CAN_Tx_Deadline_State_t *pxTxDeadlines;	/* The Tx deadlines, or NULL if frames have none. */
+	CAN_Layer_t *pxLayers;					/* The layers added by ioctlADD_CAN_LAYER, in the order they were added. */
+	CAN_Layer_t *pxTxBufferLayers[ canNUM_TX_BUFFERS ];	/* The layer that sent the frame in each hardware Tx buffer, or NULL. */
+} CAN_Controller_State_t;
 
-						for(counter=length-5;counter>=0;counter--)
-						{
-							data |=(((uint64_t)CAN_RxMsg.dataB[counter])<<displace2);
-							displace2 -=8;
-						}
-					}
-					dataPtr=(uint64_t *)pvBuffer;
-					*dataPtr=data;
-					xReturn = CAN_RxMsg.len;
-	}
-	else
-	{
-		xReturn=0;
-	}
-}
+/* A bit timing in the table of precomputed bit timings, xCommonBitTimings[]. */
+typedef struct xCAN_COMMON_BIT_TIMING
+{
+	uint32_t ulPCLK;
+	uint32_t ulBitRate;
+	uint32_t ulBTR;
+} CAN_Common_Bit_Timing_t;
 
+/* Transfer type casts from peripheral structs. */
+#define prvCAN_FRAME_QUEUE_RX_STATE( pxPeripheralControl ) ( ( CAN_Frame_Queue_Rx_State_t * ) ( pxPeripheralControl )->pxRxControl->pvTransferState )
+#define prvCAN_FRAME_QUEUE_TX_STATE( pxPeripheralControl ) ( ( CAN_Frame_Queue_Tx_State_t * ) ( pxPeripheralControl )->pxTxControl->pvTransferState )
+#define prvCAN_CONTROLLER_STATE( pxPeripheralControl ) ( ( CAN_Controller_State_t * ) diGET_DEVICE_STATE( pxPeripheralControl ) )
 
+/*-----------------------------------------------------------*/
 
+/*
+ * Reset a single controller and give it the default bit timing for ulBitRate,
+ * without touching the acceptance filter that is shared with the other
+ * controller.
+ */
+static portBASE_TYPE prvResetController( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBitRate );
 
+/*
+ * Find the bit timing that gives the bit rate nearest to ulBitRate from a
+ * peripheral clock of ulPCLK, and of those the one whose sample point (in
+ * tenths of a percent) is nearest to usSamplePoint, then the one with the most
+ * time quanta.  The SJW is ucSJW time quanta, or less if TSEG2 is shorter.
+ * Returns pdFAIL, leaving *pulBTR unchanged, if no bit timing is within
+ * canMAX_BIT_RATE_ERROR_PPM of ulBitRate.
+ */
+static portBASE_TYPE prvSolveBitTiming( const uint32_t ulPCLK, const uint32_t ulBitRate, const uint16_t usSamplePoint, const uint8_t ucSJW, uint32_t * const pulBTR );
 
-return xReturn;
-}
+/*
+ * Find the bus timing register value for a bit timing request.  A
+ * usSamplePoint or ucSJW of 0 selects boardCAN_DEFAULT_SAMPLE_POINT or
+ * canMAX_SJW respectively, and if both are 0 xCommonBitTimings[] is searched
+ * before solving.  Returns pdFAIL if the request is invalid or cannot be met.
+ */
+static portBASE_TYPE prvFindBitTiming( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBitRate, uint16_t usSamplePoint, uint8_t ucSJW, uint32_t * const pulBTR );
 
+/*
+ * Write ulBTR to the bus timing register, which can only be written in reset
+ * mode.  The rest of the mode register is left as it was.
+ */
+static void prvWriteBitTiming( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBTR );
 
-/*---------------------------------- CAN_ioctl ---------------------------------------*/
+/*
+ * Set or clear listen only mode, which can only be changed in reset mode.  The
+ * rest of the mode register is left as it was.
+ */
+static void prvWriteListenOnlyMode( LPC_CAN_TypeDef * const pxCAN, const portBASE_TYPE xListenOnly );
+
+/*
+ * Describe the bit timing currently set in the bus timing register.
+ */
+static void prvGetBitTiming( LPC_CAN_TypeDef * const pxCAN, CAN_Bit_Timing_t * const pxTiming );
 
+/*
+ * The peripheral clock of the controller at pxCAN.
+ */
+static uint32_t prvGetPCLK( LPC_CAN_TypeDef * const pxCAN );
 
-portBASE_TYPE FreeRTOS_CAN_ioctl( Peripheral_Descriptor_t pxPeripheral, uint32_t ulRequest, void *pvValue )
-{
-Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
-const int8_t cPeripheralNumber = diGET_PERIPHERAL_NUMBER( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
-LPC_CAN_TypeDef * pxCAN = ( LPC_CAN_TypeDef * ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
-CAN_PinCFG_Type xCANConfig;
-FunctionalState NewState;
-uint32_t ulValue = ( uint32_t ) pvValue;
+/*
+ * Listen to the bus in listen only mode at each bit rate of pxDetection in
+ * turn, and keep the first at which enough frames are received without a bus
+ * error.  Blocks the calling task for up to the listen time of every bit rate
+ * tried.  Returns pdFAIL, with the bit timing and mode restored, if no bit rate
+ * was found.
+ */
+static portBASE_TYPE prvDetectBitRate( CAN_Controller_State_t * const pxControllerState, CAN_Bit_Rate_Detection_t * const pxDetection );
 
-portBASE_TYPE xReturn = pdPASS;
+/*
+ * Start the free running timer that timestamps frames, counting once every
+ * boardCAN_TIMESTAMP_RESOLUTION_US microseconds.
+ */
+static void prvStartTimestampTimer( void );
 
-	taskENTER_CRITICAL();
-	{
-		switch( ulRequest )
-		{
+/*
+ * Create the frame queue used by the ioctlUSE_CAN_FRAME_QUEUE_RX transfer
+ * mode, replacing any frame queue that already exists.
+ */
+static portBASE_TYPE prvConfigureFrameQueueRx( Peripheral_Control_t * const pxPeripheralControl, const unsigned portBASE_TYPE uxQueueLength );
 
-			case ioctlUSE_INTERRUPTS :
-					
-				if( ulValue == pdFALSE )
-				{
-					NVIC_DisableIRQ(CAN_IRQn);
-				}
-				else
-				{
-					/* Enable the Rx  interrupt. */
-					CAN_IRQCmd (pxCAN,CANINT_RIE, ENABLE);
+/*
+ * Copy up to xFramesToRead frames out of an Rx frame queue, blocking for up
+ * to the queue's Rx timeout for frames to arrive.
+ */
+static size_t prvReadFramesFromQueue( CAN_Frame_Queue_Rx_State_t * const pxQueueState, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead );
 
-					/* Enable the interrupt and set its priority to the minimum
-					interrupt priority.  A separate command can be issued to raise
-					the priority if desired. */
-					NVIC_EnableIRQ(CAN_IRQn);
-					enable_irq = 1;
+/*
+ * Move every frame held by the CAN controller into the Rx frame queue.  Called
+ * from the CAN interrupt.
+ */
+static inline void prvRxFramesIntoQueueFromISR( CAN_Controller_State_t * const pxControllerState, Transfer_Control_t * const pxTransferControl, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken );
 
-				}
-				break;
+/*
+ * Replace the high priority Rx frame queue of a controller with a new, empty,
+ * queue, or remove it if pxConfig has no ranges of IDs.
+ */
+static portBASE_TYPE prvSetRxPriority( Peripheral_Control_t * const pxPeripheralControl, const CAN_Rx_Priority_Config_t * const pxConfig );
 
+/*
+ * Copy up to xFramesToRead frames out of the high and low priority Rx frame
+ * queues, taking every frame in the high priority queue before each frame
+ * taken from the low priority queue, and blocking for frames to arrive as
+ * prvReadFramesFromQueue() does.
+ */
+static size_t prvReadFramesByPriority( CAN_Rx_Priority_State_t * const pxPriority, CAN_Frame_Queue_Rx_State_t * const pxQueueState, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead );
 
+/*
+ * Take the oldest frame from an Rx frame queue that has the overflow policy
+ * ucOverflowPolicy, without blocking.  Returns pdFALSE if the queue is empty.
+ */
+static portBASE_TYPE prvTakeFrameFromQueue( CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint8_t ucOverflowPolicy, CAN_MSG_Type * const pxFrame );
 
-			case ioctlSET_SPEED :
-				can_SetBaudrate (pxCAN,ulValue);
-				break;
+/*
+ * Add pxFrame to an Rx frame queue.  If the queue is full either pxFrame or
+ * the oldest frame in the queue is discarded, as ucOverflowPolicy says, and
+ * pdFALSE is returned.  Called from the CAN interrupt.
+ */
+static portBASE_TYPE prvAddFrameToQueueFromISR( CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint8_t ucOverflowPolicy, const CAN_MSG_Type * const pxFrame );
 
+/*
+ * Move every frame held by the CAN controller into the high or low priority
+ * Rx frame queue, as its ID says.  Called from the CAN interrupt.
+ */
+static void prvRxFramesIntoPriorityQueuesFromISR( CAN_Controller_State_t * const pxControllerState, CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken );
 
-			case ioctlSET_INTERRUPT_PRIORITY :
+/*
+ * Write the payload of pxFrame to pvBuffer as a single 64 bit word, with any
+ * bytes beyond the frame's DLC cleared, and return the number of payload bytes.
+ */
+static size_t prvCopyPayloadToBuffer( const CAN_MSG_Type * const pxFrame, void * const pvBuffer );
 
-				/* The ISR uses ISR safe FreeRTOS API functions, so the priority
-				being set must be lower than (ie numerically larger than)
-				configMAX_LIBRARY_INTERRUPT_PRIORITY. */
-				configASSERT( ulValue >= configMAX_LIBRARY_INTERRUPT_PRIORITY );
-				NVIC_SetPriority( xIRQ[ cPeripheralNumber ], ulValue );
-				break;
+/*
+ * Send xFramesToWrite frames, waiting up to xBlockTime ticks in all for a Tx
+ * buffer to become free whenever all three are in use.  Returns the number of
+ * frames actually sent, which is less than xFramesToWrite if the wait timed out
+ * or the controller is bus-off.
+ */
+static size_t prvWriteFramesPolled( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrames, const size_t xFramesToWrite, portTickType xBlockTime );
 
+/*
+ * Send pxFrame with CAN_SendMsg(), first noting the Tx buffer it will take if
+ * the controller's frames are being confirmed.
+ */
+static Status prvSendMsg( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrame, const uint8_t ucSelfReception );
 
-			case ioctlSET_CAN_STD_ID :
-				CAN_TxMsg.id = ulValue;
-				CAN_TxMsg.format = STD_ID_FORMAT;
-				break;
+/*
+ * Read up to xFramesToRead frames that have already been received, without
+ * blocking.
+ */
+static size_t prvReadFramesPolled( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead );
 
-			case ioctlSET_CAN_EXT_ID :
+/*
+ * Create the priority ordered queue used by the ioctlUSE_CAN_FRAME_QUEUE_TX
+ * transfer mode, replacing any Tx frame queue that already exists.
+ */
+static portBASE_TYPE prvConfigureFrameQueueTx( Peripheral_Control_t * const pxPeripheralControl, const unsigned portBASE_TYPE uxQueueLength );
 
-				CAN_TxMsg.id = ulValue;
-				CAN_TxMsg.format = EXT_ID_FORMAT;
-				break;
+/*
+ * Add up to xFramesToWrite frames to the Tx frame queue, blocking for up to the
+ * configured Tx timeout for space to become available.
+ */
+static size_t prvWriteFramesToQueue( Peripheral_Control_t * const pxPeripheralControl, const CAN_MSG_Type * const pxFrames, const size_t xFramesToWrite );
 
-			case ioctlSET_CAN_FRAME_TYPE :
-				if(ulValue==0)
-				{
-				CAN_TxMsg.type =DATA_FRAME;
-				}
-				else
-				CAN_TxMsg.type =REMOTE_FRAME;
-				break;
+/*
+ * Add pxFrame to a Tx frame queue that is not full, with the deadline
+ * ulDeadline, or 0 for none, on behalf of pxLayer, or NULL.  Called from the
+ * CAN interrupt, and by tasks from within a critical section.
+ */
+static void prvAddFrameToTxQueue( CAN_Frame_Queue_Tx_State_t * const pxQueueState, const CAN_MSG_Type * const pxFrame, const uint32_t ulDeadline, CAN_Layer_t * const pxLayer );
 
-			case ioctlSET_CAN_CONFIG_SELFTEST_MODE :
-				if(ulValue == 0)
-				CAN_ModeConfig(pxCAN,CAN_SELFTEST_MODE,DISABLE);
-				else
-				CAN_ModeConfig(pxCAN,CAN_SELFTEST_MODE,ENABLE);
-				break;
+/*
+ * Move the highest priority queued frames into whichever hardware Tx buffers
+ * are free, dropping any that have missed their deadlines on the way.  Called
+ * from the CAN interrupt, and by tasks from within a critical section.  Returns
+ * the number of frames removed from the queue.
+ */
+static uint32_t prvLoadTxBuffersFromQueue( LPC_CAN_TypeDef * const pxCAN, CAN_Frame_Queue_Tx_State_t * const pxQueueState );
 
-			case ioctlSET_CONFIG_CANAF_MODE_BYPASS :
-				if(ulValue == 1)
-				CAN_SetAFMode (LPC_CANAF,CAN_AccBP);
-				else
-				CAN_SetAFMode (LPC_CANAF,CAN_Normal);
-				break;
+/*
+ * Move the frame at index usParent of the Tx frame queue's heap down past any
+ * frames that have priority over it.
+ */
+static void prvSiftDownTxQueue( CAN_Frame_Queue_Tx_State_t * const pxQueueState, uint16_t usParent );
 
-			case ioctlSET_CAN_FRAME_LENGTH :
-				 CAN_TxMsg.len=ulValue;
-				break;
+/*
+ * Make room in a full Tx frame queue by dropping the frames that have missed
+ * their deadlines.  Returns pdTRUE if any were dropped.  Called by tasks from
+ * within a critical section.
+ */
+static portBASE_TYPE prvMakeRoomInTxQueue( LPC_CAN_TypeDef * const pxCAN, CAN_Frame_Queue_Tx_State_t * const pxQueueState );
 
-			default :
-				xReturn = pdFAIL;
-				break;
-		}
-	}
-	taskEXIT_CRITICAL();
+/*
+ * Add, remove or replace acceptance filter entries.  Each returns pdPASS if the
+ * acceptance filter look up table was updated, otherwise pdFAIL, in which case
+ * the acceptance filter mode is left as it was.
+ */
+static portBASE_TYPE prvAddFilterEntry( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Entry_t * const pxEntry );
+static portBASE_TYPE prvRemoveFilterEntry( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Entry_t * const pxEntry );
+static portBASE_TYPE prvLoadFilterTable( AF_SectionDef * const pxTable );
 
-	return xReturn;
-}
+/*
+ * Replace every acceptance filter entry that belongs to pxCAN with the
+ * entries in pxTable, which are first sorted and merged into as few entries
+ * as possible.  The entries of the other CAN controller are kept.  The new
+ * table is built in RAM, then copied into the look up table in a single pass,
+ * so the acceptance filter is only off for the duration of the copy.
+ */
+static portBASE_TYPE prvCompileFilterTable( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Table_t * const pxTable );
 
+/*
+ * Set the start address of each section of the acceptance filter look up
+ * table from the number of entries in each section.
+ */
+static void prvSetFilterSectionAddresses( void );
 
-/*--------------------------------- INTERRUPT HANDLER -------------------------------------*/
-void CAN_IRQHandler(void)
-{
-	uint8_t CANIntStatus;
-	static signed portBASE_TYPE xHigherPriorityTaskWoken;
-	xHigherPriorityTaskWoken = pdFALSE;
-	CANIntStatus = CAN_IntGetStatus(LPC_CAN2);
-	if(CANIntStatus &0x01)
-	 {
-		CAN_ReceiveMsg(LPC_CAN2,&CAN_RxMsg);
-		xSemaphoreGiveFromISR( xSemaphore_irq, &xHigherPriorityTaskWoken );
+/*
+ * Add a FullCAN entry for the standard ID usID, so frames with that ID are
+ * written straight into a message object in the acceptance filter RAM.
+ */
+static portBASE_TYPE prvAddFullCANEntry( LPC_CAN_TypeDef * const pxCAN, const uint16_t usID );
+
+/*
+ * Find the FullCAN message object that receives the ID in pxMailbox.
+ */
+static portBASE_TYPE prvGetFullCANMailbox( LPC_CAN_TypeDef * const pxCAN, CAN_FullCAN_Mailbox_t * const pxMailbox );
+
+/*
+ * Set a bit in pulUpdated (an array of two words) for each FullCAN message
+ * object that has received a frame since the last call, and release the
+ * objects so they can be read in place.
+ */
+static void prvGetFullCANUpdates( uint32_t * const pulUpdated );
+
+/*
+ * Move the FullCAN interrupt pending bits into ulFullCANUpdated[].  Called from
+ * the CAN interrupt.
+ */
+static void prvFullCANUpdatesFromISR( void );
+
+/*
+ * Replace the routes used to forward the frames received by a controller.  The
+ * routes are copied, so pxTable need not remain in scope.
+ */
+static portBASE_TYPE prvSetRoutingTable( CAN_Controller_State_t * const pxControllerState, const CAN_Routing_Table_t * const pxTable );
+
+/*
+ * Forward pxFrame if it matches one of the controller's routes.  Called from the
+ * CAN interrupt.  Returns pdTRUE if the frame should also be passed to read()
+ * on the controller that received it, which is always the case if no route
+ * matches.
+ */
+static portBASE_TYPE prvRouteFrameFromISR( CAN_Controller_State_t * const pxControllerState, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Pass a frame received by the controller to everything that can take it
+ * before the controller's own reader - the routes, then the layers in the
+ * order they were added.  Called from the CAN interrupt.  Returns pdTRUE if the
+ * frame should be passed to read() on the controller.
+ */
+static portBASE_TYPE prvDispatchRxFrameFromISR( CAN_Controller_State_t * const pxControllerState, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * Start sending pxFrame from the controller with index uxIndex, without
+ * waiting, on behalf of pxLayer, or NULL.  Returns pdFAIL if there is no room
+ * for the frame.
+ */
+static portBASE_TYPE prvForwardFrameFromISR( const unsigned portBASE_TYPE uxIndex, const CAN_MSG_Type * const pxFrame, CAN_Layer_t * const pxLayer );
+
+/*
+ * Write pxFrame into hardware Tx buffer ulBuffer (0 to 2) and request its
+ * transmission.
+ */
+static void prvWriteTxBuffer( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBuffer, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Add pxLayer to the end of the controller's list of layers, or remove it from
+ * the list.  Called from within a critical section.
+ */
+static portBASE_TYPE prvAddLayer( CAN_Controller_State_t * const pxControllerState, CAN_Layer_t * const pxLayer );
+static portBASE_TYPE prvRemoveLayer( CAN_Controller_State_t * const pxControllerState, CAN_Layer_t * const pxLayer );
+
+/*
+ * The pxSendFunction of every layer.
+ */
+static portBASE_TYPE prvLayerSendFrame( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Finish with the frame a layer sent in Tx buffer ulBuffer (0 to 2), once it
+ * has been sent or aborted, or the buffer is about to be reloaded.  Does
+ * nothing if no layer sent the frame in the buffer.
+ */
+static void prvLayerTxBufferDone( CAN_Controller_State_t * const pxControllerState, const uint32_t ulBuffer );
+
+#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+
+/*
+ * Replace the Tx confirmations of a controller, or stop them if pxConfig has
+ * neither a function nor a queue.  Frames already in the Tx buffers are
+ * confirmed as the new configuration says.
+ */
+static portBASE_TYPE prvSetTxConfirmation( CAN_Controller_State_t * const pxControllerState, const CAN_Tx_Confirmation_Config_t * const pxConfig );
+
+/*
+ * Note that pxFrame is being loaded into Tx buffer ulBuffer (0 to 2), first
+ * confirming the frame the buffer held if its Tx interrupt has not yet been
+ * handled.  Called from the CAN and timer interrupts, or from within a
+ * critical section, before the transmission of pxFrame is requested.
+ */
+static void prvRecordTxFrame( CAN_Tx_Confirmation_State_t * const pxConfirmation, LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBuffer, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Confirm the frame in Tx buffer ulBuffer, which has completed, as sent if
+ * ulStatus (the value of the SR register) shows the buffer completed
+ * successfully, and otherwise as aborted.
+ */
+static void prvConfirmTxFromISR( CAN_Tx_Confirmation_State_t * const pxConfirmation, const uint32_t ulBuffer, const uint32_t ulStatus, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+
+#if ioconfigUSE_CAN_TX_DEADLINES == 1
+
+/*
+ * Replace the Tx deadlines of a controller with new ones that count the drops
+ * of up to uxMaxIDs IDs, or stop the deadlines if uxMaxIDs is 0.
+ */
+static portBASE_TYPE prvSetTxDeadlines( CAN_Controller_State_t * const pxControllerState, const unsigned portBASE_TYPE uxMaxIDs );
+
+/*
+ * Abort the frames in the hardware Tx buffers of either controller that have
+ * missed their deadlines, and set the timestamp timer to interrupt at the
+ * earliest deadline still to come.  Called from the CAN and timestamp timer
+ * interrupts, or from within a critical section.
+ */
+static void prvCheckTxDeadlinesFromISR( void );
+
+/*
+ * Note that Tx buffer ulBuffer (0 to 2) has completed, counting its frame as
+ * aborted if it was aborted for missing its deadline - which ulStatus, the
+ * value of the SR register, shows if the frame was not sent.  Called from the
+ * CAN interrupt, or from within a critical section.
+ */
+static void prvTxDeadlineBufferDoneFromISR( CAN_Tx_Deadline_State_t * const pxDeadlines, const uint32_t ulBuffer, const uint32_t ulStatus );
+
+/*
+ * Count a frame with the ID ulKey (see CAN_Tx_Deadline_Record_t) dropped from
+ * the Tx frame queue, or aborted in a hardware Tx buffer if xAborted is pdTRUE.
+ */
+static void prvCountTxDeadlineDrop( CAN_Tx_Deadline_State_t * const pxDeadlines, const uint32_t ulKey, const portBASE_TYPE xAborted );
+
+/*
+ * Fill in the result of the ioctlGET_CAN_TX_DEADLINE_DROPS request.
+ */
+static portBASE_TYPE prvGetTxDeadlineDrops( const CAN_Tx_Deadline_State_t * const pxDeadlines, CAN_Tx_Deadline_Drops_t * const pxResult );
+
+void boardCAN_TIMESTAMP_TIMER_HANDLER( void );
+
+#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+#if ioconfigUSE_CAN_ANALYTICS == 1
+
+/*
+ * Replace the analytics of a controller with a new, empty, table that can
+ * track uxMaxIDs IDs, or stop the analytics if uxMaxIDs is 0.
+ */
+static portBASE_TYPE prvConfigureAnalytics( CAN_Controller_State_t * const pxControllerState, const unsigned portBASE_TYPE uxMaxIDs );
+
+/*
+ * Add a received frame to the analytics of a controller.  Called from the CAN
+ * interrupt, or from within a critical section.
+ */
+static void prvAnalyseFrameFromISR( CAN_Analytics_State_t * const pxAnalytics, const CAN_MSG_Type * const pxFrame );
+
+/*
+ * Add the frames that hardware Tx buffers sent successfully to the bus load
+ * of a controller.  ulTxInterrupts holds the TI1 to TI3 bits of the interrupt
+ * capture register.  Called from the CAN interrupt.
+ */
+static void prvAnalyseTxFromISR( CAN_Analytics_State_t * const pxAnalytics, LPC_CAN_TypeDef * const pxCAN, const uint32_t ulTxInterrupts );
+
+/*
+ * The bus time, in bits, of a frame with the given format, type and DLC,
+ * assuming the worst case number of stuff bits.
+ */
+static uint32_t prvFrameBits( const uint8_t ucFormat, const uint8_t ucType, const uint8_t ucDLC );
+
+/*
+ * Fill in the result of the ioctlGET_CAN_ID_ANALYTICS and
+ * ioctlGET_CAN_BUS_LOAD requests.  Called from within a critical section.
+ */
+static portBASE_TYPE prvGetIDAnalytics( const CAN_Analytics_State_t * const pxAnalytics, CAN_ID_Analytics_t * const pxResult );
+static void prvGetBusLoad( const CAN_Controller_State_t * const pxControllerState, CAN_Bus_Load_t * const pxResult );
+
+#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+#if ioconfigUSE_CAN_CYCLIC_TX == 1
+
+/*
+ * Copy a cyclic Tx table, choose the offsets it leaves to the driver, and
+ * start the controller sending it.  A table with no messages stops the
+ * controller sending cyclically.
+ */
+static portBASE_TYPE prvSetCyclicTxTable( CAN_Controller_State_t * const pxControllerState, const CAN_Cyclic_Tx_Table_t * const pxTable );
+
+/*
+ * Give every entry with an offset of diCAN_CYCLIC_TX_AUTO_OFFSET an offset,
+ * shortest period first, that adds least to the busiest slot it occupies, then
+ * least to the slots it occupies in total.  Returns the most frames due in any
+ * slot, or 0 if there was not enough heap to choose the offsets.
+ */
+static uint16_t prvChooseCyclicTxOffsets( CAN_Cyclic_Tx_Entry_t * const pxEntries, const uint16_t usEntries );
+
+/*
+ * Start the timer that paces the cyclic Tx scheduler, and return the number of
+ * the next slot to start, moving the timer's match back to it if the match had
+ * been set for a later slot.  Must be called from within a critical section.
+ */
+static uint32_t prvCyclicTxNextSlot( void );
+
+/*
+ * Load the frames of the controller at index uxIndex that are due in slot
+ * ulSlot, and lower *pulNextSlot to the next slot in which any of its frames
+ * are due.  Called from the timer interrupt.
+ */
+static void prvCyclicTxSlotFromISR( const unsigned portBASE_TYPE uxIndex, const uint32_t ulSlot, uint32_t * const pulNextSlot );
+
+/*
+ * Send the due frames of a controller's cyclic Tx table that have not yet found
+ * room, in table order, until one does not fit.  Called from the timer and CAN
+ * interrupts, which have the same priority.
+ */
+static void prvCyclicTxSendPendingFromISR( const unsigned portBASE_TYPE uxIndex, CAN_Cyclic_Tx_Schedule_t * const pxSchedule );
+
+void boardCAN_CYCLIC_TX_TIMER_HANDLER( void );
+
+#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+
+/*
+ * Count the error interrupts in ulInterruptSource, and start bus-off recovery
+ * if the controller has gone bus-off.  Called from the CAN interrupt.
+ */
+static void prvHandleErrorsFromISR( CAN_Controller_State_t * const pxControllerState, const uint32_t ulInterruptSource, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/*
+ * The callback of the timer that restarts a controller after it has gone
+ * bus-off.
+ */
+static void prvBusOffRecoveryCallback( xTimerHandle xTimer );
+
+/*
+ * Give the CAN interrupt, and the timer interrupts that share its data, the
+ * priority last set by ioctlSET_INTERRUPT_PRIORITY.  Called from within a
+ * critical section each time one of the interrupts is enabled.
+ */
+static void prvSetInterruptPriorities( void );
+
+void CAN_IRQHandler( void );
+
+/*-----------------------------------------------------------*/
+
+/* FullCAN message objects that have been received into, but not yet reported
+by ioctlGET_CAN_FULLCAN_UPDATES, when the FullCAN interrupt has been enabled by
+ioctlSET_CAN_FULLCAN_INTERRUPT and is handled by the ISR.  Bit n of word 0 is
+object n, bit n of word 1 is object n + 32. */
+static volatile uint32_t ulFullCANUpdated[ canMAX_FULLCAN_OBJECTS / canFULLCAN_OBJECTS_PER_WORD ] = { 0UL };
+
+/* The number of entries in each section of the acceptance filter look up
+table, as maintained by the CAN library. */
+extern uint16_t CANAF_FullCAN_cnt, CANAF_std_cnt, CANAF_gstd_cnt, CANAF_ext_cnt, CANAF_gext_cnt;
+
+/* Stores the Rx transfer control structures that are currently in use by the
+supported CAN ports. */
+static Transfer_Control_t *pxRxTransferControlStructs[ boardNUM_CANS ] = { NULL };
+
+/* Stores the Tx transfer control structures that are currently in use by the
+supported CAN ports. */
+static Transfer_Control_t *pxTxTransferControlStructs[ boardNUM_CANS ] = { NULL };
+
+/* Stores the state of each CAN controller that has been opened, so the ISR,
+which is shared by both controllers, can find it. */
+static CAN_Controller_State_t *pxControllerStates[ boardNUM_CANS ] = { NULL };
+
+/* The priority of the CAN interrupt, which is shared by both controllers, and
+of the cyclic Tx and timestamp timer interrupts, which must never interrupt it
+or each other.  Only changed by ioctlSET_INTERRUPT_PRIORITY, so enabling an
+interrupt on one controller does not undo the priority set for the other. */
+static uint32_t ulInterruptPriority = configMIN_LIBRARY_INTERRUPT_PRIORITY;
+
+/* The status register bit that shows each hardware Tx buffer is free. */
+static const uint32_t ulTxBufferStatusBits[ canNUM_TX_BUFFERS ] = { CAN_SR_TBS1, CAN_SR_TBS2, CAN_SR_TBS3 };
+
+/* The Tx complete interrupt of each hardware Tx buffer. */
+static const uint32_t ulTxInterruptBits[ canNUM_TX_BUFFERS ] = { CAN_ICR_TI1, CAN_ICR_TI2, CAN_ICR_TI3 };
+
+/* The status register bit that shows each hardware Tx buffer's last
+transmission completed successfully. */
+static const uint32_t ulTxCompleteBits[ canNUM_TX_BUFFERS ] = { CAN_SR_TCS1, CAN_SR_TCS2, CAN_SR_TCS3 };
+
+/* The bit timings prvSolveBitTiming() finds for the common bit rates at the
+peripheral clocks a CCLK of 100MHz or 120MHz divided by 2 or 4 gives, with a
+sample point of canCOMMON_BIT_TIMING_SAMPLE_POINT and the widest SJW.  Looking
+the bit timing up saves solving for it when a controller is opened, which
+happens within a critical section.  Rates that cannot be met at a clock, such
+as 800K from 25MHz or 50MHz, are left out. */
+static const CAN_Common_Bit_Timing_t xCommonBitTimings[] =
+{
+	{  25000000UL,    10000UL, 0x002F807CUL },	/* 20 tq, 85.0%. */
+	{  25000000UL,    20000UL, 0x0016407CUL },	/* 10 tq, 80.0%. */
+	{  25000000UL,    50000UL, 0x002F8018UL },	/* 20 tq, 85.0%. */
+	{  25000000UL,   100000UL, 0x00164018UL },	/* 10 tq, 80.0%. */
+	{  25000000UL,   125000UL, 0x002F8009UL },	/* 20 tq, 85.0%. */
+	{  25000000UL,   250000UL, 0x002F8004UL },	/* 20 tq, 85.0%. */
+	{  25000000UL,   500000UL, 0x00164004UL },	/* 10 tq, 80.0%. */
+	{  25000000UL,  1000000UL, 0x007FC000UL },	/* 25 tq, 68.0%. */
+	{  30000000UL,    10000UL, 0x001B40C7UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,    20000UL, 0x001B4063UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,    50000UL, 0x001B4027UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,   100000UL, 0x001B4013UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,   125000UL, 0x001C400EUL },	/* 16 tq, 87.5%. */
+	{  30000000UL,   250000UL, 0x001B4007UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,   500000UL, 0x001B4003UL },	/* 15 tq, 86.7%. */
+	{  30000000UL,  1000000UL, 0x001B4001UL },	/* 15 tq, 86.7%. */
+	{  50000000UL,    10000UL, 0x002F80F9UL },	/* 20 tq, 85.0%. */
+	{  50000000UL,    20000UL, 0x002F807CUL },	/* 20 tq, 85.0%. */
+	{  50000000UL,    50000UL, 0x002F8031UL },	/* 20 tq, 85.0%. */
+	{  50000000UL,   100000UL, 0x002F8018UL },	/* 20 tq, 85.0%. */
+	{  50000000UL,   125000UL, 0x001C4018UL },	/* 16 tq, 87.5%. */
+	{  50000000UL,   250000UL, 0x002F8009UL },	/* 20 tq, 85.0%. */
+	{  50000000UL,   500000UL, 0x002F8004UL },	/* 20 tq, 85.0%. */
+	{  50000000UL,  1000000UL, 0x00164004UL },	/* 10 tq, 80.0%. */
+	{  60000000UL,    10000UL, 0x001C4176UL },	/* 16 tq, 87.5%. */
+	{  60000000UL,    20000UL, 0x001B40C7UL },	/* 15 tq, 86.7%. */
+	{  60000000UL,    50000UL, 0x001C404AUL },	/* 16 tq, 87.5%. */
+	{  60000000UL,   100000UL, 0x001B4027UL },	/* 15 tq, 86.7%. */
+	{  60000000UL,   125000UL, 0x001C401DUL },	/* 16 tq, 87.5%. */
+	{  60000000UL,   250000UL, 0x001C400EUL },	/* 16 tq, 87.5%. */
+	{  60000000UL,   500000UL, 0x001B4007UL },	/* 15 tq, 86.7%. */
+	{  60000000UL,   800000UL, 0x001B4004UL },	/* 15 tq, 86.7%. */
+	{  60000000UL,  1000000UL, 0x001B4003UL }	/* 15 tq, 86.7%. */
+};
+
+/* The bit rates tried by ioctlDETECT_CAN_BIT_RATE when the application does
+not give its own - those of CiA 301, fastest first. */
+static const uint32_t ulDetectableBitRates[] = { 1000000UL, 800000UL, 500000UL, 250000UL, 125000UL, 100000UL, 50000UL, 20000UL, 10000UL };
+
+#if ioconfigUSE_CAN_CYCLIC_TX == 1
+
+	/* The slot that starts at the next match of the cyclic Tx timer, and
+	whether the timer is running.  The timer is shared by both
+	controllers. */
+	static uint32_t ulCyclicTxSlot = 0UL;
+	static portBASE_TYPE xCyclicTxTimerRunning = pdFALSE;
+
+#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+
+/*------------------------------- CAN_open ----------------------------------------*/
+
+portBASE_TYPE FreeRTOS_CAN_open( Peripheral_Control_t * const pxPeripheralControl )
+{
+PINSEL_CFG_Type xPinConfig;
+LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( pxPeripheralControl );
+portBASE_TYPE xReturn = pdFAIL, xOtherControllerOpen = pdFALSE;
+const int8_t cPeripheralNumber = diGET_PERIPHERAL_NUMBER( pxPeripheralControl );
+CAN_Controller_State_t *pxControllerState = NULL;
+unsigned portBASE_TYPE uxIndex;
+
+	/* Sanity check the peripheral number. */
+	if( ( cPeripheralNumber > 0 ) && ( cPeripheralNumber <= boardNUM_CANS ) )
+	{
+		/* Opening a controller a second time reuses its existing state. */
+		pxControllerState = pxControllerStates[ canPERIPHERAL_INDEX( cPeripheralNumber ) ];
+
+		if( pxControllerState == NULL )
+		{
+			pxControllerState = pvPortMalloc( sizeof( CAN_Controller_State_t ) );
+
+			if( pxControllerState != NULL )
+			{
+				memset( pxControllerState, 0x00, sizeof( CAN_Controller_State_t ) );
+				vSemaphoreCreateBinary( pxControllerState->xRxSemaphore );
+
+				if( pxControllerState->xRxSemaphore == NULL )
+				{
+					vPortFree( pxControllerState );
+					pxControllerState = NULL;
+				}
+				else
+				{
+					/* The semaphore is only given when a frame is received. */
+					xSemaphoreTake( pxControllerState->xRxSemaphore, 0U );
+				}
+			}
+		}
+	}
+
+	if( pxControllerState != NULL )
+	{
+		pxControllerState->pxCAN = pxCAN;
+		pxControllerState->ulBitRate = boardDEFAULT_CAN_BAUD;
+		pxPeripheralControl->pvDeviceState = ( void * ) pxControllerState;
+
+		pxPeripheralControl->read = FreeRTOS_CAN_read;
+		pxPeripheralControl->write = FreeRTOS_CAN_write;
+		pxPeripheralControl->ioctl = FreeRTOS_CAN_ioctl;
+
+
+		/* Setup the pins for the CAN being used. */
+		taskENTER_CRITICAL();
+		{
+			boardCONFIGURE_CAN_PINS( cPeripheralNumber, xPinConfig );
+
+			for( uxIndex = 0; uxIndex < boardNUM_CANS; uxIndex++ )
+			{
+				if( ( uxIndex != ( unsigned portBASE_TYPE ) canPERIPHERAL_INDEX( cPeripheralNumber ) ) && ( pxControllerStates[ uxIndex ] != NULL ) )
+				{
+					xOtherControllerOpen = pdTRUE;
+				}
+			}
+
+			if( xOtherControllerOpen == pdFALSE )
+			{
+				/* Set up the default CAN configuration.  This is what
+				CAN_Init() does, less its bit rate calculation, which never
+				returns if it cannot divide the peripheral clock down to the
+				bit rate exactly. */
+				CLKPWR_SetPCLKDiv( CLKPWR_PCLKSEL_CAN1, CLKPWR_PCLKSEL_CCLK_DIV_2 );
+				CLKPWR_SetPCLKDiv( CLKPWR_PCLKSEL_CAN2, CLKPWR_PCLKSEL_CCLK_DIV_2 );
+				CLKPWR_SetPCLKDiv( CLKPWR_PCLKSEL_ACF, CLKPWR_PCLKSEL_CCLK_DIV_2 );
+
+				LPC_CANAF->AFMR = CAN_AFMR_AccOff;
+				for( uxIndex = 0; uxIndex < canAF_LUT_SIZE_WORDS; uxIndex++ )
+				{
+					LPC_CANAF_RAM->mask[ uxIndex ] = 0UL;
+				}
+				LPC_CANAF->SFF_sa = 0UL;
+				LPC_CANAF->SFF_GRP_sa = 0UL;
+				LPC_CANAF->EFF_sa = 0UL;
+				LPC_CANAF->EFF_GRP_sa = 0UL;
+				LPC_CANAF->ENDofTable = 0UL;
+
+				xReturn = prvResetController( pxCAN, boardDEFAULT_CAN_BAUD );
+				//Self-test mode selected
+				//CAN_ModeConfig(pxCAN, CAN_SELFTEST_MODE, ENABLE);
+
+				//Acceptance filter bypassed
+				CAN_SetAFMode (LPC_CANAF, CAN_AccBP);
+
+				/* The timestamp timer is shared by both controllers. */
+				prvStartTimestampTimer();
+			}
+			else
+			{
+				/* The other controller is already running, so leave the
+				acceptance filter it may be using alone. */
+				xReturn = prvResetController( pxCAN, boardDEFAULT_CAN_BAUD );
+			}
+
+			pxControllerStates[ canPERIPHERAL_INDEX( cPeripheralNumber ) ] = pxControllerState;
+		}
+		taskEXIT_CRITICAL();
+
+		/* xReturn is pdFAIL if boardDEFAULT_CAN_BAUD cannot be set from the
+		peripheral clock. */
+		configASSERT( xReturn );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvResetController( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBitRate )
+{
+portBASE_TYPE xReturn;
+uint32_t ulBTR;
+
+	if( pxCAN == LPC_CAN1 )
+	{
+		CLKPWR_ConfigPPWR( CLKPWR_PCONP_PCAN1, ENABLE );
+	}
+	else
+	{
+		CLKPWR_ConfigPPWR( CLKPWR_PCONP_PCAN2, ENABLE );
+	}
+
+	/* The same sequence as CAN_Init(), less the acceptance filter.  The
+	peripheral clocks of both controllers were set when the first controller
+	was opened. */
+	pxCAN->MOD = CAN_MOD_RM;
+	pxCAN->IER = 0UL;
+	pxCAN->GSR = 0UL;
+	pxCAN->CMR = CAN_CMR_AT | CAN_CMR_RRB | CAN_CMR_CDO;
+	( void ) pxCAN->ICR;
+
+	xReturn = prvFindBitTiming( pxCAN, ulBitRate, 0U, 0U, &ulBTR );
+	if( xReturn == pdPASS )
+	{
+		pxCAN->BTR = ulBTR;
+	}
+
+	pxCAN->MOD = 0UL;
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSolveBitTiming( const uint32_t ulPCLK, const uint32_t ulBitRate, const uint16_t usSamplePoint, const uint8_t ucSJW, uint32_t * const pulBTR )
+{
+portBASE_TYPE xReturn = pdFAIL;
+uint32_t ulTimeQuanta, ulPrescaler, ulLastPrescaler, ulTSEG1, ulTSEG2, ulSJW, ulSamplePoint;
+uint32_t ulRateError, ulSamplePointError, ulBestRateError = 0UL, ulBestSamplePointError = 0UL;
+uint64_t ullClocks;
+
+	/* Each number of time quanta per bit needs the prescaler that divides
+	the peripheral clock down to nearest that many time quanta per bit, which
+	is one of the two either side of the exact division.  Trying the most time
+	quanta first means that, of equally good bit timings, the one with the
+	finest time quanta is kept. */
+	for( ulTimeQuanta = canMAX_TQ_PER_BIT; ulTimeQuanta >= canMIN_TQ_PER_BIT; ulTimeQuanta-- )
+	{
+		ulPrescaler = ulPCLK / ( ulBitRate * ulTimeQuanta );
+		ulLastPrescaler = ulPrescaler + 1UL;
+
+		if( ulPrescaler == 0UL )
+		{
+			ulPrescaler = 1UL;
+		}
+
+		if( ulLastPrescaler > canMAX_PRESCALER )
+		{
+			ulLastPrescaler = canMAX_PRESCALER;
+		}
+
+		for( ; ulPrescaler <= ulLastPrescaler; ulPrescaler++ )
+		{
+			ullClocks = ( uint64_t ) ulBitRate * ( uint64_t ) ulPrescaler * ( uint64_t ) ulTimeQuanta;
+			ulRateError = ( uint32_t ) ( ( ( ( ullClocks > ulPCLK ) ? ( ullClocks - ulPCLK ) : ( ulPCLK - ullClocks ) ) * 1000000ULL ) / ullClocks );
+
+			if( ( ulRateError > canMAX_BIT_RATE_ERROR_PPM ) || ( ( xReturn == pdPASS ) && ( ulRateError > ulBestRateError ) ) )
+			{
+				continue;
+			}
+
+			for( ulTSEG2 = canMIN_TSEG2; ulTSEG2 <= canMAX_TSEG2; ulTSEG2++ )
+			{
+				ulTSEG1 = ulTimeQuanta - 1UL - ulTSEG2;
+				ulSJW = ( ( uint32_t ) ucSJW < ulTSEG2 ) ? ( uint32_t ) ucSJW : ulTSEG2;
+
+				if( ( ulTSEG1 > canMAX_TSEG1 ) || ( ulTSEG1 <= ulSJW ) )
+				{
+					continue;
+				}
+
+				ulSamplePoint = ( ( ( 1UL + ulTSEG1 ) * 1000UL ) + ( ulTimeQuanta / 2UL ) ) / ulTimeQuanta;
+				ulSamplePointError = ( ulSamplePoint > usSamplePoint ) ? ( ulSamplePoint - usSamplePoint ) : ( usSamplePoint - ulSamplePoint );
+
+				if( ( xReturn == pdFAIL ) || ( ulRateError < ulBestRateError ) || ( ulSamplePointError < ulBestSamplePointError ) )
+				{
+					ulBestRateError = ulRateError;
+					ulBestSamplePointError = ulSamplePointError;
+					*pulBTR = canBTR( ulPrescaler, ulTSEG1, ulTSEG2, ulSJW );
+					xReturn = pdPASS;
+				}
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvFindBitTiming( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBitRate, uint16_t usSamplePoint, uint8_t ucSJW, uint32_t * const pulBTR )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulPCLK = prvGetPCLK( pxCAN );
+const portBASE_TYPE xDefaultTiming = ( ( usSamplePoint == 0U ) && ( ucSJW == 0U ) );
+unsigned portBASE_TYPE uxIndex;
+
+	if( usSamplePoint == 0U )
+	{
+		usSamplePoint = boardCAN_DEFAULT_SAMPLE_POINT;
+	}
+
+	if( ucSJW == 0U )
+	{
+		ucSJW = ( uint8_t ) canMAX_SJW;
+	}
+
+	if( ( ulBitRate > 0UL ) && ( ulBitRate <= canMAX_BIT_RATE ) && ( usSamplePoint < 1000U ) && ( ucSJW <= canMAX_SJW ) )
+	{
+		/* Only the default bit timings are looked up, so a bit timing asked
+		for explicitly is always solved for. */
+		if( ( xDefaultTiming != pdFALSE ) && ( usSamplePoint == canCOMMON_BIT_TIMING_SAMPLE_POINT ) )
+		{
+			for( uxIndex = 0U; uxIndex < ( sizeof( xCommonBitTimings ) / sizeof( xCommonBitTimings[ 0 ] ) ); uxIndex++ )
+			{
+				if( ( xCommonBitTimings[ uxIndex ].ulPCLK == ulPCLK ) && ( xCommonBitTimings[ uxIndex ].ulBitRate == ulBitRate ) )
+				{
+					*pulBTR = xCommonBitTimings[ uxIndex ].ulBTR;
+					xReturn = pdPASS;
+					break;
+				}
+			}
+		}
+
+		if( xReturn == pdFAIL )
+		{
+			xReturn = prvSolveBitTiming( ulPCLK, ulBitRate, usSamplePoint, ucSJW, pulBTR );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteBitTiming( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBTR )
+{
+const uint32_t ulMode = pxCAN->MOD;
+
+	/* A controller that is in reset mode, for example because it is bus-off
+	and waiting to be restarted, is left in reset mode. */
+	pxCAN->MOD = ulMode | CAN_MOD_RM;
+	pxCAN->BTR = ulBTR;
+	pxCAN->MOD = ulMode;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteListenOnlyMode( LPC_CAN_TypeDef * const pxCAN, const portBASE_TYPE xListenOnly )
+{
+uint32_t ulMode = pxCAN->MOD;
+
+	/* CAN_ModeConfig() always takes the controller out of reset mode, which
+	would restart a bus-off controller before its back-off had passed, so the
+	reset mode bit is restored as prvWriteBitTiming() does. */
+	pxCAN->MOD = ulMode | CAN_MOD_RM;
+
+	if( xListenOnly != pdFALSE )
+	{
+		ulMode |= CAN_MOD_LOM;
+	}
+	else
+	{
+		ulMode &= ~CAN_MOD_LOM;
+	}
+
+	pxCAN->MOD = ulMode | CAN_MOD_RM;
+	pxCAN->MOD = ulMode;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGetBitTiming( LPC_CAN_TypeDef * const pxCAN, CAN_Bit_Timing_t * const pxTiming )
+{
+const uint32_t ulBTR = pxCAN->BTR;
+const uint32_t ulTimeQuanta = 1UL + canBTR_TSEG1( ulBTR ) + canBTR_TSEG2( ulBTR );
+const uint32_t ulClocksPerBit = canBTR_PRESCALER( ulBTR ) * ulTimeQuanta;
+
+	pxTiming->ulBTR = ulBTR;
+	pxTiming->ulBitRate = ( prvGetPCLK( pxCAN ) + ( ulClocksPerBit / 2UL ) ) / ulClocksPerBit;
+	pxTiming->usSamplePoint = ( uint16_t ) ( ( ( ( 1UL + canBTR_TSEG1( ulBTR ) ) * 1000UL ) + ( ulTimeQuanta / 2UL ) ) / ulTimeQuanta );
+	pxTiming->usPrescaler = ( uint16_t ) canBTR_PRESCALER( ulBTR );
+	pxTiming->ucTimeQuanta = ( uint8_t ) ulTimeQuanta;
+	pxTiming->ucTSEG1 = ( uint8_t ) canBTR_TSEG1( ulBTR );
+	pxTiming->ucTSEG2 = ( uint8_t ) canBTR_TSEG2( ulBTR );
+	pxTiming->ucSJW = ( uint8_t ) canBTR_SJW( ulBTR );
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvGetPCLK( LPC_CAN_TypeDef * const pxCAN )
+{
+	return CLKPWR_GetPCLK( ( pxCAN == LPC_CAN1 ) ? CLKPWR_PCLKSEL_CAN1 : CLKPWR_PCLKSEL_CAN2 );
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvDetectBitRate( CAN_Controller_State_t * const pxControllerState, CAN_Bit_Rate_Detection_t * const pxDetection )
+{
+LPC_CAN_TypeDef * const pxCAN = pxControllerState->pxCAN;
+const CAN_Statistics_t * const pxStatistics = &( pxControllerState->xStatistics );
+const uint32_t *pulBitRates = pxDetection->pulBitRates;
+unsigned portBASE_TYPE uxBitRates = ( unsigned portBASE_TYPE ) pxDetection->usNumberOfBitRates, uxIndex;
+portTickType xListenTicks = ( portTickType ) pxDetection->usListenTimeMs / portTICK_RATE_MS, xStartTime;
+uint32_t ulMode, ulOriginalBTR, ulBTR, ulFrames = 0UL, ulErrors, ulNewFrames, ulErrorsSeen, ulCleanFrames;
+CAN_MSG_Type xFrame;
+portBASE_TYPE xReturn = pdFAIL;
+
+	pxDetection->ulBitRate = 0UL;
+
+	if( pulBitRates == NULL )
+	{
+		pulBitRates = ulDetectableBitRates;
+		uxBitRates = sizeof( ulDetectableBitRates ) / sizeof( ulDetectableBitRates[ 0 ] );
+	}
+
+	if( xListenTicks == 0U )
+	{
+		xListenTicks = 1U;
+	}
+
+	if( ( uxBitRates > 0U ) && ( pxDetection->ucFramesToLock > 0U ) )
+	{
+		/* In listen only mode the controller neither acknowledges frames nor
+		sends error flags, and cannot transmit, so listening at a wrong bit
+		rate does not disturb the other nodes.  Its error counters are frozen,
+		but bus errors are still captured and counted by the ISR - so the bus
+		error interrupt is needed while listening even if the error interrupts
+		have not been enabled by ioctlSET_CAN_ERROR_INTERRUPTS. */
+		taskENTER_CRITICAL();
+		{
+			ulMode = pxCAN->MOD;
+			ulOriginalBTR = pxCAN->BTR;
+			prvWriteListenOnlyMode( pxCAN, pdTRUE );
+
+			if( pxControllerState->xErrorInterruptsEnabled == pdFALSE )
+			{
+				CAN_IRQCmd( pxCAN, CANINT_BEIE, ENABLE );
+				prvSetInterruptPriorities();
+				NVIC_EnableIRQ( CAN_IRQn );
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		for( uxIndex = 0U; ( uxIndex < uxBitRates ) && ( xReturn == pdFAIL ); uxIndex++ )
+		{
+			/* A bit rate that cannot be set from the peripheral clock is
+			skipped without listening. */
+			if( prvFindBitTiming( pxCAN, pulBitRates[ uxIndex ], 0U, 0U, &ulBTR ) == pdPASS )
+			{
+				taskENTER_CRITICAL();
+				{
+					prvWriteBitTiming( pxCAN, ulBTR );
+					ulFrames = pxStatistics->ulRxFrames;
+					ulErrors = canBUS_ERRORS( pxStatistics );
+				}
+				taskEXIT_CRITICAL();
+
+				/* Without interrupts nothing else reads the receive buffer, so
+				frames are read and discarded here, starting with any left
+				from before the bit timing was changed. */
+				if( pxControllerState->xInterruptsEnabled == pdFALSE )
+				{
+					while( CAN_ReceiveMsg( pxCAN, &xFrame ) == SUCCESS )
+					{
+						/* Discard the frame. */
+					}
+				}
+
+				ulErrorsSeen = 0UL;
+				ulCleanFrames = 0UL;
+				xStartTime = xTaskGetTickCount();
+
+				do
+				{
+					vTaskDelay( 1 );
+
+					if( pxControllerState->xInterruptsEnabled != pdFALSE )
+					{
+						ulNewFrames = pxStatistics->ulRxFrames - ulFrames;
+						ulFrames += ulNewFrames;
+					}
+					else
+					{
+						for( ulNewFrames = 0UL; CAN_ReceiveMsg( pxCAN, &xFrame ) == SUCCESS; ulNewFrames++ )
+						{
+							/* Discard the frame. */
+						}
+					}
+
+					/* Frames received in the same tick as a bus error are not
+					counted, as they may have come before it. */
+					if( canBUS_ERRORS( pxStatistics ) != ulErrors )
+					{
+						ulErrorsSeen += canBUS_ERRORS( pxStatistics ) - ulErrors;
+						ulErrors = canBUS_ERRORS( pxStatistics );
+						ulCleanFrames = 0UL;
+					}
+					else
+					{
+						ulCleanFrames += ulNewFrames;
+					}
+
+					if( ulCleanFrames >= ( uint32_t ) pxDetection->ucFramesToLock )
+					{
+						pxDetection->ulBitRate = pulBitRates[ uxIndex ];
+						xReturn = pdPASS;
+					}
+
+				} while( ( xReturn == pdFAIL ) && ( ulErrorsSeen < canDETECT_MAX_BUS_ERRORS ) && ( ( xTaskGetTickCount() - xStartTime ) < xListenTicks ) );
+			}
+		}
+
+		taskENTER_CRITICAL();
+		{
+			if( xReturn == pdPASS )
+			{
+				pxControllerState->ulBitRate = pxDetection->ulBitRate;
+			}
+			else
+			{
+				prvWriteBitTiming( pxCAN, ulOriginalBTR );
+			}
+
+			/* Listen only mode is left unless the controller was already in
+			it. */
+			prvWriteListenOnlyMode( pxCAN, ( ( ulMode & CAN_MOD_LOM ) != 0UL ) ? pdTRUE : pdFALSE );
+
+			if( pxControllerState->xErrorInterruptsEnabled == pdFALSE )
+			{
+				CAN_IRQCmd( pxCAN, CANINT_BEIE, DISABLE );
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvStartTimestampTimer( void )
+{
+	#if ioconfigUSE_CAN_TIMESTAMPS == 1
+	{
+	TIM_TIMERCFG_Type xTimerConfig;
+
+		/* TIM_Init() also powers the timer and resets its count.  The timer
+		is never stopped, and nothing else uses it, so the count wraps
+		naturally at 32 bits. */
+		xTimerConfig.PrescaleOption = TIM_PRESCALE_USVAL;
+		xTimerConfig.PrescaleValue = boardCAN_TIMESTAMP_RESOLUTION_US;
+		TIM_Init( boardCAN_TIMESTAMP_TIMER, TIM_TIMER_MODE, &xTimerConfig );
+		TIM_Cmd( boardCAN_TIMESTAMP_TIMER, ENABLE );
+	}
+	#endif /* ioconfigUSE_CAN_TIMESTAMPS */
+}
+/*-----------------------------------------------------------*/
+
+/*----------------------------------- CAN_write ------------------------------------------*/
+
+size_t FreeRTOS_CAN_write( Peripheral_Descriptor_t const pxPeripheral, const void *pvBuffer, const size_t xBytes )
+{
+Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
+LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
+CAN_Controller_State_t * const pxControllerState = prvCAN_CONTROLLER_STATE( pxPeripheralControl );
+size_t xReturn = 0U;
+uint32_t ulPayload[ 2 ] = { 0UL, 0UL };
+const size_t xPayloadBytes = canDLC_TO_BYTES( pxControllerState->xTxFrame.len );
+
+uint8_t self_rec=0; //Make this zero if communicating between two boards
+
+if( ( diGET_TX_TRANSFER_STRUCT( pxPeripheralControl ) != NULL ) && ( diGET_TX_TRANSFER_TYPE( pxPeripheralControl ) == ioctlUSE_CAN_FRAME_QUEUE_TX ) )
+{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+		{
+			/* pvBuffer points to an array of CAN_MSG_Type structures.  The
+			frames are sent in CAN ID priority order, not the order in which
+			they appear in the array. */
+			xReturn = prvWriteFramesToQueue( pxPeripheralControl, ( const CAN_MSG_Type * ) pvBuffer, xBytes / sizeof( CAN_MSG_Type ) );
+			xReturn *= sizeof( CAN_MSG_Type );
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+}
+else if( pxControllerState->xFrameBatchMode != pdFALSE )
+{
+		#if ioconfigUSE_CAN_POLLED_TX == 1
+		{
+			/* pvBuffer points to an array of CAN_MSG_Type structures, each of
+			which carries its own ID, format, type and length, so the ID and
+			length set by ioctl() are not used.  Only whole frames are sent. */
+			xReturn = prvWriteFramesPolled( pxCAN, ( CAN_MSG_Type * ) pvBuffer, xBytes / sizeof( CAN_MSG_Type ), pxControllerState->xTxBlockTime );
+			pxControllerState->xStatistics.ulTxFrames += ( uint32_t ) xReturn;
+			xReturn *= sizeof( CAN_MSG_Type );
+		}
+		#endif /* ioconfigUSE_CAN_POLLED_TX */
+}
+else
+{
+		#if ioconfigUSE_CAN_POLLED_TX == 1
+		{
+			/* pvBuffer holds the payload bytes of a single frame, the number
+			of which was set by ioctlSET_CAN_FRAME_LENGTH.  The payload is
+			moved into the frame as two whole words, which map directly onto
+			the TDA and TDB registers. */
+			memcpy( ulPayload, pvBuffer, xPayloadBytes );
+			pxControllerState->xTxFrame.dataAWord = ulPayload[ 0 ];
+			pxControllerState->xTxFrame.dataBWord = ulPayload[ 1 ];
+
+			if( prvSendMsg( pxCAN, &( pxControllerState->xTxFrame ), self_rec ) == SUCCESS )
+			{
+				( pxControllerState->xStatistics.ulTxFrames )++;
+				xReturn = xPayloadBytes;
+			}
+		}
+		#endif /* ioconfigUSE_CAN_POLLED_TX */
+}
+
+	return xReturn;
+}
+
+/*---------------------------------- CAN_read ---------------------------------------*/
+
+size_t FreeRTOS_CAN_read( Peripheral_Descriptor_t const pxPeripheral, void * const pvBuffer, const size_t xBytes )
+{
+Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
+LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
+CAN_Controller_State_t * const pxControllerState = prvCAN_CONTROLLER_STATE( pxPeripheralControl );
+size_t xReturn = 0U;
+
+if( ( diGET_RX_TRANSFER_STRUCT( pxPeripheralControl ) != NULL ) && ( diGET_RX_TRANSFER_TYPE( pxPeripheralControl ) == ioctlUSE_CAN_FRAME_QUEUE_RX ) )
+{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+		{
+		CAN_Rx_Priority_State_t *pxRxPriority;
+
+			/* The high priority queue cannot be replaced, and so freed, while
+			the read below might block with a pointer to it. */
+			taskENTER_CRITICAL();
+			{
+				pxRxPriority = pxControllerState->pxRxPriority;
+				pxControllerState->xRxQueueReadInProgress = pdTRUE;
+			}
+			taskEXIT_CRITICAL();
+
+			/* pvBuffer points to an array of CAN_MSG_Type structures, and only
+			whole frames are ever returned.  The frame queue is not protected
+			by a mutex, so the application must ensure only one task reads
+			from the peripheral at a time. */
+			if( pxRxPriority != NULL )
+			{
+				xReturn = prvReadFramesByPriority( pxRxPriority, prvCAN_FRAME_QUEUE_RX_STATE( pxPeripheralControl ), ( CAN_MSG_Type * ) pvBuffer, xBytes / sizeof( CAN_MSG_Type ) );
+			}
+			else
+			{
+				xReturn = prvReadFramesFromQueue( prvCAN_FRAME_QUEUE_RX_STATE( pxPeripheralControl ), ( CAN_MSG_Type * ) pvBuffer, xBytes / sizeof( CAN_MSG_Type ) );
+			}
+			xReturn *= sizeof( CAN_MSG_Type );
+
+			pxControllerState->xRxQueueReadInProgress = pdFALSE;
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+}
+
+else if( ( pxControllerState->xInterruptsEnabled == pdFALSE ) && ( pxControllerState->xFrameBatchMode != pdFALSE ) )
+{
+		#if ioconfigUSE_CAN_POLLED_RX == 1
+		{
+			/* Return as many whole frames as the controller has already
+			received, up to the number that fit in pvBuffer, without
+			blocking. */
+			xReturn = prvReadFramesPolled( pxCAN, ( CAN_MSG_Type * ) pvBuffer, xBytes / sizeof( CAN_MSG_Type ) );
+			pxControllerState->xStatistics.ulRxFrames += ( uint32_t ) xReturn;
+			xReturn *= sizeof( CAN_MSG_Type );
+		}
+		#endif /* ioconfigUSE_CAN_POLLED_RX */
+}
+
+else if( pxControllerState->xInterruptsEnabled == pdFALSE )
+{
+		#if ioconfigUSE_CAN_POLLED_RX == 1
+		{
+			/* Nothing is written to pvBuffer if no frame has been received. */
+			if( CAN_ReceiveMsg( pxCAN, &( pxControllerState->xRxFrame ) ) == SUCCESS )
+			{
+				( pxControllerState->xStatistics.ulRxFrames )++;
+				xReturn = prvCopyPayloadToBuffer( &( pxControllerState->xRxFrame ), pvBuffer );
+			}
+		}
+		#endif /* ioconfigUSE_CAN_POLLED_RX */
+}
+
+else
+{
+	if( ( pxControllerState->xFrameBatchMode != pdFALSE ) && ( xBytes < sizeof( CAN_MSG_Type ) ) )
+	{
+		/* Only whole frames are returned in frame batch mode. */
+		xReturn = 0U;
+	}
+	else if( xSemaphoreTake( pxControllerState->xRxSemaphore, portMAX_DELAY) == pdTRUE )
+	{
+		if( pxControllerState->xFrameBatchMode != pdFALSE )
+		{
+			/* Only the most recent frame is kept, so a single whole frame is
+			returned however many would fit in pvBuffer.  The ISR must not
+			replace the frame while it is being copied. */
+			taskENTER_CRITICAL();
+			{
+				*( ( CAN_MSG_Type * ) pvBuffer ) = pxControllerState->xRxFrame;
+			}
+			taskEXIT_CRITICAL();
+			xReturn = sizeof( CAN_MSG_Type );
+		}
+		else
+		{
+			xReturn = prvCopyPayloadToBuffer( &( pxControllerState->xRxFrame ), pvBuffer );
+		}
+	}
+	else
+	{
+		xReturn=0;
+	}
+}
+
+
+
+
+
+return xReturn;
+}
+
+
+/*---------------------------------- CAN_ioctl ---------------------------------------*/
+
+
+portBASE_TYPE FreeRTOS_CAN_ioctl( Peripheral_Descriptor_t pxPeripheral, uint32_t ulRequest, void *pvValue )
+{
+Peripheral_Control_t * const pxPeripheralControl = ( Peripheral_Control_t * const ) pxPeripheral;
+const int8_t cPeripheralNumber = diGET_PERIPHERAL_NUMBER( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
+LPC_CAN_TypeDef * pxCAN = ( LPC_CAN_TypeDef * ) diGET_PERIPHERAL_BASE_ADDRESS( ( ( Peripheral_Control_t * const ) pxPeripheral ) );
+CAN_Controller_State_t * const pxControllerState = prvCAN_CONTROLLER_STATE( pxPeripheralControl );
+CAN_PinCFG_Type xCANConfig;
+FunctionalState NewState;
+uint32_t ulValue = ( uint32_t ) pvValue;
+uint32_t ulBTR = 0UL;
+
+portBASE_TYPE xReturn = pdPASS;
+
+	if( ulRequest == ioctlUSE_CAN_FRAME_QUEUE_RX )
+	{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+		{
+			/* The frame queue is allocated from the heap, so it is created
+			before entering the critical section below.  pvValue holds the
+			number of frames the queue can hold. */
+			if( prvConfigureFrameQueueRx( pxPeripheralControl, ( unsigned portBASE_TYPE ) ulValue ) == pdPASS )
+			{
+				/* Frame queues can only be used when interrupts are also
+				used.  If the queue could not be created then ulRequest is
+				left unchanged, and the switch statement below will return
+				pdFAIL. */
+				ulRequest = ioctlUSE_INTERRUPTS;
+				ulValue = ( uint32_t ) pdTRUE;
+			}
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+	}
+	else if( ulRequest == ioctlUSE_CAN_FRAME_QUEUE_TX )
+	{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+		{
+			/* As above, the queue is created before entering the critical
+			section.  pvValue holds the number of frames the queue can hold. */
+			xReturn = prvConfigureFrameQueueTx( pxPeripheralControl, ( unsigned portBASE_TYPE ) ulValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+	}
+	else if( ulRequest == ioctlCOMPILE_CAN_FILTER_TABLE )
+	{
+		/* Sorting the entries and building the new table takes time and
+		uses the heap, so is done before entering the critical section.  The
+		function enters its own critical section to update the table. */
+		xReturn = prvCompileFilterTable( pxCAN, ( const CAN_Filter_Table_t * ) pvValue );
+	}
+	else if( ulRequest == ioctlSET_CAN_ANALYTICS )
+	{
+		#if ioconfigUSE_CAN_ANALYTICS == 1
+		{
+			/* The table of IDs is allocated from the heap, so is created
+			before entering the critical section.  pvValue holds the number of
+			IDs to track. */
+			xReturn = prvConfigureAnalytics( pxControllerState, ( unsigned portBASE_TYPE ) ulValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_ANALYTICS */
+	}
+	else if( ulRequest == ioctlSET_CAN_TX_DEADLINES )
+	{
+		#if ioconfigUSE_CAN_TX_DEADLINES == 1
+		{
+			/* The table of IDs is allocated from the heap, so is created
+			before entering the critical section.  pvValue holds the number of
+			IDs whose drops are counted. */
+			xReturn = prvSetTxDeadlines( pxControllerState, ( unsigned portBASE_TYPE ) ulValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+	}
+	else if( ulRequest == ioctlSET_CAN_CYCLIC_TX_TABLE )
+	{
+		#if ioconfigUSE_CAN_CYCLIC_TX == 1
+		{
+			/* The table is copied into memory allocated from the heap, and
+			choosing its offsets takes time, so this is done before entering
+			the critical section. */
+			xReturn = prvSetCyclicTxTable( pxControllerState, ( const CAN_Cyclic_Tx_Table_t * ) pvValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+	}
+	else if( ( ulRequest == ioctlSET_SPEED ) || ( ulRequest == ioctlSET_CAN_BIT_TIMING ) )
+	{
+		/* Solving for a bit timing that is not in xCommonBitTimings[] takes
+		time, so is also done before entering the critical section.  From here
+		on ulValue holds the bit rate. */
+		if( ulRequest == ioctlSET_SPEED )
+		{
+			xReturn = prvFindBitTiming( pxCAN, ulValue, 0U, 0U, &ulBTR );
+		}
+		else
+		{
+			ulValue = ( ( CAN_Bit_Timing_Request_t * ) pvValue )->ulBitRate;
+			xReturn = prvFindBitTiming( pxCAN, ulValue, ( ( CAN_Bit_Timing_Request_t * ) pvValue )->usSamplePoint, ( ( CAN_Bit_Timing_Request_t * ) pvValue )->ucSJW, &ulBTR );
+		}
+	}
+	else if( ulRequest == ioctlSET_CAN_ERROR_INTERRUPTS )
+	{
+		/* The timer that restarts the controller after it has gone bus-off
+		is created the first time the error interrupts are enabled, before
+		entering the critical section.  If the timer cannot be created the
+		controller is restarted as soon as it goes bus-off, without a
+		back-off. */
+		if( ( ulValue != pdFALSE ) && ( pxControllerState->xBusOffTimer == NULL ) )
+		{
+			pxControllerState->xBusOffBackOff = canBUS_OFF_MIN_BACK_OFF;
+			pxControllerState->xBusOffTimer = xTimerCreate( ( const signed char * ) "CANBusOff", canBUS_OFF_MIN_BACK_OFF, pdFALSE, ( void * ) pxControllerState, prvBusOffRecoveryCallback );
+		}
+	}
+	else if( ulRequest == ioctlDETECT_CAN_BIT_RATE )
+	{
+		/* Listening at each bit rate blocks the calling task, so cannot be
+		done within the critical section.  The function enters its own
+		critical sections to change the mode and bit timing. */
+		xReturn = prvDetectBitRate( pxControllerState, ( CAN_Bit_Rate_Detection_t * ) pvValue );
+	}
+	else if( ulRequest == ioctlSET_CAN_RX_PRIORITY )
+	{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+		{
+			/* The high priority queue is allocated from the heap, so is
+			created before entering the critical section. */
+			xReturn = prvSetRxPriority( pxPeripheralControl, ( const CAN_Rx_Priority_Config_t * ) pvValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+	}
+	else if( ulRequest == ioctlSET_CAN_TX_CONFIRMATION )
+	{
+		#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+		{
+			/* The confirmation queue is created before entering the critical
+			section. */
+			xReturn = prvSetTxConfirmation( pxControllerState, ( const CAN_Tx_Confirmation_Config_t * ) pvValue );
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+	}
+	else if( ulRequest == ioctlGET_CAN_TX_CONFIRMATION )
+	{
+		#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+		{
+			/* Waiting for a confirmation blocks the calling task, so cannot be
+			done within the critical section. */
+			if( ( pxControllerState->pxTxConfirmation == NULL ) || ( pxControllerState->pxTxConfirmation->xQueue == NULL ) )
+			{
+				xReturn = pdFAIL;
+			}
+			else
+			{
+				xReturn = xQueueReceive( pxControllerState->pxTxConfirmation->xQueue, pvValue, pxControllerState->pxTxConfirmation->xBlockTime );
+			}
+		}
+		#else
+		{
+			xReturn = pdFAIL;
+		}
+		#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+	}
+	else if( ulRequest == ioctlSET_CAN_ROUTING_TABLE )
+	{
+		/* The routes are copied into memory allocated from the heap, so this
+		is also done before entering the critical section. */
+		xReturn = prvSetRoutingTable( pxControllerState, ( const CAN_Routing_Table_t * ) pvValue );
+
+		if( ( xReturn == pdPASS ) && ( pxControllerState->usNumberOfRoutes > 0U ) )
+		{
+			/* Frames are forwarded from the Rx interrupt, so interrupts are
+			used from now on. */
+			ulRequest = ioctlUSE_INTERRUPTS;
+			ulValue = ( uint32_t ) pdTRUE;
+		}
+	}
+
+	taskENTER_CRITICAL();
+	{
+		switch( ulRequest )
+		{
+
+			case ioctlUSE_INTERRUPTS :
+					
+				if( ulValue == pdFALSE )
+				{
+					/* Both controllers share one interrupt, so only this
+					controller's Rx interrupt is disabled. */
+					CAN_IRQCmd( pxCAN, CANINT_RIE, DISABLE );
+					pxControllerState->xInterruptsEnabled = pdFALSE;
+				}
+				else
+				{
+					/* Enable the Rx  interrupt. */
+					CAN_IRQCmd (pxCAN,CANINT_RIE, ENABLE);
+
+					/* Enable the interrupt at the priority set by
+					ioctlSET_INTERRUPT_PRIORITY, which is the minimum interrupt
+					priority until a separate command raises it. */
+					prvSetInterruptPriorities();
+					NVIC_EnableIRQ(CAN_IRQn);
+					pxControllerState->xInterruptsEnabled = pdTRUE;
+
+					/* If the Rx is configured to use a frame queue, remember
+					the transfer control structure the ISR should use. */
+					pxRxTransferControlStructs[ canPERIPHERAL_INDEX( cPeripheralNumber ) ] = pxPeripheralControl->pxRxControl;
+				}
+				break;
+
+
+			case ioctlSET_CAN_ERROR_INTERRUPTS :
+
+				/* Both controllers share one interrupt, so only this
+				controller's error interrupts are changed.  Until they are
+				enabled the error counts of ioctlGET_CAN_STATISTICS stay at
+				zero, and a controller that goes bus-off stays off the bus. */
+				NewState = ( ulValue != pdFALSE ) ? ENABLE : DISABLE;
+				CAN_IRQCmd( pxCAN, CANINT_EIE, NewState );
+				CAN_IRQCmd( pxCAN, CANINT_DOIE, NewState );
+				CAN_IRQCmd( pxCAN, CANINT_EPIE, NewState );
+				CAN_IRQCmd( pxCAN, CANINT_ALIE, NewState );
+				CAN_IRQCmd( pxCAN, CANINT_BEIE, NewState );
+				pxControllerState->xErrorInterruptsEnabled = ( ulValue != pdFALSE ) ? pdTRUE : pdFALSE;
+
+				if( ulValue != pdFALSE )
+				{
+					prvSetInterruptPriorities();
+					NVIC_EnableIRQ( CAN_IRQn );
+				}
+				break;
+
+
+			case ioctlUSE_CAN_FRAME_QUEUE_TX :
+
+				if( xReturn == pdPASS )
+				{
+					/* Let the controller choose between the three Tx buffers
+					by CAN ID, rather than by the TFI priority field, so the
+					frame that would win arbitration on the bus is always sent
+					first. */
+					CAN_ModeConfig( pxCAN, CAN_TXPRIORITY_MODE, DISABLE );
+
+					/* Enable the Tx complete interrupt of each Tx buffer. */
+					CAN_IRQCmd( pxCAN, CANINT_TIE1, ENABLE );
+					CAN_IRQCmd( pxCAN, CANINT_TIE2, ENABLE );
+					CAN_IRQCmd( pxCAN, CANINT_TIE3, ENABLE );
+
+					prvSetInterruptPriorities();
+					NVIC_EnableIRQ( CAN_IRQn );
+
+					pxTxTransferControlStructs[ canPERIPHERAL_INDEX( cPeripheralNumber ) ] = pxPeripheralControl->pxTxControl;
+				}
+				break;
+
+
+			case ioctlSET_TX_TIMEOUT :
+
+				/* This request only reaches the peripheral when the Tx transfer
+				mode is one the generic FreeRTOS+IO code does not know about. */
+				if( ( pxPeripheralControl->pxTxControl != NULL ) && ( diGET_TX_TRANSFER_TYPE( pxPeripheralControl ) == ioctlUSE_CAN_FRAME_QUEUE_TX ) )
+				{
+					#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+					{
+						prvCAN_FRAME_QUEUE_TX_STATE( pxPeripheralControl )->xBlockTime = ( portTickType ) ulValue;
+					}
+					#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+				}
+				else if( pxPeripheralControl->pxTxControl == NULL )
+				{
+					/* Used by the polled batch write. */
+					pxControllerState->xTxBlockTime = ( portTickType ) ulValue;
+				}
+				else
+				{
+					xReturn = pdFAIL;
+				}
+				break;
+
+
+			case ioctlSET_RX_TIMEOUT :
+			case ioctlCLEAR_RX_BUFFER :
+			case ioctlGET_CAN_RX_OVERRUN_COUNT :
+
+				/* These requests only reach the peripheral when the Rx transfer
+				mode is one the generic FreeRTOS+IO code does not know about. */
+				if( ( pxPeripheralControl->pxRxControl != NULL ) && ( diGET_RX_TRANSFER_TYPE( pxPeripheralControl ) == ioctlUSE_CAN_FRAME_QUEUE_RX ) )
+				{
+					#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+					{
+					CAN_Frame_Queue_Rx_State_t * const pxQueueState = prvCAN_FRAME_QUEUE_RX_STATE( pxPeripheralControl );
+
+						if( ulRequest == ioctlSET_RX_TIMEOUT )
+						{
+							pxQueueState->xBlockTime = ( portTickType ) ulValue;
+						}
+						else if( ulRequest == ioctlCLEAR_RX_BUFFER )
+						{
+							/* Only the reading task moves the read index, or
+							the ISR, which cannot run within the critical
+							section, so discarding the queued frames is just a
+							matter of catching the read index up with the write
+							index. */
+							pxQueueState->usNextReadIndex = pxQueueState->usNextWriteIndex;
+							xSemaphoreTake( pxQueueState->xNewFrameSemaphore, 0U );
+
+							if( pxControllerState->pxRxPriority != NULL )
+							{
+								pxControllerState->pxRxPriority->xHighQueue.usNextReadIndex = pxControllerState->pxRxPriority->xHighQueue.usNextWriteIndex;
+							}
+						}
+						else
+						{
+							/* Counts the frames discarded by the high priority
+							queue too. */
+							*( ( uint32_t * ) pvValue ) = pxQueueState->ulOverrunCount;
+						}
+					}
+					#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+				}
+				else
+				{
+					xReturn = pdFAIL;
+				}
+				break;
+
+
+
+			case ioctlSET_SPEED :
+			case ioctlSET_CAN_BIT_TIMING :
+
+				/* The bit timing was found before the critical section was
+				entered.  It is only changed if one was found, so a bit rate
+				that cannot be set leaves the controller as it was. */
+				if( xReturn == pdPASS )
+				{
+					prvWriteBitTiming( pxCAN, ulBTR );
+					pxControllerState->ulBitRate = ulValue;
+				}
+				break;
+
+			case ioctlGET_CAN_BIT_TIMING :
+				prvGetBitTiming( pxCAN, ( CAN_Bit_Timing_t * ) pvValue );
+				break;
+
+			case ioctlDETECT_CAN_BIT_RATE :
+				/* Already handled before entering the critical section. */
+				break;
+
+
+			case ioctlSET_INTERRUPT_PRIORITY :
+
+				/* The ISR uses ISR safe FreeRTOS API functions, so the priority
+				being set must be lower than (ie numerically larger than)
+				configMAX_LIBRARY_INTERRUPT_PRIORITY. */
+				configASSERT( ulValue >= configMAX_LIBRARY_INTERRUPT_PRIORITY );
+				ulInterruptPriority = ulValue;
+				prvSetInterruptPriorities();
+				break;
+
+
+			case ioctlSET_CAN_STD_ID :
+				pxControllerState->xTxFrame.id = ulValue;
+				pxControllerState->xTxFrame.format = STD_ID_FORMAT;
+				break;
+
+			case ioctlSET_CAN_EXT_ID :
+
+				pxControllerState->xTxFrame.id = ulValue;
+				pxControllerState->xTxFrame.format = EXT_ID_FORMAT;
+				break;
+
+			case ioctlSET_CAN_FRAME_TYPE :
+				if(ulValue==0)
+				{
+				pxControllerState->xTxFrame.type =DATA_FRAME;
+				}
+				else
+				pxControllerState->xTxFrame.type =REMOTE_FRAME;
+				break;
+
+			case ioctlSET_CAN_CONFIG_SELFTEST_MODE :
+				if(ulValue == 0)
+				CAN_ModeConfig(pxCAN,CAN_SELFTEST_MODE,DISABLE);
+				else
+				CAN_ModeConfig(pxCAN,CAN_SELFTEST_MODE,ENABLE);
+				break;
+
+			case ioctlSET_CONFIG_CANAF_MODE_BYPASS :
+				if(ulValue == 1)
+				CAN_SetAFMode (LPC_CANAF,CAN_AccBP);
+				else
+				CAN_SetAFMode (LPC_CANAF,CAN_Normal);
+				break;
+
+			case ioctlSET_CAN_FRAME_LENGTH :
+				 pxControllerState->xTxFrame.len=ulValue;
+				break;
+
+			case ioctlSET_CAN_FRAME_BATCH_MODE :
+				pxControllerState->xFrameBatchMode = ( portBASE_TYPE ) ulValue;
+				break;
+
+			case ioctlADD_CAN_FILTER_ENTRY :
+				xReturn = prvAddFilterEntry( pxCAN, ( const CAN_Filter_Entry_t * ) pvValue );
+				break;
+
+			case ioctlREMOVE_CAN_FILTER_ENTRY :
+				xReturn = prvRemoveFilterEntry( pxCAN, ( const CAN_Filter_Entry_t * ) pvValue );
+				break;
+
+			case ioctlLOAD_CAN_FILTER_TABLE :
+				xReturn = prvLoadFilterTable( ( AF_SectionDef * ) pvValue );
+				break;
+
+			case ioctlCOMPILE_CAN_FILTER_TABLE :
+				/* Already handled before entering the critical section. */
+				break;
+
+			case ioctlADD_CAN_FULLCAN_ENTRY :
+				xReturn = prvAddFullCANEntry( pxCAN, ( uint16_t ) ulValue );
+				break;
+
+			case ioctlGET_CAN_FULLCAN_MAILBOX :
+				xReturn = prvGetFullCANMailbox( pxCAN, ( CAN_FullCAN_Mailbox_t * ) pvValue );
+				break;
+
+			case ioctlSET_CAN_FULLCAN_INTERRUPT :
+
+				/* FCANIE is shared by both controllers.  Objects the ISR has
+				already collected are still reported once the interrupt is
+				disabled again. */
+				if( ulValue != pdFALSE )
+				{
+					LPC_CANAF->FCANIE = 0x01UL;
+					prvSetInterruptPriorities();
+					NVIC_EnableIRQ( CAN_IRQn );
+				}
+				else
+				{
+					LPC_CANAF->FCANIE = 0x00UL;
+				}
+				break;
+
+			case ioctlGET_CAN_FULLCAN_UPDATES :
+				prvGetFullCANUpdates( ( uint32_t * ) pvValue );
+				break;
+
+			case ioctlSET_CAN_ROUTING_TABLE :
+				/* Already handled before entering the critical section. */
+				break;
+
+			case ioctlSET_CAN_RX_PRIORITY :
+				/* Already handled before entering the critical section. */
+				break;
+
+			case ioctlSET_CAN_TX_CONFIRMATION :
+			case ioctlGET_CAN_TX_CONFIRMATION :
+				/* Already handled before entering the critical section. */
+				break;
+
+			case ioctlGET_CAN_TX_CONFIRMATION_STATISTICS :
+				#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+				{
+					if( pxControllerState->pxTxConfirmation != NULL )
+					{
+						*( ( CAN_Tx_Confirmation_Statistics_t * ) pvValue ) = pxControllerState->pxTxConfirmation->xStatistics;
+					}
+					else
+					{
+						xReturn = pdFAIL;
+					}
+				}
+				#else
+				{
+					xReturn = pdFAIL;
+				}
+				#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+				break;
+
+			case ioctlSET_CAN_TX_DEADLINES :
+				/* Already handled before entering the critical section. */
+				break;
+
+			case ioctlGET_CAN_TX_DEADLINE_DROPS :
+			case ioctlGET_CAN_TX_DEADLINE_STATISTICS :
+
+				#if ioconfigUSE_CAN_TX_DEADLINES == 1
+				{
+					if( pxControllerState->pxTxDeadlines == NULL )
+					{
+						xReturn = pdFAIL;
+					}
+					else if( ulRequest == ioctlGET_CAN_TX_DEADLINE_DROPS )
+					{
+						xReturn = prvGetTxDeadlineDrops( pxControllerState->pxTxDeadlines, ( CAN_Tx_Deadline_Drops_t * ) pvValue );
+					}
+					else
+					{
+						*( ( CAN_Tx_Deadline_Statistics_t * ) pvValue ) = pxControllerState->pxTxDeadlines->xStatistics;
+					}
+				}
+				#else
+				{
+					xReturn = pdFAIL;
+				}
+				#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+				break;
+
+			case ioctlGET_CAN_RX_PRIORITY_STATISTICS :
+				if( pxControllerState->pxRxPriority != NULL )
+				{
+					*( ( CAN_Rx_Priority_Statistics_t * ) pvValue ) = pxControllerState->pxRxPriority->xStatistics;
+				}
+				else
+				{
+					xReturn = pdFAIL;
+				}
+				break;
+
+			case ioctlGET_CAN_ROUTE_DROP_COUNT :
+				*( ( uint32_t * ) pvValue ) = pxControllerState->ulRouteDropCount;
+				break;
+
+			case ioctlGET_CAN_STATISTICS :
+				ulValue = pxCAN->GSR;
+				*( ( CAN_Statistics_t * ) pvValue ) = pxControllerState->xStatistics;
+				( ( CAN_Statistics_t * ) pvValue )->ucTxErrorCounter = canGSR_TXERR( ulValue );
+				( ( CAN_Statistics_t * ) pvValue )->ucRxErrorCounter = canGSR_RXERR( ulValue );
+				break;
+
+			case ioctlCLEAR_CAN_STATISTICS :
+				memset( &( pxControllerState->xStatistics ), 0x00, sizeof( CAN_Statistics_t ) );
+				break;
+
+			case ioctlGET_CAN_TIMESTAMP :
+				*( ( uint32_t * ) pvValue ) = canGET_TIMESTAMP();
+				break;
+
+			case ioctlGET_CAN_TX_TIMESTAMP :
+				*( ( CAN_Tx_Timestamp_t * ) pvValue ) = pxControllerState->xTxTimestamp;
+				break;
+
+			case ioctlSET_CAN_ANALYTICS :
+				/* Already handled before the critical section was entered. */
+				break;
+
+			case ioctlGET_CAN_ID_ANALYTICS :
+			case ioctlGET_CAN_BUS_LOAD :
+			case ioctlCLEAR_CAN_ANALYTICS :
+
+				#if ioconfigUSE_CAN_ANALYTICS == 1
+				{
+					if( pxControllerState->pxAnalytics == NULL )
+					{
+						xReturn = pdFAIL;
+					}
+					else if( ulRequest == ioctlGET_CAN_ID_ANALYTICS )
+					{
+						xReturn = prvGetIDAnalytics( pxControllerState->pxAnalytics, ( CAN_ID_Analytics_t * ) pvValue );
+					}
+					else if( ulRequest == ioctlGET_CAN_BUS_LOAD )
+					{
+						prvGetBusLoad( pxControllerState, ( CAN_Bus_Load_t * ) pvValue );
+					}
+					else
+					{
+						/* Forget every ID and start a new bus load window. */
+						memset( pxControllerState->pxAnalytics->pxRecords, 0x00, sizeof( CAN_ID_Record_t ) * pxControllerState->pxAnalytics->usMaxIDs );
+						memset( pxControllerState->pxAnalytics->pusSlots, 0x00, sizeof( uint16_t ) * ( pxControllerState->pxAnalytics->usSlotMask + 1U ) );
+						pxControllerState->pxAnalytics->usIDsTracked = 0U;
+						pxControllerState->pxAnalytics->ulUntrackedFrames = 0UL;
+						pxControllerState->pxAnalytics->ulFrames = 0UL;
+						pxControllerState->pxAnalytics->ullBits = 0ULL;
+						pxControllerState->pxAnalytics->ulStartTime = canGET_TIMESTAMP();
+					}
+				}
+				#else
+				{
+					xReturn = pdFAIL;
+				}
+				#endif /* ioconfigUSE_CAN_ANALYTICS */
+				break;
+
+			case ioctlSET_CAN_CYCLIC_TX_TABLE :
+				/* Already handled before the critical section was entered. */
+				break;
+
+			case ioctlSET_CAN_CYCLIC_TX_DATA :
+			case ioctlGET_CAN_CYCLIC_TX_STATISTICS :
+
+				#if ioconfigUSE_CAN_CYCLIC_TX == 1
+				{
+				CAN_Cyclic_Tx_Schedule_t * const pxSchedule = pxControllerState->pxCyclicTx;
+				CAN_Cyclic_Tx_Entry_t *pxEntry;
+
+					/* Both requests start with the index of the message. */
+					if( ( pxSchedule == NULL ) || ( *( ( uint16_t * ) pvValue ) >= pxSchedule->usEntries ) )
+					{
+						xReturn = pdFAIL;
+					}
+					else if( ulRequest == ioctlSET_CAN_CYCLIC_TX_DATA )
+					{
+						pxEntry = &( pxSchedule->pxEntries[ ( ( CAN_Cyclic_Tx_Data_t * ) pvValue )->usIndex ] );
+						pxEntry->xFrame.dataAWord = ( ( CAN_Cyclic_Tx_Data_t * ) pvValue )->ulDataA;
+						pxEntry->xFrame.dataBWord = ( ( CAN_Cyclic_Tx_Data_t * ) pvValue )->ulDataB;
+					}
+					else
+					{
+						pxEntry = &( pxSchedule->pxEntries[ ( ( CAN_Cyclic_Tx_Statistics_t * ) pvValue )->usIndex ] );
+						( ( CAN_Cyclic_Tx_Statistics_t * ) pvValue )->usOffsetMs = pxEntry->usOffsetMs;
+						( ( CAN_Cyclic_Tx_Statistics_t * ) pvValue )->ulFramesSent = pxEntry->ulFramesSent;
+						( ( CAN_Cyclic_Tx_Statistics_t * ) pvValue )->ulFramesMissed = pxEntry->ulFramesMissed;
+						( ( CAN_Cyclic_Tx_Statistics_t * ) pvValue )->usPeakFramesPerMs = pxSchedule->usPeakFramesPerSlot;
+					}
+				}
+				#else
+				{
+					xReturn = pdFAIL;
+				}
+				#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+				break;
+
+			case ioctlADD_CAN_LAYER :
+
+				/* The layers receive, and pace the frames they send, from the
+				CAN interrupt, so the controller uses interrupts from now
+				on. */
+				xReturn = prvAddLayer( pxControllerState, ( CAN_Layer_t * ) pvValue );
+
+				if( xReturn == pdPASS )
+				{
+					CAN_IRQCmd( pxCAN, CANINT_RIE, ENABLE );
+					CAN_IRQCmd( pxCAN, CANINT_TIE1, ENABLE );
+					CAN_IRQCmd( pxCAN, CANINT_TIE2, ENABLE );
+					CAN_IRQCmd( pxCAN, CANINT_TIE3, ENABLE );
+					pxControllerState->xInterruptsEnabled = pdTRUE;
+					prvSetInterruptPriorities();
+					NVIC_EnableIRQ( CAN_IRQn );
+				}
+				break;
+
+			case ioctlREMOVE_CAN_LAYER :
+				xReturn = prvRemoveLayer( pxControllerState, ( CAN_Layer_t * ) pvValue );
+				break;
+
+			default :
+				xReturn = pdFAIL;
+				break;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return xReturn;
+}
+
+
+/*---------------------------- Polled frame batches -------------------------------*/
+
+#if ioconfigUSE_CAN_POLLED_TX == 1
+
+static size_t prvWriteFramesPolled( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrames, const size_t xFramesToWrite, portTickType xBlockTime )
+{
+size_t xFramesWritten;
+const uint32_t ulTxBuffersFree = ( CAN_SR_TBS1 | CAN_SR_TBS2 | CAN_SR_TBS3 );
+xTimeOutType xTimeOut;
+
+	vTaskSetTimeOutState( &xTimeOut );
+
+	for( xFramesWritten = 0U; xFramesWritten < xFramesToWrite; xFramesWritten++ )
+	{
+		/* No FreeRTOS objects exist to signal that a Tx buffer has become
+		free, so check once a tick.  A frame that nothing acknowledges is
+		retransmitted indefinitely without the controller going bus-off, so
+		the wait is bounded by the Tx timeout, and the frames not yet sent are
+		left to the caller. */
+		while( ( pxCAN->SR & ulTxBuffersFree ) == 0UL )
+		{
+			if( ( ( pxCAN->SR & CAN_SR_BS ) != 0UL ) || ( xTaskCheckForTimeOut( &xTimeOut, &xBlockTime ) != pdFALSE ) )
+			{
+				break;
+			}
+
+			vTaskDelay( 1 );
+		}
+
+		if( prvSendMsg( pxCAN, &( pxFrames[ xFramesWritten ] ), 0U ) != SUCCESS )
+		{
+			break;
+		}
+	}
+
+	return xFramesWritten;
+}
+/*-----------------------------------------------------------*/
+
+static Status prvSendMsg( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrame, const uint8_t ucSelfReception )
+{
+Status xReturn;
+
+	#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+	{
+	CAN_Tx_Confirmation_State_t *pxConfirmation;
+	uint32_t ulStatus, ulBuffer;
+
+		/* CAN_SendMsg() takes the lowest numbered free buffer.  The ISR must
+		not load a buffer between it being chosen here and being filled. */
+		taskENTER_CRITICAL();
+		{
+			pxConfirmation = pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxConfirmation;
+
+			if( pxConfirmation != NULL )
+			{
+				ulStatus = pxCAN->SR;
+
+				for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+				{
+					if( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL )
+					{
+						prvRecordTxFrame( pxConfirmation, pxCAN, ulBuffer, pxFrame );
+						break;
+					}
+				}
+			}
+
+			xReturn = CAN_SendMsg( pxCAN, pxFrame, ucSelfReception );
+		}
+		taskEXIT_CRITICAL();
+	}
+	#else
+	{
+		xReturn = CAN_SendMsg( pxCAN, pxFrame, ucSelfReception );
+	}
+	#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+
+	return xReturn;
+}
+
+#endif /* ioconfigUSE_CAN_POLLED_TX */
+/*-----------------------------------------------------------*/
+
+#if ioconfigUSE_CAN_POLLED_RX == 1
+
+static size_t prvReadFramesPolled( LPC_CAN_TypeDef * const pxCAN, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead )
+{
+size_t xFramesRead;
+
+	for( xFramesRead = 0U; xFramesRead < xFramesToRead; xFramesRead++ )
+	{
+		/* CAN_ReceiveMsg() returns ERROR when the receive buffer is empty. */
+		if( CAN_ReceiveMsg( pxCAN, &( pxFrames[ xFramesRead ] ) ) != SUCCESS )
+		{
+			break;
+		}
+
+		/* The frame is stamped with the time it was polled, which may be
+		long after it was received. */
+		pxFrames[ xFramesRead ].timestamp = canGET_TIMESTAMP();
+
+		#if ioconfigUSE_CAN_ANALYTICS == 1
+		{
+			if( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxAnalytics != NULL )
+			{
+				taskENTER_CRITICAL();
+				{
+					prvAnalyseFrameFromISR( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxAnalytics, &( pxFrames[ xFramesRead ] ) );
+				}
+				taskEXIT_CRITICAL();
+			}
+		}
+		#endif /* ioconfigUSE_CAN_ANALYTICS */
+	}
+
+	return xFramesRead;
+}
+
+#endif /* ioconfigUSE_CAN_POLLED_RX */
+/*-----------------------------------------------------------*/
+
+static size_t prvCopyPayloadToBuffer( const CAN_MSG_Type * const pxFrame, void * const pvBuffer )
+{
+const size_t xPayloadBytes = canDLC_TO_BYTES( pxFrame->len );
+uint64_t ullPayload;
+
+	/* dataA holds the first four payload bytes and dataB the last four, so on
+	this little endian part the payload is just the two words side by side.
+	Bytes beyond the DLC are masked off.  Only DLCs below 8 are masked, so a
+	DLC of zero gives an empty payload and no shift is ever out of range. */
+	ullPayload = ( ( uint64_t ) pxFrame->dataBWord << 32ULL ) | ( uint64_t ) pxFrame->dataAWord;
+
+	if( xPayloadBytes < canMAX_PAYLOAD_BYTES )
+	{
+		ullPayload &= ( ( uint64_t ) 1ULL << ( xPayloadBytes * 8U ) ) - 1ULL;
+	}
+
+	memcpy( pvBuffer, &ullPayload, sizeof( ullPayload ) );
+
+	return xPayloadBytes;
+}
+
+/*---------------------------- Acceptance filter ---------------------------------*/
+
+/* The acceptance filter look up table is shared by both CAN controllers.  These
+functions are only called from within the critical section in
+FreeRTOS_CAN_ioctl(), which also protects the table size variables maintained
+by the CAN library. */
+
+static portBASE_TYPE prvAddFilterEntry( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Entry_t * const pxEntry )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulAFMode = LPC_CANAF->AFMR;
+CAN_ERROR xResult;
+
+	configASSERT( pxEntry );
+
+	if( pxEntry->ulLowerID == pxEntry->ulUpperID )
+	{
+		xResult = CAN_LoadExplicitEntry( pxCAN, pxEntry->ulLowerID, ( CAN_ID_FORMAT_Type ) pxEntry->ucFormat );
+	}
+	else
+	{
+		xResult = CAN_LoadGroupEntry( pxCAN, pxEntry->ulLowerID, pxEntry->ulUpperID, ( CAN_ID_FORMAT_Type ) pxEntry->ucFormat );
+	}
+
+	if( xResult == CAN_OK )
+	{
+		/* The library leaves the acceptance filter in normal (or FullCAN)
+		mode, so only the IDs in the table are now received. */
+		xReturn = pdPASS;
+	}
+	else
+	{
+		/* The library can return with the acceptance filter switched off,
+		which would stop all reception. */
+		LPC_CANAF->AFMR = ulAFMode;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvRemoveFilterEntry( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Entry_t * const pxEntry )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulController = ( pxCAN == LPC_CAN1 ) ? 0UL : 1UL;
+AFLUT_ENTRY_Type xEntryType;
+uint32_t ulWanted, ulWantedUpper, ulWord, ulFirstWord, ulEntry, ulPosition, ulCount;
+
+	configASSERT( pxEntry );
+
+	/* CAN_RemoveEntry() takes the position of the entry within its section of
+	the look up table, so first search the section for an entry that matches
+	both the controller and the IDs. */
+	if( pxEntry->ucFormat == STD_ID_FORMAT )
+	{
+		ulWanted = ( ulController << canAF_STD_CONTROLLER_SHIFT ) | ( pxEntry->ulLowerID & 0x7FFUL );
+		ulWantedUpper = ( ulController << canAF_STD_CONTROLLER_SHIFT ) | ( pxEntry->ulUpperID & 0x7FFUL );
+
+		if( pxEntry->ulLowerID == pxEntry->ulUpperID )
+		{
+			/* Two 16 bit entries are packed into each word, the first in the
+			upper half. */
+			xEntryType = EXPLICIT_STANDARD_ENTRY;
+			ulFirstWord = LPC_CANAF->SFF_sa >> 2UL;
+			ulCount = CANAF_std_cnt;
+		}
+		else
+		{
+			/* Each word holds the lower bound in its upper half and the upper
+			bound in its lower half. */
+			xEntryType = GROUP_STANDARD_ENTRY;
+			ulFirstWord = LPC_CANAF->SFF_GRP_sa >> 2UL;
+			ulCount = CANAF_gstd_cnt;
+		}
+	}
+	else
+	{
+		ulWanted = ( ulController << canAF_EXT_CONTROLLER_SHIFT ) | pxEntry->ulLowerID;
+		ulWantedUpper = ( ulController << canAF_EXT_CONTROLLER_SHIFT ) | pxEntry->ulUpperID;
+
+		if( pxEntry->ulLowerID == pxEntry->ulUpperID )
+		{
+			/* One word per entry. */
+			xEntryType = EXPLICIT_EXTEND_ENTRY;
+			ulFirstWord = LPC_CANAF->EFF_sa >> 2UL;
+			ulCount = CANAF_ext_cnt;
+		}
+		else
+		{
+			/* Two words per entry, the lower bound first. */
+			xEntryType = GROUP_EXTEND_ENTRY;
+			ulFirstWord = LPC_CANAF->EFF_GRP_sa >> 2UL;
+			ulCount = CANAF_gext_cnt;
+		}
+	}
+
+	for( ulPosition = 0UL; ulPosition < ulCount; ulPosition++ )
+	{
+		switch( xEntryType )
+		{
+			case EXPLICIT_STANDARD_ENTRY :
+				ulWord = LPC_CANAF_RAM->mask[ ulFirstWord + ( ulPosition >> 1UL ) ];
+				ulEntry = ( ( ulPosition & 0x01UL ) == 0UL ) ? ( ulWord >> 16UL ) : ulWord;
+				xReturn = ( ( ulEntry & canAF_STD_ENTRY_MASK ) == ulWanted );
+				break;
+
+			case GROUP_STANDARD_ENTRY :
+				ulWord = LPC_CANAF_RAM->mask[ ulFirstWord + ulPosition ];
+				xReturn = ( ( ( ( ulWord >> 16UL ) & canAF_STD_ENTRY_MASK ) == ulWanted ) && ( ( ulWord & canAF_STD_ENTRY_MASK ) == ulWantedUpper ) );
+				break;
+
+			case EXPLICIT_EXTEND_ENTRY :
+				xReturn = ( LPC_CANAF_RAM->mask[ ulFirstWord + ulPosition ] == ulWanted );
+				break;
+
+			default :
+				ulWord = ulFirstWord + ( ulPosition << 1UL );
+				xReturn = ( ( LPC_CANAF_RAM->mask[ ulWord ] == ulWanted ) && ( LPC_CANAF_RAM->mask[ ulWord + 1UL ] == ulWantedUpper ) );
+				break;
+		}
+
+		if( xReturn != pdFALSE )
+		{
+			break;
+		}
+	}
+
+	if( xReturn != pdFALSE )
+	{
+		if( CAN_RemoveEntry( xEntryType, ( uint16_t ) ulPosition ) == CAN_OK )
+		{
+			/* The library always leaves the acceptance filter in FullCAN
+			mode, which is only wanted if there are FullCAN entries. */
+			if( CANAF_FullCAN_cnt == 0U )
+			{
+				CAN_SetAFMode( LPC_CANAF, CAN_Normal );
+			}
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvLoadFilterTable( AF_SectionDef * const pxTable )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulAFMode = LPC_CANAF->AFMR;
+
+	configASSERT( pxTable );
+
+	/* CAN_SetupAFLUT() adds to the table size variables rather than setting
+	them, so they must be zeroed for the new table to replace the old one. */
+	CANAF_FullCAN_cnt = 0U;
+	CANAF_std_cnt = 0U;
+	CANAF_gstd_cnt = 0U;
+	CANAF_ext_cnt = 0U;
+	CANAF_gext_cnt = 0U;
+
+	/* Note CAN_SetupAFLUT() advances the section pointers held in pxTable as
+	it reads each section, so pxTable cannot be used again without being
+	reinitialised. */
+	if( CAN_SetupAFLUT( LPC_CANAF, pxTable ) == CAN_OK )
+	{
+		xReturn = pdPASS;
+	}
+	else
+	{
+		/* The table is only partially written, so receive nothing rather
+		than an arbitrary subset of the wanted IDs, unless the filter was
+		bypassed anyway. */
+		if( ulAFMode == 0x02UL )
+		{
+			LPC_CANAF->AFMR = ulAFMode;
+		}
+	}
+
+	return xReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+/* Returns pdTRUE if pxEntry1 should be placed before pxEntry2 in the sorted
+list of filter entries - all the standard ID entries first, each format in
+ascending order of lower ID. */
+static portBASE_TYPE prvFilterEntryPrecedes( const CAN_Filter_Entry_t * const pxEntry1, const CAN_Filter_Entry_t * const pxEntry2 )
+{
+portBASE_TYPE xReturn;
+
+	if( pxEntry1->ucFormat != pxEntry2->ucFormat )
+	{
+		xReturn = ( pxEntry1->ucFormat == STD_ID_FORMAT );
+	}
+	else
+	{
+		xReturn = ( pxEntry1->ulLowerID < pxEntry2->ulLowerID );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+/* Place the 16 bit standard ID entry ulEntry at position ulPosition of the
+section that starts at word ulFirstWord of the table image.  Two entries are
+packed into each word, the first in the upper half.  A lone entry in the last
+word is paired with a disabled entry, as required by the acceptance filter. */
+static void prvPackStdEntry( uint32_t * const pulImage, const uint32_t ulFirstWord, const uint32_t ulPosition, const uint32_t ulEntry )
+{
+const uint32_t ulWord = ulFirstWord + ( ulPosition >> 1UL );
+
+	if( ulWord < canAF_LUT_SIZE_WORDS )
+	{
+		if( ( ulPosition & 0x01UL ) == 0UL )
+		{
+			pulImage[ ulWord ] = ( ulEntry << 16UL ) | 0xFFFFUL;
+		}
+		else
+		{
+			pulImage[ ulWord ] = ( pulImage[ ulWord ] & 0xFFFF0000UL ) | ulEntry;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvPackWord( uint32_t * const pulImage, const uint32_t ulWord, const uint32_t ulValue )
+{
+	if( ulWord < canAF_LUT_SIZE_WORDS )
+	{
+		pulImage[ ulWord ] = ulValue;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvCompileFilterTable( LPC_CAN_TypeDef * const pxCAN, const CAN_Filter_Table_t * const pxTable )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulController = ( pxCAN == LPC_CAN1 ) ? 0UL : 1UL;
+CAN_Filter_Entry_t *pxEntries = NULL, xEntry;
+uint32_t *pulImage;
+uint32_t ulNumberOfEntries = 0UL, ulEntry, ulGap, ulSorted, ulPass, ulOld, ulWord, ulValue;
+uint32_t ulFirstWord, ulNextWord, ulOldFirstWord, ulStdCount, ulStdGroupCount, ulExtCount, ulExtGroupCount;
+
+	configASSERT( pxTable );
+
+	pulImage = ( uint32_t * ) pvPortMalloc( canAF_LUT_SIZE_WORDS * sizeof( uint32_t ) );
+
+	if( pxTable->usNumberOfEntries > 0U )
+	{
+		pxEntries = ( CAN_Filter_Entry_t * ) pvPortMalloc( pxTable->usNumberOfEntries * sizeof( CAN_Filter_Entry_t ) );
+	}
+
+	if( ( pulImage != NULL ) && ( ( pxEntries != NULL ) || ( pxTable->usNumberOfEntries == 0U ) ) )
+	{
+		/* Take a copy of the entries so they can be sorted, making sure the
+		IDs are within range and each lower ID is not above its upper ID. */
+		for( ulEntry = 0UL; ulEntry < pxTable->usNumberOfEntries; ulEntry++ )
+		{
+			xEntry = pxTable->pxEntries[ ulEntry ];
+			ulValue = ( xEntry.ucFormat == STD_ID_FORMAT ) ? 0x7FFUL : 0x1FFFFFFFUL;
+			xEntry.ulLowerID &= ulValue;
+			xEntry.ulUpperID &= ulValue;
+
+			if( xEntry.ulLowerID > xEntry.ulUpperID )
+			{
+				ulValue = xEntry.ulLowerID;
+				xEntry.ulLowerID = xEntry.ulUpperID;
+				xEntry.ulUpperID = ulValue;
+			}
+
+			pxEntries[ ulEntry ] = xEntry;
+		}
+
+		/* Shell sort the entries, which needs no extra memory and copes well
+		with lists of several hundred entries. */
+		for( ulGap = pxTable->usNumberOfEntries >> 1UL; ulGap > 0UL; ulGap >>= 1UL )
+		{
+			for( ulSorted = ulGap; ulSorted < pxTable->usNumberOfEntries; ulSorted++ )
+			{
+				xEntry = pxEntries[ ulSorted ];
+
+				for( ulEntry = ulSorted; ( ulEntry >= ulGap ) && ( prvFilterEntryPrecedes( &xEntry, &( pxEntries[ ulEntry - ulGap ] ) ) != pdFALSE ); ulEntry -= ulGap )
+				{
+					pxEntries[ ulEntry ] = pxEntries[ ulEntry - ulGap ];
+				}
+
+				pxEntries[ ulEntry ] = xEntry;
+			}
+		}
+
+		/* Merge entries that overlap or are adjacent into ranges.  A run of
+		consecutive IDs then costs one group entry instead of an explicit entry
+		per ID. */
+		for( ulEntry = 0UL; ulEntry < pxTable->usNumberOfEntries; ulEntry++ )
+		{
+			if( ( ulNumberOfEntries > 0UL ) && ( pxEntries[ ulNumberOfEntries - 1UL ].ucFormat == pxEntries[ ulEntry ].ucFormat ) && ( pxEntries[ ulEntry ].ulLowerID <= ( pxEntries[ ulNumberOfEntries - 1UL ].ulUpperID + 1UL ) ) )
+			{
+				if( pxEntries[ ulEntry ].ulUpperID > pxEntries[ ulNumberOfEntries - 1UL ].ulUpperID )
+				{
+					pxEntries[ ulNumberOfEntries - 1UL ].ulUpperID = pxEntries[ ulEntry ].ulUpperID;
+				}
+			}
+			else
+			{
+				pxEntries[ ulNumberOfEntries ] = pxEntries[ ulEntry ];
+				ulNumberOfEntries++;
+			}
+		}
+
+		/* The table is sorted by controller number then ID, so within each
+		section the entries of CAN1 come before those of CAN2.  The new entries
+		therefore never need to be merged with those of the other controller,
+		which are copied across from the current table unchanged.  That has to
+		be done in a critical section, as does the update itself. */
+		taskENTER_CRITICAL();
+		{
+			ulFirstWord = ( CANAF_FullCAN_cnt + 1UL ) >> 1UL;
+
+			/* Explicit standard IDs. */
+			ulStdCount = 0UL;
+			ulOldFirstWord = LPC_CANAF->SFF_sa >> 2UL;
+			for( ulPass = 0UL; ulPass < 2UL; ulPass++ )
+			{
+				if( ulPass == ulController )
+				{
+					for( ulEntry = 0UL; ulEntry < ulNumberOfEntries; ulEntry++ )
+					{
+						if( ( pxEntries[ ulEntry ].ucFormat == STD_ID_FORMAT ) && ( pxEntries[ ulEntry ].ulLowerID == pxEntries[ ulEntry ].ulUpperID ) )
+						{
+							prvPackStdEntry( pulImage, ulFirstWord, ulStdCount, ( ulController << canAF_STD_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulLowerID );
+							ulStdCount++;
+						}
+					}
+				}
+				else
+				{
+					for( ulOld = 0UL; ulOld < CANAF_std_cnt; ulOld++ )
+					{
+						ulWord = LPC_CANAF_RAM->mask[ ulOldFirstWord + ( ulOld >> 1UL ) ];
+						ulValue = ( ( ulOld & 0x01UL ) == 0UL ) ? ( ulWord >> 16UL ) : ( ulWord & 0xFFFFUL );
+
+						if( ( ( ulValue >> canAF_STD_CONTROLLER_SHIFT ) & canAF_CONTROLLER_MASK ) == ulPass )
+						{
+							prvPackStdEntry( pulImage, ulFirstWord, ulStdCount, ulValue );
+							ulStdCount++;
+						}
+					}
+				}
+			}
+			ulNextWord = ulFirstWord + ( ( ulStdCount + 1UL ) >> 1UL );
+
+			/* Groups of standard IDs, one word each. */
+			ulStdGroupCount = 0UL;
+			ulFirstWord = ulNextWord;
+			ulOldFirstWord = LPC_CANAF->SFF_GRP_sa >> 2UL;
+			for( ulPass = 0UL; ulPass < 2UL; ulPass++ )
+			{
+				if( ulPass == ulController )
+				{
+					for( ulEntry = 0UL; ulEntry < ulNumberOfEntries; ulEntry++ )
+					{
+						if( ( pxEntries[ ulEntry ].ucFormat == STD_ID_FORMAT ) && ( pxEntries[ ulEntry ].ulLowerID != pxEntries[ ulEntry ].ulUpperID ) )
+						{
+							ulValue = ( ( ( ulController << canAF_STD_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulLowerID ) << 16UL ) | ( ulController << canAF_STD_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulUpperID;
+							prvPackWord( pulImage, ulFirstWord + ulStdGroupCount, ulValue );
+							ulStdGroupCount++;
+						}
+					}
+				}
+				else
+				{
+					for( ulOld = 0UL; ulOld < CANAF_gstd_cnt; ulOld++ )
+					{
+						ulValue = LPC_CANAF_RAM->mask[ ulOldFirstWord + ulOld ];
+
+						if( ( ( ulValue >> ( canAF_STD_CONTROLLER_SHIFT + 16UL ) ) & canAF_CONTROLLER_MASK ) == ulPass )
+						{
+							prvPackWord( pulImage, ulFirstWord + ulStdGroupCount, ulValue );
+							ulStdGroupCount++;
+						}
+					}
+				}
+			}
+			ulNextWord = ulFirstWord + ulStdGroupCount;
+
+			/* Explicit extended IDs, one word each. */
+			ulExtCount = 0UL;
+			ulFirstWord = ulNextWord;
+			ulOldFirstWord = LPC_CANAF->EFF_sa >> 2UL;
+			for( ulPass = 0UL; ulPass < 2UL; ulPass++ )
+			{
+				if( ulPass == ulController )
+				{
+					for( ulEntry = 0UL; ulEntry < ulNumberOfEntries; ulEntry++ )
+					{
+						if( ( pxEntries[ ulEntry ].ucFormat == EXT_ID_FORMAT ) && ( pxEntries[ ulEntry ].ulLowerID == pxEntries[ ulEntry ].ulUpperID ) )
+						{
+							prvPackWord( pulImage, ulFirstWord + ulExtCount, ( ulController << canAF_EXT_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulLowerID );
+							ulExtCount++;
+						}
+					}
+				}
+				else
+				{
+					for( ulOld = 0UL; ulOld < CANAF_ext_cnt; ulOld++ )
+					{
+						ulValue = LPC_CANAF_RAM->mask[ ulOldFirstWord + ulOld ];
+
+						if( ( ( ulValue >> canAF_EXT_CONTROLLER_SHIFT ) & canAF_CONTROLLER_MASK ) == ulPass )
+						{
+							prvPackWord( pulImage, ulFirstWord + ulExtCount, ulValue );
+							ulExtCount++;
+						}
+					}
+				}
+			}
+			ulNextWord = ulFirstWord + ulExtCount;
+
+			/* Groups of extended IDs, two words each. */
+			ulExtGroupCount = 0UL;
+			ulFirstWord = ulNextWord;
+			ulOldFirstWord = LPC_CANAF->EFF_GRP_sa >> 2UL;
+			for( ulPass = 0UL; ulPass < 2UL; ulPass++ )
+			{
+				if( ulPass == ulController )
+				{
+					for( ulEntry = 0UL; ulEntry < ulNumberOfEntries; ulEntry++ )
+					{
+						if( ( pxEntries[ ulEntry ].ucFormat == EXT_ID_FORMAT ) && ( pxEntries[ ulEntry ].ulLowerID != pxEntries[ ulEntry ].ulUpperID ) )
+						{
+							prvPackWord( pulImage, ulFirstWord + ( ulExtGroupCount << 1UL ), ( ulController << canAF_EXT_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulLowerID );
+							prvPackWord( pulImage, ulFirstWord + ( ulExtGroupCount << 1UL ) + 1UL, ( ulController << canAF_EXT_CONTROLLER_SHIFT ) | pxEntries[ ulEntry ].ulUpperID );
+							ulExtGroupCount++;
+						}
+					}
+				}
+				else
+				{
+					for( ulOld = 0UL; ulOld < CANAF_gext_cnt; ulOld++ )
+					{
+						ulValue = LPC_CANAF_RAM->mask[ ulOldFirstWord + ( ulOld << 1UL ) ];
+
+						if( ( ( ulValue >> canAF_EXT_CONTROLLER_SHIFT ) & canAF_CONTROLLER_MASK ) == ulPass )
+						{
+							prvPackWord( pulImage, ulFirstWord + ( ulExtGroupCount << 1UL ), ulValue );
+							prvPackWord( pulImage, ulFirstWord + ( ulExtGroupCount << 1UL ) + 1UL, LPC_CANAF_RAM->mask[ ulOldFirstWord + ( ulOld << 1UL ) + 1UL ] );
+							ulExtGroupCount++;
+						}
+					}
+				}
+			}
+			ulNextWord = ulFirstWord + ( ulExtGroupCount << 1UL );
+
+			/* The FullCAN message objects are stored after the end of the
+			table, so must also fit. */
+			if( ( ulNextWord + ( CANAF_FullCAN_cnt * canAF_FULLCAN_OBJECT_WORDS ) ) <= canAF_LUT_SIZE_WORDS )
+			{
+				/* The FullCAN section is not changed, so the copy starts at
+				the explicit standard ID section. */
+				LPC_CANAF->AFMR = 0x01UL;
+
+				for( ulWord = ( ( CANAF_FullCAN_cnt + 1UL ) >> 1UL ); ulWord < ulNextWord; ulWord++ )
+				{
+					LPC_CANAF_RAM->mask[ ulWord ] = pulImage[ ulWord ];
+				}
+
+				CANAF_std_cnt = ( uint16_t ) ulStdCount;
+				CANAF_gstd_cnt = ( uint16_t ) ulStdGroupCount;
+				CANAF_ext_cnt = ( uint16_t ) ulExtCount;
+				CANAF_gext_cnt = ( uint16_t ) ulExtGroupCount;
+
+				prvSetFilterSectionAddresses();
+
+				if( CANAF_FullCAN_cnt == 0U )
+				{
+					CAN_SetAFMode( LPC_CANAF, CAN_Normal );
+				}
+				else
+				{
+					CAN_SetAFMode( LPC_CANAF, CAN_eFCAN );
+				}
+
+				xReturn = pdPASS;
+			}
+		}
+		taskEXIT_CRITICAL();
+	}
+
+	vPortFree( pxEntries );
+	vPortFree( pulImage );
+
+	return xReturn;
+}
+
+/*-----------------------------------------------------------*/
+
+static void prvSetFilterSectionAddresses( void )
+{
+	LPC_CANAF->SFF_sa = ( ( CANAF_FullCAN_cnt + 1UL ) >> 1UL ) << 2UL;
+	LPC_CANAF->SFF_GRP_sa = LPC_CANAF->SFF_sa + ( ( ( CANAF_std_cnt + 1UL ) >> 1UL ) << 2UL );
+	LPC_CANAF->EFF_sa = LPC_CANAF->SFF_GRP_sa + ( ( uint32_t ) CANAF_gstd_cnt << 2UL );
+	LPC_CANAF->EFF_GRP_sa = LPC_CANAF->EFF_sa + ( ( uint32_t ) CANAF_ext_cnt << 2UL );
+	LPC_CANAF->ENDofTable = LPC_CANAF->EFF_GRP_sa + ( ( uint32_t ) CANAF_gext_cnt << 3UL );
+}
+
+/*------------------------------- FullCAN ---------------------------------------*/
+
+static portBASE_TYPE prvAddFullCANEntry( LPC_CAN_TypeDef * const pxCAN, const uint16_t usID )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulAFMode = LPC_CANAF->AFMR;
+
+	if( CAN_LoadFullCANEntry( pxCAN, usID ) == CAN_OK )
+	{
+		/* CAN_LoadFullCANEntry() moves every start address up by a word for
+		each entry added, but the later sections only move when the number of
+		FullCAN entries becomes odd, as two entries share each word. */
+		LPC_CANAF->AFMR = 0x01UL;
+		prvSetFilterSectionAddresses();
+
+		/* The interrupt pending bits in FCANIC0 and FCANIC1 are what allow
+		updated objects to be found without reading every object.  They are
+		set whether or not the FullCAN interrupt is enabled, so
+		ioctlGET_CAN_FULLCAN_UPDATES polls them, and FCANIE is left alone -
+		it is only set by ioctlSET_CAN_FULLCAN_INTERRUPT. */
+		CAN_SetAFMode( LPC_CANAF, CAN_eFCAN );
+		xReturn = pdPASS;
+	}
+	else
+	{
+		LPC_CANAF->AFMR = ulAFMode;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvGetFullCANMailbox( LPC_CAN_TypeDef * const pxCAN, CAN_FullCAN_Mailbox_t * const pxMailbox )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const uint32_t ulController = ( pxCAN == LPC_CAN1 ) ? 0UL : 1UL;
+uint32_t ulObject, ulWord, ulEntry, ulWanted;
+
+	configASSERT( pxMailbox );
+
+	ulWanted = ( ulController << canAF_STD_CONTROLLER_SHIFT ) | ( pxMailbox->usID & 0x7FFUL );
+
+	/* The message objects are in the same order as the FullCAN entries, which
+	are packed two to a word at the start of the table. */
+	for( ulObject = 0UL; ulObject < CANAF_FullCAN_cnt; ulObject++ )
+	{
+		ulWord = LPC_CANAF_RAM->mask[ ulObject >> 1UL ];
+		ulEntry = ( ( ulObject & 0x01UL ) == 0UL ) ? ( ulWord >> 16UL ) : ulWord;
+
+		if( ( ulEntry & canAF_STD_ENTRY_MASK ) == ulWanted )
+		{
+			pxMailbox->ucObjectNumber = ( uint8_t ) ulObject;
+			pxMailbox->pxObject = ( CAN_FullCAN_Object_t * ) ( LPC_CANAF_RAM_BASE + LPC_CANAF->ENDofTable + ( ulObject * canAF_FULLCAN_OBJECT_WORDS * sizeof( uint32_t ) ) );
+			xReturn = pdPASS;
+			break;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGetFullCANUpdates( uint32_t * const pulUpdated )
+{
+CAN_FullCAN_Object_t * const pxObjects = ( CAN_FullCAN_Object_t * ) ( LPC_CANAF_RAM_BASE + LPC_CANAF->ENDofTable );
+uint32_t ulWordNumber, ulPending, ulBit;
+
+	configASSERT( pulUpdated );
+
+	for( ulWordNumber = 0UL; ulWordNumber < ( canMAX_FULLCAN_OBJECTS / canFULLCAN_OBJECTS_PER_WORD ); ulWordNumber++ )
+	{
+		/* Combine the objects already collected by the ISR with those still
+		pending in hardware. */
+		ulPending = ulFullCANUpdated[ ulWordNumber ];
+		ulFullCANUpdated[ ulWordNumber ] = 0UL;
+		ulPending |= ( ulWordNumber == 0UL ) ? LPC_CANAF->FCANIC0 : LPC_CANAF->FCANIC1;
+		pulUpdated[ ulWordNumber ] = ulPending;
+
+		/* Visit only the pending objects, finding each with a single count
+		leading zeros instruction rather than by testing every bit. */
+		while( ulPending != 0UL )
+		{
+			ulBit = 31UL - ( uint32_t ) __CLZ( ulPending );
+			ulPending &= ~( 1UL << ulBit );
+
+			/* Clearing the semaphore bits also clears the object's interrupt
+			pending bit, and lets the application read the object in place. */
+			pxObjects[ ( ulWordNumber * canFULLCAN_OBJECTS_PER_WORD ) + ulBit ].ulControl &= ~diCAN_FULLCAN_SEMAPHORE_BITS;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvFullCANUpdatesFromISR( void )
+{
+CAN_FullCAN_Object_t * const pxObjects = ( CAN_FullCAN_Object_t * ) ( LPC_CANAF_RAM_BASE + LPC_CANAF->ENDofTable );
+uint32_t ulWordNumber, ulPending, ulBit;
+
+	for( ulWordNumber = 0UL; ulWordNumber < ( canMAX_FULLCAN_OBJECTS / canFULLCAN_OBJECTS_PER_WORD ); ulWordNumber++ )
+	{
+		ulPending = ( ulWordNumber == 0UL ) ? LPC_CANAF->FCANIC0 : LPC_CANAF->FCANIC1;
+		ulFullCANUpdated[ ulWordNumber ] |= ulPending;
+
+		/* The interrupt stays asserted until the semaphore bits of every
+		pending object are cleared.  The frame itself stays in the object. */
+		while( ulPending != 0UL )
+		{
+			ulBit = 31UL - ( uint32_t ) __CLZ( ulPending );
+			ulPending &= ~( 1UL << ulBit );
+			pxObjects[ ( ulWordNumber * canFULLCAN_OBJECTS_PER_WORD ) + ulBit ].ulControl &= ~diCAN_FULLCAN_SEMAPHORE_BITS;
+		}
+	}
+}
+
+/*------------------------------ Rx frame queue -----------------------------------*/
+
+#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+
+static portBASE_TYPE prvConfigureFrameQueueRx( Peripheral_Control_t * const pxPeripheralControl, const unsigned portBASE_TYPE uxQueueLength )
+{
+portBASE_TYPE xReturn = pdFAIL;
+CAN_Frame_Queue_Rx_State_t *pxQueueState;
+Transfer_Control_t *pxRxControl = pxPeripheralControl->pxRxControl;
+
+	configASSERT( uxQueueLength > 0U );
+
+	/* Stop the ISR using the Rx control structure, whatever transfer type it
+	was set up for, as the structure is changed below and is freed if the new
+	queue cannot be created.  The ISR is given the structure again when the
+	request is completed as an ioctlUSE_INTERRUPTS request. */
+	taskENTER_CRITICAL();
+	{
+		pxRxTransferControlStructs[ canPERIPHERAL_INDEX( diGET_PERIPHERAL_NUMBER( pxPeripheralControl ) ) ] = NULL;
+	}
+	taskEXIT_CRITICAL();
+
+	/* The generic FreeRTOS+IO code does not know how to delete a frame queue,
+	so delete any existing frame queue here before the transfer control
+	structure is reused. */
+	if( ( pxRxControl != NULL ) && ( pxRxControl->ucType == ioctlUSE_CAN_FRAME_QUEUE_RX ) && ( pxRxControl->pvTransferState != NULL ) )
+	{
+		pxQueueState = ( CAN_Frame_Queue_Rx_State_t * ) pxRxControl->pvTransferState;
+		vSemaphoreDelete( pxQueueState->xNewFrameSemaphore );
+		vPortFree( pxQueueState->pxFrames );
+		vPortFree( pxQueueState );
+		pxRxControl->pvTransferState = NULL;
+	}
+
+	/* The peripheral is going to use a CAN_Frame_Queue_Rx_State_t structure
+	to control reception. */
+	vIOUtilsCreateTransferControlStructure( &( pxPeripheralControl->pxRxControl ) );
+	configASSERT( pxPeripheralControl->pxRxControl );
+
+	if( pxPeripheralControl->pxRxControl != NULL )
+	{
+		/* Create the necessary structure. */
+		pxQueueState = pvPortMalloc( sizeof( CAN_Frame_Queue_Rx_State_t ) );
+
+		if( pxQueueState != NULL )
+		{
+			/* One more slot than the requested queue length is allocated, as
+			one slot is always left empty. */
+			pxQueueState->pxFrames = pvPortMalloc( ( uxQueueLength + 1U ) * sizeof( CAN_MSG_Type ) );
+			vSemaphoreCreateBinary( pxQueueState->xNewFrameSemaphore );
+
+			if( ( pxQueueState->pxFrames != NULL ) && ( pxQueueState->xNewFrameSemaphore != NULL ) )
+			{
+				/* The semaphore is created in the 'given' state, but no frames
+				have been received yet. */
+				xSemaphoreTake( pxQueueState->xNewFrameSemaphore, 0U );
+
+				pxQueueState->usQueueLength = ( uint16_t ) ( uxQueueLength + 1U );
+				pxQueueState->usNextWriteIndex = 0U;
+				pxQueueState->usNextReadIndex = 0U;
+				pxQueueState->xBlockTime = portMAX_DELAY;
+				pxQueueState->ulOverrunCount = 0UL;
+				pxPeripheralControl->pxRxControl->pvTransferState = ( void * ) pxQueueState;
+				pxPeripheralControl->pxRxControl->ucType = ioctlUSE_CAN_FRAME_QUEUE_RX;
+				xReturn = pdPASS;
+			}
+			else
+			{
+				/* Free whatever was allocated and return an error. */
+				if( pxQueueState->xNewFrameSemaphore != NULL )
+				{
+					vSemaphoreDelete( pxQueueState->xNewFrameSemaphore );
+				}
+
+				vPortFree( pxQueueState->pxFrames );
+				vPortFree( pxQueueState );
+				pxQueueState = NULL;
+			}
+		}
+
+		if( pxQueueState == NULL )
+		{
+			/* The Rx structure, or a member it contains, could not be created,
+			so the Rx control structure (which should point to it) should also
+			be deleted. */
+			vPortFree( pxPeripheralControl->pxRxControl );
+			pxPeripheralControl->pxRxControl = NULL;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvReadFramesFromQueue( CAN_Frame_Queue_Rx_State_t * const pxQueueState, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead )
+{
+size_t xFramesRead = 0U;
+uint16_t usReadIndex;
+portTickType xTicksToWait;
+xTimeOutType xTimeOut;
+
+	xTicksToWait = pxQueueState->xBlockTime;
+	vTaskSetTimeOutState( &xTimeOut );
+	usReadIndex = pxQueueState->usNextReadIndex;
+
+	for( ;; )
+	{
+		/* Copy out as many of the requested frames as are already queued.  The
+		semaphore is only waited on when the queue is empty, so a burst of
+		frames is drained without a kernel call per frame. */
+		while( ( xFramesRead < xFramesToRead ) && ( usReadIndex != pxQueueState->usNextWriteIndex ) )
+		{
+			pxFrames[ xFramesRead ] = pxQueueState->pxFrames[ usReadIndex ];
+			xFramesRead++;
+
+			usReadIndex++;
+			if( usReadIndex == pxQueueState->usQueueLength )
+			{
+				usReadIndex = 0U;
+			}
+		}
+
+		/* Free the slots just read so the ISR can use them again. */
+		pxQueueState->usNextReadIndex = usReadIndex;
+
+		if( xFramesRead >= xFramesToRead )
+		{
+			break;
+		}
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+		{
+			/* Time out has expired. */
+			break;
+		}
+
+		/* Wait for the ISR to queue more frames. */
+		if( xSemaphoreTake( pxQueueState->xNewFrameSemaphore, xTicksToWait ) != pdPASS )
+		{
+			break;
+		}
+	}
+
+	return xFramesRead;
+}
+/*-----------------------------------------------------------*/
+
+static inline void prvRxFramesIntoQueueFromISR( CAN_Controller_State_t * const pxControllerState, Transfer_Control_t * const pxTransferControl, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_Frame_Queue_Rx_State_t * const pxQueueState = ( CAN_Frame_Queue_Rx_State_t * ) ( pxTransferControl->pvTransferState );
+LPC_CAN_TypeDef * const pxCAN = pxControllerState->pxCAN;
+uint16_t usWriteIndex, usNextWriteIndex;
+uint32_t ulReceived = 0UL;
+CAN_MSG_Type xDiscardedFrame;
+
+	usWriteIndex = pxQueueState->usNextWriteIndex;
+
+	while( ( pxCAN->SR & CAN_SR_RBS ) != 0UL )
+	{
+		usNextWriteIndex = usWriteIndex + 1U;
+		if( usNextWriteIndex == pxQueueState->usQueueLength )
+		{
+			usNextWriteIndex = 0U;
+		}
+
+		if( usNextWriteIndex != pxQueueState->usNextReadIndex )
+		{
+			/* There is space in the queue.  CAN_ReceiveMsg() also releases the
+			receive buffer.  A frame that is taken by a layer, or is only
+			forwarded to the other controller, leaves its slot free for the
+			next frame. */
+			CAN_ReceiveMsg( pxCAN, &( pxQueueState->pxFrames[ usWriteIndex ] ) );
+			pxQueueState->pxFrames[ usWriteIndex ].timestamp = ulTimestamp;
+			( pxControllerState->xStatistics.ulRxFrames )++;
+
+			#if ioconfigUSE_CAN_ANALYTICS == 1
+			{
+				if( pxControllerState->pxAnalytics != NULL )
+				{
+					prvAnalyseFrameFromISR( pxControllerState->pxAnalytics, &( pxQueueState->pxFrames[ usWriteIndex ] ) );
+				}
+			}
+			#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+			if( prvDispatchRxFrameFromISR( pxControllerState, &( pxQueueState->pxFrames[ usWriteIndex ] ), pxHigherPriorityTaskWoken ) != pdFALSE )
+			{
+				usWriteIndex = usNextWriteIndex;
+				ulReceived++;
+			}
+		}
+		else
+		{
+			/* The queue is full.  The frame still has to be read so the
+			receive buffer is released, and can still be forwarded. */
+			CAN_ReceiveMsg( pxCAN, &xDiscardedFrame );
+			xDiscardedFrame.timestamp = ulTimestamp;
+			( pxControllerState->xStatistics.ulRxFrames )++;
+
+			#if ioconfigUSE_CAN_ANALYTICS == 1
+			{
+				if( pxControllerState->pxAnalytics != NULL )
+				{
+					prvAnalyseFrameFromISR( pxControllerState->pxAnalytics, &xDiscardedFrame );
+				}
+			}
+			#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+			if( prvDispatchRxFrameFromISR( pxControllerState, &xDiscardedFrame, pxHigherPriorityTaskWoken ) != pdFALSE )
+			{
+				/* An overrun has occurred. */
+				( pxQueueState->ulOverrunCount )++;
+			}
+		}
+	}
+
+	if( ulReceived > 0UL )
+	{
+		/* Publish the new frames, then unblock any task that might have been
+		waiting for them to arrive. */
+		pxQueueState->usNextWriteIndex = usWriteIndex;
+		xSemaphoreGiveFromISR( pxQueueState->xNewFrameSemaphore, pxHigherPriorityTaskWoken );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvSetRxPriority( Peripheral_Control_t * const pxPeripheralControl, const CAN_Rx_Priority_Config_t * const pxConfig )
+{
+CAN_Controller_State_t * const pxControllerState = prvCAN_CONTROLLER_STATE( pxPeripheralControl );
+CAN_Rx_Priority_State_t *pxNewPriority = NULL, *pxOldPriority = NULL;
+portBASE_TYPE xReturn = pdPASS;
+size_t xRangeBytes;
+
+	configASSERT( pxConfig );
+
+	/* Frames are only sorted by priority as they are moved into the Rx frame
+	queue. */
+	if( ( pxPeripheralControl->pxRxControl == NULL ) || ( diGET_RX_TRANSFER_TYPE( pxPeripheralControl ) != ioctlUSE_CAN_FRAME_QUEUE_RX ) )
+	{
+		xReturn = pdFAIL;
+	}
+	else if( pxConfig->usNumberOfRanges > 0U )
+	{
+		if( ( pxConfig->usHighQueueLength == 0U ) || ( pxConfig->ucHighOverflowPolicy > diCAN_RX_DROP_OLDEST ) || ( pxConfig->ucLowOverflowPolicy > diCAN_RX_DROP_OLDEST ) )
+		{
+			xReturn = pdFAIL;
+		}
+		else
+		{
+			/* The state is followed by the ranges, which the ISR searches so
+			are copied, then by the frame storage, which has one more slot than
+			the queue length as one slot is always left empty. */
+			xRangeBytes = sizeof( CAN_Filter_Entry_t ) * pxConfig->usNumberOfRanges;
+			pxNewPriority = pvPortMalloc( sizeof( CAN_Rx_Priority_State_t ) + xRangeBytes + ( ( pxConfig->usHighQueueLength + 1U ) * sizeof( CAN_MSG_Type ) ) );
+
+			if( pxNewPriority != NULL )
+			{
+				memset( pxNewPriority, 0x00, sizeof( CAN_Rx_Priority_State_t ) );
+				pxNewPriority->pxRanges = ( CAN_Filter_Entry_t * ) &( pxNewPriority[ 1 ] );
+				memcpy( pxNewPriority->pxRanges, pxConfig->pxHighPriorityIDs, xRangeBytes );
+				pxNewPriority->usNumberOfRanges = pxConfig->usNumberOfRanges;
+				pxNewPriority->ucHighOverflowPolicy = pxConfig->ucHighOverflowPolicy;
+				pxNewPriority->ucLowOverflowPolicy = pxConfig->ucLowOverflowPolicy;
+				pxNewPriority->xHighQueue.pxFrames = ( CAN_MSG_Type * ) &( pxNewPriority->pxRanges[ pxConfig->usNumberOfRanges ] );
+				pxNewPriority->xHighQueue.usQueueLength = ( uint16_t ) ( pxConfig->usHighQueueLength + 1U );
+			}
+			else
+			{
+				xReturn = pdFAIL;
+			}
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			/* A task blocked in read() could still be using the old queue, so
+			it is only replaced when no read is in progress. */
+			if( pxControllerState->xRxQueueReadInProgress == pdFALSE )
+			{
+				pxOldPriority = pxControllerState->pxRxPriority;
+				pxControllerState->pxRxPriority = pxNewPriority;
+			}
+			else
+			{
+				pxOldPriority = pxNewPriority;
+				xReturn = pdFAIL;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* The ISR cannot still be using the old queue once the critical
+		section has been exited. */
+		if( pxOldPriority != NULL )
+		{
+			vPortFree( pxOldPriority );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvReadFramesByPriority( CAN_Rx_Priority_State_t * const pxPriority, CAN_Frame_Queue_Rx_State_t * const pxQueueState, CAN_MSG_Type * const pxFrames, const size_t xFramesToRead )
+{
+size_t xFramesRead = 0U;
+portTickType xTicksToWait;
+xTimeOutType xTimeOut;
+
+	xTicksToWait = pxQueueState->xBlockTime;
+	vTaskSetTimeOutState( &xTimeOut );
+
+	for( ;; )
+	{
+		/* The high priority queue is looked at again before each frame is
+		taken from the low priority queue, so a high priority frame that
+		arrives during a long read is not left behind the low priority frames
+		still queued. */
+		while( ( xFramesRead < xFramesToRead ) &&
+			   ( ( prvTakeFrameFromQueue( &( pxPriority->xHighQueue ), pxPriority->ucHighOverflowPolicy, &( pxFrames[ xFramesRead ] ) ) != pdFALSE ) ||
+				 ( prvTakeFrameFromQueue( pxQueueState, pxPriority->ucLowOverflowPolicy, &( pxFrames[ xFramesRead ] ) ) != pdFALSE ) ) )
+		{
+			xFramesRead++;
+		}
+
+		if( xFramesRead >= xFramesToRead )
+		{
+			break;
+		}
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+		{
+			/* Time out has expired. */
+			break;
+		}
+
+		/* Wait for the ISR to queue more frames in either queue. */
+		if( xSemaphoreTake( pxQueueState->xNewFrameSemaphore, xTicksToWait ) != pdPASS )
+		{
+			break;
+		}
+	}
+
+	return xFramesRead;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvTakeFrameFromQueue( CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint8_t ucOverflowPolicy, CAN_MSG_Type * const pxFrame )
+{
+portBASE_TYPE xReturn = pdFALSE;
+uint16_t usReadIndex;
+
+	/* The ISR moves the read index of a drop oldest queue on when it discards
+	the oldest frame, so a frame is copied out of such a queue, and the read
+	index moved past it, with interrupts masked.  Otherwise only the reading
+	task moves the read index. */
+	if( ucOverflowPolicy == diCAN_RX_DROP_OLDEST )
+	{
+		taskENTER_CRITICAL();
+	}
+
+	usReadIndex = pxQueueState->usNextReadIndex;
+
+	if( usReadIndex != pxQueueState->usNextWriteIndex )
+	{
+		*pxFrame = pxQueueState->pxFrames[ usReadIndex ];
+
+		usReadIndex++;
+		if( usReadIndex == pxQueueState->usQueueLength )
+		{
+			usReadIndex = 0U;
+		}
+
+		pxQueueState->usNextReadIndex = usReadIndex;
+		xReturn = pdTRUE;
+	}
+
+	if( ucOverflowPolicy == diCAN_RX_DROP_OLDEST )
+	{
+		taskEXIT_CRITICAL();
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvAddFrameToQueueFromISR( CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint8_t ucOverflowPolicy, const CAN_MSG_Type * const pxFrame )
+{
+portBASE_TYPE xReturn = pdTRUE;
+uint16_t usWriteIndex, usNextWriteIndex, usReadIndex;
+
+	usWriteIndex = pxQueueState->usNextWriteIndex;
+	usNextWriteIndex = usWriteIndex + 1U;
+	if( usNextWriteIndex == pxQueueState->usQueueLength )
+	{
+		usNextWriteIndex = 0U;
+	}
+
+	if( usNextWriteIndex == pxQueueState->usNextReadIndex )
+	{
+		xReturn = pdFALSE;
+
+		if( ucOverflowPolicy == diCAN_RX_DROP_OLDEST )
+		{
+			/* Make room by moving the read index past the oldest frame. */
+			usReadIndex = usNextWriteIndex + 1U;
+			if( usReadIndex == pxQueueState->usQueueLength )
+			{
+				usReadIndex = 0U;
+			}
+
+			pxQueueState->usNextReadIndex = usReadIndex;
+		}
+	}
+
+	if( ( xReturn != pdFALSE ) || ( ucOverflowPolicy == diCAN_RX_DROP_OLDEST ) )
+	{
+		pxQueueState->pxFrames[ usWriteIndex ] = *pxFrame;
+		pxQueueState->usNextWriteIndex = usNextWriteIndex;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRxFramesIntoPriorityQueuesFromISR( CAN_Controller_State_t * const pxControllerState, CAN_Frame_Queue_Rx_State_t * const pxQueueState, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_Rx_Priority_State_t * const pxPriority = pxControllerState->pxRxPriority;
+LPC_CAN_TypeDef * const pxCAN = pxControllerState->pxCAN;
+const CAN_Filter_Entry_t *pxRange;
+CAN_Frame_Queue_Rx_State_t *pxTargetQueue;
+CAN_MSG_Type xFrame;
+uint32_t *pulFramesQueued, *pulOverruns;
+uint8_t ucOverflowPolicy;
+uint16_t usRange;
+portBASE_TYPE xQueued = pdFALSE;
+
+	while( ( pxCAN->SR & CAN_SR_RBS ) != 0UL )
+	{
+		/* The queue a frame goes to is not known until its ID has been read,
+		so each frame is received here then copied into its queue. */
+		CAN_ReceiveMsg( pxCAN, &xFrame );
+		xFrame.timestamp = ulTimestamp;
+		( pxControllerState->xStatistics.ulRxFrames )++;
+
+		#if ioconfigUSE_CAN_ANALYTICS == 1
+		{
+			if( pxControllerState->pxAnalytics != NULL )
+			{
+				prvAnalyseFrameFromISR( pxControllerState->pxAnalytics, &xFrame );
+			}
+		}
+		#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+		if( prvDispatchRxFrameFromISR( pxControllerState, &xFrame, pxHigherPriorityTaskWoken ) != pdFALSE )
+		{
+			pxTargetQueue = pxQueueState;
+			ucOverflowPolicy = pxPriority->ucLowOverflowPolicy;
+			pulFramesQueued = &( pxPriority->xStatistics.ulLowFramesQueued );
+			pulOverruns = &( pxPriority->xStatistics.ulLowOverruns );
+
+			for( usRange = 0U; usRange < pxPriority->usNumberOfRanges; usRange++ )
+			{
+				pxRange = &( pxPriority->pxRanges[ usRange ] );
+
+				if( ( pxRange->ucFormat == xFrame.format ) && ( xFrame.id >= pxRange->ulLowerID ) && ( xFrame.id <= pxRange->ulUpperID ) )
+				{
+					pxTargetQueue = &( pxPriority->xHighQueue );
+					ucOverflowPolicy = pxPriority->ucHighOverflowPolicy;
+					pulFramesQueued = &( pxPriority->xStatistics.ulHighFramesQueued );
+					pulOverruns = &( pxPriority->xStatistics.ulHighOverruns );
+					break;
+				}
+			}
+
+			if( prvAddFrameToQueueFromISR( pxTargetQueue, ucOverflowPolicy, &xFrame ) != pdFALSE )
+			{
+				( *pulFramesQueued )++;
+				xQueued = pdTRUE;
+			}
+			else
+			{
+				/* An overrun has occurred.  The frame was still queued if the
+				oldest frame was discarded in its place. */
+				( *pulOverruns )++;
+				( pxQueueState->ulOverrunCount )++;
+
+				if( ucOverflowPolicy == diCAN_RX_DROP_OLDEST )
+				{
+					( *pulFramesQueued )++;
+					xQueued = pdTRUE;
+				}
+			}
+		}
+	}
+
+	if( xQueued != pdFALSE )
+	{
+		/* Unblock any task that might have been waiting for either queue. */
+		xSemaphoreGiveFromISR( pxQueueState->xNewFrameSemaphore, pxHigherPriorityTaskWoken );
+	}
+}
+
+#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+
+/*------------------------------ Tx frame queue -----------------------------------*/
+
+#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+
+/* Returns a key that sorts frames in the order in which they would win bus
+arbitration.  The bits of the key follow the arbitration field as it appears on
+the bus: the 11 bit base ID, the RTR bit of a standard frame (or the recessive
+SRR bit of an extended frame), the IDE bit, then for extended frames the 18 bit
+ID extension and the RTR bit. */
+static uint32_t prvArbitrationKey( const CAN_MSG_Type * const pxFrame )
+{
+uint32_t ulKey;
+
+	if( pxFrame->format == STD_ID_FORMAT )
+	{
+		ulKey = ( pxFrame->id & 0x7FFUL ) << 21UL;
+
+		if( pxFrame->type == REMOTE_FRAME )
+		{
+			ulKey |= ( 1UL << 20UL );
+		}
+	}
+	else
+	{
+		ulKey = ( ( pxFrame->id >> 18UL ) & 0x7FFUL ) << 21UL;
+		ulKey |= ( 1UL << 20UL ) | ( 1UL << 19UL );
+		ulKey |= ( pxFrame->id & 0x3FFFFUL ) << 1UL;
+
+		if( pxFrame->type == REMOTE_FRAME )
+		{
+			ulKey |= 1UL;
+		}
+	}
+
+	return ulKey;
+}
+/*-----------------------------------------------------------*/
+
+/* Returns pdTRUE if pxItem1 should be sent before pxItem2. */
+static portBASE_TYPE prvItemHasPriority( const CAN_Tx_Queue_Item_t * const pxItem1, const CAN_Tx_Queue_Item_t * const pxItem2 )
+{
+portBASE_TYPE xReturn;
+
+	if( pxItem1->ulArbitrationKey != pxItem2->ulArbitrationKey )
+	{
+		xReturn = ( pxItem1->ulArbitrationKey < pxItem2->ulArbitrationKey );
+	}
+	else
+	{
+		/* The sequence number is allowed to wrap. */
+		xReturn = ( ( int32_t ) ( pxItem1->ulSequenceNumber - pxItem2->ulSequenceNumber ) < 0L );
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvConfigureFrameQueueTx( Peripheral_Control_t * const pxPeripheralControl, const unsigned portBASE_TYPE uxQueueLength )
+{
+portBASE_TYPE xReturn = pdFAIL;
+CAN_Frame_Queue_Tx_State_t *pxQueueState;
+Transfer_Control_t *pxTxControl = pxPeripheralControl->pxTxControl;
+uint32_t ulBuffer;
+uint16_t usItem;
+
+	configASSERT( uxQueueLength > 0U );
+
+	/* The generic FreeRTOS+IO code does not know how to delete a frame queue,
+	so delete any existing frame queue here before the transfer control
+	structure is reused. */
+	if( ( pxTxControl != NULL ) && ( pxTxControl->ucType == ioctlUSE_CAN_FRAME_QUEUE_TX ) && ( pxTxControl->pvTransferState != NULL ) )
+	{
+		pxQueueState = ( CAN_Frame_Queue_Tx_State_t * ) pxTxControl->pvTransferState;
+
+		/* Stop the ISR using the queue while it is deleted.  The frames still
+		in the queue are never sent, so the layers that sent them are no
+		longer waiting for them. */
+		taskENTER_CRITICAL();
+		{
+			pxTxTransferControlStructs[ canPERIPHERAL_INDEX( diGET_PERIPHERAL_NUMBER( pxPeripheralControl ) ) ] = NULL;
+
+			for( usItem = 0U; usItem < pxQueueState->usFramesWaiting; usItem++ )
+			{
+				if( pxQueueState->pxItems[ usItem ].pxLayer != NULL )
+				{
+					( pxQueueState->pxItems[ usItem ].pxLayer->usTxFramesPending )--;
+				}
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		vSemaphoreDelete( pxQueueState->xSpaceAvailableSemaphore );
+		vPortFree( pxQueueState->pxItems );
+		vPortFree( pxQueueState );
+		pxTxControl->pvTransferState = NULL;
+	}
+
+	/* The peripheral is going to use a CAN_Frame_Queue_Tx_State_t structure
+	to control transmission. */
+	vIOUtilsCreateTransferControlStructure( &( pxPeripheralControl->pxTxControl ) );
+	configASSERT( pxPeripheralControl->pxTxControl );
+
+	if( pxPeripheralControl->pxTxControl != NULL )
+	{
+		/* Create the necessary structure. */
+		pxQueueState = pvPortMalloc( sizeof( CAN_Frame_Queue_Tx_State_t ) );
+
+		if( pxQueueState != NULL )
+		{
+			pxQueueState->pxItems = pvPortMalloc( uxQueueLength * sizeof( CAN_Tx_Queue_Item_t ) );
+			vSemaphoreCreateBinary( pxQueueState->xSpaceAvailableSemaphore );
+
+			if( ( pxQueueState->pxItems != NULL ) && ( pxQueueState->xSpaceAvailableSemaphore != NULL ) )
+			{
+				/* The semaphore is only given when space is freed. */
+				xSemaphoreTake( pxQueueState->xSpaceAvailableSemaphore, 0U );
+
+				pxQueueState->usQueueLength = ( uint16_t ) uxQueueLength;
+				pxQueueState->usFramesWaiting = 0U;
+				pxQueueState->ulNextSequenceNumber = 0UL;
+				pxQueueState->xBlockTime = portMAX_DELAY;
+
+				for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+				{
+					pxQueueState->ulBufferArbitrationKeys[ ulBuffer ] = 0UL;
+				}
+
+				pxPeripheralControl->pxTxControl->pvTransferState = ( void * ) pxQueueState;
+				pxPeripheralControl->pxTxControl->ucType = ioctlUSE_CAN_FRAME_QUEUE_TX;
+				xReturn = pdPASS;
+			}
+			else
+			{
+				/* Free whatever was allocated and return an error. */
+				if( pxQueueState->xSpaceAvailableSemaphore != NULL )
+				{
+					vSemaphoreDelete( pxQueueState->xSpaceAvailableSemaphore );
+				}
+
+				vPortFree( pxQueueState->pxItems );
+				vPortFree( pxQueueState );
+				pxQueueState = NULL;
+			}
+		}
+
+		if( pxQueueState == NULL )
+		{
+			/* The Tx structure, or a member it contains, could not be created,
+			so the Tx control structure (which should point to it) should also
+			be deleted. */
+			vPortFree( pxPeripheralControl->pxTxControl );
+			pxPeripheralControl->pxTxControl = NULL;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static size_t prvWriteFramesToQueue( Peripheral_Control_t * const pxPeripheralControl, const CAN_MSG_Type * const pxFrames, const size_t xFramesToWrite )
+{
+CAN_Frame_Queue_Tx_State_t * const pxQueueState = prvCAN_FRAME_QUEUE_TX_STATE( pxPeripheralControl );
+LPC_CAN_TypeDef * const pxCAN = ( LPC_CAN_TypeDef * const ) diGET_PERIPHERAL_BASE_ADDRESS( pxPeripheralControl );
+const CAN_Controller_State_t * const pxControllerState = prvCAN_CONTROLLER_STATE( pxPeripheralControl );
+size_t xFramesWritten = 0U;
+uint32_t ulDeadline;
+portTickType xTicksToWait;
+xTimeOutType xTimeOut;
+
+	xTicksToWait = pxQueueState->xBlockTime;
+	vTaskSetTimeOutState( &xTimeOut );
+
+	for( ;; )
+	{
+		/* Add as many frames as there is space for in one go, so a batch of
+		frames costs a single critical section. */
+		taskENTER_CRITICAL();
+		{
+			while( ( xFramesWritten < xFramesToWrite ) && ( ( pxQueueState->usFramesWaiting < pxQueueState->usQueueLength ) || ( prvMakeRoomInTxQueue( pxCAN, pxQueueState ) != pdFALSE ) ) )
+			{
+				/* The timestamp of a frame written to the queue is its
+				deadline, but only once deadlines have been enabled. */
+				ulDeadline = ( pxControllerState->pxTxDeadlines != NULL ) ? pxFrames[ xFramesWritten ].timestamp : 0UL;
+				prvAddFrameToTxQueue( pxQueueState, &( pxFrames[ xFramesWritten ] ), ulDeadline, NULL );
+				xFramesWritten++;
+			}
+
+			/* Start sending if any hardware Tx buffers are idle.  Otherwise
+			the Tx interrupts will take the frames as buffers become free. */
+			prvLoadTxBuffersFromQueue( pxCAN, pxQueueState );
+		}
+		taskEXIT_CRITICAL();
+
+		if( xFramesWritten >= xFramesToWrite )
+		{
+			break;
+		}
+
+		if( xTaskCheckForTimeOut( &xTimeOut, &xTicksToWait ) != pdFALSE )
+		{
+			/* Time out has expired. */
+			break;
+		}
+
+		/* Wait for the ISR to free space in the queue. */
+		if( xSemaphoreTake( pxQueueState->xSpaceAvailableSemaphore, xTicksToWait ) != pdPASS )
+		{
+			break;
+		}
+	}
+
+	return xFramesWritten;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAddFrameToTxQueue( CAN_Frame_Queue_Tx_State_t * const pxQueueState, const CAN_MSG_Type * const pxFrame, const uint32_t ulDeadline, CAN_Layer_t * const pxLayer )
+{
+CAN_Tx_Queue_Item_t * const pxItems = pxQueueState->pxItems;
+CAN_Tx_Queue_Item_t xTemp;
+uint16_t usChild, usParent;
+
+	configASSERT( pxQueueState->usFramesWaiting < pxQueueState->usQueueLength );
+
+	/* Place the new frame at the bottom of the heap, then move it up past any
+	frames it has priority over. */
+	usChild = pxQueueState->usFramesWaiting;
+	pxItems[ usChild ].xFrame = *pxFrame;
+	pxItems[ usChild ].xFrame.timestamp = ulDeadline;
+	pxItems[ usChild ].ulArbitrationKey = prvArbitrationKey( pxFrame );
+	pxItems[ usChild ].ulSequenceNumber = pxQueueState->ulNextSequenceNumber;
+	pxItems[ usChild ].pxLayer = pxLayer;
+	( pxQueueState->ulNextSequenceNumber )++;
+	( pxQueueState->usFramesWaiting )++;
+
+	while( usChild > 0U )
+	{
+		usParent = ( usChild - 1U ) >> 1U;
+
+		if( prvItemHasPriority( &( pxItems[ usChild ] ), &( pxItems[ usParent ] ) ) == pdFALSE )
+		{
+			break;
+		}
+
+		xTemp = pxItems[ usParent ];
+		pxItems[ usParent ] = pxItems[ usChild ];
+		pxItems[ usChild ] = xTemp;
+		usChild = usParent;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvLoadTxBuffersFromQueue( LPC_CAN_TypeDef * const pxCAN, CAN_Frame_Queue_Tx_State_t * const pxQueueState )
+{
+CAN_Tx_Queue_Item_t * const pxItems = pxQueueState->pxItems;
+uint32_t ulStatus, ulBuffer, ulOtherBuffer, ulLoaded = 0UL;
+portBASE_TYPE xBlocked = pdFALSE;
+
+	#if ioconfigUSE_CAN_TX_DEADLINES == 1
+	CAN_Tx_Deadline_State_t * const pxDeadlines = pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxDeadlines;
+	const uint32_t ulNow = canGET_TIMESTAMP();
+	portBASE_TYPE xTimedFrameLoaded = pdFALSE;
+	#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+	ulStatus = pxCAN->SR;
+
+	for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+	{
+		if( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) == 0UL )
+		{
+			/* This buffer is still sending. */
+			continue;
+		}
+
+		#if ioconfigUSE_CAN_TX_DEADLINES == 1
+		{
+			/* A frame that has missed its deadline is dropped rather than
+			sent, and the buffer goes to the next frame. */
+			if( pxDeadlines != NULL )
+			{
+				while( ( pxQueueState->usFramesWaiting > 0U ) && ( pxItems[ 0 ].xFrame.timestamp != 0UL ) && ( canDEADLINE_PASSED( pxItems[ 0 ].xFrame.timestamp, ulNow ) != pdFALSE ) )
+				{
+					prvCountTxDeadlineDrop( pxDeadlines, ( pxItems[ 0 ].xFrame.format == EXT_ID_FORMAT ) ? ( pxItems[ 0 ].xFrame.id | canANALYTICS_EXT_KEY_BIT ) : pxItems[ 0 ].xFrame.id, pdFALSE );
+					( pxQueueState->usFramesWaiting )--;
+					pxItems[ 0 ] = pxItems[ pxQueueState->usFramesWaiting ];
+					prvSiftDownTxQueue( pxQueueState, 0U );
+					ulLoaded++;
+				}
+			}
+		}
+		#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+		if( pxQueueState->usFramesWaiting == 0U )
+		{
+			break;
+		}
+
+		/* When two buffers hold frames with the same ID the controller sends
+		the one in the lowest numbered buffer first, which may not be the one
+		that was written first.  Hold back a frame whose ID is already being
+		sent until that frame has gone. */
+		for( ulOtherBuffer = 0UL; ulOtherBuffer < canNUM_TX_BUFFERS; ulOtherBuffer++ )
+		{
+			if( ( ( ulStatus & ulTxBufferStatusBits[ ulOtherBuffer ] ) == 0UL ) && ( pxQueueState->ulBufferArbitrationKeys[ ulOtherBuffer ] == pxItems[ 0 ].ulArbitrationKey ) )
+			{
+				xBlocked = pdTRUE;
+			}
+		}
+
+		if( xBlocked != pdFALSE )
+		{
+			break;
+		}
+
+		/* Send the highest priority frame. */
+		pxQueueState->ulBufferArbitrationKeys[ ulBuffer ] = pxItems[ 0 ].ulArbitrationKey;
+		prvWriteTxBuffer( pxCAN, ulBuffer, &( pxItems[ 0 ].xFrame ) );
+		pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxBufferLayers[ ulBuffer ] = pxItems[ 0 ].pxLayer;
+		ulStatus &= ~( ulTxBufferStatusBits[ ulBuffer ] );
+		ulLoaded++;
+
+		#if ioconfigUSE_CAN_TX_DEADLINES == 1
+		{
+			/* Keep the deadline, so the frame can be aborted if it is still
+			waiting for the bus when the deadline passes. */
+			if( ( pxDeadlines != NULL ) && ( pxItems[ 0 ].xFrame.timestamp != 0UL ) )
+			{
+				pxDeadlines->ulDeadlines[ ulBuffer ] = pxItems[ 0 ].xFrame.timestamp;
+				pxDeadlines->ulKeys[ ulBuffer ] = ( pxItems[ 0 ].xFrame.format == EXT_ID_FORMAT ) ? ( pxItems[ 0 ].xFrame.id | canANALYTICS_EXT_KEY_BIT ) : pxItems[ 0 ].xFrame.id;
+				pxDeadlines->ulTimed |= ( 1UL << ulBuffer );
+				xTimedFrameLoaded = pdTRUE;
+			}
+		}
+		#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+		/* Remove the frame from the top of the heap by moving the last frame
+		to the top, then moving it down past any frames that have priority
+		over it. */
+		( pxQueueState->usFramesWaiting )--;
+		pxItems[ 0 ] = pxItems[ pxQueueState->usFramesWaiting ];
+		prvSiftDownTxQueue( pxQueueState, 0U );
+	}
+
+	#if ioconfigUSE_CAN_TX_DEADLINES == 1
+	{
+		if( xTimedFrameLoaded != pdFALSE )
+		{
+			prvCheckTxDeadlinesFromISR();
+		}
+	}
+	#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+	return ulLoaded;
+}
+/*-----------------------------------------------------------*/
+
+static void prvSiftDownTxQueue( CAN_Frame_Queue_Tx_State_t * const pxQueueState, uint16_t usParent )
+{
+CAN_Tx_Queue_Item_t * const pxItems = pxQueueState->pxItems;
+CAN_Tx_Queue_Item_t xTemp;
+uint16_t usChild;
+
+	for( ;; )
+	{
+		usChild = ( usParent << 1U ) + 1U;
+
+		if( usChild >= pxQueueState->usFramesWaiting )
+		{
+			break;
+		}
+
+		if( ( ( usChild + 1U ) < pxQueueState->usFramesWaiting ) && ( prvItemHasPriority( &( pxItems[ usChild + 1U ] ), &( pxItems[ usChild ] ) ) != pdFALSE ) )
+		{
+			usChild++;
+		}
+
+		if( prvItemHasPriority( &( pxItems[ usChild ] ), &( pxItems[ usParent ] ) ) == pdFALSE )
+		{
+			break;
+		}
+
+		xTemp = pxItems[ usParent ];
+		pxItems[ usParent ] = pxItems[ usChild ];
+		pxItems[ usChild ] = xTemp;
+		usParent = usChild;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvMakeRoomInTxQueue( LPC_CAN_TypeDef * const pxCAN, CAN_Frame_Queue_Tx_State_t * const pxQueueState )
+{
+portBASE_TYPE xReturn = pdFALSE;
+
+	#if ioconfigUSE_CAN_TX_DEADLINES == 1
+	{
+	CAN_Tx_Deadline_State_t * const pxDeadlines = pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxDeadlines;
+	CAN_Tx_Queue_Item_t * const pxItems = pxQueueState->pxItems;
+	const uint32_t ulNow = canGET_TIMESTAMP();
+	uint16_t usItem, usKept = 0U;
+
+		if( pxDeadlines != NULL )
+		{
+			/* Frames that are behind higher priority frames can miss their
+			deadlines long before they reach the top of the heap, so every
+			frame is checked.  The frames that are kept are packed to the front
+			of the array, and the heap is then rebuilt from the bottom up, which
+			keeps the sequence numbers, and so the order of equal keys. */
+			for( usItem = 0U; usItem < pxQueueState->usFramesWaiting; usItem++ )
+			{
+				if( ( pxItems[ usItem ].xFrame.timestamp != 0UL ) && ( canDEADLINE_PASSED( pxItems[ usItem ].xFrame.timestamp, ulNow ) != pdFALSE ) )
+				{
+					prvCountTxDeadlineDrop( pxDeadlines, ( pxItems[ usItem ].xFrame.format == EXT_ID_FORMAT ) ? ( pxItems[ usItem ].xFrame.id | canANALYTICS_EXT_KEY_BIT ) : pxItems[ usItem ].xFrame.id, pdFALSE );
+				}
+				else
+				{
+					pxItems[ usKept ] = pxItems[ usItem ];
+					usKept++;
+				}
+			}
+
+			if( usKept < pxQueueState->usFramesWaiting )
+			{
+				pxQueueState->usFramesWaiting = usKept;
+
+				for( usItem = usKept >> 1U; usItem > 0U; usItem-- )
+				{
+					prvSiftDownTxQueue( pxQueueState, usItem - 1U );
+				}
+
+				xReturn = pdTRUE;
+			}
+		}
+	}
+	#else
+	{
+		( void ) pxCAN;
+		( void ) pxQueueState;
+	}
+	#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+	return xReturn;
+}
+
+#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+
+/*------------------------------ Analytics --------------------------------------*/
+
+#if ioconfigUSE_CAN_ANALYTICS == 1
+
+static portBASE_TYPE prvConfigureAnalytics( CAN_Controller_State_t * const pxControllerState, const unsigned portBASE_TYPE uxMaxIDs )
+{
+portBASE_TYPE xReturn = pdPASS;
+CAN_Analytics_State_t *pxNewAnalytics = NULL, *pxOldAnalytics;
+size_t xSlots = 2U;
+
+	if( uxMaxIDs > canANALYTICS_MAX_IDS )
+	{
+		xReturn = pdFAIL;
+	}
+	else if( uxMaxIDs > 0U )
+	{
+		/* At least twice as many hash slots as records, rounded up to a power
+		of two. */
+		while( xSlots < ( uxMaxIDs * 2U ) )
+		{
+			xSlots <<= 1U;
+		}
+
+		/* The state, the records and the slots are allocated as one block. */
+		pxNewAnalytics = pvPortMalloc( sizeof( CAN_Analytics_State_t ) + ( sizeof( CAN_ID_Record_t ) * uxMaxIDs ) + ( sizeof( uint16_t ) * xSlots ) );
+
+		if( pxNewAnalytics != NULL )
+		{
+			memset( pxNewAnalytics, 0x00, sizeof( CAN_Analytics_State_t ) + ( sizeof( CAN_ID_Record_t ) * uxMaxIDs ) + ( sizeof( uint16_t ) * xSlots ) );
+			pxNewAnalytics->pxRecords = ( CAN_ID_Record_t * ) &( pxNewAnalytics[ 1 ] );
+			pxNewAnalytics->pusSlots = ( uint16_t * ) &( pxNewAnalytics->pxRecords[ uxMaxIDs ] );
+			pxNewAnalytics->usMaxIDs = ( uint16_t ) uxMaxIDs;
+			pxNewAnalytics->usSlotMask = ( uint16_t ) ( xSlots - 1U );
+			pxNewAnalytics->ulStartTime = canGET_TIMESTAMP();
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxOldAnalytics = pxControllerState->pxAnalytics;
+			pxControllerState->pxAnalytics = pxNewAnalytics;
+		}
+		taskEXIT_CRITICAL();
+
+		/* The ISR cannot still be using the old analytics once the critical
+		section has been exited. */
+		if( pxOldAnalytics != NULL )
+		{
+			vPortFree( pxOldAnalytics );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvAnalyseFrameFromISR( CAN_Analytics_State_t * const pxAnalytics, const CAN_MSG_Type * const pxFrame )
+{
+const uint32_t ulKey = ( pxFrame->format == EXT_ID_FORMAT ) ? ( pxFrame->id | canANALYTICS_EXT_KEY_BIT ) : pxFrame->id;
+uint32_t ulSlot, ulInterval, ulMean, ulJitter, ulBucket;
+CAN_ID_Record_t *pxRecord = NULL;
+
+	( pxAnalytics->ulFrames )++;
+	pxAnalytics->ullBits += prvFrameBits( pxFrame->format, pxFrame->type, pxFrame->len );
+
+	/* Find the ID's record, probing linearly from its hash.  An empty slot
+	means the ID has not been seen before. */
+	ulSlot = ( ( ulKey * 2654435761UL ) >> 16UL ) & pxAnalytics->usSlotMask;
+
+	while( pxAnalytics->pusSlots[ ulSlot ] != 0U )
+	{
+		if( pxAnalytics->pxRecords[ pxAnalytics->pusSlots[ ulSlot ] - 1U ].ulKey == ulKey )
+		{
+			pxRecord = &( pxAnalytics->pxRecords[ pxAnalytics->pusSlots[ ulSlot ] - 1U ] );
+			break;
+		}
+
+		ulSlot = ( ulSlot + 1UL ) & pxAnalytics->usSlotMask;
+	}
+
+	if( pxRecord == NULL )
+	{
+		if( pxAnalytics->usIDsTracked < pxAnalytics->usMaxIDs )
+		{
+			pxRecord = &( pxAnalytics->pxRecords[ pxAnalytics->usIDsTracked ] );
+			( pxAnalytics->usIDsTracked )++;
+			pxAnalytics->pusSlots[ ulSlot ] = pxAnalytics->usIDsTracked;
+			pxRecord->ulKey = ulKey;
+		}
+		else
+		{
+			( pxAnalytics->ulUntrackedFrames )++;
+		}
+	}
+	else
+	{
+		/* Timestamps wrap, so the interval is only correct if it is shorter
+		than the timer's period. */
+		ulInterval = pxFrame->timestamp - pxRecord->ulLastSeen;
+
+		if( pxRecord->ulFrames == 1UL )
+		{
+			pxRecord->ulMinInterval = ulInterval;
+			pxRecord->ulMaxInterval = ulInterval;
+		}
+		else
+		{
+			if( ulInterval < pxRecord->ulMinInterval )
+			{
+				pxRecord->ulMinInterval = ulInterval;
+			}
+
+			if( ulInterval > pxRecord->ulMaxInterval )
+			{
+				pxRecord->ulMaxInterval = ulInterval;
+			}
+
+			/* The jitter is the distance from the mean of the intervals
+			before this one, bucketed by its most significant bit. */
+			ulMean = canROUNDED_MEAN( pxRecord->ullIntervalTotal, pxRecord->ulFrames - 1UL );
+			ulJitter = ( ulInterval > ulMean ) ? ( ulInterval - ulMean ) : ( ulMean - ulInterval );
+			ulBucket = 32UL - ( uint32_t ) __CLZ( ulJitter );
+
+			if( ulBucket >= diCAN_JITTER_BUCKETS )
+			{
+				ulBucket = diCAN_JITTER_BUCKETS - 1UL;
+			}
+
+			( pxRecord->ulJitterHistogram[ ulBucket ] )++;
+		}
+
+		pxRecord->ullIntervalTotal += ulInterval;
+	}
+
+	if( pxRecord != NULL )
+	{
+		( pxRecord->ulFrames )++;
+		pxRecord->ulLastSeen = pxFrame->timestamp;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvAnalyseTxFromISR( CAN_Analytics_State_t * const pxAnalytics, LPC_CAN_TypeDef * const pxCAN, const uint32_t ulTxInterrupts )
+{
+const uint32_t ulStatus = pxCAN->SR;
+uint32_t ulBuffer, ulTFI;
+
+	for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+	{
+		/* A Tx interrupt is also raised when a transmission is aborted, but
+		only a completed transmission sets the buffer's Tx complete bit.  The
+		Tx buffer still holds the frame that was sent. */
+		if( ( ( ulTxInterrupts & ulTxInterruptBits[ ulBuffer ] ) != 0UL ) && ( ( ulStatus & ulTxCompleteBits[ ulBuffer ] ) != 0UL ) )
+		{
+			ulTFI = ( &( pxCAN->TFI1 ) )[ ulBuffer * 4UL ];
+			( pxAnalytics->ulFrames )++;
+			pxAnalytics->ullBits += prvFrameBits( ( ( ulTFI & CAN_TFI_FF ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT, ( ( ulTFI & CAN_TFI_RTR ) != 0UL ) ? REMOTE_FRAME : DATA_FRAME, ( uint8_t ) ( ( ulTFI >> 16UL ) & 0x0FUL ) );
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvFrameBits( const uint8_t ucFormat, const uint8_t ucType, const uint8_t ucDLC )
+{
+const uint32_t ulDataBits = ( ucType == DATA_FRAME ) ? ( 8UL * canDLC_TO_BYTES( ucDLC ) ) : 0UL;
+uint32_t ulFixedBits, ulStuffedBits;
+
+	if( ucFormat == EXT_ID_FORMAT )
+	{
+		ulFixedBits = canEXT_FRAME_FIXED_BITS;
+		ulStuffedBits = canEXT_FRAME_STUFFED_BITS + ulDataBits;
+	}
+	else
+	{
+		ulFixedBits = canSTD_FRAME_FIXED_BITS;
+		ulStuffedBits = canSTD_FRAME_STUFFED_BITS + ulDataBits;
+	}
+
+	/* At worst, the first stuff bit follows five bits of the stuffed part of
+	the frame, and every further stuff bit follows four more. */
+	return ulFixedBits + ulDataBits + ( ( ulStuffedBits - 1UL ) / 4UL ) + canINTERMISSION_BITS;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvGetIDAnalytics( const CAN_Analytics_State_t * const pxAnalytics, CAN_ID_Analytics_t * const pxResult )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const CAN_ID_Record_t *pxRecord;
+
+	if( pxResult->usIndex < pxAnalytics->usIDsTracked )
+	{
+		pxRecord = &( pxAnalytics->pxRecords[ pxResult->usIndex ] );
+
+		pxResult->ucFormat = ( ( pxRecord->ulKey & canANALYTICS_EXT_KEY_BIT ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT;
+		pxResult->ulID = pxRecord->ulKey & ~canANALYTICS_EXT_KEY_BIT;
+		pxResult->ulFrames = pxRecord->ulFrames;
+		pxResult->ulLastSeen = pxRecord->ulLastSeen;
+		pxResult->ulMinInterval = pxRecord->ulMinInterval;
+		pxResult->ulMaxInterval = pxRecord->ulMaxInterval;
+		pxResult->ulMeanInterval = ( pxRecord->ulFrames > 1UL ) ? canROUNDED_MEAN( pxRecord->ullIntervalTotal, pxRecord->ulFrames - 1UL ) : 0UL;
+		memcpy( pxResult->ulJitterHistogram, pxRecord->ulJitterHistogram, sizeof( pxResult->ulJitterHistogram ) );
+
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvGetBusLoad( const CAN_Controller_State_t * const pxControllerState, CAN_Bus_Load_t * const pxResult )
+{
+const CAN_Analytics_State_t * const pxAnalytics = pxControllerState->pxAnalytics;
+uint64_t ullCapacity, ullLoad = 0ULL;
+
+	pxResult->ulBitRate = pxControllerState->ulBitRate;
+	pxResult->ulFrames = pxAnalytics->ulFrames;
+	pxResult->ullBits = pxAnalytics->ullBits;
+	pxResult->ulElapsedTime = canGET_TIMESTAMP() - pxAnalytics->ulStartTime;
+	pxResult->usIDsTracked = pxAnalytics->usIDsTracked;
+	pxResult->ulUntrackedFrames = pxAnalytics->ulUntrackedFrames;
+
+	/* The number of bits the bus could have carried in the elapsed time. */
+	ullCapacity = ( ( uint64_t ) pxResult->ulBitRate * ( uint64_t ) pxResult->ulElapsedTime * ( uint64_t ) boardCAN_TIMESTAMP_RESOLUTION_US ) / 1000000ULL;
+
+	if( ullCapacity > 0ULL )
+	{
+		ullLoad = ( pxAnalytics->ullBits * 10000ULL ) / ullCapacity;
+	}
+
+	/* Worst case stuffing can give an estimate above 100%. */
+	pxResult->usLoad = ( ullLoad > 10000ULL ) ? 10000U : ( uint16_t ) ullLoad;
+}
+
+#endif /* ioconfigUSE_CAN_ANALYTICS */
+/*-----------------------------------------------------------*/
+
+/*------------------------------- Gateway ---------------------------------------*/
+
+static portBASE_TYPE prvSetRoutingTable( CAN_Controller_State_t * const pxControllerState, const CAN_Routing_Table_t * const pxTable )
+{
+portBASE_TYPE xReturn = pdPASS;
+const uint8_t ucThisController = ( pxControllerState->pxCAN == LPC_CAN1 ) ? 1U : 2U;
+CAN_Route_t *pxNewRoutes = NULL, *pxOldRoutes;
+uint16_t usRoute;
+
+	configASSERT( pxTable );
+
+	for( usRoute = 0U; usRoute < pxTable->usNumberOfRoutes; usRoute++ )
+	{
+		/* Frames can only be forwarded to the other controller.  The other
+		controller does not have to be open yet - frames are dropped until it
+		is. */
+		if( ( pxTable->pxRoutes[ usRoute ].ucDestination == 0U ) || ( pxTable->pxRoutes[ usRoute ].ucDestination > boardNUM_CANS ) || ( pxTable->pxRoutes[ usRoute ].ucDestination == ucThisController ) )
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( ( xReturn == pdPASS ) && ( pxTable->usNumberOfRoutes > 0U ) )
+	{
+		/* The ISR searches the routes, so they are copied to memory that
+		remains valid after the ioctl() call returns. */
+		pxNewRoutes = pvPortMalloc( sizeof( CAN_Route_t ) * pxTable->usNumberOfRoutes );
+
+		if( pxNewRoutes != NULL )
+		{
+			memcpy( pxNewRoutes, pxTable->pxRoutes, sizeof( CAN_Route_t ) * pxTable->usNumberOfRoutes );
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxOldRoutes = pxControllerState->pxRoutes;
+			pxControllerState->pxRoutes = pxNewRoutes;
+			pxControllerState->usNumberOfRoutes = pxTable->usNumberOfRoutes;
+		}
+		taskEXIT_CRITICAL();
+
+		/* The ISR cannot still be using the old routes once the critical
+		section has been exited. */
+		if( pxOldRoutes != NULL )
+		{
+			vPortFree( pxOldRoutes );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvDispatchRxFrameFromISR( CAN_Controller_State_t * const pxControllerState, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_Layer_t *pxLayer;
+portBASE_TYPE xDeliver = pdFALSE;
+
+	/* A frame that is only forwarded is not delivered locally at all, so is
+	not seen by the layers either. */
+	xDeliver = prvRouteFrameFromISR( pxControllerState, pxFrame );
+
+	for( pxLayer = pxControllerState->pxLayers; ( pxLayer != NULL ) && ( xDeliver != pdFALSE ); pxLayer = pxLayer->pxNext )
+	{
+		if( pxLayer->pxRxFunction( pxLayer, pxFrame, pxHigherPriorityTaskWoken ) != pdFALSE )
+		{
+			xDeliver = pdFALSE;
+		}
+	}
+
+	return xDeliver;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvRouteFrameFromISR( CAN_Controller_State_t * const pxControllerState, const CAN_MSG_Type * const pxFrame )
+{
+const CAN_Route_t *pxRoute;
+CAN_MSG_Type xForwardedFrame;
+uint32_t ulIDMask;
+uint16_t usRoute;
+portBASE_TYPE xDeliverLocally = pdTRUE;
+
+	for( usRoute = 0U; usRoute < pxControllerState->usNumberOfRoutes; usRoute++ )
+	{
+		pxRoute = &( pxControllerState->pxRoutes[ usRoute ] );
+
+		if( ( pxRoute->ucFormat == pxFrame->format ) && ( pxFrame->id >= pxRoute->ulLowerID ) && ( pxFrame->id <= pxRoute->ulUpperID ) )
+		{
+			ulIDMask = ( pxFrame->format == EXT_ID_FORMAT ) ? 0x1FFFFFFFUL : 0x7FFUL;
+			xForwardedFrame = *pxFrame;
+			xForwardedFrame.id = ( ( pxFrame->id & ~( pxRoute->ulIDRewriteMask ) ) | ( pxRoute->ulIDRewriteValue & pxRoute->ulIDRewriteMask ) ) & ulIDMask;
+
+			if( ( pxControllerStates[ canPERIPHERAL_INDEX( pxRoute->ucDestination ) ] == NULL ) || ( prvForwardFrameFromISR( canPERIPHERAL_INDEX( pxRoute->ucDestination ), &xForwardedFrame, NULL ) != pdPASS ) )
+			{
+				( pxControllerState->ulRouteDropCount )++;
+			}
+
+			xDeliverLocally = ( portBASE_TYPE ) pxRoute->ucDeliverLocally;
+
+			/* Only the first matching route is used. */
+			break;
+		}
+	}
+
+	return xDeliverLocally;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvForwardFrameFromISR( const unsigned portBASE_TYPE uxIndex, const CAN_MSG_Type * const pxFrame, CAN_Layer_t * const pxLayer )
+{
+LPC_CAN_TypeDef * const pxCAN = pxControllerStates[ uxIndex ]->pxCAN;
+Transfer_Control_t * const pxTransferStruct = pxTxTransferControlStructs[ uxIndex ];
+portBASE_TYPE xReturn = pdFAIL;
+uint32_t ulStatus, ulBuffer;
+
+	if( ( pxTransferStruct != NULL ) && ( diGET_TRANSFER_TYPE_FROM_CONTROL_STRUCT( pxTransferStruct ) == ioctlUSE_CAN_FRAME_QUEUE_TX ) )
+	{
+		#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+		{
+		CAN_Frame_Queue_Tx_State_t * const pxQueueState = ( CAN_Frame_Queue_Tx_State_t * ) pxTransferStruct->pvTransferState;
+
+			/* Frames written by tasks are also waiting, so the forwarded frame
+			takes its place among them in ID order. */
+			if( pxQueueState->usFramesWaiting < pxQueueState->usQueueLength )
+			{
+				prvAddFrameToTxQueue( pxQueueState, pxFrame, 0UL, pxLayer );
+				prvLoadTxBuffersFromQueue( pxCAN, pxQueueState );
+				xReturn = pdPASS;
+			}
+		}
+		#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+	}
+	else
+	{
+		/* There is nowhere to hold the frame, so it is only forwarded if a
+		hardware Tx buffer is free.  Tasks that also write to this controller
+		should use a Tx frame queue, as the polled write does not expect the
+		ISR to take a buffer between checking and filling it. */
+		ulStatus = pxCAN->SR;
+
+		for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+		{
+			if( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL )
+			{
+				prvWriteTxBuffer( pxCAN, ulBuffer, pxFrame );
+				pxControllerStates[ uxIndex ]->pxTxBufferLayers[ ulBuffer ] = pxLayer;
+				xReturn = pdPASS;
+				break;
+			}
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvWriteTxBuffer( LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBuffer, const CAN_MSG_Type * const pxFrame )
+{
+volatile uint32_t * const pulTxRegisters = &( pxCAN->TFI1 ) + ( ulBuffer * 4UL );
+uint32_t ulFrameInformation;
+
+	#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+	{
+		if( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxConfirmation != NULL )
+		{
+			prvRecordTxFrame( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxConfirmation, pxCAN, ulBuffer, pxFrame );
+		}
+	}
+	#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+
+	#if ioconfigUSE_CAN_TX_DEADLINES == 1
+	{
+	CAN_Tx_Deadline_State_t * const pxDeadlines = pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->pxTxDeadlines;
+
+		/* The frame the buffer held had a deadline, but the buffer's Tx
+		interrupt has not been handled yet, so finish with the frame now.  The
+		Tx frame queue gives pxFrame its own deadline once it is loaded. */
+		if( ( pxDeadlines != NULL ) && ( ( pxDeadlines->ulTimed & ( 1UL << ulBuffer ) ) != 0UL ) )
+		{
+			prvTxDeadlineBufferDoneFromISR( pxDeadlines, ulBuffer, pxCAN->SR );
+		}
+	}
+	#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+	/* Likewise for a frame the buffer held for a layer.  The caller gives
+	pxFrame its own layer once it is loaded. */
+	prvLayerTxBufferDone( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ], ulBuffer );
+
+	/* The TFI, TID, TDA and TDB registers are contiguous, and repeat for each
+	buffer. */
+	ulFrameInformation = CAN_TFI_DLC( pxFrame->len );
+	if( pxFrame->type == REMOTE_FRAME )
+	{
+		ulFrameInformation |= CAN_TFI_RTR;
+	}
+	if( pxFrame->format == EXT_ID_FORMAT )
+	{
+		ulFrameInformation |= CAN_TFI_FF;
+	}
+
+	pulTxRegisters[ 0 ] = ulFrameInformation;
+	pulTxRegisters[ 1 ] = pxFrame->id;
+	pulTxRegisters[ 2 ] = pxFrame->dataAWord;
+	pulTxRegisters[ 3 ] = pxFrame->dataBWord;
+
+	pxCAN->CMR = ( CAN_CMR_STB1 << ulBuffer ) | CAN_CMR_TR;
+
+	( pxControllerStates[ canCONTROLLER_INDEX( pxCAN ) ]->xStatistics.ulTxFrames )++;
+}
+/*-----------------------------------------------------------*/
+
+/*-------------------------------- Layers ---------------------------------------*/
+
+static portBASE_TYPE prvAddLayer( CAN_Controller_State_t * const pxControllerState, CAN_Layer_t * const pxLayer )
+{
+portBASE_TYPE xReturn = pdFAIL;
+CAN_Layer_t **ppxLink;
+
+	configASSERT( pxLayer );
+	configASSERT( pxLayer->pxRxFunction );
+
+	/* A layer can only be added to one controller at a time. */
+	if( pxLayer->pvController == NULL )
+	{
+		for( ppxLink = &( pxControllerState->pxLayers ); *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+		{
+			/* Find the end of the list. */
+		}
+
+		pxLayer->pxSendFunction = prvLayerSendFrame;
+		pxLayer->usTxFramesPending = 0U;
+		pxLayer->pvController = ( void * ) pxControllerState;
+		pxLayer->pxNext = NULL;
+		*ppxLink = pxLayer;
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvRemoveLayer( CAN_Controller_State_t * const pxControllerState, CAN_Layer_t * const pxLayer )
+{
+portBASE_TYPE xReturn = pdFAIL;
+CAN_Layer_t **ppxLink;
+Transfer_Control_t *pxTransferStruct;
+uint32_t ulBuffer;
+
+	configASSERT( pxLayer );
+
+	for( ppxLink = &( pxControllerState->pxLayers ); *ppxLink != NULL; ppxLink = &( ( *ppxLink )->pxNext ) )
+	{
+		if( *ppxLink == pxLayer )
+		{
+			*ppxLink = pxLayer->pxNext;
+			xReturn = pdPASS;
+			break;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		/* The frames the layer has already sent still go, but nothing that
+		refers to the layer is left behind, so its memory can be freed as soon
+		as this returns. */
+		for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+		{
+			if( pxControllerState->pxTxBufferLayers[ ulBuffer ] == pxLayer )
+			{
+				pxControllerState->pxTxBufferLayers[ ulBuffer ] = NULL;
+			}
+		}
+
+		pxTransferStruct = pxTxTransferControlStructs[ canCONTROLLER_INDEX( pxControllerState->pxCAN ) ];
+
+		if( ( pxTransferStruct != NULL ) && ( diGET_TRANSFER_TYPE_FROM_CONTROL_STRUCT( pxTransferStruct ) == ioctlUSE_CAN_FRAME_QUEUE_TX ) )
+		{
+			#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+			{
+			CAN_Frame_Queue_Tx_State_t * const pxQueueState = ( CAN_Frame_Queue_Tx_State_t * ) pxTransferStruct->pvTransferState;
+			uint16_t usItem;
+
+				for( usItem = 0U; usItem < pxQueueState->usFramesWaiting; usItem++ )
+				{
+					if( pxQueueState->pxItems[ usItem ].pxLayer == pxLayer )
+					{
+						pxQueueState->pxItems[ usItem ].pxLayer = NULL;
+					}
+				}
+			}
+			#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+		}
+
+		pxLayer->usTxFramesPending = 0U;
+		pxLayer->pvController = NULL;
+		pxLayer->pxNext = NULL;
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvLayerSendFrame( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame )
+{
+CAN_Controller_State_t * const pxControllerState = ( CAN_Controller_State_t * ) pxLayer->pvController;
+portBASE_TYPE xReturn = pdFAIL;
+
+	if( pxControllerState != NULL )
+	{
+		/* The frame is counted first, as it might be loaded into a Tx buffer
+		straight away. */
+		( pxLayer->usTxFramesPending )++;
+		xReturn = prvForwardFrameFromISR( canCONTROLLER_INDEX( pxControllerState->pxCAN ), pxFrame, pxLayer );
+
+		if( xReturn != pdPASS )
+		{
+			( pxLayer->usTxFramesPending )--;
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvLayerTxBufferDone( CAN_Controller_State_t * const pxControllerState, const uint32_t ulBuffer )
+{
+CAN_Layer_t * const pxLayer = pxControllerState->pxTxBufferLayers[ ulBuffer ];
+
+	if( pxLayer != NULL )
+	{
+		configASSERT( pxLayer->usTxFramesPending > 0U );
+		( pxLayer->usTxFramesPending )--;
+		pxControllerState->pxTxBufferLayers[ ulBuffer ] = NULL;
+	}
+}
+/*-----------------------------------------------------------*/
+
+/*------------------------------ Tx confirmation --------------------------------*/
+
+#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+
+static portBASE_TYPE prvSetTxConfirmation( CAN_Controller_State_t * const pxControllerState, const CAN_Tx_Confirmation_Config_t * const pxConfig )
+{
+CAN_Tx_Confirmation_State_t *pxNewConfirmation = NULL, *pxOldConfirmation;
+portBASE_TYPE xReturn = pdPASS;
+
+	configASSERT( pxConfig );
+
+	if( ( pxConfig->pxFunction != NULL ) || ( pxConfig->usQueueLength > 0U ) )
+	{
+		pxNewConfirmation = pvPortMalloc( sizeof( CAN_Tx_Confirmation_State_t ) );
+
+		if( pxNewConfirmation != NULL )
+		{
+			memset( pxNewConfirmation, 0x00, sizeof( CAN_Tx_Confirmation_State_t ) );
+			pxNewConfirmation->pxFunction = pxConfig->pxFunction;
+			pxNewConfirmation->pvContext = pxConfig->pvContext;
+			pxNewConfirmation->xBlockTime = pxConfig->xBlockTime;
+
+			if( pxConfig->usQueueLength > 0U )
+			{
+				pxNewConfirmation->xQueue = xQueueCreate( ( unsigned portBASE_TYPE ) pxConfig->usQueueLength, sizeof( CAN_Tx_Confirmation_t ) );
+
+				if( pxNewConfirmation->xQueue == NULL )
+				{
+					vPortFree( pxNewConfirmation );
+					pxNewConfirmation = NULL;
+				}
+			}
+		}
+
+		if( pxNewConfirmation == NULL )
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxOldConfirmation = pxControllerState->pxTxConfirmation;
+
+			if( pxNewConfirmation != NULL )
+			{
+				if( pxOldConfirmation != NULL )
+				{
+					memcpy( pxNewConfirmation->xBuffers, pxOldConfirmation->xBuffers, sizeof( pxNewConfirmation->xBuffers ) );
+					pxNewConfirmation->ulPending = pxOldConfirmation->ulPending;
+				}
+
+				/* Frames are confirmed by the Tx complete interrupts. */
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE1, ENABLE );
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE2, ENABLE );
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE3, ENABLE );
+				NVIC_EnableIRQ( CAN_IRQn );
+			}
+
+			pxControllerState->pxTxConfirmation = pxNewConfirmation;
+		}
+		taskEXIT_CRITICAL();
+
+		/* Nothing can still be using the old confirmations once the critical
+		section has been exited. */
+		if( pxOldConfirmation != NULL )
+		{
+			if( pxOldConfirmation->xQueue != NULL )
+			{
+				vQueueDelete( pxOldConfirmation->xQueue );
+			}
+
+			vPortFree( pxOldConfirmation );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvRecordTxFrame( CAN_Tx_Confirmation_State_t * const pxConfirmation, LPC_CAN_TypeDef * const pxCAN, const uint32_t ulBuffer, const CAN_MSG_Type * const pxFrame )
+{
+portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	/* The buffer is only loaded once it is free, so if the frame it held has
+	not been confirmed, the Tx interrupt that would have confirmed it has not
+	been handled yet - the buffer is being loaded by the Rx interrupt, or from
+	within a critical section.  Confirm the frame now, while the Tx complete
+	status still describes it, as by the time the interrupt is handled the
+	buffer will hold pxFrame.  A task woken by the confirmation runs at the next
+	context switch rather than straight away. */
+	if( ( pxConfirmation->ulPending & ( 1UL << ulBuffer ) ) != 0UL )
+	{
+		prvConfirmTxFromISR( pxConfirmation, ulBuffer, pxCAN->SR, canGET_TIMESTAMP(), &xHigherPriorityTaskWoken );
+	}
+
+	pxConfirmation->xBuffers[ ulBuffer ] = *pxFrame;
+	pxConfirmation->ulPending |= ( 1UL << ulBuffer );
+}
+/*-----------------------------------------------------------*/
+
+static void prvConfirmTxFromISR( CAN_Tx_Confirmation_State_t * const pxConfirmation, const uint32_t ulBuffer, const uint32_t ulStatus, const uint32_t ulTimestamp, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+CAN_MSG_Type * const pxFrame = &( pxConfirmation->xBuffers[ ulBuffer ] );
+CAN_Tx_Confirmation_t xConfirmation;
+
+	xConfirmation.ucFormat = pxFrame->format;
+	xConfirmation.ucType = pxFrame->type;
+	xConfirmation.ucLength = pxFrame->len;
+	xConfirmation.ulID = pxFrame->id;
+	xConfirmation.ulDataA = pxFrame->dataAWord;
+	xConfirmation.ulDataB = pxFrame->dataBWord;
+	xConfirmation.ulTimestamp = ulTimestamp;
+	xConfirmation.ucBuffer = ( uint8_t ) ( ulBuffer + 1UL );
+	pxConfirmation->ulPending &= ~( 1UL << ulBuffer );
+
+	/* A Tx interrupt is also raised when a transmission is aborted, but only
+	a completed transmission sets the buffer's Tx complete bit. */
+	if( ( ulStatus & ulTxCompleteBits[ ulBuffer ] ) != 0UL )
+	{
+		xConfirmation.ucResult = diCAN_TX_SENT;
+		( pxConfirmation->xStatistics.ulFramesSent )++;
+	}
+	else
+	{
+		xConfirmation.ucResult = diCAN_TX_ABORTED;
+		( pxConfirmation->xStatistics.ulFramesAborted )++;
+	}
+
+	if( pxConfirmation->pxFunction != NULL )
+	{
+		pxConfirmation->pxFunction( &xConfirmation, pxConfirmation->pvContext, pxHigherPriorityTaskWoken );
+	}
+
+	if( pxConfirmation->xQueue != NULL )
+	{
+		if( xQueueSendFromISR( pxConfirmation->xQueue, &xConfirmation, pxHigherPriorityTaskWoken ) != pdPASS )
+		{
+			( pxConfirmation->xStatistics.ulOverruns )++;
+		}
+	}
+}
+
+#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+
+/*------------------------------- Tx deadlines ----------------------------------*/
+
+#if ioconfigUSE_CAN_TX_DEADLINES == 1
+
+static portBASE_TYPE prvSetTxDeadlines( CAN_Controller_State_t * const pxControllerState, const unsigned portBASE_TYPE uxMaxIDs )
+{
+portBASE_TYPE xReturn = pdPASS;
+CAN_Tx_Deadline_State_t *pxNewDeadlines = NULL, *pxOldDeadlines;
+size_t xSlots = 2U, xBytes;
+
+	if( uxMaxIDs > canTX_DEADLINE_MAX_IDS )
+	{
+		xReturn = pdFAIL;
+	}
+	else if( uxMaxIDs > 0U )
+	{
+		/* At least twice as many hash slots as records, rounded up to a power
+		of two. */
+		while( xSlots < ( uxMaxIDs * 2U ) )
+		{
+			xSlots <<= 1U;
+		}
+
+		/* The state, the records and the slots are allocated as one block. */
+		xBytes = sizeof( CAN_Tx_Deadline_State_t ) + ( sizeof( CAN_Tx_Deadline_Record_t ) * uxMaxIDs ) + ( sizeof( uint16_t ) * xSlots );
+		pxNewDeadlines = pvPortMalloc( xBytes );
+
+		if( pxNewDeadlines != NULL )
+		{
+			memset( pxNewDeadlines, 0x00, xBytes );
+			pxNewDeadlines->pxRecords = ( CAN_Tx_Deadline_Record_t * ) &( pxNewDeadlines[ 1 ] );
+			pxNewDeadlines->pusSlots = ( uint16_t * ) &( pxNewDeadlines->pxRecords[ uxMaxIDs ] );
+			pxNewDeadlines->usMaxIDs = ( uint16_t ) uxMaxIDs;
+			pxNewDeadlines->usSlotMask = ( uint16_t ) ( xSlots - 1U );
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			pxOldDeadlines = pxControllerState->pxTxDeadlines;
+			pxControllerState->pxTxDeadlines = pxNewDeadlines;
+
+			/* The frames already in the Tx buffers keep no deadline.  The
+			timestamp timer interrupt aborts frames in the same Tx buffers the
+			CAN interrupt loads, so is given the same priority, and neither can
+			interrupt the other. */
+			if( pxNewDeadlines != NULL )
+			{
+				prvSetInterruptPriorities();
+				NVIC_EnableIRQ( boardCAN_TIMESTAMP_TIMER_IRQ );
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* The interrupts cannot still be using the old deadlines once the
+		critical section has been exited. */
+		if( pxOldDeadlines != NULL )
+		{
+			vPortFree( pxOldDeadlines );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static void prvCheckTxDeadlinesFromISR( void )
+{
+CAN_Tx_Deadline_State_t *pxDeadlines;
+LPC_CAN_TypeDef *pxCAN;
+unsigned portBASE_TYPE uxIndex;
+uint32_t ulNow, ulNext = 0UL, ulWaiting, ulStatus, ulAbort, ulBuffer;
+portBASE_TYPE xNextFound;
+
+	do
+	{
+		ulNow = canGET_TIMESTAMP();
+		xNextFound = pdFALSE;
+
+		for( uxIndex = 0; uxIndex < boardNUM_CANS; uxIndex++ )
+		{
+			if( ( pxControllerStates[ uxIndex ] == NULL ) || ( pxControllerStates[ uxIndex ]->pxTxDeadlines == NULL ) )
+			{
+				continue;
+			}
+
+			pxDeadlines = pxControllerStates[ uxIndex ]->pxTxDeadlines;
+			pxCAN = pxControllerStates[ uxIndex ]->pxCAN;
+			ulWaiting = pxDeadlines->ulTimed & ~( pxDeadlines->ulAborting );
+			ulAbort = 0UL;
+
+			if( ulWaiting != 0UL )
+			{
+				ulStatus = pxCAN->SR;
+
+				for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+				{
+					/* A buffer that is free has completed, and only waits for
+					its Tx interrupt to be handled. */
+					if( ( ( ulWaiting & ( 1UL << ulBuffer ) ) == 0UL ) || ( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL ) )
+					{
+						continue;
+					}
+
+					if( canDEADLINE_PASSED( pxDeadlines->ulDeadlines[ ulBuffer ], ulNow ) != pdFALSE )
+					{
+						ulAbort |= ( CAN_CMR_STB1 << ulBuffer );
+						pxDeadlines->ulAborting |= ( 1UL << ulBuffer );
+					}
+					else if( ( xNextFound == pdFALSE ) || ( ( int32_t ) ( pxDeadlines->ulDeadlines[ ulBuffer ] - ulNext ) < 0L ) )
+					{
+						ulNext = pxDeadlines->ulDeadlines[ ulBuffer ];
+						xNextFound = pdTRUE;
+					}
+				}
+			}
+
+			/* Only the selected buffers are aborted.  A frame that is already
+			being sent finishes, but is not retried if it loses arbitration or
+			fails.  Each aborted buffer raises its Tx interrupt with its Tx
+			complete bit clear. */
+			if( ulAbort != 0UL )
+			{
+				pxCAN->CMR = CAN_CMR_AT | ulAbort;
+			}
+		}
+
+		if( xNextFound != pdFALSE )
+		{
+			boardCAN_TIMESTAMP_TIMER->MR0 = ulNext;
+			boardCAN_TIMESTAMP_TIMER->MCR |= canTIMER_MR0_INTERRUPT;
+		}
+		else
+		{
+			boardCAN_TIMESTAMP_TIMER->MCR &= ~canTIMER_MR0_INTERRUPT;
+		}
+
+		/* The match is missed if the timer passed the deadline while it was
+		being set, in which case the frames are checked again. */
+	} while( ( xNextFound != pdFALSE ) && ( canDEADLINE_PASSED( ulNext, canGET_TIMESTAMP() ) != pdFALSE ) );
+}
+/*-----------------------------------------------------------*/
+
+void boardCAN_TIMESTAMP_TIMER_HANDLER( void )
+{
+	boardCAN_TIMESTAMP_TIMER->IR = canTIMER_MR0_INTERRUPT;
+	prvCheckTxDeadlinesFromISR();
+}
+/*-----------------------------------------------------------*/
+
+static void prvTxDeadlineBufferDoneFromISR( CAN_Tx_Deadline_State_t * const pxDeadlines, const uint32_t ulBuffer, const uint32_t ulStatus )
+{
+	/* A frame that started to be sent before it was aborted completes
+	normally. */
+	if( ( ( pxDeadlines->ulAborting & ( 1UL << ulBuffer ) ) != 0UL ) && ( ( ulStatus & ulTxCompleteBits[ ulBuffer ] ) == 0UL ) )
+	{
+		prvCountTxDeadlineDrop( pxDeadlines, pxDeadlines->ulKeys[ ulBuffer ], pdTRUE );
+	}
+
+	pxDeadlines->ulTimed &= ~( 1UL << ulBuffer );
+	pxDeadlines->ulAborting &= ~( 1UL << ulBuffer );
+}
+/*-----------------------------------------------------------*/
+
+static void prvCountTxDeadlineDrop( CAN_Tx_Deadline_State_t * const pxDeadlines, const uint32_t ulKey, const portBASE_TYPE xAborted )
+{
+CAN_Tx_Deadline_Record_t *pxRecord = NULL;
+uint32_t ulSlot;
+
+	if( xAborted != pdFALSE )
+	{
+		( pxDeadlines->xStatistics.ulAborted )++;
+	}
+	else
+	{
+		( pxDeadlines->xStatistics.ulDroppedFromQueue )++;
+	}
+
+	/* Find the ID's record, probing linearly from its hash, as the analytics
+	do.  An empty slot means no frame with the ID has been dropped before. */
+	ulSlot = ( ( ulKey * 2654435761UL ) >> 16UL ) & pxDeadlines->usSlotMask;
+
+	while( pxDeadlines->pusSlots[ ulSlot ] != 0U )
+	{
+		if( pxDeadlines->pxRecords[ pxDeadlines->pusSlots[ ulSlot ] - 1U ].ulKey == ulKey )
+		{
+			pxRecord = &( pxDeadlines->pxRecords[ pxDeadlines->pusSlots[ ulSlot ] - 1U ] );
+			break;
+		}
+
+		ulSlot = ( ulSlot + 1UL ) & pxDeadlines->usSlotMask;
+	}
+
+	if( ( pxRecord == NULL ) && ( pxDeadlines->xStatistics.usIDsTracked < pxDeadlines->usMaxIDs ) )
+	{
+		pxRecord = &( pxDeadlines->pxRecords[ pxDeadlines->xStatistics.usIDsTracked ] );
+		( pxDeadlines->xStatistics.usIDsTracked )++;
+		pxDeadlines->pusSlots[ ulSlot ] = pxDeadlines->xStatistics.usIDsTracked;
+		pxRecord->ulKey = ulKey;
+	}
+
+	if( pxRecord == NULL )
+	{
+		( pxDeadlines->xStatistics.ulUntrackedDrops )++;
+	}
+	else if( xAborted != pdFALSE )
+	{
+		( pxRecord->ulAborted )++;
+	}
+	else
+	{
+		( pxRecord->ulDroppedFromQueue )++;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static portBASE_TYPE prvGetTxDeadlineDrops( const CAN_Tx_Deadline_State_t * const pxDeadlines, CAN_Tx_Deadline_Drops_t * const pxResult )
+{
+portBASE_TYPE xReturn = pdFAIL;
+const CAN_Tx_Deadline_Record_t *pxRecord;
+
+	if( pxResult->usIndex < pxDeadlines->xStatistics.usIDsTracked )
+	{
+		pxRecord = &( pxDeadlines->pxRecords[ pxResult->usIndex ] );
+
+		pxResult->ucFormat = ( ( pxRecord->ulKey & canANALYTICS_EXT_KEY_BIT ) != 0UL ) ? EXT_ID_FORMAT : STD_ID_FORMAT;
+		pxResult->ulID = pxRecord->ulKey & ~canANALYTICS_EXT_KEY_BIT;
+		pxResult->ulDroppedFromQueue = pxRecord->ulDroppedFromQueue;
+		pxResult->ulAborted = pxRecord->ulAborted;
+
+		xReturn = pdPASS;
+	}
+
+	return xReturn;
+}
+
+#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+/*------------------------------- Cyclic Tx -------------------------------------*/
+
+#if ioconfigUSE_CAN_CYCLIC_TX == 1
+
+static portBASE_TYPE prvSetCyclicTxTable( CAN_Controller_State_t * const pxControllerState, const CAN_Cyclic_Tx_Table_t * const pxTable )
+{
+portBASE_TYPE xReturn = pdPASS;
+CAN_Cyclic_Tx_Schedule_t *pxNewSchedule = NULL, *pxOldSchedule;
+const CAN_Cyclic_Tx_Message_t *pxMessage;
+CAN_Cyclic_Tx_Entry_t *pxEntry;
+unsigned portBASE_TYPE uxIndex;
+uint32_t ulSlot;
+uint16_t usMessage;
+
+	configASSERT( pxTable );
+
+	for( usMessage = 0U; usMessage < pxTable->usNumberOfMessages; usMessage++ )
+	{
+		pxMessage = &( pxTable->pxMessages[ usMessage ] );
+
+		if( ( pxMessage->usPeriodMs == 0U ) || ( pxMessage->ucLength > 8U ) || ( ( pxMessage->usOffsetMs >= pxMessage->usPeriodMs ) && ( pxMessage->usOffsetMs != diCAN_CYCLIC_TX_AUTO_OFFSET ) ) )
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( ( xReturn == pdPASS ) && ( pxTable->usNumberOfMessages > 0U ) )
+	{
+		/* The ISR walks the entries, so they are copied to memory that
+		remains valid after the ioctl() call returns. */
+		pxNewSchedule = pvPortMalloc( sizeof( CAN_Cyclic_Tx_Schedule_t ) + ( sizeof( CAN_Cyclic_Tx_Entry_t ) * pxTable->usNumberOfMessages ) );
+
+		if( pxNewSchedule != NULL )
+		{
+			memset( pxNewSchedule, 0x00, sizeof( CAN_Cyclic_Tx_Schedule_t ) + ( sizeof( CAN_Cyclic_Tx_Entry_t ) * pxTable->usNumberOfMessages ) );
+			pxNewSchedule->pxEntries = ( CAN_Cyclic_Tx_Entry_t * ) ( pxNewSchedule + 1 );
+			pxNewSchedule->usEntries = pxTable->usNumberOfMessages;
+
+			for( usMessage = 0U; usMessage < pxTable->usNumberOfMessages; usMessage++ )
+			{
+				pxMessage = &( pxTable->pxMessages[ usMessage ] );
+				pxEntry = &( pxNewSchedule->pxEntries[ usMessage ] );
+
+				pxEntry->xFrame.format = pxMessage->ucFormat;
+				pxEntry->xFrame.type = pxMessage->ucType;
+				pxEntry->xFrame.len = pxMessage->ucLength;
+				pxEntry->xFrame.id = pxMessage->ulID;
+				pxEntry->xFrame.dataAWord = pxMessage->ulDataA;
+				pxEntry->xFrame.dataBWord = pxMessage->ulDataB;
+				pxEntry->pxPayloadFunction = pxMessage->pxPayloadFunction;
+				pxEntry->pvContext = pxMessage->pvContext;
+				pxEntry->usPeriodMs = pxMessage->usPeriodMs;
+				pxEntry->usOffsetMs = pxMessage->usOffsetMs;
+			}
+
+			pxNewSchedule->usPeakFramesPerSlot = prvChooseCyclicTxOffsets( pxNewSchedule->pxEntries, pxNewSchedule->usEntries );
+
+			if( pxNewSchedule->usPeakFramesPerSlot == 0U )
+			{
+				vPortFree( pxNewSchedule );
+				xReturn = pdFAIL;
+			}
+		}
+		else
+		{
+			xReturn = pdFAIL;
+		}
+	}
+
+	if( xReturn == pdPASS )
+	{
+		taskENTER_CRITICAL();
+		{
+			if( pxNewSchedule != NULL )
+			{
+				/* Each message is first due its offset after the next slot
+				starts. */
+				ulSlot = prvCyclicTxNextSlot();
+
+				for( usMessage = 0U; usMessage < pxNewSchedule->usEntries; usMessage++ )
+				{
+					pxNewSchedule->pxEntries[ usMessage ].ulNextSlot = ulSlot + pxNewSchedule->pxEntries[ usMessage ].usOffsetMs;
+				}
+
+				/* Frames that find no room when they are due are retried from
+				the Tx complete interrupts. */
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE1, ENABLE );
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE2, ENABLE );
+				CAN_IRQCmd( pxControllerState->pxCAN, CANINT_TIE3, ENABLE );
+				NVIC_EnableIRQ( CAN_IRQn );
+			}
+
+			pxOldSchedule = pxControllerState->pxCyclicTx;
+			pxControllerState->pxCyclicTx = pxNewSchedule;
+
+			/* The timer stops interrupting once neither controller has a
+			table. */
+			ulSlot = 0UL;
+			for( uxIndex = 0; uxIndex < boardNUM_CANS; uxIndex++ )
+			{
+				if( ( pxControllerStates[ uxIndex ] != NULL ) && ( pxControllerStates[ uxIndex ]->pxCyclicTx != NULL ) )
+				{
+					ulSlot++;
+				}
+			}
+
+			if( ( ulSlot == 0UL ) && ( xCyclicTxTimerRunning != pdFALSE ) )
+			{
+				boardCAN_CYCLIC_TX_TIMER->MCR &= ~canTIMER_MR0_INTERRUPT;
+				boardCAN_CYCLIC_TX_TIMER->IR = canTIMER_MR0_INTERRUPT;
+				NVIC_DisableIRQ( boardCAN_CYCLIC_TX_TIMER_IRQ );
+				xCyclicTxTimerRunning = pdFALSE;
+			}
+		}
+		taskEXIT_CRITICAL();
+
+		/* The ISR cannot still be using the old table once the critical
+		section has been exited. */
+		if( pxOldSchedule != NULL )
+		{
+			vPortFree( pxOldSchedule );
+		}
+	}
+
+	return xReturn;
+}
+/*-----------------------------------------------------------*/
+
+static uint16_t prvChooseCyclicTxOffsets( CAN_Cyclic_Tx_Entry_t * const pxEntries, const uint16_t usEntries )
+{
+uint32_t ulHyperperiod = 1UL, ulA, ulB, ulTemp, ulOffset, ulOffsets, ulSlot, ulMax, ulSum, ulBestOffset, ulBestMax, ulBestSum;
+uint16_t *pusFrames, usEntry, usPeak = 0U;
+CAN_Cyclic_Tx_Entry_t *pxEntry;
+
+	/* The load repeats every least common multiple of the periods. */
+	for( usEntry = 0U; ( usEntry < usEntries ) && ( ulHyperperiod < canCYCLIC_TX_MAX_HYPERPERIOD ); usEntry++ )
+	{
+		ulA = ulHyperperiod;
+		ulB = pxEntries[ usEntry ].usPeriodMs;
+
+		while( ulB != 0UL )
+		{
+			ulTemp = ulA % ulB;
+			ulA = ulB;
+			ulB = ulTemp;
+		}
+
+		ulTemp = ( uint32_t ) pxEntries[ usEntry ].usPeriodMs / ulA;
+		ulHyperperiod = ( ulHyperperiod > ( canCYCLIC_TX_MAX_HYPERPERIOD / ulTemp ) ) ? canCYCLIC_TX_MAX_HYPERPERIOD : ( ulHyperperiod * ulTemp );
+	}
+
+	/* The number of frames due in each slot of the hyperperiod. */
+	pusFrames = pvPortMalloc( sizeof( uint16_t ) * ulHyperperiod );
+
+	if( pusFrames != NULL )
+	{
+		memset( pusFrames, 0x00, sizeof( uint16_t ) * ulHyperperiod );
+
+		/* Offsets given by the application are taken as they are. */
+		for( usEntry = 0U; usEntry < usEntries; usEntry++ )
+		{
+			if( pxEntries[ usEntry ].usOffsetMs != diCAN_CYCLIC_TX_AUTO_OFFSET )
+			{
+				for( ulSlot = pxEntries[ usEntry ].usOffsetMs; ulSlot < ( ulHyperperiod + pxEntries[ usEntry ].usOffsetMs ); ulSlot += pxEntries[ usEntry ].usPeriodMs )
+				{
+					( pusFrames[ ulSlot % ulHyperperiod ] )++;
+				}
+			}
+		}
+
+		/* The messages with the shortest periods occupy the most slots, so
+		have the least freedom, and are placed first. */
+		for( ;; )
+		{
+			pxEntry = NULL;
+
+			for( usEntry = 0U; usEntry < usEntries; usEntry++ )
+			{
+				if( ( pxEntries[ usEntry ].usOffsetMs == diCAN_CYCLIC_TX_AUTO_OFFSET ) && ( ( pxEntry == NULL ) || ( pxEntries[ usEntry ].usPeriodMs < pxEntry->usPeriodMs ) ) )
+				{
+					pxEntry = &( pxEntries[ usEntry ] );
+				}
+			}
+
+			if( pxEntry == NULL )
+			{
+				break;
+			}
+
+			ulOffsets = ( pxEntry->usPeriodMs < ulHyperperiod ) ? pxEntry->usPeriodMs : ulHyperperiod;
+			ulBestOffset = 0UL;
+			ulBestMax = UINT32_MAX;
+			ulBestSum = UINT32_MAX;
+
+			for( ulOffset = 0UL; ulOffset < ulOffsets; ulOffset++ )
+			{
+				ulMax = 0UL;
+				ulSum = 0UL;
+
+				for( ulSlot = ulOffset; ulSlot < ( ulHyperperiod + ulOffset ); ulSlot += pxEntry->usPeriodMs )
+				{
+					ulTemp = pusFrames[ ulSlot % ulHyperperiod ];
+					ulSum += ulTemp;
+					if( ulTemp > ulMax )
+					{
+						ulMax = ulTemp;
+					}
+				}
+
+				if( ( ulMax < ulBestMax ) || ( ( ulMax == ulBestMax ) && ( ulSum < ulBestSum ) ) )
+				{
+					ulBestOffset = ulOffset;
+					ulBestMax = ulMax;
+					ulBestSum = ulSum;
+				}
+			}
+
+			pxEntry->usOffsetMs = ( uint16_t ) ulBestOffset;
+
+			for( ulSlot = ulBestOffset; ulSlot < ( ulHyperperiod + ulBestOffset ); ulSlot += pxEntry->usPeriodMs )
+			{
+				( pusFrames[ ulSlot % ulHyperperiod ] )++;
+			}
+		}
+
+		for( ulSlot = 0UL; ulSlot < ulHyperperiod; ulSlot++ )
+		{
+			if( pusFrames[ ulSlot ] > usPeak )
+			{
+				usPeak = pusFrames[ ulSlot ];
+			}
+		}
+
+		vPortFree( pusFrames );
+	}
+
+	return usPeak;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvCyclicTxNextSlot( void )
+{
+TIM_TIMERCFG_Type xTimerConfig;
+uint32_t ulCountsToMatch, ulSlotsEarlier;
+
+	if( xCyclicTxTimerRunning == pdFALSE )
+	{
+		/* TIM_Init() also powers the timer and resets its count.  The timer
+		counts microseconds, and interrupts on MR0 at the start of each slot in
+		which a frame is due. */
+		xTimerConfig.PrescaleOption = TIM_PRESCALE_USVAL;
+		xTimerConfig.PrescaleValue = 1UL;
+		TIM_Init( boardCAN_CYCLIC_TX_TIMER, TIM_TIMER_MODE, &xTimerConfig );
+
+		ulCyclicTxSlot = 0UL;
+		boardCAN_CYCLIC_TX_TIMER->MR0 = canCYCLIC_TX_SLOT_US;
+		boardCAN_CYCLIC_TX_TIMER->MCR = canTIMER_MR0_INTERRUPT;
+		boardCAN_CYCLIC_TX_TIMER->IR = canTIMER_MR0_INTERRUPT;
+		TIM_Cmd( boardCAN_CYCLIC_TX_TIMER, ENABLE );
+
+		/* The timer interrupt loads frames into the same Tx buffers and
+		queues as the CAN interrupt, so is given the same priority, and
+		neither can interrupt the other. */
+		prvSetInterruptPriorities();
+		NVIC_EnableIRQ( boardCAN_CYCLIC_TX_TIMER_IRQ );
+		xCyclicTxTimerRunning = pdTRUE;
+	}
+	else
+	{
+		/* The match may have been set for a slot well after the next, if the
+		other controller's table has nothing due before then. */
+		ulCountsToMatch = boardCAN_CYCLIC_TX_TIMER->MR0 - boardCAN_CYCLIC_TX_TIMER->TC;
+
+		if( ( ( int32_t ) ulCountsToMatch ) > ( int32_t ) canCYCLIC_TX_SLOT_US )
+		{
+			ulSlotsEarlier = ( ulCountsToMatch - 1UL ) / canCYCLIC_TX_SLOT_US;
+			boardCAN_CYCLIC_TX_TIMER->MR0 -= ulSlotsEarlier * canCYCLIC_TX_SLOT_US;
+			ulCyclicTxSlot -= ulSlotsEarlier;
+		}
+	}
+
+	return ulCyclicTxSlot;
+}
+/*-----------------------------------------------------------*/
+
+void boardCAN_CYCLIC_TX_TIMER_HANDLER( void )
+{
+uint32_t ulNextSlot;
+unsigned portBASE_TYPE uxIndex;
+
+	boardCAN_CYCLIC_TX_TIMER->IR = canTIMER_MR0_INTERRUPT;
+
+	/* Handle every slot that has started.  More than one has if this
+	interrupt was held off for longer than a slot, and none has if the loop
+	below already handled the match that raised it. */
+	while( ( int32_t ) ( boardCAN_CYCLIC_TX_TIMER->TC - boardCAN_CYCLIC_TX_TIMER->MR0 ) >= 0 )
+	{
+		ulNextSlot = ulCyclicTxSlot + canCYCLIC_TX_MAX_SLOTS_AHEAD;
+
+		for( uxIndex = 0; uxIndex < boardNUM_CANS; uxIndex++ )
+		{
+			if( ( pxControllerStates[ uxIndex ] != NULL ) && ( pxControllerStates[ uxIndex ]->pxCyclicTx != NULL ) )
+			{
+				prvCyclicTxSlotFromISR( uxIndex, ulCyclicTxSlot, &ulNextSlot );
+			}
+		}
+
+		/* Skip the slots in which nothing is due. */
+		boardCAN_CYCLIC_TX_TIMER->MR0 += ( ulNextSlot - ulCyclicTxSlot ) * canCYCLIC_TX_SLOT_US;
+		ulCyclicTxSlot = ulNextSlot;
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCyclicTxSlotFromISR( const unsigned portBASE_TYPE uxIndex, const uint32_t ulSlot, uint32_t * const pulNextSlot )
+{
+CAN_Cyclic_Tx_Schedule_t * const pxSchedule = pxControllerStates[ uxIndex ]->pxCyclicTx;
+CAN_Cyclic_Tx_Entry_t *pxEntry;
+uint16_t usEntry;
+
+	for( usEntry = 0U; usEntry < pxSchedule->usEntries; usEntry++ )
+	{
+		pxEntry = &( pxSchedule->pxEntries[ usEntry ] );
+
+		if( pxEntry->ulNextSlot == ulSlot )
+		{
+			if( pxEntry->ucPending != pdFALSE )
+			{
+				/* The last frame never found room, and is replaced by this
+				one. */
+				( pxEntry->ulFramesMissed )++;
+			}
+			else
+			{
+				pxEntry->ucPending = pdTRUE;
+				( pxSchedule->usPending )++;
+			}
+
+			if( pxEntry->pxPayloadFunction != NULL )
+			{
+				pxEntry->pxPayloadFunction( &( pxEntry->xFrame.dataAWord ), &( pxEntry->xFrame.dataBWord ), pxEntry->pvContext );
+			}
+
+			pxEntry->ulNextSlot += pxEntry->usPeriodMs;
+		}
+
+		if( ( int32_t ) ( pxEntry->ulNextSlot - *pulNextSlot ) < 0 )
+		{
+			*pulNextSlot = pxEntry->ulNextSlot;
+		}
+	}
+
+	if( pxSchedule->usPending > 0U )
+	{
+		prvCyclicTxSendPendingFromISR( uxIndex, pxSchedule );
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvCyclicTxSendPendingFromISR( const unsigned portBASE_TYPE uxIndex, CAN_Cyclic_Tx_Schedule_t * const pxSchedule )
+{
+CAN_Cyclic_Tx_Entry_t *pxEntry;
+uint16_t usEntry;
+
+	for( usEntry = 0U; ( usEntry < pxSchedule->usEntries ) && ( pxSchedule->usPending > 0U ); usEntry++ )
+	{
+		pxEntry = &( pxSchedule->pxEntries[ usEntry ] );
+
+		if( pxEntry->ucPending != pdFALSE )
+		{
+			if( prvForwardFrameFromISR( uxIndex, &( pxEntry->xFrame ), NULL ) != pdPASS )
+			{
+				break;
+			}
+
+			pxEntry->ucPending = pdFALSE;
+			( pxSchedule->usPending )--;
+			( pxEntry->ulFramesSent )++;
+		}
+	}
+}
+
+#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+
+/*--------------------------- Errors and bus-off ----------------------------------*/
+
+static void prvHandleErrorsFromISR( CAN_Controller_State_t * const pxControllerState, const uint32_t ulInterruptSource, portBASE_TYPE * const pxHigherPriorityTaskWoken )
+{
+LPC_CAN_TypeDef * const pxCAN = pxControllerState->pxCAN;
+CAN_Statistics_t * const pxStatistics = &( pxControllerState->xStatistics );
+uint32_t ulStatus;
+
+	if( ( ulInterruptSource & CAN_ICR_DOI ) != 0UL )
+	{
+		( pxStatistics->ulDataOverruns )++;
+		pxCAN->CMR = CAN_CMR_CDO;
+	}
+
+	if( ( ulInterruptSource & CAN_ICR_EPI ) != 0UL )
+	{
+		( pxStatistics->ulErrorPassive )++;
+	}
+
+	if( ( ulInterruptSource & CAN_ICR_ALI ) != 0UL )
+	{
+		( pxStatistics->ulArbitrationLost )++;
+	}
+
+	if( ( ulInterruptSource & CAN_ICR_BEI ) != 0UL )
+	{
+		switch( canICR_ERRC( ulInterruptSource ) )
+		{
+			case canERRC_BIT_ERROR		:	( pxStatistics->ulBitErrors )++;
+											break;
+
+			case canERRC_FORM_ERROR		:	( pxStatistics->ulFormErrors )++;
+											break;
+
+			case canERRC_STUFF_ERROR	:	( pxStatistics->ulStuffErrors )++;
+											break;
+
+			default						:	( pxStatistics->ulOtherErrors )++;
+											break;
+		}
+	}
+
+	if( ( ulInterruptSource & CAN_ICR_EI ) != 0UL )
+	{
+		( pxStatistics->ulErrorWarnings )++;
+		ulStatus = pxCAN->GSR;
+
+		if( ( ulStatus & CAN_GSR_BS ) != 0UL )
+		{
+			/* The controller has gone bus-off, and has put itself into reset
+			mode.  It is restarted once the back-off delay has expired. */
+			( pxStatistics->ulBusOffEvents )++;
+
+			if( pxControllerState->xBusOffTimer != NULL )
+			{
+				xTimerChangePeriodFromISR( pxControllerState->xBusOffTimer, pxControllerState->xBusOffBackOff, pxHigherPriorityTaskWoken );
+
+				pxControllerState->xBusOffBackOff <<= 1U;
+				if( pxControllerState->xBusOffBackOff > canBUS_OFF_MAX_BACK_OFF )
+				{
+					pxControllerState->xBusOffBackOff = canBUS_OFF_MAX_BACK_OFF;
+				}
+			}
+			else
+			{
+				pxCAN->MOD &= ~CAN_MOD_RM;
+			}
+		}
+		else if( ( ulStatus & CAN_GSR_ES ) == 0UL )
+		{
+			/* Both error counters are back below the warning limit, so the bus
+			is healthy again. */
+			pxControllerState->xBusOffBackOff = canBUS_OFF_MIN_BACK_OFF;
+		}
+	}
+}
+/*-----------------------------------------------------------*/
+
+static void prvBusOffRecoveryCallback( xTimerHandle xTimer )
+{
+CAN_Controller_State_t * const pxControllerState = ( CAN_Controller_State_t * ) pvTimerGetTimerID( xTimer );
+
+	/* Leaving reset mode starts the bus-off recovery sequence, in which the
+	controller waits for 128 occurrences of 11 recessive bits before it takes
+	part in bus traffic again. */
+	taskENTER_CRITICAL();
+	{
+		if( ( pxControllerState->pxCAN->GSR & CAN_GSR_BS ) != 0UL )
+		{
+			pxControllerState->pxCAN->MOD &= ~CAN_MOD_RM;
+		}
+	}
+	taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+static void prvSetInterruptPriorities( void )
+{
+	NVIC_SetPriority( CAN_IRQn, ulInterruptPriority );
+
+	#if ioconfigUSE_CAN_CYCLIC_TX == 1
+	{
+		/* The cyclic Tx timer interrupt loads frames into the same Tx buffers
+		and queues as the CAN interrupt, so must not be able to interrupt it. */
+		NVIC_SetPriority( boardCAN_CYCLIC_TX_TIMER_IRQ, ulInterruptPriority );
+	}
+	#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+
+	#if ioconfigUSE_CAN_TX_DEADLINES == 1
+	{
+		/* As must the timestamp timer interrupt, which aborts frames that miss
+		their deadlines. */
+		NVIC_SetPriority( boardCAN_TIMESTAMP_TIMER_IRQ, ulInterruptPriority );
+	}
+	#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+}
+/*-----------------------------------------------------------*/
+
+/*--------------------------------- INTERRUPT HANDLER -------------------------------------*/
+void CAN_IRQHandler(void)
+{
+uint32_t ulInterruptSource, ulRxStatus, ulTimestamp, ulBuffer;
+portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+unsigned portBASE_TYPE uxIndex;
+CAN_Controller_State_t *pxControllerState;
+LPC_CAN_TypeDef *pxCAN;
+Transfer_Control_t *pxTransferStruct;
+CAN_MSG_Type xFrame;
+
+	/* Every event handled by this entry to the ISR is given the same
+	timestamp, taken as close as possible to the events themselves. */
+	ulTimestamp = canGET_TIMESTAMP();
+
+	if( ( LPC_CANAF->FCANIE != 0UL ) && ( ( LPC_CANAF->FCANIC0 | LPC_CANAF->FCANIC1 ) != 0UL ) )
+	{
+		/* FullCAN frames are received without the CPU, and are only passed
+		through here once ioctlSET_CAN_FULLCAN_INTERRUPT has enabled the
+		FullCAN interrupt, which stays asserted until the pending objects are
+		cleared. */
+		prvFullCANUpdatesFromISR();
+	}
+
+	/* Both controllers share this interrupt.  The central Rx status register
+	shows which of them are holding a received frame, so is read once rather
+	than checking each controller's own status. */
+	ulRxStatus = CAN_GetCRStatus( LPC_CANCR, CANCR_RX_STS );
+
+	for( uxIndex = 0; uxIndex < boardNUM_CANS; uxIndex++ )
+	{
+		pxControllerState = pxControllerStates[ uxIndex ];
+
+		/* Controllers that have not been opened are skipped. */
+		if( pxControllerState != NULL )
+		{
+			pxCAN = pxControllerState->pxCAN;
+
+			/* Reading the interrupt capture register clears every interrupt
+			but the Rx interrupt, which is cleared by releasing the receive
+			buffer. */
+			ulInterruptSource = CAN_IntGetStatus( pxCAN );
+
+			if( ( ulInterruptSource & ( CAN_ICR_EI | CAN_ICR_DOI | CAN_ICR_EPI | CAN_ICR_ALI | CAN_ICR_BEI ) ) != 0UL )
+			{
+				prvHandleErrorsFromISR( pxControllerState, ulInterruptSource, &xHigherPriorityTaskWoken );
+			}
+
+			/* A controller that is not using interrupts is polled by the task
+			that reads it, so its frames are left alone. */
+			if( ( pxControllerState->xInterruptsEnabled != pdFALSE ) && ( ( ulRxStatus & ( CAN_RSR_RB1 << uxIndex ) ) != 0UL ) )
+			{
+				pxTransferStruct = pxRxTransferControlStructs[ uxIndex ];
+
+				if( ( pxTransferStruct != NULL ) && ( diGET_TRANSFER_TYPE_FROM_CONTROL_STRUCT( pxTransferStruct ) == ioctlUSE_CAN_FRAME_QUEUE_RX ) )
+				{
+					#if ioconfigUSE_CAN_FRAME_QUEUE_RX == 1
+					{
+						if( pxControllerState->pxRxPriority != NULL )
+						{
+							prvRxFramesIntoPriorityQueuesFromISR( pxControllerState, ( CAN_Frame_Queue_Rx_State_t * ) pxTransferStruct->pvTransferState, ulTimestamp, &xHigherPriorityTaskWoken );
+						}
+						else
+						{
+							prvRxFramesIntoQueueFromISR( pxControllerState, pxTransferStruct, ulTimestamp, &xHigherPriorityTaskWoken );
+						}
+					}
+					#endif /* ioconfigUSE_CAN_FRAME_QUEUE_RX */
+				}
+				else
+				{
+					/* No frame queue is in use, so just keep the most recent
+					frame that is not only being forwarded. */
+					CAN_ReceiveMsg( pxCAN, &xFrame );
+					xFrame.timestamp = ulTimestamp;
+					( pxControllerState->xStatistics.ulRxFrames )++;
+
+					#if ioconfigUSE_CAN_ANALYTICS == 1
+					{
+						if( pxControllerState->pxAnalytics != NULL )
+						{
+							prvAnalyseFrameFromISR( pxControllerState->pxAnalytics, &xFrame );
+						}
+					}
+					#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+					if( prvDispatchRxFrameFromISR( pxControllerState, &xFrame, &xHigherPriorityTaskWoken ) != pdFALSE )
+					{
+						pxControllerState->xRxFrame = xFrame;
+						xSemaphoreGiveFromISR( pxControllerState->xRxSemaphore, &xHigherPriorityTaskWoken );
+					}
+				}
+			}
+
+			if( ( ulInterruptSource & ( CAN_ICR_TI1 | CAN_ICR_TI2 | CAN_ICR_TI3 ) ) != 0UL )
+			{
+				for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+				{
+					if( ( ulInterruptSource & ulTxInterruptBits[ ulBuffer ] ) != 0UL )
+					{
+						pxControllerState->xTxTimestamp.ulTimestamp = ulTimestamp;
+						pxControllerState->xTxTimestamp.ucBuffer = ( uint8_t ) ( ulBuffer + 1UL );
+						( pxControllerState->xTxTimestamp.ulCompletions )++;
+					}
+				}
+
+				#if ioconfigUSE_CAN_TX_CONFIRMATION == 1
+				{
+				CAN_Tx_Confirmation_State_t * const pxConfirmation = pxControllerState->pxTxConfirmation;
+				uint32_t ulStatus;
+
+					/* Confirm the frames before the buffers are refilled below.
+					A buffer that is no longer free has already been refilled,
+					and its frame confirmed, as it was loaded. */
+					if( ( pxConfirmation != NULL ) && ( pxConfirmation->ulPending != 0UL ) )
+					{
+						ulStatus = pxCAN->SR;
+
+						for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+						{
+							if( ( ( ulInterruptSource & ulTxInterruptBits[ ulBuffer ] ) != 0UL ) && ( ( pxConfirmation->ulPending & ( 1UL << ulBuffer ) ) != 0UL ) && ( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL ) )
+							{
+								prvConfirmTxFromISR( pxConfirmation, ulBuffer, ulStatus, ulTimestamp, &xHigherPriorityTaskWoken );
+							}
+						}
+					}
+				}
+				#endif /* ioconfigUSE_CAN_TX_CONFIRMATION */
+
+				#if ioconfigUSE_CAN_TX_DEADLINES == 1
+				{
+				CAN_Tx_Deadline_State_t * const pxDeadlines = pxControllerState->pxTxDeadlines;
+				uint32_t ulStatus;
+
+					/* Finish with the deadlines of the frames that completed,
+					counting those that were aborted. */
+					if( ( pxDeadlines != NULL ) && ( pxDeadlines->ulTimed != 0UL ) )
+					{
+						ulStatus = pxCAN->SR;
+
+						for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+						{
+							if( ( ( ulInterruptSource & ulTxInterruptBits[ ulBuffer ] ) != 0UL ) && ( ( pxDeadlines->ulTimed & ( 1UL << ulBuffer ) ) != 0UL ) && ( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL ) )
+							{
+								prvTxDeadlineBufferDoneFromISR( pxDeadlines, ulBuffer, ulStatus );
+							}
+						}
+					}
+				}
+				#endif /* ioconfigUSE_CAN_TX_DEADLINES */
+
+				#if ioconfigUSE_CAN_ANALYTICS == 1
+				{
+					if( pxControllerState->pxAnalytics != NULL )
+					{
+						prvAnalyseTxFromISR( pxControllerState->pxAnalytics, pxCAN, ulInterruptSource & ( CAN_ICR_TI1 | CAN_ICR_TI2 | CAN_ICR_TI3 ) );
+					}
+				}
+				#endif /* ioconfigUSE_CAN_ANALYTICS */
+
+				if( pxControllerState->pxLayers != NULL )
+				{
+				CAN_Layer_t *pxLayer;
+				uint32_t ulStatus;
+
+					/* Finish with the frames the layers sent, then let the
+					layers send their next frames before the Tx frame queue
+					takes the free buffers, so a transfer is not held up behind
+					a full queue. */
+					ulStatus = pxCAN->SR;
+
+					for( ulBuffer = 0UL; ulBuffer < canNUM_TX_BUFFERS; ulBuffer++ )
+					{
+						if( ( ( ulInterruptSource & ulTxInterruptBits[ ulBuffer ] ) != 0UL ) && ( ( ulStatus & ulTxBufferStatusBits[ ulBuffer ] ) != 0UL ) )
+						{
+							prvLayerTxBufferDone( pxControllerState, ulBuffer );
+						}
+					}
+
+					for( pxLayer = pxControllerState->pxLayers; pxLayer != NULL; pxLayer = pxLayer->pxNext )
+					{
+						if( pxLayer->pxTxFunction != NULL )
+						{
+							pxLayer->pxTxFunction( pxLayer, &xHigherPriorityTaskWoken );
+						}
+					}
+				}
+
+				pxTransferStruct = pxTxTransferControlStructs[ uxIndex ];
+
+				if( ( pxTransferStruct != NULL ) && ( diGET_TRANSFER_TYPE_FROM_CONTROL_STRUCT( pxTransferStruct ) == ioctlUSE_CAN_FRAME_QUEUE_TX ) )
+				{
+					#if ioconfigUSE_CAN_FRAME_QUEUE_TX == 1
+					{
+						/* Refill the buffers that have just finished sending,
+						and unblock any task that was waiting for space in the
+						queue. */
+						if( prvLoadTxBuffersFromQueue( pxCAN, ( CAN_Frame_Queue_Tx_State_t * ) pxTransferStruct->pvTransferState ) > 0UL )
+						{
+							xSemaphoreGiveFromISR( ( ( CAN_Frame_Queue_Tx_State_t * ) pxTransferStruct->pvTransferState )->xSpaceAvailableSemaphore, &xHigherPriorityTaskWoken );
+						}
+					}
+					#endif /* ioconfigUSE_CAN_FRAME_QUEUE_TX */
+				}
+
+				#if ioconfigUSE_CAN_CYCLIC_TX == 1
+				{
+					/* Cyclic frames that found no room when they were due are
+					retried once the buffers, or the Tx frame queue, have been
+					refilled. */
+					if( ( pxControllerState->pxCyclicTx != NULL ) && ( pxControllerState->pxCyclicTx->usPending > 0U ) )
+					{
+						prvCyclicTxSendPendingFromISR( uxIndex, pxControllerState->pxCyclicTx );
+					}
+				}
+				#endif /* ioconfigUSE_CAN_CYCLIC_TX */
+			}
+		}
+	}
 
-	 }
+	portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
 }
 
 /*-----------------------------------------------------------*/
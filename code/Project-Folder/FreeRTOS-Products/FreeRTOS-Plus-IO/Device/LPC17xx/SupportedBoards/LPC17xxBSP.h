@@ -43,6 +43,7 @@
 #include "lpc17xx_ssp.h"
 #include "lpc17xx_i2c.h"
 #include "lpc17xx_can.h"
+#include "lpc17xx_timer.h"
 
 /*******************************************************************************
  * Definitions used by FreeRTOS+IO to determine the peripherals that are
@@ -80,6 +81,27 @@ portBASE_TYPE vFreeRTOS_lpc17xx_PopulateFunctionPointers( const Peripheral_Types
 #define boardNUM_I2CS				3 /* I2C0 to I2C2. */
 #define boardNUM_CANS				2 /* CAN1 to CAN2. */
 
+/*******************************************************************************
+ * The free running timer used to timestamp CAN frames when
+ * ioconfigUSE_CAN_TIMESTAMPS is 1, and the length of one of its counts in
+ * microseconds.  Its match interrupt, and the name of its interrupt handler,
+ * are used to abort frames that miss their deadlines when
+ * ioconfigUSE_CAN_TX_DEADLINES is 1.
+ ******************************************************************************/
+#define boardCAN_TIMESTAMP_TIMER		LPC_TIM3
+#define boardCAN_TIMESTAMP_RESOLUTION_US	1
+#define boardCAN_TIMESTAMP_TIMER_IRQ	TIMER3_IRQn
+#define boardCAN_TIMESTAMP_TIMER_HANDLER	TIMER3_IRQHandler
+
+/*******************************************************************************
+ * The timer whose match interrupt paces the frames sent by the cyclic Tx
+ * scheduler when ioconfigUSE_CAN_CYCLIC_TX is 1, its interrupt, and the name
+ * of its interrupt handler.
+ ******************************************************************************/
+#define boardCAN_CYCLIC_TX_TIMER		LPC_TIM2
+#define boardCAN_CYCLIC_TX_TIMER_IRQ	TIMER2_IRQn
+#define boardCAN_CYCLIC_TX_TIMER_HANDLER	TIMER2_IRQHandler
+
 
 /*******************************************************************************
  * Configure port UART port pins to be correct for the wiring of the
@@ -190,6 +212,16 @@ portBASE_TYPE vFreeRTOS_lpc17xx_PopulateFunctionPointers( const Peripheral_Types
 #define boardCONFIGURE_CAN_PINS( cPeripheralNumber, xPinConfig )					\
 	switch( ( cPeripheralNumber ) )													\
 	{																				\
+		case 1	:	/* P0.0 and P0.1 are used by UART3, so RD1 and TD1 are		\
+					taken from P0.21 and P0.22. */									\
+					( xPinConfig ).Funcnum = 3;										\
+					( xPinConfig ).Pinnum = 21;										\
+					( xPinConfig ).Portnum = 0;										\
+					PINSEL_ConfigPin( &( xPinConfig ) );							\
+					( xPinConfig ).Pinnum = 22;										\
+					PINSEL_ConfigPin( &( xPinConfig ) );							\
+					break;															\
+																					\
 		case 2	:	( xPinConfig ).Funcnum = 2;										\
 					( xPinConfig ).Pinnum = 4;										\
 					( xPinConfig ).Portnum = 0;										\
@@ -198,8 +230,6 @@ portBASE_TYPE vFreeRTOS_lpc17xx_PopulateFunctionPointers( const Peripheral_Types
 					PINSEL_ConfigPin( &( xPinConfig ) );							\
 					break;															\
 																					\
-																\
-																					\
 		default	:	/* These are either not implemented yet, or not available		\
 					on this board.  Force an assert failure. */						\
 					configASSERT( ( cPeripheralNumber ) - ( cPeripheralNumber ) );	\
@@ -212,6 +242,13 @@ portBASE_TYPE vFreeRTOS_lpc17xx_PopulateFunctionPointers( const Peripheral_Types
 #define boardDEFAULT_UART_BAUD		115200
 #define boardDEFAULT_CAN_BAUD		125000
 
+/*******************************************************************************
+ * The CAN sample point used by ioctlSET_SPEED, and when a CAN port is opened,
+ * in tenths of a percent of the bit time.  87.5% is the sample point CANopen
+ * and SAE J2284 recommend.
+ ******************************************************************************/
+#define boardCAN_DEFAULT_SAMPLE_POINT	875
+
 /*******************************************************************************
  * Command console definitions.
  ******************************************************************************/
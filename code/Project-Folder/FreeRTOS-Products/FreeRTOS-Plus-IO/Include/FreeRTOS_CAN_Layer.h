@@ -0,0 +1,89 @@
+/*
+ * FreeRTOS+IO V1.0.1 (C) 2012 Real Time Engineers ltd.
+ *
+ * FreeRTOS+IO is an add-on component to FreeRTOS.  It is not, in itself, part
+ * of the FreeRTOS kernel.  FreeRTOS+IO is licensed separately from FreeRTOS,
+ * and uses a different license to FreeRTOS.  FreeRTOS+IO uses a dual license
+ * model, information on which is provided below:
+ *
+ * - Open source licensing -
+ * FreeRTOS+IO is a free download and may be used, modified and distributed
+ * without charge provided the user adheres to version two of the GNU General
+ * Public license (GPL) and does not remove the copyright notice or this text.
+ * The GPL V2 text is available on the gnu.org web site, and on the following
+ * URL: http://www.FreeRTOS.org/gpl-2.0.txt
+ *
+ * - Commercial licensing -
+ * Businesses and individuals who wish to incorporate FreeRTOS+IO into
+ * proprietary software for redistribution in any form must first obtain a low
+ * cost commercial license - and in-so-doing support the maintenance, support
+ * and further development of the FreeRTOS+IO product.  Commercial licenses can
+ * be obtained from http://shop.freertos.org and do not require any source files
+ * to be changed.
+ *
+ * FreeRTOS+IO is distributed in the hope that it will be useful.  You cannot
+ * use FreeRTOS+IO unless you agree that you use the software 'as is'.
+ * FreeRTOS+IO is provided WITHOUT ANY WARRANTY; without even the implied
+ * warranties of NON-INFRINGEMENT, MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. Real Time Engineers Ltd. disclaims all conditions and terms, be they
+ * implied, expressed, or statutory.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * http://www.FreeRTOS.org
+ * http://www.FreeRTOS.org/FreeRTOS-Plus
+ *
+ */
+
+#ifndef FREERTOS_IO_CAN_LAYER_H
+#define FREERTOS_IO_CAN_LAYER_H
+
+#ifndef FREERTOS_IO_H
+	#error FreeRTOS_IO.h must be #included before FreeRTOS_CAN_Layer.h.
+#endif
+
+/* A protocol layer, such as ISO-TP or J1939, that sits on top of an open CAN
+controller.  The layer fills in pxRxFunction, pxTxFunction and pvContext, then
+passes the structure to the ioctlADD_CAN_LAYER request of the controller, which
+fills in the rest.  The structure must stay valid until it is passed to
+ioctlREMOVE_CAN_LAYER. */
+typedef struct xCAN_LAYER CAN_Layer_t;
+
+/* Called by the CAN interrupt with each frame the controller receives that is
+to be delivered locally - that is, every frame not only forwarded by a route of
+ioctlSET_CAN_ROUTING_TABLE.  The layers are offered the frame in the order in
+which they were added, then the controller's own reader is.  The function
+returns pdTRUE if the layer took the frame, in which case it goes no further.
+It may only use the FreeRTOS API functions that end in "FromISR", passing them
+pxHigherPriorityTaskWoken. */
+typedef portBASE_TYPE ( *CAN_Layer_Rx_Function_t )( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/* Called by the CAN interrupt each time one of the controller's hardware Tx
+buffers completes, after usTxFramesPending has been updated, and before the
+buffers are refilled from the controller's Tx frame queue.  The same rules
+apply as to a CAN_Layer_Rx_Function_t. */
+typedef void ( *CAN_Layer_Tx_Function_t )( CAN_Layer_t * const pxLayer, portBASE_TYPE * const pxHigherPriorityTaskWoken );
+
+/* Sends a frame on behalf of a layer - through the controller's Tx frame queue
+if it has one, otherwise through any free hardware Tx buffer.  Returns pdFAIL
+if there was no room for the frame, or the layer has been removed.  It does not
+use the FreeRTOS API, so can be called from the layer's own Rx and Tx functions,
+or by a task from within a critical section. */
+typedef portBASE_TYPE ( *CAN_Layer_Send_Function_t )( CAN_Layer_t * const pxLayer, const CAN_MSG_Type * const pxFrame );
+
+struct xCAN_LAYER
+{
+	/* Filled in by the layer. */
+	CAN_Layer_Rx_Function_t pxRxFunction;
+	CAN_Layer_Tx_Function_t pxTxFunction;		/* NULL if the layer does not need to know when its frames have gone. */
+	void *pvContext;							/* For use by the layer. */
+
+	/* Filled in by the driver. */
+	CAN_Layer_Send_Function_t pxSendFunction;
+	volatile uint16_t usTxFramesPending;		/* Frames sent by pxSendFunction that have neither been sent on the bus nor aborted. */
+	void *pvController;							/* The state of the controller the layer was added to, or NULL if it has not been added. */
+	CAN_Layer_t *pxNext;						/* The next layer added to the same controller. */
+};
+
+#endif /* FREERTOS_IO_CAN_LAYER_H */
+
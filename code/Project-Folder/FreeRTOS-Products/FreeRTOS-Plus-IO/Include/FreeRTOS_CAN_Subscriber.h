@@ -0,0 +1,55 @@
+/*
+ * FreeRTOS+IO V1.0.1 (C) 2012 Real Time Engineers ltd.
+ *
+ * FreeRTOS+IO is an add-on component to FreeRTOS.  It is not, in itself, part
+ * of the FreeRTOS kernel.  FreeRTOS+IO is licensed separately from FreeRTOS,
+ * and uses a different license to FreeRTOS.  FreeRTOS+IO uses a dual license
+ * model, information on which is provided below:
+ *
+ * - Open source licensing -
+ * FreeRTOS+IO is a free download and may be used, modified and distributed
+ * without charge provided the user adheres to version two of the GNU General
+ * Public license (GPL) and does not remove the copyright notice or this text.
+ * The GPL V2 text is available on the gnu.org web site, and on the following
+ * URL: http://www.FreeRTOS.org/gpl-2.0.txt
+ *
+ * - Commercial licensing -
+ * Businesses and individuals who wish to incorporate FreeRTOS+IO into
+ * proprietary software for redistribution in any form must first obtain a low
+ * cost commercial license - and in-so-doing support the maintenance, support
+ * and further development of the FreeRTOS+IO product.  Commercial licenses can
+ * be obtained from http://shop.freertos.org and do not require any source files
+ * to be changed.
+ *
+ * FreeRTOS+IO is distributed in the hope that it will be useful.  You cannot
+ * use FreeRTOS+IO unless you agree that you use the software 'as is'.
+ * FreeRTOS+IO is provided WITHOUT ANY WARRANTY; without even the implied
+ * warranties of NON-INFRINGEMENT, MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE. Real Time Engineers Ltd. disclaims all conditions and terms, be they
+ * implied, expressed, or statutory.
+ *
+ * 1 tab == 4 spaces!
+ *
+ * http://www.FreeRTOS.org
+ * http://www.FreeRTOS.org/FreeRTOS-Plus
+ *
+ */
+
+#ifndef FREERTOS_IO_CAN_SUBSCRIBER_H
+#define FREERTOS_IO_CAN_SUBSCRIBER_H
+
+/*
+ * Create a subscriber on xCAN, which must be an open CAN controller.  The
+ * subscriber receives nothing until ioctlSET_CAN_SUBSCRIBER_CONFIG has given
+ * it a frame queue and ioctlADD_CAN_SUBSCRIPTION has given it a subscription.
+ * After that each FreeRTOS_read() from the returned handle reads the frames
+ * that matched its subscriptions, as an array of CAN_MSG_Type structures.
+ * ioctlRELEASE_CAN_SUBSCRIBER frees the subscriber, after which the handle
+ * must not be used again.  Returns NULL if the subscriber could not be
+ * created, including when diCAN_MAX_SUBSCRIBERS subscribers already exist on
+ * xCAN.
+ */
+Peripheral_Descriptor_t FreeRTOS_CAN_Subscriber_open( Peripheral_Descriptor_t const xCAN );
+
+#endif /* FREERTOS_IO_CAN_SUBSCRIBER_H */
+
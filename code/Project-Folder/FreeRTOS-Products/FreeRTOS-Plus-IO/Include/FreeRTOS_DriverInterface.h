@@ -90,6 +90,7 @@ typedef struct xPERIPHREAL_CONTROL
 	Transfer_Control_t *pxRxControl;			/* Pointer to the transfer control structure used to manage receptions from the peripheral. */
 	const Available_Peripherals_t *pxDevice;	/* Pointer to the structure that defines the name and base address of the open peripheral. */
 	int8_t cPeripheralNumber;					/* Where more than one peripheral of the same kind is available, this holds the number of the peripheral this structure is used to control. */
+	void *pvDeviceState;						/* Pointer to any state the peripheral specific driver keeps for this peripheral, independent of the Tx and Rx transfer modes.  NULL if the driver keeps none. */
 } Peripheral_Control_t;
 
 
@@ -104,6 +105,8 @@ typedef struct xPERIPHREAL_CONTROL
 #define ioctlUSE_CHARACTER_QUEUE_TX			3
 #define ioctlUSE_CHARACTER_QUEUE_RX			4
 #define ioctlUSE_CIRCULAR_BUFFER_RX			5
+#define ioctlUSE_CAN_FRAME_QUEUE_RX			6
+#define ioctlUSE_CAN_FRAME_QUEUE_TX			7
 
 /* Transfer mode related ioctl() requests. */
 #define ioctlOBTAIN_WRITE_MUTEX				10
@@ -136,6 +139,604 @@ typedef struct xPERIPHREAL_CONTROL
 #define ioctlSET_CAN_CONFIG_SELFTEST_MODE	403
 #define ioctlSET_CONFIG_CANAF_MODE_BYPASS	404
 #define ioctlSET_CAN_FRAME_LENGTH			405
+#define ioctlGET_CAN_RX_OVERRUN_COUNT		406
+#define ioctlSET_CAN_FRAME_BATCH_MODE		407
+#define ioctlADD_CAN_FILTER_ENTRY			408
+#define ioctlREMOVE_CAN_FILTER_ENTRY		409
+#define ioctlLOAD_CAN_FILTER_TABLE			410
+#define ioctlCOMPILE_CAN_FILTER_TABLE		411
+#define ioctlADD_CAN_FULLCAN_ENTRY			412
+#define ioctlGET_CAN_FULLCAN_MAILBOX		413
+#define ioctlGET_CAN_FULLCAN_UPDATES		414
+#define ioctlSET_CAN_ROUTING_TABLE			415
+#define ioctlGET_CAN_ROUTE_DROP_COUNT		416
+#define ioctlGET_CAN_STATISTICS				417
+#define ioctlCLEAR_CAN_STATISTICS			418
+#define ioctlGET_CAN_TIMESTAMP				419
+#define ioctlGET_CAN_TX_TIMESTAMP			420
+#define ioctlSET_CAN_ANALYTICS				421
+#define ioctlGET_CAN_ID_ANALYTICS			422
+#define ioctlGET_CAN_BUS_LOAD				423
+#define ioctlCLEAR_CAN_ANALYTICS			424
+
+/* ISO-TP specific ioctl requests. */
+#define ioctlSET_ISOTP_CONFIG				425
+#define ioctlGET_ISOTP_STATISTICS			426
+#define ioctlRELEASE_ISOTP_SESSION			453
+
+/* J1939 specific ioctl requests. */
+#define ioctlSET_J1939_CONFIG				427
+#define ioctlADD_J1939_PGN_HANDLER			428
+#define ioctlGET_J1939_ADDRESS				429
+#define ioctlGET_J1939_STATISTICS			430
+#define ioctlRELEASE_J1939_NODE				454
+
+/* CAN subscriber specific ioctl requests. */
+#define ioctlSET_CAN_SUBSCRIBER_CONFIG		431
+#define ioctlADD_CAN_SUBSCRIPTION			432
+#define ioctlCLEAR_CAN_SUBSCRIPTIONS		433
+#define ioctlGET_CAN_SUBSCRIBER_STATISTICS	434
+#define ioctlRELEASE_CAN_SUBSCRIBER			455
+
+/* CAN cyclic Tx specific ioctl requests. */
+#define ioctlSET_CAN_CYCLIC_TX_TABLE		435
+#define ioctlSET_CAN_CYCLIC_TX_DATA			436
+#define ioctlGET_CAN_CYCLIC_TX_STATISTICS	437
+
+/* CAN bit timing specific ioctl requests. */
+#define ioctlSET_CAN_BIT_TIMING				438
+#define ioctlGET_CAN_BIT_TIMING				439
+#define ioctlDETECT_CAN_BIT_RATE			440
+
+/* CAN Rx priority specific ioctl requests. */
+#define ioctlSET_CAN_RX_PRIORITY			441
+#define ioctlGET_CAN_RX_PRIORITY_STATISTICS	442
+
+/* CAN Tx confirmation specific ioctl requests. */
+#define ioctlSET_CAN_TX_CONFIRMATION		443
+#define ioctlGET_CAN_TX_CONFIRMATION		444
+#define ioctlGET_CAN_TX_CONFIRMATION_STATISTICS	445
+
+/* CAN Tx deadline specific ioctl requests. */
+#define ioctlSET_CAN_TX_DEADLINES			446
+#define ioctlGET_CAN_TX_DEADLINE_DROPS		447
+#define ioctlGET_CAN_TX_DEADLINE_STATISTICS	448
+
+/* CAN error interrupt specific ioctl requests. */
+#define ioctlSET_CAN_ERROR_INTERRUPTS		449
+
+/* CAN FullCAN interrupt specific ioctl requests. */
+#define ioctlSET_CAN_FULLCAN_INTERRUPT		450
+
+/* CAN protocol layer specific ioctl requests. */
+#define ioctlADD_CAN_LAYER					451
+#define ioctlREMOVE_CAN_LAYER				452
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlADD_CAN_FILTER_ENTRY and ioctlREMOVE_CAN_FILTER_ENTRY requests.  An entry
+with equal lower and upper IDs accepts a single ID, otherwise it accepts the
+inclusive range of IDs. */
+typedef struct xCAN_FILTER_ENTRY
+{
+	uint32_t ulLowerID;		/* The lowest ID accepted by the entry. */
+	uint32_t ulUpperID;		/* The highest ID accepted by the entry. */
+	uint8_t ucFormat;		/* STD_ID_FORMAT for 11 bit IDs, or EXT_ID_FORMAT for 29 bit IDs. */
+} CAN_Filter_Entry_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlCOMPILE_CAN_FILTER_TABLE request.  The entries can be in any order, and
+can overlap. */
+typedef struct xCAN_FILTER_TABLE
+{
+	const CAN_Filter_Entry_t *pxEntries;	/* The IDs and ranges of IDs to accept. */
+	uint16_t usNumberOfEntries;				/* The number of entries in the pxEntries array. */
+} CAN_Filter_Table_t;
+
+/* A FullCAN message object, written into the acceptance filter RAM by the
+hardware each time a frame with the object's ID is received.  ulControl holds
+the ID in bits 10:0, the DLC in bits 19:16, the semaphore bits in bits 25:24 and
+the RTR bit in bit 30.  The hardware sets the semaphore bits to 01 while it is
+updating the object, and to 11 once it has finished.  To read an object in
+place, clear the semaphore bits, read the data, then read ulControl again - the
+data is only consistent if the semaphore bits are still 00. */
+typedef struct xCAN_FULLCAN_OBJECT
+{
+	volatile uint32_t ulControl;
+	volatile uint32_t ulDataA;
+	volatile uint32_t ulDataB;
+} CAN_FullCAN_Object_t;
+
+#define diCAN_FULLCAN_SEMAPHORE_BITS		( 0x03000000UL )
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_FULLCAN_MAILBOX request.  The object moves if entries are later
+added to or removed from the acceptance filter table, so the mailbox should be
+obtained after the table has been set up. */
+typedef struct xCAN_FULLCAN_MAILBOX
+{
+	uint16_t usID;						/* Set by the application to the standard ID of a FullCAN entry. */
+	uint8_t ucObjectNumber;				/* Set by the driver to the number of the message object that receives usID. */
+	CAN_FullCAN_Object_t *pxObject;		/* Set by the driver to the message object that receives usID. */
+} CAN_FullCAN_Mailbox_t;
+
+/* A route used when one CAN controller forwards frames to the other.  Frames
+received with an ID in the inclusive range ulLowerID to ulUpperID are sent by
+the controller numbered ucDestination straight from the Rx interrupt.  The ID of
+the forwarded frame is ( ID & ~ulIDRewriteMask ) | ( ulIDRewriteValue &
+ulIDRewriteMask ), so a mask of 0 forwards the frame with its ID unchanged. */
+typedef struct xCAN_ROUTE
+{
+	uint32_t ulLowerID;				/* The lowest ID forwarded by the route. */
+	uint32_t ulUpperID;				/* The highest ID forwarded by the route. */
+	uint32_t ulIDRewriteMask;		/* The ID bits replaced before the frame is forwarded. */
+	uint32_t ulIDRewriteValue;		/* The values of the ID bits set in ulIDRewriteMask. */
+	uint8_t ucFormat;				/* STD_ID_FORMAT for 11 bit IDs, or EXT_ID_FORMAT for 29 bit IDs. */
+	uint8_t ucDestination;			/* The number of the controller that sends the frame - 1 for "/CAN1/", 2 for "/CAN2/". */
+	uint8_t ucDeliverLocally;		/* pdTRUE to also pass the frame to read() on the controller that received it. */
+} CAN_Route_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_ROUTING_TABLE request.  When routes overlap the first match is
+used.  A table with no routes stops forwarding. */
+typedef struct xCAN_ROUTING_TABLE
+{
+	const CAN_Route_t *pxRoutes;	/* The routes used by the controller that receives the frames. */
+	uint16_t usNumberOfRoutes;		/* The number of routes in the pxRoutes array. */
+} CAN_Routing_Table_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_STATISTICS request.  The counters describe the controller and the
+bus.  Frames dropped by the driver itself are reported separately by the
+ioctlGET_CAN_RX_OVERRUN_COUNT and ioctlGET_CAN_ROUTE_DROP_COUNT requests.  The
+error counts, from ulDataOverruns to ulBusOffEvents, are only kept while the
+error interrupts are enabled by an ioctlSET_CAN_ERROR_INTERRUPTS request with a
+non-zero pvValue.  That request also enables recovery from bus-off - without
+it a controller that goes bus-off stays off the bus. */
+typedef struct xCAN_STATISTICS
+{
+	uint32_t ulRxFrames;			/* Frames read from the controller's receive buffer. */
+	uint32_t ulTxFrames;			/* Frames passed to the controller for transmission. */
+	uint32_t ulDataOverruns;		/* Times the controller lost a frame because its receive buffer was still full. */
+	uint32_t ulErrorWarnings;		/* Changes of the error or bus status - the error counters crossing the warning limit, or bus-off being entered or left. */
+	uint32_t ulErrorPassive;		/* Changes between the error active and error passive states. */
+	uint32_t ulBitErrors;			/* Bus errors of each type. */
+	uint32_t ulFormErrors;
+	uint32_t ulStuffErrors;
+	uint32_t ulOtherErrors;			/* Bus errors that are not bit, form or stuff errors, such as CRC and acknowledge errors. */
+	uint32_t ulArbitrationLost;		/* Times the controller lost arbitration while sending. */
+	uint32_t ulBusOffEvents;		/* Times the controller went bus-off. */
+	uint8_t ucTxErrorCounter;		/* The transmit error counter at the time of the request. */
+	uint8_t ucRxErrorCounter;		/* The receive error counter at the time of the request. */
+} CAN_Statistics_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_TX_TIMESTAMP request.  Timestamps are taken from the same free
+running timer as the timestamp of each received frame, and the value returned
+by ioctlGET_CAN_TIMESTAMP, so count in units of
+boardCAN_TIMESTAMP_RESOLUTION_US microseconds and wrap at 32 bits. */
+typedef struct xCAN_TX_TIMESTAMP
+{
+	uint32_t ulTimestamp;			/* The time at which the CAN interrupt handled the most recent Tx complete event. */
+	uint32_t ulCompletions;			/* Incremented by each Tx complete event, so a new event can be told apart from the last. */
+	uint8_t ucBuffer;				/* The hardware Tx buffer, 1 to 3, that completed most recently. */
+} CAN_Tx_Timestamp_t;
+
+/* The number of buckets in the jitter histogram of each ID.  Bucket 0 counts
+intervals that were exactly the mean interval, and bucket n counts intervals
+that differed from the mean by 2^(n-1) to (2^n)-1 timestamp units.  The last
+bucket also counts every larger difference. */
+#define diCAN_JITTER_BUCKETS				16
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_ID_ANALYTICS request.  IDs are numbered from 0 in the order in
+which they were first received, so every tracked ID can be found by
+incrementing usIndex until the request returns pdFAIL.  Times and intervals are
+in timestamp units (see CAN_Tx_Timestamp_t).  The interval of each frame is
+compared with the mean of the intervals before it to give its jitter. */
+typedef struct xCAN_ID_ANALYTICS
+{
+	uint16_t usIndex;					/* Set by the application to the number of the tracked ID to return. */
+	uint8_t ucFormat;					/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint32_t ulID;
+	uint32_t ulFrames;					/* Frames received with the ID. */
+	uint32_t ulLastSeen;				/* The timestamp of the most recent frame. */
+	uint32_t ulMinInterval;				/* The shortest, longest and mean time between consecutive frames.  All 0 until two frames have been received. */
+	uint32_t ulMaxInterval;
+	uint32_t ulMeanInterval;
+	uint32_t ulJitterHistogram[ diCAN_JITTER_BUCKETS ];
+} CAN_ID_Analytics_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_BUS_LOAD request.  The load is estimated from the length of every
+frame received by the controller, and of every frame it sent successfully,
+since analytics were enabled or last cleared.  Stuff bits are estimated at
+their worst case, so the load is an upper bound.  ulElapsedTime wraps with the
+timestamp timer, so analytics must be cleared more often than that. */
+typedef struct xCAN_BUS_LOAD
+{
+	uint32_t ulBitRate;					/* The bit rate last set by ioctlSET_SPEED, or the default bit rate. */
+	uint32_t ulFrames;					/* Frames included in the estimate. */
+	uint64_t ullBits;					/* The estimated bus time of those frames, in bits, including intermission. */
+	uint32_t ulElapsedTime;				/* The time over which the frames were counted, in timestamp units. */
+	uint16_t usLoad;					/* The bus load in hundredths of a percent. */
+	uint16_t usIDsTracked;				/* The number of IDs that can be returned by ioctlGET_CAN_ID_ANALYTICS. */
+	uint32_t ulUntrackedFrames;			/* Frames received with an ID that could not be tracked because the table of IDs was full. */
+} CAN_Bus_Load_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_ISOTP_CONFIG request.  Each FreeRTOS_ISOTP_open() creates a separate
+ISO 15765-2 session on the CAN controller it is given, which carries messages
+between a pair of CAN IDs using normal addressing.  ulTxID is used by the
+single, first and consecutive frames this end sends, and by the flow control
+frames it returns to the other end.  ulRxID is used by every frame the other
+end sends.  Both IDs have the format given by ucFormat. */
+typedef struct xCAN_ISOTP_CONFIG
+{
+	uint8_t ucFormat;				/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint32_t ulTxID;
+	uint32_t ulRxID;
+	uint8_t ucBlockSize;			/* The number of consecutive frames the other end may send before waiting for the next flow control frame, or 0 for no limit. */
+	uint8_t ucSTmin;				/* The minimum gap the other end must leave between consecutive frames, encoded as in ISO 15765-2 (0x00 to 0x7F milliseconds, or 0xF1 to 0xF9 hundreds of microseconds). */
+	uint8_t ucPadFrames;			/* pdTRUE to send every frame with 8 data bytes, filling unused bytes with ucPaddingByte. */
+	uint8_t ucPaddingByte;
+	uint32_t ulRxBufferSize;		/* The length of the longest message that can be received. */
+	uint16_t usNBsTimeoutMs;		/* N_Bs, the longest this end waits for each flow control frame before abandoning the message it is sending, or 0 for the 1000ms of ISO 15765-2. */
+	uint16_t usNCrTimeoutMs;		/* N_Cr, the longest this end waits for each consecutive frame before abandoning the message it is receiving, or 0 for 1000ms. */
+} CAN_ISOTP_Config_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_ISOTP_STATISTICS request. */
+typedef struct xCAN_ISOTP_STATISTICS
+{
+	uint32_t ulMessagesSent;
+	uint32_t ulMessagesReceived;
+	uint32_t ulTxFailures;			/* Messages not sent because the other end reported an overflow, or did not send a flow control frame within N_Bs or the Tx timeout. */
+	uint32_t ulRxAborts;			/* Messages abandoned part way through because a consecutive frame was out of sequence or did not arrive within N_Cr, a new message started, or a flow control frame could not be sent. */
+	uint32_t ulRxOverruns;			/* Messages refused because the last message had not been read yet, or because they were longer than the Rx buffer. */
+} CAN_ISOTP_Statistics_t;
+
+/* The J1939 addresses with special meanings - the destination of a message
+sent to every node, and the source address used by a node that has not been
+able to claim an address. */
+#define diJ1939_GLOBAL_ADDRESS				( 0xFFU )
+#define diJ1939_NULL_ADDRESS				( 0xFEU )
+
+/* The longest message the J1939 transport protocol can carry. */
+#define diJ1939_MAX_MESSAGE_BYTES			( 1785U )
+
+/* A J1939 message, as passed to FreeRTOS_write() on a node returned by
+FreeRTOS_J1939_open() and to the handler of its PGN.  Messages of up to 8 bytes
+are carried in a single frame, longer messages by the transport protocol - BAM
+if the destination is diJ1939_GLOBAL_ADDRESS, otherwise RTS/CTS.  The destination address of a PGN in
+the PDU2 range (PF of 240 or more) is always diJ1939_GLOBAL_ADDRESS. */
+typedef struct xJ1939_MESSAGE
+{
+	uint32_t ulPGN;
+	uint8_t ucPriority;					/* 0 (highest) to 7 (lowest). */
+	uint8_t ucSourceAddress;			/* Filled in by the driver. */
+	uint8_t ucDestinationAddress;
+	uint16_t usLength;
+	const uint8_t *pucData;
+} J1939_Message_t;
+
+/* A function that handles every message received with a particular PGN.  It
+is called from the CAN interrupt, so must be short, and may only use the
+FreeRTOS API functions that end in "FromISR", passing them
+pxHigherPriorityTaskWoken.  The data pointed to by pxMessage is only valid
+until the handler returns. */
+typedef void ( *J1939_PGN_Handler_Function_t )( const J1939_Message_t *pxMessage, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken );
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlADD_J1939_PGN_HANDLER request.  Adding a handler for a PGN that already has
+one replaces it. */
+typedef struct xJ1939_PGN_HANDLER
+{
+	uint32_t ulPGN;
+	J1939_PGN_Handler_Function_t pxHandler;
+	void *pvContext;					/* Passed to pxHandler. */
+} J1939_PGN_Handler_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_J1939_CONFIG request, which starts a J1939 node claiming an address on
+the CAN controller given to FreeRTOS_J1939_open().  The node can send once
+ioctlGET_J1939_ADDRESS reports the claim has succeeded.  A node that loses its
+preferred address to a node with a higher priority NAME tries the other
+addresses from 128 to 247 if bit 63 of its NAME (arbitrary address capable) is
+set, otherwise it gives up. */
+typedef struct xJ1939_CONFIG
+{
+	uint8_t ucPreferredAddress;
+	uint64_t ullName;					/* The node's 64 bit NAME.  A numerically lower NAME has the higher priority. */
+	uint16_t usMaxHandlers;				/* The number of PGNs that can be given handlers. */
+	uint16_t usRxBufferSize;			/* The length of the longest transport protocol message that can be received. */
+	uint8_t ucPacketsPerCTS;			/* The number of packets the node lets another node send for each CTS, or 0 for as many as the sender asks for. */
+} J1939_Config_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_J1939_STATISTICS request. */
+typedef struct xJ1939_STATISTICS
+{
+	uint32_t ulFramesDispatched;		/* Single frame messages passed to a handler. */
+	uint32_t ulMessagesReassembled;		/* Transport protocol messages passed to a handler. */
+	uint32_t ulMessagesSent;
+	uint32_t ulTxFailures;				/* Messages not sent because the destination aborted the connection or the Tx timeout expired. */
+	uint32_t ulRxAborts;				/* Transport protocol messages abandoned because a packet was missed, timed out, or the sender aborted. */
+	uint32_t ulRxRefused;				/* Transport protocol messages refused because a message was already being received, or would not fit in the Rx buffer. */
+	uint32_t ulAddressesLost;			/* Times another node took the address the node had claimed, or was claiming. */
+} J1939_Statistics_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_SUBSCRIBER_CONFIG request.  Each FreeRTOS_CAN_Subscriber_open()
+creates a subscriber on a controller, which this gives its own frame queue for
+FreeRTOS_read() to read as an array of CAN_MSG_Type structures.  A received
+frame is copied into the queue of every subscriber with a subscription that
+matches it, and is only passed on to the reader of the controller itself if no
+subscription matches it.  Up to diCAN_MAX_SUBSCRIBERS subscribers can be
+created on each controller.  Configuring a subscriber again discards its
+subscriptions. */
+typedef struct xCAN_SUBSCRIBER_CONFIG
+{
+	uint16_t usQueueLength;				/* The number of frames the subscriber's queue can hold. */
+} CAN_Subscriber_Config_t;
+
+#define diCAN_MAX_SUBSCRIBERS				8
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlADD_CAN_SUBSCRIPTION request.  A frame matches the subscription if it has
+the same format, and the bits of its ID that are set in ulMask equal the same
+bits of ulID.  Standard ID subscriptions, and extended ID subscriptions with
+every bit of ulMask set, are found by table look up, so cost the same however
+many there are.  Each extended ID subscription with a partial mask is checked
+against every extended frame, so only a few are allowed. */
+typedef struct xCAN_SUBSCRIPTION
+{
+	uint8_t ucFormat;					/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint32_t ulID;
+	uint32_t ulMask;
+} CAN_Subscription_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_SUBSCRIBER_STATISTICS request. */
+typedef struct xCAN_SUBSCRIBER_STATISTICS
+{
+	uint32_t ulFramesQueued;
+	uint32_t ulOverruns;				/* Matching frames discarded because the subscriber's queue was full. */
+} CAN_Subscriber_Statistics_t;
+
+/* A function that fills in the data of a frame sent by the cyclic Tx
+scheduler, called each time the frame is due.  It is called from the interrupt
+of boardCAN_CYCLIC_TX_TIMER, so must be short, and must not call the FreeRTOS
+API.  pulDataA and pulDataB hold the data sent last time, laid out as the
+dataAWord and dataBWord members of CAN_MSG_Type. */
+typedef void ( *CAN_Cyclic_Tx_Payload_Function_t )( uint32_t *pulDataA, uint32_t *pulDataB, void *pvContext );
+
+/* A message sent by the cyclic Tx scheduler.  The message is due every
+usPeriodMs milliseconds, usOffsetMs milliseconds into its period.  A message
+given an offset of diCAN_CYCLIC_TX_AUTO_OFFSET has one chosen by the driver,
+which places the messages with the shortest periods first, each where it adds
+least to the busiest millisecond of the table. */
+typedef struct xCAN_CYCLIC_TX_MESSAGE
+{
+	uint8_t ucFormat;					/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint8_t ucType;						/* DATA_FRAME or REMOTE_FRAME. */
+	uint8_t ucLength;					/* 0 to 8. */
+	uint32_t ulID;
+	uint32_t ulDataA;					/* The data sent until it is changed, laid out as the dataAWord and dataBWord members of CAN_MSG_Type. */
+	uint32_t ulDataB;
+	uint16_t usPeriodMs;				/* 1 or more. */
+	uint16_t usOffsetMs;				/* Less than usPeriodMs, or diCAN_CYCLIC_TX_AUTO_OFFSET. */
+	CAN_Cyclic_Tx_Payload_Function_t pxPayloadFunction;	/* Called to fill in the data each time the frame is due, or NULL to send the data last set by ioctlSET_CAN_CYCLIC_TX_DATA. */
+	void *pvContext;					/* Passed to pxPayloadFunction. */
+} CAN_Cyclic_Tx_Message_t;
+
+#define diCAN_CYCLIC_TX_AUTO_OFFSET			( 0xFFFFU )
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_CYCLIC_TX_TABLE request, which replaces the messages the controller
+sends cyclically.  A table with no messages stops them.  The first time each
+message is due is its offset after the next millisecond boundary.  Frames are
+sent from the timer interrupt, through the controller's Tx frame queue if it
+has one - which tasks that also write to the controller should use - and
+otherwise straight into a free hardware Tx buffer.  A frame that cannot be sent
+when it is due is retried as the controller finishes sending other frames, and
+is counted as missed if it is still waiting when it is next due. */
+typedef struct xCAN_CYCLIC_TX_TABLE
+{
+	const CAN_Cyclic_Tx_Message_t *pxMessages;
+	uint16_t usNumberOfMessages;
+} CAN_Cyclic_Tx_Table_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_CYCLIC_TX_DATA request.  The new data is sent from the next time
+the message is due. */
+typedef struct xCAN_CYCLIC_TX_DATA
+{
+	uint16_t usIndex;					/* The position of the message in the table. */
+	uint32_t ulDataA;					/* The new data, laid out as the dataAWord and dataBWord members of CAN_MSG_Type. */
+	uint32_t ulDataB;
+} CAN_Cyclic_Tx_Data_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_CYCLIC_TX_STATISTICS request. */
+typedef struct xCAN_CYCLIC_TX_STATISTICS
+{
+	uint16_t usIndex;					/* Set by the application to the position of the message in the table. */
+	uint16_t usOffsetMs;				/* The offset used, as chosen by the driver if the table asked for diCAN_CYCLIC_TX_AUTO_OFFSET. */
+	uint32_t ulFramesSent;
+	uint32_t ulFramesMissed;
+	uint16_t usPeakFramesPerMs;			/* The most frames of the whole table that are due in the same millisecond. */
+} CAN_Cyclic_Tx_Statistics_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_BIT_TIMING request.  Of the bit timings that give the bit rate
+nearest to ulBitRate, the one whose sample point is nearest to usSamplePoint is
+set.  ioctlSET_SPEED is the same request with the board's default sample point
+and SJW.  Both fail, leaving the bit timing as it was, if no bit timing gives a
+bit rate within 0.5% of the one requested. */
+typedef struct xCAN_BIT_TIMING_REQUEST
+{
+	uint32_t ulBitRate;					/* Up to 1000000. */
+	uint16_t usSamplePoint;				/* In tenths of a percent of the bit time - 875 for the 87.5% used by CANopen - or 0 for boardCAN_DEFAULT_SAMPLE_POINT. */
+	uint8_t ucSJW;						/* The synchronisation jump width, 1 to 4 time quanta, or 0 for 4.  It is shortened if TSEG2 is shorter. */
+} CAN_Bit_Timing_Request_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_BIT_TIMING request, which describes the bit timing actually set.
+The lengths of the segments are in time quanta.  A bit is one time quantum of
+synchronisation segment, then TSEG1 - the propagation segment and phase
+segment 1 - then TSEG2, and the bus is sampled between TSEG1 and TSEG2. */
+typedef struct xCAN_BIT_TIMING
+{
+	uint32_t ulBitRate;					/* The bit rate achieved, which can differ from the one requested. */
+	uint16_t usSamplePoint;				/* In tenths of a percent of the bit time. */
+	uint16_t usPrescaler;				/* Peripheral clock cycles per time quantum. */
+	uint8_t ucTimeQuanta;				/* Time quanta per bit. */
+	uint8_t ucTSEG1;
+	uint8_t ucTSEG2;
+	uint8_t ucSJW;
+	uint32_t ulBTR;						/* The value of the controller's bus timing register. */
+} CAN_Bit_Timing_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlDETECT_CAN_BIT_RATE request.  The controller listens to the bus at each bit
+rate in turn, with the default sample point and SJW, until ucFramesToLock
+frames are received without a bus error between them.  It listens in listen
+only mode, so never acknowledges a frame, sends an error flag or transmits
+while a bit rate is being tried, and the other nodes see no errors however many
+of the bit rates are wrong.  The request blocks for at most usListenTimeMs at
+each bit rate, then leaves the controller at the bit rate found, or, if none
+was, at the bit rate it had before and returns pdFAIL.  Must be called from a
+task. */
+typedef struct xCAN_BIT_RATE_DETECTION
+{
+	const uint32_t *pulBitRates;		/* The bit rates to try, in order, or NULL for the bit rates of CiA 301 - 1000000 down to 10000. */
+	uint16_t usNumberOfBitRates;		/* Ignored if pulBitRates is NULL. */
+	uint16_t usListenTimeMs;			/* Long enough for ucFramesToLock frames to be sent on the bus. */
+	uint8_t ucFramesToLock;				/* 1 or more. */
+	uint32_t ulBitRate;					/* Set by the driver to the bit rate found, or 0. */
+} CAN_Bit_Rate_Detection_t;
+
+/* What a queue set by ioctlSET_CAN_RX_PRIORITY does with a frame that arrives
+when it is full. */
+#define diCAN_RX_DROP_NEWEST				0	/* Discard the frame that arrived, as the Rx frame queue always does. */
+#define diCAN_RX_DROP_OLDEST				1	/* Discard the oldest frame in the queue, so the reader always gets the latest frames. */
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_RX_PRIORITY request, which can only be made once the Rx frame
+queue is in use.  Frames whose ID lies in one of the ranges are queued in a
+high priority queue of usHighQueueLength frames, and all others in the Rx frame
+queue, which becomes the low priority queue.  read() returns every frame in the
+high priority queue before the next frame in the low priority queue, so however
+many low priority frames are waiting, a high priority frame is returned by the
+next read().  A configuration with no ranges removes the high priority queue,
+discarding any frames still in it.  Fails if made while a task is reading from
+the controller, as the reader could still be using the queue it replaces. */
+typedef struct xCAN_RX_PRIORITY_CONFIG
+{
+	const CAN_Filter_Entry_t *pxHighPriorityIDs;	/* The ranges of IDs that are high priority.  Copied by the driver. */
+	uint16_t usNumberOfRanges;
+	uint16_t usHighQueueLength;						/* The number of frames the high priority queue can hold. */
+	uint8_t ucHighOverflowPolicy;					/* diCAN_RX_DROP_NEWEST or diCAN_RX_DROP_OLDEST. */
+	uint8_t ucLowOverflowPolicy;
+} CAN_Rx_Priority_Config_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_RX_PRIORITY_STATISTICS request.  The counts start again each time
+ioctlSET_CAN_RX_PRIORITY is made.  ioctlGET_CAN_RX_OVERRUN_COUNT returns the
+frames discarded by both queues. */
+typedef struct xCAN_RX_PRIORITY_STATISTICS
+{
+	uint32_t ulHighFramesQueued;
+	uint32_t ulHighOverruns;						/* Frames discarded because the high priority queue was full. */
+	uint32_t ulLowFramesQueued;
+	uint32_t ulLowOverruns;
+} CAN_Rx_Priority_Statistics_t;
+
+/* The result of a frame reported by a Tx confirmation. */
+#define diCAN_TX_SENT						0	/* The frame was sent, and acknowledged by at least one other node. */
+#define diCAN_TX_ABORTED					1	/* The frame was not sent - its transmission was aborted, or the controller was reset. */
+
+/* A Tx confirmation, which reports what became of one frame loaded into a
+hardware Tx buffer.  Frames are confirmed in the order in which their buffers
+complete, which is not always the order in which they were written. */
+typedef struct xCAN_TX_CONFIRMATION
+{
+	uint8_t ucFormat;					/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint8_t ucType;						/* DATA_FRAME or REMOTE_FRAME. */
+	uint8_t ucLength;
+	uint32_t ulID;
+	uint32_t ulDataA;					/* The data of the frame, laid out as the dataAWord and dataBWord members of CAN_MSG_Type. */
+	uint32_t ulDataB;
+	uint8_t ucBuffer;					/* The hardware Tx buffer, 1 to 3, that held the frame. */
+	uint8_t ucResult;					/* diCAN_TX_SENT or diCAN_TX_ABORTED. */
+	uint32_t ulTimestamp;				/* The time at which the buffer completed, in timestamp units (see CAN_Tx_Timestamp_t). */
+} CAN_Tx_Confirmation_t;
+
+/* A function that is given each Tx confirmation.  It is called from the CAN
+interrupt, or from within the critical section in which a task loads a frame
+into the buffer that held the confirmed frame, so must be short, and may only
+use the FreeRTOS API functions that end in "FromISR".  The confirmation pointed
+to by pxConfirmation is only valid until the function returns. */
+typedef void ( *CAN_Tx_Confirmation_Function_t )( const CAN_Tx_Confirmation_t *pxConfirmation, void *pvContext, portBASE_TYPE *pxHigherPriorityTaskWoken );
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlSET_CAN_TX_CONFIRMATION request.  Once set, every frame the controller
+loads into a hardware Tx buffer - whether written by a task, or sent by the
+Tx frame queue, the router, ISO-TP, J1939 or the cyclic Tx scheduler - is
+confirmed when its buffer completes, to the function, to the queue read by
+ioctlGET_CAN_TX_CONFIRMATION, or to both.  A confirmation is normally made by
+the Tx interrupt of the buffer.  One whose interrupt has not been handled by the
+time the buffer is loaded again is made as the buffer is loaded, and is
+timestamped then.  A configuration with no function and no queue stops the
+confirmations.  Must not be made while a task is waiting for a confirmation. */
+typedef struct xCAN_TX_CONFIRMATION_CONFIG
+{
+	CAN_Tx_Confirmation_Function_t pxFunction;	/* Called with each confirmation, or NULL. */
+	void *pvContext;					/* Passed to pxFunction. */
+	uint16_t usQueueLength;				/* The number of confirmations the queue can hold, or 0 for no queue. */
+	portTickType xBlockTime;			/* The longest time ioctlGET_CAN_TX_CONFIRMATION waits for a confirmation. */
+} CAN_Tx_Confirmation_Config_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_TX_CONFIRMATION_STATISTICS request.  The counts start again each
+time ioctlSET_CAN_TX_CONFIRMATION is made. */
+typedef struct xCAN_TX_CONFIRMATION_STATISTICS
+{
+	uint32_t ulFramesSent;
+	uint32_t ulFramesAborted;
+	uint32_t ulOverruns;				/* Confirmations discarded because the queue was full. */
+} CAN_Tx_Confirmation_Statistics_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_TX_DEADLINE_DROPS request.  Once ioctlSET_CAN_TX_DEADLINES has
+been made, with pvValue holding the number of IDs whose drops are counted (0
+stops the deadlines), the timestamp member of each frame a task writes to the
+Tx frame queue is the time, in timestamp units (see CAN_Tx_Timestamp_t), by
+which the frame must have been sent, or 0 if the frame has no deadline.  A
+frame still in the queue at its deadline is dropped from the queue, and one
+still waiting in a hardware Tx buffer is aborted, unless it is already being
+sent.  IDs are numbered from 0 in the order in which a frame with the ID was
+first dropped, so every ID can be found by incrementing usIndex until the
+request returns pdFAIL. */
+typedef struct xCAN_TX_DEADLINE_DROPS
+{
+	uint16_t usIndex;					/* Set by the application to the number of the ID to return. */
+	uint8_t ucFormat;					/* STD_ID_FORMAT or EXT_ID_FORMAT. */
+	uint32_t ulID;
+	uint32_t ulDroppedFromQueue;		/* Frames with the ID dropped from the Tx frame queue. */
+	uint32_t ulAborted;					/* Frames with the ID aborted in a hardware Tx buffer. */
+} CAN_Tx_Deadline_Drops_t;
+
+/* The structure pointed to by the pvValue parameter of the
+ioctlGET_CAN_TX_DEADLINE_STATISTICS request.  The counts start again each
+time ioctlSET_CAN_TX_DEADLINES is made. */
+typedef struct xCAN_TX_DEADLINE_STATISTICS
+{
+	uint32_t ulDroppedFromQueue;
+	uint32_t ulAborted;
+	uint32_t ulUntrackedDrops;			/* Drops of IDs that were not counted because the table of IDs was full. */
+	uint16_t usIDsTracked;				/* The number of IDs that can be returned by ioctlGET_CAN_TX_DEADLINE_DROPS. */
+} CAN_Tx_Deadline_Statistics_t;
 
 /*
  * Peripheral control structure access macros.
@@ -149,6 +750,7 @@ typedef struct xPERIPHREAL_CONTROL
 #define diGET_TX_TRANSFER_STATE( pxPeripheralControl ) ( ( pxPeripheralControl )->pxTxControl->pvTransferState )
 #define diGET_RX_TRANSFER_STATE( pxPeripheralControl ) ( ( pxPeripheralControl )->pxRxControl->pvTransferState )
 #define diGET_TRANSFER_TYPE_FROM_CONTROL_STRUCT( pxTransferControl ) pxTransferControl->ucType
+#define diGET_DEVICE_STATE( pxPeripheralControl ) ( ( pxPeripheralControl )->pvDeviceState )
 
 /*
  * Function prototypes.
@@ -680,8 +680,16 @@ typedef struct {
 								 - if format = STD_ID_FORMAT, id should be 11 bit identifier
 								 - if format = EXT_ID_FORMAT, id should be 29 bit identifier
 							 */
-	uint8_t dataA[4]; 		/**< Data field A */
-	uint8_t dataB[4]; 		/**< Data field B */
+	union {
+		uint8_t dataA[4]; 	/**< Data field A */
+		uint32_t dataAWord;	/**< Data field A as one little endian word, laid
+								 out as the CANxRDA and CANxTDAn registers */
+	};
+	union {
+		uint8_t dataB[4]; 	/**< Data field B */
+		uint32_t dataBWord;	/**< Data field B as one little endian word, laid
+								 out as the CANxRDB and CANxTDBn registers */
+	};
 	uint8_t len; 			/**< Length of data field in bytes, should be:
 								 - 0000b-0111b: 0-7 bytes
 								 - 1xxxb: 8 bytes
@@ -695,6 +703,13 @@ typedef struct {
 								 field are send from the CANxTDA and CANxTDB registers
 								 - REMOTE_FRAME: Remote Frame is sent
 							*/
+	uint32_t timestamp;		/**< When receiving, the time at which the frame
+								 was received, set by the FreeRTOS+IO driver.
+								 When sending through a Tx frame queue with
+								 ioctlSET_CAN_TX_DEADLINES made, the deadline
+								 by which the frame must have been sent, or 0
+								 for no deadline.  Otherwise ignored when sending
+							*/
 } CAN_MSG_Type;
 
 /**
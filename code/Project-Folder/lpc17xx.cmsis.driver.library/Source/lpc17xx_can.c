@@ -282,7 +282,14 @@ CAN_ERROR CAN_SetupAFLUT(LPC_CANAF_TypeDef* CANAFx, AF_SectionDef* AFSection)
 				count++;
 				CANAF_FullCAN_cnt++;
 			}
-			AFSection->FullCAN_Sec = (FullCAN_Entry *)((uint32_t)(AFSection->FullCAN_Sec)+ sizeof(FullCAN_Entry));
+			AFSection->FullCAN_Sec++;
+		}
+		// an odd last entry shares its word with a disabled entry
+		if((CANAF_FullCAN_cnt & 0x00000001)!=0)
+		{
+			LPC_CANAF_RAM->mask[count] &= 0xFFFF0000;
+			LPC_CANAF_RAM->mask[count] |= 0x0000FFFF;
+			count++;
 		}
 	}
 
@@ -335,7 +342,14 @@ CAN_ERROR CAN_SetupAFLUT(LPC_CANAF_TypeDef* CANAFx, AF_SectionDef* AFSection)
 				count++;
 				CANAF_std_cnt++;
 			}
-			AFSection->SFF_Sec = (SFF_Entry *)((uint32_t)(AFSection->SFF_Sec)+ sizeof(SFF_Entry));
+			AFSection->SFF_Sec++;
+		}
+		// an odd last entry shares its word with a disabled entry
+		if((CANAF_std_cnt & 0x00000001)!=0)
+		{
+			LPC_CANAF_RAM->mask[count] &= 0xFFFF0000;
+			LPC_CANAF_RAM->mask[count] |= 0x0000FFFF;
+			count++;
 		}
 	}
 
@@ -378,7 +392,7 @@ CAN_ERROR CAN_SetupAFLUT(LPC_CANAF_TypeDef* CANAFx, AF_SectionDef* AFSection)
 			LPC_CANAF_RAM->mask[count] = entry;
 			CANAF_gstd_cnt++;
 			count++;
-			AFSection->SFF_GPR_Sec = (SFF_GPR_Entry *)((uint32_t)(AFSection->SFF_GPR_Sec)+ sizeof(SFF_GPR_Entry));
+			AFSection->SFF_GPR_Sec++;
 		}
 	}
 
@@ -412,7 +426,7 @@ CAN_ERROR CAN_SetupAFLUT(LPC_CANAF_TypeDef* CANAFx, AF_SectionDef* AFSection)
 			LPC_CANAF_RAM->mask[count] = entry;
 			CANAF_ext_cnt ++;
 			count++;
-			AFSection->EFF_Sec = (EFF_Entry *)((uint32_t)(AFSection->EFF_Sec)+ sizeof(EFF_Entry));
+			AFSection->EFF_Sec++;
 		}
 	}
 
@@ -451,7 +465,7 @@ CAN_ERROR CAN_SetupAFLUT(LPC_CANAF_TypeDef* CANAFx, AF_SectionDef* AFSection)
 			entry = (ctrl2 << 29)|(upperEID << 0);
 			LPC_CANAF_RAM->mask[count++] = entry;
 			CANAF_gext_cnt++;
-			AFSection->EFF_GPR_Sec = (EFF_GPR_Entry *)((uint32_t)(AFSection->EFF_GPR_Sec)+ sizeof(EFF_GPR_Entry));
+			AFSection->EFF_GPR_Sec++;
 		}
 	}
 	//update address values
@@ -1302,7 +1316,6 @@ CAN_ERROR CAN_RemoveEntry(AFLUT_ENTRY_Type EntryType, uint16_t position)
  *********************************************************************/
 Status CAN_SendMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg,uint8_t self_rec)
 {
-	uint32_t data;
 	CHECK_PARAM(PARAM_CANx(CANx));
 	CHECK_PARAM(PARAM_ID_FORMAT(CAN_Msg->format));
 	if(CAN_Msg->format==STD_ID_FORMAT)
@@ -1345,12 +1358,10 @@ Status CAN_SendMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg,uint8_t self_re
 		CANx->TID1 = CAN_Msg->id;
 
 		/*Write first 4 data bytes*/
-		data = (CAN_Msg->dataA[0])|(((CAN_Msg->dataA[1]))<<8)|((CAN_Msg->dataA[2])<<16)|((CAN_Msg->dataA[3])<<24);
-		CANx->TDA1 = data;
+		CANx->TDA1 = CAN_Msg->dataAWord;
 
 		/*Write second 4 data bytes*/
-		data = (CAN_Msg->dataB[0])|(((CAN_Msg->dataB[1]))<<8)|((CAN_Msg->dataB[2])<<16)|((CAN_Msg->dataB[3])<<24);
-		CANx->TDB1 = data;
+		CANx->TDB1 = CAN_Msg->dataBWord;
 
 		 /*Write transmission request*/
 		if(self_rec==0)
@@ -1388,12 +1399,10 @@ Status CAN_SendMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg,uint8_t self_re
 		CANx->TID2 = CAN_Msg->id;
 
 		/*Write first 4 data bytes*/
-		data = (CAN_Msg->dataA[0])|(((CAN_Msg->dataA[1]))<<8)|((CAN_Msg->dataA[2])<<16)|((CAN_Msg->dataA[3])<<24);
-		CANx->TDA2 = data;
+		CANx->TDA2 = CAN_Msg->dataAWord;
 
 		/*Write second 4 data bytes*/
-		data = (CAN_Msg->dataB[0])|(((CAN_Msg->dataB[1]))<<8)|((CAN_Msg->dataB[2])<<16)|((CAN_Msg->dataB[3])<<24);
-		CANx->TDB2 = data;
+		CANx->TDB2 = CAN_Msg->dataBWord;
 
 		/*Write transmission request*/
 		CANx->CMR = 0x41;
@@ -1428,12 +1437,10 @@ Status CAN_SendMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg,uint8_t self_re
 		CANx->TID3 = CAN_Msg->id;
 
 		/*Write first 4 data bytes*/
-		data = (CAN_Msg->dataA[0])|(((CAN_Msg->dataA[1]))<<8)|((CAN_Msg->dataA[2])<<16)|((CAN_Msg->dataA[3])<<24);
-		CANx->TDA3 = data;
+		CANx->TDA3 = CAN_Msg->dataAWord;
 
 		/*Write second 4 data bytes*/
-		data = (CAN_Msg->dataB[0])|(((CAN_Msg->dataB[1]))<<8)|((CAN_Msg->dataB[2])<<16)|((CAN_Msg->dataB[3])<<24);
-		CANx->TDB3 = data;
+		CANx->TDB3 = CAN_Msg->dataBWord;
 
 		/*Write transmission request*/
 		CANx->CMR = 0x81;
@@ -1458,8 +1465,6 @@ Status CAN_SendMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg,uint8_t self_re
  *********************************************************************/
 Status CAN_ReceiveMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg)
 {
-	uint32_t data;
-
 	CHECK_PARAM(PARAM_CANx(CANx));
 
 	//check status of Receive Buffer
@@ -1479,18 +1484,10 @@ Status CAN_ReceiveMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg)
 		if (CAN_Msg->type == DATA_FRAME)
 		{
 			/* Read first 4 data bytes */
-			data = CANx->RDA;
-			*((uint8_t *) &CAN_Msg->dataA[0])= data & 0x000000FF;
-			*((uint8_t *) &CAN_Msg->dataA[1])= (data & 0x0000FF00)>>8;;
-			*((uint8_t *) &CAN_Msg->dataA[2])= (data & 0x00FF0000)>>16;
-			*((uint8_t *) &CAN_Msg->dataA[3])= (data & 0xFF000000)>>24;
+			CAN_Msg->dataAWord = CANx->RDA;
 
 			/* Read second 4 data bytes */
-			data = CANx->RDB;
-			*((uint8_t *) &CAN_Msg->dataB[0])= data & 0x000000FF;
-			*((uint8_t *) &CAN_Msg->dataB[1])= (data & 0x0000FF00)>>8;
-			*((uint8_t *) &CAN_Msg->dataB[2])= (data & 0x00FF0000)>>16;
-			*((uint8_t *) &CAN_Msg->dataB[3])= (data & 0xFF000000)>>24;
+			CAN_Msg->dataBWord = CANx->RDB;
 
 		/*release receive buffer*/
 		CANx->CMR = 0x04;
@@ -1523,7 +1520,7 @@ Status CAN_ReceiveMsg (LPC_CAN_TypeDef *CANx, CAN_MSG_Type *CAN_Msg)
  *********************************************************************/
 CAN_ERROR FCAN_ReadObj (LPC_CANAF_TypeDef* CANAFx, CAN_MSG_Type *CAN_Msg)
 {
-	uint32_t *pSrc, data;
+	uint32_t *pSrc;
 	uint32_t interrut_word, msg_idx, test_bit, head_idx, tail_idx;
 
 	CHECK_PARAM(PARAM_CANAFx(CANAFx));
@@ -1565,20 +1562,12 @@ CAN_ERROR FCAN_ReadObj (LPC_CANAF_TypeDef* CANAFx, CAN_MSG_Type *CAN_Msg)
 	    	 		/*Set to DatA*/
 	    	 		pSrc++;
 	    	 		/* Copy to dest buf */
-	    	 		data = *pSrc;
-	    			*((uint8_t *) &CAN_Msg->dataA[0])= data & 0x000000FF;
-	    			*((uint8_t *) &CAN_Msg->dataA[1])= (data & 0x0000FF00)>>8;
-	    			*((uint8_t *) &CAN_Msg->dataA[2])= (data & 0x00FF0000)>>16;
-	    			*((uint8_t *) &CAN_Msg->dataA[3])= (data & 0xFF000000)>>24;
+	    	 		CAN_Msg->dataAWord = *pSrc;
 
 	    	 		/*Set to DatB*/
 	    	 		pSrc++;
 	    	 		/* Copy to dest buf */
-	    	 		data = *pSrc;
-	    			*((uint8_t *) &CAN_Msg->dataB[0])= data & 0x000000FF;
-	    			*((uint8_t *) &CAN_Msg->dataB[1])= (data & 0x0000FF00)>>8;
-	    			*((uint8_t *) &CAN_Msg->dataB[2])= (data & 0x00FF0000)>>16;
-	    			*((uint8_t *) &CAN_Msg->dataB[3])= (data & 0xFF000000)>>24;
+	    	 		CAN_Msg->dataBWord = *pSrc;
 	    	 		/*Back to Dat1*/
 	    	 		pSrc -= 2;
 